@@ -21,6 +21,15 @@ static void EnqueueApiEvent(orbit_api::EventType type, const char* name = nullpt
   thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
   uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
 
+  // Async strings are sent in chunks through a buffer on the stack, so they can't be interned by
+  // address.
+  if (name != nullptr && type != orbit_api::kString && producer.IsInterningNames()) {
+    orbit_api::ApiEvent api_event(pid, tid, timestamp_ns, type, /*name=*/nullptr, data, color);
+    api_event.name_key = producer.InternName(name);
+    producer.EnqueueIntermediateEvent(api_event);
+    return;
+  }
+
   orbit_api::ApiEvent api_event(pid, tid, timestamp_ns, type, name, data, color);
   producer.EnqueueIntermediateEvent(api_event);
 }
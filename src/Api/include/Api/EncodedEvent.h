@@ -79,7 +79,7 @@ struct ApiEvent {
   ApiEvent(int32_t pid, int32_t tid, uint64_t timestamp_ns, orbit_api::EventType type,
            const char* name = nullptr, uint64_t data = 0, orbit_api_color color = kOrbitColorAuto)
       : encoded_event(type, name, data, color), pid(pid), tid(tid), timestamp_ns(timestamp_ns) {
-    static_assert(sizeof(ApiEvent) == 64, "orbit_api::ApiEvent should be 64 bytes.");
+    static_assert(sizeof(ApiEvent) == 72, "orbit_api::ApiEvent should be 72 bytes.");
   }
   orbit_api::EventType Type() const { return encoded_event.Type(); }
 
@@ -87,6 +87,8 @@ struct ApiEvent {
   int32_t pid;
   int32_t tid;
   uint64_t timestamp_ns;
+  // If not 0, the name is not part of encoded_event but was interned with this key.
+  uint64_t name_key = 0;
 };
 
 template <typename Dest, typename Source>
@@ -5,14 +5,32 @@
 #ifndef API_LOCK_FREE_API_EVENT_PRODUCER_H_
 #define API_LOCK_FREE_API_EVENT_PRODUCER_H_
 
+#include <absl/base/casts.h>
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
+
+#include <atomic>
+#include <string>
+
 #include "Api/EncodedEvent.h"
 #include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
 #include "ProducerSideChannel/ProducerSideChannel.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 
 namespace orbit_api {
 
 // This class is used to enqueue orbit_api::ApiEvent events from multiple threads and relay them to
 // OrbitService in the form of orbit_grpc_protos::ApiEvent events.
+//
+// When the capture options ask for it, names are interned: an instrumented thread registers the
+// full name the first time it uses a given address in a capture (see InternName), and events only
+// carry that address as key. The InternedString is then sent by the forwarder thread right before
+// the first event that refers to it, so that it is always received before any such event.
+//
+// When events are sent through shared memory, each ApiEvent is written as a fixed-size
+// SharedMemoryApiEventRecord, without building a protobuf.
 class LockFreeApiEventProducer
     : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<orbit_api::ApiEvent> {
  public:
@@ -22,8 +40,48 @@ class LockFreeApiEventProducer
 
   ~LockFreeApiEventProducer() { ShutdownAndWait(); }
 
+  [[nodiscard]] bool IsInterningNames() const {
+    return intern_names_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the key to set as orbit_api::ApiEvent::name_key for `name`. Only the first call with a
+  // given address in a capture copies the string, and only the first call from each thread takes a
+  // lock. Subsequent calls with the same address are assumed to refer to the same string.
+  [[nodiscard]] uint64_t InternName(const char* name) {
+    struct ThreadLocalInternedNames {
+      uint64_t capture_generation = 0;
+      absl::flat_hash_set<const char*> names;
+    };
+    thread_local ThreadLocalInternedNames thread_local_interned_names;
+
+    const uint64_t key = absl::bit_cast<uint64_t>(name);
+    const uint64_t capture_generation = capture_generation_.load(std::memory_order_acquire);
+    if (thread_local_interned_names.capture_generation != capture_generation) {
+      thread_local_interned_names.names.clear();
+      thread_local_interned_names.capture_generation = capture_generation;
+    }
+    if (thread_local_interned_names.names.insert(name).second) {
+      absl::MutexLock lock{&interned_names_mutex_};
+      interned_names_.try_emplace(key, name);
+    }
+    return key;
+  }
+
  protected:
-  [[nodiscard]] virtual orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+  void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
+    intern_names_ = capture_options.intern_orbit_api_names();
+    LockFreeBufferCaptureEventProducer::OnCaptureStart(std::move(capture_options));
+  }
+
+  void OnCaptureFinished() override {
+    LockFreeBufferCaptureEventProducer::OnCaptureFinished();
+    intern_names_ = false;
+    absl::MutexLock lock{&interned_names_mutex_};
+    interned_names_.clear();
+    capture_generation_.fetch_add(1, std::memory_order_release);
+  }
+
+  [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
       orbit_api::ApiEvent&& raw_api_event, google::protobuf::Arena* arena) override {
     auto* capture_event =
         google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
@@ -37,8 +95,93 @@ class LockFreeApiEventProducer
     api_event->set_r3(raw_api_event.encoded_event.args[3]);
     api_event->set_r4(raw_api_event.encoded_event.args[4]);
     api_event->set_r5(raw_api_event.encoded_event.args[5]);
+    api_event->set_name_key(raw_api_event.name_key);
+    return capture_event;
+  }
+
+  void AddTranslatedIntermediateEvents(
+      orbit_api::ApiEvent&& raw_api_event, google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* capture_events)
+      override {
+    orbit_grpc_protos::ProducerCaptureEvent* interned_string_event =
+        CreateInternedStringEventIfNotSent(&raw_api_event, arena);
+    if (interned_string_event != nullptr) {
+      capture_events->AddAllocated(interned_string_event);
+    }
+    capture_events->AddAllocated(TranslateIntermediateEvent(std::move(raw_api_event), arena));
+  }
+
+  void WriteIntermediateEventToSharedMemory(orbit_api::ApiEvent&& raw_api_event,
+                                            google::protobuf::Arena* arena) override {
+    orbit_grpc_protos::ProducerCaptureEvent* interned_string_event =
+        CreateInternedStringEventIfNotSent(&raw_api_event, arena);
+    if (interned_string_event != nullptr) {
+      WriteCaptureEventToSharedMemory(*interned_string_event);
+    }
+
+    orbit_producer_side_channel::SharedMemoryApiEventRecord record;
+    record.timestamp_ns = raw_api_event.timestamp_ns;
+    record.pid = raw_api_event.pid;
+    record.tid = raw_api_event.tid;
+    for (size_t i = 0; i < 6; ++i) {
+      record.args[i] = raw_api_event.encoded_event.args[i];
+    }
+    record.name_key = raw_api_event.name_key;
+    WriteRecordToSharedMemory(orbit_producer_side_channel::SharedMemoryRecordType::kApiEvent,
+                              record);
+  }
+
+ private:
+  // Returns the InternedString to send right before `raw_api_event` if its name hasn't been sent
+  // yet in this capture, or nullptr. Only to be called by the forwarder thread.
+  [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* CreateInternedStringEventIfNotSent(
+      orbit_api::ApiEvent* raw_api_event, google::protobuf::Arena* arena) {
+    const uint64_t capture_generation = capture_generation_.load(std::memory_order_acquire);
+    if (sent_name_keys_capture_generation_ != capture_generation) {
+      sent_name_keys_.clear();
+      sent_name_keys_capture_generation_ = capture_generation;
+    }
+
+    if (raw_api_event->name_key == 0 || sent_name_keys_.contains(raw_api_event->name_key)) {
+      return nullptr;
+    }
+
+    std::string name;
+    bool name_found = false;
+    {
+      absl::MutexLock lock{&interned_names_mutex_};
+      auto name_it = interned_names_.find(raw_api_event->name_key);
+      if (name_it != interned_names_.end()) {
+        name = name_it->second;
+        name_found = true;
+      }
+    }
+
+    if (!name_found) {
+      // The event was produced before the intern pool was cleared for a new capture: its name is
+      // lost, but the event must not refer to a string that was never sent.
+      raw_api_event->name_key = 0;
+      return nullptr;
+    }
+
+    auto* capture_event =
+        google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
+    capture_event->mutable_interned_string()->set_key(raw_api_event->name_key);
+    capture_event->mutable_interned_string()->set_intern(std::move(name));
+    sent_name_keys_.insert(raw_api_event->name_key);
     return capture_event;
   }
+
+  std::atomic<bool> intern_names_ = false;
+
+  // Incremented every time the interned names are cleared, so that the per-thread caches of
+  // InternName and the keys already sent by the forwarder thread can be reset too.
+  std::atomic<uint64_t> capture_generation_ = 0;
+  absl::Mutex interned_names_mutex_;
+  absl::flat_hash_map<uint64_t, std::string> interned_names_ ABSL_GUARDED_BY(interned_names_mutex_);
+
+  uint64_t sent_name_keys_capture_generation_ = 0;
+  absl::flat_hash_set<uint64_t> sent_name_keys_;
 };
 
 }  // namespace orbit_api
@@ -4,6 +4,8 @@
 
 #include "CaptureClient/ApiEventProcessor.h"
 
+#include <cstring>
+
 #include "OrbitBase/Logging.h"
 
 namespace orbit_capture_client {
@@ -16,8 +18,8 @@ ApiEventProcessor::ApiEventProcessor(CaptureListener* listener) : capture_listen
 }
 
 static inline TimerInfo TimerInfoFromEncodedEvent(const orbit_api::EncodedEvent& encoded_event,
-                                                  uint64_t start, uint64_t end, int32_t pid,
-                                                  int32_t tid, uint32_t depth) {
+                                                  uint64_t name_key, uint64_t start, uint64_t end,
+                                                  int32_t pid, int32_t tid, uint32_t depth) {
   TimerInfo timer_info;
   timer_info.set_start(start);
   timer_info.set_end(end);
@@ -32,10 +34,14 @@ static inline TimerInfo TimerInfoFromEncodedEvent(const orbit_api::EncodedEvent&
   timer_info.add_registers(encoded_event.args[3]);
   timer_info.add_registers(encoded_event.args[4]);
   timer_info.add_registers(encoded_event.args[5]);
+  // The name encoded in the registers is truncated, the full name is available from this key.
+  timer_info.set_user_data_key(name_key);
   return timer_info;
 }
 
-void ApiEventProcessor::ProcessApiEvent(const orbit_grpc_protos::ApiEvent& grpc_api_event) {
+void ApiEventProcessor::ProcessApiEvent(
+    const orbit_grpc_protos::ApiEvent& grpc_api_event,
+    const absl::flat_hash_map<uint64_t, std::string>& string_intern_pool) {
   orbit_api::ApiEvent api_event;
   api_event.pid = grpc_api_event.pid();
   api_event.tid = grpc_api_event.tid();
@@ -46,6 +52,19 @@ void ApiEventProcessor::ProcessApiEvent(const orbit_grpc_protos::ApiEvent& grpc_
   api_event.encoded_event.args[3] = grpc_api_event.r3();
   api_event.encoded_event.args[4] = grpc_api_event.r4();
   api_event.encoded_event.args[5] = grpc_api_event.r5();
+
+  if (grpc_api_event.name_key() != 0) {
+    auto name_it = string_intern_pool.find(grpc_api_event.name_key());
+    if (name_it != string_intern_pool.end()) {
+      api_event.name_key = grpc_api_event.name_key();
+      char* name = api_event.encoded_event.event.name;
+      std::strncpy(name, name_it->second.c_str(), orbit_api::kMaxEventStringSize - 1);
+      name[orbit_api::kMaxEventStringSize - 1] = 0;
+    } else {
+      ERROR("Unknown key %u for the name of an ApiEvent", grpc_api_event.name_key());
+    }
+  }
+
   ProcessApiEvent(api_event);
 }
 
@@ -93,8 +112,8 @@ void ApiEventProcessor::ProcessStopEvent(const orbit_api::ApiEvent& stop_event)
 
   const orbit_api::ApiEvent& start_event = event_stack.back();
   TimerInfo timer_info = TimerInfoFromEncodedEvent(
-      start_event.encoded_event, start_event.timestamp_ns, stop_event.timestamp_ns, stop_event.pid,
-      stop_event.tid, /*depth=*/event_stack.size() - 1);
+      start_event.encoded_event, start_event.name_key, start_event.timestamp_ns,
+      stop_event.timestamp_ns, stop_event.pid, stop_event.tid, /*depth=*/event_stack.size() - 1);
   capture_listener_->OnTimer(timer_info);
   event_stack.pop_back();
 }
@@ -114,17 +133,17 @@ void ApiEventProcessor::ProcessAsyncStopEvent(const orbit_api::ApiEvent& stop_ev
 
   orbit_api::ApiEvent& start_event = asynchronous_events_by_id_[event_id];
   TimerInfo timer_info = TimerInfoFromEncodedEvent(
-      start_event.encoded_event, start_event.timestamp_ns, stop_event.timestamp_ns, stop_event.pid,
-      stop_event.tid, /*depth=*/0);
+      start_event.encoded_event, start_event.name_key, start_event.timestamp_ns,
+      stop_event.timestamp_ns, stop_event.pid, stop_event.tid, /*depth=*/0);
   capture_listener_->OnTimer(timer_info);
 
   asynchronous_events_by_id_.erase(event_id);
 }
 
 void ApiEventProcessor::ProcessTrackingEvent(const orbit_api::ApiEvent& api_event) {
-  TimerInfo timer_info =
-      TimerInfoFromEncodedEvent(api_event.encoded_event, api_event.timestamp_ns,
-                                api_event.timestamp_ns, api_event.pid, api_event.tid, /*depth=*/0);
+  TimerInfo timer_info = TimerInfoFromEncodedEvent(
+      api_event.encoded_event, api_event.name_key, api_event.timestamp_ns, api_event.timestamp_ns,
+      api_event.pid, api_event.tid, /*depth=*/0);
   capture_listener_->OnTimer(timer_info);
 }
 
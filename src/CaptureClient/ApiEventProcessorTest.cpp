@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <string>
 #include <vector>
 
 #include "CaptureClient/ApiEventProcessor.h"
@@ -21,6 +22,7 @@ using orbit_client_protos::TimerInfo;
 
 using orbit_grpc_protos::ApiEvent;
 using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::InternedString;
 
 namespace {
 
@@ -103,6 +105,19 @@ class ApiTester {
     EnqueueApiEvent(orbit_api::kTrackUint64, name, value, color);
     return *this;
   }
+  ApiTester& InternName(uint64_t key, const std::string& name) {
+    ClientCaptureEvent client_capture_event;
+    InternedString* interned_string = client_capture_event.mutable_interned_string();
+    interned_string->set_key(key);
+    interned_string->set_intern(name);
+    string_intern_pool_.emplace(key, name);
+    capture_event_processor_->ProcessEvent(client_capture_event);
+    return *this;
+  }
+  ApiTester& StartWithInternedName(uint64_t name_key) {
+    EnqueueApiEvent(orbit_api::kScopeStart, /*name=*/nullptr, 0, kOrbitColorAuto, name_key);
+    return *this;
+  }
 
   ApiTester& ExpectNumTimers(size_t num_timers) {
     EXPECT_EQ(api_event_listener_.timers_.size(), num_timers);
@@ -132,9 +147,21 @@ class ApiTester {
     return *this;
   }
 
+  ApiTester& ExpectLastTimerName(const std::string& name) {
+    EXPECT_EQ(ApiEventFromTimerInfo(api_event_listener_.timers_.back()).name, name);
+    EXPECT_EQ(ApiEventFromTimerInfo(capture_event_listener_.timers_.back()).name, name);
+    return *this;
+  }
+
+  ApiTester& ExpectLastTimerNameKey(uint64_t name_key) {
+    EXPECT_EQ(api_event_listener_.timers_.back().user_data_key(), name_key);
+    EXPECT_EQ(capture_event_listener_.timers_.back().user_data_key(), name_key);
+    return *this;
+  }
+
  private:
   void EnqueueApiEvent(orbit_api::EventType type, const char* name = nullptr, uint64_t data = 0,
-                       orbit_api_color color = kOrbitColorAuto) {
+                       orbit_api_color color = kOrbitColorAuto, uint64_t name_key = 0) {
     orbit_api::EncodedEvent encoded_event(type, name, data, color);
     ClientCaptureEvent client_capture_event;
     ApiEvent* api_event = client_capture_event.mutable_api_event();
@@ -147,8 +174,9 @@ class ApiTester {
     api_event->set_r3(encoded_event.args[3]);
     api_event->set_r4(encoded_event.args[4]);
     api_event->set_r5(encoded_event.args[5]);
+    api_event->set_name_key(name_key);
 
-    api_event_processor_.ProcessApiEvent(*api_event);
+    api_event_processor_.ProcessApiEvent(*api_event, string_intern_pool_);
     capture_event_processor_->ProcessEvent(client_capture_event);
   }
 
@@ -170,6 +198,7 @@ class ApiTester {
   }
 
   // ApiEventProcessor in isolation.
+  absl::flat_hash_map<uint64_t, std::string> string_intern_pool_;
   ApiEventCaptureListener api_event_listener_;
   ApiEventProcessor api_event_processor_;
 
@@ -259,6 +288,34 @@ TEST(ApiEventProcessor, MixedEvents) {
   api.Stop().ExpectNumTimers(7).ExpectNumScopeTimers(3);
 }
 
+TEST(ApiEventProcessor, ScopesWithInternedNames) {
+  constexpr uint64_t kKey0 = 42;
+  constexpr uint64_t kKey1 = 43;
+  ApiTester api;
+  api.InternName(kKey0, "Scope0").InternName(kKey1, "Scope1");
+  api.StartWithInternedName(kKey0).ExpectNumTimers(0);
+  api.StartWithInternedName(kKey1).ExpectNumTimers(0);
+  api.Stop().ExpectNumTimers(1).ExpectLastTimerName("Scope1");
+  api.Start("Scope2").ExpectNumTimers(1);
+  api.Stop().ExpectNumTimers(2).ExpectLastTimerName("Scope2");
+  api.Stop().ExpectNumTimers(3).ExpectLastTimerName("Scope0");
+
+  api.ExpectNumScopeTimers(3);
+}
+
+TEST(ApiEventProcessor, LongInternedNamesAreTruncatedButKeepTheirKey) {
+  constexpr uint64_t kKey = 42;
+  const std::string long_name(2 * orbit_api::kMaxEventStringSize, 'a');
+  ApiTester api;
+  api.InternName(kKey, long_name);
+  api.StartWithInternedName(kKey)
+      .Stop()
+      .ExpectNumTimers(1)
+      .ExpectLastTimerName(long_name.substr(0, orbit_api::kMaxEventStringSize - 1))
+      .ExpectLastTimerNameKey(kKey);
+  api.Start("Scope").Stop().ExpectNumTimers(2).ExpectLastTimerNameKey(0);
+}
+
 }  // namespace
 
 }  // namespace orbit_capture_client
@@ -8,11 +8,17 @@
 #include <absl/flags/declare.h>
 #include <absl/flags/flag.h>
 #include <absl/strings/str_format.h>
+#include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
 
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
 #include <outcome.hpp>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -20,10 +26,12 @@
 #include "CaptureClient/CaptureListener.h"
 #include "ClientData/FunctionUtils.h"
 #include "ClientData/ModuleData.h"
+#include "GrpcProtos/CaptureEventsCompression.h"
 #include "Introspection/Introspection.h"
 #include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "capture.pb.h"
 #include "tracepoint.pb.h"
 
@@ -45,6 +53,127 @@ using orbit_grpc_protos::UnwindingMethod;
 
 using orbit_base::Future;
 
+namespace {
+
+// Decompresses the compressed_capture_events of CaptureResponses on its own thread, so that reading
+// from the Capture gRPC stream is not slowed down by the decompression, and passes the events to
+// `process_events`. Responses are processed in the order in which they are added, whether they are
+// compressed or not. The destructor waits for all the responses to be processed.
+class CaptureResponseDecompressionThread {
+ public:
+  using ProcessEventsFunction =
+      std::function<void(const google::protobuf::RepeatedPtrField<ClientCaptureEvent>& events)>;
+
+  // The sizes of the compressed CaptureEvents and of the decompressed CaptureResponses are added to
+  // `compressed_byte_count` and `uncompressed_byte_count`.
+  explicit CaptureResponseDecompressionThread(ProcessEventsFunction process_events,
+                                              std::atomic<uint64_t>* compressed_byte_count,
+                                              std::atomic<uint64_t>* uncompressed_byte_count)
+      : process_events_{std::move(process_events)},
+        compressed_byte_count_{compressed_byte_count},
+        uncompressed_byte_count_{uncompressed_byte_count} {
+    CHECK(compressed_byte_count_ != nullptr);
+    CHECK(uncompressed_byte_count_ != nullptr);
+    thread_ = std::thread{&CaptureResponseDecompressionThread::Run, this};
+  }
+
+  ~CaptureResponseDecompressionThread() {
+    {
+      absl::MutexLock lock{&mutex_};
+      stop_requested_ = true;
+    }
+    thread_.join();
+    LOG("Received %u bytes of compressed CaptureEvents, %u bytes after decompression",
+        compressed_byte_count_->load(), uncompressed_byte_count_->load());
+  }
+
+  CaptureResponseDecompressionThread(const CaptureResponseDecompressionThread&) = delete;
+  CaptureResponseDecompressionThread& operator=(const CaptureResponseDecompressionThread&) =
+      delete;
+  CaptureResponseDecompressionThread(CaptureResponseDecompressionThread&&) = delete;
+  CaptureResponseDecompressionThread& operator=(CaptureResponseDecompressionThread&&) = delete;
+
+  // Blocks while kMaxQueuedResponses responses are waiting to be processed, so that a slow
+  // decompression throttles the reading from the gRPC stream instead of accumulating responses.
+  void AddResponse(CaptureResponse&& response) {
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(
+        +[](CaptureResponseDecompressionThread* self) {
+          return self->responses_.size() < kMaxQueuedResponses;
+        },
+        this));
+    responses_.push_back(std::move(response));
+  }
+
+ private:
+  void Run() {
+    orbit_base::SetCurrentThreadName("CC::Decompress");
+    std::deque<CaptureResponse> responses;
+    while (true) {
+      {
+        absl::MutexLock lock{&mutex_};
+        mutex_.Await(absl::Condition(
+            +[](CaptureResponseDecompressionThread* self) {
+              return !self->responses_.empty() || self->stop_requested_;
+            },
+            this));
+        if (responses_.empty()) return;
+        std::swap(responses, responses_);
+      }
+      for (const CaptureResponse& response : responses) {
+        ProcessResponse(response);
+      }
+      responses.clear();
+    }
+  }
+
+  void ProcessResponse(const CaptureResponse& response) {
+    if (response.compressed_capture_events().empty()) {
+      process_events_(response.capture_events());
+      return;
+    }
+
+    *compressed_byte_count_ += response.compressed_capture_events().size();
+    ErrorMessageOr<void> decompress_result =
+        decompressor_.DecompressBlock(response.compressed_capture_events(), &serialized_response_);
+    if (decompress_result.has_error()) {
+      // All the following blocks will fail to decompress as well, only report the first error.
+      if (!decompression_failed_) {
+        ERROR("%s", decompress_result.error().message());
+        decompression_failed_ = true;
+      }
+      return;
+    }
+    *uncompressed_byte_count_ += serialized_response_.size();
+    if (!decompressed_response_.ParseFromString(serialized_response_)) {
+      ERROR("Parsing decompressed CaptureResponse");
+      return;
+    }
+    process_events_(decompressed_response_.capture_events());
+  }
+
+  // Each response carries up to 10000 events, so this bounds the memory held by the queue.
+  static constexpr size_t kMaxQueuedResponses = 64;
+
+  ProcessEventsFunction process_events_;
+  std::atomic<uint64_t>* compressed_byte_count_;
+  std::atomic<uint64_t>* uncompressed_byte_count_;
+
+  absl::Mutex mutex_;
+  std::deque<CaptureResponse> responses_ ABSL_GUARDED_BY(mutex_);
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Only accessed by the decompression thread, and by the destructor after the thread has exited.
+  orbit_grpc_protos::CaptureEventsDecompressor decompressor_;
+  bool decompression_failed_ = false;
+  std::string serialized_response_;
+  CaptureResponse decompressed_response_;
+
+  std::thread thread_;
+};
+
+}  // namespace
+
 InstrumentedFunction::FunctionType CaptureClient::InstrumentedFunctionTypeFromOrbitType(
     FunctionInfo::OrbitType orbit_type) {
   switch (orbit_type) {
@@ -76,6 +205,9 @@ Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> CaptureClient::Capture(
     bool collect_gpu_jobs, bool enable_api, bool enable_introspection,
     bool enable_user_space_instrumentation, uint64_t max_local_marker_depth_per_command_buffer,
     bool collect_memory_info, uint64_t memory_sampling_period_ms,
+    uint32_t ring_buffer_reader_thread_count, bool event_driven_ring_buffer_polling,
+    bool compress_capture_events, bool unwind_with_precompiled_cfi, bool intern_orbit_api_names,
+    bool use_shared_memory_producer_transport, bool use_unwinding_cache,
     std::unique_ptr<CaptureEventProcessor> capture_event_processor) {
   absl::MutexLock lock(&state_mutex_);
   if (state_ != State::kStopped) {
@@ -93,13 +225,20 @@ Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> CaptureClient::Capture(
        unwinding_method, collect_scheduling_info, collect_thread_state, collect_gpu_jobs,
        enable_api, enable_introspection, enable_user_space_instrumentation,
        max_local_marker_depth_per_command_buffer, collect_memory_info, memory_sampling_period_ms,
+       ring_buffer_reader_thread_count, event_driven_ring_buffer_polling, compress_capture_events,
+       unwind_with_precompiled_cfi, intern_orbit_api_names, use_shared_memory_producer_transport,
+       use_unwinding_cache,
        capture_event_processor = std::move(capture_event_processor)]() mutable {
         return CaptureSync(process_id, module_manager, selected_functions, selected_tracepoints,
                            samples_per_second, stack_dump_size, unwinding_method,
                            collect_scheduling_info, collect_thread_state, collect_gpu_jobs,
                            enable_api, enable_introspection, enable_user_space_instrumentation,
                            max_local_marker_depth_per_command_buffer, collect_memory_info,
-                           memory_sampling_period_ms, capture_event_processor.get());
+                           memory_sampling_period_ms, ring_buffer_reader_thread_count,
+                           event_driven_ring_buffer_polling, compress_capture_events,
+                           unwind_with_precompiled_cfi, intern_orbit_api_names,
+                           use_shared_memory_producer_transport, use_unwinding_cache,
+                           capture_event_processor.get());
       });
 
   return capture_result;
@@ -138,10 +277,15 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
     bool collect_thread_state, bool collect_gpu_jobs, bool enable_api, bool enable_introspection,
     bool enable_user_space_instrumentation, uint64_t max_local_marker_depth_per_command_buffer,
     bool collect_memory_info, uint64_t memory_sampling_period_ms,
+    uint32_t ring_buffer_reader_thread_count, bool event_driven_ring_buffer_polling,
+    bool compress_capture_events, bool unwind_with_precompiled_cfi, bool intern_orbit_api_names,
+    bool use_shared_memory_producer_transport, bool use_unwinding_cache,
     CaptureEventProcessor* capture_event_processor) {
   ORBIT_SCOPE_FUNCTION;
   writes_done_failed_ = false;
   try_abort_ = false;
+  compressed_capture_events_byte_count_ = 0;
+  uncompressed_capture_events_byte_count_ = 0;
   {
     absl::WriterMutexLock lock{&context_and_stream_mutex_};
     CHECK(client_context_ == nullptr);
@@ -201,6 +345,13 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
   capture_options->set_enable_api(enable_api);
   capture_options->set_enable_introspection(enable_introspection);
   capture_options->set_enable_user_space_instrumentation(enable_user_space_instrumentation);
+  capture_options->set_ring_buffer_reader_thread_count(ring_buffer_reader_thread_count);
+  capture_options->set_event_driven_ring_buffer_polling(event_driven_ring_buffer_polling);
+  capture_options->set_compress_capture_events(compress_capture_events);
+  capture_options->set_unwind_with_precompiled_cfi(unwind_with_precompiled_cfi);
+  capture_options->set_intern_orbit_api_names(intern_orbit_api_names);
+  capture_options->set_use_shared_memory_producer_transport(use_shared_memory_producer_transport);
+  capture_options->set_use_unwinding_cache(use_unwinding_cache);
 
   auto api_functions = FindApiFunctions(module_manager);
   *(capture_options->mutable_api_functions()) = {api_functions.begin(), api_functions.end()};
@@ -223,18 +374,34 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
   }
   LOG("Sent CaptureRequest on Capture's gRPC stream: asking to start capturing");
 
-  while (!writes_done_failed_ && !try_abort_) {
-    CaptureResponse response;
-    bool read_succeeded;
-    {
-      absl::ReaderMutexLock lock{&context_and_stream_mutex_};
-      read_succeeded = reader_writer_->Read(&response);
+  {
+    std::optional<CaptureResponseDecompressionThread> decompression_thread;
+    if (compress_capture_events) {
+      decompression_thread.emplace(
+          [this, capture_event_processor](
+              const google::protobuf::RepeatedPtrField<ClientCaptureEvent>& events) {
+            ProcessEvents(capture_event_processor, events);
+          },
+          &compressed_capture_events_byte_count_, &uncompressed_capture_events_byte_count_);
     }
-    if (read_succeeded) {
-      ProcessEvents(capture_event_processor, response.capture_events());
-    } else {
-      break;
+
+    while (!writes_done_failed_ && !try_abort_) {
+      CaptureResponse response;
+      bool read_succeeded;
+      {
+        absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+        read_succeeded = reader_writer_->Read(&response);
+      }
+      if (!read_succeeded) {
+        break;
+      }
+      if (decompression_thread.has_value()) {
+        decompression_thread->AddResponse(std::move(response));
+      } else {
+        ProcessEvents(capture_event_processor, response.capture_events());
+      }
     }
+    // Destroying decompression_thread makes sure that all the received events have been processed.
   }
 
   ErrorMessageOr<void> finish_result = FinishCapture();
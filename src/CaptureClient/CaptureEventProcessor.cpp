@@ -174,7 +174,7 @@ void CaptureEventProcessorForListener::ProcessEvent(const ClientCaptureEvent& ev
       ProcessMemoryUsageEvent(event.memory_usage_event());
       break;
     case ClientCaptureEvent::kApiEvent:
-      api_event_processor_.ProcessApiEvent(event.api_event());
+      api_event_processor_.ProcessApiEvent(event.api_event(), string_intern_pool_);
       break;
     case ClientCaptureEvent::kWarningEvent:
       ProcessWarningEvent(event.warning_event());
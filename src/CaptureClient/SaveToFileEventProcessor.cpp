@@ -10,6 +10,7 @@
 #include "capture_data.pb.h"
 
 using orbit_capture_file::CaptureFileOutputStream;
+using orbit_capture_file::CaptureFileOutputStreamOptions;
 using orbit_client_protos::UserDefinedCaptureInfo;
 using orbit_grpc_protos::ClientCaptureEvent;
 
@@ -45,7 +46,10 @@ class SaveToFileEventProcessor : public CaptureEventProcessor {
 };
 
 ErrorMessageOr<void> SaveToFileEventProcessor::Initialize() {
-  auto stream_or_error = CaptureFileOutputStream::Create(file_path_);
+  // Don't let a slow disk slow down the processing of the capture events.
+  CaptureFileOutputStreamOptions options;
+  options.write_asynchronously = true;
+  auto stream_or_error = CaptureFileOutputStream::Create(file_path_, options);
   if (stream_or_error.has_error()) {
     return ErrorMessage{absl::StrFormat("Failed to initialize CaptureSaveToFileProcessor: %s",
                                         stream_or_error.error().message())};
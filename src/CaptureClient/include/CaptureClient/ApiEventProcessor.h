@@ -6,6 +6,10 @@
 #define CAPTURE_CLIENT_API_EVENT_PROCESSOR_H_
 
 #include <absl/container/flat_hash_map.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
 
 #include "Api/EncodedEvent.h"
 #include "CaptureClient/CaptureListener.h"
@@ -18,10 +22,15 @@ namespace orbit_capture_client {
 // is maintained to cache "start" events until a corresponding "stop" event is received. The pair
 // is then used to create a single TimerInfo object. "Tracking" events don't need to be cached
 // however, they are translated to TImerInfo objects that are directly passed to the listener.
+// Events whose name was interned (see ApiEvent::name_key) get their name from
+// `string_intern_pool`, and are then encoded like all other events. As the encoded name is
+// truncated to orbit_api::kMaxEventStringSize - 1 characters, the TimerInfos of these events also
+// carry the key of the name in `user_data_key`.
 class ApiEventProcessor {
  public:
   explicit ApiEventProcessor(CaptureListener* listener);
-  void ProcessApiEvent(const orbit_grpc_protos::ApiEvent& event_buffer);
+  void ProcessApiEvent(const orbit_grpc_protos::ApiEvent& event_buffer,
+                       const absl::flat_hash_map<uint64_t, std::string>& string_intern_pool);
 
  private:
   void ProcessApiEvent(const orbit_api::ApiEvent& api_event);
@@ -47,7 +47,10 @@ class CaptureClient {
       bool collect_scheduling_info, bool collect_thread_state, bool collect_gpu_jobs,
       bool enable_api, bool enable_introspection, bool enable_user_space_instrumentation,
       uint64_t max_local_marker_depth_per_command_buffer, bool collect_memory_info,
-      uint64_t memory_sampling_period_ms,
+      uint64_t memory_sampling_period_ms, uint32_t ring_buffer_reader_thread_count,
+      bool event_driven_ring_buffer_polling, bool compress_capture_events,
+      bool unwind_with_precompiled_cfi, bool intern_orbit_api_names,
+      bool use_shared_memory_producer_transport, bool use_unwinding_cache,
       std::unique_ptr<CaptureEventProcessor> capture_event_processor);
 
   // Returns true if stop was initiated and false otherwise.
@@ -70,6 +73,15 @@ class CaptureClient {
 
   bool AbortCaptureAndWait(int64_t max_wait_ms);
 
+  // The number of bytes of compressed CaptureEvents received so far in the current or last capture,
+  // and their number of bytes after decompression. Both are 0 if the capture isn't compressed.
+  [[nodiscard]] uint64_t GetCompressedCaptureEventsByteCount() const {
+    return compressed_capture_events_byte_count_;
+  }
+  [[nodiscard]] uint64_t GetUncompressedCaptureEventsByteCount() const {
+    return uncompressed_capture_events_byte_count_;
+  }
+
   [[nodiscard]] static orbit_grpc_protos::InstrumentedFunction::FunctionType
   InstrumentedFunctionTypeFromOrbitType(orbit_client_protos::FunctionInfo::OrbitType orbit_type);
 
@@ -82,7 +94,11 @@ class CaptureClient {
       bool collect_scheduling_info, bool collect_thread_state, bool collect_gpu_jobs,
       bool enable_api, bool enable_introspection, bool enable_user_space_instrumentation,
       uint64_t max_local_marker_depth_per_command_buffer, bool collect_memory_info,
-      uint64_t memory_sampling_period_ms, CaptureEventProcessor* capture_event_processor);
+      uint64_t memory_sampling_period_ms, uint32_t ring_buffer_reader_thread_count,
+      bool event_driven_ring_buffer_polling, bool compress_capture_events,
+      bool unwind_with_precompiled_cfi, bool intern_orbit_api_names,
+      bool use_shared_memory_producer_transport, bool use_unwinding_cache,
+      CaptureEventProcessor* capture_event_processor);
 
   void ProcessEvents(
       CaptureEventProcessor* capture_event_processor,
@@ -101,6 +117,8 @@ class CaptureClient {
   State state_ = State::kStopped;
   std::atomic<bool> writes_done_failed_ = false;
   std::atomic<bool> try_abort_ = false;
+  std::atomic<uint64_t> compressed_capture_events_byte_count_ = 0;
+  std::atomic<uint64_t> uncompressed_capture_events_byte_count_ = 0;
 };
 
 }  // namespace orbit_capture_client
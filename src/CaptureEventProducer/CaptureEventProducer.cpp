@@ -107,6 +107,34 @@ bool CaptureEventProducer::NotifyAllEventsSent() {
   return write_succeeded;
 }
 
+bool CaptureEventProducer::NotifySharedMemoryBufferCreated(const std::string& name,
+                                                           uint64_t size) {
+  CHECK(producer_side_service_stub_ != nullptr);
+  {
+    absl::ReaderMutexLock lock{&shutdown_requested_mutex_};
+    CHECK(!shutdown_requested_);
+  }
+
+  orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest shared_memory_buffer_created_request;
+  shared_memory_buffer_created_request.mutable_shared_memory_buffer_created()->set_name(name);
+  shared_memory_buffer_created_request.mutable_shared_memory_buffer_created()->set_size(size);
+  bool write_succeeded;
+  {
+    absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+    if (stream_ == nullptr) {
+      ERROR("Sending SharedMemoryBufferCreated to ProducerSideService: not connected");
+      return false;
+    }
+    write_succeeded = stream_->Write(shared_memory_buffer_created_request);
+  }
+  if (write_succeeded) {
+    LOG("Sent SharedMemoryBufferCreated to ProducerSideService");
+  } else {
+    ERROR("Sending SharedMemoryBufferCreated to ProducerSideService");
+  }
+  return write_succeeded;
+}
+
 void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
   CHECK(producer_side_service_stub_ != nullptr);
 
@@ -4,6 +4,7 @@
 
 #include <gmock/gmock.h>
 #include <google/protobuf/arena.h>
+#include <google/protobuf/repeated_field.h>
 #include <grpcpp/server_impl.h>
 #include <grpcpp/support/channel_arguments.h>
 #include <gtest/gtest.h>
@@ -19,6 +20,7 @@
 
 #include "CaptureEventProducer/FakeProducerSideService.h"
 #include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "capture.pb.h"
 #include "grpcpp/grpcpp.h"
 
@@ -26,6 +28,9 @@ namespace orbit_capture_event_producer {
 
 namespace {
 
+// Intermediate events equal to this string are translated to two ProducerCaptureEvents.
+constexpr const char* kTranslatedToTwoEvents = "two";
+
 class LockFreeBufferCaptureEventProducerImpl
     : public LockFreeBufferCaptureEventProducer<std::string> {
  protected:
@@ -33,6 +38,18 @@ class LockFreeBufferCaptureEventProducerImpl
       std::string&& /*intermediate_event*/, google::protobuf::Arena* arena) override {
     return google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
   }
+
+  void AddTranslatedIntermediateEvents(
+      std::string&& intermediate_event, google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* capture_events)
+      override {
+    if (intermediate_event == kTranslatedToTwoEvents) {
+      capture_events->AddAllocated(
+          google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena));
+    }
+    LockFreeBufferCaptureEventProducer::AddTranslatedIntermediateEvents(
+        std::move(intermediate_event), arena, capture_events);
+  }
 };
 
 class LockFreeBufferCaptureEventProducerTest : public ::testing::Test {
@@ -186,6 +203,78 @@ TEST_F(LockFreeBufferCaptureEventProducerTest, EnqueueIntermediateEvent) {
   buffer_producer_->EnqueueIntermediateEvent("");
 }
 
+TEST_F(LockFreeBufferCaptureEventProducerTest, IntermediateEventTranslatedToMultipleEvents) {
+  fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{});
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->IsCapturing());
+
+  int32_t capture_events_received_count = 0;
+  ON_CALL(*fake_service_, OnCaptureEventsReceived)
+      .WillByDefault([&capture_events_received_count](
+                         const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events) {
+        capture_events_received_count += events.size();
+      });
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(::testing::Between(1, 2));
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(0);
+  buffer_producer_->EnqueueIntermediateEvent("");
+  buffer_producer_->EnqueueIntermediateEvent(kTranslatedToTwoEvents);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_EQ(capture_events_received_count, 3);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  fake_service_->SendCaptureFinishedCommand();
+}
+
+TEST_F(LockFreeBufferCaptureEventProducerTest, EventsAreWrittenToSharedMemory) {
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> ring_buffer;
+  ON_CALL(*fake_service_, OnSharedMemoryBufferCreatedReceived)
+      .WillByDefault([&ring_buffer](const std::string& name, uint64_t size) {
+        auto ring_buffer_or_error =
+            orbit_producer_side_channel::SharedMemoryRingBuffer::OpenAndUnlink(name, size);
+        ASSERT_FALSE(ring_buffer_or_error.has_error());
+        ring_buffer = std::move(ring_buffer_or_error.value());
+      });
+
+  orbit_grpc_protos::CaptureOptions capture_options;
+  capture_options.set_use_shared_memory_producer_transport(true);
+  fake_service_->SendStartCaptureCommand(capture_options);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->IsCapturing());
+
+  EXPECT_CALL(*fake_service_, OnSharedMemoryBufferCreatedReceived).Times(1);
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(0);
+  buffer_producer_->EnqueueIntermediateEvent("");
+  buffer_producer_->EnqueueIntermediateEvent(kTranslatedToTwoEvents);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  fake_service_->SendCaptureFinishedCommand();
+
+  ASSERT_NE(ring_buffer, nullptr);
+  size_t record_count = 0;
+  auto record_count_or_error = ring_buffer->ConsumeRecords(
+      SIZE_MAX, [&record_count](orbit_producer_side_channel::SharedMemoryRecordType type,
+                                absl::Span<const uint8_t> payload) {
+        EXPECT_EQ(type, orbit_producer_side_channel::SharedMemoryRecordType::kProducerCaptureEvent);
+        orbit_grpc_protos::ProducerCaptureEvent event;
+        EXPECT_TRUE(event.ParseFromArray(payload.data(), static_cast<int>(payload.size())));
+        ++record_count;
+      });
+  ASSERT_FALSE(record_count_or_error.has_error());
+  EXPECT_EQ(record_count_or_error.value(), 3);
+  EXPECT_EQ(record_count, 3);
+}
+
 TEST_F(LockFreeBufferCaptureEventProducerTest, DuplicatedCommands) {
   EXPECT_FALSE(buffer_producer_->IsCapturing());
 
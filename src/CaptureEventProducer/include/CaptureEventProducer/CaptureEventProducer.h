@@ -10,6 +10,7 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
 #include <thread>
 
 #include "absl/synchronization/mutex.h"
@@ -60,6 +61,9 @@ class CaptureEventProducer {
   // Subclasses should use this method to notify the ProducerSideService that
   // they have sent all their CaptureEvents after the capture has been stopped.
   [[nodiscard]] bool NotifyAllEventsSent();
+  // Subclasses can use this method to let the ProducerSideService know that the CaptureEvents of
+  // the current capture will (also) be sent through the SharedMemoryRingBuffer called `name`.
+  [[nodiscard]] bool NotifySharedMemoryBufferCreated(const std::string& name, uint64_t size);
 
  private:
   void ConnectAndReceiveCommandsThread();
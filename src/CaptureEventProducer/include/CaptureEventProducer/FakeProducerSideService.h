@@ -40,6 +40,10 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent:
           OnAllEventsSentReceived();
           break;
+        case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryBufferCreated:
+          OnSharedMemoryBufferCreatedReceived(request.shared_memory_buffer_created().name(),
+                                              request.shared_memory_buffer_created().size());
+          break;
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::EVENT_NOT_SET:
           break;
       }
@@ -90,6 +94,8 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
   MOCK_METHOD(void, OnCaptureEventsReceived,
               (const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events), ());
   MOCK_METHOD(void, OnAllEventsSentReceived, (), ());
+  MOCK_METHOD(void, OnSharedMemoryBufferCreatedReceived, (const std::string& name, uint64_t size),
+              ());
 
  private:
   grpc::ServerContext* context_ = nullptr;
@@ -5,12 +5,22 @@
 #ifndef CAPTURE_EVENT_PRODUCER_LOCK_FREE_BUFFER_CAPTURE_EVENT_PRODUCER_H_
 #define CAPTURE_EVENT_PRODUCER_LOCK_FREE_BUFFER_CAPTURE_EVENT_PRODUCER_H_
 
+#include <absl/strings/str_format.h>
 #include <google/protobuf/arena.h>
+#include <google/protobuf/repeated_field.h>
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <type_traits>
 
 #include "CaptureEventProducer/CaptureEventProducer.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/Profiling.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "concurrentqueue.h"
 
 namespace orbit_capture_event_producer {
@@ -31,6 +41,11 @@ namespace orbit_capture_event_producer {
 // In particular, when hundreds of thousands of events are produced per second, it is recommended
 // that IntermediateEventT not be a protobuf or another type that involves heap allocations, as the
 // cost of dynamic allocations and de-allocations can add up quickly.
+//
+// When CaptureOptions::use_shared_memory_producer_transport is set, the events of a capture are
+// instead written to a SharedMemoryRingBuffer that OrbitService reads directly, and gRPC is only
+// used to announce the buffer and for AllEventsSent. Subclasses can override
+// WriteIntermediateEventToSharedMemory to write fixed-layout records and skip protobufs entirely.
 template <typename IntermediateEventT>
 class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
  public:
@@ -67,9 +82,11 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
   }
 
  protected:
-  void OnCaptureStart(orbit_grpc_protos::CaptureOptions /*capture_options*/) override {
+  void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
     absl::MutexLock lock{&status_mutex_};
     status_ = ProducerStatus::kShouldSendEvents;
+    use_shared_memory_ = capture_options.use_shared_memory_producer_transport();
+    ++capture_index_;
   }
 
   void OnCaptureStop() override {
@@ -95,7 +112,135 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
   [[nodiscard]] virtual orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
       IntermediateEventT&& intermediate_event, google::protobuf::Arena* arena) = 0;
 
+  // Adds the `CaptureEvent`s an `IntermediateEventT` translates to to `capture_events`. By default
+  // this is the single event returned by TranslateIntermediateEvent, but subclasses can override
+  // this method to also send events `intermediate_event` depends on, like InternedStrings, right
+  // before it. The same rules as for TranslateIntermediateEvent apply to the events added.
+  virtual void AddTranslatedIntermediateEvents(
+      IntermediateEventT&& intermediate_event, google::protobuf::Arena* arena,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>*
+          capture_events) {
+    capture_events->AddAllocated(TranslateIntermediateEvent(std::move(intermediate_event), arena));
+  }
+
+  // Writes the records an `IntermediateEventT` translates to to the SharedMemoryRingBuffer, using
+  // WriteCaptureEventToSharedMemory and WriteRecordToSharedMemory. By default, the events added by
+  // AddTranslatedIntermediateEvents are serialized into kProducerCaptureEvent records.
+  virtual void WriteIntermediateEventToSharedMemory(IntermediateEventT&& intermediate_event,
+                                                    google::protobuf::Arena* arena) {
+    auto* capture_events =
+        google::protobuf::Arena::CreateMessage<
+            orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::BufferedCaptureEvents>(arena)
+            ->mutable_capture_events();
+    AddTranslatedIntermediateEvents(std::move(intermediate_event), arena, capture_events);
+    for (const orbit_grpc_protos::ProducerCaptureEvent& capture_event : *capture_events) {
+      WriteCaptureEventToSharedMemory(capture_event);
+    }
+  }
+
+  // These two methods are only to be called from WriteIntermediateEventToSharedMemory. If the
+  // consumer doesn't free up space in the ring buffer in time, the record is dropped.
+  void WriteCaptureEventToSharedMemory(const orbit_grpc_protos::ProducerCaptureEvent& event) {
+    const size_t payload_size = event.ByteSizeLong();
+    uint8_t* payload = BeginSharedMemoryRecord(
+        orbit_producer_side_channel::SharedMemoryRecordType::kProducerCaptureEvent, payload_size);
+    if (payload == nullptr) return;
+    event.SerializeWithCachedSizesToArray(payload);
+    shared_memory_ring_buffer_->CommitRecord();
+  }
+
+  template <typename RecordT>
+  void WriteRecordToSharedMemory(orbit_producer_side_channel::SharedMemoryRecordType type,
+                                 const RecordT& record) {
+    static_assert(std::is_trivially_copyable_v<RecordT>);
+    uint8_t* payload = BeginSharedMemoryRecord(type, sizeof(RecordT));
+    if (payload == nullptr) return;
+    memcpy(payload, &record, sizeof(RecordT));
+    shared_memory_ring_buffer_->CommitRecord();
+  }
+
  private:
+  [[nodiscard]] uint8_t* BeginSharedMemoryRecord(
+      orbit_producer_side_channel::SharedMemoryRecordType type, size_t payload_size) {
+    CHECK(shared_memory_ring_buffer_ != nullptr);
+    if (payload_size > shared_memory_ring_buffer_->GetMaxPayloadSize()) {
+      ERROR("Record of %u bytes doesn't fit in the shared memory ring buffer", payload_size);
+      ++shared_memory_dropped_record_count_;
+      return nullptr;
+    }
+    if (shared_memory_ring_buffer_stalled_) {
+      ++shared_memory_dropped_record_count_;
+      return nullptr;
+    }
+
+    // OrbitService polls the ring buffer about every millisecond: give it plenty of time before
+    // assuming that it has stopped reading, so that a full buffer only delays the forwarder thread.
+    static constexpr std::chrono::duration kMaxWaitForSpace = std::chrono::seconds{1};
+    static constexpr std::chrono::duration kSleepOnFullRingBuffer = std::chrono::microseconds{100};
+    const auto deadline = std::chrono::steady_clock::now() + kMaxWaitForSpace;
+    while (true) {
+      uint8_t* payload =
+          shared_memory_ring_buffer_->TryBeginRecord(type, static_cast<uint32_t>(payload_size));
+      if (payload != nullptr) return payload;
+      if (shutdown_requested_ || std::chrono::steady_clock::now() > deadline) break;
+      std::this_thread::sleep_for(kSleepOnFullRingBuffer);
+    }
+    ERROR("Shared memory ring buffer is full and not being read: dropping events");
+    shared_memory_ring_buffer_stalled_ = true;
+    ++shared_memory_dropped_record_count_;
+    return nullptr;
+  }
+
+  // Creates the SharedMemoryRingBuffer the first time it's needed in a capture and announces it to
+  // ProducerSideService. If either fails, events are sent over gRPC for the rest of the capture.
+  [[nodiscard]] orbit_producer_side_channel::SharedMemoryRingBuffer*
+  GetOrCreateSharedMemoryRingBuffer(uint64_t capture_index) {
+    if (shared_memory_capture_index_ == capture_index) return shared_memory_ring_buffer_.get();
+
+    ResetSharedMemoryRingBuffer();
+    shared_memory_capture_index_ = capture_index;
+    static constexpr uint64_t kSharedMemoryRingBufferCapacity = 8 * 1024 * 1024;
+    auto ring_buffer_or_error = orbit_producer_side_channel::SharedMemoryRingBuffer::Create(
+        kSharedMemoryRingBufferCapacity);
+    if (ring_buffer_or_error.has_error()) {
+      ERROR("%s; sending events over gRPC", ring_buffer_or_error.error().message());
+      return nullptr;
+    }
+    if (!NotifySharedMemoryBufferCreated(ring_buffer_or_error.value()->GetName(),
+                                         ring_buffer_or_error.value()->GetSize())) {
+      return nullptr;
+    }
+    shared_memory_ring_buffer_ = std::move(ring_buffer_or_error.value());
+    return shared_memory_ring_buffer_.get();
+  }
+
+  // Records are only dropped when the ring buffer is full for too long or a record is too large:
+  // let the user know that the capture is incomplete.
+  void SendSharedMemoryDroppedRecordsWarning() {
+    if (shared_memory_dropped_record_count_ == 0) return;
+    orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest send_request;
+    orbit_grpc_protos::WarningEvent* warning_event = send_request.mutable_buffered_capture_events()
+                                                         ->add_capture_events()
+                                                         ->mutable_warning_event();
+    warning_event->set_timestamp_ns(orbit_base::CaptureTimestampNs());
+    warning_event->set_message(absl::StrFormat(
+        "%u events were dropped as they couldn't be written to shared memory in time",
+        shared_memory_dropped_record_count_));
+    if (!SendCaptureEvents(send_request)) {
+      ERROR("Sending WarningEvent about dropped shared memory records");
+    }
+  }
+
+  void ResetSharedMemoryRingBuffer() {
+    if (shared_memory_dropped_record_count_ > 0) {
+      ERROR("Dropped %u records that couldn't be written to the shared memory ring buffer",
+            shared_memory_dropped_record_count_);
+    }
+    shared_memory_ring_buffer_.reset();
+    shared_memory_ring_buffer_stalled_ = false;
+    shared_memory_dropped_record_count_ = 0;
+  }
+
   void ForwarderThread() {
     orbit_base::SetCurrentThreadName("ForwarderThread");
 
@@ -117,9 +262,13 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
         bool queue_was_emptied = dequeued_event_count < kMaxEventsPerRequest;
 
         ProducerStatus current_status;
+        bool use_shared_memory;
+        uint64_t capture_index;
         {
           absl::MutexLock lock{&status_mutex_};
           current_status = status_;
+          use_shared_memory = use_shared_memory_;
+          capture_index = capture_index_;
           if (status_ == ProducerStatus::kShouldNotifyAllEventsSent && queue_was_emptied) {
             // We are about to send AllEventsSent: update status_ while we hold the mutex.
             status_ = ProducerStatus::kShouldDropEvents;
@@ -130,34 +279,48 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
              current_status == ProducerStatus::kShouldNotifyAllEventsSent) &&
             dequeued_event_count > 0) {
           google::protobuf::Arena arena{arena_options};
-          auto* send_request = google::protobuf::Arena::CreateMessage<
-              orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>(&arena);
-          auto* capture_events =
-              send_request->mutable_buffered_capture_events()->mutable_capture_events();
-          capture_events->Reserve(dequeued_event_count);
-
-          for (size_t i = 0; i < dequeued_event_count; ++i) {
-            capture_events->AddAllocated(
-                TranslateIntermediateEvent(std::move(dequeued_events[i]), &arena));
-          }
-
-          if (!SendCaptureEvents(*send_request)) {
-            ERROR("Forwarding %lu CaptureEvents", dequeued_event_count);
-            break;
+          if (use_shared_memory && GetOrCreateSharedMemoryRingBuffer(capture_index) != nullptr) {
+            for (size_t i = 0; i < dequeued_event_count; ++i) {
+              WriteIntermediateEventToSharedMemory(std::move(dequeued_events[i]), &arena);
+            }
+          } else {
+            auto* send_request = google::protobuf::Arena::CreateMessage<
+                orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>(&arena);
+            auto* capture_events =
+                send_request->mutable_buffered_capture_events()->mutable_capture_events();
+            capture_events->Reserve(dequeued_event_count);
+
+            for (size_t i = 0; i < dequeued_event_count; ++i) {
+              AddTranslatedIntermediateEvents(std::move(dequeued_events[i]), &arena,
+                                              capture_events);
+            }
+
+            if (!SendCaptureEvents(*send_request)) {
+              ERROR("Forwarding %lu CaptureEvents", dequeued_event_count);
+              break;
+            }
           }
         }
 
         if (current_status == ProducerStatus::kShouldNotifyAllEventsSent && queue_was_emptied) {
           // lock_free_queue_ is now empty and status_ == kShouldNotifyAllEventsSent,
           // send AllEventsSent. status_ has already been changed to kShouldDropEvents.
+          // All records have already been committed to the ring buffer, if any, which
+          // ProducerSideService drains before handling AllEventsSent.
+          SendSharedMemoryDroppedRecordsWarning();
           if (!NotifyAllEventsSent()) {
             ERROR("Notifying that all CaptureEvents have been sent");
           }
+          ResetSharedMemoryRingBuffer();
           break;
         }
 
         // Note that if current_status == ProducerStatus::kShouldDropEvents
         // the events extracted from the lock_free_queue_ will just be dropped.
+        if (current_status == ProducerStatus::kShouldDropEvents &&
+            shared_memory_ring_buffer_ != nullptr) {
+          ResetSharedMemoryRingBuffer();
+        }
 
         if (queue_was_emptied) {
           break;
@@ -178,7 +341,17 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
 
   enum class ProducerStatus { kShouldSendEvents, kShouldNotifyAllEventsSent, kShouldDropEvents };
   ProducerStatus status_ = ProducerStatus::kShouldDropEvents;
+  bool use_shared_memory_ = false;
+  // Incremented on every OnCaptureStart, so that the forwarder thread creates a new ring buffer for
+  // each capture even if it doesn't observe the intermediate kShouldDropEvents.
+  uint64_t capture_index_ = 0;
   absl::Mutex status_mutex_;
+
+  // Only accessed by the forwarder thread.
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> shared_memory_ring_buffer_;
+  uint64_t shared_memory_capture_index_ = 0;
+  bool shared_memory_ring_buffer_stalled_ = false;
+  uint64_t shared_memory_dropped_record_count_ = 0;
 };
 
 }  // namespace orbit_capture_event_producer
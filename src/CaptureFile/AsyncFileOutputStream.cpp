@@ -0,0 +1,150 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AsyncFileOutputStream.h"
+
+#include <absl/time/clock.h>
+
+#include <limits>
+#include <tuple>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_capture_file_internal {
+
+AsyncFileOutputStream::AsyncFileOutputStream(const orbit_base::unique_fd& fd, size_t buffer_size,
+                                             size_t buffer_count)
+    : fd_{fd}, buffer_size_{buffer_size} {
+  CHECK(buffer_size > 0 && buffer_size <= std::numeric_limits<int>::max());
+  CHECK(buffer_count > 0);
+  for (size_t i = 0; i < buffer_count; ++i) {
+    buffers_.push_back(make_unique_for_overwrite<char[]>(buffer_size));
+    free_buffer_indices_.push_back(i);
+  }
+  writer_thread_ = std::thread{&AsyncFileOutputStream::WriteBuffersLoop, this};
+}
+
+AsyncFileOutputStream::~AsyncFileOutputStream() {
+  if (!Flush()) {
+    ERROR("Writing to file: %s", GetLastError().value().message());
+  }
+  {
+    absl::MutexLock lock{&mutex_};
+    stop_requested_ = true;
+  }
+  writer_thread_.join();
+}
+
+bool AsyncFileOutputStream::Next(void** data, int* size) {
+  if (current_buffer_index_.has_value() && current_buffer_used_size_ == buffer_size_) {
+    SubmitCurrentBuffer();
+  }
+
+  if (!current_buffer_index_.has_value()) {
+    absl::MutexLock lock{&mutex_};
+    if (free_buffer_indices_.empty() && !last_error_.has_value()) {
+      // Backpressure: all the buffers are waiting to be written.
+      const absl::Time wait_start = absl::Now();
+      mutex_.Await(absl::Condition(
+          +[](AsyncFileOutputStream* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+            return !self->free_buffer_indices_.empty() || self->last_error_.has_value();
+          },
+          this));
+      ++stats_.wait_count;
+      stats_.wait_duration += absl::Now() - wait_start;
+    }
+    if (last_error_.has_value()) return false;
+    current_buffer_index_ = free_buffer_indices_.front();
+    free_buffer_indices_.pop_front();
+  }
+
+  *data = buffers_[current_buffer_index_.value()].get() + current_buffer_used_size_;
+  *size = static_cast<int>(buffer_size_ - current_buffer_used_size_);
+  byte_count_ += *size;
+  current_buffer_used_size_ = buffer_size_;
+  return true;
+}
+
+void AsyncFileOutputStream::BackUp(int count) {
+  CHECK(count >= 0 && static_cast<size_t>(count) <= current_buffer_used_size_);
+  current_buffer_used_size_ -= count;
+  byte_count_ -= count;
+}
+
+void AsyncFileOutputStream::SubmitCurrentBuffer() {
+  CHECK(current_buffer_index_.has_value());
+  absl::MutexLock lock{&mutex_};
+  if (current_buffer_used_size_ == 0) {
+    free_buffer_indices_.push_back(current_buffer_index_.value());
+  } else {
+    buffers_to_write_.emplace_back(current_buffer_index_.value(), current_buffer_used_size_);
+  }
+  current_buffer_index_.reset();
+  current_buffer_used_size_ = 0;
+}
+
+bool AsyncFileOutputStream::Flush() {
+  if (current_buffer_index_.has_value()) {
+    SubmitCurrentBuffer();
+  }
+
+  absl::MutexLock lock{&mutex_};
+  mutex_.Await(absl::Condition(
+      +[](AsyncFileOutputStream* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+        return self->buffers_to_write_.empty() && !self->writing_;
+      },
+      this));
+  return !last_error_.has_value();
+}
+
+std::optional<ErrorMessage> AsyncFileOutputStream::GetLastError() const {
+  absl::MutexLock lock{&mutex_};
+  return last_error_;
+}
+
+AsyncFileOutputStream::Stats AsyncFileOutputStream::GetStats() const {
+  absl::MutexLock lock{&mutex_};
+  return stats_;
+}
+
+void AsyncFileOutputStream::WriteBuffersLoop() {
+  orbit_base::SetCurrentThreadName("CaptureFileIo");
+  while (true) {
+    size_t buffer_index = 0;
+    size_t size = 0;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](AsyncFileOutputStream* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+            return !self->buffers_to_write_.empty() || self->stop_requested_;
+          },
+          this));
+      if (buffers_to_write_.empty()) return;
+      std::tie(buffer_index, size) = buffers_to_write_.front();
+      buffers_to_write_.pop_front();
+      // After an error, the remaining buffers are discarded.
+      if (last_error_.has_value()) {
+        free_buffer_indices_.push_back(buffer_index);
+        continue;
+      }
+      writing_ = true;
+    }
+
+    ErrorMessageOr<void> result = orbit_base::WriteFully(fd_, buffers_[buffer_index].get(), size);
+
+    absl::MutexLock lock{&mutex_};
+    if (result.has_error()) {
+      last_error_ = result.error();
+    } else {
+      stats_.bytes_written += size;
+      ++stats_.buffers_written;
+    }
+    free_buffer_indices_.push_back(buffer_index);
+    writing_ = false;
+  }
+}
+
+}  // namespace orbit_capture_file_internal
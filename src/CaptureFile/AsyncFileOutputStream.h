@@ -0,0 +1,90 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_FILE_ASYNC_FILE_OUTPUT_STREAM_H_
+#define CAPTURE_FILE_ASYNC_FILE_OUTPUT_STREAM_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/time/time.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// ZeroCopyOutputStream that appends to a file from a dedicated thread. The data is written to one
+// of `buffer_count` pre-allocated buffers of `buffer_size` bytes. When the buffer is full, it is
+// handed to the I/O thread, which writes it to the file with a single write, and the next free
+// buffer is used. The caller only blocks when all the buffers are waiting to be written, which
+// happens when the disk is slower than the producer: GetStats reports how often and for how long.
+// Write errors are reported asynchronously: after an error, Next returns false and GetLastError
+// returns the error.
+class AsyncFileOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  struct Stats {
+    uint64_t bytes_written = 0;
+    uint64_t buffers_written = 0;
+    // Number of times the caller had to wait for a buffer to be written, and for how long in total.
+    uint64_t wait_count = 0;
+    absl::Duration wait_duration = absl::ZeroDuration();
+  };
+
+  explicit AsyncFileOutputStream(const orbit_base::unique_fd& fd,
+                                 size_t buffer_size = 4 * 1024 * 1024, size_t buffer_count = 2);
+  // Flushes the remaining data.
+  ~AsyncFileOutputStream() override;
+
+  AsyncFileOutputStream(const AsyncFileOutputStream&) = delete;
+  AsyncFileOutputStream& operator=(const AsyncFileOutputStream&) = delete;
+
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  [[nodiscard]] int64_t ByteCount() const override { return byte_count_; }
+
+  // Waits until all the data passed to the stream so far has been written to the file. Returns
+  // false if there was an error.
+  [[nodiscard]] bool Flush();
+
+  [[nodiscard]] std::optional<ErrorMessage> GetLastError() const;
+  [[nodiscard]] Stats GetStats() const;
+
+ private:
+  void SubmitCurrentBuffer();
+  void WriteBuffersLoop();
+
+  const orbit_base::unique_fd& fd_;
+  const size_t buffer_size_;
+  std::vector<std::unique_ptr<char[]>> buffers_;
+
+  // Only accessed by the caller's thread.
+  std::optional<size_t> current_buffer_index_;
+  size_t current_buffer_used_size_ = 0;
+  int64_t byte_count_ = 0;
+
+  mutable absl::Mutex mutex_;
+  std::deque<size_t> free_buffer_indices_ ABSL_GUARDED_BY(mutex_);
+  // Indices and sizes of the buffers to write, in order.
+  std::deque<std::pair<size_t, size_t>> buffers_to_write_ ABSL_GUARDED_BY(mutex_);
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
+  std::optional<ErrorMessage> last_error_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+
+  std::thread writer_thread_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CAPTURE_FILE_ASYNC_FILE_OUTPUT_STREAM_H_
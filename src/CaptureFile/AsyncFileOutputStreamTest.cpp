@@ -0,0 +1,70 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "AsyncFileOutputStream.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_base::HasNoError;
+
+TEST(AsyncFileOutputStream, WritesAllDataInOrder) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  std::string expected_content;
+  {
+    // Small buffers, so that the caller has to wait for the I/O thread.
+    AsyncFileOutputStream output_stream{temporary_file.fd(), /*buffer_size=*/16,
+                                        /*buffer_count=*/2};
+    google::protobuf::io::CodedOutputStream coded_output_stream{&output_stream};
+    for (int i = 0; i < 1000; ++i) {
+      std::string data = std::to_string(i) + ",";
+      coded_output_stream.WriteRaw(data.data(), data.size());
+      expected_content += data;
+    }
+    coded_output_stream.Trim();
+    EXPECT_EQ(output_stream.ByteCount(), expected_content.size());
+    ASSERT_TRUE(output_stream.Flush());
+
+    AsyncFileOutputStream::Stats stats = output_stream.GetStats();
+    EXPECT_EQ(stats.bytes_written, expected_content.size());
+    EXPECT_GE(stats.buffers_written, expected_content.size() / 16);
+  }
+
+  auto content_or_error = orbit_base::ReadFileToString(temporary_file.file_path());
+  ASSERT_THAT(content_or_error, HasNoError());
+  EXPECT_EQ(content_or_error.value(), expected_content);
+}
+
+TEST(AsyncFileOutputStream, WriteErrorIsReported) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  // Writing to a file opened for reading fails.
+  auto fd_or_error = orbit_base::OpenFileForReading(temporary_file.file_path());
+  ASSERT_THAT(fd_or_error, HasNoError());
+
+  AsyncFileOutputStream output_stream{fd_or_error.value(), /*buffer_size=*/16,
+                                      /*buffer_count=*/2};
+  void* data = nullptr;
+  int size = 0;
+  ASSERT_TRUE(output_stream.Next(&data, &size));
+  EXPECT_EQ(size, 16);
+  EXPECT_FALSE(output_stream.Flush());
+  EXPECT_TRUE(output_stream.GetLastError().has_value());
+  EXPECT_FALSE(output_stream.Next(&data, &size));
+}
+
+}  // namespace orbit_capture_file_internal
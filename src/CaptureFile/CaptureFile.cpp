@@ -5,6 +5,7 @@
 #include "CaptureFile/CaptureFile.h"
 
 #include "CaptureFileConstants.h"
+#include "MemoryMappedProtoSectionInputStreamImpl.h"
 #include "OrbitBase/File.h"
 #include "ProtoSectionInputStreamImpl.h"
 
@@ -47,6 +48,9 @@ class CaptureFileImpl : public CaptureFile {
                                        void* data, size_t size) override;
 
   std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() override;
+  std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStreamAtOffset(
+      uint64_t offset_in_section) override;
+  [[nodiscard]] ErrorMessageOr<std::vector<CaptureSectionChunk>> ReadCaptureSectionIndex() override;
 
   [[nodiscard]] const std::filesystem::path& GetFilePath() const override;
 
@@ -61,6 +65,9 @@ class CaptureFileImpl : public CaptureFile {
   ErrorMessageOr<void> WriteSectionList(const std::vector<CaptureFileSection>& section_list,
                                         uint64_t offset);
   [[nodiscard]] bool IsThereSectionWithOffsetAfterSectionList() const;
+  // Reads from a memory mapping of the fragment of the file if possible, with pread otherwise.
+  [[nodiscard]] std::unique_ptr<ProtoSectionInputStream> CreateFileFragmentProtoInputStream(
+      uint64_t offset, uint64_t size);
 
   std::filesystem::path file_path_;
   unique_fd fd_;
@@ -74,14 +81,9 @@ class CaptureFileImpl : public CaptureFile {
   uint64_t capture_section_size_ = 0;
 
   std::vector<CaptureFileSection> section_list_;
-};
 
-template <uint64_t alignment>
-constexpr uint64_t AlignUp(uint64_t value) {
-  // alignment must be a power of 2
-  static_assert((alignment & (alignment - 1)) == 0);
-  return (value + (alignment - 1)) & ~(alignment - 1);
-}
+  bool memory_mapping_error_logged_ = false;
+};
 
 ErrorMessageOr<uint64_t> GetEndOfFileOffset(const unique_fd& fd) {
   off_t end_of_file = lseek(fd.get(), 0, SEEK_END);
@@ -278,9 +280,75 @@ ErrorMessageOr<void> CaptureFileImpl::ReadFromSection(uint64_t section_number,
   return outcome::success();
 }
 
+std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateFileFragmentProtoInputStream(
+    uint64_t offset, uint64_t size) {
+  // An empty section can't be mapped, and there is nothing to gain from mapping it anyway.
+  if (size == 0) {
+    return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(fd_, offset,
+                                                                                     size);
+  }
+
+  auto memory_mapped_input_stream_or_error =
+      orbit_capture_file_internal::MemoryMappedProtoSectionInputStreamImpl::Create(fd_, offset,
+                                                                                  size);
+  if (memory_mapped_input_stream_or_error.has_value()) {
+    return std::move(memory_mapped_input_stream_or_error.value());
+  }
+
+  if (!memory_mapping_error_logged_) {
+    LOG("Reading \"%s\" without memory mapping: %s", file_path_.string(),
+        memory_mapped_input_stream_or_error.error().message());
+    memory_mapping_error_logged_ = true;
+  }
+  return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(fd_, offset,
+                                                                                   size);
+}
+
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureSectionInputStream() {
-  return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
-      fd_, header_.capture_section_offset, capture_section_size_);
+  return CreateFileFragmentProtoInputStream(header_.capture_section_offset,
+                                            capture_section_size_);
+}
+
+std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureSectionInputStreamAtOffset(
+    uint64_t offset_in_section) {
+  CHECK(offset_in_section < capture_section_size_);
+  return CreateFileFragmentProtoInputStream(header_.capture_section_offset + offset_in_section,
+                                            capture_section_size_ - offset_in_section);
+}
+
+ErrorMessageOr<std::vector<CaptureSectionChunk>> CaptureFileImpl::ReadCaptureSectionIndex() {
+  std::optional<uint64_t> section_number = FindSectionByType(kSectionTypeCaptureSectionIndex);
+  if (!section_number.has_value()) {
+    return std::vector<CaptureSectionChunk>{};
+  }
+
+  const CaptureFileSection& section = section_list_[section_number.value()];
+  uint64_t number_of_chunks = 0;
+  if (section.size < sizeof(number_of_chunks)) {
+    return ErrorMessage{absl::StrFormat("Invalid capture section index size: %d", section.size)};
+  }
+  OUTCOME_TRY(
+      ReadFromSection(section_number.value(), 0, &number_of_chunks, sizeof(number_of_chunks)));
+  if (number_of_chunks != (section.size - sizeof(number_of_chunks)) / sizeof(CaptureSectionChunk) ||
+      (section.size - sizeof(number_of_chunks)) % sizeof(CaptureSectionChunk) != 0) {
+    return ErrorMessage{absl::StrFormat(
+        "Capture section index size doesn't match its number of chunks: size=%d, chunks=%d",
+        section.size, number_of_chunks)};
+  }
+
+  std::vector<CaptureSectionChunk> chunks(number_of_chunks);
+  OUTCOME_TRY(ReadFromSection(section_number.value(), sizeof(number_of_chunks), chunks.data(),
+                              number_of_chunks * sizeof(CaptureSectionChunk)));
+
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (chunks[i].offset >= capture_section_size_ ||
+        (i > 0 && chunks[i].offset <= chunks[i - 1].offset)) {
+      return ErrorMessage{
+          absl::StrFormat("Invalid offset of capture section chunk %d: %#x", i, chunks[i].offset)};
+    }
+  }
+
+  return chunks;
 }
 
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateProtoSectionInputStream(
@@ -288,8 +356,7 @@ std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateProtoSectionInpu
   CHECK(section_number < section_list_.size());
   const auto& section_info = section_list_[section_number];
 
-  return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
-      fd_, section_info.offset, section_info.size);
+  return CreateFileFragmentProtoInputStream(section_info.offset, section_info.size);
 }
 
 std::optional<uint64_t> CaptureFileImpl::FindSectionByType(uint64_t section_type) const {
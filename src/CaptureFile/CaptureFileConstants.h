@@ -18,4 +18,11 @@ static_assert(kFileSignature.size() == 4);
 
 constexpr uint32_t kFileVersion = 1;
 
+template <uint64_t alignment>
+constexpr uint64_t AlignUp(uint64_t value) {
+  // alignment must be a power of 2
+  static_assert((alignment & (alignment - 1)) == 0);
+  return (value + (alignment - 1)) & ~(alignment - 1);
+}
+
 #endif  // CAPTURE_FILE_CONSTANTS_H_
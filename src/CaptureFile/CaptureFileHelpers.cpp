@@ -6,10 +6,107 @@
 
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "CaptureFile/CaptureFile.h"
+#include "OrbitBase/Future.h"
 
 namespace orbit_capture_file {
 
+namespace {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+// Decoded chunks hold all their events in memory: this bounds the memory used while reading.
+constexpr size_t kMaxChunksInFlight = 16;
+
+// Events of a chunk of the capture section, decoded on a thread of the thread pool.
+struct DecodedChunk {
+  std::vector<ClientCaptureEvent> events;
+  ErrorMessageOr<void> result = outcome::success();
+  orbit_base::Future<void> decoded;
+};
+
+// Schedules the decoding of the chunks of the capture section, in order, while keeping at most
+// `max_chunks_in_flight` of them scheduled or decoded and not yet consumed.
+class CaptureSectionChunkDecoder {
+ public:
+  explicit CaptureSectionChunkDecoder(CaptureFile* capture_file, ThreadPool* thread_pool,
+                                      std::vector<CaptureSectionChunk> chunks,
+                                      size_t max_chunks_in_flight)
+      : capture_file_{capture_file},
+        thread_pool_{thread_pool},
+        chunks_{std::move(chunks)},
+        max_chunks_in_flight_{max_chunks_in_flight} {}
+
+  CaptureSectionChunkDecoder(const CaptureSectionChunkDecoder&) = delete;
+  CaptureSectionChunkDecoder& operator=(const CaptureSectionChunkDecoder&) = delete;
+
+  ~CaptureSectionChunkDecoder() {
+    // The chunks still being decoded read from the file and write to their DecodedChunk.
+    for (const std::unique_ptr<DecodedChunk>& chunk : chunks_in_flight_) {
+      chunk->decoded.Wait();
+    }
+  }
+
+  // Waits for the next chunk to be decoded and returns it. Returns nullptr after the last chunk.
+  [[nodiscard]] std::unique_ptr<DecodedChunk> GetNextDecodedChunk() {
+    ScheduleChunks();
+    if (chunks_in_flight_.empty()) return nullptr;
+
+    std::unique_ptr<DecodedChunk> chunk = std::move(chunks_in_flight_.front());
+    chunks_in_flight_.pop_front();
+    // Keep the thread pool busy while this chunk is being consumed.
+    ScheduleChunks();
+    chunk->decoded.Wait();
+    return chunk;
+  }
+
+ private:
+  void ScheduleChunks() {
+    while (next_chunk_index_ < chunks_.size() && chunks_in_flight_.size() < max_chunks_in_flight_) {
+      const CaptureSectionChunk& chunk = chunks_[next_chunk_index_++];
+      auto decoded_chunk = std::make_unique<DecodedChunk>();
+      decoded_chunk->decoded = thread_pool_->Schedule(
+          [decoded_chunk = decoded_chunk.get(),
+           input_stream = capture_file_->CreateCaptureSectionInputStreamAtOffset(chunk.offset),
+           event_count = chunk.event_count]() {
+            decoded_chunk->events.resize(event_count);
+            for (ClientCaptureEvent& event : decoded_chunk->events) {
+              decoded_chunk->result = input_stream->ReadMessage(&event);
+              if (decoded_chunk->result.has_error()) return;
+            }
+          });
+      chunks_in_flight_.push_back(std::move(decoded_chunk));
+    }
+  }
+
+  CaptureFile* capture_file_;
+  ThreadPool* thread_pool_;
+  std::vector<CaptureSectionChunk> chunks_;
+  size_t max_chunks_in_flight_;
+  size_t next_chunk_index_ = 0;
+  std::deque<std::unique_ptr<DecodedChunk>> chunks_in_flight_;
+};
+
+ErrorMessageOr<void> ReadCaptureSectionSequentially(
+    CaptureFile* capture_file, const std::function<bool(const ClientCaptureEvent&)>& consumer) {
+  auto input_stream = capture_file->CreateCaptureSectionInputStream();
+  while (true) {
+    ClientCaptureEvent event;
+    OUTCOME_TRY(input_stream->ReadMessage(&event));
+    if (!consumer(event) || event.event_case() == ClientCaptureEvent::kCaptureFinished) {
+      return outcome::success();
+    }
+  }
+}
+
+}  // namespace
+
 ErrorMessageOr<void> WriteUserData(
     const std::filesystem::path& capture_file_path,
     const orbit_client_protos::UserDefinedCaptureInfo& user_defined_capture_info) {
@@ -39,4 +136,31 @@ ErrorMessageOr<void> WriteUserData(
   return outcome::success();
 }
 
-}  // namespace orbit_capture_file
\ No newline at end of file
+ErrorMessageOr<void> ReadCaptureSection(
+    CaptureFile* capture_file, ThreadPool* thread_pool,
+    const std::function<bool(const ClientCaptureEvent&)>& consumer) {
+  OUTCOME_TRY(capture_section_index, capture_file->ReadCaptureSectionIndex());
+  if (capture_section_index.empty()) {
+    return ReadCaptureSectionSequentially(capture_file, consumer);
+  }
+
+  // Decode enough chunks ahead for all the threads to be busy while the consumer, which is usually
+  // the bottleneck, processes the current chunk.
+  const size_t max_chunks_in_flight =
+      std::clamp<size_t>(2 * thread_pool->GetPoolSize(), 2, kMaxChunksInFlight);
+  CaptureSectionChunkDecoder decoder{capture_file, thread_pool, std::move(capture_section_index),
+                                     max_chunks_in_flight};
+  while (std::unique_ptr<DecodedChunk> chunk = decoder.GetNextDecodedChunk()) {
+    OUTCOME_TRY(chunk->result);
+    for (const ClientCaptureEvent& event : chunk->events) {
+      if (!consumer(event) || event.event_case() == ClientCaptureEvent::kCaptureFinished) {
+        return outcome::success();
+      }
+    }
+  }
+
+  // Like the sequential reader, which fails when reading past the end of the section.
+  return ErrorMessage{"Unexpected end of section while reading message size"};
+}
+
+}  // namespace orbit_capture_file
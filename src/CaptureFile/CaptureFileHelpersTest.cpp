@@ -3,19 +3,28 @@
 // found in the LICENSE file.
 
 #include <absl/base/casts.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileHelpers.h"
 #include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFileConstants.h"
+#include "OrbitBase/Logging.h"
 #include "OrbitBase/TemporaryFile.h"
 #include "OrbitBase/TestUtils.h"
+#include "OrbitBase/ThreadPool.h"
 
 namespace orbit_capture_file {
 
+using orbit_base::HasError;
 using orbit_base::HasNoError;
 
 static constexpr const char* kAnswerString =
@@ -105,4 +114,172 @@ TEST(CaptureFileHelpers, CreateCaptureFileAndWriteUserData) {
   }
 }
 
-}  // namespace orbit_capture_file
\ No newline at end of file
+static ClientCaptureEvent CreateCallstackSampleCaptureEvent(uint64_t timestamp_ns) {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::CallstackSample* callstack_sample = event.mutable_callstack_sample();
+  callstack_sample->set_pid(1234);
+  callstack_sample->set_tid(1234 + timestamp_ns % 16);
+  callstack_sample->set_timestamp_ns(timestamp_ns);
+  callstack_sample->set_callstack_id(1 + timestamp_ns % 97);
+  return event;
+}
+
+// Writes `event_count` CallstackSamples with timestamps 0 to `event_count - 1`, followed by a
+// CaptureFinished event.
+static void WriteCaptureWithCallstackSamples(const std::filesystem::path& file_path,
+                                             uint64_t event_count,
+                                             CaptureFileOutputStreamOptions options = {}) {
+  auto output_stream_or_error = CaptureFileOutputStream::Create(file_path, options);
+  ASSERT_THAT(output_stream_or_error, HasNoError());
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+  for (uint64_t i = 0; i < event_count; ++i) {
+    ASSERT_THAT(output_stream->WriteCaptureEvent(CreateCallstackSampleCaptureEvent(i)),
+                HasNoError());
+  }
+  ClientCaptureEvent capture_finished;
+  capture_finished.mutable_capture_finished()->set_status(
+      orbit_grpc_protos::CaptureFinished::kSuccessful);
+  ASSERT_THAT(output_stream->WriteCaptureEvent(capture_finished), HasNoError());
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+}
+
+TEST(CaptureFileHelpers, ReadCaptureSectionInParallel) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  const std::filesystem::path& file_path = temporary_file.file_path();
+  temporary_file.CloseAndRemove();
+
+  constexpr uint64_t kEventCount = 10'000;
+  CaptureFileOutputStreamOptions options;
+  options.capture_section_index_chunk_size = 1024;
+  WriteCaptureWithCallstackSamples(file_path, kEventCount, options);
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+  auto index_or_error = capture_file->ReadCaptureSectionIndex();
+  ASSERT_THAT(index_or_error, HasNoError());
+  EXPECT_GT(index_or_error.value().size(), 10);
+
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+  uint64_t next_timestamp_ns = 0;
+  bool capture_finished = false;
+  auto result = ReadCaptureSection(
+      capture_file.get(), thread_pool.get(), [&](const ClientCaptureEvent& event) {
+        if (event.event_case() == ClientCaptureEvent::kCaptureFinished) {
+          capture_finished = true;
+          return true;
+        }
+        EXPECT_EQ(event.event_case(), ClientCaptureEvent::kCallstackSample);
+        EXPECT_EQ(event.callstack_sample().timestamp_ns(), next_timestamp_ns);
+        ++next_timestamp_ns;
+        return true;
+      });
+  EXPECT_THAT(result, HasNoError());
+  EXPECT_EQ(next_timestamp_ns, kEventCount);
+  EXPECT_TRUE(capture_finished);
+
+  // The consumer can stop the reading at any time.
+  uint64_t consumed_event_count = 0;
+  result = ReadCaptureSection(capture_file.get(), thread_pool.get(),
+                              [&consumed_event_count](const ClientCaptureEvent& /*event*/) {
+                                ++consumed_event_count;
+                                return consumed_event_count < kEventCount / 2;
+                              });
+  EXPECT_THAT(result, HasNoError());
+  EXPECT_EQ(consumed_event_count, kEventCount / 2);
+
+  thread_pool->ShutdownAndWait();
+}
+
+TEST(CaptureFileHelpers, ReadCaptureSectionInParallelFailsWithoutCaptureFinished) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  const std::filesystem::path& file_path = temporary_file.file_path();
+  temporary_file.CloseAndRemove();
+
+  constexpr uint64_t kEventCount = 10'000;
+  CaptureFileOutputStreamOptions options;
+  options.capture_section_index_chunk_size = 1024;
+  {
+    auto output_stream_or_error = CaptureFileOutputStream::Create(file_path, options);
+    ASSERT_THAT(output_stream_or_error, HasNoError());
+    std::unique_ptr<CaptureFileOutputStream> output_stream =
+        std::move(output_stream_or_error.value());
+    for (uint64_t i = 0; i < kEventCount; ++i) {
+      ASSERT_THAT(output_stream->WriteCaptureEvent(CreateCallstackSampleCaptureEvent(i)),
+                  HasNoError());
+    }
+    ASSERT_THAT(output_stream->Close(), HasNoError());
+  }
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+
+  std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+  uint64_t consumed_event_count = 0;
+  auto result = ReadCaptureSection(capture_file.get(), thread_pool.get(),
+                                   [&consumed_event_count](const ClientCaptureEvent& /*event*/) {
+                                     ++consumed_event_count;
+                                     return true;
+                                   });
+  EXPECT_THAT(result, HasError("Unexpected end of section"));
+  EXPECT_EQ(consumed_event_count, kEventCount);
+
+  thread_pool->ShutdownAndWait();
+}
+
+// Compares reading a large capture sequentially with reading it with ReadCaptureSection and one
+// thread per core. It writes a ~50 MB temporary file and mostly reports timings, so it is disabled
+// by default: use --gtest_also_run_disabled_tests to run it.
+TEST(CaptureFileHelpers, DISABLED_ReadCaptureSectionBenchmark) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  const std::filesystem::path& file_path = temporary_file.file_path();
+  temporary_file.CloseAndRemove();
+
+  // About 50 MB, to keep the test short. Multiply by 100 for the size of the largest captures.
+  constexpr uint64_t kEventCount = 2'500'000;
+  WriteCaptureWithCallstackSamples(file_path, kEventCount);
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+
+  uint64_t checksum = 0;
+  const absl::Time sequential_start = absl::Now();
+  auto input_stream = capture_file->CreateCaptureSectionInputStream();
+  while (true) {
+    ClientCaptureEvent event;
+    ASSERT_THAT(input_stream->ReadMessage(&event), HasNoError());
+    if (event.event_case() == ClientCaptureEvent::kCaptureFinished) break;
+    checksum += event.callstack_sample().timestamp_ns();
+  }
+  const absl::Duration sequential_duration = absl::Now() - sequential_start;
+
+  const size_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::Create(thread_count, thread_count, absl::Seconds(1));
+  uint64_t parallel_checksum = 0;
+  const absl::Time parallel_start = absl::Now();
+  ASSERT_THAT(ReadCaptureSection(capture_file.get(), thread_pool.get(),
+                                 [&parallel_checksum](const ClientCaptureEvent& event) {
+                                   parallel_checksum += event.callstack_sample().timestamp_ns();
+                                   return true;
+                                 }),
+              HasNoError());
+  const absl::Duration parallel_duration = absl::Now() - parallel_start;
+  thread_pool->ShutdownAndWait();
+
+  EXPECT_EQ(parallel_checksum, checksum);
+  LOG("Read %u events: sequentially in %.0f ms, on %u threads in %.0f ms", kEventCount,
+      absl::ToDoubleMilliseconds(sequential_duration), thread_count,
+      absl::ToDoubleMilliseconds(parallel_duration));
+}
+
+}  // namespace orbit_capture_file
@@ -8,9 +8,16 @@
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "AsyncFileOutputStream.h"
+#include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFileConstants.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
@@ -20,9 +27,88 @@ namespace orbit_capture_file {
 
 namespace {
 
+using orbit_grpc_protos::ClientCaptureEvent;
+
+// signature - 4bytes, version - 4bytes, capture section offset - 8 bytes
+constexpr uint64_t kSectionListOffsetFieldOffset =
+    kFileSignature.size() + sizeof(kFileVersion) + sizeof(uint64_t);
+constexpr uint64_t kCaptureSectionOffset = kSectionListOffsetFieldOffset + sizeof(uint64_t);
+
+// Returns the first and last timestamp of the event, or std::nullopt for events that are not
+// associated with a point in time (interned strings and callstacks, address infos...).
+std::optional<std::pair<uint64_t, uint64_t>> GetEventTimeRange(const ClientCaptureEvent& event) {
+  auto instant = [](uint64_t timestamp_ns) { return std::make_pair(timestamp_ns, timestamp_ns); };
+  auto slice = [](uint64_t end_timestamp_ns, uint64_t duration_ns) {
+    return std::make_pair(end_timestamp_ns - duration_ns, end_timestamp_ns);
+  };
+
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kApiEvent:
+      return instant(event.api_event().timestamp_ns());
+    case ClientCaptureEvent::kCallstackSample:
+      return instant(event.callstack_sample().timestamp_ns());
+    case ClientCaptureEvent::kCaptureStarted:
+      return instant(event.capture_started().capture_start_timestamp_ns());
+    case ClientCaptureEvent::kClockResolutionEvent:
+      return instant(event.clock_resolution_event().timestamp_ns());
+    case ClientCaptureEvent::kErrorEnablingOrbitApiEvent:
+      return instant(event.error_enabling_orbit_api_event().timestamp_ns());
+    case ClientCaptureEvent::kErrorsWithPerfEventOpenEvent:
+      return instant(event.errors_with_perf_event_open_event().timestamp_ns());
+    case ClientCaptureEvent::kFunctionCall:
+      return slice(event.function_call().end_timestamp_ns(), event.function_call().duration_ns());
+    case ClientCaptureEvent::kGpuJob:
+      return std::make_pair(event.gpu_job().amdgpu_cs_ioctl_time_ns(),
+                            event.gpu_job().dma_fence_signaled_time_ns());
+    case ClientCaptureEvent::kGpuQueueSubmission:
+      return std::make_pair(
+          event.gpu_queue_submission().meta_info().pre_submission_cpu_timestamp(),
+          event.gpu_queue_submission().meta_info().post_submission_cpu_timestamp());
+    case ClientCaptureEvent::kIntrospectionScope:
+      return slice(event.introspection_scope().end_timestamp_ns(),
+                   event.introspection_scope().duration_ns());
+    case ClientCaptureEvent::kLostPerfRecordsEvent:
+      return slice(event.lost_perf_records_event().end_timestamp_ns(),
+                   event.lost_perf_records_event().duration_ns());
+    case ClientCaptureEvent::kMemoryUsageEvent:
+      return instant(event.memory_usage_event().timestamp_ns());
+    case ClientCaptureEvent::kModulesSnapshot:
+      return instant(event.modules_snapshot().timestamp_ns());
+    case ClientCaptureEvent::kModuleUpdateEvent:
+      return instant(event.module_update_event().timestamp_ns());
+    case ClientCaptureEvent::kOutOfOrderEventsDiscardedEvent:
+      return slice(event.out_of_order_events_discarded_event().end_timestamp_ns(),
+                   event.out_of_order_events_discarded_event().duration_ns());
+    case ClientCaptureEvent::kSchedulingSlice:
+      return slice(event.scheduling_slice().out_timestamp_ns(),
+                   event.scheduling_slice().duration_ns());
+    case ClientCaptureEvent::kThreadName:
+      return instant(event.thread_name().timestamp_ns());
+    case ClientCaptureEvent::kThreadNamesSnapshot:
+      return instant(event.thread_names_snapshot().timestamp_ns());
+    case ClientCaptureEvent::kThreadStateSlice:
+      return slice(event.thread_state_slice().end_timestamp_ns(),
+                   event.thread_state_slice().duration_ns());
+    case ClientCaptureEvent::kTracepointEvent:
+      return instant(event.tracepoint_event().timestamp_ns());
+    case ClientCaptureEvent::kWarningEvent:
+      return instant(event.warning_event().timestamp_ns());
+    case ClientCaptureEvent::kAddressInfo:
+    case ClientCaptureEvent::kCaptureFinished:
+    case ClientCaptureEvent::kInternedCallstack:
+    case ClientCaptureEvent::kInternedString:
+    case ClientCaptureEvent::kInternedTracepointInfo:
+    case ClientCaptureEvent::EVENT_NOT_SET:
+      return std::nullopt;
+  }
+  UNREACHABLE();
+}
+
 class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  public:
-  explicit CaptureFileOutputStreamImpl(std::filesystem::path path) : path_{std::move(path)} {}
+  explicit CaptureFileOutputStreamImpl(std::filesystem::path path,
+                                       CaptureFileOutputStreamOptions options)
+      : path_{std::move(path)}, options_{options} {}
   ~CaptureFileOutputStreamImpl() noexcept override;
 
   [[nodiscard]] ErrorMessageOr<void> Initialize();
@@ -34,16 +120,32 @@ class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  private:
   void Reset() noexcept;
   [[nodiscard]] ErrorMessageOr<void> WriteHeader();
+  void UpdateCaptureSectionIndex(const ClientCaptureEvent& event, uint64_t event_size);
+  void WritePaddingForAlignment();
+  // Writes the CAPTURE_SECTION_INDEX section and the section list after the capture section.
+  // Returns the offset of the section list.
+  [[nodiscard]] uint64_t WriteCaptureSectionIndexAndSectionList();
   // Handles write error by cleaning up the file and generating error message.
   [[nodiscard]] ErrorMessage HandleWriteError(const char* section_name,
                                               std::string_view original_error);
   // Call this in case of unrecoverable error to close and remove the file.
   void CloseAndTryRemoveFileAfterError();
+  // Waits for all the data to be written to the file.
+  [[nodiscard]] bool FlushOutputStream();
+  [[nodiscard]] std::string GetOutputStreamError() const;
 
   std::filesystem::path path_;
+  CaptureFileOutputStreamOptions options_;
   orbit_base::unique_fd fd_;
 
+  // Number of bytes written to the file so far. CodedOutputStream::ByteCount is an int, which is
+  // not enough for large captures.
+  uint64_t bytes_written_ = 0;
+  std::vector<CaptureSectionChunk> capture_section_index_;
+
+  // Only one of them is used, depending on options_.write_asynchronously.
   std::optional<google::protobuf::io::FileOutputStream> file_output_stream_;
+  std::optional<orbit_capture_file_internal::AsyncFileOutputStream> async_file_output_stream_;
   std::optional<google::protobuf::io::CodedOutputStream> coded_output_;
 };
 
@@ -69,9 +171,30 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Initialize() {
 }
 
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::Close() noexcept {
+  uint64_t section_list_offset = WriteCaptureSectionIndexAndSectionList();
   coded_output_->Trim();
   if (coded_output_->HadError()) {
-    return HandleWriteError("Unknown", SafeStrerror(file_output_stream_->GetErrno()));
+    return HandleWriteError("Unknown", GetOutputStreamError());
+  }
+
+  // The header is updated directly through the file descriptor, so the buffered data has to be
+  // flushed first.
+  coded_output_.reset();
+  if (!FlushOutputStream()) {
+    return HandleWriteError("Section List", GetOutputStreamError());
+  }
+  if (async_file_output_stream_.has_value()) {
+    orbit_capture_file_internal::AsyncFileOutputStream::Stats stats =
+        async_file_output_stream_->GetStats();
+    LOG("Wrote %u bytes to \"%s\" in %u buffers, waited %u times for %.3f ms for buffers to be "
+        "written",
+        stats.bytes_written, path_.string(), stats.buffers_written, stats.wait_count,
+        absl::ToDoubleMilliseconds(stats.wait_duration));
+  }
+  auto write_result = orbit_base::WriteFullyAtOffset(
+      fd_, &section_list_offset, sizeof(section_list_offset), kSectionListOffsetFieldOffset);
+  if (write_result.has_error()) {
+    return HandleWriteError("Header", write_result.error().message());
   }
   Reset();
 
@@ -81,6 +204,7 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Close() noexcept {
 void CaptureFileOutputStreamImpl::Reset() noexcept {
   coded_output_.reset();
   file_output_stream_.reset();
+  async_file_output_stream_.reset();
   fd_.release();
 }
 
@@ -93,6 +217,21 @@ void CaptureFileOutputStreamImpl::CloseAndTryRemoveFileAfterError() {
   }
 }
 
+bool CaptureFileOutputStreamImpl::FlushOutputStream() {
+  if (async_file_output_stream_.has_value()) {
+    return async_file_output_stream_->Flush();
+  }
+  return file_output_stream_->Flush();
+}
+
+std::string CaptureFileOutputStreamImpl::GetOutputStreamError() const {
+  if (async_file_output_stream_.has_value()) {
+    std::optional<ErrorMessage> error = async_file_output_stream_->GetLastError();
+    return error.has_value() ? error->message() : "Unknown error";
+  }
+  return SafeStrerror(file_output_stream_->GetErrno());
+}
+
 ErrorMessage CaptureFileOutputStreamImpl::HandleWriteError(const char* section_name,
                                                            std::string_view original_error) {
   CloseAndTryRemoveFileAfterError();
@@ -103,20 +242,80 @@ ErrorMessage CaptureFileOutputStreamImpl::HandleWriteError(const char* section_n
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteCaptureEvent(
     const orbit_grpc_protos::ClientCaptureEvent& event) {
   CHECK(coded_output_.has_value());
-  CHECK(file_output_stream_.has_value());
   size_t message_size = event.ByteSizeLong();
+  UpdateCaptureSectionIndex(event,
+                            google::protobuf::io::CodedOutputStream::VarintSize32(message_size) +
+                                message_size);
   coded_output_->WriteVarint32(message_size);
   if (!event.SerializeToCodedStream(&coded_output_.value())) {
-    return HandleWriteError("Capture", SafeStrerror(file_output_stream_->GetErrno()));
+    return HandleWriteError("Capture", GetOutputStreamError());
   }
 
   if (coded_output_->HadError()) {
-    return HandleWriteError("Capture", SafeStrerror(file_output_stream_->GetErrno()));
+    return HandleWriteError("Capture", GetOutputStreamError());
   }
 
   return outcome::success();
 }
 
+void CaptureFileOutputStreamImpl::UpdateCaptureSectionIndex(const ClientCaptureEvent& event,
+                                                            uint64_t event_size) {
+  const uint64_t offset_in_capture_section = bytes_written_ - kCaptureSectionOffset;
+  if (capture_section_index_.empty() ||
+      offset_in_capture_section - capture_section_index_.back().offset >=
+          options_.capture_section_index_chunk_size) {
+    capture_section_index_.push_back(CaptureSectionChunk{
+        /*.offset = */ offset_in_capture_section,
+        /*.min_timestamp_ns = */ std::numeric_limits<uint64_t>::max(),
+        /*.max_timestamp_ns = */ 0,
+        /*.event_count = */ 0});
+  }
+
+  CaptureSectionChunk& chunk = capture_section_index_.back();
+  ++chunk.event_count;
+  std::optional<std::pair<uint64_t, uint64_t>> time_range = GetEventTimeRange(event);
+  if (time_range.has_value()) {
+    chunk.min_timestamp_ns = std::min(chunk.min_timestamp_ns, time_range->first);
+    chunk.max_timestamp_ns = std::max(chunk.max_timestamp_ns, time_range->second);
+  }
+  bytes_written_ += event_size;
+}
+
+void CaptureFileOutputStreamImpl::WritePaddingForAlignment() {
+  static constexpr std::array<char, 8> kPadding{};
+  const uint64_t aligned_offset = AlignUp<8>(bytes_written_);
+  coded_output_->WriteRaw(kPadding.data(), aligned_offset - bytes_written_);
+  bytes_written_ = aligned_offset;
+}
+
+uint64_t CaptureFileOutputStreamImpl::WriteCaptureSectionIndexAndSectionList() {
+  CHECK(coded_output_.has_value());
+
+  // Both the index and the section list go right after the capture section. This way the USER_DATA
+  // section can later be added after the section list, at the end of the file.
+  WritePaddingForAlignment();
+  const uint64_t index_offset = bytes_written_;
+  const uint64_t number_of_chunks = capture_section_index_.size();
+  const uint64_t index_size =
+      sizeof(number_of_chunks) + number_of_chunks * sizeof(CaptureSectionChunk);
+  coded_output_->WriteRaw(&number_of_chunks, sizeof(number_of_chunks));
+  coded_output_->WriteRaw(capture_section_index_.data(),
+                          number_of_chunks * sizeof(CaptureSectionChunk));
+  bytes_written_ += index_size;
+
+  WritePaddingForAlignment();
+  const uint64_t section_list_offset = bytes_written_;
+  const uint64_t number_of_sections = 1;
+  const CaptureFileSection index_section{/*.type = */ kSectionTypeCaptureSectionIndex,
+                                         /*.offset = */ index_offset,
+                                         /*.size = */ index_size};
+  coded_output_->WriteRaw(&number_of_sections, sizeof(number_of_sections));
+  coded_output_->WriteRaw(&index_section, sizeof(index_section));
+  bytes_written_ += sizeof(number_of_sections) + sizeof(index_section);
+
+  return section_list_offset;
+}
+
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
   CHECK(fd_.valid());
 
@@ -125,12 +324,11 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
   // signature - 4bytes, version - 4bytes
   // capture section offset - 8 bytes
   // additional section offset - 8 bytes
-  uint64_t capture_section_offset =
-      kFileSignature.size() + sizeof(kFileVersion) + 2 * sizeof(uint64_t);
+  uint64_t capture_section_offset = kCaptureSectionOffset;
   header.append(std::string_view(absl::bit_cast<char*>(&capture_section_offset),
                                  sizeof(capture_section_offset)));
-  uint64_t additional_section_list_offset =
-      0;  // For the streaming format we have no additional sections
+  // The section list is only written on Close, after the capture section.
+  uint64_t additional_section_list_offset = 0;
   header.append(std::string_view(absl::bit_cast<char*>(&additional_section_list_offset),
                                  sizeof(additional_section_list_offset)));
 
@@ -140,10 +338,16 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
   if (write_result.has_error()) {
     return HandleWriteError("Header", write_result.error().message());
   }
+  bytes_written_ = header.size();
 
   // Prepare the protobuf stream to use to write to capture section.
-  file_output_stream_.emplace(fd_.get());
-  coded_output_.emplace(&file_output_stream_.value());
+  if (options_.write_asynchronously) {
+    async_file_output_stream_.emplace(fd_);
+    coded_output_.emplace(&async_file_output_stream_.value());
+  } else {
+    file_output_stream_.emplace(fd_.get());
+    coded_output_.emplace(&file_output_stream_.value());
+  }
 
   return outcome::success();
 }
@@ -151,8 +355,8 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
 }  // namespace
 
 ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> CaptureFileOutputStream::Create(
-    std::filesystem::path path) {
-  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(std::move(path));
+    std::filesystem::path path, CaptureFileOutputStreamOptions options) {
+  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(std::move(path), options);
   auto init_result = implementation->Initialize();
   if (init_result.has_error()) {
     return init_result.error();
@@ -6,10 +6,12 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFileConstants.h"
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
 
 namespace orbit_capture_file {
 
@@ -120,4 +122,44 @@ TEST(CaptureFileOutputStream, WriteAfterClose) {
   EXPECT_DEATH((void)output_stream->WriteCaptureEvent(event), "");
 }
 
-}  // namespace orbit_capture_file
\ No newline at end of file
+TEST(CaptureFileOutputStream, WriteAsynchronously) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  std::string temp_file_name = temporary_file.file_path().string();
+  temporary_file.CloseAndRemove();
+
+  CaptureFileOutputStreamOptions options;
+  options.write_asynchronously = true;
+  auto output_stream_or_error = CaptureFileOutputStream::Create(temp_file_name, options);
+  ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  // Enough events to fill several buffers.
+  constexpr uint64_t kEventCount = 200'000;
+  for (uint64_t key = 0; key < kEventCount; ++key) {
+    ASSERT_THAT(
+        output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(key, kAnswerString)),
+        orbit_base::HasNoError());
+  }
+  ASSERT_THAT(output_stream->Close(), orbit_base::HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(temp_file_name);
+  ASSERT_THAT(capture_file_or_error, orbit_base::HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+  auto index_or_error = capture_file->ReadCaptureSectionIndex();
+  ASSERT_THAT(index_or_error, orbit_base::HasNoError());
+  EXPECT_GT(index_or_error.value().size(), 1);
+
+  auto input_stream = capture_file->CreateCaptureSectionInputStream();
+  for (uint64_t key = 0; key < kEventCount; ++key) {
+    orbit_grpc_protos::ClientCaptureEvent event;
+    ASSERT_THAT(input_stream->ReadMessage(&event), orbit_base::HasNoError());
+    ASSERT_EQ(event.event_case(), orbit_grpc_protos::ClientCaptureEvent::kInternedString);
+    ASSERT_EQ(event.interned_string().key(), key);
+  }
+}
+
+}  // namespace orbit_capture_file
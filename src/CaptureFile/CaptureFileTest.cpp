@@ -8,6 +8,11 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
 #include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFileConstants.h"
@@ -122,8 +127,9 @@ TEST(CaptureFile, CreateCaptureFileWriteAdditionalSectionAndReadMainSection) {
 
   auto section_number_or_error = capture_file->AddUserDataSection(333);
   ASSERT_TRUE(section_number_or_error.has_value()) << section_number_or_error.error().message();
-  ASSERT_EQ(capture_file->GetSectionList().size(), 1);
-  EXPECT_EQ(section_number_or_error.value(), 0);
+  // The CAPTURE_SECTION_INDEX section is the first one.
+  ASSERT_EQ(capture_file->GetSectionList().size(), 2);
+  EXPECT_EQ(section_number_or_error.value(), 1);
   capture_file.reset();
 
   capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
@@ -180,7 +186,8 @@ TEST(CaptureFile, CreateCaptureFileAndAddSection) {
   auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
   ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
   std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
-  EXPECT_EQ(capture_file->GetSectionList().size(), 0);
+  ASSERT_EQ(capture_file->GetSectionList().size(), 1);
+  EXPECT_EQ(capture_file->GetSectionList()[0].type, kSectionTypeCaptureSectionIndex);
 
   uint64_t buf_size;
   {
@@ -197,22 +204,22 @@ TEST(CaptureFile, CreateCaptureFileAndAddSection) {
     ASSERT_TRUE(event.SerializeToCodedStream(&coded_output_stream));
     auto section_number_or_error = capture_file->AddUserDataSection(buf_size);
     ASSERT_THAT(section_number_or_error, HasValue());
-    ASSERT_EQ(capture_file->GetSectionList().size(), 1);
-    EXPECT_EQ(section_number_or_error.value(), 0);
+    ASSERT_EQ(capture_file->GetSectionList().size(), 2);
+    EXPECT_EQ(section_number_or_error.value(), 1);
 
-    EXPECT_EQ(capture_file->FindSectionByType(kSectionTypeUserData), 0);
+    EXPECT_EQ(capture_file->FindSectionByType(kSectionTypeUserData), 1);
     // Write something to the section
     std::string something{"something"};
     constexpr uint64_t kOffsetInSection = 5;
     auto write_to_section_result =
-        capture_file->WriteToSection(0, kOffsetInSection, something.c_str(), something.size());
+        capture_file->WriteToSection(1, kOffsetInSection, something.c_str(), something.size());
     ASSERT_THAT(write_to_section_result, HasNoError());
 
     {
       std::string content;
       content.resize(something.size());
       auto read_result =
-          capture_file->ReadFromSection(0, kOffsetInSection, content.data(), something.size());
+          capture_file->ReadFromSection(1, kOffsetInSection, content.data(), something.size());
       ASSERT_THAT(read_result, HasNoError());
       EXPECT_EQ(content, something);
     }
@@ -223,7 +230,7 @@ TEST(CaptureFile, CreateCaptureFileAndAddSection) {
   }
 
   {
-    const auto& capture_file_section = capture_file->GetSectionList()[0];
+    const auto& capture_file_section = capture_file->GetSectionList()[1];
     EXPECT_EQ(capture_file_section.size, buf_size);
     EXPECT_GT(capture_file_section.offset, 0);
     EXPECT_EQ(capture_file_section.type, kSectionTypeUserData);
@@ -235,18 +242,18 @@ TEST(CaptureFile, CreateCaptureFileAndAddSection) {
   capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
   ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
   capture_file = std::move(capture_file_or_error.value());
-  EXPECT_EQ(capture_file->GetSectionList().size(), 1);
+  EXPECT_EQ(capture_file->GetSectionList().size(), 2);
   {
-    const auto& capture_file_section = capture_file->GetSectionList()[0];
+    const auto& capture_file_section = capture_file->GetSectionList()[1];
     EXPECT_EQ(capture_file_section.type, kSectionTypeUserData);
     EXPECT_GT(capture_file_section.offset, 0);
     EXPECT_EQ(capture_file_section.size, buf_size);
   }
 
-  ASSERT_EQ(capture_file->FindSectionByType(kSectionTypeUserData), 0);
+  ASSERT_EQ(capture_file->FindSectionByType(kSectionTypeUserData), 1);
 
   {
-    auto section_input_stream = capture_file->CreateProtoSectionInputStream(0);
+    auto section_input_stream = capture_file->CreateProtoSectionInputStream(1);
     ASSERT_NE(section_input_stream.get(), nullptr);
     ClientCaptureEvent event_from_file;
     ASSERT_THAT(section_input_stream->ReadMessage(&event_from_file), HasNoError());
@@ -256,6 +263,88 @@ TEST(CaptureFile, CreateCaptureFileAndAddSection) {
   }
 }
 
+static ClientCaptureEvent CreateSchedulingSliceCaptureEvent(uint64_t out_timestamp_ns,
+                                                             uint64_t duration_ns) {
+  ClientCaptureEvent event;
+  orbit_grpc_protos::SchedulingSlice* scheduling_slice = event.mutable_scheduling_slice();
+  scheduling_slice->set_out_timestamp_ns(out_timestamp_ns);
+  scheduling_slice->set_duration_ns(duration_ns);
+  return event;
+}
+
+TEST(CaptureFile, CaptureSectionIndex) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  std::string temp_file_name = temporary_file.file_path().string();
+  temporary_file.CloseAndRemove();
+
+  // Use small chunks so that the index has several entries.
+  CaptureFileOutputStreamOptions options;
+  options.capture_section_index_chunk_size = 100;
+  auto output_stream_or_error = CaptureFileOutputStream::Create(temp_file_name, options);
+  ASSERT_TRUE(output_stream_or_error.has_value()) << output_stream_or_error.error().message();
+  std::unique_ptr<CaptureFileOutputStream> output_stream =
+      std::move(output_stream_or_error.value());
+
+  constexpr uint64_t kEventCount = 100;
+  constexpr uint64_t kDurationNs = 5;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    // Events without timestamp don't affect the time ranges of the chunks.
+    const ClientCaptureEvent event =
+        i % 10 == 0 ? CreateInternedStringCaptureEvent(i, kAnswerString)
+                    : CreateSchedulingSliceCaptureEvent(1000 + 10 * i, kDurationNs);
+    ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+  }
+  ASSERT_THAT(output_stream->Close(), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+
+  auto index_or_error = capture_file->ReadCaptureSectionIndex();
+  ASSERT_THAT(index_or_error, HasNoError());
+  const std::vector<CaptureSectionChunk>& index = index_or_error.value();
+  ASSERT_GT(index.size(), 1);
+  EXPECT_EQ(index[0].offset, 0);
+
+  uint64_t first_event_of_chunk = 0;
+  for (const CaptureSectionChunk& chunk : index) {
+    ASSERT_GT(chunk.event_count, 0);
+    auto input_stream = capture_file->CreateCaptureSectionInputStreamAtOffset(chunk.offset);
+
+    uint64_t min_timestamp_ns = std::numeric_limits<uint64_t>::max();
+    uint64_t max_timestamp_ns = 0;
+    for (uint64_t i = first_event_of_chunk; i < first_event_of_chunk + chunk.event_count; ++i) {
+      ClientCaptureEvent event;
+      ASSERT_THAT(input_stream->ReadMessage(&event), HasNoError());
+      if (i % 10 == 0) {
+        ASSERT_EQ(event.event_case(), ClientCaptureEvent::kInternedString);
+        EXPECT_EQ(event.interned_string().key(), i);
+        continue;
+      }
+      ASSERT_EQ(event.event_case(), ClientCaptureEvent::kSchedulingSlice);
+      EXPECT_EQ(event.scheduling_slice().out_timestamp_ns(), 1000 + 10 * i);
+      min_timestamp_ns = std::min(min_timestamp_ns, 1000 + 10 * i - kDurationNs);
+      max_timestamp_ns = std::max(max_timestamp_ns, 1000 + 10 * i);
+    }
+    EXPECT_EQ(chunk.min_timestamp_ns, min_timestamp_ns);
+    EXPECT_EQ(chunk.max_timestamp_ns, max_timestamp_ns);
+    first_event_of_chunk += chunk.event_count;
+  }
+  EXPECT_EQ(first_event_of_chunk, kEventCount);
+
+  // Adding the USER_DATA section keeps the index.
+  ASSERT_THAT(capture_file->AddUserDataSection(10), HasValue());
+  capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  capture_file = std::move(capture_file_or_error.value());
+  auto index_after_user_data_or_error = capture_file->ReadCaptureSectionIndex();
+  ASSERT_THAT(index_after_user_data_or_error, HasNoError());
+  EXPECT_EQ(index_after_user_data_or_error.value().size(), index.size());
+}
+
 TEST(CaptureFile, OpenCaptureFileInvalidSignature) {
   auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
   ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
@@ -306,6 +395,37 @@ TEST(CaptureFile, OpenCaptureFileInvalidVersion) {
   EXPECT_THAT(capture_file_or_error, HasError("Incompatible version 0, expected 1"));
 }
 
+TEST(CaptureFile, OpenCaptureFileWithoutCaptureSectionIndex) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  // This is how files were written before the CAPTURE_SECTION_INDEX section was introduced.
+  std::string file_content = CreateHeader(1, 24, 0);
+  ClientCaptureEvent event = CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString);
+  google::protobuf::io::StringOutputStream string_output_stream(&file_content);
+  {
+    google::protobuf::io::CodedOutputStream coded_output_stream(&string_output_stream);
+    coded_output_stream.WriteVarint32(event.ByteSizeLong());
+    ASSERT_TRUE(event.SerializeToCodedStream(&coded_output_stream));
+  }
+  ASSERT_THAT(orbit_base::WriteFully(temporary_file.fd(), file_content), HasNoError());
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(temporary_file.file_path());
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+
+  auto index_or_error = capture_file->ReadCaptureSectionIndex();
+  ASSERT_THAT(index_or_error, HasNoError());
+  EXPECT_TRUE(index_or_error.value().empty());
+
+  auto capture_section = capture_file->CreateCaptureSectionInputStream();
+  ClientCaptureEvent event_from_file;
+  ASSERT_THAT(capture_section->ReadMessage(&event_from_file), HasNoError());
+  ASSERT_EQ(event_from_file.event_case(), ClientCaptureEvent::kInternedString);
+  EXPECT_EQ(event_from_file.interned_string().key(), kAnswerKey);
+}
+
 TEST(CaptureFile, OpenCaptureFileInvalidSectionListSize) {
   auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
   ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
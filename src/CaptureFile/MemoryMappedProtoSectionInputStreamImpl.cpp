@@ -0,0 +1,153 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MemoryMappedProtoSectionInputStreamImpl.h"
+
+#include <absl/strings/str_format.h>
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+#include "ProtoSectionInputStreamImpl.h"
+
+#if defined(__linux)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace orbit_capture_file_internal {
+
+namespace {
+
+// Size of the window that the kernel is asked to read ahead of the current position.
+constexpr uint64_t kReadAheadSize = 8 * 1024 * 1024;
+constexpr int kMaxVarint32Size = 5;
+
+}  // namespace
+
+MemoryMappedProtoSectionInputStreamImpl::~MemoryMappedProtoSectionInputStreamImpl() {
+#if defined(__linux)
+  if (munmap(mapping_address_, mapping_size_) != 0) {
+    ERROR("munmap: %s", SafeStrerror(errno));
+  }
+#endif
+}
+
+ErrorMessageOr<std::unique_ptr<MemoryMappedProtoSectionInputStreamImpl>>
+MemoryMappedProtoSectionInputStreamImpl::Create(const orbit_base::unique_fd& fd,
+                                                uint64_t section_offset, uint64_t section_size) {
+#if defined(__linux)
+  // Accessing a mapping beyond the end of the file results in SIGBUS.
+  struct stat file_stat {};
+  if (fstat(fd.get(), &file_stat) != 0) {
+    return ErrorMessage{absl::StrFormat("Unable to stat capture file: %s", SafeStrerror(errno))};
+  }
+  if (section_offset + section_size > static_cast<uint64_t>(file_stat.st_size)) {
+    return ErrorMessage{"The section is not entirely contained in the file"};
+  }
+
+  // The offset of a mapping has to be a multiple of the page size.
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  const uint64_t mapping_offset = section_offset & ~(kPageSize - 1);
+  const size_t mapping_size = section_size + (section_offset - mapping_offset);
+  void* mapping_address =
+      mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd.get(), mapping_offset);
+  if (mapping_address == MAP_FAILED) {
+    return ErrorMessage{absl::StrFormat("Unable to map capture file: %s", SafeStrerror(errno))};
+  }
+  // This also lets the kernel free the pages soon after they have been read.
+  if (madvise(mapping_address, mapping_size, MADV_SEQUENTIAL) != 0) {
+    ERROR("madvise(MADV_SEQUENTIAL): %s", SafeStrerror(errno));
+  }
+
+  const uint8_t* section_data =
+      static_cast<const uint8_t*>(mapping_address) + (section_offset - mapping_offset);
+  return std::unique_ptr<MemoryMappedProtoSectionInputStreamImpl>{
+      new MemoryMappedProtoSectionInputStreamImpl{fd, section_offset, mapping_address, mapping_size,
+                                                  section_data, section_size}};
+#else
+  (void)fd;
+  (void)section_offset;
+  (void)section_size;
+  return ErrorMessage{"Memory mapping of capture files is not supported on this platform"};
+#endif
+}
+
+ErrorMessageOr<void> MemoryMappedProtoSectionInputStreamImpl::ValidateFileSizeUpTo(
+    uint64_t section_position) {
+  if (section_position <= validated_position_) return outcome::success();
+
+#if defined(__linux)
+  struct stat file_stat {};
+  if (fstat(fd_.get(), &file_stat) != 0) {
+    return ErrorMessage{absl::StrFormat("Unable to stat capture file: %s", SafeStrerror(errno))};
+  }
+  const uint64_t file_size = file_stat.st_size;
+  if (section_offset_ + section_position > file_size) {
+    return ErrorMessage{"The capture file was truncated while it was being read"};
+  }
+  // Validate a whole read-ahead window at once, so that fstat is only called once per window.
+  validated_position_ =
+      std::min({section_position + kReadAheadSize, section_size_, file_size - section_offset_});
+#endif
+  return outcome::success();
+}
+
+void MemoryMappedProtoSectionInputStreamImpl::ReadAheadIfNeeded() {
+#if defined(__linux)
+  if (read_ahead_position_ >= section_size_ ||
+      current_position_ + kReadAheadSize / 2 < read_ahead_position_) {
+    return;
+  }
+
+  const uint64_t read_ahead_end = std::min(read_ahead_position_ + kReadAheadSize, section_size_);
+  // madvise requires a page-aligned address, and the mapping starts at a page boundary.
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  const auto* read_ahead_start = reinterpret_cast<const uint8_t*>(
+      reinterpret_cast<uintptr_t>(section_data_ + read_ahead_position_) & ~(kPageSize - 1));
+  const size_t read_ahead_size = section_data_ + read_ahead_end - read_ahead_start;
+  if (madvise(const_cast<uint8_t*>(read_ahead_start), read_ahead_size, MADV_WILLNEED) != 0) {
+    ERROR("madvise(MADV_WILLNEED): %s", SafeStrerror(errno));
+  }
+  read_ahead_position_ = read_ahead_end;
+#endif
+}
+
+ErrorMessageOr<void> MemoryMappedProtoSectionInputStreamImpl::ReadMessage(
+    google::protobuf::Message* message) {
+  ReadAheadIfNeeded();
+
+  // Constructed on the mapped data, CodedInputStream doesn't copy anything.
+  const uint64_t bytes_left = section_size_ - current_position_;
+  OUTCOME_TRY(ValidateFileSizeUpTo(current_position_ +
+                                   std::min<uint64_t>(bytes_left, kMaxVarint32Size)));
+  google::protobuf::io::CodedInputStream size_input_stream{
+      section_data_ + current_position_,
+      static_cast<int>(std::min<uint64_t>(bytes_left, kMaxVarint32Size))};
+  uint32_t message_size = 0;
+  if (!size_input_stream.ReadVarint32(&message_size)) {
+    return ErrorMessage{"Unexpected end of section while reading message size"};
+  }
+
+  if (message_size > kMaximumMessageSize) {
+    return ErrorMessage{
+        absl::StrFormat("The message size %d is too big (maximum allowed message size is %d)",
+                        message_size, kMaximumMessageSize)};
+  }
+
+  const uint64_t message_position = current_position_ + size_input_stream.CurrentPosition();
+  if (message_size > section_size_ - message_position) {
+    return ErrorMessage{"Unexpected end of section while reading the message"};
+  }
+  OUTCOME_TRY(ValidateFileSizeUpTo(message_position + message_size));
+
+  message->ParseFromArray(section_data_ + message_position, message_size);
+  current_position_ = message_position + message_size;
+  return outcome::success();
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,69 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MEMORY_MAPPED_PROTO_SECTION_INPUT_STREAM_IMPL_H_
+#define MEMORY_MAPPED_PROTO_SECTION_INPUT_STREAM_IMPL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// Reads proto messages from a section of capture file by parsing them directly from a read-only
+// memory mapping of the section. Unlike ProtoSectionInputStreamImpl, this doesn't copy the data
+// from the page cache to intermediate buffers. The section is expected to be read sequentially:
+// the kernel is asked to read ahead and to drop the pages that were already read.
+// Accessing the mapping beyond the end of the file raises SIGBUS, so the size of the file is
+// checked again before each read-ahead window is accessed. Truncating the file while it is being
+// read can still crash between two such checks, but results in an error otherwise.
+class MemoryMappedProtoSectionInputStreamImpl : public orbit_capture_file::ProtoSectionInputStream {
+ public:
+  ~MemoryMappedProtoSectionInputStreamImpl() override;
+
+  MemoryMappedProtoSectionInputStreamImpl(const MemoryMappedProtoSectionInputStreamImpl&) = delete;
+  MemoryMappedProtoSectionInputStreamImpl& operator=(
+      const MemoryMappedProtoSectionInputStreamImpl&) = delete;
+
+  ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) override;
+
+  // Returns an error if the file can't be mapped, for example if this is not supported on the
+  // platform. Callers are expected to fall back to ProtoSectionInputStreamImpl in that case.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<MemoryMappedProtoSectionInputStreamImpl>>
+  Create(const orbit_base::unique_fd& fd, uint64_t section_offset, uint64_t section_size);
+
+ private:
+  MemoryMappedProtoSectionInputStreamImpl(const orbit_base::unique_fd& fd, uint64_t section_offset,
+                                          void* mapping_address, size_t mapping_size,
+                                          const uint8_t* section_data, uint64_t section_size)
+      : fd_{fd},
+        section_offset_{section_offset},
+        mapping_address_{mapping_address},
+        mapping_size_{mapping_size},
+        section_data_{section_data},
+        section_size_{section_size} {}
+
+  [[nodiscard]] ErrorMessageOr<void> ValidateFileSizeUpTo(uint64_t section_position);
+  void ReadAheadIfNeeded();
+
+  const orbit_base::unique_fd& fd_;
+  uint64_t section_offset_;
+  void* mapping_address_;
+  size_t mapping_size_;
+  const uint8_t* section_data_;
+  uint64_t section_size_;
+  uint64_t current_position_ = 0;
+  uint64_t read_ahead_position_ = 0;
+  // The part of the section before this position was last known to be contained in the file.
+  uint64_t validated_position_ = 0;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // MEMORY_MAPPED_PROTO_SECTION_INPUT_STREAM_IMPL_H_
@@ -0,0 +1,182 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "MemoryMappedProtoSectionInputStreamImpl.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/TemporaryFile.h"
+#include "OrbitBase/TestUtils.h"
+#include "ProtoSectionInputStreamImpl.h"
+#include "capture.pb.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+using orbit_capture_file::ProtoSectionInputStream;
+using orbit_grpc_protos::ClientCaptureEvent;
+
+namespace {
+
+void AppendMessage(const google::protobuf::Message& message, std::string* output) {
+  google::protobuf::io::StringOutputStream string_output_stream{output};
+  google::protobuf::io::CodedOutputStream coded_output_stream{&string_output_stream};
+  coded_output_stream.WriteVarint32(message.ByteSizeLong());
+  CHECK(message.SerializeToCodedStream(&coded_output_stream));
+}
+
+ClientCaptureEvent CreateInternedStringCaptureEvent(uint64_t key, const std::string& str) {
+  ClientCaptureEvent event;
+  event.mutable_interned_string()->set_key(key);
+  event.mutable_interned_string()->set_intern(str);
+  return event;
+}
+
+}  // namespace
+
+TEST(MemoryMappedProtoSectionInputStreamImpl, ReadMessagesUntilEndOfSection) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  // The section doesn't start at a page boundary, and is followed by data of another section.
+  std::string file_content = "not part of the section";
+  const uint64_t section_offset = file_content.size();
+  constexpr uint64_t kMessageCount = 100;
+  for (uint64_t i = 0; i < kMessageCount; ++i) {
+    AppendMessage(CreateInternedStringCaptureEvent(i, std::to_string(i)), &file_content);
+  }
+  const uint64_t section_size = file_content.size() - section_offset;
+  file_content.append("not part of the section either");
+  ASSERT_THAT(orbit_base::WriteFully(temporary_file.fd(), file_content), HasNoError());
+
+  auto input_stream_or_error = MemoryMappedProtoSectionInputStreamImpl::Create(
+      temporary_file.fd(), section_offset, section_size);
+  ASSERT_THAT(input_stream_or_error, HasNoError());
+  std::unique_ptr<MemoryMappedProtoSectionInputStreamImpl> input_stream =
+      std::move(input_stream_or_error.value());
+
+  for (uint64_t i = 0; i < kMessageCount; ++i) {
+    ClientCaptureEvent event;
+    ASSERT_THAT(input_stream->ReadMessage(&event), HasNoError());
+    ASSERT_EQ(event.event_case(), ClientCaptureEvent::kInternedString);
+    EXPECT_EQ(event.interned_string().key(), i);
+    EXPECT_EQ(event.interned_string().intern(), std::to_string(i));
+  }
+
+  ClientCaptureEvent event;
+  EXPECT_THAT(input_stream->ReadMessage(&event), HasError("Unexpected end of section"));
+}
+
+TEST(MemoryMappedProtoSectionInputStreamImpl, ReadMessageFailsOnTruncatedFile) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  std::string file_content;
+  AppendMessage(CreateInternedStringCaptureEvent(1, "one"), &file_content);
+  ASSERT_THAT(orbit_base::WriteFully(temporary_file.fd(), file_content), HasNoError());
+
+  auto input_stream_or_error =
+      MemoryMappedProtoSectionInputStreamImpl::Create(temporary_file.fd(), 0, file_content.size());
+  ASSERT_THAT(input_stream_or_error, HasNoError());
+  std::unique_ptr<MemoryMappedProtoSectionInputStreamImpl> input_stream =
+      std::move(input_stream_or_error.value());
+
+  // Reading the mapping beyond the new end of the file would raise SIGBUS.
+  ASSERT_EQ(ftruncate(temporary_file.fd().get(), 0), 0);
+  ClientCaptureEvent event;
+  EXPECT_THAT(input_stream->ReadMessage(&event), HasError("truncated"));
+}
+
+TEST(MemoryMappedProtoSectionInputStreamImpl, MessageTruncatedBySectionEnd) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  std::string file_content;
+  AppendMessage(CreateInternedStringCaptureEvent(42, "forty-two"), &file_content);
+  ASSERT_THAT(orbit_base::WriteFully(temporary_file.fd(), file_content), HasNoError());
+
+  auto input_stream_or_error = MemoryMappedProtoSectionInputStreamImpl::Create(
+      temporary_file.fd(), 0, file_content.size() - 1);
+  ASSERT_THAT(input_stream_or_error, HasNoError());
+
+  ClientCaptureEvent event;
+  EXPECT_THAT(input_stream_or_error.value()->ReadMessage(&event),
+              HasError("Unexpected end of section while reading the message"));
+}
+
+TEST(MemoryMappedProtoSectionInputStreamImpl, SectionPastEndOfFile) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  ASSERT_THAT(orbit_base::WriteFully(temporary_file.fd(), "0123456789"), HasNoError());
+
+  EXPECT_THAT(MemoryMappedProtoSectionInputStreamImpl::Create(temporary_file.fd(), 5, 10),
+              HasError("not entirely contained in the file"));
+}
+
+// Times reading all the messages of a large section with ProtoSectionInputStreamImpl (pread to a
+// buffer) and with MemoryMappedProtoSectionInputStreamImpl. As it writes a file of about 110 MB
+// just to log two durations, it has to be requested with --gtest_also_run_disabled_tests.
+TEST(MemoryMappedProtoSectionInputStreamImpl, DISABLED_ComparisonWithPreadBenchmark) {
+  auto temporary_file_or_error = orbit_base::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_base::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  // About 128 MB, to keep the test short. Multiply by 16 for a 2 GB capture.
+  constexpr uint64_t kMessageCount = 1'000'000;
+  const std::string intern(100, 'x');
+  uint64_t section_size = 0;
+  std::string buffer;
+  for (uint64_t i = 0; i < kMessageCount; ++i) {
+    // StringOutputStream grows the string to its capacity: don't use it on the large buffer.
+    std::string message;
+    AppendMessage(CreateInternedStringCaptureEvent(i, intern), &message);
+    buffer.append(message);
+    if (buffer.size() > 1024 * 1024 || i == kMessageCount - 1) {
+      ASSERT_THAT(orbit_base::WriteFully(temporary_file.fd(), buffer), HasNoError());
+      section_size += buffer.size();
+      buffer.clear();
+    }
+  }
+
+  auto read_all_messages = [](ProtoSectionInputStream* input_stream) {
+    const absl::Time start = absl::Now();
+    ClientCaptureEvent event;
+    for (uint64_t i = 0; i < kMessageCount; ++i) {
+      CHECK(!input_stream->ReadMessage(&event).has_error());
+    }
+    return absl::Now() - start;
+  };
+
+  auto fd_or_error = orbit_base::OpenFileForReading(temporary_file.file_path());
+  ASSERT_THAT(fd_or_error, HasNoError());
+  ProtoSectionInputStreamImpl pread_input_stream{fd_or_error.value(), 0, section_size};
+  const absl::Duration pread_duration = read_all_messages(&pread_input_stream);
+
+  auto memory_mapped_input_stream_or_error =
+      MemoryMappedProtoSectionInputStreamImpl::Create(temporary_file.fd(), 0, section_size);
+  ASSERT_THAT(memory_mapped_input_stream_or_error, HasNoError());
+  const absl::Duration memory_mapped_duration =
+      read_all_messages(memory_mapped_input_stream_or_error.value().get());
+
+  LOG("Read %u bytes: %.0f ms with pread, %.0f ms with memory mapping", section_size,
+      absl::ToDoubleMilliseconds(pread_duration),
+      absl::ToDoubleMilliseconds(memory_mapped_duration));
+}
+
+}  // namespace orbit_capture_file_internal
@@ -9,8 +9,6 @@
 
 namespace orbit_capture_file_internal {
 
-constexpr uint64_t kMaximumMessageSize = 1024 * 1024;  // 1Mb
-
 ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::Message* message) {
   uint32_t message_size = 0;
 
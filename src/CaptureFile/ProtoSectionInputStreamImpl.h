@@ -11,6 +11,9 @@
 
 namespace orbit_capture_file_internal {
 
+// Messages in capture file sections are limited to this size.
+constexpr uint64_t kMaximumMessageSize = 1024 * 1024;  // 1Mb
+
 // This class is used to read proto messages from a section of capture file.
 class ProtoSectionInputStreamImpl : public orbit_capture_file::ProtoSectionInputStream {
  public:
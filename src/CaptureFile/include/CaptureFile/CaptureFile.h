@@ -65,6 +65,17 @@ class CaptureFile {
 
   virtual std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() = 0;
 
+  // Same as CreateCaptureSectionInputStream but starts reading at `offset_in_section`, which needs
+  // to be the offset of a message, such as the offset of a CaptureSectionChunk.
+  virtual std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStreamAtOffset(
+      uint64_t offset_in_section) = 0;
+
+  // Returns the content of the CAPTURE_SECTION_INDEX section, ordered by offset. Returns an empty
+  // vector if the file doesn't have this section, in which case the capture section can only be
+  // read sequentially from the start.
+  [[nodiscard]] virtual ErrorMessageOr<std::vector<CaptureSectionChunk>>
+  ReadCaptureSectionIndex() = 0;
+
   static ErrorMessageOr<std::unique_ptr<CaptureFile>> OpenForReadWrite(
       const std::filesystem::path& file_path);
 };
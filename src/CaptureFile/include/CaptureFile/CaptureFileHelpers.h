@@ -6,13 +6,28 @@
 #define CAPTURE_FILE_CAPTURE_FILE_HELPERS_H_
 
 #include <filesystem>
+#include <functional>
 
+#include "CaptureFile/CaptureFile.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
+#include "capture.pb.h"
 #include "user_defined_capture_info.pb.h"
 
 namespace orbit_capture_file {
 ErrorMessageOr<void> WriteUserData(
     const std::filesystem::path& capture_file_path,
     const orbit_client_protos::UserDefinedCaptureInfo& user_defined_capture_info);
+
+// Reads the events of the capture section of `capture_file` and passes them to `consumer`, in
+// order and on the calling thread. Reading stops after the CaptureFinished event, or as soon as
+// `consumer` returns false. Reaching the end of the section without seeing CaptureFinished is an
+// error.
+// The chunks listed in the CAPTURE_SECTION_INDEX section are decoded in parallel on
+// `thread_pool`, a few chunks ahead of the consumer. Files without this section are read
+// sequentially on the calling thread.
+[[nodiscard]] ErrorMessageOr<void> ReadCaptureSection(
+    CaptureFile* capture_file, ThreadPool* thread_pool,
+    const std::function<bool(const orbit_grpc_protos::ClientCaptureEvent&)>& consumer);
 }  // namespace orbit_capture_file
 #endif  // CAPTURE_FILE_CAPTURE_FILE_HELPERS_H_
\ No newline at end of file
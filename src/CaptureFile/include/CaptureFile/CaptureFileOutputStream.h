@@ -6,6 +6,7 @@
 #define CAPTURE_FILE_CAPTURE_FILE_OUTPUT_STREAM_H_
 
 #include <google/protobuf/message.h>
+#include <stdint.h>
 
 #include <filesystem>
 #include <memory>
@@ -15,6 +16,16 @@
 
 namespace orbit_capture_file {
 
+struct CaptureFileOutputStreamOptions {
+  // Approximate size of the chunks of the capture section listed in the CAPTURE_SECTION_INDEX.
+  uint64_t capture_section_index_chunk_size = 4 * 1024 * 1024;
+  // If true, WriteCaptureEvent only serializes the event to a memory buffer. Full buffers are
+  // written to the file by a separate thread, so that a slow disk doesn't block the caller unless
+  // all the buffers are waiting to be written. Write errors can then be reported by a later call
+  // to WriteCaptureEvent or by Close.
+  bool write_asynchronously = false;
+};
+
 // This class in used for creating new capture file from
 // a stream of ClientCaptureEvents. If the file already exists
 // it is going to be overwritten. Appending to the existing file
@@ -39,6 +50,11 @@ namespace orbit_capture_file {
 //
 // output_stream->Close();
 //
+// While writing, the stream keeps track of the byte offset, time range and number of events of
+// consecutive chunks of the capture section. On Close, this index is written to a
+// CAPTURE_SECTION_INDEX section (see FORMAT.md), which allows readers to seek to a time range or
+// to get a summary of the capture without parsing all of it.
+//
 // Note: the stream will be closed on destruction if it was not explicitly closed before that.
 // Note: Write after close or error will result in CHECK failure.
 class CaptureFileOutputStream {
@@ -53,7 +69,7 @@ class CaptureFileOutputStream {
   // Create new capture file output stream. If the file exists it is going to be
   // overwritten.
   [[nodiscard]] static ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> Create(
-      std::filesystem::path path);
+      std::filesystem::path path, CaptureFileOutputStreamOptions options = {});
 };
 
 }  // namespace orbit_capture_file
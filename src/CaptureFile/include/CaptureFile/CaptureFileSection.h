@@ -10,6 +10,7 @@
 namespace orbit_capture_file {
 
 constexpr uint64_t kSectionTypeUserData = 1;
+constexpr uint64_t kSectionTypeCaptureSectionIndex = 2;
 
 struct CaptureFileSection {
   uint64_t type;
@@ -17,5 +18,17 @@ struct CaptureFileSection {
   uint64_t size;
 };
 
+// Entry of the CAPTURE_SECTION_INDEX section: describes a chunk of consecutive messages of the
+// capture section.
+struct CaptureSectionChunk {
+  // Offset of the first message of the chunk from the start of the capture section.
+  uint64_t offset;
+  // Time range of the events of the chunk that have a timestamp. If none of them has one,
+  // min_timestamp_ns is std::numeric_limits<uint64_t>::max() and max_timestamp_ns is 0.
+  uint64_t min_timestamp_ns;
+  uint64_t max_timestamp_ns;
+  uint64_t event_count;
+};
+
 }  // namespace orbit_capture_file
 #endif  // CAPTURE_FILE_CAPTURE_FILE_SECTION_H_
@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/AddressToFunctionIndex.h"
+
+#include <map>
+
+#include "ClientData/ModuleData.h"
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::FunctionInfo;
+
+namespace orbit_client_data {
+
+AddressToFunctionIndex::AddressToFunctionIndex(const ProcessData& process,
+                                               const ModuleManager& module_manager) {
+  const std::map<uint64_t, ModuleInMemory> memory_map = process.GetMemoryMapCopy();
+  for (const auto& [start, module_in_memory] : memory_map) {
+    const ModuleData* module = module_manager.GetModuleByPathAndBuildId(
+        module_in_memory.file_path(), module_in_memory.build_id());
+    if (module == nullptr) continue;
+
+    std::shared_ptr<const ModuleFunctionIndex> function_index = module->GetFunctionIndex();
+    if (function_index->empty()) continue;
+
+    module_starts_.push_back(start);
+    module_ends_.push_back(module_in_memory.end());
+    module_elf_bases_.push_back(start - module->executable_segment_offset() - module->load_bias());
+    module_function_indices_.push_back(std::move(function_index));
+  }
+}
+
+size_t AddressToFunctionIndex::FindModuleIndex(uint64_t absolute_address) const {
+  const size_t module_index = FindLastLessOrEqual(module_starts_, absolute_address);
+  if (module_index == kIndexNotFound || absolute_address >= module_ends_[module_index]) {
+    return kIndexNotFound;
+  }
+  return module_index;
+}
+
+const FunctionInfo* AddressToFunctionIndex::FindFunctionByAddress(uint64_t absolute_address,
+                                                                  bool is_exact) const {
+  const size_t module_index = FindModuleIndex(absolute_address);
+  if (module_index == kIndexNotFound) return nullptr;
+
+  return module_function_indices_[module_index]->FindFunctionByElfAddress(
+      absolute_address - module_elf_bases_[module_index], is_exact);
+}
+
+std::optional<uint64_t> AddressToFunctionIndex::FindFunctionAbsoluteAddressByAddress(
+    uint64_t absolute_address) const {
+  const size_t module_index = FindModuleIndex(absolute_address);
+  if (module_index == kIndexNotFound) return std::nullopt;
+
+  const FunctionInfo* function = module_function_indices_[module_index]->FindFunctionByElfAddress(
+      absolute_address - module_elf_bases_[module_index], /*is_exact=*/false);
+  if (function == nullptr) return std::nullopt;
+
+  return module_elf_bases_[module_index] + function->address();
+}
+
+void AddressToFunctionIndex::FindFunctionsByAddresses(
+    absl::Span<const uint64_t> absolute_addresses, absl::Span<const FunctionInfo*> functions,
+    absl::Span<uint64_t> function_absolute_addresses) const {
+  CHECK(functions.size() == absolute_addresses.size());
+  CHECK(function_absolute_addresses.size() == absolute_addresses.size());
+
+  size_t module_index = kIndexNotFound;
+  for (size_t i = 0; i < absolute_addresses.size(); ++i) {
+    const uint64_t absolute_address = absolute_addresses[i];
+    if (module_index == kIndexNotFound || !ModuleContains(module_index, absolute_address)) {
+      module_index = FindModuleIndex(absolute_address);
+    }
+
+    const FunctionInfo* function = nullptr;
+    if (module_index != kIndexNotFound) {
+      function = module_function_indices_[module_index]->FindFunctionByElfAddress(
+          absolute_address - module_elf_bases_[module_index], /*is_exact=*/false);
+    }
+    functions[i] = function;
+    function_absolute_addresses[i] =
+        function != nullptr ? module_elf_bases_[module_index] + function->address() : 0;
+  }
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,221 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ClientData/AddressToFunctionIndex.h"
+#include "ClientData/ModuleData.h"
+#include "ClientData/ModuleManager.h"
+#include "ClientData/ProcessData.h"
+#include "OrbitBase/Logging.h"
+#include "capture_data.pb.h"
+#include "module.pb.h"
+#include "symbol.pb.h"
+
+using orbit_client_protos::FunctionInfo;
+using orbit_grpc_protos::ModuleInfo;
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+
+namespace orbit_client_data {
+
+namespace {
+
+constexpr const char* kModulePath1 = "/path/to/module1";
+constexpr const char* kModulePath2 = "/path/to/module2";
+constexpr const char* kBuildId = "build_id";
+
+constexpr uint64_t kModule1Start = 0x10000;
+constexpr uint64_t kModule1End = 0x20000;
+constexpr uint64_t kModule2Start = 0x40000;
+constexpr uint64_t kModule2End = 0x50000;
+constexpr uint64_t kLoadBias = 0x400000;
+constexpr uint64_t kExecutableSegmentOffset = 0x1000;
+
+ModuleInfo CreateModuleInfo(const std::string& file_path, uint64_t start, uint64_t end) {
+  ModuleInfo module_info;
+  module_info.set_name(file_path);
+  module_info.set_file_path(file_path);
+  module_info.set_build_id(kBuildId);
+  module_info.set_address_start(start);
+  module_info.set_address_end(end);
+  module_info.set_load_bias(kLoadBias);
+  module_info.set_executable_segment_offset(kExecutableSegmentOffset);
+  return module_info;
+}
+
+// Adds `function_count` contiguous functions of size `function_size` to the module, starting from
+// the beginning of the executable segment.
+void AddSymbols(ModuleManager* module_manager, const std::string& file_path,
+                uint64_t function_count, uint64_t function_size) {
+  ModuleSymbols symbols;
+  for (uint64_t i = 0; i < function_count; ++i) {
+    SymbolInfo* symbol = symbols.add_symbol_infos();
+    symbol->set_name(absl::StrFormat("function%u", i));
+    symbol->set_demangled_name(absl::StrFormat("function%u", i));
+    symbol->set_address(kLoadBias + kExecutableSegmentOffset + i * function_size);
+    symbol->set_size(function_size);
+  }
+  ModuleData* module = module_manager->GetMutableModuleByPathAndBuildId(file_path, kBuildId);
+  CHECK(module != nullptr);
+  module->AddSymbols(symbols);
+}
+
+// The absolute address of byte `offset` of function `function_index`, as added by AddSymbols.
+uint64_t AbsoluteAddress(uint64_t module_start, uint64_t function_index, uint64_t function_size,
+                         uint64_t offset) {
+  return module_start + function_index * function_size + offset;
+}
+
+class AddressToFunctionIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::vector<ModuleInfo> module_infos{
+        CreateModuleInfo(kModulePath1, kModule1Start, kModule1End),
+        CreateModuleInfo(kModulePath2, kModule2Start, kModule2End)};
+    process_.UpdateModuleInfos(module_infos);
+    CHECK(module_manager_.AddOrUpdateModules(module_infos).empty());
+  }
+
+  ProcessData process_;
+  ModuleManager module_manager_;
+};
+
+}  // namespace
+
+TEST_F(AddressToFunctionIndexTest, OnlyModulesWithSymbolsAreIndexed) {
+  EXPECT_EQ(AddressToFunctionIndex(process_, module_manager_).module_count(), 0);
+
+  AddSymbols(&module_manager_, kModulePath2, 10, 0x10);
+  AddressToFunctionIndex index{process_, module_manager_};
+  EXPECT_EQ(index.module_count(), 1);
+  EXPECT_EQ(index.FindFunctionByAddress(kModule1Start, false), nullptr);
+  EXPECT_NE(index.FindFunctionByAddress(kModule2Start, false), nullptr);
+}
+
+TEST_F(AddressToFunctionIndexTest, FindFunctionByAddress) {
+  constexpr uint64_t kFunctionSize = 0x10;
+  AddSymbols(&module_manager_, kModulePath1, 10, kFunctionSize);
+  AddSymbols(&module_manager_, kModulePath2, 10, kFunctionSize);
+  AddressToFunctionIndex index{process_, module_manager_};
+
+  const uint64_t address = AbsoluteAddress(kModule2Start, 3, kFunctionSize, 4);
+  const FunctionInfo* function = index.FindFunctionByAddress(address, false);
+  ASSERT_NE(function, nullptr);
+  EXPECT_EQ(function->name(), "function3");
+  EXPECT_EQ(function->module_path(), kModulePath2);
+  EXPECT_EQ(index.FindFunctionByAddress(address, true), nullptr);
+  const uint64_t function_address = AbsoluteAddress(kModule2Start, 3, kFunctionSize, 0);
+  EXPECT_EQ(index.FindFunctionByAddress(function_address, true), function);
+  EXPECT_EQ(index.FindFunctionAbsoluteAddressByAddress(address), function_address);
+
+  // Same results as the lookup through the ModuleData.
+  const ModuleData* module = module_manager_.GetModuleByPathAndBuildId(kModulePath2, kBuildId);
+  const uint64_t offset = address - kModule2Start + kExecutableSegmentOffset;
+  EXPECT_EQ(module->FindFunctionByOffset(offset, false), function);
+
+  // Before the first module, between the modules, after the last function and after the last
+  // module.
+  EXPECT_EQ(index.FindFunctionByAddress(kModule1Start - 1, false), nullptr);
+  EXPECT_EQ(index.FindFunctionByAddress(kModule2Start - 1, false), nullptr);
+  const uint64_t after_last_function = AbsoluteAddress(kModule1Start, 11, kFunctionSize, 0);
+  EXPECT_EQ(index.FindFunctionByAddress(after_last_function, false), nullptr);
+  EXPECT_EQ(index.FindFunctionByAddress(kModule2End, false), nullptr);
+  EXPECT_EQ(index.FindFunctionAbsoluteAddressByAddress(kModule2End), std::nullopt);
+}
+
+TEST_F(AddressToFunctionIndexTest, FindFunctionsByAddresses) {
+  constexpr uint64_t kFunctionSize = 0x10;
+  AddSymbols(&module_manager_, kModulePath1, 10, kFunctionSize);
+  AddSymbols(&module_manager_, kModulePath2, 10, kFunctionSize);
+  AddressToFunctionIndex index{process_, module_manager_};
+
+  const std::vector<uint64_t> addresses{AbsoluteAddress(kModule1Start, 5, kFunctionSize, 1),
+                                        AbsoluteAddress(kModule1Start, 2, kFunctionSize, 2),
+                                        kModule2Start - 1,
+                                        AbsoluteAddress(kModule2Start, 7, kFunctionSize, 3),
+                                        AbsoluteAddress(kModule1Start, 9, kFunctionSize, 4)};
+  std::vector<const FunctionInfo*> functions(addresses.size());
+  std::vector<uint64_t> function_addresses(addresses.size());
+  index.FindFunctionsByAddresses(addresses, absl::MakeSpan(functions),
+                                 absl::MakeSpan(function_addresses));
+
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    EXPECT_EQ(functions[i], index.FindFunctionByAddress(addresses[i], false));
+    EXPECT_EQ(function_addresses[i],
+              index.FindFunctionAbsoluteAddressByAddress(addresses[i]).value_or(0));
+  }
+  EXPECT_EQ(functions[2], nullptr);
+  ASSERT_NE(functions[3], nullptr);
+  EXPECT_EQ(functions[3]->name(), "function7");
+  EXPECT_EQ(function_addresses[3], AbsoluteAddress(kModule2Start, 7, kFunctionSize, 0));
+}
+
+// Logs the throughput of AddressToFunctionIndex next to the one of the lookups through ProcessData
+// and ModuleData that it replaces. Timing only, so disabled unless disabled tests are requested.
+TEST_F(AddressToFunctionIndexTest, DISABLED_LookupBenchmark) {
+  constexpr uint64_t kFunctionCount = 4096;
+  constexpr uint64_t kFunctionSize = 0x4;
+  constexpr uint64_t kLookupCount = 1'000'000;
+  AddSymbols(&module_manager_, kModulePath1, kFunctionCount, kFunctionSize);
+  AddSymbols(&module_manager_, kModulePath2, kFunctionCount, kFunctionSize);
+  AddressToFunctionIndex index{process_, module_manager_};
+
+  std::vector<uint64_t> addresses;
+  addresses.reserve(kLookupCount);
+  uint64_t state = 1;
+  for (uint64_t i = 0; i < kLookupCount; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const uint64_t module_start = (state >> 63) != 0 ? kModule1Start : kModule2Start;
+    addresses.push_back(AbsoluteAddress(module_start, (state >> 20) % kFunctionCount,
+                                        kFunctionSize, (state >> 8) % kFunctionSize));
+  }
+
+  uint64_t found_count = 0;
+  absl::Time start = absl::Now();
+  for (uint64_t address : addresses) {
+    if (index.FindFunctionByAddress(address, false) != nullptr) ++found_count;
+  }
+  const absl::Duration index_duration = absl::Now() - start;
+  EXPECT_EQ(found_count, kLookupCount);
+
+  std::vector<const FunctionInfo*> functions(addresses.size());
+  std::vector<uint64_t> function_addresses(addresses.size());
+  start = absl::Now();
+  index.FindFunctionsByAddresses(addresses, absl::MakeSpan(functions),
+                                 absl::MakeSpan(function_addresses));
+  const absl::Duration batch_duration = absl::Now() - start;
+
+  found_count = 0;
+  start = absl::Now();
+  for (uint64_t address : addresses) {
+    const auto module_in_memory = process_.FindModuleByAddress(address);
+    if (module_in_memory.has_error()) continue;
+    const ModuleData* module = module_manager_.GetModuleByPathAndBuildId(
+        module_in_memory.value().file_path(), module_in_memory.value().build_id());
+    const uint64_t offset =
+        address - module_in_memory.value().start() + module->executable_segment_offset();
+    if (module->FindFunctionByOffset(offset, false) != nullptr) ++found_count;
+  }
+  const absl::Duration baseline_duration = absl::Now() - start;
+  EXPECT_EQ(found_count, kLookupCount);
+
+  auto lookups_per_second = [](absl::Duration duration) {
+    return kLookupCount / absl::ToDoubleSeconds(duration);
+  };
+  LOG("AddressToFunctionIndex: %.1fM lookups/s, batch: %.1fM lookups/s, "
+      "ProcessData and ModuleData: %.1fM lookups/s",
+      lookups_per_second(index_duration) / 1e6, lookups_per_second(batch_duration) / 1e6,
+      lookups_per_second(baseline_duration) / 1e6);
+}
+
+}  // namespace orbit_client_data
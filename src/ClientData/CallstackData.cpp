@@ -7,7 +7,10 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
+#include <type_traits>
 #include <utility>
 
 #include "ClientData/CallstackTypes.h"
@@ -19,12 +22,94 @@ using orbit_client_protos::CallstackInfo;
 
 namespace orbit_client_data {
 
+namespace {
+
+template <typename ThreadCallstackEvents>
+[[nodiscard]] uint64_t GetTimestamp(const ThreadCallstackEvents& thread_events, size_t index) {
+  constexpr size_t kCapacity = std::remove_reference_t<
+      decltype(*thread_events.chunks.front())>::kCapacity;
+  return thread_events.chunks[index / kCapacity]->timestamps_ns[index % kCapacity];
+}
+
+// Returns the index of the first event of `thread_events` for which `is_after(timestamp)` is true,
+// assuming that `is_after` is false for a prefix of the events and true for the rest.
+template <typename ThreadCallstackEvents, typename IsAfter>
+[[nodiscard]] size_t PartitionPoint(const ThreadCallstackEvents& thread_events,
+                                    IsAfter&& is_after) {
+  size_t begin = 0;
+  size_t end = thread_events.size;
+  while (begin < end) {
+    size_t middle = begin + (end - begin) / 2;
+    if (is_after(GetTimestamp(thread_events, middle))) {
+      end = middle;
+    } else {
+      begin = middle + 1;
+    }
+  }
+  return begin;
+}
+
+}  // namespace
+
 void CallstackData::AddCallstackEvent(CallstackEvent callstack_event) {
   std::lock_guard lock(mutex_);
   CHECK(unique_callstacks_.contains(callstack_event.callstack_id()));
+  absl::MutexLock events_lock(&callstack_events_mutex_);
   RegisterTime(callstack_event.time());
-  callstack_events_by_tid_[callstack_event.thread_id()][callstack_event.time()] =
-      std::move(callstack_event);
+  AddCallstackEventLocked(callstack_event.thread_id(), callstack_event.time(),
+                          callstack_event.callstack_id());
+}
+
+void CallstackData::AddCallstackEventLocked(int32_t thread_id, uint64_t timestamp_ns,
+                                            uint64_t callstack_id) {
+  constexpr size_t kCapacity = CallstackEventChunk::kCapacity;
+  ThreadCallstackEvents& thread_events = callstack_events_by_tid_[thread_id];
+
+  // Fast path: samples of a thread almost always arrive in order. Appending only writes past the
+  // last event, which no reader looks at, so the last chunk can be shared with readers.
+  if (thread_events.size == 0 ||
+      GetTimestamp(thread_events, thread_events.size - 1) < timestamp_ns) {
+    if (thread_events.size % kCapacity == 0) {
+      thread_events.chunks.push_back(std::make_shared<CallstackEventChunk>());
+    }
+    CallstackEventChunk& chunk = *thread_events.chunks.back();
+    chunk.timestamps_ns[thread_events.size % kCapacity] = timestamp_ns;
+    chunk.callstack_ids[thread_events.size % kCapacity] = callstack_id;
+    ++thread_events.size;
+    return;
+  }
+
+  // Slow path: the event needs to replace or be inserted before existing events. Readers might
+  // still be iterating over those, so the affected chunks are copied before being modified.
+  const size_t index = PartitionPoint(
+      thread_events, [timestamp_ns](uint64_t timestamp) { return timestamp >= timestamp_ns; });
+  CHECK(index < thread_events.size);
+  if (GetTimestamp(thread_events, index) == timestamp_ns) {
+    // As for a map, an event with the same timestamp replaces the existing one.
+    std::shared_ptr<CallstackEventChunk>& chunk = thread_events.chunks[index / kCapacity];
+    chunk = std::make_shared<CallstackEventChunk>(*chunk);
+    chunk->callstack_ids[index % kCapacity] = callstack_id;
+    return;
+  }
+
+  if (thread_events.size % kCapacity == 0) {
+    thread_events.chunks.push_back(std::make_shared<CallstackEventChunk>());
+  }
+  for (size_t chunk_index = index / kCapacity; chunk_index < thread_events.chunks.size();
+       ++chunk_index) {
+    thread_events.chunks[chunk_index] =
+        std::make_shared<CallstackEventChunk>(*thread_events.chunks[chunk_index]);
+  }
+  for (size_t i = thread_events.size; i > index; --i) {
+    CallstackEventChunk& destination = *thread_events.chunks[i / kCapacity];
+    const CallstackEventChunk& source = *thread_events.chunks[(i - 1) / kCapacity];
+    destination.timestamps_ns[i % kCapacity] = source.timestamps_ns[(i - 1) % kCapacity];
+    destination.callstack_ids[i % kCapacity] = source.callstack_ids[(i - 1) % kCapacity];
+  }
+  CallstackEventChunk& chunk = *thread_events.chunks[index / kCapacity];
+  chunk.timestamps_ns[index % kCapacity] = timestamp_ns;
+  chunk.callstack_ids[index % kCapacity] = callstack_id;
+  ++thread_events.size;
 }
 
 void CallstackData::RegisterTime(uint64_t time) {
@@ -40,109 +125,146 @@ void CallstackData::AddUniqueCallstack(uint64_t callstack_id,
 }
 
 uint32_t CallstackData::GetCallstackEventsCount() const {
-  std::lock_guard lock(mutex_);
+  absl::ReaderMutexLock lock(&callstack_events_mutex_);
   uint32_t count = 0;
   for (const auto& tid_and_events : callstack_events_by_tid_) {
-    count += tid_and_events.second.size();
+    count += tid_and_events.second.size;
   }
   return count;
 }
 
-std::vector<orbit_client_protos::CallstackEvent> CallstackData::GetCallstackEventsInTimeRange(
-    uint64_t time_begin, uint64_t time_end) const {
-  std::lock_guard lock(mutex_);
-  std::vector<CallstackEvent> callstack_events;
+uint64_t CallstackData::GetCallstackEventsMemoryUsageBytes() const {
+  absl::ReaderMutexLock lock(&callstack_events_mutex_);
+  uint64_t bytes = callstack_events_by_tid_.capacity() *
+                   sizeof(std::pair<const int32_t, ThreadCallstackEvents>);
   for (const auto& tid_and_events : callstack_events_by_tid_) {
-    const std::map<uint64_t, CallstackEvent>& events = tid_and_events.second;
-    for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-      uint64_t time = event_it->first;
-      if (time < time_end) {
-        callstack_events.push_back(event_it->second);
-      } else {
-        break;
+    const std::vector<std::shared_ptr<CallstackEventChunk>>& chunks = tid_and_events.second.chunks;
+    bytes += chunks.capacity() * sizeof(std::shared_ptr<CallstackEventChunk>) +
+             chunks.size() * sizeof(CallstackEventChunk);
+  }
+  return bytes;
+}
+
+std::vector<CallstackData::CallstackEventChunkRange> CallstackData::GetChunkRangesInTimeRange(
+    const ThreadCallstackEvents& thread_events, uint64_t min_timestamp, uint64_t max_timestamp) {
+  constexpr size_t kCapacity = CallstackEventChunk::kCapacity;
+  const size_t begin = PartitionPoint(
+      thread_events, [min_timestamp](uint64_t timestamp) { return timestamp >= min_timestamp; });
+  const size_t end = PartitionPoint(
+      thread_events, [max_timestamp](uint64_t timestamp) { return timestamp > max_timestamp; });
+
+  std::vector<CallstackEventChunkRange> chunk_ranges;
+  for (size_t range_begin = begin; range_begin < end;) {
+    const size_t chunk_index = range_begin / kCapacity;
+    const size_t range_end = std::min(end, (chunk_index + 1) * kCapacity);
+    chunk_ranges.push_back(CallstackEventChunkRange{thread_events.chunks[chunk_index],
+                                                    range_begin % kCapacity,
+                                                    range_end - chunk_index * kCapacity});
+    range_begin = range_end;
+  }
+  return chunk_ranges;
+}
+
+std::vector<CallstackData::ThreadCallstackEventChunkRanges>
+CallstackData::GetChunkRangesInTimeRange(std::optional<int32_t> thread_id, uint64_t min_timestamp,
+                                         uint64_t max_timestamp) const {
+  std::vector<ThreadCallstackEventChunkRanges> thread_chunk_ranges;
+  if (min_timestamp > max_timestamp) return thread_chunk_ranges;
+
+  absl::ReaderMutexLock lock(&callstack_events_mutex_);
+  if (thread_id.has_value()) {
+    auto tid_and_events_it = callstack_events_by_tid_.find(thread_id.value());
+    if (tid_and_events_it == callstack_events_by_tid_.end()) return thread_chunk_ranges;
+    thread_chunk_ranges.push_back(ThreadCallstackEventChunkRanges{
+        thread_id.value(),
+        GetChunkRangesInTimeRange(tid_and_events_it->second, min_timestamp, max_timestamp)});
+    return thread_chunk_ranges;
+  }
+
+  thread_chunk_ranges.reserve(callstack_events_by_tid_.size());
+  for (const auto& [tid, thread_events] : callstack_events_by_tid_) {
+    thread_chunk_ranges.push_back(ThreadCallstackEventChunkRanges{
+        tid, GetChunkRangesInTimeRange(thread_events, min_timestamp, max_timestamp)});
+  }
+  return thread_chunk_ranges;
+}
+
+void CallstackData::ForEachCallstackEventInChunkRanges(
+    const std::vector<ThreadCallstackEventChunkRanges>& thread_chunk_ranges,
+    const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) {
+  // The same message is reused for all events, so only pass it to actions that don't keep a
+  // reference to it.
+  CallstackEvent event;
+  for (const auto& [tid, chunk_ranges] : thread_chunk_ranges) {
+    event.set_thread_id(tid);
+    for (const CallstackEventChunkRange& chunk_range : chunk_ranges) {
+      for (size_t i = chunk_range.begin; i < chunk_range.end; ++i) {
+        event.set_time(chunk_range.chunk->timestamps_ns[i]);
+        event.set_callstack_id(chunk_range.chunk->callstack_ids[i]);
+        action(event);
       }
     }
   }
+}
+
+std::vector<orbit_client_protos::CallstackEvent> CallstackData::GetCallstackEventsInTimeRange(
+    uint64_t time_begin, uint64_t time_end) const {
+  std::vector<CallstackEvent> callstack_events;
+  if (time_end == 0) return callstack_events;
+  ForEachCallstackEventInChunkRanges(
+      GetChunkRangesInTimeRange(std::nullopt, time_begin, time_end - 1),
+      [&callstack_events](const CallstackEvent& event) { callstack_events.push_back(event); });
   return callstack_events;
 }
 
 absl::flat_hash_map<int32_t, uint32_t> CallstackData::GetCallstackEventsCountsPerTid() const {
-  std::lock_guard lock(mutex_);
+  absl::ReaderMutexLock lock(&callstack_events_mutex_);
   absl::flat_hash_map<int32_t, uint32_t> counts;
   for (const auto& tid_and_events : callstack_events_by_tid_) {
-    counts.emplace(tid_and_events.first, tid_and_events.second.size());
+    counts.emplace(tid_and_events.first, tid_and_events.second.size);
   }
   return counts;
 }
 
 uint32_t CallstackData::GetCallstackEventsOfTidCount(int32_t thread_id) const {
-  std::lock_guard lock(mutex_);
+  absl::ReaderMutexLock lock(&callstack_events_mutex_);
   const auto& tid_and_events_it = callstack_events_by_tid_.find(thread_id);
   if (tid_and_events_it == callstack_events_by_tid_.end()) {
     return 0;
   }
-  return tid_and_events_it->second.size();
+  return tid_and_events_it->second.size;
 }
 
 std::vector<CallstackEvent> CallstackData::GetCallstackEventsOfTidInTimeRange(
     int32_t tid, uint64_t time_begin, uint64_t time_end) const {
-  std::lock_guard lock(mutex_);
   std::vector<CallstackEvent> callstack_events;
-
-  auto tid_and_events_it = callstack_events_by_tid_.find(tid);
-  if (tid_and_events_it == callstack_events_by_tid_.end()) {
-    return callstack_events;
-  }
-
-  const std::map<uint64_t, CallstackEvent>& events = tid_and_events_it->second;
-  for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-    uint64_t time = event_it->first;
-    if (time < time_end) {
-      callstack_events.push_back(event_it->second);
-    } else {
-      break;
-    }
-  }
+  if (time_end == 0) return callstack_events;
+  ForEachCallstackEventInChunkRanges(
+      GetChunkRangesInTimeRange(tid, time_begin, time_end - 1),
+      [&callstack_events](const CallstackEvent& event) { callstack_events.push_back(event); });
   return callstack_events;
 }
 
 void CallstackData::ForEachCallstackEvent(
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
-  std::lock_guard lock(mutex_);
-  for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
-    for (const auto& [unused_timestamp, event] : events) {
-      action(event);
-    }
-  }
+  ForEachCallstackEventInChunkRanges(
+      GetChunkRangesInTimeRange(std::nullopt, 0, std::numeric_limits<uint64_t>::max()), action);
 }
 
 void CallstackData::ForEachCallstackEventInTimeRange(
     uint64_t min_timestamp, uint64_t max_timestamp,
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
-  std::lock_guard lock(mutex_);
   CHECK(min_timestamp <= max_timestamp);
-  for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
-    for (auto event_it = events.lower_bound(min_timestamp);
-         event_it != events.upper_bound(max_timestamp); ++event_it) {
-      action(event_it->second);
-    }
-  }
+  ForEachCallstackEventInChunkRanges(
+      GetChunkRangesInTimeRange(std::nullopt, min_timestamp, max_timestamp), action);
 }
 
 void CallstackData::ForEachCallstackEventOfTidInTimeRange(
     int32_t tid, uint64_t min_timestamp, uint64_t max_timestamp,
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
-  std::lock_guard lock(mutex_);
   CHECK(min_timestamp <= max_timestamp);
-  const auto& tid_and_events_it = callstack_events_by_tid_.find(tid);
-  if (tid_and_events_it == callstack_events_by_tid_.end()) {
-    return;
-  }
-  const auto& events = tid_and_events_it->second;
-  for (auto event_it = events.lower_bound(min_timestamp);
-       event_it != events.upper_bound(max_timestamp); ++event_it) {
-    action(event_it->second);
-  }
+  ForEachCallstackEventInChunkRanges(GetChunkRangesInTimeRange(tid, min_timestamp, max_timestamp),
+                                     action);
 }
 
 void CallstackData::AddCallstackFromKnownCallstackData(const CallstackEvent& event,
@@ -157,7 +279,8 @@ void CallstackData::AddCallstackFromKnownCallstackData(const CallstackEvent& eve
 
   // The insertion only happens if the hash isn't already present.
   unique_callstacks_.emplace(callstack_id, std::move(unique_callstack));
-  callstack_events_by_tid_[event.thread_id()][event.time()] = CallstackEvent(event);
+  absl::MutexLock events_lock(&callstack_events_mutex_);
+  AddCallstackEventLocked(event.thread_id(), event.time(), callstack_id);
 }
 
 const orbit_client_protos::CallstackInfo* CallstackData::GetCallstack(uint64_t callstack_id) const {
@@ -211,16 +334,21 @@ void CallstackData::UpdateCallstackTypeBasedOnMajorityStart() {
 
   absl::flat_hash_set<uint64_t> callstack_ids_to_filter;
 
-  for (auto& [tid, timestamps_and_callstack_events] : callstack_events_by_tid_) {
+  // Take a snapshot of all the events, as the events and the CallstackInfos are guarded by
+  // different mutexes.
+  const std::vector<ThreadCallstackEventChunkRanges> thread_chunk_ranges =
+      GetChunkRangesInTimeRange(std::nullopt, 0, std::numeric_limits<uint64_t>::max());
+
+  for (const auto& [tid, chunk_ranges] : thread_chunk_ranges) {
     uint64_t count_for_this_thread = 0;
 
     // Count the number of occurrences of each outer frame for this thread.
     absl::flat_hash_map<uint64_t, uint64_t> count_by_outer_frame;
-    for (const auto& [unused_timestamp_ns, event] : timestamps_and_callstack_events) {
+    ForEachCallstackEventInChunkRanges({{tid, chunk_ranges}}, [&](const CallstackEvent& event) {
       const CallstackInfo& callstack = *unique_callstacks_.at(event.callstack_id());
       CHECK(callstack.type() != CallstackInfo::kFilteredByMajorityOutermostFrame);
       if (callstack.type() != CallstackInfo::kComplete) {
-        continue;
+        return;
       }
       ++count_for_this_thread;
 
@@ -228,7 +356,7 @@ void CallstackData::UpdateCallstackTypeBasedOnMajorityStart() {
       CHECK(!frames.empty());
       uint64_t outer_frame = *frames.rbegin();
       ++count_by_outer_frame[outer_frame];
-    }
+    });
 
     // Find the outer frame with the most occurrences.
     if (count_by_outer_frame.empty()) {
@@ -258,19 +386,19 @@ void CallstackData::UpdateCallstackTypeBasedOnMajorityStart() {
     // doesn't match the (super)majority outer frame.
     // Note that if a CallstackEvent from another thread references a filtered CallstackInfo, that
     // CallstackEvent will also be affected.
-    for (const auto& [unused_timestamp_ns, event] : timestamps_and_callstack_events) {
+    ForEachCallstackEventInChunkRanges({{tid, chunk_ranges}}, [&](const CallstackEvent& event) {
       const CallstackInfo& callstack = *unique_callstacks_.at(event.callstack_id());
       CHECK(callstack.type() != CallstackInfo::kFilteredByMajorityOutermostFrame);
       if (callstack.type() != CallstackInfo::kComplete) {
-        continue;
+        return;
       }
 
-      const auto& frames = unique_callstacks_.at(event.callstack_id())->frames();
+      const auto& frames = callstack.frames();
       CHECK(!frames.empty());
       if (*frames.rbegin() != majority_outer_frame) {
         callstack_ids_to_filter.insert(event.callstack_id());
       }
-    }
+    });
   }
 
   // Change the type of the recorded CallstackInfos.
@@ -282,16 +410,15 @@ void CallstackData::UpdateCallstackTypeBasedOnMajorityStart() {
 
   // Count how many CallstackEvents had their CallstackInfo affected by the type change.
   uint64_t affected_event_count = 0;
-  for (auto& [tid, timestamps_and_callstack_events] : callstack_events_by_tid_) {
-    for (const auto& [unused_timestamp_ns, event] : timestamps_and_callstack_events) {
-      if (unique_callstacks_.at(event.callstack_id())->type() ==
-          CallstackInfo::kFilteredByMajorityOutermostFrame) {
-        ++affected_event_count;
-      }
+  uint32_t callstack_event_count = 0;
+  ForEachCallstackEventInChunkRanges(thread_chunk_ranges, [&](const CallstackEvent& event) {
+    ++callstack_event_count;
+    if (unique_callstacks_.at(event.callstack_id())->type() ==
+        CallstackInfo::kFilteredByMajorityOutermostFrame) {
+      ++affected_event_count;
     }
-  }
+  });
 
-  uint32_t callstack_event_count = GetCallstackEventsCount();
   LOG("Filtered %u CallstackInfos of %u (%.2f%%), affecting %u CallstackEvents of %u (%.2f%%)",
       callstack_ids_to_filter.size(), unique_callstacks_.size(),
       100.0f * callstack_ids_to_filter.size() / unique_callstacks_.size(), affected_event_count,
@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -11,6 +13,7 @@
 #include <vector>
 
 #include "ClientData/CallstackData.h"
+#include "OrbitBase/Logging.h"
 #include "capture_data.pb.h"
 
 using orbit_client_protos::CallstackEvent;
@@ -162,4 +165,184 @@ TEST(CallstackData, FilterCallstackEventsBasedOnMajorityStart) {
       testing::Pointwise(CallstackEventEq(), std::vector<CallstackEvent>{event8, event9, event10}));
 }
 
+namespace {
+
+CallstackEvent MakeCallstackEvent(uint64_t time, int32_t thread_id, uint64_t callstack_id) {
+  CallstackEvent event;
+  event.set_time(time);
+  event.set_thread_id(thread_id);
+  event.set_callstack_id(callstack_id);
+  return event;
+}
+
+}  // namespace
+
+TEST(CallstackData, RangeQueriesSpanningMultipleChunks) {
+  CallstackData callstack_data;
+  constexpr uint64_t kCallstackId = 1;
+  callstack_data.AddUniqueCallstack(kCallstackId, CallstackInfo{});
+
+  constexpr int32_t kTid1 = 42;
+  constexpr int32_t kTid2 = 43;
+  constexpr uint64_t kEventCount = 5000;
+  for (uint64_t i = 1; i <= kEventCount; ++i) {
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(10 * i, kTid1, kCallstackId));
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(10 * i + 5, kTid2, kCallstackId));
+  }
+
+  EXPECT_EQ(callstack_data.GetCallstackEventsCount(), 2 * kEventCount);
+  EXPECT_EQ(callstack_data.GetCallstackEventsOfTidCount(kTid1), kEventCount);
+  EXPECT_EQ(callstack_data.GetCallstackEventsCountsPerTid().size(), 2);
+  EXPECT_EQ(callstack_data.min_time(), 10);
+  EXPECT_EQ(callstack_data.max_time(), 10 * kEventCount + 5);
+
+  // The end of the range is exclusive.
+  std::vector<CallstackEvent> events =
+      callstack_data.GetCallstackEventsOfTidInTimeRange(kTid1, 10'000, 30'000);
+  ASSERT_EQ(events.size(), 2000);
+  EXPECT_EQ(events.front().time(), 10'000);
+  EXPECT_EQ(events.back().time(), 29'990);
+  for (size_t i = 1; i < events.size(); ++i) {
+    EXPECT_EQ(events[i].time(), events[i - 1].time() + 10);
+    EXPECT_EQ(events[i].thread_id(), kTid1);
+  }
+
+  EXPECT_EQ(callstack_data.GetCallstackEventsInTimeRange(10'000, 30'000).size(), 4000);
+  EXPECT_TRUE(callstack_data.GetCallstackEventsInTimeRange(0, 10).empty());
+  EXPECT_TRUE(callstack_data.GetCallstackEventsOfTidInTimeRange(44, 0, 100).empty());
+
+  // The end of the range is inclusive.
+  uint64_t count = 0;
+  callstack_data.ForEachCallstackEventOfTidInTimeRange(
+      kTid2, 15, 10'005, [&count, kTid2](const CallstackEvent& event) {
+        EXPECT_EQ(event.thread_id(), kTid2);
+        ++count;
+      });
+  EXPECT_EQ(count, 1000);
+
+  count = 0;
+  callstack_data.ForEachCallstackEventInTimeRange(
+      10 * kEventCount, std::numeric_limits<uint64_t>::max(),
+      [&count](const CallstackEvent& /*event*/) { ++count; });
+  EXPECT_EQ(count, 2);
+}
+
+TEST(CallstackData, OutOfOrderAndDuplicateEvents) {
+  CallstackData callstack_data;
+  constexpr int32_t kTid = 42;
+  for (uint64_t callstack_id = 1; callstack_id <= 3; ++callstack_id) {
+    callstack_data.AddUniqueCallstack(callstack_id, CallstackInfo{});
+  }
+
+  // Insert the events of the first chunk last, so that all the following ones need to be moved.
+  constexpr uint64_t kEventCount = 3000;
+  std::vector<CallstackEvent> expected_events;
+  for (uint64_t time = 1; time <= kEventCount; ++time) {
+    expected_events.push_back(MakeCallstackEvent(time, kTid, 1));
+  }
+  for (uint64_t time = 1001; time <= kEventCount; ++time) {
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(time, kTid, 1));
+  }
+  std::vector<CallstackEvent> events_before_insertion =
+      callstack_data.GetCallstackEventsOfTidInTimeRange(kTid, 0, 2000);
+  for (uint64_t time = 1000; time >= 1; --time) {
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(time, kTid, 1));
+  }
+  // Events with an existing timestamp replace the existing event.
+  callstack_data.AddCallstackEvent(MakeCallstackEvent(1500, kTid, 2));
+  expected_events[1499].set_callstack_id(2);
+  callstack_data.AddCallstackEvent(MakeCallstackEvent(kEventCount, kTid, 3));
+  expected_events.back().set_callstack_id(3);
+
+  EXPECT_EQ(callstack_data.GetCallstackEventsCount(), kEventCount);
+  EXPECT_THAT(callstack_data.GetCallstackEventsOfTidInTimeRange(
+                  kTid, 0, std::numeric_limits<uint64_t>::max()),
+              testing::Pointwise(CallstackEventEq(), expected_events));
+  // Results returned earlier are not affected.
+  EXPECT_EQ(events_before_insertion.size(), 999);
+  EXPECT_EQ(events_before_insertion.front().time(), 1001);
+}
+
+TEST(CallstackData, ForEachCallstackEventAllowsAddingEvents) {
+  CallstackData callstack_data;
+  constexpr uint64_t kCallstackId = 1;
+  callstack_data.AddUniqueCallstack(kCallstackId, CallstackInfo{});
+  constexpr int32_t kTid = 42;
+  for (uint64_t time = 1; time <= 10; ++time) {
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(time, kTid, kCallstackId));
+  }
+
+  // Events added while iterating are not visited.
+  uint64_t visited_count = 0;
+  callstack_data.ForEachCallstackEvent([&](const CallstackEvent& event) {
+    EXPECT_TRUE(callstack_data.HasCallstack(event.callstack_id()));
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(event.time() + 100, kTid, kCallstackId));
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(event.time() - 1, kTid + 1, kCallstackId));
+    ++visited_count;
+  });
+  EXPECT_EQ(visited_count, 10);
+  EXPECT_EQ(callstack_data.GetCallstackEventsCount(), 30);
+}
+
+TEST(CallstackData, GetCallstackEventsMemoryUsageBytes) {
+  CallstackData callstack_data;
+  EXPECT_EQ(callstack_data.GetCallstackEventsMemoryUsageBytes(), 0);
+
+  constexpr int32_t kTid = 42;
+  constexpr uint64_t kCallstackId = 1;
+  callstack_data.AddUniqueCallstack(kCallstackId, CallstackInfo{});
+  constexpr uint64_t kEventCount = 3000;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    callstack_data.AddCallstackEvent(MakeCallstackEvent(i, kTid, kCallstackId));
+  }
+
+  // Each sample needs at least its timestamp and its callstack id.
+  const uint64_t memory_usage_bytes = callstack_data.GetCallstackEventsMemoryUsageBytes();
+  EXPECT_GE(memory_usage_bytes, kEventCount * 2 * sizeof(uint64_t));
+  // Memory is allocated in chunks, so the overhead is bounded.
+  EXPECT_LE(memory_usage_bytes, 2 * kEventCount * 2 * sizeof(uint64_t));
+}
+
+// Logs the memory used by each sample and the latency of range queries over a capture of a few
+// million samples. Disabled by default as it doesn't check anything; run it with
+// --gtest_also_run_disabled_tests.
+TEST(CallstackData, DISABLED_RangeQueryBenchmark) {
+  constexpr int32_t kThreadCount = 16;
+  constexpr uint64_t kEventsPerThread = 250'000;
+  constexpr uint64_t kCallstackCount = 1000;
+  // One sample per thread every millisecond.
+  constexpr uint64_t kSamplingPeriodNs = 1'000'000;
+
+  CallstackData callstack_data;
+  for (uint64_t callstack_id = 0; callstack_id < kCallstackCount; ++callstack_id) {
+    callstack_data.AddUniqueCallstack(callstack_id, CallstackInfo{});
+  }
+  for (uint64_t i = 0; i < kEventsPerThread; ++i) {
+    for (int32_t tid = 0; tid < kThreadCount; ++tid) {
+      callstack_data.AddCallstackEvent(MakeCallstackEvent(
+          i * kSamplingPeriodNs + tid, tid, (i * kThreadCount + tid) % kCallstackCount));
+    }
+  }
+  constexpr uint64_t kEventCount = kThreadCount * kEventsPerThread;
+  ASSERT_EQ(callstack_data.GetCallstackEventsCount(), kEventCount);
+  LOG("%u samples: %.1f bytes per sample", kEventCount,
+      static_cast<double>(callstack_data.GetCallstackEventsMemoryUsageBytes()) / kEventCount);
+
+  constexpr uint64_t kQueryCount = 1000;
+  for (uint64_t range_ns : {1'000'000ULL, 100'000'000ULL, 10'000'000'000ULL}) {
+    uint64_t event_count = 0;
+    const absl::Time start = absl::Now();
+    for (uint64_t query = 0; query < kQueryCount; ++query) {
+      const uint64_t min_timestamp = query * (kEventsPerThread * kSamplingPeriodNs / kQueryCount);
+      callstack_data.ForEachCallstackEventInTimeRange(
+          min_timestamp, min_timestamp + range_ns,
+          [&event_count](const CallstackEvent& /*event*/) { ++event_count; });
+    }
+    const absl::Duration duration = absl::Now() - start;
+    LOG("Range of %u ns: %.1f us per query, %.1f ns per visited sample", range_ns,
+        absl::ToDoubleMicroseconds(duration) / kQueryCount,
+        absl::ToDoubleNanoseconds(duration) / std::max<uint64_t>(event_count, 1));
+  }
+}
+
 }  // namespace orbit_client_data
@@ -7,6 +7,7 @@
 #include <absl/container/flat_hash_map.h>
 
 #include <algorithm>
+#include <utility>
 
 #include "ClientData/FunctionUtils.h"
 #include "OrbitBase/Logging.h"
@@ -50,6 +51,7 @@ bool ModuleData::UpdateIfChangedAndUnload(ModuleInfo info) {
   LOG("Module %s contained symbols. Because the module changed, those are now removed.",
       file_path());
   functions_.clear();
+  function_index_.reset();
   hash_to_function_map_.clear();
   is_loaded_ = false;
 
@@ -81,7 +83,7 @@ const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionByOffset(uint64
 
 const FunctionInfo* ModuleData::FindFunctionByElfAddress(uint64_t elf_address,
                                                          bool is_exact) const {
-  absl::MutexLock lock(&mutex_);
+  absl::ReaderMutexLock lock(&mutex_);
   if (functions_.empty()) return nullptr;
 
   if (is_exact) {
@@ -108,6 +110,7 @@ void ModuleData::AddFunctionInfoWithBuildId(const FunctionInfo& function_info,
   auto value = std::make_unique<FunctionInfo>(function_info);
   value->set_module_build_id(module_build_id);
   functions_.insert_or_assign(function_info.address(), std::move(value));
+  function_index_.reset();
   is_loaded_ = true;
 }
 
@@ -154,6 +157,7 @@ void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbo
         name_reuse_counter);
   }
 
+  function_index_.reset();
   is_loaded_ = true;
 }
 
@@ -179,6 +183,19 @@ std::vector<const FunctionInfo*> ModuleData::GetFunctions() const {
   return result;
 }
 
+std::shared_ptr<const ModuleFunctionIndex> ModuleData::GetFunctionIndex() const {
+  absl::MutexLock lock(&mutex_);
+  if (function_index_ == nullptr) {
+    std::vector<std::shared_ptr<const FunctionInfo>> functions;
+    functions.reserve(functions_.size());
+    for (const auto& [_, function] : functions_) {
+      functions.push_back(function);
+    }
+    function_index_ = std::make_shared<const ModuleFunctionIndex>(std::move(functions));
+  }
+  return function_index_;
+}
+
 std::vector<FunctionInfo> ModuleData::GetOrbitFunctions() const {
   absl::MutexLock lock(&mutex_);
   CHECK(is_loaded_);
@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -161,6 +162,61 @@ TEST(ModuleData, FindFunctionByOffset) {
   }
 }
 
+TEST(ModuleData, GetFunctionIndex) {
+  ModuleSymbols symbols;
+  SymbolInfo* symbol = symbols.add_symbol_infos();
+  symbol->set_name("Name 1");
+  symbol->set_demangled_name("Pretty Name 1");
+  symbol->set_address(100);
+  symbol->set_size(10);
+
+  ModuleData module{ModuleInfo{}};
+  EXPECT_TRUE(module.GetFunctionIndex()->empty());
+
+  module.AddSymbols(symbols);
+  std::shared_ptr<const ModuleFunctionIndex> index = module.GetFunctionIndex();
+  EXPECT_EQ(index->size(), 1);
+  // The index is only rebuilt when the functions change.
+  EXPECT_EQ(module.GetFunctionIndex(), index);
+  EXPECT_EQ(index->FindFunctionByElfAddress(105, false),
+            module.FindFunctionByElfAddress(105, false));
+
+  FunctionInfo function_info;
+  function_info.set_name("Name 2");
+  function_info.set_address(200);
+  function_info.set_size(10);
+  module.AddFunctionInfoWithBuildId(function_info, "");
+  index = module.GetFunctionIndex();
+  EXPECT_EQ(index->size(), 2);
+  const FunctionInfo* result = index->FindFunctionByElfAddress(200, true);
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(result->name(), "Name 2");
+}
+
+TEST(ModuleData, FunctionIndexKeepsFunctionsAfterUnloading) {
+  ModuleSymbols symbols;
+  SymbolInfo* symbol = symbols.add_symbol_infos();
+  symbol->set_name("Name");
+  symbol->set_demangled_name("Pretty Name");
+  symbol->set_address(100);
+  symbol->set_size(10);
+
+  ModuleData module{ModuleInfo{}};
+  module.AddSymbols(symbols);
+  std::shared_ptr<const ModuleFunctionIndex> index = module.GetFunctionIndex();
+
+  ModuleInfo changed_module_info;
+  changed_module_info.set_file_size(1);
+  EXPECT_TRUE(module.UpdateIfChangedAndUnload(changed_module_info));
+  EXPECT_EQ(module.FindFunctionByElfAddress(105, false), nullptr);
+  EXPECT_TRUE(module.GetFunctionIndex()->empty());
+
+  const FunctionInfo* result = index->FindFunctionByElfAddress(105, false);
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(result->address(), 100);
+  EXPECT_EQ(result->pretty_name(), "Pretty Name");
+}
+
 TEST(ModuleData, FindFunctionFromHash) {
   ModuleSymbols symbols;
 
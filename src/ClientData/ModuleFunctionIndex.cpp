@@ -0,0 +1,40 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/ModuleFunctionIndex.h"
+
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::FunctionInfo;
+
+namespace orbit_client_data {
+
+ModuleFunctionIndex::ModuleFunctionIndex(std::vector<std::shared_ptr<const FunctionInfo>> functions)
+    : functions_(std::move(functions)) {
+  addresses_.reserve(functions_.size());
+  end_addresses_.reserve(functions_.size());
+  for (const std::shared_ptr<const FunctionInfo>& function : functions_) {
+    CHECK(addresses_.empty() || addresses_.back() < function->address());
+    addresses_.push_back(function->address());
+    end_addresses_.push_back(function->address() + function->size());
+  }
+}
+
+const FunctionInfo* ModuleFunctionIndex::FindFunctionByElfAddress(uint64_t elf_address,
+                                                                  bool is_exact) const {
+  const size_t index = FindLastLessOrEqual(addresses_, elf_address);
+  if (index == kIndexNotFound) return nullptr;
+
+  if (is_exact) {
+    return addresses_[index] == elf_address ? functions_[index].get() : nullptr;
+  }
+
+  if (end_addresses_[index] < elf_address) return nullptr;
+
+  return functions_[index].get();
+}
+
+}  // namespace orbit_client_data
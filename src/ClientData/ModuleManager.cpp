@@ -69,7 +69,7 @@ std::vector<ModuleData*> ModuleManager::AddOrUpdateNotLoadedModules(
 
 const ModuleData* ModuleManager::GetModuleByPathAndBuildId(const std::string& path,
                                                            const std::string& build_id) const {
-  absl::MutexLock lock(&mutex_);
+  absl::ReaderMutexLock lock(&mutex_);
 
   auto it = module_map_.find(std::make_pair(path, build_id));
   if (it == module_map_.end()) return nullptr;
@@ -125,7 +125,7 @@ void ProcessData::AddOrUpdateModuleInfo(const ModuleInfo& module_info) {
 }
 
 ErrorMessageOr<ModuleInMemory> ProcessData::FindModuleByAddress(uint64_t absolute_address) const {
-  absl::MutexLock lock(&mutex_);
+  absl::ReaderMutexLock lock(&mutex_);
   if (start_address_to_module_in_memory_.empty()) {
     return ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
                                         ": No modules loaded by process %s",
@@ -5,6 +5,8 @@
 #include "ClientData/TimerChain.h"
 
 #include <algorithm>
+#include <iterator>
+#include <limits>
 
 #include "ClientData/TextBox.h"
 #include "capture_data.pb.h"
@@ -13,6 +15,12 @@ bool orbit_client_data::TimerBlock::Intersects(uint64_t min, uint64_t max) const
   return (min <= max_timestamp_ && max >= min_timestamp_);
 }
 
+orbit_client_data::TimerChain::TimerChain() {
+  absl::MutexLock lock(&directory_mutex_);
+  blocks_.push_back(root_);
+  blocks_by_data_address_.emplace(root_->data_.data(), root_);
+}
+
 orbit_client_data::TimerChain::~TimerChain() {
   // Find last block in chain
   while (current_->next_ != nullptr) {
@@ -27,22 +35,84 @@ orbit_client_data::TimerChain::~TimerChain() {
   }
 }
 
+void orbit_client_data::TimerChain::AllocateNewBlock() {
+  CHECK(current_->next_ == nullptr);
+  auto* block = new orbit_client_data::TimerBlock(current_);
+  {
+    absl::MutexLock lock(&directory_mutex_);
+    const uint64_t max_end_before = completed_blocks_max_end_.empty()
+                                        ? std::numeric_limits<uint64_t>::min()
+                                        : completed_blocks_max_end_.back();
+    completed_blocks_max_end_.push_back(std::max(max_end_before, current_->max_timestamp_));
+    blocks_.push_back(block);
+    // The storage of a block is reserved on construction, so its address doesn't change.
+    blocks_by_data_address_.emplace(block->data_.data(), block);
+  }
+  current_->next_ = block;
+  current_ = block;
+  ++num_blocks_;
+}
+
 orbit_client_data::TimerBlock* orbit_client_data::TimerChain::GetBlockContaining(
     const orbit_client_data::TextBox* element) const {
-  orbit_client_data::TimerBlock* block = root_;
-  while (block != nullptr) {
-    uint32_t size = block->size();
-    if (size != 0) {
-      orbit_client_data::TextBox* begin = &block->data_[0];
-      orbit_client_data::TextBox* end = &block->data_[size - 1];
-      if (begin <= element && end >= element) {
-        return block;
+  absl::ReaderMutexLock lock(&directory_mutex_);
+  auto it = blocks_by_data_address_.upper_bound(element);
+  if (it == blocks_by_data_address_.begin()) return nullptr;
+
+  --it;
+  orbit_client_data::TimerBlock* block = it->second;
+  if (block->size() == 0 || element > &block->data_[block->size() - 1]) return nullptr;
+  return block;
+}
+
+std::vector<orbit_client_data::TimerBlock*> orbit_client_data::TimerChain::GetBlocksIntersecting(
+    uint64_t min, uint64_t max) const {
+  const bool is_sorted_by_start = is_sorted_by_start_;
+  absl::ReaderMutexLock lock(&directory_mutex_);
+  // All timers of the blocks before `first_block_index` end before `min`.
+  const size_t first_block_index =
+      std::lower_bound(completed_blocks_max_end_.begin(), completed_blocks_max_end_.end(), min) -
+      completed_blocks_max_end_.begin();
+
+  std::vector<orbit_client_data::TimerBlock*> result;
+  for (size_t i = first_block_index; i < blocks_.size(); ++i) {
+    orbit_client_data::TimerBlock* block = blocks_[i];
+    if (is_sorted_by_start && block->min_timestamp_ > max) break;
+    if (block->Intersects(min, max)) result.push_back(block);
+  }
+  return result;
+}
+
+orbit_client_data::TextBox* orbit_client_data::TimerChain::FindFirstStartingAfter(
+    uint64_t time) const {
+  if (!is_sorted_by_start_) {
+    for (orbit_client_data::TimerBlock* block = root_; block != nullptr; block = block->next_) {
+      for (size_t k = 0; k < block->size(); ++k) {
+        if (block->data_[k].GetTimerInfo().start() > time) return &block->data_[k];
       }
     }
-    block = block->next_;
+    return nullptr;
   }
 
-  return nullptr;
+  absl::ReaderMutexLock lock(&directory_mutex_);
+  // Find the first block with a first timer starting after `time`. The first timer starting after
+  // `time` is either in the block before it, or is its first timer.
+  auto next_block_it = std::upper_bound(
+      blocks_.begin(), blocks_.end(), time,
+      [](uint64_t timestamp, const orbit_client_data::TimerBlock* block) {
+        return block->size() == 0 || timestamp < block->data_[0].GetTimerInfo().start();
+      });
+  if (next_block_it != blocks_.begin()) {
+    orbit_client_data::TimerBlock* block = *std::prev(next_block_it);
+    auto text_box_it =
+        std::upper_bound(block->data_.begin(), block->data_.end(), time,
+                         [](uint64_t timestamp, const orbit_client_data::TextBox& text_box) {
+                           return timestamp < text_box.GetTimerInfo().start();
+                         });
+    if (text_box_it != block->data_.end()) return &*text_box_it;
+  }
+  if (next_block_it == blocks_.end() || (*next_block_it)->size() == 0) return nullptr;
+  return &(*next_block_it)->data_[0];
 }
 
 orbit_client_data::TextBox* orbit_client_data::TimerChain::GetElementAfter(
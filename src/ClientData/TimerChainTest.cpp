@@ -0,0 +1,179 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerChain.h"
+#include "OrbitBase/Logging.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace orbit_client_data {
+
+namespace {
+
+// More than one block.
+constexpr uint64_t kTimerCount = 3000;
+
+TextBox& AddTimer(TimerChain* chain, uint64_t start, uint64_t end) {
+  TimerInfo timer_info;
+  timer_info.set_start(start);
+  timer_info.set_end(end);
+  return chain->emplace_back(timer_info);
+}
+
+// Adds kTimerCount timers [10 * i, 10 * i + 5].
+void AddSortedTimers(TimerChain* chain) {
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    AddTimer(chain, 10 * i, 10 * i + 5);
+  }
+}
+
+std::vector<TimerBlock*> GetBlocksIntersectingByWalkingTheChain(TimerChain* chain, uint64_t min,
+                                                                uint64_t max) {
+  std::vector<TimerBlock*> result;
+  for (TimerBlock& block : *chain) {
+    if (block.Intersects(min, max)) result.push_back(&block);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(TimerChainTest, GetBlocksIntersectingMatchesWalkingTheChain) {
+  TimerChain chain;
+  AddSortedTimers(&chain);
+  ASSERT_EQ(GetBlocksIntersectingByWalkingTheChain(&chain, 0, 10 * kTimerCount).size(), 3);
+  EXPECT_TRUE(chain.IsSortedByStart());
+
+  for (auto [min, max] : std::vector<std::pair<uint64_t, uint64_t>>{
+           {0, 0}, {0, 100}, {10'000, 10'000}, {10'235, 20'481}, {29'995, 29'995}, {30'000, 40'000},
+           {0, 40'000}}) {
+    EXPECT_EQ(chain.GetBlocksIntersecting(min, max),
+              GetBlocksIntersectingByWalkingTheChain(&chain, min, max))
+        << min << " " << max;
+  }
+  EXPECT_TRUE(chain.GetBlocksIntersecting(30'000, 40'000).empty());
+}
+
+TEST(TimerChainTest, GetBlocksIntersectingWithUnsortedTimers) {
+  TimerChain chain;
+  AddSortedTimers(&chain);
+  // A long timer added last, but starting first.
+  AddTimer(&chain, 1, 100'000);
+  EXPECT_FALSE(chain.IsSortedByStart());
+
+  EXPECT_EQ(chain.GetBlocksIntersecting(5'000, 5'000),
+            GetBlocksIntersectingByWalkingTheChain(&chain, 5'000, 5'000));
+  EXPECT_EQ(chain.GetBlocksIntersecting(50'000, 60'000).size(), 1);
+}
+
+TEST(TimerChainTest, FindFirstStartingAfter) {
+  TimerChain chain;
+  EXPECT_EQ(chain.FindFirstStartingAfter(0), nullptr);
+
+  AddSortedTimers(&chain);
+  const TextBox* text_box = chain.FindFirstStartingAfter(0);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->GetTimerInfo().start(), 10);
+
+  // The first timer of the second block.
+  text_box = chain.FindFirstStartingAfter(10'235);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->GetTimerInfo().start(), 10'240);
+
+  text_box = chain.FindFirstStartingAfter(10'240);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->GetTimerInfo().start(), 10'250);
+
+  EXPECT_EQ(chain.FindFirstStartingAfter(10 * (kTimerCount - 1)), nullptr);
+}
+
+TEST(TimerChainTest, FindFirstStartingAfterWithUnsortedTimers) {
+  TimerChain chain;
+  AddTimer(&chain, 100, 200);
+  AddTimer(&chain, 50, 60);
+  AddTimer(&chain, 300, 400);
+  EXPECT_FALSE(chain.IsSortedByStart());
+
+  // The first in chain order, not the one with the earliest start.
+  const TextBox* text_box = chain.FindFirstStartingAfter(10);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->GetTimerInfo().start(), 100);
+
+  text_box = chain.FindFirstStartingAfter(100);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->GetTimerInfo().start(), 300);
+}
+
+TEST(TimerChainTest, GetElementBeforeAndAfterAcrossBlocks) {
+  TimerChain chain;
+  AddSortedTimers(&chain);
+
+  const TextBox* last_of_first_block = chain.FindFirstStartingAfter(10'225);
+  ASSERT_NE(last_of_first_block, nullptr);
+  ASSERT_EQ(last_of_first_block->GetTimerInfo().start(), 10'230);
+
+  const TextBox* first_of_second_block = chain.GetElementAfter(last_of_first_block);
+  ASSERT_NE(first_of_second_block, nullptr);
+  EXPECT_EQ(first_of_second_block->GetTimerInfo().start(), 10'240);
+  EXPECT_EQ(chain.GetElementBefore(first_of_second_block), last_of_first_block);
+
+  const TextBox* first = chain.FindFirstStartingAfter(0);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(chain.GetElementBefore(chain.GetElementBefore(first)), nullptr);
+
+  TextBox text_box_not_in_chain;
+  EXPECT_EQ(chain.GetElementAfter(&text_box_not_in_chain), nullptr);
+  EXPECT_EQ(chain.GetElementBefore(&text_box_not_in_chain), nullptr);
+}
+
+// Walks a chain of a million timers for range queries, as before, and then uses the directory, to
+// log how long both take. Run it with --gtest_also_run_disabled_tests.
+TEST(TimerChainTest, DISABLED_RangeQueryBenchmark) {
+  constexpr uint64_t kLongTimerCount = 1'000'000;
+  constexpr uint64_t kQueryCount = 1'000;
+  TimerChain chain;
+  for (uint64_t i = 0; i < kLongTimerCount; ++i) {
+    AddTimer(&chain, 10 * i, 10 * i + 5);
+  }
+
+  // Small ranges spread over the whole chain, like a zoomed-in view.
+  auto get_range = [](uint64_t query) {
+    const uint64_t min = query * (10 * kLongTimerCount / kQueryCount);
+    return std::make_pair(min, min + 10'000);
+  };
+
+  uint64_t walk_block_count = 0;
+  const absl::Time walk_start = absl::Now();
+  for (uint64_t query = 0; query < kQueryCount; ++query) {
+    auto [min, max] = get_range(query);
+    walk_block_count += GetBlocksIntersectingByWalkingTheChain(&chain, min, max).size();
+  }
+  const absl::Duration walk_duration = absl::Now() - walk_start;
+
+  uint64_t directory_block_count = 0;
+  const absl::Time directory_start = absl::Now();
+  for (uint64_t query = 0; query < kQueryCount; ++query) {
+    auto [min, max] = get_range(query);
+    directory_block_count += chain.GetBlocksIntersecting(min, max).size();
+  }
+  const absl::Duration directory_duration = absl::Now() - directory_start;
+
+  EXPECT_EQ(walk_block_count, directory_block_count);
+  LOG("%u timers, walking the chain: %.1f us per query, directory: %.1f us per query",
+      chain.size(), absl::ToDoubleMicroseconds(walk_duration) / kQueryCount,
+      absl::ToDoubleMicroseconds(directory_duration) / kQueryCount);
+}
+
+}  // namespace orbit_client_data
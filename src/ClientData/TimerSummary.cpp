@@ -0,0 +1,84 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/TimerSummary.h"
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+[[nodiscard]] uint32_t GetLevelShift(size_t level) {
+  return TimerSummary::kFinestLevelShift +
+         static_cast<uint32_t>(level) * TimerSummary::kLevelShiftStep;
+}
+
+[[nodiscard]] uint64_t GetBucketSizeNs(size_t level) { return uint64_t{1} << GetLevelShift(level); }
+
+[[nodiscard]] uint64_t GetBucket(const TextBox* text_box, uint32_t level_shift) {
+  return text_box->GetTimerInfo().start() >> level_shift;
+}
+
+[[nodiscard]] uint64_t GetDuration(const TextBox* text_box) {
+  return text_box->GetTimerInfo().end() - text_box->GetTimerInfo().start();
+}
+
+}  // namespace
+
+void TimerSummary::Add(TextBox* text_box) {
+  CHECK(text_box != nullptr);
+  absl::MutexLock lock(&mutex_);
+  for (size_t level = 0; level < kLevelCount; ++level) {
+    const uint32_t level_shift = GetLevelShift(level);
+    const uint64_t bucket = GetBucket(text_box, level_shift);
+    std::vector<TextBox*>& timers = levels_[level];
+
+    // Timers are mostly added in order of start, so the bucket is usually the last one.
+    auto it = timers.end();
+    while (it != timers.begin() && GetBucket(*(it - 1), level_shift) > bucket) --it;
+
+    if (it != timers.begin() && GetBucket(*(it - 1), level_shift) == bucket) {
+      // The longer timer of this bucket is also in the bucket of each coarser level, so `text_box`
+      // can't be the longest there either.
+      if (GetDuration(text_box) <= GetDuration(*(it - 1))) return;
+      *(it - 1) = text_box;
+    } else {
+      timers.insert(it, text_box);
+    }
+  }
+}
+
+bool TimerSummary::ForEachLongestTimerPerBucket(uint64_t max_bucket_size_ns,
+                                                uint64_t min_timestamp, uint64_t max_timestamp,
+                                                const std::function<void(TextBox*)>& action) const {
+  if (GetBucketSizeNs(0) > max_bucket_size_ns) return false;
+  size_t level = 0;
+  while (level + 1 < kLevelCount && GetBucketSizeNs(level + 1) <= max_bucket_size_ns) ++level;
+  const uint32_t level_shift = GetLevelShift(level);
+
+  absl::ReaderMutexLock lock(&mutex_);
+  const std::vector<TextBox*>& timers = levels_[level];
+  auto it = std::lower_bound(timers.begin(), timers.end(), min_timestamp >> level_shift,
+                             [level_shift](const TextBox* text_box, uint64_t bucket) {
+                               return GetBucket(text_box, level_shift) < bucket;
+                             });
+  if (it != timers.begin()) --it;
+
+  for (; it != timers.end() && (*it)->GetTimerInfo().start() <= max_timestamp; ++it) {
+    action(*it);
+  }
+  return true;
+}
+
+size_t TimerSummary::GetTimerCount(size_t level) const {
+  CHECK(level < kLevelCount);
+  absl::ReaderMutexLock lock(&mutex_);
+  return levels_[level].size();
+}
+
+}  // namespace orbit_client_data
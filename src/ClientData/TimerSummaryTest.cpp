@@ -0,0 +1,93 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+#include "ClientData/TimerSummary.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+using testing::ElementsAre;
+
+namespace orbit_client_data {
+
+namespace {
+
+constexpr uint64_t kFinestBucketSizeNs = uint64_t{1} << TimerSummary::kFinestLevelShift;
+
+class TimerSummaryTest : public ::testing::Test {
+ protected:
+  TextBox* AddTimer(uint64_t start, uint64_t end) {
+    TimerInfo timer_info;
+    timer_info.set_start(start);
+    timer_info.set_end(end);
+    TextBox* text_box = &text_boxes_.emplace_back(timer_info);
+    summary_.Add(text_box);
+    return text_box;
+  }
+
+  std::vector<TextBox*> GetTimers(uint64_t max_bucket_size_ns, uint64_t min_timestamp,
+                                  uint64_t max_timestamp) {
+    std::vector<TextBox*> timers;
+    EXPECT_TRUE(summary_.ForEachLongestTimerPerBucket(
+        max_bucket_size_ns, min_timestamp, max_timestamp,
+        [&timers](TextBox* text_box) { timers.push_back(text_box); }));
+    return timers;
+  }
+
+  // std::deque keeps the addresses of the TextBoxes stable, like TimerChain.
+  std::deque<TextBox> text_boxes_;
+  TimerSummary summary_;
+};
+
+}  // namespace
+
+TEST_F(TimerSummaryTest, KeepsLongestTimerPerBucket) {
+  AddTimer(0, 10);
+  TextBox* long_timer = AddTimer(100, 1000);
+  TextBox* other_bucket_timer = AddTimer(kFinestBucketSizeNs, kFinestBucketSizeNs + 10);
+  AddTimer(kFinestBucketSizeNs + 100, kFinestBucketSizeNs + 110);
+
+  EXPECT_EQ(summary_.GetTimerCount(0), 2);
+  EXPECT_EQ(summary_.GetTimerCount(1), 1);
+  EXPECT_THAT(GetTimers(kFinestBucketSizeNs, 0, 2 * kFinestBucketSizeNs),
+              ElementsAre(long_timer, other_bucket_timer));
+  EXPECT_THAT(GetTimers(4 * kFinestBucketSizeNs, 0, 2 * kFinestBucketSizeNs),
+              ElementsAre(long_timer));
+}
+
+TEST_F(TimerSummaryTest, TimersAddedOutOfOrderAreSorted) {
+  TextBox* third = AddTimer(3 * kFinestBucketSizeNs, 3 * kFinestBucketSizeNs + 1);
+  TextBox* first = AddTimer(kFinestBucketSizeNs, kFinestBucketSizeNs + 1);
+  TextBox* second = AddTimer(2 * kFinestBucketSizeNs, 2 * kFinestBucketSizeNs + 1);
+
+  EXPECT_THAT(GetTimers(kFinestBucketSizeNs, 0, 4 * kFinestBucketSizeNs),
+              ElementsAre(first, second, third));
+}
+
+TEST_F(TimerSummaryTest, IncludesBucketBeforeRange) {
+  TextBox* first = AddTimer(0, 10 * kFinestBucketSizeNs);
+  TextBox* second = AddTimer(10 * kFinestBucketSizeNs, 11 * kFinestBucketSizeNs);
+  AddTimer(20 * kFinestBucketSizeNs, 21 * kFinestBucketSizeNs);
+
+  // `first` starts before the range but ends in it.
+  EXPECT_THAT(GetTimers(kFinestBucketSizeNs, 5 * kFinestBucketSizeNs, 15 * kFinestBucketSizeNs),
+              ElementsAre(first, second));
+}
+
+TEST_F(TimerSummaryTest, NotUsableWhenBucketsAreTooLarge) {
+  AddTimer(0, 10);
+  bool called = false;
+  EXPECT_FALSE(summary_.ForEachLongestTimerPerBucket(kFinestBucketSizeNs - 1, 0, 100,
+                                                     [&called](TextBox*) { called = true; }));
+  EXPECT_FALSE(called);
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_ADDRESS_TO_FUNCTION_INDEX_H_
+#define CLIENT_DATA_ADDRESS_TO_FUNCTION_INDEX_H_
+
+#include <absl/types/span.h>
+#include <stdint.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "ClientData/ModuleFunctionIndex.h"
+#include "ClientData/ModuleManager.h"
+#include "ClientData/ProcessData.h"
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+// Immutable snapshot of the modules loaded by a process, combined with the function indices of
+// those modules (see ModuleFunctionIndex), to map absolute addresses to functions without going
+// through ProcessData and ModuleManager, and without locking. The module ranges are kept sorted in
+// separate arrays, like the functions in ModuleFunctionIndex.
+//
+// A new snapshot needs to be created when the modules of the process change or when symbols are
+// loaded or unloaded. The returned FunctionInfo pointers stay valid as long as the snapshot does,
+// as it shares the ownership of the functions (see ModuleFunctionIndex).
+class AddressToFunctionIndex {
+ public:
+  AddressToFunctionIndex() = default;
+  // Only the modules of `process` with functions in `module_manager` are indexed.
+  explicit AddressToFunctionIndex(const ProcessData& process, const ModuleManager& module_manager);
+
+  [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByAddress(
+      uint64_t absolute_address, bool is_exact) const;
+
+  // Returns the absolute address of the function containing `absolute_address`.
+  [[nodiscard]] std::optional<uint64_t> FindFunctionAbsoluteAddressByAddress(
+      uint64_t absolute_address) const;
+
+  // Looks up all of `absolute_addresses` (e.g. the frames of a callstack) at once, with the same
+  // semantics as FindFunctionByAddress(address, /*is_exact=*/false). For each address,
+  // `functions` receives the function or nullptr, and `function_absolute_addresses` the absolute
+  // address of that function or 0. Consecutive addresses in the same module only search that
+  // module's functions.
+  void FindFunctionsByAddresses(absl::Span<const uint64_t> absolute_addresses,
+                                absl::Span<const orbit_client_protos::FunctionInfo*> functions,
+                                absl::Span<uint64_t> function_absolute_addresses) const;
+
+  [[nodiscard]] size_t module_count() const { return module_starts_.size(); }
+
+ private:
+  [[nodiscard]] size_t FindModuleIndex(uint64_t absolute_address) const;
+  [[nodiscard]] bool ModuleContains(size_t module_index, uint64_t absolute_address) const {
+    return absolute_address >= module_starts_[module_index] &&
+           absolute_address < module_ends_[module_index];
+  }
+
+  std::vector<uint64_t> module_starts_;
+  std::vector<uint64_t> module_ends_;
+  // Absolute address of ELF address 0, i.e. start - executable_segment_offset - load_bias. The
+  // arithmetic wraps around, which is fine as it's only used for additions and subtractions.
+  std::vector<uint64_t> module_elf_bases_;
+  std::vector<std::shared_ptr<const ModuleFunctionIndex>> module_function_indices_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_ADDRESS_TO_FUNCTION_INDEX_H_
@@ -5,13 +5,16 @@
 #ifndef CLIENT_DATA_CALLSTACK_DATA_H_
 #define CLIENT_DATA_CALLSTACK_DATA_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include <functional>
 #include <limits>
-#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <vector>
 
 #include "CallstackTypes.h"
@@ -20,6 +23,11 @@
 
 namespace orbit_client_data {
 
+// CallstackEvents are stored per thread, sorted by timestamp, in columns (timestamps and callstack
+// ids) split into fixed-size chunks. Chunks are never modified after they have been handed to a
+// reader, except for the slots past the last event, so that readers only hold the mutex long
+// enough to find the chunks covering their time range, and call the actions of the ForEach...
+// methods without holding any lock.
 class CallstackData {
  public:
   explicit CallstackData() = default;
@@ -38,14 +46,12 @@ class CallstackData {
   void AddCallstackFromKnownCallstackData(const orbit_client_protos::CallstackEvent& event,
                                           const CallstackData* known_callstack_data);
 
-  [[nodiscard]] const absl::flat_hash_map<int32_t,
-                                          std::map<uint64_t, orbit_client_protos::CallstackEvent>>&
-  callstack_events_by_tid() const {
-    return callstack_events_by_tid_;
-  }
-
   [[nodiscard]] uint32_t GetCallstackEventsCount() const;
 
+  // Approximate number of bytes used to store the callstack events, computed from the capacities of
+  // the containers that hold them (not including the allocator's own overhead).
+  [[nodiscard]] uint64_t GetCallstackEventsMemoryUsageBytes() const;
+
   [[nodiscard]] std::vector<orbit_client_protos::CallstackEvent> GetCallstackEventsInTimeRange(
       uint64_t time_begin, uint64_t time_end) const;
 
@@ -68,12 +74,12 @@ class CallstackData {
       const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const;
 
   [[nodiscard]] uint64_t max_time() const {
-    std::lock_guard lock(mutex_);
+    absl::ReaderMutexLock lock(&callstack_events_mutex_);
     return max_time_;
   }
 
   [[nodiscard]] uint64_t min_time() const {
-    std::lock_guard lock(mutex_);
+    absl::ReaderMutexLock lock(&callstack_events_mutex_);
     return min_time_;
   }
 
@@ -98,21 +104,63 @@ class CallstackData {
   void UpdateCallstackTypeBasedOnMajorityStart();
 
  private:
+  struct CallstackEventChunk {
+    // 16 KB per chunk.
+    static constexpr size_t kCapacity = 1024;
+    uint64_t timestamps_ns[kCapacity];
+    uint64_t callstack_ids[kCapacity];
+  };
+
+  struct ThreadCallstackEvents {
+    std::vector<std::shared_ptr<CallstackEventChunk>> chunks;
+    size_t size = 0;
+  };
+
+  // The events [begin, end) of a chunk, kept alive even if the chunk is replaced in the meantime.
+  struct CallstackEventChunkRange {
+    std::shared_ptr<const CallstackEventChunk> chunk;
+    size_t begin;
+    size_t end;
+  };
+
+  struct ThreadCallstackEventChunkRanges {
+    int32_t thread_id;
+    std::vector<CallstackEventChunkRange> chunk_ranges;
+  };
+
   [[nodiscard]] std::shared_ptr<orbit_client_protos::CallstackInfo> GetCallstackPtr(
       uint64_t callstack_id) const;
 
-  void RegisterTime(uint64_t time);
+  void AddCallstackEventLocked(int32_t thread_id, uint64_t timestamp_ns, uint64_t callstack_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(callstack_events_mutex_);
+  void RegisterTime(uint64_t time) ABSL_EXCLUSIVE_LOCKS_REQUIRED(callstack_events_mutex_);
+
+  // Returns the chunk ranges holding the events of `thread_events` with a timestamp in
+  // [min_timestamp, max_timestamp].
+  [[nodiscard]] static std::vector<CallstackEventChunkRange> GetChunkRangesInTimeRange(
+      const ThreadCallstackEvents& thread_events, uint64_t min_timestamp, uint64_t max_timestamp);
+  // If `thread_id` is empty, the ranges of all threads are returned.
+  [[nodiscard]] std::vector<ThreadCallstackEventChunkRanges> GetChunkRangesInTimeRange(
+      std::optional<int32_t> thread_id, uint64_t min_timestamp, uint64_t max_timestamp) const
+      ABSL_LOCKS_EXCLUDED(callstack_events_mutex_);
+  static void ForEachCallstackEventInChunkRanges(
+      const std::vector<ThreadCallstackEventChunkRanges>& thread_chunk_ranges,
+      const std::function<void(const orbit_client_protos::CallstackEvent&)>& action);
 
   // Use a reentrant mutex so that calls to the ForEach... methods can be nested.
-  // E.g., one might want to nest ForEachCallstackEvent and ForEachFrameInCallstack.
+  // E.g., one might want to nest ForEachUniqueCallstack and ForEachFrameInCallstack.
   mutable std::recursive_mutex mutex_;
   absl::flat_hash_map<uint64_t, std::shared_ptr<orbit_client_protos::CallstackInfo>>
       unique_callstacks_;
-  absl::flat_hash_map<int32_t, std::map<uint64_t, orbit_client_protos::CallstackEvent>>
-      callstack_events_by_tid_;
 
-  uint64_t max_time_ = 0;
-  uint64_t min_time_ = std::numeric_limits<uint64_t>::max();
+  // Always acquired after mutex_, if both are needed.
+  mutable absl::Mutex callstack_events_mutex_;
+  absl::flat_hash_map<int32_t, ThreadCallstackEvents> callstack_events_by_tid_
+      ABSL_GUARDED_BY(callstack_events_mutex_);
+
+  uint64_t max_time_ ABSL_GUARDED_BY(callstack_events_mutex_) = 0;
+  uint64_t min_time_ ABSL_GUARDED_BY(callstack_events_mutex_) =
+      std::numeric_limits<uint64_t>::max();
 };
 
 }  // namespace orbit_client_data
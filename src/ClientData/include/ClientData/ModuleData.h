@@ -13,6 +13,7 @@
 #include <utility>
 #include <vector>
 
+#include "ClientData/ModuleFunctionIndex.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
@@ -57,6 +58,9 @@ class ModuleData final {
       std::string_view pretty_name) const;
   [[nodiscard]] std::vector<const orbit_client_protos::FunctionInfo*> GetFunctions() const;
   [[nodiscard]] std::vector<orbit_client_protos::FunctionInfo> GetOrbitFunctions() const;
+  // Returns a frozen snapshot of the functions of this module, built on first use after the
+  // functions changed. Lookups in the snapshot don't take the mutex of this ModuleData.
+  [[nodiscard]] std::shared_ptr<const ModuleFunctionIndex> GetFunctionIndex() const;
 
  private:
   [[nodiscard]] bool NeedsUpdate(const orbit_grpc_protos::ModuleInfo& info) const;
@@ -64,7 +68,9 @@ class ModuleData final {
   mutable absl::Mutex mutex_;
   orbit_grpc_protos::ModuleInfo module_info_;
   bool is_loaded_;
-  std::map<uint64_t, std::unique_ptr<orbit_client_protos::FunctionInfo>> functions_;
+  // Shared with the function index, so that its functions outlive unloading the symbols.
+  std::map<uint64_t, std::shared_ptr<orbit_client_protos::FunctionInfo>> functions_;
+  mutable std::shared_ptr<const ModuleFunctionIndex> function_index_;
   absl::flat_hash_map<std::string_view, orbit_client_protos::FunctionInfo*>
       name_to_function_info_map_;
 
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_MODULE_FUNCTION_INDEX_H_
+#define CLIENT_DATA_MODULE_FUNCTION_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "capture_data.pb.h"
+
+namespace orbit_client_data {
+
+constexpr size_t kIndexNotFound = static_cast<size_t>(-1);
+
+// Returns the index of the last element of `sorted_values` that is less than or equal to `value`,
+// or kIndexNotFound. Unlike with std::upper_bound, the loop has no data-dependent branch, so
+// lookups of unrelated addresses don't stall on branch mispredictions.
+[[nodiscard]] inline size_t FindLastLessOrEqual(const std::vector<uint64_t>& sorted_values,
+                                                uint64_t value) {
+  if (sorted_values.empty() || sorted_values[0] > value) return kIndexNotFound;
+  const uint64_t* base = sorted_values.data();
+  size_t count = sorted_values.size();
+  while (count > 1) {
+    const size_t half = count / 2;
+    base = base[half] <= value ? base + half : base;
+    count -= half;
+  }
+  return base - sorted_values.data();
+}
+
+// Immutable index of the functions of a module, sorted by ELF address. The addresses, the end
+// addresses and the FunctionInfo pointers are kept in separate arrays, so that a binary search only
+// touches the contiguous array of addresses, and an instance can be read from any thread without
+// locking.
+//
+// The index shares the ownership of the FunctionInfos with the ModuleData that created it (see
+// ModuleData::GetFunctionIndex). The functions it returns stay valid as long as the index does,
+// even if the ModuleData unloads its symbols in the meantime.
+class ModuleFunctionIndex {
+ public:
+  // `functions` must be sorted by address, without duplicated addresses.
+  explicit ModuleFunctionIndex(
+      std::vector<std::shared_ptr<const orbit_client_protos::FunctionInfo>> functions);
+
+  // Same semantics as ModuleData::FindFunctionByElfAddress.
+  [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByElfAddress(
+      uint64_t elf_address, bool is_exact) const;
+
+  [[nodiscard]] size_t size() const { return addresses_.size(); }
+  [[nodiscard]] bool empty() const { return addresses_.empty(); }
+
+ private:
+  std::vector<uint64_t> addresses_;
+  std::vector<uint64_t> end_addresses_;
+  std::vector<std::shared_ptr<const orbit_client_protos::FunctionInfo>> functions_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_MODULE_FUNCTION_INDEX_H_
@@ -5,11 +5,15 @@
 #ifndef CLIENT_DATA_TIMER_CHAIN_H_
 #define CLIENT_DATA_TIMER_CHAIN_H_
 
+#include <absl/container/btree_map.h>
+#include <absl/synchronization/mutex.h>
+
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <iosfwd>
 #include <limits>
+#include <vector>
 
 #include "ClientData/TextBox.h"
 #include "OrbitBase/Logging.h"
@@ -97,8 +101,14 @@ class TimerChainIterator {
 // is a difference compared with BlockChain in how the iterators work: Here,
 // the iterator runs over blocks, in BlockChain the iterator runs over the
 // individually stored elements.
+//
+// In addition to the linked list, the chain keeps a directory of its blocks, so that range and
+// neighbour queries don't need to walk the chain from the start. Timers are usually added in order
+// of start (e.g., the timers of one depth of a track): then, the queries by time are binary
+// searches over the directory and within a block.
 class TimerChain {
  public:
+  TimerChain();
   ~TimerChain();
 
   // Append an item to the end of the current block. If capacity of the current block is reached, a
@@ -107,6 +117,9 @@ class TimerChain {
   TextBox& emplace_back(Args&&... args) {
     if (current_->at_capacity()) AllocateNewBlock();
     TextBox& text_box = current_->emplace_back(std::forward<Args>(args)...);
+    const uint64_t start = text_box.GetTimerInfo().start();
+    if (start < last_start_) is_sorted_by_start_ = false;
+    last_start_ = start;
     ++num_items_;
     return text_box;
   }
@@ -120,22 +133,40 @@ class TimerChain {
 
   [[nodiscard]] TextBox* GetElementBefore(const TextBox* element) const;
 
+  // Returns the blocks for which TimerBlock::Intersects(min, max) is true, in chain order. The
+  // blocks before the first one containing a timer that ends at or after `min` are skipped with a
+  // binary search. If timers were added in order of start, the search also stops at the first
+  // block starting after `max`.
+  [[nodiscard]] std::vector<TimerBlock*> GetBlocksIntersecting(uint64_t min, uint64_t max) const;
+
+  // Returns the first timer, in chain order, that starts after `time`, or nullptr.
+  [[nodiscard]] TextBox* FindFirstStartingAfter(uint64_t time) const;
+
+  [[nodiscard]] bool IsSortedByStart() const { return is_sorted_by_start_; }
+
   [[nodiscard]] TimerChainIterator begin() { return TimerChainIterator(root_); }
 
   [[nodiscard]] TimerChainIterator end() { return TimerChainIterator(nullptr); }
 
  private:
-  void AllocateNewBlock() {
-    CHECK(current_->next_ == nullptr);
-    current_->next_ = new TimerBlock(current_);
-    current_ = current_->next_;
-    ++num_blocks_;
-  }
+  void AllocateNewBlock();
 
   TimerBlock* root_ = new TimerBlock(/*prev=*/nullptr);
   TimerBlock* current_ = root_;
   uint64_t num_blocks_ = 1;
   uint64_t num_items_ = 0;
+  uint64_t last_start_ = 0;
+  std::atomic<bool> is_sorted_by_start_ = true;
+
+  // The directory only changes when a block is allocated. The timestamps of the current block keep
+  // changing, so they are read from the block itself.
+  mutable absl::Mutex directory_mutex_;
+  std::vector<TimerBlock*> blocks_ ABSL_GUARDED_BY(directory_mutex_);
+  // Maximum end timestamp of the timers of blocks_[0], ..., blocks_[i], for all blocks but the
+  // current one.
+  std::vector<uint64_t> completed_blocks_max_end_ ABSL_GUARDED_BY(directory_mutex_);
+  absl::btree_map<const TextBox*, TimerBlock*> blocks_by_data_address_
+      ABSL_GUARDED_BY(directory_mutex_);
 };
 }  // namespace orbit_client_data
 
@@ -0,0 +1,57 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_TIMER_SUMMARY_H_
+#define CLIENT_DATA_TIMER_SUMMARY_H_
+
+#include <absl/synchronization/mutex.h>
+#include <stdint.h>
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "ClientData/TextBox.h"
+
+namespace orbit_client_data {
+
+// Multi-resolution summary of the timers of one depth of a track, used to draw the track zoomed out
+// with a cost proportional to the number of pixels rather than to the number of timers.
+//
+// Each level splits the time into buckets of a power-of-two number of nanoseconds, and keeps the
+// longest timer starting in each non-empty bucket, sorted by start. When a bucket is narrower than
+// a pixel, the other timers starting in the bucket can only be drawn as lines in the same pixel,
+// as timers of the same depth don't overlap. The summary is updated incrementally as timers are
+// added, which is cheap when they are added in order of start.
+//
+// The summary doesn't own the TextBoxes (see TimerChain). It can be read and updated from
+// different threads.
+class TimerSummary {
+ public:
+  // The buckets of the finest level span 2^16 ns (about 65 us), each following level has buckets
+  // four times larger, up to 2^38 ns (about 4.6 min).
+  static constexpr uint32_t kFinestLevelShift = 16;
+  static constexpr uint32_t kLevelShiftStep = 2;
+  static constexpr size_t kLevelCount = 12;
+
+  void Add(TextBox* text_box);
+
+  // Calls `action`, in order of start, on the longest timer starting in each bucket that intersects
+  // [min_timestamp, max_timestamp] and in the bucket before, as its timer can extend into the
+  // range. The coarsest level with buckets not larger than `max_bucket_size_ns` is used. Returns
+  // false without calling `action` if even the buckets of the finest level are larger.
+  bool ForEachLongestTimerPerBucket(uint64_t max_bucket_size_ns, uint64_t min_timestamp,
+                                    uint64_t max_timestamp,
+                                    const std::function<void(TextBox*)>& action) const;
+
+  [[nodiscard]] size_t GetTimerCount(size_t level) const;
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::array<std::vector<TextBox*>, kLevelCount> levels_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_TIMER_SUMMARY_H_
@@ -7,6 +7,7 @@
 #include <absl/container/flat_hash_map.h>
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <outcome.hpp>
 #include <vector>
@@ -14,6 +15,7 @@
 #include "ClientData/FunctionUtils.h"
 #include "ClientData/ModuleData.h"
 
+using orbit_client_data::AddressToFunctionIndex;
 using orbit_client_data::CallstackData;
 using orbit_client_data::ModuleData;
 using orbit_client_data::TracepointData;
@@ -195,23 +197,23 @@ CaptureData::FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingAddress
 std::optional<uint64_t>
 CaptureData::FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingModulesInMemory(
     uint64_t absolute_address) const {
-  const auto module_or_error = process_.FindModuleByAddress(absolute_address);
-  if (module_or_error.has_error()) return std::nullopt;
-  const std::string& module_path = module_or_error.value().file_path();
-  const std::string& module_build_id = module_or_error.value().build_id();
-  const uint64_t module_base_address = module_or_error.value().start();
-
-  const ModuleData* module =
-      module_manager_->GetModuleByPathAndBuildId(module_path, module_build_id);
-  if (module == nullptr) return std::nullopt;
-
-  const uint64_t offset =
-      absolute_address - module_base_address + module->executable_segment_offset();
-  const auto* function_info = module->FindFunctionByOffset(offset, false);
-  if (function_info == nullptr) return std::nullopt;
-
-  return module_base_address - module->load_bias() - module->executable_segment_offset() +
-         function_info->address();
+  return GetAddressToFunctionIndex()->FindFunctionAbsoluteAddressByAddress(absolute_address);
+}
+
+void CaptureData::FindFunctionAbsoluteAddressesByInstructionAbsoluteAddresses(
+    absl::Span<const uint64_t> absolute_addresses, absl::Span<uint64_t> function_addresses) const {
+  CHECK(function_addresses.size() == absolute_addresses.size());
+  std::vector<const FunctionInfo*> functions(absolute_addresses.size());
+  GetAddressToFunctionIndex()->FindFunctionsByAddresses(absolute_addresses,
+                                                        absl::MakeSpan(functions),
+                                                        function_addresses);
+  for (size_t i = 0; i < absolute_addresses.size(); ++i) {
+    if (functions[i] != nullptr) continue;
+    function_addresses[i] =
+        FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingAddressInfo(
+            absolute_addresses[i])
+            .value_or(absolute_addresses[i]);
+  }
 }
 
 const FunctionInfo* CaptureData::FindFunctionByModulePathBuildIdAndOffset(
@@ -254,20 +256,12 @@ const std::string& CaptureData::GetModulePathByAddress(uint64_t absolute_address
 
 const FunctionInfo* CaptureData::FindFunctionByAddress(uint64_t absolute_address,
                                                        bool is_exact) const {
-  const auto module_or_error = process_.FindModuleByAddress(absolute_address);
-  if (module_or_error.has_error()) return nullptr;
-  const auto& module_in_memory = module_or_error.value();
-  const std::string& module_path = module_in_memory.file_path();
-  const std::string& module_build_id = module_in_memory.build_id();
-  const uint64_t module_base_address = module_in_memory.start();
-
-  const ModuleData* module =
-      module_manager_->GetModuleByPathAndBuildId(module_path, module_build_id);
-  if (module == nullptr) return nullptr;
-
-  const uint64_t offset =
-      absolute_address - module_base_address + module->executable_segment_offset();
-  return module->FindFunctionByOffset(offset, is_exact);
+  return GetAddressToFunctionIndex()->FindFunctionByAddress(absolute_address, is_exact);
+}
+
+void CaptureData::UpdateAddressToFunctionIndex() {
+  std::atomic_store(&address_to_function_index_,
+                    std::make_shared<const AddressToFunctionIndex>(process_, *module_manager_));
 }
 
 [[nodiscard]] ModuleData* CaptureData::FindModuleByAddress(uint64_t absolute_address) const {
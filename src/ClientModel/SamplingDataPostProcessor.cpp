@@ -5,9 +5,12 @@
 #include "ClientModel/SamplingDataPostProcessor.h"
 
 #include <absl/hash/hash.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <string>
@@ -15,8 +18,10 @@
 #include <vector>
 
 #include "ClientData/CallstackTypes.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "capture_data.pb.h"
@@ -57,7 +62,7 @@ using CallstackInfoAsPairWithLvalueRefToFrames =
     std::pair<const std::vector<uint64_t>&, CallstackInfo::CallstackType>;
 
 // CallstackInfoHash and CallstackInfoEq allow heterogeneous lookup in
-// SamplingDataPostProcessor::resolved_callstack_to_id_;
+// PostProcessedSamplingDataBuilder::resolved_callstack_to_id_;
 struct CallstackInfoHash {
   using is_transparent = void;  // Makes this functor transparent, enabling heterogeneous lookup.
 
@@ -87,28 +92,89 @@ struct CallstackInfoEq {
   }
 };
 
-class SamplingDataPostProcessor {
- public:
-  explicit SamplingDataPostProcessor() = default;
-  SamplingDataPostProcessor& operator=(const SamplingDataPostProcessor& other) = default;
-  SamplingDataPostProcessor(const SamplingDataPostProcessor& other) = default;
+using CallstackCountsPerThread =
+    absl::flat_hash_map<ThreadID, absl::flat_hash_map<uint64_t, uint32_t>>;
+using UniqueCallstacks = absl::flat_hash_map<uint64_t, std::shared_ptr<CallstackInfo>>;
+using ResolvedFramesPerCallstack = absl::flat_hash_map<uint64_t, std::vector<uint64_t>>;
+
+// The callstacks of a thread are split in shards of at most this size, so that the work is
+// balanced between the threads of the thread pool even if most samples come from a single thread
+// (or from all threads, for the summary).
+constexpr size_t kCallstacksPerShard = 1024;
+// Same for the addresses to resolve.
+constexpr size_t kAddressesPerShard = 4096;
+
+// Calls `task(index)` for each index in [0, task_count), in parallel on `thread_pool` if it isn't
+// nullptr, and waits for all the calls to complete. The calling thread runs one of the tasks.
+void ParallelFor(ThreadPool* thread_pool, size_t task_count,
+                 const std::function<void(size_t)>& task) {
+  if (thread_pool == nullptr || task_count <= 1) {
+    for (size_t index = 0; index < task_count; ++index) {
+      task(index);
+    }
+    return;
+  }
+
+  std::vector<orbit_base::Future<void>> futures;
+  futures.reserve(task_count - 1);
+  for (size_t index = 1; index < task_count; ++index) {
+    futures.push_back(thread_pool->Schedule([&task, index] { task(index); }));
+  }
+  task(0);
+  for (const orbit_base::Future<void>& future : futures) {
+    future.Wait();
+  }
+}
 
-  SamplingDataPostProcessor(SamplingDataPostProcessor&& other) = default;
-  SamplingDataPostProcessor& operator=(SamplingDataPostProcessor&& other) = default;
+template <typename Map>
+void AddCounts(const Map& counts, Map* total_counts) {
+  for (const auto& [key, count] : counts) {
+    (*total_counts)[key] += count;
+  }
+}
 
-  PostProcessedSamplingData ProcessSamples(const CallstackData& callstack_data,
-                                           const CaptureData& capture_data, bool generate_summary);
+// Creates a PostProcessedSamplingData from the number of samples of each callstack per thread.
+// If `thread_pool` isn't nullptr, the addresses are resolved, and the samples aggregated, in
+// parallel on its threads. Only the callstacks missing from `resolved_frames_per_callstack` are
+// resolved, and they are added to it.
+class PostProcessedSamplingDataBuilder {
+ public:
+  PostProcessedSamplingDataBuilder(ThreadPool* thread_pool,
+                                   ResolvedFramesPerCallstack* resolved_frames_per_callstack)
+      : thread_pool_{thread_pool}, resolved_frames_per_callstack_{resolved_frames_per_callstack} {}
+
+  PostProcessedSamplingData Build(const CallstackCountsPerThread& callstack_counts_per_thread,
+                                  const CallstackData& callstack_data,
+                                  const CaptureData& capture_data);
 
  private:
+  // The samples of `callstack_counts` (a subset of the callstacks of a thread) aggregated in
+  // `sample_data`, to be merged with the other shards of the same thread.
+  struct Shard {
+    std::vector<std::pair<uint64_t, uint32_t>> callstack_counts;
+    ThreadSampleData sample_data;
+  };
+
   void SortByThreadUsage();
 
   void ResolveCallstacks(const CallstackData& callstack_data, const CaptureData& capture_data);
 
-  void MapAddressToFunctionAddress(uint64_t absolute_address, const CaptureData& capture_data);
+  void MapAddressesToFunctionAddresses(const CallstackData& callstack_data,
+                                       const CaptureData& capture_data);
+
+  void AggregateShard(const UniqueCallstacks& unique_callstacks, Shard* shard) const;
+
+  static void MergeShards(std::vector<Shard>::iterator shards_begin,
+                          std::vector<Shard>::iterator shards_end,
+                          ThreadSampleData* thread_sample_data);
+
+  static void FillThreadSampleDataSampleReport(const CaptureData& capture_data,
+                                               ThreadSampleData* thread_sample_data);
 
-  void FillThreadSampleDataSampleReports(const CaptureData& capture_data);
+  ThreadPool* thread_pool_;
+  ResolvedFramesPerCallstack* resolved_frames_per_callstack_;
 
-  // Filled by ProcessSamples.
+  // Filled by Build.
   absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data_;
   absl::flat_hash_map<uint64_t, CallstackInfo> id_to_resolved_callstack_;
   absl::flat_hash_map<CallstackInfoAsClass, uint64_t, CallstackInfoHash, CallstackInfoEq>
@@ -116,107 +182,117 @@ class SamplingDataPostProcessor {
   absl::flat_hash_map<uint64_t, uint64_t> original_id_to_resolved_callstack_id_;
   absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>>
       function_address_to_sampled_callstack_ids_;
+  // Only read once filled, so it can be shared by the tasks running on the thread pool.
   absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
   std::vector<ThreadSampleData> sorted_thread_sample_data_;
 };
 
 }  // namespace
 
-PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& callstack_data,
-                                                          const CaptureData& capture_data,
-                                                          bool generate_summary) {
-  return SamplingDataPostProcessor{}.ProcessSamples(callstack_data, capture_data, generate_summary);
+void SamplingDataPostProcessor::AddCallstackEvent(const CallstackEvent& event) {
+  absl::MutexLock lock{&mutex_};
+  thread_id_to_callstack_id_to_count_[event.thread_id()][event.callstack_id()]++;
+  if (!generate_summary_) {
+    return;
+  }
+  thread_id_to_callstack_id_to_count_[orbit_base::kAllProcessThreadsTid][event.callstack_id()]++;
 }
 
-namespace {
-PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(
-    const CallstackData& callstack_data, const CaptureData& capture_data, bool generate_summary) {
-  // Unique call stacks and per thread data
-  callstack_data.ForEachCallstackEvent(
-      [this, &callstack_data, generate_summary](const CallstackEvent& event) {
-        CHECK(callstack_data.HasCallstack(event.callstack_id()));
-        const orbit_client_protos::CallstackInfo* callstack_info =
-            callstack_data.GetCallstack(event.callstack_id());
-
-        // For non-kComplete callstacks, only use the innermost frame for statistics, as it's the
-        // only one known to be correct. Note that, in the vast majority of cases, the innermost
-        // frame is also the only one available.
-        absl::flat_hash_set<uint64_t> unique_frames;
-        CHECK(!callstack_info->frames().empty());
-        if (callstack_info->type() == CallstackInfo::kComplete) {
-          for (uint64_t frame : callstack_info->frames()) {
-            unique_frames.insert(frame);
-          }
-        } else {
-          unique_frames.insert(callstack_info->frames(0));
-        }
-
-        ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[event.thread_id()];
-        thread_sample_data->samples_count++;
-        thread_sample_data->sampled_callstack_id_to_count[event.callstack_id()]++;
-        for (uint64_t frame : unique_frames) {
-          thread_sample_data->sampled_address_to_count[frame]++;
-        }
-
-        if (!generate_summary) {
-          return;
-        }
-        ThreadSampleData* all_thread_sample_data =
-            &thread_id_to_sample_data_[orbit_base::kAllProcessThreadsTid];
-        all_thread_sample_data->samples_count++;
-        all_thread_sample_data->sampled_callstack_id_to_count[event.callstack_id()]++;
-        for (uint64_t frame : unique_frames) {
-          all_thread_sample_data->sampled_address_to_count[frame]++;
-        }
-      });
-
-  ResolveCallstacks(callstack_data, capture_data);
+PostProcessedSamplingData SamplingDataPostProcessor::CreatePostProcessedSamplingData(
+    const CallstackData& callstack_data, const CaptureData& capture_data,
+    ThreadPool* thread_pool) {
+  absl::MutexLock lock{&mutex_};
+  return PostProcessedSamplingDataBuilder{thread_pool, &callstack_id_to_resolved_frames_}.Build(
+      thread_id_to_callstack_id_to_count_, callstack_data, capture_data);
+}
 
-  for (auto& sample_data_it : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &sample_data_it.second;
+void SamplingDataPostProcessor::InvalidateResolvedCallstacks() {
+  absl::MutexLock lock{&mutex_};
+  callstack_id_to_resolved_frames_.clear();
+}
 
-    // Address count per sample per thread
-    for (const auto& [sampled_callstack_id, callstack_count] :
-         thread_sample_data->sampled_callstack_id_to_count) {
-      uint64_t resolved_callstack_id = original_id_to_resolved_callstack_id_[sampled_callstack_id];
-      const CallstackInfo& resolved_callstack = id_to_resolved_callstack_[resolved_callstack_id];
-
-      // "Exclusive" stat.
-      CHECK(!resolved_callstack.frames().empty());
-      thread_sample_data->resolved_address_to_exclusive_count[resolved_callstack.frames(0)] +=
-          callstack_count;
+PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& callstack_data,
+                                                          const CaptureData& capture_data,
+                                                          bool generate_summary,
+                                                          ThreadPool* thread_pool) {
+  // Count the samples of each thread in parallel.
+  std::vector<ThreadID> thread_ids;
+  for (const auto& [thread_id, unused_count] : callstack_data.GetCallstackEventsCountsPerTid()) {
+    thread_ids.push_back(thread_id);
+  }
+  std::vector<absl::flat_hash_map<uint64_t, uint32_t>> callstack_id_to_count_per_thread(
+      thread_ids.size());
+  ParallelFor(thread_pool, thread_ids.size(),
+              [&callstack_data, &thread_ids, &callstack_id_to_count_per_thread](size_t index) {
+                absl::flat_hash_map<uint64_t, uint32_t>* callstack_id_to_count =
+                    &callstack_id_to_count_per_thread[index];
+                callstack_data.ForEachCallstackEventOfTidInTimeRange(
+                    thread_ids[index], 0, std::numeric_limits<uint64_t>::max(),
+                    [callstack_id_to_count](const CallstackEvent& event) {
+                      (*callstack_id_to_count)[event.callstack_id()]++;
+                    });
+              });
+
+  CallstackCountsPerThread callstack_counts_per_thread;
+  for (size_t index = 0; index < thread_ids.size(); ++index) {
+    if (generate_summary) {
+      AddCounts(callstack_id_to_count_per_thread[index],
+                &callstack_counts_per_thread[orbit_base::kAllProcessThreadsTid]);
+    }
+    callstack_counts_per_thread.insert_or_assign(
+        thread_ids[index], std::move(callstack_id_to_count_per_thread[index]));
+  }
 
-      absl::flat_hash_set<uint64_t> unique_resolved_addresses;
-      if (resolved_callstack.type() == CallstackInfo::kComplete) {
-        for (uint64_t resolved_address : resolved_callstack.frames()) {
-          unique_resolved_addresses.insert(resolved_address);
-        }
-      } else {
-        // For non-kComplete callstacks, only use the innermost frame for statistics.
-        unique_resolved_addresses.insert(resolved_callstack.frames(0));
-      }
+  ResolvedFramesPerCallstack resolved_frames_per_callstack;
+  return PostProcessedSamplingDataBuilder{thread_pool, &resolved_frames_per_callstack}.Build(
+      callstack_counts_per_thread, callstack_data, capture_data);
+}
 
-      // "Inclusive" stat.
-      for (uint64_t resolved_address : unique_resolved_addresses) {
-        thread_sample_data->resolved_address_to_count[resolved_address] += callstack_count;
-      }
+namespace {
+PostProcessedSamplingData PostProcessedSamplingDataBuilder::Build(
+    const CallstackCountsPerThread& callstack_counts_per_thread,
+    const CallstackData& callstack_data, const CaptureData& capture_data) {
+  ResolveCallstacks(callstack_data, capture_data);
 
-      // "Unwind errors" stat.
-      if (resolved_callstack.type() != CallstackInfo::kComplete) {
-        thread_sample_data->resolved_address_to_error_count[resolved_callstack.frames(0)] +=
-            callstack_count;
+  // Split the callstacks of each thread into shards. The shards of a thread are contiguous.
+  std::vector<Shard> shards;
+  std::vector<std::pair<ThreadID, size_t>> thread_id_and_first_shard_index;
+  for (const auto& [thread_id, callstack_id_to_count] : callstack_counts_per_thread) {
+    thread_id_and_first_shard_index.emplace_back(thread_id, shards.size());
+    size_t callstack_index = 0;
+    for (const auto& callstack_id_and_count : callstack_id_to_count) {
+      if (callstack_index++ % kCallstacksPerShard == 0) {
+        shards.emplace_back();
       }
+      shards.back().callstack_counts.push_back(callstack_id_and_count);
     }
+    thread_id_to_sample_data_[thread_id].sampled_callstack_id_to_count = callstack_id_to_count;
+  }
 
-    // For each thread, sort resolved (function) addresses by inclusive count.
-    for (const auto& address_count_it : thread_sample_data->resolved_address_to_count) {
-      const uint64_t address = address_count_it.first;
-      const uint32_t count = address_count_it.second;
-      thread_sample_data->sorted_count_to_resolved_address.insert(std::make_pair(count, address));
-    }
+  // A copy of the CallstackInfos, so that the shards don't contend on the mutex of CallstackData.
+  const UniqueCallstacks unique_callstacks = callstack_data.GetUniqueCallstacksCopy();
+  ParallelFor(thread_pool_, shards.size(), [this, &unique_callstacks, &shards](size_t shard_index) {
+    AggregateShard(unique_callstacks, &shards[shard_index]);
+  });
+
+  // thread_id_to_sample_data_ isn't modified anymore, so pointers to its values stay valid.
+  std::vector<std::pair<ThreadSampleData*, std::pair<size_t, size_t>>> threads_and_shard_ranges;
+  for (size_t index = 0; index < thread_id_and_first_shard_index.size(); ++index) {
+    const auto& [thread_id, first_shard_index] = thread_id_and_first_shard_index[index];
+    size_t end_shard_index = index + 1 < thread_id_and_first_shard_index.size()
+                                 ? thread_id_and_first_shard_index[index + 1].second
+                                 : shards.size();
+    threads_and_shard_ranges.emplace_back(&thread_id_to_sample_data_.at(thread_id),
+                                          std::make_pair(first_shard_index, end_shard_index));
   }
 
-  FillThreadSampleDataSampleReports(capture_data);
+  ParallelFor(thread_pool_, threads_and_shard_ranges.size(),
+              [&capture_data, &shards, &threads_and_shard_ranges](size_t index) {
+                auto& [thread_sample_data, shard_range] = threads_and_shard_ranges[index];
+                MergeShards(shards.begin() + shard_range.first,
+                            shards.begin() + shard_range.second, thread_sample_data);
+                FillThreadSampleDataSampleReport(capture_data, thread_sample_data);
+              });
 
   SortByThreadUsage();
 
@@ -226,7 +302,101 @@ PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(
       std::move(function_address_to_sampled_callstack_ids_), std::move(sorted_thread_sample_data_));
 }
 
-void SamplingDataPostProcessor::SortByThreadUsage() {
+void PostProcessedSamplingDataBuilder::AggregateShard(const UniqueCallstacks& unique_callstacks,
+                                                      Shard* shard) const {
+  ThreadSampleData* sample_data = &shard->sample_data;
+  for (const auto& [callstack_id, callstack_count] : shard->callstack_counts) {
+    auto callstack_it = unique_callstacks.find(callstack_id);
+    CHECK(callstack_it != unique_callstacks.end());
+    const orbit_client_protos::CallstackInfo* callstack_info = callstack_it->second.get();
+
+    // For non-kComplete callstacks, only use the innermost frame for statistics, as it's the
+    // only one known to be correct. Note that, in the vast majority of cases, the innermost
+    // frame is also the only one available.
+    absl::flat_hash_set<uint64_t> unique_frames;
+    CHECK(!callstack_info->frames().empty());
+    if (callstack_info->type() == CallstackInfo::kComplete) {
+      for (uint64_t frame : callstack_info->frames()) {
+        unique_frames.insert(frame);
+      }
+    } else {
+      unique_frames.insert(callstack_info->frames(0));
+    }
+
+    sample_data->samples_count += callstack_count;
+    for (uint64_t frame : unique_frames) {
+      sample_data->sampled_address_to_count[frame] += callstack_count;
+    }
+
+    // Address count per sample per thread
+    uint64_t resolved_callstack_id = original_id_to_resolved_callstack_id_.at(callstack_id);
+    const CallstackInfo& resolved_callstack = id_to_resolved_callstack_.at(resolved_callstack_id);
+
+    // "Exclusive" stat.
+    CHECK(!resolved_callstack.frames().empty());
+    sample_data->resolved_address_to_exclusive_count[resolved_callstack.frames(0)] +=
+        callstack_count;
+
+    absl::flat_hash_set<uint64_t> unique_resolved_addresses;
+    if (resolved_callstack.type() == CallstackInfo::kComplete) {
+      for (uint64_t resolved_address : resolved_callstack.frames()) {
+        unique_resolved_addresses.insert(resolved_address);
+      }
+    } else {
+      // For non-kComplete callstacks, only use the innermost frame for statistics.
+      unique_resolved_addresses.insert(resolved_callstack.frames(0));
+    }
+
+    // "Inclusive" stat.
+    for (uint64_t resolved_address : unique_resolved_addresses) {
+      sample_data->resolved_address_to_count[resolved_address] += callstack_count;
+    }
+
+    // "Unwind errors" stat.
+    if (resolved_callstack.type() != CallstackInfo::kComplete) {
+      sample_data->resolved_address_to_error_count[resolved_callstack.frames(0)] +=
+          callstack_count;
+    }
+  }
+}
+
+void PostProcessedSamplingDataBuilder::MergeShards(std::vector<Shard>::iterator shards_begin,
+                                                   std::vector<Shard>::iterator shards_end,
+                                                   ThreadSampleData* thread_sample_data) {
+  for (auto shard_it = shards_begin; shard_it != shards_end; ++shard_it) {
+    ThreadSampleData& shard_sample_data = shard_it->sample_data;
+    if (shard_it == shards_begin) {
+      thread_sample_data->samples_count = shard_sample_data.samples_count;
+      thread_sample_data->sampled_address_to_count =
+          std::move(shard_sample_data.sampled_address_to_count);
+      thread_sample_data->resolved_address_to_count =
+          std::move(shard_sample_data.resolved_address_to_count);
+      thread_sample_data->resolved_address_to_exclusive_count =
+          std::move(shard_sample_data.resolved_address_to_exclusive_count);
+      thread_sample_data->resolved_address_to_error_count =
+          std::move(shard_sample_data.resolved_address_to_error_count);
+      continue;
+    }
+    thread_sample_data->samples_count += shard_sample_data.samples_count;
+    AddCounts(shard_sample_data.sampled_address_to_count,
+              &thread_sample_data->sampled_address_to_count);
+    AddCounts(shard_sample_data.resolved_address_to_count,
+              &thread_sample_data->resolved_address_to_count);
+    AddCounts(shard_sample_data.resolved_address_to_exclusive_count,
+              &thread_sample_data->resolved_address_to_exclusive_count);
+    AddCounts(shard_sample_data.resolved_address_to_error_count,
+              &thread_sample_data->resolved_address_to_error_count);
+  }
+
+  // For each thread, sort resolved (function) addresses by inclusive count.
+  for (const auto& address_count_it : thread_sample_data->resolved_address_to_count) {
+    const uint64_t address = address_count_it.first;
+    const uint32_t count = address_count_it.second;
+    thread_sample_data->sorted_count_to_resolved_address.insert(std::make_pair(count, address));
+  }
+}
+
+void PostProcessedSamplingDataBuilder::SortByThreadUsage() {
   sorted_thread_sample_data_.reserve(thread_id_to_sample_data_.size());
 
   for (auto& pair : thread_id_to_sample_data_) {
@@ -241,21 +411,23 @@ void SamplingDataPostProcessor::SortByThreadUsage() {
        });
 }
 
-void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack_data,
-                                                  const CaptureData& capture_data) {
-  callstack_data.ForEachUniqueCallstack([this, &capture_data](uint64_t callstack_id,
-                                                              const CallstackInfo& callstack) {
+void PostProcessedSamplingDataBuilder::ResolveCallstacks(const CallstackData& callstack_data,
+                                                         const CaptureData& capture_data) {
+  MapAddressesToFunctionAddresses(callstack_data, capture_data);
+
+  callstack_data.ForEachUniqueCallstack([this](uint64_t callstack_id,
+                                               const CallstackInfo& callstack) {
     // A "resolved callstack" is a callstack where every address is replaced by the start address of
     // the function (if known).
-    std::vector<uint64_t> resolved_callstack_frames;
-
-    for (uint64_t address : callstack.frames()) {
-      if (!exact_address_to_function_address_.contains(address)) {
-        MapAddressToFunctionAddress(address, capture_data);
+    auto [resolved_frames_it, inserted] = resolved_frames_per_callstack_->try_emplace(callstack_id);
+    std::vector<uint64_t>& resolved_callstack_frames = resolved_frames_it->second;
+    if (inserted) {
+      resolved_callstack_frames.reserve(callstack.frames_size());
+      for (uint64_t address : callstack.frames()) {
+        auto function_address_it = exact_address_to_function_address_.find(address);
+        CHECK(function_address_it != exact_address_to_function_address_.end());
+        resolved_callstack_frames.push_back(function_address_it->second);
       }
-      auto function_address_it = exact_address_to_function_address_.find(address);
-      CHECK(function_address_it != exact_address_to_function_address_.end());
-      resolved_callstack_frames.push_back(function_address_it->second);
     }
 
     if (callstack.type() == CallstackInfo::kComplete) {
@@ -298,55 +470,80 @@ void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack
   });
 }
 
-void SamplingDataPostProcessor::MapAddressToFunctionAddress(uint64_t absolute_address,
-                                                            const CaptureData& capture_data) {
-  // SamplingDataPostProcessor relies heavily on the association between address and function
+void PostProcessedSamplingDataBuilder::MapAddressesToFunctionAddresses(
+    const CallstackData& callstack_data, const CaptureData& capture_data) {
+  // PostProcessedSamplingDataBuilder relies heavily on the association between address and function
   // address held by exact_address_to_function_address_, otherwise each address is considered a
-  // different function. We are storing this mapping for faster lookup.
-  std::optional<uint64_t> absolute_function_address_option =
-      capture_data.FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(absolute_address);
-  uint64_t absolute_function_address = absolute_function_address_option.value_or(absolute_address);
+  // different function. We are storing this mapping for faster lookup. Each address is only looked
+  // up once, and the lookups are distributed over the thread pool.
+  // Only the addresses of the callstacks that haven't been resolved before are needed.
+  std::vector<uint64_t> addresses;
+  {
+    absl::flat_hash_set<uint64_t> unique_addresses;
+    callstack_data.ForEachUniqueCallstack(
+        [this, &unique_addresses, &addresses](uint64_t callstack_id,
+                                              const CallstackInfo& callstack) {
+          if (resolved_frames_per_callstack_->contains(callstack_id)) return;
+          for (uint64_t address : callstack.frames()) {
+            if (unique_addresses.insert(address).second) {
+              addresses.push_back(address);
+            }
+          }
+        });
+  }
 
-  exact_address_to_function_address_[absolute_address] = absolute_function_address;
+  std::vector<uint64_t> function_addresses(addresses.size());
+  const size_t shard_count = (addresses.size() + kAddressesPerShard - 1) / kAddressesPerShard;
+  ParallelFor(thread_pool_, shard_count,
+              [&capture_data, &addresses, &function_addresses](size_t shard_index) {
+                const size_t begin = shard_index * kAddressesPerShard;
+                const size_t count = std::min(addresses.size() - begin, kAddressesPerShard);
+                capture_data.FindFunctionAbsoluteAddressesByInstructionAbsoluteAddresses(
+                    absl::MakeConstSpan(addresses).subspan(begin, count),
+                    absl::MakeSpan(function_addresses).subspan(begin, count));
+              });
+
+  exact_address_to_function_address_.reserve(addresses.size());
+  for (size_t index = 0; index < addresses.size(); ++index) {
+    exact_address_to_function_address_.emplace(addresses[index], function_addresses[index]);
+  }
 }
 
-void SamplingDataPostProcessor::FillThreadSampleDataSampleReports(const CaptureData& capture_data) {
-  for (auto& data : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &data.second;
-    std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_functions;
+void PostProcessedSamplingDataBuilder::FillThreadSampleDataSampleReport(
+    const CaptureData& capture_data, ThreadSampleData* thread_sample_data) {
+  std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_functions;
 
-    for (auto sorted_it = thread_sample_data->sorted_count_to_resolved_address.rbegin();
-         sorted_it != thread_sample_data->sorted_count_to_resolved_address.rend(); ++sorted_it) {
-      uint32_t num_occurrences = sorted_it->first;
-      uint64_t absolute_address = sorted_it->second;
+  for (auto sorted_it = thread_sample_data->sorted_count_to_resolved_address.rbegin();
+       sorted_it != thread_sample_data->sorted_count_to_resolved_address.rend(); ++sorted_it) {
+    uint32_t num_occurrences = sorted_it->first;
+    uint64_t absolute_address = sorted_it->second;
 
-      SampledFunction function;
-      function.name = capture_data.GetFunctionNameByAddress(absolute_address);
+    SampledFunction function;
+    function.name = capture_data.GetFunctionNameByAddress(absolute_address);
 
-      function.inclusive = num_occurrences;
-      function.inclusive_percent = 100.f * num_occurrences / thread_sample_data->samples_count;
+    function.inclusive = num_occurrences;
+    function.inclusive_percent = 100.f * num_occurrences / thread_sample_data->samples_count;
 
-      function.exclusive = 0;
-      function.exclusive_percent = 0.f;
+    function.exclusive = 0;
+    function.exclusive_percent = 0.f;
 
-      if (auto it = thread_sample_data->resolved_address_to_exclusive_count.find(absolute_address);
-          it != thread_sample_data->resolved_address_to_exclusive_count.end()) {
-        function.exclusive = it->second;
-        function.exclusive_percent = 100.f * it->second / thread_sample_data->samples_count;
-      }
-
-      function.unwind_errors = 0;
-      function.unwind_errors_percent = 0.f;
-      if (auto it = thread_sample_data->resolved_address_to_error_count.find(absolute_address);
-          it != thread_sample_data->resolved_address_to_error_count.end()) {
-        function.unwind_errors = it->second;
-        function.unwind_errors_percent = 100.f * it->second / thread_sample_data->samples_count;
-      }
-      function.absolute_address = absolute_address;
-      function.module_path = capture_data.GetModulePathByAddress(absolute_address);
+    if (auto it = thread_sample_data->resolved_address_to_exclusive_count.find(absolute_address);
+        it != thread_sample_data->resolved_address_to_exclusive_count.end()) {
+      function.exclusive = it->second;
+      function.exclusive_percent = 100.f * it->second / thread_sample_data->samples_count;
+    }
 
-      sampled_functions->push_back(function);
+    function.unwind_errors = 0;
+    function.unwind_errors_percent = 0.f;
+    if (auto it = thread_sample_data->resolved_address_to_error_count.find(absolute_address);
+        it != thread_sample_data->resolved_address_to_error_count.end()) {
+      function.unwind_errors = it->second;
+      function.unwind_errors_percent = 100.f * it->second / thread_sample_data->samples_count;
     }
+    function.absolute_address = absolute_address;
+    function.module_path = capture_data.GetModulePathByAddress(absolute_address);
+
+    sampled_functions->push_back(function);
   }
 }
 
@@ -2,16 +2,25 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include "ClientData/ModuleManager.h"
 #include "ClientModel/CaptureData.h"
 #include "ClientModel/SamplingDataPostProcessor.h"
+#include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
 #include "capture_data.pb.h"
 
 using orbit_client_data::CallstackCount;
@@ -151,6 +160,7 @@ class SamplingDataPostProcessorTest : public ::testing::Test {
     callstack_event.set_time(current_callstack_timestamp_ns_);
     callstack_event.set_callstack_id(callstack_id);
     callstack_event.set_thread_id(thread_id);
+    sampling_data_post_processor_.AddCallstackEvent(callstack_event);
     capture_data_.AddCallstackEvent(std::move(callstack_event));
   }
 
@@ -352,6 +362,20 @@ class SamplingDataPostProcessorTest : public ::testing::Test {
                                             /*generate_summary=*/true);
   }
 
+  void CreatePostProcessedSamplingDataWithSummaryOnThreadPool() {
+    std::shared_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+    ppsd_ = CreatePostProcessedSamplingData(*capture_data_.GetCallstackData(), capture_data_,
+                                            /*generate_summary=*/true, thread_pool.get());
+    thread_pool->ShutdownAndWait();
+  }
+
+  void CreatePostProcessedSamplingDataIncrementally() {
+    ppsd_ = sampling_data_post_processor_.CreatePostProcessedSamplingData(
+        *capture_data_.GetCallstackData(), capture_data_);
+  }
+
+  // Fed by AddCallstackEvent.
+  SamplingDataPostProcessor sampling_data_post_processor_{/*generate_summary=*/true};
   PostProcessedSamplingData ppsd_;
 
   void VerifyNoCallstackInfos() {
@@ -1697,4 +1721,214 @@ TEST_F(SamplingDataPostProcessorTest, TwoThreadsWithSummaryWithMixedCallstackTyp
   VerifyEmptySortedCallstackReport(kThreadIdNotSampled);
 }
 
+TEST_F(SamplingDataPostProcessorTest, IncrementalWithCallstackEventsAddedAfterFirstCreation) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+  AddAllAddressInfos();
+
+  CreatePostProcessedSamplingDataIncrementally();
+  EXPECT_EQ(ppsd_.GetThreadSampleData().size(), 0);
+  EXPECT_EQ(ppsd_.GetSummary(), nullptr);
+
+  AddCallstackEventsInThreadId1And2();
+
+  CreatePostProcessedSamplingDataIncrementally();
+
+  VerifyAllCallstackInfos(CallstackInfo::kComplete);
+
+  EXPECT_EQ(ppsd_.GetThreadSampleData().size(), 3);
+  ASSERT_NE(ppsd_.GetSummary(), nullptr);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId2), nullptr);
+
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThread(*ppsd_.GetSummary(),
+                                                             orbit_base::kAllProcessThreadsTid);
+  VerifyThreadSampleDataForCallstackEventsInThreadId1(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId1));
+  VerifyThreadSampleDataForCallstackEventsInThreadId2(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId2));
+
+  VerifyGetCountOfFunction();
+
+  VerifySortedCallstackReportForCallstackEventsInThreadId1();
+  VerifySortedCallstackReportForCallstackEventsInThreadId2();
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalWithAddressInfosAddedAfterFirstCreation) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+
+  AddCallstackEventsAllInThreadId1();
+
+  CreatePostProcessedSamplingDataIncrementally();
+
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThreadWithoutAddressInfos(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId1), kThreadId1);
+
+  // The resolved callstacks are kept until they are invalidated...
+  AddAllAddressInfos();
+
+  CreatePostProcessedSamplingDataIncrementally();
+
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThreadWithoutAddressInfos(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId1), kThreadId1);
+
+  // ...as when symbols are loaded: the callstacks are then resolved again with the new information.
+  sampling_data_post_processor_.InvalidateResolvedCallstacks();
+  CreatePostProcessedSamplingDataIncrementally();
+
+  VerifyAllCallstackInfos(CallstackInfo::kComplete);
+
+  ASSERT_NE(ppsd_.GetSummary(), nullptr);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThread(*ppsd_.GetSummary(),
+                                                             orbit_base::kAllProcessThreadsTid);
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThread(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId1), kThreadId1);
+
+  VerifyGetCountOfFunction();
+
+  VerifySortedCallstackReportForCallstackEventsAllInTheSameThread(kThreadId1);
+}
+
+TEST_F(SamplingDataPostProcessorTest, TwoThreadsWithSummaryOnThreadPool) {
+  AddAllCallstackInfos(CallstackInfo::kComplete);
+  AddAllAddressInfos();
+
+  AddCallstackEventsInThreadId1And2();
+
+  CreatePostProcessedSamplingDataWithSummaryOnThreadPool();
+
+  VerifyAllCallstackInfos(CallstackInfo::kComplete);
+
+  EXPECT_EQ(ppsd_.GetThreadSampleData().size(), 3);
+  ASSERT_NE(ppsd_.GetSummary(), nullptr);
+
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId1), nullptr);
+  ASSERT_NE(ppsd_.GetThreadSampleDataByThreadId(kThreadId2), nullptr);
+  EXPECT_THAT(ppsd_.GetThreadSampleData(),
+              ElementsAre(ThreadSampleDataEq(*ppsd_.GetSummary()),
+                          ThreadSampleDataEq(*ppsd_.GetThreadSampleDataByThreadId(kThreadId2)),
+                          ThreadSampleDataEq(*ppsd_.GetThreadSampleDataByThreadId(kThreadId1))));
+
+  VerifyThreadSampleDataForCallstackEventsAllInTheSameThread(*ppsd_.GetSummary(),
+                                                             orbit_base::kAllProcessThreadsTid);
+  VerifyThreadSampleDataForCallstackEventsInThreadId1(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId1));
+  VerifyThreadSampleDataForCallstackEventsInThreadId2(
+      *ppsd_.GetThreadSampleDataByThreadId(kThreadId2));
+
+  VerifyGetCountOfFunction();
+
+  VerifySortedCallstackReportForCallstackEventsAllInTheSameThread(
+      orbit_base::kAllProcessThreadsTid);
+  VerifySortedCallstackReportForCallstackEventsInThreadId1();
+  VerifySortedCallstackReportForCallstackEventsInThreadId2();
+  VerifyEmptySortedCallstackReport(kThreadIdNotSampled);
+}
+
+// Times CreatePostProcessedSamplingData on a single thread and on a thread pool with one thread per
+// core. Each thread only samples a few hundred callstacks, while the summary contains all of them,
+// so that the summary is split into many shards. Multiply the sizes by 10 to get closer to a large
+// capture. Disabled by default, as it only measures.
+TEST(SamplingDataPostProcessor, DISABLED_ThreadPoolBenchmark) {
+  constexpr int kThreadCount = 64;
+  constexpr uint64_t kCallstacksPerThread = 500;
+  constexpr uint64_t kFramesPerCallstack = 20;
+  constexpr uint64_t kFunctionCount = 10'000;
+  constexpr uint64_t kInstructionsPerFunction = 4;
+  constexpr uint64_t kCallstackEventCount = 250'000;
+  constexpr uint64_t kFirstFunctionAddress = 0x1000'0000;
+  constexpr uint64_t kFunctionSize = 0x100;
+
+  ModuleManager module_manager;
+  CaptureData capture_data{&module_manager, CaptureStarted{}, std::filesystem::path{},
+                           absl::flat_hash_set<uint64_t>{}};
+
+  // Deterministic pseudo-random instruction addresses.
+  uint64_t state = 42;
+  auto next_instruction_address = [&state]() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const uint64_t function_index = (state >> 33) % kFunctionCount;
+    const uint64_t instruction_index = (state >> 13) % kInstructionsPerFunction;
+    return kFirstFunctionAddress + function_index * kFunctionSize + instruction_index;
+  };
+
+  for (uint64_t function_index = 0; function_index < kFunctionCount; ++function_index) {
+    for (uint64_t offset = 0; offset < kInstructionsPerFunction; ++offset) {
+      LinuxAddressInfo address_info;
+      address_info.set_module_path("/path/to/module");
+      address_info.set_function_name(absl::StrFormat("function%u", function_index));
+      address_info.set_absolute_address(kFirstFunctionAddress + function_index * kFunctionSize +
+                                        offset);
+      address_info.set_offset_in_function(offset);
+      capture_data.InsertAddressInfo(std::move(address_info));
+    }
+  }
+
+  constexpr uint64_t kCallstackCount = kThreadCount * kCallstacksPerThread;
+  for (uint64_t callstack_id = 1; callstack_id <= kCallstackCount; ++callstack_id) {
+    CallstackInfo callstack_info;
+    for (uint64_t frame = 0; frame < kFramesPerCallstack; ++frame) {
+      callstack_info.add_frames(next_instruction_address());
+    }
+    callstack_info.set_type(callstack_id % 10 == 0 ? CallstackInfo::kDwarfUnwindingError
+                                                   : CallstackInfo::kComplete);
+    capture_data.AddUniqueCallstack(callstack_id, std::move(callstack_info));
+  }
+
+  for (uint64_t event_index = 0; event_index < kCallstackEventCount; ++event_index) {
+    const int32_t thread_id = static_cast<int32_t>(event_index % kThreadCount);
+    CallstackEvent callstack_event;
+    callstack_event.set_time(event_index);
+    callstack_event.set_thread_id(thread_id);
+    callstack_event.set_callstack_id(1 + thread_id * kCallstacksPerThread +
+                                     (next_instruction_address() % kCallstacksPerThread));
+    capture_data.AddCallstackEvent(std::move(callstack_event));
+  }
+
+  const absl::Time sequential_start = absl::Now();
+  PostProcessedSamplingData sequential_ppsd =
+      CreatePostProcessedSamplingData(*capture_data.GetCallstackData(), capture_data);
+  const absl::Duration sequential_duration = absl::Now() - sequential_start;
+
+  const size_t pool_size = std::max(1U, std::thread::hardware_concurrency());
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::Create(pool_size, pool_size, absl::Seconds(1));
+  const absl::Time parallel_start = absl::Now();
+  PostProcessedSamplingData parallel_ppsd =
+      CreatePostProcessedSamplingData(*capture_data.GetCallstackData(), capture_data,
+                                      /*generate_summary=*/true, thread_pool.get());
+  const absl::Duration parallel_duration = absl::Now() - parallel_start;
+  thread_pool->ShutdownAndWait();
+
+  ASSERT_NE(sequential_ppsd.GetSummary(), nullptr);
+  ASSERT_NE(parallel_ppsd.GetSummary(), nullptr);
+  const ThreadSampleData& summary = *parallel_ppsd.GetSummary();
+  EXPECT_EQ(summary.samples_count, kCallstackEventCount);
+  EXPECT_EQ(summary.sampled_address_to_count,
+            sequential_ppsd.GetSummary()->sampled_address_to_count);
+  EXPECT_EQ(summary.resolved_address_to_count,
+            sequential_ppsd.GetSummary()->resolved_address_to_count);
+  EXPECT_EQ(summary.resolved_address_to_error_count,
+            sequential_ppsd.GetSummary()->resolved_address_to_error_count);
+
+  // The summary, merged from many shards, adds up the threads, which have a single shard each.
+  absl::flat_hash_map<uint64_t, uint32_t> resolved_address_to_exclusive_count;
+  for (int32_t thread_id = 0; thread_id < kThreadCount; ++thread_id) {
+    const ThreadSampleData* thread_sample_data =
+        parallel_ppsd.GetThreadSampleDataByThreadId(thread_id);
+    ASSERT_NE(thread_sample_data, nullptr);
+    for (const auto& [address, count] : thread_sample_data->resolved_address_to_exclusive_count) {
+      resolved_address_to_exclusive_count[address] += count;
+    }
+  }
+  EXPECT_EQ(summary.resolved_address_to_exclusive_count, resolved_address_to_exclusive_count);
+
+  LOG("Post-processed %u samples of %u callstacks: sequentially in %.0f ms, on %u threads in "
+      "%.0f ms",
+      kCallstackEventCount, kCallstackCount, absl::ToDoubleMilliseconds(sequential_duration),
+      pool_size, absl::ToDoubleMilliseconds(parallel_duration));
+}
+
 }  // namespace orbit_client_model
@@ -8,8 +8,10 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
@@ -20,6 +22,7 @@
 #include <utility>
 #include <vector>
 
+#include "ClientData/AddressToFunctionIndex.h"
 #include "ClientData/CallstackData.h"
 #include "ClientData/FunctionInfoSet.h"
 #include "ClientData/ModuleData.h"
@@ -82,6 +85,10 @@ class CaptureData {
   [[nodiscard]] const std::string& GetFunctionNameByAddress(uint64_t absolute_address) const;
   [[nodiscard]] std::optional<uint64_t> FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(
       uint64_t absolute_address) const;
+  // Batch version of FindFunctionAbsoluteAddressByInstructionAbsoluteAddress, e.g. for the frames
+  // of a callstack. Addresses that can't be resolved are copied unchanged to `function_addresses`.
+  void FindFunctionAbsoluteAddressesByInstructionAbsoluteAddresses(
+      absl::Span<const uint64_t> absolute_addresses, absl::Span<uint64_t> function_addresses) const;
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByModulePathBuildIdAndOffset(
       const std::string& module_path, const std::string& build_id, uint64_t offset) const;
   [[nodiscard]] const std::string& GetModulePathByAddress(uint64_t absolute_address) const;
@@ -203,6 +210,13 @@ class CaptureData {
   [[nodiscard]] const orbit_client_data::ProcessData* process() const { return &process_; }
   [[nodiscard]] orbit_client_data::ProcessData* mutable_process() { return &process_; }
 
+  // The lookups of functions by absolute address go through a snapshot of the modules of the
+  // process and of their functions (see AddressToFunctionIndex). This needs to be called after
+  // modifying the modules of `mutable_process()` and after loading or unloading symbols. The new
+  // snapshot replaces the old one atomically, so this can be called while other threads look up
+  // functions.
+  void UpdateAddressToFunctionIndex();
+
   [[nodiscard]] bool has_post_processed_sampling_data() const {
     return post_processed_sampling_data_.has_value();
   }
@@ -241,9 +255,16 @@ class CaptureData {
   [[nodiscard]] std::optional<uint64_t>
   FindFunctionAbsoluteAddressByInstructionAbsoluteAddressUsingAddressInfo(
       uint64_t absolute_address) const;
+  [[nodiscard]] std::shared_ptr<const orbit_client_data::AddressToFunctionIndex>
+  GetAddressToFunctionIndex() const {
+    return std::atomic_load(&address_to_function_index_);
+  }
 
   orbit_client_data::ProcessData process_;
   orbit_client_data::ModuleManager* module_manager_;
+  // Only accessed with std::atomic_load and std::atomic_store.
+  std::shared_ptr<const orbit_client_data::AddressToFunctionIndex> address_to_function_index_ =
+      std::make_shared<const orbit_client_data::AddressToFunctionIndex>();
   absl::flat_hash_map<uint64_t, orbit_grpc_protos::InstrumentedFunction> instrumented_functions_;
 
   orbit_client_data::TracepointInfoSet selected_tracepoints_;
@@ -5,14 +5,64 @@
 #ifndef CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 #define CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <stdint.h>
+
+#include <vector>
+
 #include "ClientData/CallstackData.h"
+#include "ClientData/CallstackTypes.h"
 #include "ClientData/PostProcessedSamplingData.h"
 #include "ClientModel/CaptureData.h"
+#include "OrbitBase/ThreadPool.h"
+#include "capture_data.pb.h"
 
 namespace orbit_client_model {
+
+// Counts the samples of each callstack per thread as the CallstackEvents are added, e.g., while
+// the capture is running. This way, creating the PostProcessedSamplingData doesn't require a pass
+// over all the CallstackEvents: only the unique callstacks of each thread, which are usually orders
+// of magnitude fewer, are aggregated. The frames of each callstack resolved to function addresses
+// are kept across calls to CreatePostProcessedSamplingData, so that only new callstacks are
+// resolved, until InvalidateResolvedCallstacks is called because symbols were loaded.
+// All methods are thread-safe.
+class SamplingDataPostProcessor {
+ public:
+  explicit SamplingDataPostProcessor(bool generate_summary = true)
+      : generate_summary_{generate_summary} {}
+
+  SamplingDataPostProcessor(const SamplingDataPostProcessor&) = delete;
+  SamplingDataPostProcessor& operator=(const SamplingDataPostProcessor&) = delete;
+  SamplingDataPostProcessor(SamplingDataPostProcessor&&) = delete;
+  SamplingDataPostProcessor& operator=(SamplingDataPostProcessor&&) = delete;
+
+  void AddCallstackEvent(const orbit_client_protos::CallstackEvent& event);
+
+  // `callstack_data` has to contain the CallstackInfos of all the CallstackEvents added so far.
+  // If `thread_pool` isn't nullptr, the work is distributed over its threads.
+  [[nodiscard]] orbit_client_data::PostProcessedSamplingData CreatePostProcessedSamplingData(
+      const orbit_client_data::CallstackData& callstack_data, const CaptureData& capture_data,
+      ThreadPool* thread_pool = nullptr);
+
+  // Has to be called when the function addresses the callstacks resolve to might have changed.
+  void InvalidateResolvedCallstacks();
+
+ private:
+  const bool generate_summary_;
+  absl::Mutex mutex_;
+  absl::flat_hash_map<orbit_client_data::ThreadID, absl::flat_hash_map<uint64_t, uint32_t>>
+      thread_id_to_callstack_id_to_count_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<uint64_t, std::vector<uint64_t>> callstack_id_to_resolved_frames_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+// If `thread_pool` isn't nullptr, the samples are counted, the addresses resolved and the samples
+// aggregated, sharded by thread and by callstack, in parallel on its threads.
 orbit_client_data::PostProcessedSamplingData CreatePostProcessedSamplingData(
     const orbit_client_data::CallstackData& callstack_data, const CaptureData& capture_data,
-    bool generate_summary = true);
+    bool generate_summary = true, ThreadPool* thread_pool = nullptr);
 }  // namespace orbit_client_model
 
 #endif  // CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
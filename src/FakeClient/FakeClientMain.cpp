@@ -42,6 +42,21 @@ ABSL_FLAG(bool, thread_state, false, "Collect thread state information");
 ABSL_FLAG(bool, gpu_jobs, true, "Collect GPU jobs");
 ABSL_FLAG(uint16_t, memory_sampling_rate, 0,
           "Memory usage sampling rate in samples per second (0: no sampling)");
+ABSL_FLAG(uint32_t, ring_buffer_reader_threads, 1,
+          "Number of threads OrbitService uses to read perf_event_open ring buffers");
+ABSL_FLAG(bool, event_driven_ring_buffer_polling, false,
+          "Wait for perf_event_open ring buffers to have data instead of polling them");
+ABSL_FLAG(bool, compress_capture_events, false,
+          "Ask OrbitService to compress the CaptureEvents it sends");
+ABSL_FLAG(bool, unwind_with_precompiled_cfi, false,
+          "Unwind DWARF stack samples with call frame information precompiled into flat tables");
+ABSL_FLAG(bool, intern_orbit_api_names, false,
+          "Ask the Orbit API to send the name of each scope only once per capture");
+ABSL_FLAG(bool, use_shared_memory_producer_transport, false,
+          "Ask producers to send their events to OrbitService through shared memory");
+ABSL_FLAG(bool, use_unwinding_cache, false,
+          "Unwind DWARF stack samples only up to the frames shared with the previous sample of the "
+          "same thread, reusing the outer frames of that sample (experimental)");
 
 namespace {
 std::atomic<bool> exit_requested = false;
@@ -192,6 +207,21 @@ int main(int argc, char* argv[]) {
     memory_sampling_period_ms = 1'000 / absl::GetFlag(FLAGS_memory_sampling_rate);
     LOG("memory_sampling_period_ms=%u", memory_sampling_period_ms);
   }
+  uint32_t ring_buffer_reader_thread_count = absl::GetFlag(FLAGS_ring_buffer_reader_threads);
+  LOG("ring_buffer_reader_thread_count=%u", ring_buffer_reader_thread_count);
+  bool event_driven_ring_buffer_polling = absl::GetFlag(FLAGS_event_driven_ring_buffer_polling);
+  LOG("event_driven_ring_buffer_polling=%d", event_driven_ring_buffer_polling);
+  bool compress_capture_events = absl::GetFlag(FLAGS_compress_capture_events);
+  LOG("compress_capture_events=%d", compress_capture_events);
+  bool unwind_with_precompiled_cfi = absl::GetFlag(FLAGS_unwind_with_precompiled_cfi);
+  LOG("unwind_with_precompiled_cfi=%d", unwind_with_precompiled_cfi);
+  bool intern_orbit_api_names = absl::GetFlag(FLAGS_intern_orbit_api_names);
+  LOG("intern_orbit_api_names=%d", intern_orbit_api_names);
+  bool use_shared_memory_producer_transport =
+      absl::GetFlag(FLAGS_use_shared_memory_producer_transport);
+  LOG("use_shared_memory_producer_transport=%d", use_shared_memory_producer_transport);
+  bool use_unwinding_cache = absl::GetFlag(FLAGS_use_unwinding_cache);
+  LOG("use_unwinding_cache=%d", use_unwinding_cache);
 
   uint32_t grpc_port = absl::GetFlag(FLAGS_port);
   std::string service_address = absl::StrFormat("127.0.0.1:%d", grpc_port);
@@ -242,7 +272,10 @@ int main(int argc, char* argv[]) {
       orbit_client_data::TracepointInfoSet{}, samples_per_second, kStackDumpSize, unwinding_method,
       collect_scheduling_info, collect_thread_state, collect_gpu_jobs, kEnableApi,
       kEnableIntrospection, kEnableUserSpaceInstrumentation, kMaxLocalMarkerDepthPerCommandBuffer,
-      collect_memory_info, memory_sampling_period_ms, std::move(capture_event_processor));
+      collect_memory_info, memory_sampling_period_ms, ring_buffer_reader_thread_count,
+      event_driven_ring_buffer_polling, compress_capture_events, unwind_with_precompiled_cfi,
+      intern_orbit_api_names, use_shared_memory_producer_transport, use_unwinding_cache,
+      std::move(capture_event_processor));
   LOG("Asked to start capture");
 
   uint32_t duration_s = absl::GetFlag(FLAGS_duration);
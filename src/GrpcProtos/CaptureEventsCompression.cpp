@@ -0,0 +1,102 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "GrpcProtos/CaptureEventsCompression.h"
+
+#include <absl/strings/str_format.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_grpc_protos {
+
+namespace {
+
+// zlib's API is not const-correct, but it never writes to the input.
+[[nodiscard]] Bytef* InputBytes(std::string_view data) {
+  return reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+}
+
+}  // namespace
+
+CaptureEventsCompressor::CaptureEventsCompressor() : stream_{std::make_unique<z_stream_s>()} {
+  // Favor speed: OrbitService runs on the same machine as the process being profiled.
+  int result = deflateInit(stream_.get(), Z_BEST_SPEED);
+  CHECK(result == Z_OK);
+}
+
+CaptureEventsCompressor::~CaptureEventsCompressor() { deflateEnd(stream_.get()); }
+
+void CaptureEventsCompressor::CompressBlock(std::string_view data, std::string* compressed_block) {
+  CHECK(data.size() <= std::numeric_limits<uInt>::max());
+  stream_->next_in = InputBytes(data);
+  stream_->avail_in = static_cast<uInt>(data.size());
+
+  // Z_SYNC_FLUSH can add a few bytes on top of the bound for the data itself.
+  constexpr size_t kSyncFlushOverhead = 16;
+  compressed_block->resize(deflateBound(stream_.get(), stream_->avail_in) + kSyncFlushOverhead);
+  size_t compressed_size = 0;
+  while (true) {
+    stream_->next_out = reinterpret_cast<Bytef*>(compressed_block->data() + compressed_size);
+    stream_->avail_out = static_cast<uInt>(compressed_block->size() - compressed_size);
+    // Z_SYNC_FLUSH makes all the input available to the decompressor without resetting the
+    // compression history.
+    int result = deflate(stream_.get(), Z_SYNC_FLUSH);
+    CHECK(result == Z_OK || result == Z_BUF_ERROR);
+    compressed_size = compressed_block->size() - stream_->avail_out;
+    // If the output buffer was filled, there might be more pending output.
+    if (stream_->avail_out != 0) break;
+    compressed_block->resize(2 * compressed_block->size());
+  }
+  CHECK(stream_->avail_in == 0);
+  compressed_block->resize(compressed_size);
+}
+
+CaptureEventsDecompressor::CaptureEventsDecompressor() : stream_{std::make_unique<z_stream_s>()} {
+  int result = inflateInit(stream_.get());
+  CHECK(result == Z_OK);
+}
+
+CaptureEventsDecompressor::~CaptureEventsDecompressor() { inflateEnd(stream_.get()); }
+
+ErrorMessageOr<void> CaptureEventsDecompressor::DecompressBlock(std::string_view compressed_block,
+                                                                std::string* data) {
+  if (stream_corrupted_) {
+    return ErrorMessage{"Compressed stream of CaptureEvents is corrupted"};
+  }
+  CHECK(compressed_block.size() <= std::numeric_limits<uInt>::max());
+  stream_->next_in = InputBytes(compressed_block);
+  stream_->avail_in = static_cast<uInt>(compressed_block.size());
+
+  // CaptureEvents typically compress to less than a quarter of their size.
+  constexpr size_t kMinInitialOutputSize = 4096;
+  data->resize(std::max(4 * compressed_block.size(), kMinInitialOutputSize));
+  size_t size = 0;
+  while (true) {
+    stream_->next_out = reinterpret_cast<Bytef*>(data->data() + size);
+    stream_->avail_out = static_cast<uInt>(data->size() - size);
+    int result = inflate(stream_.get(), Z_SYNC_FLUSH);
+    size = data->size() - stream_->avail_out;
+    // The compressor never ends the stream, so Z_STREAM_END also means the data is corrupted.
+    bool no_progress = result == Z_BUF_ERROR && stream_->avail_in != 0 && stream_->avail_out != 0;
+    if ((result != Z_OK && result != Z_BUF_ERROR) || no_progress) {
+      stream_corrupted_ = true;
+      data->clear();
+      return ErrorMessage{absl::StrFormat("Unable to decompress CaptureEvents: %s",
+                                          stream_->msg != nullptr ? stream_->msg : "invalid data")};
+    }
+    if (stream_->avail_in == 0 && stream_->avail_out != 0) break;
+    if (stream_->avail_out == 0) {
+      data->resize(2 * data->size());
+    }
+  }
+  data->resize(size);
+  return outcome::success();
+}
+
+}  // namespace orbit_grpc_protos
@@ -0,0 +1,165 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "GrpcProtos/CaptureEventsCompression.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/TestUtils.h"
+#include "capture.pb.h"
+#include "services.pb.h"
+
+namespace orbit_grpc_protos {
+
+using orbit_base::HasError;
+
+namespace {
+
+// Pseudo-random but deterministic data that doesn't compress well.
+std::string CreateIncompressibleData(size_t size) {
+  std::string data(size, '\0');
+  uint64_t state = 42;
+  for (char& c : data) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    c = static_cast<char>(state >> 56);
+  }
+  return data;
+}
+
+// A CaptureResponse resembling what OrbitService sends while sampling and tracing the scheduler.
+CaptureResponse CreateCaptureResponse(uint64_t first_timestamp_ns, int event_count) {
+  CaptureResponse response;
+  for (int i = 0; i < event_count; ++i) {
+    const uint64_t timestamp_ns = first_timestamp_ns + i * 12'345;
+    if (i % 2 == 0) {
+      CallstackSample* callstack_sample =
+          response.add_capture_events()->mutable_callstack_sample();
+      callstack_sample->set_pid(1234);
+      callstack_sample->set_tid(1234 + i % 16);
+      callstack_sample->set_timestamp_ns(timestamp_ns);
+      callstack_sample->set_callstack_id(1 + i % 97);
+    } else {
+      SchedulingSlice* scheduling_slice =
+          response.add_capture_events()->mutable_scheduling_slice();
+      scheduling_slice->set_pid(1234);
+      scheduling_slice->set_tid(1234 + i % 16);
+      scheduling_slice->set_core(i % 8);
+      scheduling_slice->set_duration_ns(50'000 + i % 1000);
+      scheduling_slice->set_out_timestamp_ns(timestamp_ns);
+    }
+  }
+  return response;
+}
+
+}  // namespace
+
+TEST(CaptureEventsCompression, BlocksRoundTrip) {
+  CaptureEventsCompressor compressor;
+  CaptureEventsDecompressor decompressor;
+
+  // Include an empty block and one larger than the initial output buffer of the decompressor.
+  const std::vector<std::string> blocks{"first block", "", std::string(100'000, 'a'),
+                                        CreateIncompressibleData(10'000), "last block"};
+  std::string compressed_block;
+  std::string decompressed_block;
+  for (const std::string& block : blocks) {
+    compressor.CompressBlock(block, &compressed_block);
+    ASSERT_FALSE(decompressor.DecompressBlock(compressed_block, &decompressed_block).has_error());
+    EXPECT_EQ(decompressed_block, block);
+  }
+}
+
+TEST(CaptureEventsCompression, HistoryIsKeptAcrossBlocks) {
+  CaptureEventsCompressor compressor;
+  const std::string data = CreateIncompressibleData(1000);
+
+  std::string first_compressed_block;
+  compressor.CompressBlock(data, &first_compressed_block);
+  EXPECT_GT(first_compressed_block.size(), data.size() / 2);
+
+  // The same data can now be encoded as a reference to the previous block.
+  std::string second_compressed_block;
+  compressor.CompressBlock(data, &second_compressed_block);
+  EXPECT_LT(second_compressed_block.size(), data.size() / 10);
+
+  CaptureEventsDecompressor decompressor;
+  std::string decompressed_block;
+  ASSERT_FALSE(
+      decompressor.DecompressBlock(first_compressed_block, &decompressed_block).has_error());
+  ASSERT_FALSE(
+      decompressor.DecompressBlock(second_compressed_block, &decompressed_block).has_error());
+  EXPECT_EQ(decompressed_block, data);
+}
+
+TEST(CaptureEventsCompression, CorruptedStreamIsAnError) {
+  CaptureEventsDecompressor decompressor;
+  std::string decompressed_block;
+  EXPECT_THAT(decompressor.DecompressBlock("not a deflate stream", &decompressed_block),
+              HasError("Unable to decompress"));
+  EXPECT_TRUE(decompressed_block.empty());
+
+  // The decompressor can't recover, even if the next block is valid.
+  CaptureEventsCompressor compressor;
+  std::string compressed_block;
+  compressor.CompressBlock("valid", &compressed_block);
+  EXPECT_THAT(decompressor.DecompressBlock(compressed_block, &decompressed_block),
+              HasError("corrupted"));
+}
+
+// Prints the compression ratio and speed on typical CaptureResponses, and how many events per
+// second that lets through a constrained link. Disabled, as it has nothing to assert.
+TEST(CaptureEventsCompression, DISABLED_CaptureResponsesBenchmark) {
+  constexpr int kResponseCount = 200;
+  constexpr int kEventsPerResponse = 5'000;
+  std::vector<std::string> serialized_responses;
+  uint64_t uncompressed_bytes = 0;
+  for (int i = 0; i < kResponseCount; ++i) {
+    serialized_responses.push_back(
+        CreateCaptureResponse(i * 100'000'000ULL, kEventsPerResponse).SerializeAsString());
+    uncompressed_bytes += serialized_responses.back().size();
+  }
+
+  CaptureEventsCompressor compressor;
+  std::vector<std::string> compressed_blocks(kResponseCount);
+  uint64_t compressed_bytes = 0;
+  const absl::Time compression_start = absl::Now();
+  for (int i = 0; i < kResponseCount; ++i) {
+    compressor.CompressBlock(serialized_responses[i], &compressed_blocks[i]);
+    compressed_bytes += compressed_blocks[i].size();
+  }
+  const absl::Duration compression_duration = absl::Now() - compression_start;
+
+  CaptureEventsDecompressor decompressor;
+  std::string decompressed_block;
+  const absl::Time decompression_start = absl::Now();
+  for (int i = 0; i < kResponseCount; ++i) {
+    ASSERT_FALSE(
+        decompressor.DecompressBlock(compressed_blocks[i], &decompressed_block).has_error());
+    ASSERT_EQ(decompressed_block.size(), serialized_responses[i].size());
+  }
+  const absl::Duration decompression_duration = absl::Now() - decompression_start;
+
+  constexpr double kMegabyte = 1024 * 1024;
+  LOG("%u bytes compressed to %u bytes (ratio %.2f)", uncompressed_bytes, compressed_bytes,
+      static_cast<double>(uncompressed_bytes) / compressed_bytes);
+  LOG("Compression: %.1f MB/s, decompression: %.1f MB/s",
+      uncompressed_bytes / kMegabyte / absl::ToDoubleSeconds(compression_duration),
+      uncompressed_bytes / kMegabyte / absl::ToDoubleSeconds(decompression_duration));
+
+  constexpr double kLinkBytesPerSecond = 100'000'000 / 8.0;
+  constexpr double kEventCount = static_cast<double>(kResponseCount) * kEventsPerResponse;
+  LOG("Events per second over a 100 Mbit/s link: %.0f uncompressed, %.0f compressed",
+      kEventCount * kLinkBytesPerSecond / uncompressed_bytes,
+      kEventCount * kLinkBytesPerSecond / compressed_bytes);
+}
+
+}  // namespace orbit_grpc_protos
@@ -0,0 +1,66 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef GRPC_PROTOS_CAPTURE_EVENTS_COMPRESSION_H_
+#define GRPC_PROTOS_CAPTURE_EVENTS_COMPRESSION_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "OrbitBase/Result.h"
+
+struct z_stream_s;
+
+namespace orbit_grpc_protos {
+
+// Compresses the serialized CaptureResponses that OrbitService sends on the Capture gRPC stream
+// when CaptureOptions::compress_capture_events is set.
+// All the blocks of a capture are part of a single deflate stream. Each block is flushed, so that
+// it can be decompressed as soon as it is received, but the compression history is kept from one
+// block to the next: repeated content (callstacks, names, timestamps' high bits) in a block can be
+// encoded as references to previous blocks.
+class CaptureEventsCompressor {
+ public:
+  CaptureEventsCompressor();
+  ~CaptureEventsCompressor();
+
+  CaptureEventsCompressor(const CaptureEventsCompressor&) = delete;
+  CaptureEventsCompressor& operator=(const CaptureEventsCompressor&) = delete;
+  CaptureEventsCompressor(CaptureEventsCompressor&&) = delete;
+  CaptureEventsCompressor& operator=(CaptureEventsCompressor&&) = delete;
+
+  // Replaces the content of `compressed_block` with the next block of the stream, which contains
+  // `data`.
+  void CompressBlock(std::string_view data, std::string* compressed_block);
+
+ private:
+  std::unique_ptr<z_stream_s> stream_;
+};
+
+// Counterpart of CaptureEventsCompressor. Blocks have to be passed in the order in which they were
+// compressed.
+class CaptureEventsDecompressor {
+ public:
+  CaptureEventsDecompressor();
+  ~CaptureEventsDecompressor();
+
+  CaptureEventsDecompressor(const CaptureEventsDecompressor&) = delete;
+  CaptureEventsDecompressor& operator=(const CaptureEventsDecompressor&) = delete;
+  CaptureEventsDecompressor(CaptureEventsDecompressor&&) = delete;
+  CaptureEventsDecompressor& operator=(CaptureEventsDecompressor&&) = delete;
+
+  // Replaces the content of `data` with the decompressed content of `compressed_block`. After an
+  // error, the following blocks can't be decompressed either.
+  [[nodiscard]] ErrorMessageOr<void> DecompressBlock(std::string_view compressed_block,
+                                                     std::string* data);
+
+ private:
+  std::unique_ptr<z_stream_s> stream_;
+  bool stream_corrupted_ = false;
+};
+
+}  // namespace orbit_grpc_protos
+
+#endif  // GRPC_PROTOS_CAPTURE_EVENTS_COMPRESSION_H_
@@ -7,28 +7,132 @@
 #include <absl/base/attributes.h>
 #include <absl/base/const_init.h>
 #include <absl/synchronization/mutex.h>
-#include <absl/time/time.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
-#include "OrbitBase/ThreadPool.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "SpscQueue.h"
 
+using orbit_introspection::SpscQueue;
 using orbit_introspection::TracingListener;
 using orbit_introspection::TracingScope;
 using orbit_introspection::TracingTimerCallback;
 
 ABSL_CONST_INIT static absl::Mutex global_tracing_mutex(absl::kConstInit);
-ABSL_CONST_INIT static TracingListener* global_tracing_listener = nullptr;
 
 // Tracing uses the same function table used by the Orbit API, but specifies its own functions.
 orbit_api_v0 g_orbit_api_v0;
 
+namespace {
+
+// Number of scopes an instrumented thread can record before the consumer thread drains them. When
+// the queue is full, the instrumented thread waits for the consumer instead of dropping scopes.
+constexpr size_t kThreadScopeQueueCapacity = 1024;
+// Maximum number of scopes consumed from one queue before moving to the next one, so that a thread
+// producing scopes continuously can't delay the others indefinitely.
+constexpr size_t kMaxScopesConsumedPerQueue = 256;
+// After finding all queues empty this many times in a row, the consumer thread stops polling and
+// sleeps until an instrumented thread records a scope.
+constexpr size_t kConsumerEmptyRoundsBeforeIdling = 64;
+
+// Set on the consumer thread, so that scopes emitted from the user callback are ignored.
+thread_local bool is_internal_update = false;
+
+// Set by the consumer thread before it goes to sleep. The first instrumented thread to push a scope
+// after that clears it and wakes the consumer up, so the common case only costs an atomic load.
+std::atomic<bool> consumer_idle = false;
+ABSL_CONST_INIT absl::Mutex consumer_wakeup_mutex(absl::kConstInit);
+bool consumer_wakeup_requested ABSL_GUARDED_BY(consumer_wakeup_mutex) = false;
+
+void WakeUpConsumer() {
+  absl::MutexLock lock(&consumer_wakeup_mutex);
+  consumer_wakeup_requested = true;
+}
+
+struct ThreadScopeQueue {
+  SpscQueue<TracingScope> queue{kThreadScopeQueueCapacity};
+  std::atomic<bool> thread_exited = false;
+};
+
+// Queues of all the threads that have recorded scopes, and that haven't exited and been drained
+// since. Leaked on purpose, as threads can still record scopes during static destruction.
+ABSL_CONST_INIT absl::Mutex thread_scope_queues_mutex(absl::kConstInit);
+std::vector<std::shared_ptr<ThreadScopeQueue>>& GetThreadScopeQueues()
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(thread_scope_queues_mutex) {
+  static auto* thread_scope_queues = new std::vector<std::shared_ptr<ThreadScopeQueue>>();
+  return *thread_scope_queues;
+}
+
+// Registers the queue of the calling thread on construction, and marks it for removal once the
+// thread exits. The queue itself is only destroyed once the consumer has stopped using it.
+class ThreadScopeQueueRegistration {
+ public:
+  ThreadScopeQueueRegistration() : queue_{std::make_shared<ThreadScopeQueue>()} {
+    absl::MutexLock lock(&thread_scope_queues_mutex);
+    GetThreadScopeQueues().push_back(queue_);
+  }
+  ~ThreadScopeQueueRegistration() { queue_->thread_exited.store(true, std::memory_order_release); }
+
+  ThreadScopeQueueRegistration(const ThreadScopeQueueRegistration&) = delete;
+  ThreadScopeQueueRegistration& operator=(const ThreadScopeQueueRegistration&) = delete;
+
+  [[nodiscard]] SpscQueue<TracingScope>& queue() { return queue_->queue; }
+
+ private:
+  std::shared_ptr<ThreadScopeQueue> queue_;
+};
+
+SpscQueue<TracingScope>& GetThreadScopeQueue() {
+  thread_local ThreadScopeQueueRegistration registration;
+  return registration.queue();
+}
+
+// Consumes the scopes of all registered queues, calling `consumer` on each of them, and returns the
+// number of scopes consumed. Must only be called from one thread at a time.
+template <typename Consumer>
+size_t ConsumeThreadScopeQueues(Consumer&& consumer) {
+  std::vector<std::shared_ptr<ThreadScopeQueue>> queues;
+  {
+    absl::MutexLock lock(&thread_scope_queues_mutex);
+    queues = GetThreadScopeQueues();
+  }
+
+  size_t consumed_count = 0;
+  std::vector<std::shared_ptr<ThreadScopeQueue>> drained_exited_queues;
+  for (const std::shared_ptr<ThreadScopeQueue>& queue : queues) {
+    // Everything the thread pushed before exiting is visible once thread_exited has been observed,
+    // so such a queue can be drained completely and then forgotten.
+    const bool thread_exited = queue->thread_exited.load(std::memory_order_acquire);
+    size_t count;
+    do {
+      count = queue->queue.Consume(kMaxScopesConsumedPerQueue, consumer);
+      consumed_count += count;
+    } while (thread_exited && count > 0);
+    if (thread_exited) drained_exited_queues.push_back(queue);
+  }
+
+  if (!drained_exited_queues.empty()) {
+    absl::MutexLock lock(&thread_scope_queues_mutex);
+    std::vector<std::shared_ptr<ThreadScopeQueue>>& registered_queues = GetThreadScopeQueues();
+    for (const std::shared_ptr<ThreadScopeQueue>& queue : drained_exited_queues) {
+      registered_queues.erase(
+          std::remove(registered_queues.begin(), registered_queues.end(), queue),
+          registered_queues.end());
+    }
+  }
+  return consumed_count;
+}
+
+}  // namespace
+
 namespace orbit_introspection {
 
 void InitializeTracing();
@@ -38,67 +142,104 @@ TracingScope::TracingScope(orbit_api::EventType type, const char* name, uint64_t
     : encoded_event(type, name, data, color) {}
 
 TracingListener::TracingListener(TracingTimerCallback callback) {
-  constexpr size_t kMinNumThreads = 1;
-  constexpr size_t kMaxNumThreads = 1;
-  thread_pool_ = ThreadPool::Create(kMinNumThreads, kMaxNumThreads, absl::Milliseconds(500));
   user_callback_ = std::move(callback);
 
   // Activate listener (only one listener instance is supported).
   absl::MutexLock lock(&global_tracing_mutex);
   CHECK(!IsActive());
+  // Discard the scopes recorded while the previous listener was shutting down.
+  ConsumeThreadScopeQueues([](const TracingScope& /*scope*/) {});
   InitializeTracing();
-  global_tracing_listener = this;
   active_ = true;
   shutdown_initiated_ = false;
+  consumer_thread_ = std::thread([this] { ConsumeScopes(); });
 }
 
 TracingListener::~TracingListener() {
-  // Communicate that the thread pool will be shut down before shutting down
-  // the thread pool itself.
-  // Note that this is required, as otherwise, we might allow scheduling
-  // new events on the already shut down thread pool.
+  // Communicate that the listener is shutting down before stopping the consumer thread, so that
+  // instrumented threads waiting for space in their queue give up.
   {
     absl::MutexLock lock(&global_tracing_mutex);
     CHECK(IsActive());
     shutdown_initiated_ = true;
   }
   // Purge deferred scopes.
-  thread_pool_->Shutdown();
-  thread_pool_->Wait();
+  {
+    absl::MutexLock lock(&consumer_mutex_);
+    consumer_exit_requested_ = true;
+  }
+  WakeUpConsumer();
+  consumer_thread_.join();
 
-  // Deactivate and destroy the listener.
+  // Deactivate the listener.
   absl::MutexLock lock(&global_tracing_mutex);
   active_ = false;
-  global_tracing_listener = nullptr;
 }
 
-}  // namespace orbit_introspection
-
-namespace {
-struct ScopeToggle {
-  ScopeToggle() = delete;
-  ScopeToggle(bool* value, bool initial_value) : toggle(value) { *toggle = initial_value; }
-  ~ScopeToggle() { *toggle = !*toggle; }
-  bool* toggle = nullptr;
-};
-}  // namespace
+void TracingListener::ConsumeScopes() {
+  orbit_base::SetCurrentThreadName("TracingListener");
+  is_internal_update = true;
+  size_t empty_round_count = 0;
+  while (true) {
+    bool exit_requested;
+    {
+      absl::MutexLock lock(&consumer_mutex_);
+      exit_requested = consumer_exit_requested_;
+    }
+    // Always drain once more after the exit request was observed.
+    size_t consumed_count = ConsumeThreadScopeQueues(user_callback_);
+    if (exit_requested) return;
+    if (consumed_count > 0) {
+      empty_round_count = 0;
+      continue;
+    }
+    // Instrumented threads that were just active are likely to record more scopes soon.
+    if (++empty_round_count < kConsumerEmptyRoundsBeforeIdling) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Announce that the consumer is going to sleep before checking the queues one last time. Paired
+    // with the fence in DeferScopeProcessing, this guarantees that either this check sees the new
+    // scope or the instrumented thread sees consumer_idle and wakes the consumer up.
+    consumer_idle.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ConsumeThreadScopeQueues(user_callback_) > 0) {
+      consumer_idle.store(false, std::memory_order_relaxed);
+      empty_round_count = 0;
+      continue;
+    }
+
+    absl::MutexLock lock(&consumer_wakeup_mutex);
+    consumer_wakeup_mutex.Await(absl::Condition(&consumer_wakeup_requested));
+    consumer_wakeup_requested = false;
+    consumer_idle.store(false, std::memory_order_relaxed);
+    empty_round_count = 0;
+  }
+}
 
 void TracingListener::DeferScopeProcessing(const TracingScope& scope) {
   // Prevent reentry to avoid feedback loop.
-  thread_local bool is_internal_update = false;
   if (is_internal_update) return;
-
-  // User callback is called from a worker thread to minimize contention on instrumented threads.
-  absl::MutexLock lock(&global_tracing_mutex);
   if (IsShutdownInitiated()) return;
-  global_tracing_listener->thread_pool_->Schedule([scope]() {
-    ScopeToggle scope_toggle(&is_internal_update, true);
-    absl::MutexLock lock(&global_tracing_mutex);
-    if (!IsActive()) return;
-    global_tracing_listener->user_callback_(scope);
-  });
+
+  // The user callback is called from the consumer thread to minimize the work on instrumented
+  // threads.
+  SpscQueue<TracingScope>& queue = GetThreadScopeQueue();
+  while (!queue.TryPush(scope)) {
+    if (IsShutdownInitiated()) return;
+    std::this_thread::yield();
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (consumer_idle.load(std::memory_order_relaxed) &&
+      consumer_idle.exchange(false, std::memory_order_relaxed)) {
+    WakeUpConsumer();
+  }
 }
 
+}  // namespace orbit_introspection
+
 static std::vector<TracingScope>& GetThreadLocalScopes() {
   thread_local std::vector<TracingScope> thread_local_scopes;
   return thread_local_scopes;
@@ -5,13 +5,16 @@
 #include <absl/container/flat_hash_map.h>
 #include <gtest/gtest.h>
 #include <stddef.h>
+#include <time.h>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <thread>
 #include <vector>
 
 #include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadUtils.h"
 
 static void TestScopes() {
@@ -58,4 +61,82 @@ TEST(Tracing, Scopes) {
   }
 }
 
+TEST(Tracing, NoScopesAreLostWhenProducingFasterThanConsuming) {
+  constexpr size_t kNumScopes = 100'000;
+  std::atomic<size_t> num_received_scopes = 0;
+  {
+    TracingListener tracing_listener(
+        [&num_received_scopes](const TracingScope& /*scope*/) { ++num_received_scopes; });
+    std::thread thread([] {
+      for (size_t i = 0; i < kNumScopes; ++i) {
+        ORBIT_SCOPE("TEST_ORBIT_SCOPE");
+      }
+    });
+    thread.join();
+  }
+  EXPECT_EQ(num_received_scopes, kNumScopes);
+}
+
+TEST(Tracing, ScopesAreOnlyReportedToTheActiveListener) {
+  std::atomic<size_t> num_scopes_first_listener = 0;
+  {
+    TracingListener tracing_listener(
+        [&num_scopes_first_listener](const TracingScope& /*scope*/) {
+          ++num_scopes_first_listener;
+        });
+    TestScopes();
+  }
+  // No listener.
+  TestScopes();
+
+  std::atomic<size_t> num_scopes_second_listener = 0;
+  {
+    TracingListener tracing_listener(
+        [&num_scopes_second_listener](const TracingScope& /*scope*/) {
+          ++num_scopes_second_listener;
+        });
+    TestScopes();
+  }
+  EXPECT_EQ(num_scopes_first_listener, 4);
+  EXPECT_EQ(num_scopes_second_listener, 4);
+}
+
+static uint64_t GetCurrentThreadCpuTimeNs() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+// Reports the CPU time a scope costs the instrumented thread, with up to 64 threads recording
+// scopes at the same time. Only useful when working on Introspection, so it is disabled.
+TEST(Tracing, DISABLED_ScopeCostBenchmark) {
+  constexpr size_t kNumScopesPerThread = 100'000;
+  for (size_t num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    std::atomic<uint64_t> total_duration_ns = 0;
+    std::atomic<size_t> num_received_scopes = 0;
+    {
+      TracingListener tracing_listener(
+          [&num_received_scopes](const TracingScope& /*scope*/) { ++num_received_scopes; });
+
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&total_duration_ns] {
+          uint64_t start_ns = GetCurrentThreadCpuTimeNs();
+          for (size_t i = 0; i < kNumScopesPerThread; ++i) {
+            ORBIT_SCOPE("TEST_ORBIT_SCOPE");
+          }
+          total_duration_ns += GetCurrentThreadCpuTimeNs() - start_ns;
+        });
+      }
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+    }
+
+    EXPECT_EQ(num_received_scopes, num_threads * kNumScopesPerThread);
+    LOG("%2u threads: %.1f ns per scope", num_threads,
+        static_cast<double>(total_duration_ns) / (num_threads * kNumScopesPerThread));
+  }
+}
+
 }  // namespace orbit_introspection
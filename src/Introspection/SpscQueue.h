@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INTROSPECTION_SPSC_QUEUE_H_
+#define INTROSPECTION_SPSC_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_introspection {
+
+// Bounded, lock-free queue for exactly one producer thread and one consumer thread. All the memory
+// is allocated on construction: neither TryPush nor Consume ever allocates or blocks.
+template <typename T>
+class SpscQueue {
+ public:
+  // `capacity` must be a power of two.
+  explicit SpscQueue(size_t capacity) : elements_(capacity), index_mask_{capacity - 1} {
+    CHECK(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+  // Only to be called by the producer. Returns false if the queue is full.
+  [[nodiscard]] bool TryPush(const T& element) {
+    const uint64_t write_index = write_index_.load(std::memory_order_relaxed);
+    if (write_index - cached_read_index_ >= elements_.size()) {
+      cached_read_index_ = read_index_.load(std::memory_order_acquire);
+      if (write_index - cached_read_index_ >= elements_.size()) return false;
+    }
+    elements_[write_index & index_mask_] = element;
+    write_index_.store(write_index + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only to be called by the consumer. Calls `consumer` on at most `max_count` elements, oldest
+  // first, and returns the number of elements consumed. The slots are only handed back to the
+  // producer once the whole batch has been consumed.
+  template <typename Consumer>
+  size_t Consume(size_t max_count, Consumer&& consumer) {
+    const uint64_t read_index = read_index_.load(std::memory_order_relaxed);
+    const uint64_t write_index = write_index_.load(std::memory_order_acquire);
+    const size_t count = std::min<uint64_t>(write_index - read_index, max_count);
+    for (size_t i = 0; i < count; ++i) {
+      consumer(static_cast<const T&>(elements_[(read_index + i) & index_mask_]));
+    }
+    read_index_.store(read_index + count, std::memory_order_release);
+    return count;
+  }
+
+  [[nodiscard]] size_t capacity() const { return elements_.size(); }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  std::vector<T> elements_;
+  const uint64_t index_mask_;
+
+  // Written by the producer only. The producer's copy of read_index_ avoids touching the consumer's
+  // cache line on every push.
+  alignas(kCacheLineSize) std::atomic<uint64_t> write_index_ = 0;
+  uint64_t cached_read_index_ = 0;
+
+  // Written by the consumer only.
+  alignas(kCacheLineSize) std::atomic<uint64_t> read_index_ = 0;
+};
+
+}  // namespace orbit_introspection
+
+#endif  // INTROSPECTION_SPSC_QUEUE_H_
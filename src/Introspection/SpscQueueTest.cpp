@@ -0,0 +1,75 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <thread>
+#include <vector>
+
+#include "SpscQueue.h"
+
+namespace orbit_introspection {
+
+TEST(SpscQueue, PushAndConsumeInOrder) {
+  SpscQueue<int> queue{4};
+  EXPECT_EQ(queue.capacity(), 4);
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  EXPECT_TRUE(queue.TryPush(3));
+
+  std::vector<int> consumed;
+  EXPECT_EQ(queue.Consume(2, [&consumed](int element) { consumed.push_back(element); }), 2);
+  EXPECT_EQ(consumed, (std::vector<int>{1, 2}));
+
+  EXPECT_EQ(queue.Consume(10, [&consumed](int element) { consumed.push_back(element); }), 1);
+  EXPECT_EQ(consumed, (std::vector<int>{1, 2, 3}));
+
+  EXPECT_EQ(queue.Consume(10, [&consumed](int element) { consumed.push_back(element); }), 0);
+}
+
+TEST(SpscQueue, TryPushFailsWhenFull) {
+  SpscQueue<int> queue{2};
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  EXPECT_FALSE(queue.TryPush(3));
+
+  EXPECT_EQ(queue.Consume(1, [](int element) { EXPECT_EQ(element, 1); }), 1);
+  EXPECT_TRUE(queue.TryPush(3));
+  EXPECT_FALSE(queue.TryPush(4));
+
+  std::vector<int> consumed;
+  EXPECT_EQ(queue.Consume(10, [&consumed](int element) { consumed.push_back(element); }), 2);
+  EXPECT_EQ(consumed, (std::vector<int>{2, 3}));
+}
+
+TEST(SpscQueue, InvalidCapacity) {
+  EXPECT_DEATH(SpscQueue<int>{3}, "Check failed");
+  EXPECT_DEATH(SpscQueue<int>{0}, "Check failed");
+}
+
+TEST(SpscQueue, ConcurrentProducerAndConsumer) {
+  constexpr uint64_t kElementCount = 1'000'000;
+  SpscQueue<uint64_t> queue{64};
+
+  std::thread producer([&queue] {
+    for (uint64_t i = 0; i < kElementCount; ++i) {
+      while (!queue.TryPush(i)) std::this_thread::yield();
+    }
+  });
+
+  uint64_t expected_element = 0;
+  while (expected_element < kElementCount) {
+    size_t count = queue.Consume(16, [&expected_element](uint64_t element) {
+      EXPECT_EQ(element, expected_element);
+      ++expected_element;
+    });
+    if (count == 0) std::this_thread::yield();
+  }
+  producer.join();
+  EXPECT_EQ(queue.Consume(16, [](uint64_t /*element*/) {}), 0);
+}
+
+}  // namespace orbit_introspection
@@ -5,14 +5,17 @@
 #ifndef INTROSPECTION_INTROSPECTION_H_
 #define INTROSPECTION_INTROSPECTION_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <thread>
 
 #include "Api/EncodedEvent.h"
 #include "Api/Orbit.h"
-#include "OrbitBase/ThreadPool.h"
 #include "OrbitBase/ThreadUtils.h"
 
 #define ORBIT_SCOPE_FUNCTION ORBIT_SCOPE(__FUNCTION__)
@@ -20,6 +23,7 @@
 namespace orbit_introspection {
 
 struct TracingScope {
+  TracingScope() = default;
   TracingScope(orbit_api::EventType type, const char* name = nullptr, uint64_t data = 0,
                orbit_api_color color = kOrbitColorAuto);
   uint64_t begin = 0;
@@ -31,6 +35,9 @@ struct TracingScope {
 
 using TracingTimerCallback = std::function<void(const TracingScope& scope)>;
 
+// Scopes are recorded in a lock-free queue owned by the instrumented thread, allocated the first
+// time the thread records a scope, so that instrumented threads never take a lock nor allocate.
+// A single thread owned by the listener drains all the queues in batches and calls the callback.
 class TracingListener {
  public:
   explicit TracingListener(TracingTimerCallback callback);
@@ -41,10 +48,14 @@ class TracingListener {
   [[nodiscard]] inline static bool IsShutdownInitiated() { return shutdown_initiated_; }
 
  private:
+  void ConsumeScopes();
+
   TracingTimerCallback user_callback_ = nullptr;
-  std::shared_ptr<ThreadPool> thread_pool_ = {};
-  inline static bool active_ = false;
-  inline static bool shutdown_initiated_ = true;
+  std::thread consumer_thread_;
+  absl::Mutex consumer_mutex_;
+  bool consumer_exit_requested_ ABSL_GUARDED_BY(consumer_mutex_) = false;
+  inline static std::atomic<bool> active_ = false;
+  inline static std::atomic<bool> shutdown_initiated_ = true;
 };
 
 }  // namespace orbit_introspection
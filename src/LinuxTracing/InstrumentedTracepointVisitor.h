@@ -0,0 +1,57 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_INSTRUMENTED_TRACEPOINT_VISITOR_H_
+#define LINUX_TRACING_INSTRUMENTED_TRACEPOINT_VISITOR_H_
+
+#include <absl/container/flat_hash_map.h>
+
+#include "LinuxTracing/TracerListener.h"
+#include "OrbitBase/Logging.h"
+#include "PerfEvent.h"
+#include "PerfEventVisitor.h"
+#include "capture.pb.h"
+#include "tracepoint.pb.h"
+
+namespace orbit_linux_tracing {
+
+// This class processes the GenericTracepointPerfEvents of the tracepoints selected by the user and
+// sends the corresponding FullTracepointEvents to the TracerListener. `ids_to_tracepoint_info`
+// maps the stream ids of the tracepoints to their category and name, and must outlive this object.
+class InstrumentedTracepointVisitor : public PerfEventVisitor {
+ public:
+  explicit InstrumentedTracepointVisitor(
+      TracerListener* listener,
+      const absl::flat_hash_map<uint64_t, orbit_grpc_protos::TracepointInfo>*
+          ids_to_tracepoint_info)
+      : listener_{listener}, ids_to_tracepoint_info_{ids_to_tracepoint_info} {
+    CHECK(listener_ != nullptr);
+    CHECK(ids_to_tracepoint_info_ != nullptr);
+  }
+
+  void Visit(GenericTracepointPerfEvent* event) override {
+    auto it = ids_to_tracepoint_info_->find(event->GetStreamId());
+    if (it == ids_to_tracepoint_info_->end()) return;
+
+    orbit_grpc_protos::FullTracepointEvent tracepoint_event;
+    tracepoint_event.set_pid(event->GetPid());
+    tracepoint_event.set_tid(event->GetTid());
+    tracepoint_event.set_timestamp_ns(event->GetTimestamp());
+    tracepoint_event.set_cpu(event->GetCpu());
+
+    orbit_grpc_protos::TracepointInfo* tracepoint = tracepoint_event.mutable_tracepoint_info();
+    tracepoint->set_name(it->second.name());
+    tracepoint->set_category(it->second.category());
+
+    listener_->OnTracepointEvent(std::move(tracepoint_event));
+  }
+
+ private:
+  TracerListener* listener_;
+  const absl::flat_hash_map<uint64_t, orbit_grpc_protos::TracepointInfo>* ids_to_tracepoint_info_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_INSTRUMENTED_TRACEPOINT_VISITOR_H_
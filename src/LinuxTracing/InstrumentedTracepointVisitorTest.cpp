@@ -0,0 +1,94 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "InstrumentedTracepointVisitor.h"
+#include "LinuxTracing/TracerListener.h"
+#include "PerfEvent.h"
+#include "capture.pb.h"
+#include "tracepoint.pb.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class MockTracerListener : public TracerListener {
+ public:
+  MOCK_METHOD(void, OnSchedulingSlice, (orbit_grpc_protos::SchedulingSlice), (override));
+  MOCK_METHOD(void, OnCallstackSample, (orbit_grpc_protos::FullCallstackSample), (override));
+  MOCK_METHOD(void, OnFunctionCall, (orbit_grpc_protos::FunctionCall), (override));
+  MOCK_METHOD(void, OnIntrospectionScope, (orbit_grpc_protos::IntrospectionScope), (override));
+  MOCK_METHOD(void, OnGpuJob, (orbit_grpc_protos::FullGpuJob full_gpu_job), (override));
+  MOCK_METHOD(void, OnThreadName, (orbit_grpc_protos::ThreadName), (override));
+  MOCK_METHOD(void, OnThreadNamesSnapshot, (orbit_grpc_protos::ThreadNamesSnapshot), (override));
+  MOCK_METHOD(void, OnThreadStateSlice, (orbit_grpc_protos::ThreadStateSlice), (override));
+  MOCK_METHOD(void, OnAddressInfo, (orbit_grpc_protos::FullAddressInfo), (override));
+  MOCK_METHOD(void, OnTracepointEvent, (orbit_grpc_protos::FullTracepointEvent), (override));
+  MOCK_METHOD(void, OnModuleUpdate, (orbit_grpc_protos::ModuleUpdateEvent), (override));
+  MOCK_METHOD(void, OnModulesSnapshot, (orbit_grpc_protos::ModulesSnapshot), (override));
+  MOCK_METHOD(void, OnErrorsWithPerfEventOpenEvent,
+              (orbit_grpc_protos::ErrorsWithPerfEventOpenEvent), (override));
+  MOCK_METHOD(void, OnLostPerfRecordsEvent, (orbit_grpc_protos::LostPerfRecordsEvent), (override));
+  MOCK_METHOD(void, OnOutOfOrderEventsDiscardedEvent,
+              (orbit_grpc_protos::OutOfOrderEventsDiscardedEvent), (override));
+};
+
+constexpr uint64_t kStreamId = 42;
+
+[[nodiscard]] std::unique_ptr<GenericTracepointPerfEvent> MakeFakeGenericTracepointPerfEvent(
+    uint64_t stream_id) {
+  auto event = std::make_unique<GenericTracepointPerfEvent>();
+  event->ring_buffer_record.sample_id.pid = 10;
+  event->ring_buffer_record.sample_id.tid = 11;
+  event->ring_buffer_record.sample_id.time = 1234;
+  event->ring_buffer_record.sample_id.stream_id = stream_id;
+  event->ring_buffer_record.sample_id.cpu = 3;
+  return event;
+}
+
+class InstrumentedTracepointVisitorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    orbit_grpc_protos::TracepointInfo tracepoint_info;
+    tracepoint_info.set_category("sched");
+    tracepoint_info.set_name("sched_switch");
+    ids_to_tracepoint_info_.emplace(kStreamId, tracepoint_info);
+  }
+
+  MockTracerListener mock_listener_;
+  absl::flat_hash_map<uint64_t, orbit_grpc_protos::TracepointInfo> ids_to_tracepoint_info_;
+  InstrumentedTracepointVisitor visitor_{&mock_listener_, &ids_to_tracepoint_info_};
+};
+
+}  // namespace
+
+TEST_F(InstrumentedTracepointVisitorTest, VisitGenericTracepointPerfEventCallsOnTracepointEvent) {
+  orbit_grpc_protos::FullTracepointEvent actual_tracepoint_event;
+  EXPECT_CALL(mock_listener_, OnTracepointEvent)
+      .Times(1)
+      .WillOnce(::testing::SaveArg<0>(&actual_tracepoint_event));
+
+  MakeFakeGenericTracepointPerfEvent(kStreamId)->Accept(&visitor_);
+
+  EXPECT_EQ(actual_tracepoint_event.pid(), 10);
+  EXPECT_EQ(actual_tracepoint_event.tid(), 11);
+  EXPECT_EQ(actual_tracepoint_event.timestamp_ns(), 1234);
+  EXPECT_EQ(actual_tracepoint_event.cpu(), 3);
+  EXPECT_EQ(actual_tracepoint_event.tracepoint_info().category(), "sched");
+  EXPECT_EQ(actual_tracepoint_event.tracepoint_info().name(), "sched_switch");
+}
+
+TEST_F(InstrumentedTracepointVisitorTest, EventsOfUnknownStreamIdsAreIgnored) {
+  EXPECT_CALL(mock_listener_, OnTracepointEvent).Times(0);
+
+  MakeFakeGenericTracepointPerfEvent(kStreamId + 1)->Accept(&visitor_);
+}
+
+}  // namespace orbit_linux_tracing
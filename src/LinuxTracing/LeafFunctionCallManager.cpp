@@ -74,14 +74,7 @@ Callstack::CallstackType LeafFunctionCallManager::PatchCallerOfLeafFunction(
     return Callstack::kFramePointerUnwindingError;
   }
 
-  const std::vector<uint64_t> original_callchain = event->ips;
-  CHECK(original_callchain.size() > 2);
-
-  std::vector<uint64_t> result;
-  result.reserve(original_callchain.size() + 1);
-  for (size_t i = 0; i < 2; ++i) {
-    result.push_back(original_callchain[i]);
-  }
+  CHECK(event->ips.size() > 2);
 
   CHECK(libunwindstack_callstack.size() == 2);
   uint64_t libunwindstack_leaf_caller_pc = libunwindstack_callstack[1].pc;
@@ -94,14 +87,9 @@ Callstack::CallstackType LeafFunctionCallManager::PatchCallerOfLeafFunction(
 
   // perf_event_open's callstack always contains the return address. Libunwindstack has already
   // decreased the address by one. To not mix them, increase the address again.
-  result.push_back(libunwindstack_leaf_caller_pc + 1);
-
-  for (size_t i = 2; i < original_callchain.size(); ++i) {
-    result.push_back(original_callchain[i]);
-  }
-
-  event->ring_buffer_record.nr = result.size();
-  event->ips = std::move(result);
+  // The caller goes right after the kernel frame and the frame of the leaf function.
+  event->ips.insert(event->ips.begin() + 2, libunwindstack_leaf_caller_pc + 1);
+  event->ring_buffer_record.nr = event->ips.size();
 
   return Callstack::kComplete;
 }
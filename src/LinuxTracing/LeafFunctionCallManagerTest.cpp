@@ -140,7 +140,7 @@ TEST_F(LeafFunctionCallManagerTest, PatchCallerOfLeafFunctionReturnsErrorOnSmall
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   event.regs.bp = 2 * kStackDumpSize;
   event.regs.sp = 0;
@@ -171,7 +171,7 @@ TEST_F(LeafFunctionCallManagerTest, PatchCallerOfLeafFunctionReturnsErrorOnUnwin
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
   event.regs.bp = kStackDumpSize;
   event.regs.sp = 10;
 
@@ -229,7 +229,7 @@ TEST_F(LeafFunctionCallManagerTest, PatchCallerOfLeafFunctionReturnsErrorOnNoFra
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
   event.regs.bp = kStackDumpSize;
   event.regs.sp = 10;
 
@@ -273,7 +273,7 @@ TEST_F(LeafFunctionCallManagerTest,
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
   event.regs.bp = kStackDumpSize;
   event.regs.sp = 10;
 
@@ -315,7 +315,7 @@ TEST_F(LeafFunctionCallManagerTest,
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
   event.regs.bp = kStackDumpSize;
   event.regs.sp = 10;
 
@@ -52,7 +52,6 @@ class LibunwindstackUnwinder {
   static std::unique_ptr<LibunwindstackUnwinder> Create();
   static std::string LibunwindstackErrorString(unwindstack::ErrorCode error_code);
 
- protected:
   static constexpr size_t kDefaultMaxFrames = 1024;  // This is arbitrary.
 };
 }  // namespace orbit_linux_tracing
@@ -19,7 +19,7 @@
 
 #include "Function.h"
 #include "KernelTracepoints.h"
-#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "PerfEventAllocator.h"
 #include "PerfEventRecords.h"
 
 namespace orbit_linux_tracing {
@@ -35,6 +35,11 @@ class PerfEventVisitor;
 class PerfEvent {
  public:
   virtual ~PerfEvent() = default;
+
+  // PerfEvents are created and destroyed at a very high rate, so recycle their memory.
+  static void* operator new(size_t size) { return PerfEventAllocator::Allocate(size); }
+  static void operator delete(void* ptr, size_t size) { PerfEventAllocator::Deallocate(ptr, size); }
+
   virtual uint64_t GetTimestamp() const = 0;
   virtual void Accept(PerfEventVisitor* visitor) = 0;
 
@@ -186,10 +191,10 @@ class DiscardedPerfEvent : public PerfEvent {
 
 struct dynamically_sized_perf_event_sample_stack_user {
   uint64_t dyn_size;
-  std::unique_ptr<char[]> data;
+  PooledArray<char> data;
 
   explicit dynamically_sized_perf_event_sample_stack_user(uint64_t dyn_size)
-      : dyn_size{dyn_size}, data{make_unique_for_overwrite<char[]>(dyn_size)} {}
+      : dyn_size{dyn_size}, data{MakePooledArrayForOverwrite<char>(dyn_size)} {}
 };
 
 struct dynamically_sized_perf_event_stack_sample {
@@ -203,29 +208,28 @@ struct dynamically_sized_perf_event_stack_sample {
 
 class StackSamplePerfEvent : public PerfEvent {
  public:
-  std::unique_ptr<dynamically_sized_perf_event_stack_sample> ring_buffer_record;
+  dynamically_sized_perf_event_stack_sample ring_buffer_record;
 
-  explicit StackSamplePerfEvent(uint64_t dyn_size)
-      : ring_buffer_record{std::make_unique<dynamically_sized_perf_event_stack_sample>(dyn_size)} {}
+  explicit StackSamplePerfEvent(uint64_t dyn_size) : ring_buffer_record{dyn_size} {}
 
-  uint64_t GetTimestamp() const override { return ring_buffer_record->sample_id.time; }
+  uint64_t GetTimestamp() const override { return ring_buffer_record.sample_id.time; }
 
   void Accept(PerfEventVisitor* visitor) override;
 
-  pid_t GetPid() const { return ring_buffer_record->sample_id.pid; }
-  pid_t GetTid() const { return ring_buffer_record->sample_id.tid; }
+  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
+  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
 
-  uint64_t GetStreamId() const { return ring_buffer_record->sample_id.stream_id; }
+  uint64_t GetStreamId() const { return ring_buffer_record.sample_id.stream_id; }
 
-  uint32_t GetCpu() const { return ring_buffer_record->sample_id.cpu; }
+  uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
 
   std::array<uint64_t, PERF_REG_X86_64_MAX> GetRegisters() const {
-    return perf_event_sample_regs_user_all_to_register_array(ring_buffer_record->regs);
+    return perf_event_sample_regs_user_all_to_register_array(ring_buffer_record.regs);
   }
 
-  const char* GetStackData() const { return ring_buffer_record->stack.data.get(); }
-  char* GetStackData() { return ring_buffer_record->stack.data.get(); }
-  uint64_t GetStackSize() const { return ring_buffer_record->stack.dyn_size; }
+  const char* GetStackData() const { return ring_buffer_record.stack.data.get(); }
+  char* GetStackData() { return ring_buffer_record.stack.data.get(); }
+  uint64_t GetStackSize() const { return ring_buffer_record.stack.dyn_size; }
 
  private:
 };
@@ -233,7 +237,7 @@ class StackSamplePerfEvent : public PerfEvent {
 class CallchainSamplePerfEvent : public PerfEvent {
  public:
   perf_event_callchain_sample_fixed ring_buffer_record;
-  std::vector<uint64_t> ips;
+  std::vector<uint64_t, PerfEventPoolAllocator<uint64_t>> ips;
   perf_event_sample_regs_user_all regs;
   dynamically_sized_perf_event_sample_stack_user stack;
 
@@ -357,16 +361,18 @@ class GenericTracepointPerfEvent : public PerfEvent {
 
   uint64_t GetTimestamp() const override { return ring_buffer_record.sample_id.time; }
 
+  uint64_t GetStreamId() const { return ring_buffer_record.sample_id.stream_id; }
+
   uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
 };
 
 class TracepointPerfEvent : public PerfEvent {
  public:
   explicit TracepointPerfEvent(uint32_t size)
-      : tracepoint_data{make_unique_for_overwrite<uint8_t[]>(size)} {}
+      : tracepoint_data{MakePooledArrayForOverwrite<uint8_t>(size)} {}
 
   perf_event_raw_sample_fixed ring_buffer_record;
-  std::unique_ptr<uint8_t[]> tracepoint_data;
+  PooledArray<uint8_t> tracepoint_data;
 
   uint64_t GetTimestamp() const override { return ring_buffer_record.sample_id.time; }
 
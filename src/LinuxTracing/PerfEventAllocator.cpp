@@ -0,0 +1,141 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PerfEventAllocator.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr size_t kMinPooledSizeLog2 = 5;
+constexpr size_t kMaxPooledSizeLog2 = 16;
+static_assert(PerfEventAllocator::kMaxPooledSize == (1ul << kMaxPooledSizeLog2));
+constexpr size_t kSizeClassCount = kMaxPooledSizeLog2 - kMinPooledSizeLog2 + 1;
+
+// Blocks beyond this are returned to the system when freed, so that an unusually large burst of
+// events doesn't permanently increase the memory footprint.
+constexpr size_t kMaxRetainedBytesPerSizeClass = 128 * 1024 * 1024;
+
+// A free block stores the pointer to the next free block of the same size class in its first bytes.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct alignas(64) SizeClass {
+  std::mutex mutex;
+  FreeBlock* free_list = nullptr;
+  size_t free_block_count = 0;
+  uint64_t pooled_allocation_count = 0;
+  uint64_t system_allocation_count = 0;
+};
+
+struct Pools {
+  std::array<SizeClass, kSizeClassCount> size_classes;
+  std::atomic<uint64_t> unpooled_allocation_count = 0;
+};
+
+Pools& GetPools() {
+  // Intentionally leaked, as PerfEvents could still be destroyed during static destruction.
+  static auto* pools = new Pools();
+  return *pools;
+}
+
+size_t ComputeSizeClassIndex(size_t size) {
+  CHECK(size <= PerfEventAllocator::kMaxPooledSize);
+  if (size <= (1ul << kMinPooledSizeLog2)) return 0;
+  size_t size_log2 = 64 - __builtin_clzll(size - 1);
+  return size_log2 - kMinPooledSizeLog2;
+}
+
+size_t GetSizeClassBlockSize(size_t size_class_index) {
+  return 1ul << (size_class_index + kMinPooledSizeLog2);
+}
+
+}  // namespace
+
+void* PerfEventAllocator::Allocate(size_t size) {
+  Pools& pools = GetPools();
+  if (size > kMaxPooledSize) {
+    ++pools.unpooled_allocation_count;
+    return ::operator new(size);
+  }
+
+  size_t size_class_index = ComputeSizeClassIndex(size);
+  SizeClass& size_class = pools.size_classes[size_class_index];
+  {
+    std::lock_guard<std::mutex> lock{size_class.mutex};
+    if (size_class.free_list != nullptr) {
+      FreeBlock* block = size_class.free_list;
+      size_class.free_list = block->next;
+      --size_class.free_block_count;
+      ++size_class.pooled_allocation_count;
+      return block;
+    }
+    ++size_class.system_allocation_count;
+  }
+
+  return ::operator new(GetSizeClassBlockSize(size_class_index));
+}
+
+void PerfEventAllocator::Deallocate(void* ptr, size_t size) {
+  if (ptr == nullptr) return;
+  if (size > kMaxPooledSize) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  size_t size_class_index = ComputeSizeClassIndex(size);
+  SizeClass& size_class = GetPools().size_classes[size_class_index];
+  {
+    std::lock_guard<std::mutex> lock{size_class.mutex};
+    if ((size_class.free_block_count + 1) * GetSizeClassBlockSize(size_class_index) <=
+        kMaxRetainedBytesPerSizeClass) {
+      auto* block = new (ptr) FreeBlock{size_class.free_list};
+      size_class.free_list = block;
+      ++size_class.free_block_count;
+      return;
+    }
+  }
+  ::operator delete(ptr);
+}
+
+void PerfEventAllocator::ReleaseUnusedMemory() {
+  for (SizeClass& size_class : GetPools().size_classes) {
+    FreeBlock* free_list;
+    {
+      std::lock_guard<std::mutex> lock{size_class.mutex};
+      free_list = size_class.free_list;
+      size_class.free_list = nullptr;
+      size_class.free_block_count = 0;
+    }
+    while (free_list != nullptr) {
+      FreeBlock* next = free_list->next;
+      ::operator delete(free_list);
+      free_list = next;
+    }
+  }
+}
+
+PerfEventAllocator::Stats PerfEventAllocator::GetAndResetStats() {
+  Pools& pools = GetPools();
+  Stats stats;
+  stats.system_allocation_count = pools.unpooled_allocation_count.exchange(0);
+  for (SizeClass& size_class : pools.size_classes) {
+    std::lock_guard<std::mutex> lock{size_class.mutex};
+    stats.pooled_allocation_count += size_class.pooled_allocation_count;
+    stats.system_allocation_count += size_class.system_allocation_count;
+    size_class.pooled_allocation_count = 0;
+    size_class.system_allocation_count = 0;
+  }
+  return stats;
+}
+
+}  // namespace orbit_linux_tracing
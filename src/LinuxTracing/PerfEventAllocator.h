@@ -0,0 +1,99 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PERF_EVENT_ALLOCATOR_H_
+#define LINUX_TRACING_PERF_EVENT_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace orbit_linux_tracing {
+
+// Recycling allocator for PerfEvents and for the buffers they own (stack dumps, callchains,
+// tracepoint data). Every record read from the perf_event_open ring buffers results in at least one
+// such allocation, which happens on the thread that reads the ring buffers, while the corresponding
+// deallocation happens later on the thread that processes the events.
+//
+// Sizes are rounded up to the next power of two, and freed blocks are kept in a free list per size
+// class instead of being returned to the system. After the first few seconds of a capture, the free
+// lists contain enough blocks for all the events that are in flight, and malloc isn't called
+// anymore. Blocks larger than kMaxPooledSize are not pooled.
+class PerfEventAllocator {
+ public:
+  // Large enough for the biggest stack dump we request (see kMaxStackSampleUserSize).
+  static constexpr size_t kMaxPooledSize = 64 * 1024;
+
+  [[nodiscard]] static void* Allocate(size_t size);
+  static void Deallocate(void* ptr, size_t size);
+
+  // Returns all the blocks in the free lists to the system. Call when no capture is running so that
+  // the memory used during a capture is not retained by the service.
+  static void ReleaseUnusedMemory();
+
+  struct Stats {
+    uint64_t pooled_allocation_count = 0;
+    uint64_t system_allocation_count = 0;
+  };
+  // Returns the number of allocations served from the free lists and from the system since the last
+  // call, and resets the counters.
+  [[nodiscard]] static Stats GetAndResetStats();
+};
+
+// Deleter for arrays allocated with MakePooledArrayForOverwrite.
+template <typename T>
+class PooledArrayDeleter {
+ public:
+  PooledArrayDeleter() = default;
+  explicit PooledArrayDeleter(size_t count) : count_{count} {}
+
+  void operator()(T* ptr) const { PerfEventAllocator::Deallocate(ptr, count_ * sizeof(T)); }
+
+ private:
+  size_t count_ = 0;
+};
+
+template <typename T>
+using PooledArray = std::unique_ptr<T[], PooledArrayDeleter<T>>;
+
+// Like make_unique_for_overwrite<T[]>(count), but backed by PerfEventAllocator. The elements are
+// left uninitialized, which is why this is restricted to trivial types.
+template <typename T>
+[[nodiscard]] PooledArray<T> MakePooledArrayForOverwrite(size_t count) {
+  static_assert(std::is_trivial_v<T>);
+  return PooledArray<T>{static_cast<T*>(PerfEventAllocator::Allocate(count * sizeof(T))),
+                        PooledArrayDeleter<T>{count}};
+}
+
+// Standard allocator backed by PerfEventAllocator, for containers owned by PerfEvents or holding
+// PerfEvents.
+template <typename T>
+class PerfEventPoolAllocator {
+ public:
+  using value_type = T;
+
+  PerfEventPoolAllocator() = default;
+  template <typename U>
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  PerfEventPoolAllocator(const PerfEventPoolAllocator<U>& /*other*/) {}
+
+  [[nodiscard]] T* allocate(size_t n) {
+    return static_cast<T*>(PerfEventAllocator::Allocate(n * sizeof(T)));
+  }
+  void deallocate(T* ptr, size_t n) { PerfEventAllocator::Deallocate(ptr, n * sizeof(T)); }
+
+  template <typename U>
+  bool operator==(const PerfEventPoolAllocator<U>& /*other*/) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const PerfEventPoolAllocator<U>& /*other*/) const {
+    return false;
+  }
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PERF_EVENT_ALLOCATOR_H_
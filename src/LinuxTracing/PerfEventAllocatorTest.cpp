@@ -0,0 +1,98 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "PerfEvent.h"
+#include "PerfEventAllocator.h"
+
+namespace orbit_linux_tracing {
+
+TEST(PerfEventAllocator, FreedBlockIsReusedForSameSizeClass) {
+  PerfEventAllocator::ReleaseUnusedMemory();
+  (void)PerfEventAllocator::GetAndResetStats();
+
+  void* first = PerfEventAllocator::Allocate(100);
+  ASSERT_NE(first, nullptr);
+  PerfEventAllocator::Deallocate(first, 100);
+
+  // 100 and 120 bytes are both rounded up to 128 bytes.
+  void* second = PerfEventAllocator::Allocate(120);
+  EXPECT_EQ(second, first);
+  PerfEventAllocator::Deallocate(second, 120);
+
+  PerfEventAllocator::Stats stats = PerfEventAllocator::GetAndResetStats();
+  EXPECT_EQ(stats.system_allocation_count, 1);
+  EXPECT_EQ(stats.pooled_allocation_count, 1);
+}
+
+TEST(PerfEventAllocator, DifferentSizeClassesDontShareBlocks) {
+  PerfEventAllocator::ReleaseUnusedMemory();
+
+  void* small = PerfEventAllocator::Allocate(64);
+  PerfEventAllocator::Deallocate(small, 64);
+
+  void* large = PerfEventAllocator::Allocate(4096);
+  EXPECT_NE(large, small);
+  // The whole requested size must be usable.
+  memset(large, 0xAB, 4096);
+  PerfEventAllocator::Deallocate(large, 4096);
+}
+
+TEST(PerfEventAllocator, BlocksLargerThanMaxPooledSizeAreNotPooled) {
+  PerfEventAllocator::ReleaseUnusedMemory();
+  (void)PerfEventAllocator::GetAndResetStats();
+
+  constexpr size_t kSize = PerfEventAllocator::kMaxPooledSize + 1;
+  void* first = PerfEventAllocator::Allocate(kSize);
+  memset(first, 0xAB, kSize);
+  PerfEventAllocator::Deallocate(first, kSize);
+  void* second = PerfEventAllocator::Allocate(kSize);
+  PerfEventAllocator::Deallocate(second, kSize);
+
+  PerfEventAllocator::Stats stats = PerfEventAllocator::GetAndResetStats();
+  EXPECT_EQ(stats.system_allocation_count, 2);
+  EXPECT_EQ(stats.pooled_allocation_count, 0);
+}
+
+TEST(PerfEventAllocator, PooledArray) {
+  constexpr size_t kCount = 1000;
+  PooledArray<uint64_t> array = MakePooledArrayForOverwrite<uint64_t>(kCount);
+  for (size_t i = 0; i < kCount; ++i) {
+    array[i] = i;
+  }
+  EXPECT_EQ(array[kCount - 1], kCount - 1);
+}
+
+TEST(PerfEventAllocator, PerfEventPoolAllocator) {
+  std::vector<uint64_t, PerfEventPoolAllocator<uint64_t>> vector;
+  for (uint64_t i = 0; i < 10'000; ++i) {
+    vector.push_back(i);
+  }
+  EXPECT_EQ(vector.size(), 10'000);
+  EXPECT_EQ(vector.back(), 9'999);
+}
+
+TEST(PerfEventAllocator, PerfEventsAreRecycled) {
+  PerfEventAllocator::ReleaseUnusedMemory();
+  (void)PerfEventAllocator::GetAndResetStats();
+
+  constexpr uint64_t kStackSize = 13;
+  for (int i = 0; i < 10; ++i) {
+    auto event = std::make_unique<StackSamplePerfEvent>(kStackSize);
+    memset(event->GetStackData(), 0xAB, kStackSize);
+  }
+
+  // The event and its stack were allocated from the system the first time, and recycled afterwards.
+  PerfEventAllocator::Stats stats = PerfEventAllocator::GetAndResetStats();
+  EXPECT_EQ(stats.system_allocation_count, 2);
+  EXPECT_EQ(stats.pooled_allocation_count, 18);
+}
+
+}  // namespace orbit_linux_tracing
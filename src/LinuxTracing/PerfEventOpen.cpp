@@ -18,7 +18,7 @@
 
 namespace orbit_linux_tracing {
 namespace {
-perf_event_attr generic_event_attr() {
+perf_event_attr generic_event_attr(bool use_wakeup_watermark) {
   perf_event_attr pe{};
   pe.size = sizeof(struct perf_event_attr);
   pe.sample_period = 1;
@@ -27,6 +27,12 @@ perf_event_attr generic_event_attr() {
   pe.sample_id_all = 1;  // Also include timestamps for lost events.
   pe.disabled = 1;
   pe.sample_type = SAMPLE_TYPE_TID_TIME_STREAMID_CPU;
+  if (use_wakeup_watermark) {
+    // Only wake up readers waiting on the file descriptor (e.g., with epoll) once this many bytes
+    // are available, instead of on every record.
+    pe.watermark = 1;
+    pe.wakeup_watermark = kRingBufferWakeupWatermarkBytes;
+  }
 
   return pe;
 }
@@ -39,8 +45,9 @@ int generic_event_open(perf_event_attr* attr, pid_t pid, int32_t cpu) {
   return fd;
 }
 
-perf_event_attr uprobe_event_attr(const char* module, uint64_t function_offset) {
-  perf_event_attr pe = generic_event_attr();
+perf_event_attr uprobe_event_attr(const char* module, uint64_t function_offset,
+                                  bool use_wakeup_watermark) {
+  perf_event_attr pe = generic_event_attr(use_wakeup_watermark);
 
   pe.type = 7;                                    // TODO: should be read from
                                                   //  "/sys/bus/event_source/devices/uprobe/type"
@@ -51,8 +58,8 @@ perf_event_attr uprobe_event_attr(const char* module, uint64_t function_offset)
 }
 }  // namespace
 
-int context_switch_event_open(pid_t pid, int32_t cpu) {
-  perf_event_attr pe = generic_event_attr();
+int context_switch_event_open(pid_t pid, int32_t cpu, bool use_wakeup_watermark) {
+  perf_event_attr pe = generic_event_attr(use_wakeup_watermark);
   pe.type = PERF_TYPE_SOFTWARE;
   pe.config = PERF_COUNT_SW_DUMMY;
   pe.context_switch = 1;
@@ -60,8 +67,8 @@ int context_switch_event_open(pid_t pid, int32_t cpu) {
   return generic_event_open(&pe, pid, cpu);
 }
 
-int mmap_task_event_open(pid_t pid, int32_t cpu) {
-  perf_event_attr pe = generic_event_attr();
+int mmap_task_event_open(pid_t pid, int32_t cpu, bool use_wakeup_watermark) {
+  perf_event_attr pe = generic_event_attr(use_wakeup_watermark);
   pe.type = PERF_TYPE_SOFTWARE;
   pe.config = PERF_COUNT_SW_DUMMY;
   pe.mmap = 1;
@@ -70,8 +77,9 @@ int mmap_task_event_open(pid_t pid, int32_t cpu) {
   return generic_event_open(&pe, pid, cpu);
 }
 
-int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t stack_dump_size) {
-  perf_event_attr pe = generic_event_attr();
+int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t stack_dump_size,
+                            bool use_wakeup_watermark) {
+  perf_event_attr pe = generic_event_attr(use_wakeup_watermark);
   pe.type = PERF_TYPE_SOFTWARE;
   pe.config = PERF_COUNT_SW_CPU_CLOCK;
   pe.sample_period = period_ns;
@@ -84,8 +92,8 @@ int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t
 }
 
 int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
-                                uint16_t stack_dump_size) {
-  perf_event_attr pe = generic_event_attr();
+                                uint16_t stack_dump_size, bool use_wakeup_watermark) {
+  perf_event_attr pe = generic_event_attr(use_wakeup_watermark);
   pe.type = PERF_TYPE_SOFTWARE;
   pe.config = PERF_COUNT_SW_CPU_CLOCK;
   pe.sample_period = period_ns;
@@ -107,8 +115,8 @@ int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
 }
 
 int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid_t pid,
-                               int32_t cpu) {
-  perf_event_attr pe = uprobe_event_attr(module, function_offset);
+                               int32_t cpu, bool use_wakeup_watermark) {
+  perf_event_attr pe = uprobe_event_attr(module, function_offset, use_wakeup_watermark);
   pe.config = 0;
   pe.sample_type |= PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
   pe.sample_regs_user = SAMPLE_REGS_USER_SP_IP_ARGUMENTS;
@@ -121,8 +129,9 @@ int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid
   return generic_event_open(&pe, pid, cpu);
 }
 
-int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu) {
-  perf_event_attr pe = uprobe_event_attr(module, function_offset);
+int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu,
+                          bool use_wakeup_watermark) {
+  perf_event_attr pe = uprobe_event_attr(module, function_offset, use_wakeup_watermark);
   pe.config = 1;  // Set bit 0 of config for uretprobe.
 
   pe.sample_type |= PERF_SAMPLE_REGS_USER;
@@ -150,12 +159,12 @@ void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length) {
 }
 
 int tracepoint_event_open(const char* tracepoint_category, const char* tracepoint_name, pid_t pid,
-                          int32_t cpu) {
+                          int32_t cpu, bool use_wakeup_watermark) {
   int tp_id = GetTracepointId(tracepoint_category, tracepoint_name);
   if (tp_id == -1) {
     return -1;
   }
-  perf_event_attr pe = generic_event_attr();
+  perf_event_attr pe = generic_event_attr(use_wakeup_watermark);
   pe.type = PERF_TYPE_TRACEPOINT;
   pe.config = tp_id;
   pe.sample_type |= PERF_SAMPLE_RAW;
@@ -103,24 +103,32 @@ static constexpr uint16_t SAMPLE_STACK_USER_SIZE_8BYTES = 8;
 // size is 65312. We leave some extra room with our flag (see `ClientFlags.cpp`).
 static constexpr uint16_t kMaxStackSampleUserSize = 65000;
 
+// Number of bytes that need to be available in a ring buffer before readers waiting on its file
+// descriptor are woken up, when the event is opened with `use_wakeup_watermark`. This is only
+// needed when the ring buffers are read in event-driven mode. Must be smaller than the smallest
+// ring buffer we create.
+static constexpr uint32_t kRingBufferWakeupWatermarkBytes = 16 * 1024;
+
 // perf_event_open for context switches.
-int context_switch_event_open(pid_t pid, int32_t cpu);
+int context_switch_event_open(pid_t pid, int32_t cpu, bool use_wakeup_watermark);
 
 // perf_event_open for task (fork and exit) and mmap records in the same buffer.
-int mmap_task_event_open(pid_t pid, int32_t cpu);
+int mmap_task_event_open(pid_t pid, int32_t cpu, bool use_wakeup_watermark);
 
 // perf_event_open for stack sampling.
-int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t stack_dump_size);
+int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu, uint16_t stack_dump_size,
+                            bool use_wakeup_watermark);
 
 // perf_event_open for stack sampling using frame pointers.
 int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
-                                uint16_t stack_dump_size);
+                                uint16_t stack_dump_size, bool use_wakeup_watermark);
 
 // perf_event_open for uprobes and uretprobes.
 int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid_t pid,
-                               int32_t cpu);
+                               int32_t cpu, bool use_wakeup_watermark);
 
-int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu);
+int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu,
+                          bool use_wakeup_watermark);
 
 // Create the ring buffer to use perf_event_open in sampled mode.
 void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
@@ -130,7 +138,7 @@ void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
 // (for example, "sched_waking"). Returns the file descriptor for the
 // perf event or -1 in case of any errors.
 int tracepoint_event_open(const char* tracepoint_category, const char* tracepoint_name, pid_t pid,
-                          int32_t cpu);
+                          int32_t cpu, bool use_wakeup_watermark);
 
 }  // namespace orbit_linux_tracing
 
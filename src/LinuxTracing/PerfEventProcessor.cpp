@@ -4,6 +4,9 @@
 
 #include "PerfEventProcessor.h"
 
+#include <absl/types/span.h>
+
+#include <algorithm>
 #include <memory>
 #include <utility>
 
@@ -80,10 +83,9 @@ void PerfEventProcessor::ProcessAllEvents() {
     // as out-of-order events are discarded in AddEvent.
     CHECK(event->GetTimestamp() >= last_processed_timestamp_ns_);
     last_processed_timestamp_ns_ = event->GetTimestamp();
-    for (PerfEventVisitor* visitor : visitors_) {
-      event->Accept(visitor);
-    }
+    events_to_visit_.push_back(std::move(event));
   }
+  VisitEventsToVisit();
 }
 
 void PerfEventProcessor::ProcessOldEvents() {
@@ -102,11 +104,38 @@ void PerfEventProcessor::ProcessOldEvents() {
     CHECK(event->GetTimestamp() >= last_processed_timestamp_ns_);
     last_processed_timestamp_ns_ = event->GetTimestamp();
 
+    events_to_visit_.push_back(event_queue_.PopEvent());
+  }
+  VisitEventsToVisit();
+}
+
+// Visits the events in events_to_visit_ in order, in segments whose length is decided by the
+// visitors through PerfEventVisitor::PrepareUpcomingEvents.
+void PerfEventProcessor::VisitEventsToVisit() {
+  event_pointers_to_visit_.reserve(events_to_visit_.size());
+  for (const std::unique_ptr<PerfEvent>& event : events_to_visit_) {
+    event_pointers_to_visit_.push_back(event.get());
+  }
+
+  absl::Span<PerfEvent* const> upcoming_events = absl::MakeConstSpan(event_pointers_to_visit_);
+  while (!upcoming_events.empty()) {
+    size_t segment_size = upcoming_events.size();
     for (PerfEventVisitor* visitor : visitors_) {
-      event->Accept(visitor);
+      segment_size = std::min(segment_size,
+                              visitor->PrepareUpcomingEvents(upcoming_events.first(segment_size)));
+      CHECK(segment_size > 0);
     }
-    event_queue_.PopEvent();
+
+    for (PerfEvent* event : upcoming_events.first(segment_size)) {
+      for (PerfEventVisitor* visitor : visitors_) {
+        event->Accept(visitor);
+      }
+    }
+    upcoming_events.remove_prefix(segment_size);
   }
+
+  event_pointers_to_visit_.clear();
+  events_to_visit_.clear();
 }
 
 }  // namespace orbit_linux_tracing
@@ -54,6 +54,11 @@ class PerfEventProcessor {
   PerfEventQueue event_queue_;
   std::vector<PerfEventVisitor*> visitors_;
 
+  void VisitEventsToVisit();
+  // Only used by VisitEventsToVisit, but kept as members to reuse their allocations.
+  std::vector<std::unique_ptr<PerfEvent>> events_to_visit_;
+  std::vector<PerfEvent*> event_pointers_to_visit_;
+
   [[nodiscard]] std::optional<std::unique_ptr<DiscardedPerfEvent>> HandleOutOfOrderEvent(
       uint64_t event_timestamp_ns);
   uint64_t last_discarded_begin_ = 0;
@@ -6,10 +6,14 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <absl/types/span.h>
+
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "OrbitBase/Profiling.h"
 #include "PerfEvent.h"
@@ -18,6 +22,8 @@
 #include "PerfEventVisitor.h"
 
 using ::testing::A;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::Mock;
 
 namespace orbit_linux_tracing {
@@ -225,4 +231,54 @@ TEST_F(PerfEventProcessorTest, ProcessAllEventsNeedsVisitor) {
   EXPECT_DEATH(processor_.ProcessAllEvents(), "!visitors_.empty()");
 }
 
+namespace {
+
+// Lets only `max_segment_size` events be visited after each call to PrepareUpcomingEvents.
+class SegmentingVisitor : public PerfEventVisitor {
+ public:
+  explicit SegmentingVisitor(size_t max_segment_size) : max_segment_size_{max_segment_size} {}
+
+  size_t PrepareUpcomingEvents(absl::Span<PerfEvent* const> upcoming_events) override {
+    size_t segment_size = std::min(upcoming_events.size(), max_segment_size_);
+    for (size_t i = 0; i < segment_size; ++i) {
+      prepared_timestamps.push_back(upcoming_events[i]->GetTimestamp());
+    }
+    return segment_size;
+  }
+
+  void Visit(ForkPerfEvent* event) override { visited_timestamps.push_back(event->GetTimestamp()); }
+
+  std::vector<uint64_t> prepared_timestamps;
+  std::vector<uint64_t> visited_timestamps;
+
+ private:
+  size_t max_segment_size_;
+};
+
+}  // namespace
+
+TEST(PerfEventProcessor, EventsAreVisitedInSegmentsDecidedByVisitors) {
+  PerfEventProcessor processor;
+  SegmentingVisitor visitor_with_short_segments{2};
+  SegmentingVisitor visitor_with_long_segments{3};
+  processor.AddVisitor(&visitor_with_long_segments);
+  processor.AddVisitor(&visitor_with_short_segments);
+
+  std::vector<uint64_t> timestamps;
+  for (uint64_t i = 0; i < 5; ++i) {
+    timestamps.push_back(orbit_base::CaptureTimestampNs());
+    processor.AddEvent(MakeFakePerfEvent(11 + i % 2, timestamps.back()));
+  }
+  processor.ProcessAllEvents();
+
+  EXPECT_THAT(visitor_with_short_segments.visited_timestamps, ElementsAreArray(timestamps));
+  EXPECT_THAT(visitor_with_short_segments.prepared_timestamps, ElementsAreArray(timestamps));
+  EXPECT_THAT(visitor_with_long_segments.visited_timestamps, ElementsAreArray(timestamps));
+  // The visitor with longer segments is asked first, but only two events are visited each time, as
+  // requested by the other visitor. Hence it is asked again for events it already prepared.
+  EXPECT_THAT(visitor_with_long_segments.prepared_timestamps,
+              ElementsAre(timestamps[0], timestamps[1], timestamps[2], timestamps[2], timestamps[3],
+                          timestamps[4], timestamps[4]));
+}
+
 }  // namespace orbit_linux_tracing
@@ -19,24 +19,22 @@ void PerfEventQueue::PushEvent(std::unique_ptr<PerfEvent> event) {
   if (origin_fd == PerfEvent::kNotOrderedInAnyFileDescriptor) {
     priority_queue_of_events_not_ordered_by_fd_.push(std::move(event));
 
-  } else if (auto queue_it = queues_of_events_ordered_by_fd_.find(origin_fd);
-             queue_it != queues_of_events_ordered_by_fd_.end()) {
-    const std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>& queue = queue_it->second;
-
-    CHECK(!queue->empty());
-    // Fundamental assumption: events from the same file descriptor come already in order.
-    CHECK(event->GetTimestamp() >= queue->back()->GetTimestamp());
-    queue->push(std::move(event));
-
   } else {
-    queue_it = queues_of_events_ordered_by_fd_
-                   .emplace(origin_fd, std::make_unique<std::queue<std::unique_ptr<PerfEvent>>>())
-                   .first;
-    const std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>& queue = queue_it->second;
-
-    queue->push(std::move(event));
-    heap_of_queues_of_events_ordered_by_fd_.emplace_back(queue.get());
-    MoveUpBackOfHeapOfQueues();
+    std::unique_ptr<QueueOfEvents>& queue = queues_of_events_ordered_by_fd_[origin_fd];
+    if (queue == nullptr) {
+      queue = std::make_unique<QueueOfEvents>();
+    }
+
+    if (!queue->empty()) {
+      // Fundamental assumption: events from the same file descriptor come already in order.
+      CHECK(event->GetTimestamp() >= queue->back()->GetTimestamp());
+      queue->push(std::move(event));
+    } else {
+      // Empty queues are not in the heap.
+      queue->push(std::move(event));
+      heap_of_queues_of_events_ordered_by_fd_.emplace_back(queue.get());
+      MoveUpBackOfHeapOfQueues();
+    }
   }
 }
 
@@ -64,6 +62,7 @@ PerfEvent* PerfEventQueue::TopEvent() {
 }
 
 std::unique_ptr<PerfEvent> PerfEventQueue::PopEvent() {
+  CHECK(HasEvent());
   if (!priority_queue_of_events_not_ordered_by_fd_.empty() &&
       (heap_of_queues_of_events_ordered_by_fd_.empty() ||
        priority_queue_of_events_not_ordered_by_fd_.top()->GetTimestamp() <=
@@ -78,14 +77,12 @@ std::unique_ptr<PerfEvent> PerfEventQueue::PopEvent() {
     return top_event;
   }
 
-  std::queue<std::unique_ptr<PerfEvent>>* top_queue =
-      heap_of_queues_of_events_ordered_by_fd_.front();
+  QueueOfEvents* top_queue = heap_of_queues_of_events_ordered_by_fd_.front();
   std::unique_ptr<PerfEvent> top_event = std::move(top_queue->front());
   top_queue->pop();
 
   if (top_queue->empty()) {
-    int top_fd = top_event->GetOrderedInFileDescriptor();
-    queues_of_events_ordered_by_fd_.erase(top_fd);
+    // Keep the empty queue in queues_of_events_ordered_by_fd_ for when new events arrive.
     std::swap(heap_of_queues_of_events_ordered_by_fd_.front(),
               heap_of_queues_of_events_ordered_by_fd_.back());
     heap_of_queues_of_events_ordered_by_fd_.pop_back();
@@ -8,11 +8,13 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
 
+#include <deque>
 #include <memory>
 #include <queue>
 #include <vector>
 
 #include "PerfEvent.h"
+#include "PerfEventAllocator.h"
 
 namespace orbit_linux_tracing {
 
@@ -27,7 +29,9 @@ namespace orbit_linux_tracing {
 //
 // In order to be able to add an event to a queue, we also need to maintain the association between
 // a queue and its ring buffer, which is what the map is for. We use the file descriptor used to
-// read from the ring buffer as identifier for a ring buffer.
+// read from the ring buffer as identifier for a ring buffer. Queues that become empty are removed
+// from the heap but kept in the map, so that they (and the memory they hold) can be reused when
+// the next event from the same ring buffer arrives.
 //
 // Some events, though, are known to come out of order even in relation to other events in the same
 // ring buffer (e.g., dma_fence_signaled). For those cases, use an additional single
@@ -40,19 +44,23 @@ class PerfEventQueue {
   std::unique_ptr<PerfEvent> PopEvent();
 
  private:
+  using QueueOfEvents =
+      std::queue<std::unique_ptr<PerfEvent>,
+                 std::deque<std::unique_ptr<PerfEvent>,
+                            PerfEventPoolAllocator<std::unique_ptr<PerfEvent>>>>;
+
   // Floats down the element at the top of the ordered_queues_heap_ to its correct place. Used when
   // the key of the top element changes, or as part of the process of removing the top element.
   void MoveDownFrontOfHeapOfQueues();
   // Floats up an element that it is know should be further up in the heap. Used on insertion.
   void MoveUpBackOfHeapOfQueues();
 
-  // This vector holds the heap of the queues each of which holds events coming from the same ring
-  // buffer and assumes them already in order by timestamp.
-  std::vector<std::queue<std::unique_ptr<PerfEvent>>*> heap_of_queues_of_events_ordered_by_fd_;
+  // This vector holds the heap of the non-empty queues each of which holds events coming from the
+  // same ring buffer and assumes them already in order by timestamp.
+  std::vector<QueueOfEvents*> heap_of_queues_of_events_ordered_by_fd_;
   // This map keeps the association between a file descriptor and the ordered queue of events coming
   // from the ring buffer corresponding to that file descriptor.
-  absl::flat_hash_map<int, std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>>
-      queues_of_events_ordered_by_fd_;
+  absl::flat_hash_map<int, std::unique_ptr<QueueOfEvents>> queues_of_events_ordered_by_fd_;
 
   static constexpr auto kPerfEventReverseTimestampCompare =
       [](const std::unique_ptr<PerfEvent>& lhs, const std::unique_ptr<PerfEvent>& rhs) {
@@ -2,12 +2,16 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
 
 #include <memory>
 
+#include "OrbitBase/Logging.h"
 #include "PerfEvent.h"
+#include "PerfEventAllocator.h"
 #include "PerfEventQueue.h"
 
 namespace orbit_linux_tracing {
@@ -269,4 +273,64 @@ TEST(
   EXPECT_EQ(popped_event->GetOrderedInFileDescriptor(), 11);
 }
 
+TEST(PerfEventQueue, FdThatBecameEmptyCanReceiveNewEvents) {
+  PerfEventQueue event_queue;
+
+  event_queue.PushEvent(MakeTestEvent(11, 100));
+  event_queue.PushEvent(MakeTestEvent(22, 101));
+  EXPECT_EQ(event_queue.PopEvent()->GetTimestamp(), 100);
+
+  event_queue.PushEvent(MakeTestEvent(11, 102));
+  event_queue.PushEvent(MakeTestEvent(11, 103));
+  EXPECT_EQ(event_queue.PopEvent()->GetTimestamp(), 101);
+  EXPECT_EQ(event_queue.PopEvent()->GetTimestamp(), 102);
+
+  event_queue.PushEvent(MakeTestEvent(22, 104));
+  EXPECT_EQ(event_queue.PopEvent()->GetTimestamp(), 103);
+  EXPECT_EQ(event_queue.PopEvent()->GetTimestamp(), 104);
+  EXPECT_FALSE(event_queue.HasEvent());
+}
+
+// Microbenchmark of the push/pop path, in the pattern PerfEventProcessor uses it: events from many
+// ring buffers are added in batches, and then the oldest ones are removed. Also verifies that once
+// the memory for the events in flight has been allocated, no further allocation reaches the system.
+TEST(PerfEventQueue, PushAndPopThroughputInSteadyState) {
+  constexpr int kFdCount = 32;
+  constexpr uint64_t kEventsPerFdPerBatch = 200;
+  constexpr int kWarmUpBatchCount = 10;
+  constexpr int kMeasuredBatchCount = 50;
+
+  PerfEventQueue event_queue;
+  uint64_t timestamp = 0;
+  auto push_and_pop_batch = [&event_queue, &timestamp] {
+    for (uint64_t i = 0; i < kEventsPerFdPerBatch; ++i) {
+      for (int fd = 0; fd < kFdCount; ++fd) {
+        event_queue.PushEvent(MakeTestEvent(fd, timestamp++));
+      }
+    }
+    while (event_queue.HasEvent()) {
+      event_queue.PopEvent();
+    }
+  };
+
+  for (int batch = 0; batch < kWarmUpBatchCount; ++batch) {
+    push_and_pop_batch();
+  }
+  (void)PerfEventAllocator::GetAndResetStats();
+
+  absl::Time start = absl::Now();
+  for (int batch = 0; batch < kMeasuredBatchCount; ++batch) {
+    push_and_pop_batch();
+  }
+  absl::Duration duration = absl::Now() - start;
+
+  PerfEventAllocator::Stats stats = PerfEventAllocator::GetAndResetStats();
+  constexpr uint64_t kMeasuredEventCount = kMeasuredBatchCount * kFdCount * kEventsPerFdPerBatch;
+  LOG("Pushed and popped %lu events in %.1f ms (%.1f ns/event)", kMeasuredEventCount,
+      absl::ToDoubleMilliseconds(duration),
+      absl::ToDoubleNanoseconds(duration) / kMeasuredEventCount);
+  EXPECT_EQ(stats.system_allocation_count, 0);
+  EXPECT_GE(stats.pooled_allocation_count, kMeasuredEventCount);
+}
+
 }  // namespace orbit_linux_tracing
@@ -5,6 +5,9 @@
 #ifndef LINUX_TRACING_PERF_EVENT_VISITOR_H_
 #define LINUX_TRACING_PERF_EVENT_VISITOR_H_
 
+#include <absl/types/span.h>
+#include <stddef.h>
+
 #include "PerfEvent.h"
 
 namespace orbit_linux_tracing {
@@ -13,6 +16,16 @@ namespace orbit_linux_tracing {
 class PerfEventVisitor {
  public:
   virtual ~PerfEventVisitor() = default;
+
+  // Called by PerfEventProcessor before visiting `upcoming_events`, in order. This gives the
+  // visitor the chance to do work for several events at once (for example, in parallel). Returns
+  // how many of the upcoming events can be visited before this method needs to be called again,
+  // which must be at least one. Note that fewer events than returned might be visited before the
+  // next call, as another visitor might have asked for a shorter range.
+  virtual size_t PrepareUpcomingEvents(absl::Span<PerfEvent* const> upcoming_events) {
+    return upcoming_events.size();
+  }
+
   virtual void Visit(ForkPerfEvent* /*event*/) {}
   virtual void Visit(ExitPerfEvent* /*event*/) {}
   virtual void Visit(ContextSwitchPerfEvent* /*event*/) {}
@@ -0,0 +1,204 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PrecompiledCfiUnwinder.h"
+
+#include <absl/strings/match.h>
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+using orbit_object_utils::CfiRow;
+using orbit_object_utils::CfiTable;
+
+namespace {
+
+// When this many frames are cached, the cache is cleared, to bound the memory used for the
+// symbolized addresses of a long capture.
+constexpr size_t kMaxSymbolizedFrameCount = 1 << 20;
+
+// Reads the 8 bytes at `address` from the stack dump, if they are entirely inside of it.
+std::optional<uint64_t> ReadFromStackDump(const uint8_t* stack_dump, uint64_t stack_start,
+                                          uint64_t stack_end, uint64_t address) {
+  if (address < stack_start || address > stack_end || stack_end - address < sizeof(uint64_t)) {
+    return std::nullopt;
+  }
+  uint64_t value;
+  memcpy(&value, stack_dump + (address - stack_start), sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+PrecompiledCfiUnwinder::PrecompiledCfiUnwinder(LibunwindstackUnwinder* fallback_unwinder,
+                                               CfiTableFactory cfi_table_factory)
+    : fallback_unwinder_{fallback_unwinder}, cfi_table_factory_{std::move(cfi_table_factory)} {
+  CHECK(fallback_unwinder_ != nullptr);
+}
+
+LibunwindstackResult PrecompiledCfiUnwinder::Unwind(
+    pid_t pid, unwindstack::Maps* maps, const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs,
+    const void* stack_dump, uint64_t stack_dump_size, bool offline_memory_only,
+    size_t max_frames) {
+  std::optional<LibunwindstackResult> result = TryUnwindWithCfiTables(
+      pid, maps, perf_regs, stack_dump, stack_dump_size, offline_memory_only, max_frames);
+  if (result.has_value()) {
+    ++precompiled_count_;
+    return std::move(result.value());
+  }
+
+  ++fallback_count_;
+  return fallback_unwinder_->Unwind(pid, maps, perf_regs, stack_dump, stack_dump_size,
+                                    offline_memory_only, max_frames);
+}
+
+std::optional<LibunwindstackResult> PrecompiledCfiUnwinder::TryUnwindWithCfiTables(
+    pid_t pid, unwindstack::Maps* maps, const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs,
+    const void* stack_dump, uint64_t stack_dump_size, bool offline_memory_only,
+    size_t max_frames) {
+  if (maps == nullptr) return std::nullopt;
+
+  const auto* stack = static_cast<const uint8_t*>(stack_dump);
+  const uint64_t stack_start = perf_regs[PERF_REG_X86_SP];
+  const uint64_t stack_end = stack_start + stack_dump_size;
+
+  uint64_t pc = perf_regs[PERF_REG_X86_IP];
+  uint64_t sp = perf_regs[PERF_REG_X86_SP];
+  uint64_t rbp = perf_regs[PERF_REG_X86_BP];
+  std::vector<unwindstack::FrameData> frames;
+
+  while (true) {
+    if (frames.size() >= max_frames) {
+      return LibunwindstackResult{std::move(frames),
+                                  unwindstack::ErrorCode::ERROR_MAX_FRAMES_EXCEEDED};
+    }
+
+    // Except for the innermost frame, the program counter is a return address: look up the call
+    // instruction instead, which might be the last instruction of the function.
+    const uint64_t adjusted_pc = frames.empty() ? pc : pc - 1;
+    unwindstack::MapInfo* map_info = maps->Find(adjusted_pc);
+    if (map_info == nullptr) return std::nullopt;
+    const CfiTable* cfi_table = GetOrCreateCfiTable(map_info->name);
+    if (cfi_table == nullptr) return std::nullopt;
+
+    const uint64_t elf_address =
+        adjusted_pc - map_info->start + map_info->offset + cfi_table->GetLoadBias();
+    const CfiRow& row = cfi_table->FindRow(elf_address);
+    if (row.type == CfiRow::Type::kNoInfo || row.type == CfiRow::Type::kUnsupported) {
+      return std::nullopt;
+    }
+
+    std::optional<unwindstack::FrameData> frame =
+        GetSymbolizedFrame(pid, maps, *map_info, adjusted_pc, sp, stack, stack_start, stack_end);
+    if (!frame.has_value()) return std::nullopt;
+    frame->num = frames.size();
+    frame->pc = adjusted_pc;
+    frame->sp = sp;
+    frames.emplace_back(std::move(frame.value()));
+
+    if (row.type == CfiRow::Type::kOutermostFrame) {
+      return LibunwindstackResult{std::move(frames)};
+    }
+
+    const uint64_t cfa =
+        (row.type == CfiRow::Type::kCfaIsRspPlusOffset ? sp : rbp) + row.cfa_offset;
+    std::optional<uint64_t> return_address =
+        ReadFromStackDump(stack, stack_start, stack_end, cfa + row.ra_offset);
+    std::optional<uint64_t> caller_rbp = rbp;
+    if (row.rbp_offset != 0) {
+      caller_rbp = ReadFromStackDump(stack, stack_start, stack_end, cfa + row.rbp_offset);
+    }
+    if (!return_address.has_value() || !caller_rbp.has_value()) {
+      // Without the rest of the memory, the fallback unwinder would stop here too.
+      if (offline_memory_only) {
+        return LibunwindstackResult{std::move(frames),
+                                    unwindstack::ErrorCode::ERROR_MEMORY_INVALID};
+      }
+      return std::nullopt;
+    }
+
+    if (return_address.value() == pc && cfa == sp) return std::nullopt;
+    pc = return_address.value();
+    sp = cfa;
+    rbp = caller_rbp.value();
+  }
+}
+
+void PrecompiledCfiUnwinder::PrecompileCfiTable(const std::string& module_path) {
+  (void)GetOrCreateCfiTable(module_path);
+}
+
+const CfiTable* PrecompiledCfiUnwinder::GetOrCreateCfiTable(const std::string& module_path) {
+  {
+    absl::MutexLock lock{&cfi_tables_mutex_};
+    auto cfi_table_it = cfi_tables_by_module_path_.find(module_path);
+    if (cfi_table_it != cfi_tables_by_module_path_.end()) return cfi_table_it->second.get();
+  }
+
+  // Anonymous and special mappings like [vdso] or [uprobes] have no file to read the CFI from.
+  std::unique_ptr<const CfiTable> cfi_table;
+  if (!module_path.empty() && !absl::StartsWith(module_path, "[")) {
+    ErrorMessageOr<CfiTable> cfi_table_or_error = cfi_table_factory_(module_path);
+    if (cfi_table_or_error.has_value()) {
+      cfi_table = std::make_unique<const CfiTable>(std::move(cfi_table_or_error.value()));
+    } else {
+      ERROR("Creating CFI table for \"%s\": %s", module_path, cfi_table_or_error.error().message());
+    }
+  }
+
+  // Another thread could have created the table for the same module in the meantime.
+  absl::MutexLock lock{&cfi_tables_mutex_};
+  return cfi_tables_by_module_path_.try_emplace(module_path, std::move(cfi_table))
+      .first->second.get();
+}
+
+std::optional<unwindstack::FrameData> PrecompiledCfiUnwinder::GetSymbolizedFrame(
+    pid_t pid, unwindstack::Maps* maps, const unwindstack::MapInfo& map_info, uint64_t pc,
+    uint64_t sp, const uint8_t* stack_dump, uint64_t stack_start, uint64_t stack_end) {
+  {
+    absl::ReaderMutexLock lock{&symbolized_frames_mutex_};
+    auto frame_it = symbolized_frames_by_pc_.find(pc);
+    // The module could have been unmapped, and another one mapped at the same address.
+    if (frame_it != symbolized_frames_by_pc_.end() &&
+        frame_it->second.map_start == map_info.start &&
+        frame_it->second.map_name == map_info.name) {
+      return frame_it->second;
+    }
+  }
+
+  // Let the fallback unwinder symbolize this single frame, as the innermost frame of a callstack.
+  // As it is given the already adjusted program counter, the function offset is also right for
+  // outer frames.
+  std::array<uint64_t, PERF_REG_X86_64_MAX> frame_regs{};
+  frame_regs[PERF_REG_X86_IP] = pc;
+  frame_regs[PERF_REG_X86_SP] = sp;
+  const bool sp_is_in_stack_dump = sp >= stack_start && sp <= stack_end;
+  LibunwindstackResult result = fallback_unwinder_->Unwind(
+      pid, maps, frame_regs, sp_is_in_stack_dump ? stack_dump + (sp - stack_start) : stack_dump,
+      sp_is_in_stack_dump ? stack_end - sp : 0, /*offline_memory_only=*/true, /*max_frames=*/1);
+  if (result.frames().empty() || result.frames().front().map_name != map_info.name) {
+    return std::nullopt;
+  }
+
+  absl::MutexLock lock{&symbolized_frames_mutex_};
+  if (symbolized_frames_by_pc_.size() >= kMaxSymbolizedFrameCount) {
+    symbolized_frames_by_pc_.clear();
+  }
+  symbolized_frames_by_pc_.insert_or_assign(pc, result.frames().front());
+  return result.frames().front();
+}
+
+PrecompiledCfiUnwinder::Stats PrecompiledCfiUnwinder::GetAndResetStats() {
+  Stats stats;
+  stats.precompiled_count = precompiled_count_.exchange(0);
+  stats.fallback_count = fallback_count_.exchange(0);
+  return stats;
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PRECOMPILED_CFI_UNWINDER_H_
+#define LINUX_TRACING_PRECOMPILED_CFI_UNWINDER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <asm/perf_regs.h>
+#include <sys/types.h>
+#include <unwindstack/MapInfo.h>
+#include <unwindstack/Maps.h>
+#include <unwindstack/Unwinder.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "LibunwindstackUnwinder.h"
+#include "ObjectUtils/CfiTable.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_linux_tracing {
+
+// LibunwindstackUnwinder that unwinds using a flat table of the call frame information of each
+// module (orbit_object_utils::CfiTable). The tables are meant to be built with PrecompileCfiTable
+// when a module is loaded, so that the unwinding doesn't stall on them; the table of a module that
+// wasn't precompiled is built the first time the module appears in a callstack.
+// Looking up the unwinding rule of a frame is then a binary search followed by a few reads from the
+// stack dump, instead of searching the FDE and evaluating its CFA program every time.
+//
+// Whenever the table can't be used (the module has no table, the address has no or unsupported
+// CFI, a value needs to be read from outside of the stack dump in online mode, ...), the whole
+// callstack is unwound with the fallback unwinder instead, so that the result is the same as if the
+// fallback unwinder was used directly.
+//
+// Function names are not part of the table: they are cached by address from the frames produced by
+// the fallback unwinder, which is asked to symbolize single frames on cache misses.
+//
+// This class is thread-safe.
+class PrecompiledCfiUnwinder : public LibunwindstackUnwinder {
+ public:
+  using CfiTableFactory =
+      std::function<ErrorMessageOr<orbit_object_utils::CfiTable>(const std::string& module_path)>;
+
+  explicit PrecompiledCfiUnwinder(
+      LibunwindstackUnwinder* fallback_unwinder,
+      CfiTableFactory cfi_table_factory = &orbit_object_utils::CfiTable::CreateFromElfFile);
+
+  LibunwindstackResult Unwind(pid_t pid, unwindstack::Maps* maps,
+                              const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs,
+                              const void* stack_dump, uint64_t stack_dump_size,
+                              bool offline_memory_only = false,
+                              size_t max_frames = kDefaultMaxFrames) override;
+
+  // Builds the table of the module at `module_path`, unless it was already built (or failed to).
+  void PrecompileCfiTable(const std::string& module_path);
+
+  struct Stats {
+    // Number of callstacks unwound with the precompiled tables, and with the fallback unwinder.
+    uint64_t precompiled_count = 0;
+    uint64_t fallback_count = 0;
+  };
+  // Returns the statistics since the last call, and resets them.
+  [[nodiscard]] Stats GetAndResetStats();
+
+ private:
+  [[nodiscard]] std::optional<LibunwindstackResult> TryUnwindWithCfiTables(
+      pid_t pid, unwindstack::Maps* maps,
+      const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs, const void* stack_dump,
+      uint64_t stack_dump_size, bool offline_memory_only, size_t max_frames);
+  // Returns nullptr if no table can be built for the module.
+  [[nodiscard]] const orbit_object_utils::CfiTable* GetOrCreateCfiTable(
+      const std::string& module_path);
+  [[nodiscard]] std::optional<unwindstack::FrameData> GetSymbolizedFrame(
+      pid_t pid, unwindstack::Maps* maps, const unwindstack::MapInfo& map_info, uint64_t pc,
+      uint64_t sp, const uint8_t* stack_dump, uint64_t stack_start, uint64_t stack_end);
+
+  LibunwindstackUnwinder* fallback_unwinder_;
+  CfiTableFactory cfi_table_factory_;
+
+  absl::Mutex cfi_tables_mutex_;
+  absl::flat_hash_map<std::string, std::unique_ptr<const orbit_object_utils::CfiTable>>
+      cfi_tables_by_module_path_ ABSL_GUARDED_BY(cfi_tables_mutex_);
+
+  // Frames as produced by the fallback unwinder, by (adjusted) absolute program counter.
+  absl::Mutex symbolized_frames_mutex_;
+  absl::flat_hash_map<uint64_t, unwindstack::FrameData> symbolized_frames_by_pc_
+      ABSL_GUARDED_BY(symbolized_frames_mutex_);
+
+  std::atomic<uint64_t> precompiled_count_ = 0;
+  std::atomic<uint64_t> fallback_count_ = 0;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PRECOMPILED_CFI_UNWINDER_H_
@@ -0,0 +1,314 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unwindstack/Maps.h>
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "LibunwindstackUnwinder.h"
+#include "ObjectUtils/CfiTable.h"
+#include "OrbitBase/Result.h"
+#include "PrecompiledCfiUnwinder.h"
+
+using orbit_object_utils::CfiTable;
+using ::testing::_;
+using ::testing::AnyNumber;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class MockLibunwindstackUnwinder : public LibunwindstackUnwinder {
+ public:
+  MOCK_METHOD(LibunwindstackResult, Unwind,
+              (pid_t, unwindstack::Maps*, (const std::array<uint64_t, PERF_REG_X86_64_MAX>&),
+               const void*, uint64_t, bool, size_t),
+              (override));
+};
+
+constexpr pid_t kPid = 10;
+
+// The executable segment of the module, at offset 0x1000 in the file, is mapped at kMapStart.
+const std::string kModulePath = "/path/to/module.so";
+constexpr uint64_t kMapStart = 0x10000;
+constexpr uint64_t kMapEnd = 0x20000;
+constexpr uint64_t kMapOffset = 0x1000;
+constexpr uint64_t kEhFrameAddress = 0x3000;
+
+// Three functions: "start" calls "caller", which calls "callee". These are their addresses in the
+// ELF file, with a load bias of zero.
+constexpr uint64_t kCalleeAddress = 0x1000;
+constexpr uint64_t kCallerAddress = 0x1100;
+constexpr uint64_t kStartAddress = 0x1200;
+constexpr uint32_t kFunctionSize = 0x100;
+
+uint64_t ToAbsoluteAddress(uint64_t elf_address) {
+  return elf_address - kMapOffset + kMapStart;
+}
+
+void AppendU32(std::vector<uint8_t>* data, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    data->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void AppendEntry(std::vector<uint8_t>* eh_frame, std::vector<uint8_t> entry) {
+  while ((entry.size() + 4) % 8 != 0) entry.push_back(0);  // DW_CFA_nop
+  AppendU32(eh_frame, static_cast<uint32_t>(entry.size()));
+  eh_frame->insert(eh_frame->end(), entry.begin(), entry.end());
+}
+
+void AppendCie(std::vector<uint8_t>* eh_frame, const std::vector<uint8_t>& instructions) {
+  // Version 1, augmentation "zR", code alignment factor 1, data alignment factor -8, return
+  // address in register 16, pc-relative 4-byte FDE pointers.
+  std::vector<uint8_t> cie{0, 0, 0, 0, 1, 'z', 'R', 0, 1, 0x78, 16, 1, 0x1b};
+  cie.insert(cie.end(), instructions.begin(), instructions.end());
+  AppendEntry(eh_frame, cie);
+}
+
+void AppendFde(std::vector<uint8_t>* eh_frame, uint64_t cie_offset, uint64_t pc_begin,
+               const std::vector<uint8_t>& instructions) {
+  const uint64_t fde_offset = eh_frame->size();
+  std::vector<uint8_t> fde;
+  AppendU32(&fde, static_cast<uint32_t>(fde_offset + 4 - cie_offset));
+  AppendU32(&fde, static_cast<uint32_t>(pc_begin - (kEhFrameAddress + fde_offset + 8)));
+  AppendU32(&fde, kFunctionSize);
+  fde.push_back(0);
+  fde.insert(fde.end(), instructions.begin(), instructions.end());
+  AppendEntry(eh_frame, fde);
+}
+
+std::vector<uint8_t> MakeEhFrame() {
+  std::vector<uint8_t> eh_frame;
+  // CFA is rsp+8, return address at CFA-8.
+  AppendCie(&eh_frame, {0x0c, 0x07, 0x08, 0x90, 0x01});
+  // push rbp; mov rbp, rsp: from +1, CFA is rsp+16 and rbp is at CFA-16; from +4, CFA is rbp+16.
+  AppendFde(&eh_frame, 0, kCalleeAddress, {0x41, 0x0e, 0x10, 0x86, 0x02, 0x43, 0x0d, 0x06});
+  // push rbx: from +1, CFA is rsp+16.
+  AppendFde(&eh_frame, 0, kCallerAddress, {0x41, 0x0e, 0x10});
+  // The return address is undefined.
+  const uint64_t outermost_cie_offset = eh_frame.size();
+  AppendCie(&eh_frame, {0x0c, 0x07, 0x08, 0x07, 0x10});
+  AppendFde(&eh_frame, outermost_cie_offset, kStartAddress, {});
+  AppendU32(&eh_frame, 0);
+  return eh_frame;
+}
+
+ErrorMessageOr<CfiTable> CreateCfiTable(const std::string& module_path) {
+  if (module_path != kModulePath) return ErrorMessage("Unknown module.");
+  return CfiTable::CreateFromEhFrame(kEhFrameAddress, MakeEhFrame(), 0);
+}
+
+// Stack sample taken in "callee", after its prologue.
+constexpr uint64_t kStackStart = 0x7000;
+constexpr uint64_t kStackEnd = 0x7040;
+constexpr uint64_t kCalleeRbp = 0x7010;
+constexpr uint64_t kCallerRbp = 0x7100;
+constexpr uint64_t kCalleePc = 0x10005;
+// Return addresses into "caller" and "start", and their adjusted values.
+constexpr uint64_t kCallerReturnAddress = 0x10150;
+constexpr uint64_t kCallerPc = kCallerReturnAddress - 1;
+constexpr uint64_t kStartReturnAddress = 0x10250;
+constexpr uint64_t kStartPc = kStartReturnAddress - 1;
+
+unwindstack::FrameData MakeSymbolizedFrame(uint64_t pc) {
+  unwindstack::FrameData frame;
+  frame.pc = pc;
+  frame.map_name = kModulePath;
+  frame.map_start = kMapStart;
+  if (pc >= ToAbsoluteAddress(kStartAddress)) {
+    frame.function_name = "start";
+    frame.function_offset = pc - ToAbsoluteAddress(kStartAddress);
+  } else if (pc >= ToAbsoluteAddress(kCallerAddress)) {
+    frame.function_name = "caller";
+    frame.function_offset = pc - ToAbsoluteAddress(kCallerAddress);
+  } else {
+    frame.function_name = "callee";
+    frame.function_offset = pc - ToAbsoluteAddress(kCalleeAddress);
+  }
+  return frame;
+}
+
+class PrecompiledCfiUnwinderTest : public ::testing::Test {
+ protected:
+  PrecompiledCfiUnwinderTest() {
+    maps_.Add(kMapStart, kMapEnd, kMapOffset, PROT_READ | PROT_EXEC, kModulePath, 0);
+
+    regs_[PERF_REG_X86_IP] = kCalleePc;
+    regs_[PERF_REG_X86_SP] = kStackStart;
+    regs_[PERF_REG_X86_BP] = kCalleeRbp;
+
+    stack_dump_.resize(kStackEnd - kStackStart);
+    WriteToStack(kCalleeRbp, kCallerRbp);
+    WriteToStack(kCalleeRbp + 8, kCallerReturnAddress);
+    WriteToStack(0x7028, kStartReturnAddress);
+
+    ON_CALL(fallback_unwinder_, Unwind(_, _, _, _, _, true, 1))
+        .WillByDefault(Invoke([](pid_t /*pid*/, unwindstack::Maps* /*maps*/,
+                                 const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs,
+                                 const void* /*stack_dump*/, uint64_t /*stack_dump_size*/,
+                                 bool /*offline_memory_only*/, size_t /*max_frames*/) {
+          return LibunwindstackResult{{MakeSymbolizedFrame(perf_regs[PERF_REG_X86_IP])},
+                                      unwindstack::ErrorCode::ERROR_MAX_FRAMES_EXCEEDED};
+        }));
+  }
+
+  void WriteToStack(uint64_t address, uint64_t value) {
+    memcpy(stack_dump_.data() + (address - kStackStart), &value, sizeof(value));
+  }
+
+  ::testing::NiceMock<MockLibunwindstackUnwinder> fallback_unwinder_;
+  unwindstack::Maps maps_;
+  std::array<uint64_t, PERF_REG_X86_64_MAX> regs_{};
+  std::vector<uint8_t> stack_dump_;
+};
+
+}  // namespace
+
+TEST_F(PrecompiledCfiUnwinderTest, UnwindsWithCfiTableAndCachesSymbolizedFrames) {
+  int table_creation_count = 0;
+  PrecompiledCfiUnwinder unwinder{&fallback_unwinder_,
+                                  [&table_creation_count](const std::string& module_path) {
+                                    ++table_creation_count;
+                                    return CreateCfiTable(module_path);
+                                  }};
+
+  // Each frame is symbolized only once, and the callstacks are never fully unwound by the fallback.
+  EXPECT_CALL(fallback_unwinder_, Unwind(_, _, _, _, _, true, 1)).Times(3);
+  EXPECT_CALL(fallback_unwinder_, Unwind(_, _, _, _, _, false, _)).Times(0);
+
+  for (int i = 0; i < 2; ++i) {
+    LibunwindstackResult result =
+        unwinder.Unwind(kPid, &maps_, regs_, stack_dump_.data(), stack_dump_.size());
+
+    EXPECT_TRUE(result.IsSuccess());
+    EXPECT_THAT(result.frames(), ElementsAre(Field(&unwindstack::FrameData::pc, kCalleePc),
+                                             Field(&unwindstack::FrameData::pc, kCallerPc),
+                                             Field(&unwindstack::FrameData::pc, kStartPc)));
+    EXPECT_THAT(result.frames(), ElementsAre(Field(&unwindstack::FrameData::sp, kStackStart),
+                                             Field(&unwindstack::FrameData::sp, 0x7020),
+                                             Field(&unwindstack::FrameData::sp, 0x7030)));
+    EXPECT_THAT(result.frames(),
+                ElementsAre(Field(&unwindstack::FrameData::function_name, "callee"),
+                            Field(&unwindstack::FrameData::function_name, "caller"),
+                            Field(&unwindstack::FrameData::function_name, "start")));
+    EXPECT_THAT(result.frames(), ElementsAre(Field(&unwindstack::FrameData::num, 0),
+                                             Field(&unwindstack::FrameData::num, 1),
+                                             Field(&unwindstack::FrameData::num, 2)));
+  }
+
+  EXPECT_EQ(table_creation_count, 1);
+  PrecompiledCfiUnwinder::Stats stats = unwinder.GetAndResetStats();
+  EXPECT_EQ(stats.precompiled_count, 2);
+  EXPECT_EQ(stats.fallback_count, 0);
+}
+
+TEST_F(PrecompiledCfiUnwinderTest, UsesPrecompiledCfiTable) {
+  int table_creation_count = 0;
+  PrecompiledCfiUnwinder unwinder{&fallback_unwinder_,
+                                  [&table_creation_count](const std::string& module_path) {
+                                    ++table_creation_count;
+                                    return CreateCfiTable(module_path);
+                                  }};
+
+  unwinder.PrecompileCfiTable(kModulePath);
+  unwinder.PrecompileCfiTable(kModulePath);
+  EXPECT_EQ(table_creation_count, 1);
+
+  LibunwindstackResult result =
+      unwinder.Unwind(kPid, &maps_, regs_, stack_dump_.data(), stack_dump_.size());
+  EXPECT_TRUE(result.IsSuccess());
+  EXPECT_EQ(result.frames().size(), 3);
+
+  EXPECT_EQ(table_creation_count, 1);
+  EXPECT_EQ(unwinder.GetAndResetStats().precompiled_count, 1);
+}
+
+TEST_F(PrecompiledCfiUnwinderTest, FallsBackWhenModuleHasNoCfiTable) {
+  int table_creation_count = 0;
+  PrecompiledCfiUnwinder unwinder{&fallback_unwinder_,
+                                  [&table_creation_count](const std::string& /*module_path*/)
+                                      -> ErrorMessageOr<CfiTable> {
+                                    ++table_creation_count;
+                                    return ErrorMessage("No .eh_frame.");
+                                  }};
+
+  EXPECT_CALL(fallback_unwinder_,
+              Unwind(kPid, &maps_, _, stack_dump_.data(), stack_dump_.size(), false, _))
+      .Times(2)
+      .WillRepeatedly(Return(LibunwindstackResult{{MakeSymbolizedFrame(kCalleePc)}}));
+
+  for (int i = 0; i < 2; ++i) {
+    LibunwindstackResult result =
+        unwinder.Unwind(kPid, &maps_, regs_, stack_dump_.data(), stack_dump_.size());
+    EXPECT_EQ(result.frames().size(), 1);
+  }
+
+  EXPECT_EQ(table_creation_count, 1);
+  PrecompiledCfiUnwinder::Stats stats = unwinder.GetAndResetStats();
+  EXPECT_EQ(stats.precompiled_count, 0);
+  EXPECT_EQ(stats.fallback_count, 2);
+}
+
+TEST_F(PrecompiledCfiUnwinderTest, FallsBackForAddressesWithoutCfi) {
+  PrecompiledCfiUnwinder unwinder{&fallback_unwinder_, &CreateCfiTable};
+  regs_[PERF_REG_X86_IP] = ToAbsoluteAddress(kStartAddress + kFunctionSize);
+
+  EXPECT_CALL(fallback_unwinder_, Unwind(_, _, _, _, _, false, _))
+      .WillOnce(Return(LibunwindstackResult{{}, unwindstack::ErrorCode::ERROR_UNWIND_INFO}));
+
+  LibunwindstackResult result =
+      unwinder.Unwind(kPid, &maps_, regs_, stack_dump_.data(), stack_dump_.size());
+  EXPECT_EQ(result.error_code(), unwindstack::ErrorCode::ERROR_UNWIND_INFO);
+  EXPECT_EQ(unwinder.GetAndResetStats().fallback_count, 1);
+}
+
+TEST_F(PrecompiledCfiUnwinderTest, StopsAtEndOfStackDumpWithOfflineMemoryOnly) {
+  PrecompiledCfiUnwinder unwinder{&fallback_unwinder_, &CreateCfiTable};
+
+  LibunwindstackResult result =
+      unwinder.Unwind(kPid, &maps_, regs_, stack_dump_.data(), 0x20, /*offline_memory_only=*/true);
+
+  EXPECT_EQ(result.error_code(), unwindstack::ErrorCode::ERROR_MEMORY_INVALID);
+  EXPECT_THAT(result.frames(), ElementsAre(Field(&unwindstack::FrameData::pc, kCalleePc),
+                                           Field(&unwindstack::FrameData::pc, kCallerPc)));
+  EXPECT_EQ(unwinder.GetAndResetStats().precompiled_count, 1);
+}
+
+TEST_F(PrecompiledCfiUnwinderTest, FallsBackAtEndOfStackDumpWithProcessMemory) {
+  PrecompiledCfiUnwinder unwinder{&fallback_unwinder_, &CreateCfiTable};
+
+  EXPECT_CALL(fallback_unwinder_, Unwind(_, _, _, _, _, true, 1)).Times(AnyNumber());
+  EXPECT_CALL(fallback_unwinder_, Unwind(kPid, &maps_, _, stack_dump_.data(), 0x20, false, _))
+      .WillOnce(Return(LibunwindstackResult{
+          {MakeSymbolizedFrame(kCalleePc), MakeSymbolizedFrame(kCallerPc)}}));
+
+  LibunwindstackResult result = unwinder.Unwind(kPid, &maps_, regs_, stack_dump_.data(), 0x20);
+
+  EXPECT_EQ(result.frames().size(), 2);
+  EXPECT_EQ(unwinder.GetAndResetStats().fallback_count, 1);
+}
+
+TEST_F(PrecompiledCfiUnwinderTest, RespectsMaxFrames) {
+  PrecompiledCfiUnwinder unwinder{&fallback_unwinder_, &CreateCfiTable};
+
+  LibunwindstackResult result = unwinder.Unwind(kPid, &maps_, regs_, stack_dump_.data(),
+                                                stack_dump_.size(), false, /*max_frames=*/2);
+
+  EXPECT_EQ(result.error_code(), unwindstack::ErrorCode::ERROR_MAX_FRAMES_EXCEEDED);
+  EXPECT_EQ(result.frames().size(), 2);
+}
+
+}  // namespace orbit_linux_tracing
@@ -11,9 +11,12 @@
 #include <absl/strings/str_join.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cinttypes>
 #include <string>
 #include <string_view>
@@ -32,7 +35,9 @@
 #include "OrbitBase/GetProcessIds.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/SafeStrerror.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "PerfEventAllocator.h"
 #include "PerfEventOpen.h"
 #include "PerfEventReaders.h"
 #include "PerfEventRecords.h"
@@ -54,7 +59,13 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
       target_pid_{capture_options.pid()},
       unwinding_method_{capture_options.unwinding_method()},
       trace_thread_state_{capture_options.trace_thread_state()},
-      trace_gpu_driver_{capture_options.trace_gpu_driver()} {
+      trace_gpu_driver_{capture_options.trace_gpu_driver()},
+      ring_buffer_reader_thread_count_{
+          std::max<uint32_t>(capture_options.ring_buffer_reader_thread_count(), 1)},
+      event_driven_ring_buffer_polling_{capture_options.event_driven_ring_buffer_polling()},
+      unwinding_thread_count_{capture_options.unwinding_thread_count()},
+      unwind_with_precompiled_cfi_{capture_options.unwind_with_precompiled_cfi()},
+      use_unwinding_cache_{capture_options.use_unwinding_cache()} {
   if (unwinding_method_ != CaptureOptions::kUndefined) {
     uint32_t stack_dump_size = capture_options.stack_dump_size();
     if (stack_dump_size > kMaxStackSampleUserSize || stack_dump_size == 0) {
@@ -109,18 +120,55 @@ void CloseFileDescriptors(const absl::flat_hash_map<int32_t, int>& fds_per_cpu)
     close(pair.second);
   }
 }
+
+size_t ComputeUnwindingThreadCount(uint32_t requested_unwinding_thread_count) {
+  if (requested_unwinding_thread_count != 0) return requested_unwinding_thread_count;
+  // Leave cores for the target process and for the other threads of the service.
+  constexpr size_t kMaxAutomaticUnwindingThreadCount = 8;
+  return std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1,
+                            kMaxAutomaticUnwindingThreadCount);
+}
 }  // namespace
 
 void TracerThread::InitUprobesEventVisitor() {
   ORBIT_SCOPE_FUNCTION;
   maps_ = LibunwindstackMaps::ParseMaps(ReadMaps(target_pid_));
   unwinder_ = LibunwindstackUnwinder::Create();
+  LibunwindstackUnwinder* unwinder = unwinder_.get();
+  if (unwinding_method_ == CaptureOptions::kDwarf && unwind_with_precompiled_cfi_) {
+    LOG("Unwinding stack samples with precompiled CFI tables");
+    precompiled_cfi_unwinder_ = std::make_unique<PrecompiledCfiUnwinder>(unwinder_.get());
+    unwinder = precompiled_cfi_unwinder_.get();
+    // Build the tables of the modules that are already loaded now, before the file descriptors are
+    // enabled, rather than when the first stack samples are unwound.
+    auto modules_or_error = orbit_object_utils::ReadModules(target_pid_);
+    if (modules_or_error.has_value()) {
+      for (const ModuleInfo& module : modules_or_error.value()) {
+        precompiled_cfi_unwinder_->PrecompileCfiTable(module.file_path());
+      }
+    } else {
+      ERROR("Unable to load modules for %d: %s", target_pid_, modules_or_error.error().message());
+    }
+  }
   leaf_function_call_manager_ = std::make_unique<LeafFunctionCallManager>(stack_dump_size_);
   uprobes_unwinding_visitor_ = std::make_unique<UprobesUnwindingVisitor>(
-      listener_, &function_call_manager_, &return_address_manager_, maps_.get(), unwinder_.get(),
+      listener_, &function_call_manager_, &return_address_manager_, maps_.get(), unwinder,
       leaf_function_call_manager_.get());
   uprobes_unwinding_visitor_->SetUnwindErrorsAndDiscardedSamplesCounters(
       &stats_.unwind_error_count, &stats_.samples_in_uretprobes_count);
+  if (precompiled_cfi_unwinder_ != nullptr) {
+    uprobes_unwinding_visitor_->SetPrecompiledCfiUnwinder(precompiled_cfi_unwinder_.get());
+  }
+  if (unwinding_method_ == CaptureOptions::kDwarf) {
+    if (use_unwinding_cache_) {
+      LOG("Reusing the outer frames of previous stack samples of the same thread");
+      unwinding_cache_ = std::make_unique<UnwindingCache>(unwinder);
+      uprobes_unwinding_visitor_->SetUnwindingCache(unwinding_cache_.get());
+    }
+    size_t unwinding_thread_count = ComputeUnwindingThreadCount(unwinding_thread_count_);
+    LOG("Unwinding stack samples on %lu threads", unwinding_thread_count);
+    uprobes_unwinding_visitor_->SetUnwindingThreadCount(unwinding_thread_count);
+  }
   event_processor_.AddVisitor(uprobes_unwinding_visitor_.get());
 }
 
@@ -131,7 +179,7 @@ bool TracerThread::OpenUprobes(const orbit_linux_tracing::Function& function,
   const char* module = function.file_path().c_str();
   const uint64_t offset = function.file_offset();
   for (int32_t cpu : cpus) {
-    int fd = uprobes_retaddr_event_open(module, offset, -1, cpu);
+    int fd = uprobes_retaddr_event_open(module, offset, -1, cpu, event_driven_ring_buffer_polling_);
     if (fd < 0) {
       ERROR("Opening uprobe %s+%#" PRIx64 " on cpu %d", function.file_path(),
             function.file_offset(), cpu);
@@ -149,7 +197,7 @@ bool TracerThread::OpenUretprobes(const orbit_linux_tracing::Function& function,
   const char* module = function.file_path().c_str();
   const uint64_t offset = function.file_offset();
   for (int32_t cpu : cpus) {
-    int fd = uretprobes_event_open(module, offset, -1, cpu);
+    int fd = uretprobes_event_open(module, offset, -1, cpu, event_driven_ring_buffer_polling_);
     if (fd < 0) {
       ERROR("Opening uretprobe %s+%#" PRIx64 " on cpu %d", function.file_path(),
             function.file_offset(), cpu);
@@ -248,6 +296,7 @@ void TracerThread::OpenUserSpaceProbesRingBuffers(
     int ring_buffer_fd = fds[0];
     std::string buffer_name = absl::StrFormat("uprobes_uretprobes_%u", cpu);
     ring_buffers_.emplace_back(ring_buffer_fd, UPROBES_RING_BUFFER_SIZE_KB, buffer_name);
+    ring_buffer_fds_to_cpu_.emplace(ring_buffer_fd, cpu);
 
     // Redirect subsequent fds to the cpu specific ring buffer created above.
     for (size_t i = 1; i < fds.size(); ++i) {
@@ -261,7 +310,7 @@ bool TracerThread::OpenMmapTask(const std::vector<int32_t>& cpus) {
   std::vector<int> mmap_task_tracing_fds;
   std::vector<PerfEventRingBuffer> mmap_task_ring_buffers;
   for (int32_t cpu : cpus) {
-    int mmap_task_fd = mmap_task_event_open(-1, cpu);
+    int mmap_task_fd = mmap_task_event_open(-1, cpu, event_driven_ring_buffer_polling_);
     std::string buffer_name = absl::StrFormat("mmap_task_%d", cpu);
     PerfEventRingBuffer mmap_task_ring_buffer{mmap_task_fd, MMAP_TASK_RING_BUFFER_SIZE_KB,
                                               buffer_name};
@@ -275,8 +324,10 @@ bool TracerThread::OpenMmapTask(const std::vector<int32_t>& cpus) {
     }
   }
 
-  for (int fd : mmap_task_tracing_fds) {
-    tracing_fds_.push_back(fd);
+  // Each successfully opened file descriptor corresponds to the cpu at the same index.
+  for (size_t i = 0; i < mmap_task_tracing_fds.size(); ++i) {
+    tracing_fds_.push_back(mmap_task_tracing_fds[i]);
+    ring_buffer_fds_to_cpu_.emplace(mmap_task_tracing_fds[i], cpus[i]);
   }
   for (PerfEventRingBuffer& buffer : mmap_task_ring_buffers) {
     ring_buffers_.emplace_back(std::move(buffer));
@@ -292,10 +343,12 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
     int sampling_fd;
     switch (unwinding_method_) {
       case CaptureOptions::kFramePointers:
-        sampling_fd = callchain_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size_);
+        sampling_fd = callchain_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size_,
+                                                  event_driven_ring_buffer_polling_);
         break;
       case CaptureOptions::kDwarf:
-        sampling_fd = stack_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size_);
+        sampling_fd = stack_sample_event_open(sampling_period_ns_, -1, cpu, stack_dump_size_,
+                                              event_driven_ring_buffer_polling_);
         break;
       case CaptureOptions::kUndefined:
       default:
@@ -317,8 +370,11 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
     }
   }
 
-  for (int fd : sampling_tracing_fds) {
+  // Each successfully opened file descriptor corresponds to the cpu at the same index.
+  for (size_t i = 0; i < sampling_tracing_fds.size(); ++i) {
+    int fd = sampling_tracing_fds[i];
     tracing_fds_.push_back(fd);
+    ring_buffer_fds_to_cpu_.emplace(fd, cpus[i]);
     uint64_t stream_id = perf_event_get_id(fd);
     if (unwinding_method_ == CaptureOptions::kDwarf) {
       stack_sampling_ids_.insert(stream_id);
@@ -335,7 +391,8 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
 static void OpenRingBuffersOrRedirectOnExisting(
     const absl::flat_hash_map<int32_t, int>& fds_per_cpu,
     absl::flat_hash_map<int32_t, int>* ring_buffer_fds_per_cpu,
-    std::vector<PerfEventRingBuffer>* ring_buffers, uint64_t ring_buffer_size_kb,
+    std::vector<PerfEventRingBuffer>* ring_buffers,
+    absl::flat_hash_map<int, int32_t>* ring_buffer_fds_to_cpu, uint64_t ring_buffer_size_kb,
     std::string_view buffer_name_prefix) {
   ORBIT_SCOPE_FUNCTION;
   // Redirect all events on the same cpu to a single ring buffer.
@@ -352,6 +409,7 @@ static void OpenRingBuffersOrRedirectOnExisting(
       std::string buffer_name = absl::StrFormat("%s_%d", buffer_name_prefix, cpu);
       ring_buffers->emplace_back(ring_buffer_fd, ring_buffer_size_kb, buffer_name);
       ring_buffer_fds_per_cpu->emplace(cpu, ring_buffer_fd);
+      ring_buffer_fds_to_cpu->emplace(ring_buffer_fd, cpu);
     }
   }
 }
@@ -376,7 +434,8 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
     const std::vector<TracepointToOpen>& tracepoints_to_open, const std::vector<int32_t>& cpus,
     std::vector<int>* tracing_fds, uint64_t ring_buffer_size_kb,
     absl::flat_hash_map<int32_t, int>* tracepoint_ring_buffer_fds_per_cpu_for_redirection,
-    std::vector<PerfEventRingBuffer>* ring_buffers) {
+    std::vector<PerfEventRingBuffer>* ring_buffers,
+    absl::flat_hash_map<int, int32_t>* ring_buffer_fds_to_cpu) {
   ORBIT_SCOPE_FUNCTION;
   absl::flat_hash_map<size_t, absl::flat_hash_map<int32_t, int>> index_to_tracepoint_fds_per_cpu;
   bool tracepoint_event_open_errors = false;
@@ -386,7 +445,8 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
     const char* tracepoint_category = tracepoints_to_open[tracepoint_index].tracepoint_category;
     const char* tracepoint_name = tracepoints_to_open[tracepoint_index].tracepoint_name;
     for (int32_t cpu : cpus) {
-      int tracepoint_fd = tracepoint_event_open(tracepoint_category, tracepoint_name, -1, cpu);
+      int tracepoint_fd = tracepoint_event_open(tracepoint_category, tracepoint_name, -1, cpu,
+                                                event_driven_ring_buffer_polling_);
       if (tracepoint_fd == -1) {
         ERROR("Opening %s:%s tracepoint for cpu %d", tracepoint_category, tracepoint_name, cpu);
         tracepoint_event_open_errors = true;
@@ -428,7 +488,8 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
 
     OpenRingBuffersOrRedirectOnExisting(
         tracepoint_fds_per_cpu, tracepoint_ring_buffer_fds_per_cpu_for_redirection, ring_buffers,
-        ring_buffer_size_kb, absl::StrFormat("%s:%s", tracepoint_category, tracepoint_name));
+        ring_buffer_fds_to_cpu, ring_buffer_size_kb,
+        absl::StrFormat("%s:%s", tracepoint_category, tracepoint_name));
   }
   return true;
 }
@@ -439,7 +500,7 @@ bool TracerThread::OpenThreadNameTracepoints(const std::vector<int32_t>& cpus) {
   return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
       {{"task", "task_newtask", &task_newtask_ids_}, {"task", "task_rename", &task_rename_ids_}},
       cpus, &tracing_fds_, THREAD_NAMES_RING_BUFFER_SIZE_KB,
-      &thread_name_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+      &thread_name_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_, &ring_buffer_fds_to_cpu_);
 }
 
 void TracerThread::InitSwitchesStatesNamesVisitor() {
@@ -471,7 +532,7 @@ bool TracerThread::OpenContextSwitchAndThreadStateTracepoints(const std::vector<
   return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
       tracepoints_to_open, cpus, &tracing_fds_,
       CONTEXT_SWITCHES_AND_THREAD_STATE_RING_BUFFER_SIZE_KB,
-      &thread_state_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+      &thread_state_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_, &ring_buffer_fds_to_cpu_);
 }
 
 void TracerThread::InitGpuTracepointEventVisitor() {
@@ -500,7 +561,7 @@ bool TracerThread::OpenGpuTracepoints(const std::vector<int32_t>& cpus) {
        {"amdgpu", "amdgpu_sched_run_job", &amdgpu_sched_run_job_ids_},
        {"dma_fence", "dma_fence_signaled", &dma_fence_signaled_ids_}},
       cpus, &tracing_fds_, GPU_TRACING_RING_BUFFER_SIZE_KB, &gpu_tracepoint_ring_buffer_fds_per_cpu,
-      &ring_buffers_);
+      &ring_buffers_, &ring_buffer_fds_to_cpu_);
 }
 
 bool TracerThread::OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus) {
@@ -513,7 +574,7 @@ bool TracerThread::OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus)
     tracepoint_event_open_errors |= !OpenFileDescriptorsAndRingBuffersForAllTracepoints(
         {{selected_tracepoint.category().c_str(), selected_tracepoint.name().c_str(), &stream_ids}},
         cpus, &tracing_fds_, INSTRUMENTED_TRACEPOINTS_RING_BUFFER_SIZE_KB,
-        &tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
+        &tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_, &ring_buffer_fds_to_cpu_);
 
     for (const auto& stream_id : stream_ids) {
       ids_to_tracepoint_info_.emplace(stream_id, selected_tracepoint);
@@ -529,6 +590,13 @@ void TracerThread::InitLostAndDiscardedEventVisitor() {
   event_processor_.AddVisitor(lost_and_discarded_event_visitor_.get());
 }
 
+void TracerThread::InitInstrumentedTracepointVisitor() {
+  ORBIT_SCOPE_FUNCTION;
+  instrumented_tracepoint_visitor_ =
+      std::make_unique<InstrumentedTracepointVisitor>(listener_, &ids_to_tracepoint_info_);
+  event_processor_.AddVisitor(instrumented_tracepoint_visitor_.get());
+}
+
 static std::vector<ThreadName> RetrieveInitialThreadNamesSystemWide(uint64_t initial_timestamp_ns) {
   std::vector<ThreadName> thread_names;
   for (pid_t pid : GetAllPids()) {
@@ -639,6 +707,9 @@ void TracerThread::Startup() {
     perf_event_open_error_details.emplace_back("selected tracepoints");
     perf_event_open_errors = true;
   }
+  if (!ids_to_tracepoint_info_.empty()) {
+    InitInstrumentedTracepointVisitor();
+  }
 
   if (perf_event_open_errors) {
     ERROR("With perf_event_open: did you forget to run as root?");
@@ -652,6 +723,8 @@ void TracerThread::Startup() {
     listener_->OnErrorsWithPerfEventOpenEvent(std::move(errors_with_perf_event_open_event));
   }
 
+  CreateRingBufferReaders();
+
   // Start recording events.
   for (int fd : tracing_fds_) {
     perf_event_enable(fd);
@@ -710,6 +783,7 @@ void TracerThread::Shutdown() {
   // Close the ring buffers.
   {
     ORBIT_SCOPE("ring_buffers_.clear()");
+    ring_buffer_readers_.clear();
     ring_buffers_.clear();
   }
 
@@ -769,29 +843,121 @@ void TracerThread::ProcessOneRecord(PerfEventRingBuffer* ring_buffer) {
   }
 
   if (event_timestamp_ns != 0) {
-    fds_to_last_timestamp_ns_.insert_or_assign(ring_buffer->GetFileDescriptor(),
-                                               event_timestamp_ns);
+    auto it = fds_to_last_timestamp_ns_.find(ring_buffer->GetFileDescriptor());
+    CHECK(it != fds_to_last_timestamp_ns_.end());
+    it->second = event_timestamp_ns;
   }
 }
 
+void TracerThread::CreateRingBufferReaders() {
+  ORBIT_SCOPE_FUNCTION;
+  absl::flat_hash_set<int32_t> cpus;
+  for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+    auto cpu_it = ring_buffer_fds_to_cpu_.find(ring_buffer.GetFileDescriptor());
+    CHECK(cpu_it != ring_buffer_fds_to_cpu_.end());
+    cpus.insert(cpu_it->second);
+    fds_to_last_timestamp_ns_.emplace(ring_buffer.GetFileDescriptor(), 0);
+  }
+
+  // Don't create more readers than there are CPUs with ring buffers, as they would never have
+  // anything to read.
+  size_t reader_count =
+      std::clamp<size_t>(ring_buffer_reader_thread_count_, 1, std::max<size_t>(cpus.size(), 1));
+  for (size_t reader_index = 0; reader_index < reader_count; ++reader_index) {
+    auto reader = std::make_unique<RingBufferReader>();
+    reader->index = reader_index;
+    ring_buffer_readers_.emplace_back(std::move(reader));
+  }
+
+  // Assign all the ring buffers of the same CPU to the same reader.
+  for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+    int32_t cpu = ring_buffer_fds_to_cpu_.at(ring_buffer.GetFileDescriptor());
+    ring_buffer_readers_[cpu % reader_count]->ring_buffers.push_back(&ring_buffer);
+  }
+  LOG("Reading from %u ring buffers with %u thread(s) (%s)", ring_buffers_.size(), reader_count,
+      event_driven_ring_buffer_polling_ ? "event-driven" : "polling");
+}
+
 void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested) {
   FAIL_IF(listener_ == nullptr, "No listener set");
 
   Startup();
 
-  bool last_iteration_saw_events = false;
   std::thread deferred_events_thread(&TracerThread::ProcessDeferredEvents, this);
 
+  // The first reader runs on this thread, each additional reader on its own thread.
+  std::vector<std::thread> additional_reader_threads;
+  for (size_t reader_index = 1; reader_index < ring_buffer_readers_.size(); ++reader_index) {
+    additional_reader_threads.emplace_back(
+        &TracerThread::RunRingBufferReader, this, ring_buffer_readers_[reader_index].get(),
+        exit_requested);
+  }
+
+  RunRingBufferReader(ring_buffer_readers_[0].get(), exit_requested);
+
+  for (std::thread& reader_thread : additional_reader_threads) {
+    reader_thread.join();
+  }
+
+  // Finish processing all deferred events.
+  {
+    std::lock_guard<std::mutex> lock(deferred_events_mutex_);
+    stop_deferred_thread_ = true;
+  }
+  deferred_events_cv_.notify_one();
+  deferred_events_thread.join();
+  event_processor_.ProcessAllEvents();
+
+  Shutdown();
+
+  // All PerfEvents have been processed and destroyed: don't hold on to their memory.
+  PerfEventAllocator::ReleaseUnusedMemory();
+}
+
+void TracerThread::RunRingBufferReader(RingBufferReader* reader,
+                                       const std::shared_ptr<std::atomic<bool>>& exit_requested) {
+  if (reader->index > 0) {
+    pthread_setname_np(pthread_self(), absl::StrFormat("RingBufRead#%u", reader->index).c_str());
+  }
+
+  int epoll_fd = -1;
+  if (event_driven_ring_buffer_polling_) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+      ERROR("epoll_create1: %s; falling back to polling", SafeStrerror(errno));
+    }
+    for (PerfEventRingBuffer* ring_buffer : reader->ring_buffers) {
+      if (epoll_fd == -1) {
+        break;
+      }
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.fd = ring_buffer->GetFileDescriptor();
+      if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ring_buffer->GetFileDescriptor(), &event) != 0) {
+        ERROR("epoll_ctl: %s; falling back to polling", SafeStrerror(errno));
+        close(epoll_fd);
+        epoll_fd = -1;
+      }
+    }
+  }
+
+  bool last_iteration_saw_events = false;
+
   while (!(*exit_requested)) {
     ORBIT_SCOPE("TracerThread::Run iteration");
 
     if (!last_iteration_saw_events) {
-      // Periodically print event statistics.
-      PrintStatsIfTimerElapsed();
+      // Periodically print event statistics. Only the first reader does this.
+      if (reader->index == 0) {
+        PrintStatsIfTimerElapsed();
+      }
 
-      // Sleep if there was no new event in the last iteration so that we are
-      // not constantly polling. Don't sleep so long that ring buffers overflow.
-      {
+      if (epoll_fd != -1) {
+        ORBIT_SCOPE("WaitForRingBufferData");
+        WaitForRingBufferData(epoll_fd);
+      } else {
+        // Sleep if there was no new event in the last iteration so that we are
+        // not constantly polling. Don't sleep so long that ring buffers overflow.
         ORBIT_SCOPE("Sleep");
         usleep(IDLE_TIME_ON_EMPTY_RING_BUFFERS_US);
       }
@@ -799,10 +965,10 @@ void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested)
 
     last_iteration_saw_events = false;
 
-    // Read and process events from all ring buffers. In order to ensure that no
-    // buffer is read constantly while others overflow, we schedule the reading
-    // using round-robin like scheduling.
-    for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+    // Read and process events from all ring buffers of this reader. In order to ensure that no
+    // buffer is read constantly while others overflow, we schedule the reading using round-robin
+    // like scheduling.
+    for (PerfEventRingBuffer* ring_buffer : reader->ring_buffers) {
       if (*exit_requested) {
         break;
       }
@@ -816,22 +982,31 @@ void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested)
         if (*exit_requested) {
           break;
         }
-        if (!ring_buffer.HasNewData()) {
+        if (!ring_buffer->HasNewData()) {
           break;
         }
 
         last_iteration_saw_events = true;
-        ProcessOneRecord(&ring_buffer);
+        ProcessOneRecord(ring_buffer);
+        ++reader->record_count;
       }
     }
   }
 
-  // Finish processing all deferred events.
-  stop_deferred_thread_ = true;
-  deferred_events_thread.join();
-  event_processor_.ProcessAllEvents();
+  if (epoll_fd != -1) {
+    close(epoll_fd);
+  }
+}
 
-  Shutdown();
+void TracerThread::WaitForRingBufferData(int epoll_fd) {
+  // We don't need to know which ring buffers are ready, as all ring buffers are checked for new
+  // data after waking up, so a single epoll_event is enough.
+  epoll_event event{};
+  int ready_count = epoll_wait(epoll_fd, &event, 1, EPOLL_TIMEOUT_ON_EMPTY_RING_BUFFERS_MS);
+  if (ready_count == -1 && errno != EINTR) {
+    ERROR("epoll_wait: %s", SafeStrerror(errno));
+    usleep(IDLE_TIME_ON_EMPTY_RING_BUFFERS_US);
+  }
 }
 
 uint64_t TracerThread::ProcessForkEventAndReturnTimestamp(const perf_event_header& header,
@@ -1035,25 +1210,11 @@ uint64_t TracerThread::ProcessSampleEventAndReturnTimestamp(const perf_event_hea
     ++stats_.gpu_events_count;
 
   } else if (is_user_instrumented_tracepoint) {
-    auto it = ids_to_tracepoint_info_.find(stream_id);
-
-    if (it == ids_to_tracepoint_info_.end()) {
-      return timestamp_ns;
-    }
-
+    // Like all other events, these are sent to the TracerListener by the thread that processes
+    // the deferred events, as several threads might be reading the ring buffers.
     auto event = ConsumeGenericTracepointPerfEvent(ring_buffer, header);
-
-    orbit_grpc_protos::FullTracepointEvent tracepoint_event;
-    tracepoint_event.set_pid(event->GetPid());
-    tracepoint_event.set_tid(event->GetTid());
-    tracepoint_event.set_timestamp_ns(event->GetTimestamp());
-    tracepoint_event.set_cpu(event->GetCpu());
-
-    orbit_grpc_protos::TracepointInfo* tracepoint = tracepoint_event.mutable_tracepoint_info();
-    tracepoint->set_name(it->second.name());
-    tracepoint->set_category(it->second.category());
-
-    listener_->OnTracepointEvent(std::move(tracepoint_event));
+    event->SetOrderedInFileDescriptor(fd);
+    DeferEvent(std::move(event));
 
   } else {
     ERROR("PERF_EVENT_SAMPLE with unexpected stream_id: %lu", stream_id);
@@ -1070,7 +1231,10 @@ uint64_t TracerThread::ProcessLostEventAndReturnTimestamp(const perf_event_heade
   uint64_t timestamp_ns = event->GetTimestamp();
 
   stats_.lost_count += event->GetNumLost();
-  stats_.lost_count_per_buffer[ring_buffer] += event->GetNumLost();
+  {
+    std::lock_guard<std::mutex> lock{stats_.lost_count_per_buffer_mutex};
+    stats_.lost_count_per_buffer[ring_buffer] += event->GetNumLost();
+  }
 
   // Fetch the timestamp of the last event that preceded this PERF_RECORD_LOST in this same ring
   // buffer.
@@ -1118,8 +1282,17 @@ uint64_t TracerThread::ProcessThrottleUnthrottleEventAndReturnTimestamp(
 }
 
 void TracerThread::DeferEvent(std::unique_ptr<PerfEvent> event) {
-  std::lock_guard<std::mutex> lock(deferred_events_mutex_);
-  deferred_events_.emplace_back(std::move(event));
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(deferred_events_mutex_);
+    was_empty = deferred_events_.empty();
+    deferred_events_.emplace_back(std::move(event));
+  }
+  // ProcessDeferredEvents only waits when there are no deferred events, so only notify when the
+  // first event is added.
+  if (event_driven_ring_buffer_polling_ && was_empty) {
+    deferred_events_cv_.notify_one();
+  }
 }
 
 std::vector<std::unique_ptr<PerfEvent>> TracerThread::ConsumeDeferredEvents() {
@@ -1139,9 +1312,17 @@ void TracerThread::ProcessDeferredEvents() {
     should_exit = stop_deferred_thread_;
     std::vector<std::unique_ptr<PerfEvent>> events = ConsumeDeferredEvents();
     if (events.empty()) {
-      // TODO: use a wait/notify mechanism instead of check/sleep.
-      ORBIT_SCOPE("Sleep");
-      usleep(IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US);
+      if (event_driven_ring_buffer_polling_) {
+        ORBIT_SCOPE("Wait");
+        std::unique_lock<std::mutex> lock(deferred_events_mutex_);
+        // The timeout still lets PerfEventProcessor process old events while no new events arrive.
+        deferred_events_cv_.wait_for(
+            lock, std::chrono::milliseconds(MAX_WAIT_TIME_ON_EMPTY_DEFERRED_EVENTS_MS),
+            [this] { return !deferred_events_.empty() || stop_deferred_thread_; });
+      } else {
+        ORBIT_SCOPE("Sleep");
+        usleep(IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US);
+      }
     } else {
       {
         ORBIT_SCOPE("AddEvents");
@@ -1179,7 +1360,9 @@ void TracerThread::RetrieveInitialThreadStatesOfTarget() {
 void TracerThread::Reset() {
   ORBIT_SCOPE_FUNCTION;
   tracing_fds_.clear();
+  ring_buffer_readers_.clear();
   ring_buffers_.clear();
+  ring_buffer_fds_to_cpu_.clear();
   fds_to_last_timestamp_ns_.clear();
 
   uprobes_uretprobes_ids_to_function_.clear();
@@ -1201,8 +1384,11 @@ void TracerThread::Reset() {
   stop_deferred_thread_ = false;
   deferred_events_.clear();
   uprobes_unwinding_visitor_.reset();
+  unwinding_cache_.reset();
+  precompiled_cfi_unwinder_.reset();
   switches_states_names_visitor_.reset();
   gpu_event_visitor_.reset();
+  instrumented_tracepoint_visitor_.reset();
   event_processor_.ClearVisitors();
 }
 
@@ -1218,23 +1404,35 @@ void TracerThread::PrintStatsIfTimerElapsed() {
   CHECK(actual_window_s > 0.0);
 
   LOG("Events per second (and total) last %.3f s:", actual_window_s);
-  LOG("  sched switches: %.0f/s (%lu)", stats_.sched_switch_count / actual_window_s,
-      stats_.sched_switch_count);
-  LOG("  samples: %.0f/s (%lu)", stats_.sample_count / actual_window_s, stats_.sample_count);
-  LOG("  u(ret)probes: %.0f/s (%lu)", stats_.uprobes_count / actual_window_s, stats_.uprobes_count);
-  LOG("  gpu events: %.0f/s (%lu)", stats_.gpu_events_count / actual_window_s,
-      stats_.gpu_events_count);
-
-  if (stats_.lost_count_per_buffer.empty()) {
-    LOG("  lost: %.0f/s (%lu)", stats_.lost_count / actual_window_s, stats_.lost_count);
-  } else {
-    LOG("  LOST: %.0f/s (%lu), of which:", stats_.lost_count / actual_window_s, stats_.lost_count);
-    for (const auto& buffer_and_lost_count : stats_.lost_count_per_buffer) {
-      LOG("    from %s: %.0f/s (%lu)", buffer_and_lost_count.first->GetName().c_str(),
-          buffer_and_lost_count.second / actual_window_s, buffer_and_lost_count.second);
+  uint64_t sched_switch_count = stats_.sched_switch_count;
+  LOG("  sched switches: %.0f/s (%lu)", sched_switch_count / actual_window_s, sched_switch_count);
+  uint64_t sample_count = stats_.sample_count;
+  LOG("  samples: %.0f/s (%lu)", sample_count / actual_window_s, sample_count);
+  uint64_t uprobes_count = stats_.uprobes_count;
+  LOG("  u(ret)probes: %.0f/s (%lu)", uprobes_count / actual_window_s, uprobes_count);
+  uint64_t gpu_events_count = stats_.gpu_events_count;
+  LOG("  gpu events: %.0f/s (%lu)", gpu_events_count / actual_window_s, gpu_events_count);
+
+  uint64_t lost_count = stats_.lost_count;
+  {
+    std::lock_guard<std::mutex> lock{stats_.lost_count_per_buffer_mutex};
+    if (stats_.lost_count_per_buffer.empty()) {
+      LOG("  lost: %.0f/s (%lu)", lost_count / actual_window_s, lost_count);
+    } else {
+      LOG("  LOST: %.0f/s (%lu), of which:", lost_count / actual_window_s, lost_count);
+      for (const auto& buffer_and_lost_count : stats_.lost_count_per_buffer) {
+        LOG("    from %s: %.0f/s (%lu)", buffer_and_lost_count.first->GetName().c_str(),
+            buffer_and_lost_count.second / actual_window_s, buffer_and_lost_count.second);
+      }
     }
   }
 
+  for (const std::unique_ptr<RingBufferReader>& reader : ring_buffer_readers_) {
+    uint64_t record_count = reader->record_count.exchange(0);
+    LOG("  records read by ring buffer reader %u (%u ring buffers): %.0f/s (%lu)", reader->index,
+        reader->ring_buffers.size(), record_count / actual_window_s, record_count);
+  }
+
   uint64_t discarded_out_of_order_count = stats_.discarded_out_of_order_count;
   LOG("  %s: %.0f/s (%lu)",
       discarded_out_of_order_count == 0 ? "discarded as out of order" : "DISCARDED AS OUT OF ORDER",
@@ -1245,16 +1443,48 @@ void TracerThread::PrintStatsIfTimerElapsed() {
 
   uint64_t unwind_error_count = stats_.unwind_error_count;
   LOG("  unwind errors: %.0f/s (%lu) [%.1f%%]", unwind_error_count / actual_window_s,
-      unwind_error_count, 100.0 * unwind_error_count / stats_.sample_count);
+      unwind_error_count, 100.0 * unwind_error_count / sample_count);
   uint64_t discarded_samples_in_uretprobes_count = stats_.samples_in_uretprobes_count;
   LOG("  samples in u(ret)probes: %.0f/s (%lu) [%.1f%%]",
       discarded_samples_in_uretprobes_count / actual_window_s,
       discarded_samples_in_uretprobes_count,
-      100.0 * discarded_samples_in_uretprobes_count / stats_.sample_count);
+      100.0 * discarded_samples_in_uretprobes_count / sample_count);
+
+  if (unwinding_cache_ != nullptr) {
+    UnwindingCache::Stats unwinding_cache_stats = unwinding_cache_->GetAndResetStats();
+    uint64_t unwound_sample_count =
+        unwinding_cache_stats.hit_count + unwinding_cache_stats.miss_count;
+    uint64_t frame_count =
+        unwinding_cache_stats.reused_frame_count + unwinding_cache_stats.unwound_frame_count;
+    LOG("  unwinding cache hits: %.0f/s (%lu) [%.1f%%], reused frames: %.0f/s (%lu) [%.1f%%]",
+        unwinding_cache_stats.hit_count / actual_window_s, unwinding_cache_stats.hit_count,
+        100.0 * unwinding_cache_stats.hit_count / unwound_sample_count,
+        unwinding_cache_stats.reused_frame_count / actual_window_s,
+        unwinding_cache_stats.reused_frame_count,
+        100.0 * unwinding_cache_stats.reused_frame_count / frame_count);
+  }
+
+  if (precompiled_cfi_unwinder_ != nullptr) {
+    PrecompiledCfiUnwinder::Stats precompiled_cfi_stats =
+        precompiled_cfi_unwinder_->GetAndResetStats();
+    uint64_t unwind_count =
+        precompiled_cfi_stats.precompiled_count + precompiled_cfi_stats.fallback_count;
+    LOG("  unwound with precompiled CFI: %.0f/s (%lu) [%.1f%%]",
+        precompiled_cfi_stats.precompiled_count / actual_window_s,
+        precompiled_cfi_stats.precompiled_count,
+        100.0 * precompiled_cfi_stats.precompiled_count / unwind_count);
+  }
 
   uint64_t thread_state_count = stats_.thread_state_count;
   LOG("  target's thread states: %.0f/s (%lu)", thread_state_count / actual_window_s,
       thread_state_count);
+
+  PerfEventAllocator::Stats allocator_stats = PerfEventAllocator::GetAndResetStats();
+  LOG("  PerfEvent allocations: recycled: %.0f/s (%lu), from system: %.0f/s (%lu)",
+      allocator_stats.pooled_allocation_count / actual_window_s,
+      allocator_stats.pooled_allocation_count,
+      allocator_stats.system_allocation_count / actual_window_s,
+      allocator_stats.system_allocation_count);
   stats_.Reset();
 }
 
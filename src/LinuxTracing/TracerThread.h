@@ -12,6 +12,7 @@
 #include <tracepoint.pb.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -22,6 +23,7 @@
 #include "ContextSwitchManager.h"
 #include "Function.h"
 #include "GpuTracepointVisitor.h"
+#include "InstrumentedTracepointVisitor.h"
 #include "LinuxTracing/TracerListener.h"
 #include "LinuxTracingUtils.h"
 #include "LostAndDiscardedEventVisitor.h"
@@ -30,7 +32,9 @@
 #include "PerfEvent.h"
 #include "PerfEventProcessor.h"
 #include "PerfEventRingBuffer.h"
+#include "PrecompiledCfiUnwinder.h"
 #include "SwitchesStatesNamesVisitor.h"
+#include "UnwindingCache.h"
 #include "UprobesUnwindingVisitor.h"
 #include "capture.pb.h"
 
@@ -59,8 +63,24 @@ class TracerThread {
     return std::nullopt;
   }
 
+  // A group of ring buffers that are read by the same thread. All ring buffers associated with the
+  // same CPU belong to the same RingBufferReader. Each reader runs on its own thread and passes the
+  // events it produces to the single PerfEventProcessor through DeferEvent, which is where the
+  // events from all readers are merged and ordered by timestamp.
+  struct RingBufferReader {
+    size_t index = 0;
+    std::vector<PerfEventRingBuffer*> ring_buffers;
+    std::atomic<uint64_t> record_count = 0;
+  };
+
   void Startup();
   void Shutdown();
+  void CreateRingBufferReaders();
+  void RunRingBufferReader(RingBufferReader* reader,
+                           const std::shared_ptr<std::atomic<bool>>& exit_requested);
+  // Blocks until at least one of the ring buffers registered with epoll_fd has reached its wakeup
+  // watermark, or until EPOLL_TIMEOUT_ON_EMPTY_RING_BUFFERS_MS has elapsed.
+  static void WaitForRingBufferData(int epoll_fd);
   void ProcessOneRecord(PerfEventRingBuffer* ring_buffer);
   void InitUprobesEventVisitor();
   bool OpenUserSpaceProbes(const std::vector<int32_t>& cpus);
@@ -90,6 +110,7 @@ class TracerThread {
   bool OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus);
 
   void InitLostAndDiscardedEventVisitor();
+  void InitInstrumentedTracepointVisitor();
 
   [[nodiscard]] uint64_t ProcessForkEventAndReturnTimestamp(const perf_event_header& header,
                                                             PerfEventRingBuffer* ring_buffer);
@@ -133,6 +154,12 @@ class TracerThread {
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_RING_BUFFERS_US = 1000;
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US = 1000;
 
+  // With event-driven polling, readers are woken up as soon as a ring buffer reaches its wakeup
+  // watermark. The timeout only bounds the latency for ring buffers that receive few records, and
+  // the time it takes to notice that the capture was stopped.
+  static constexpr int EPOLL_TIMEOUT_ON_EMPTY_RING_BUFFERS_MS = 10;
+  static constexpr uint32_t MAX_WAIT_TIME_ON_EMPTY_DEFERRED_EVENTS_MS = 10;
+
   bool trace_context_switches_;
   pid_t target_pid_;
   uint64_t sampling_period_ns_;
@@ -143,11 +170,21 @@ class TracerThread {
   bool trace_thread_state_;
   bool trace_gpu_driver_;
   std::vector<orbit_grpc_protos::TracepointInfo> instrumented_tracepoints_;
+  uint32_t ring_buffer_reader_thread_count_;
+  bool event_driven_ring_buffer_polling_;
+  uint32_t unwinding_thread_count_;
+  bool unwind_with_precompiled_cfi_;
+  bool use_unwinding_cache_;
 
   TracerListener* listener_ = nullptr;
 
   std::vector<int> tracing_fds_;
   std::vector<PerfEventRingBuffer> ring_buffers_;
+  absl::flat_hash_map<int, int32_t> ring_buffer_fds_to_cpu_;
+  std::vector<std::unique_ptr<RingBufferReader>> ring_buffer_readers_;
+  // This map is fully populated before the RingBufferReaders start, so that each reader only ever
+  // modifies the values corresponding to its own ring buffers and the map itself is never modified
+  // concurrently.
   absl::flat_hash_map<int, uint64_t> fds_to_last_timestamp_ns_;
 
   absl::flat_hash_map<uint64_t, const Function*> uprobes_uretprobes_ids_to_function_;
@@ -169,16 +206,21 @@ class TracerThread {
   std::atomic<bool> stop_deferred_thread_ = false;
   std::vector<std::unique_ptr<PerfEvent>> deferred_events_;
   std::mutex deferred_events_mutex_;
+  // Only used with event-driven polling, to wake up ProcessDeferredEvents.
+  std::condition_variable deferred_events_cv_;
 
   UprobesFunctionCallManager function_call_manager_;
   UprobesReturnAddressManager return_address_manager_;
   std::unique_ptr<LibunwindstackMaps> maps_;
   std::unique_ptr<LibunwindstackUnwinder> unwinder_;
+  std::unique_ptr<PrecompiledCfiUnwinder> precompiled_cfi_unwinder_;
+  std::unique_ptr<UnwindingCache> unwinding_cache_;
   std::unique_ptr<LeafFunctionCallManager> leaf_function_call_manager_;
   std::unique_ptr<UprobesUnwindingVisitor> uprobes_unwinding_visitor_;
   std::unique_ptr<SwitchesStatesNamesVisitor> switches_states_names_visitor_;
   std::unique_ptr<GpuTracepointVisitor> gpu_event_visitor_;
   std::unique_ptr<LostAndDiscardedEventVisitor> lost_and_discarded_event_visitor_;
+  std::unique_ptr<InstrumentedTracepointVisitor> instrumented_tracepoint_visitor_;
   PerfEventProcessor event_processor_;
 
   struct EventStats {
@@ -189,7 +231,10 @@ class TracerThread {
       uprobes_count = 0;
       gpu_events_count = 0;
       lost_count = 0;
-      lost_count_per_buffer.clear();
+      {
+        std::lock_guard<std::mutex> lock{lost_count_per_buffer_mutex};
+        lost_count_per_buffer.clear();
+      }
       discarded_out_of_order_count = 0;
       unwind_error_count = 0;
       samples_in_uretprobes_count = 0;
@@ -197,12 +242,14 @@ class TracerThread {
     }
 
     uint64_t event_count_begin_ns = 0;
-    uint64_t sched_switch_count = 0;
-    uint64_t sample_count = 0;
-    uint64_t uprobes_count = 0;
-    uint64_t gpu_events_count = 0;
-    uint64_t lost_count = 0;
+    // These counters are atomic as they can be incremented by multiple RingBufferReaders.
+    std::atomic<uint64_t> sched_switch_count = 0;
+    std::atomic<uint64_t> sample_count = 0;
+    std::atomic<uint64_t> uprobes_count = 0;
+    std::atomic<uint64_t> gpu_events_count = 0;
+    std::atomic<uint64_t> lost_count = 0;
     absl::flat_hash_map<PerfEventRingBuffer*, uint64_t> lost_count_per_buffer{};
+    std::mutex lost_count_per_buffer_mutex;
     std::atomic<uint64_t> discarded_out_of_order_count = 0;
     std::atomic<uint64_t> unwind_error_count = 0;
     std::atomic<uint64_t> samples_in_uretprobes_count = 0;
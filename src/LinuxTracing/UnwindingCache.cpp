@@ -0,0 +1,167 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "UnwindingCache.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// Returns the lowest address, between `begin` and `end`, from which the two stack dumps have the
+// same contents up to `end`. The comparison is done in chunks of eight bytes, so the result might
+// be up to seven bytes higher than the actual lowest address.
+uint64_t FindStartOfIdenticalStackContents(const uint8_t* stack1, uint64_t stack1_start,
+                                           const uint8_t* stack2, uint64_t stack2_start,
+                                           uint64_t begin, uint64_t end) {
+  uint64_t address = end;
+  while (address > begin) {
+    uint64_t chunk_size = std::min<uint64_t>(address - begin, sizeof(uint64_t));
+    uint64_t chunk_start = address - chunk_size;
+    if (memcmp(stack1 + (chunk_start - stack1_start), stack2 + (chunk_start - stack2_start),
+               chunk_size) != 0) {
+      break;
+    }
+    address = chunk_start;
+  }
+  return address;
+}
+
+}  // namespace
+
+LibunwindstackResult UnwindingCache::Unwind(
+    pid_t pid, pid_t tid, unwindstack::Maps* maps,
+    const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs, const void* stack_dump,
+    uint64_t stack_dump_size) {
+  std::shared_ptr<const CachedCallstack> cached_callstack;
+  {
+    absl::MutexLock lock{&mutex_};
+    auto cached_callstack_it = cached_callstacks_by_tid_.find(tid);
+    if (cached_callstack_it != cached_callstacks_by_tid_.end()) {
+      cached_callstack = cached_callstack_it->second;
+    }
+  }
+
+  if (cached_callstack != nullptr) {
+    std::optional<LibunwindstackResult> result = TryUnwindWithCachedCallstack(
+        *cached_callstack, pid, maps, perf_regs, stack_dump, stack_dump_size);
+    if (result.has_value()) {
+      UpdateCachedCallstack(tid, result.value(), perf_regs, stack_dump, stack_dump_size);
+      return std::move(result.value());
+    }
+  }
+
+  ++miss_count_;
+  LibunwindstackResult result =
+      unwinder_->Unwind(pid, maps, perf_regs, stack_dump, stack_dump_size);
+  unwound_frame_count_ += result.frames().size();
+  if (result.IsSuccess()) {
+    UpdateCachedCallstack(tid, result, perf_regs, stack_dump, stack_dump_size);
+  }
+  return result;
+}
+
+std::optional<LibunwindstackResult> UnwindingCache::TryUnwindWithCachedCallstack(
+    const CachedCallstack& cached_callstack, pid_t pid, unwindstack::Maps* maps,
+    const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs, const void* stack_dump,
+    uint64_t stack_dump_size) {
+  const uint64_t stack_start = perf_regs[PERF_REG_X86_SP];
+  const uint64_t stack_end = stack_start + stack_dump_size;
+  const uint64_t cached_stack_end = cached_callstack.stack_start + cached_callstack.stack.size();
+  // The new stack dump needs to contain everything that was used to unwind the cached frames.
+  if (cached_stack_end > stack_end || cached_stack_end <= stack_start) return std::nullopt;
+
+  const uint64_t identical_stack_start = FindStartOfIdenticalStackContents(
+      static_cast<const uint8_t*>(stack_dump), stack_start, cached_callstack.stack.data(),
+      cached_callstack.stack_start, std::max(stack_start, cached_callstack.stack_start),
+      cached_stack_end);
+
+  // Find the innermost cached frame that can be reused. The first frame is never reused, as it
+  // depends on the registers rather than on the stack.
+  const std::vector<unwindstack::FrameData>& cached_frames = cached_callstack.frames;
+  size_t first_reused_frame_index = 1;
+  while (first_reused_frame_index < cached_frames.size() &&
+         (cached_frames[first_reused_frame_index].sp < identical_stack_start ||
+          cached_frames[first_reused_frame_index].sp <= stack_start)) {
+    ++first_reused_frame_index;
+  }
+  if (first_reused_frame_index >= cached_frames.size()) return std::nullopt;
+  const unwindstack::FrameData& first_reused_frame = cached_frames[first_reused_frame_index];
+
+  // Only unwind with the part of the stack dump below the first reused frame. The unwinding of the
+  // frames below it doesn't read the stack above it, and the unwinding will stop after reaching it
+  // (with an error, which is expected).
+  LibunwindstackResult inner_result =
+      unwinder_->Unwind(pid, maps, perf_regs, stack_dump, first_reused_frame.sp - stack_start,
+                        /*offline_memory_only=*/true, LibunwindstackUnwinder::kDefaultMaxFrames);
+  unwound_frame_count_ += inner_result.frames().size();
+  if (inner_result.frames().size() < 2) return std::nullopt;
+  const unwindstack::FrameData& last_inner_frame = inner_result.frames().back();
+  if (last_inner_frame.sp != first_reused_frame.sp ||
+      last_inner_frame.pc != first_reused_frame.pc) {
+    return std::nullopt;
+  }
+
+  const size_t reused_frame_count = cached_frames.size() - first_reused_frame_index;
+  if (inner_result.frames().size() - 1 + reused_frame_count >
+      LibunwindstackUnwinder::kDefaultMaxFrames) {
+    return std::nullopt;
+  }
+
+  std::vector<unwindstack::FrameData> frames = inner_result.frames();
+  frames.pop_back();
+  frames.insert(frames.end(), cached_frames.begin() + first_reused_frame_index,
+                cached_frames.end());
+  for (size_t frame_index = 0; frame_index < frames.size(); ++frame_index) {
+    frames[frame_index].num = frame_index;
+  }
+
+  ++hit_count_;
+  reused_frame_count_ += reused_frame_count;
+  return LibunwindstackResult{std::move(frames), unwindstack::ErrorCode::ERROR_NONE};
+}
+
+void UnwindingCache::UpdateCachedCallstack(
+    pid_t tid, const LibunwindstackResult& result,
+    const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs, const void* stack_dump,
+    uint64_t stack_dump_size) {
+  const uint64_t stack_start = perf_regs[PERF_REG_X86_SP];
+  const uint64_t stack_end = stack_start + stack_dump_size;
+  if (result.frames().size() < 2) return;
+  const uint64_t cached_stack_start = result.frames()[1].sp;
+  if (cached_stack_start <= stack_start || cached_stack_start >= stack_end) return;
+
+  auto cached_callstack = std::make_shared<CachedCallstack>();
+  cached_callstack->frames = result.frames();
+  cached_callstack->stack_start = cached_stack_start;
+  const auto* cached_stack_begin =
+      static_cast<const uint8_t*>(stack_dump) + (cached_stack_start - stack_start);
+  cached_callstack->stack.assign(cached_stack_begin,
+                                 static_cast<const uint8_t*>(stack_dump) + stack_dump_size);
+
+  absl::MutexLock lock{&mutex_};
+  cached_callstacks_by_tid_.insert_or_assign(tid, std::move(cached_callstack));
+}
+
+void UnwindingCache::RemoveThread(pid_t tid) {
+  absl::MutexLock lock{&mutex_};
+  cached_callstacks_by_tid_.erase(tid);
+}
+
+UnwindingCache::Stats UnwindingCache::GetAndResetStats() {
+  Stats stats;
+  stats.hit_count = hit_count_.exchange(0);
+  stats.miss_count = miss_count_.exchange(0);
+  stats.reused_frame_count = reused_frame_count_.exchange(0);
+  stats.unwound_frame_count = unwound_frame_count_.exchange(0);
+  return stats;
+}
+
+}  // namespace orbit_linux_tracing
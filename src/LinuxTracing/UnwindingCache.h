@@ -0,0 +1,99 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_UNWINDING_CACHE_H_
+#define LINUX_TRACING_UNWINDING_CACHE_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <asm/perf_regs.h>
+#include <sys/types.h>
+#include <unwindstack/Error.h>
+#include <unwindstack/Maps.h>
+#include <unwindstack/Unwinder.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "LibunwindstackUnwinder.h"
+
+namespace orbit_linux_tracing {
+
+// Consecutive stack samples of the same thread usually share most of their outer frames: only the
+// innermost frames change, while the part of the stack that belongs to the callers stays the same.
+// UnwindingCache keeps, for each thread, the frames and the stack dump of the last successfully
+// unwound stack sample. When a new stack sample of the same thread has identical stack contents
+// above (at higher addresses than) the stack pointer of one of the cached frames, only the frames
+// below that frame are unwound, and the cached frames are appended to them.
+//
+// To check that the part of the unwinding that is not repeated would produce the same result, the
+// new frames are unwound from the stack dump up to the stack pointer of the cached frame only. The
+// last of these frames needs to have the same program counter and stack pointer as the cached one.
+// The rest of the unwinding only depends on the (identical) stack contents above it, and on the
+// callee-saved registers that are not saved on the stack. We assume that these don't change in a
+// way that affects the unwinding of the outer frames if program counter and stack pointer don't.
+//
+// This class is thread-safe: stack samples can be unwound on several threads at the same time.
+class UnwindingCache {
+ public:
+  explicit UnwindingCache(LibunwindstackUnwinder* unwinder) : unwinder_{unwinder} {}
+
+  // Like LibunwindstackUnwinder::Unwind, but reuses frames of the previous stack sample of `tid`.
+  [[nodiscard]] LibunwindstackResult Unwind(
+      pid_t pid, pid_t tid, unwindstack::Maps* maps,
+      const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs, const void* stack_dump,
+      uint64_t stack_dump_size);
+
+  // Drops the cached frames of `tid`, which has exited. This keeps the cache from growing with
+  // every thread ever seen, and from matching the stack of a new thread that reuses the tid.
+  void RemoveThread(pid_t tid);
+
+  struct Stats {
+    // Number of stack samples for which cached frames were reused, and for which they weren't.
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    // Number of frames that were reused from the cache, and that were actually unwound.
+    uint64_t reused_frame_count = 0;
+    uint64_t unwound_frame_count = 0;
+  };
+  // Returns the statistics since the last call, and resets them.
+  [[nodiscard]] Stats GetAndResetStats();
+
+ private:
+  struct CachedCallstack {
+    std::vector<unwindstack::FrameData> frames;
+    // Copy of the part of the stack dump above the stack pointer of the second frame, which is the
+    // only part that matters when looking for reusable frames.
+    uint64_t stack_start = 0;
+    std::vector<uint8_t> stack;
+  };
+
+  [[nodiscard]] std::optional<LibunwindstackResult> TryUnwindWithCachedCallstack(
+      const CachedCallstack& cached_callstack, pid_t pid, unwindstack::Maps* maps,
+      const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs, const void* stack_dump,
+      uint64_t stack_dump_size);
+  void UpdateCachedCallstack(pid_t tid, const LibunwindstackResult& result,
+                             const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs,
+                             const void* stack_dump, uint64_t stack_dump_size);
+
+  LibunwindstackUnwinder* unwinder_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<pid_t, std::shared_ptr<const CachedCallstack>> cached_callstacks_by_tid_
+      ABSL_GUARDED_BY(mutex_);
+
+  std::atomic<uint64_t> hit_count_ = 0;
+  std::atomic<uint64_t> miss_count_ = 0;
+  std::atomic<uint64_t> reused_frame_count_ = 0;
+  std::atomic<uint64_t> unwound_frame_count_ = 0;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_UNWINDING_CACHE_H_
@@ -0,0 +1,222 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <array>
+#include <vector>
+
+#include "LibunwindstackUnwinder.h"
+#include "UnwindingCache.h"
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::Return;
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class MockLibunwindstackUnwinder : public LibunwindstackUnwinder {
+ public:
+  MOCK_METHOD(LibunwindstackResult, Unwind,
+              (pid_t, unwindstack::Maps*, (const std::array<uint64_t, PERF_REG_X86_64_MAX>&),
+               const void*, uint64_t, bool, size_t),
+              (override));
+};
+
+constexpr pid_t kPid = 10;
+constexpr pid_t kTid = 11;
+
+// The first stack sample has its stack pointer at kStackStart1, the second at kStackStart2. Both
+// stack dumps end at kStackEnd.
+constexpr uint64_t kStackStart1 = 0x1000;
+constexpr uint64_t kStackStart2 = 0x1020;
+constexpr uint64_t kStackEnd = 0x1100;
+// Stack pointers of the outer frames, common to both stack samples.
+constexpr uint64_t kOuterFrameSp1 = 0x1040;
+constexpr uint64_t kOuterFrameSp2 = 0x1080;
+
+unwindstack::FrameData MakeFrame(uint64_t pc, uint64_t sp) {
+  unwindstack::FrameData frame;
+  frame.pc = pc;
+  frame.sp = sp;
+  return frame;
+}
+
+std::array<uint64_t, PERF_REG_X86_64_MAX> MakeRegisters(uint64_t sp) {
+  std::array<uint64_t, PERF_REG_X86_64_MAX> registers{};
+  registers[PERF_REG_X86_SP] = sp;
+  return registers;
+}
+
+std::vector<uint8_t> MakeStackDump(uint64_t stack_start) {
+  std::vector<uint8_t> stack_dump(kStackEnd - stack_start);
+  for (uint64_t address = stack_start; address < kStackEnd; ++address) {
+    stack_dump[address - stack_start] = static_cast<uint8_t>(address);
+  }
+  return stack_dump;
+}
+
+class UnwindingCacheTest : public ::testing::Test {
+ protected:
+  void UnwindFirstStackSample() {
+    EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, stack_dump1_.size(), false, _))
+        .WillOnce(Return(LibunwindstackResult{{MakeFrame(1, kStackStart1),
+                                               MakeFrame(2, kOuterFrameSp1),
+                                               MakeFrame(3, kOuterFrameSp2)}}));
+    LibunwindstackResult result = cache_.Unwind(kPid, kTid, nullptr, MakeRegisters(kStackStart1),
+                                                stack_dump1_.data(), stack_dump1_.size());
+    EXPECT_EQ(result.frames().size(), 3);
+    ::testing::Mock::VerifyAndClearExpectations(&unwinder_);
+  }
+
+  MockLibunwindstackUnwinder unwinder_;
+  UnwindingCache cache_{&unwinder_};
+  std::vector<uint8_t> stack_dump1_ = MakeStackDump(kStackStart1);
+  std::vector<uint8_t> stack_dump2_ = MakeStackDump(kStackStart2);
+};
+
+}  // namespace
+
+TEST_F(UnwindingCacheTest, FirstStackSampleOfThreadIsFullyUnwound) {
+  UnwindFirstStackSample();
+
+  UnwindingCache::Stats stats = cache_.GetAndResetStats();
+  EXPECT_EQ(stats.hit_count, 0);
+  EXPECT_EQ(stats.miss_count, 1);
+  EXPECT_EQ(stats.reused_frame_count, 0);
+  EXPECT_EQ(stats.unwound_frame_count, 3);
+}
+
+TEST_F(UnwindingCacheTest, OuterFramesAreReusedWhenTheStackAboveThemIsUnchanged) {
+  UnwindFirstStackSample();
+
+  // Only the part of the second stack dump below the first reusable frame is unwound.
+  EXPECT_CALL(unwinder_,
+              Unwind(kPid, nullptr, _, stack_dump2_.data(), kOuterFrameSp1 - kStackStart2, true, _))
+      .WillOnce(Return(LibunwindstackResult{{MakeFrame(4, kStackStart2),
+                                             MakeFrame(2, kOuterFrameSp1)},
+                                            unwindstack::ErrorCode::ERROR_MEMORY_INVALID}));
+
+  LibunwindstackResult result = cache_.Unwind(kPid, kTid, nullptr, MakeRegisters(kStackStart2),
+                                              stack_dump2_.data(), stack_dump2_.size());
+
+  EXPECT_TRUE(result.IsSuccess());
+  EXPECT_THAT(result.frames(),
+              ElementsAre(Field(&unwindstack::FrameData::pc, 4),
+                          Field(&unwindstack::FrameData::pc, 2),
+                          Field(&unwindstack::FrameData::pc, 3)));
+  EXPECT_THAT(result.frames(), ElementsAre(Field(&unwindstack::FrameData::num, 0),
+                                           Field(&unwindstack::FrameData::num, 1),
+                                           Field(&unwindstack::FrameData::num, 2)));
+
+  UnwindingCache::Stats stats = cache_.GetAndResetStats();
+  EXPECT_EQ(stats.hit_count, 1);
+  EXPECT_EQ(stats.miss_count, 1);
+  EXPECT_EQ(stats.reused_frame_count, 2);
+  EXPECT_EQ(stats.unwound_frame_count, 5);
+}
+
+TEST_F(UnwindingCacheTest, OnlyFramesAboveChangedStackContentsAreReused) {
+  UnwindFirstStackSample();
+  stack_dump2_[kOuterFrameSp1 + 8 - kStackStart2] ^= 0xFF;
+
+  EXPECT_CALL(unwinder_,
+              Unwind(kPid, nullptr, _, stack_dump2_.data(), kOuterFrameSp2 - kStackStart2, true, _))
+      .WillOnce(Return(LibunwindstackResult{
+          {MakeFrame(4, kStackStart2), MakeFrame(5, kOuterFrameSp1), MakeFrame(3, kOuterFrameSp2)},
+          unwindstack::ErrorCode::ERROR_MEMORY_INVALID}));
+
+  LibunwindstackResult result = cache_.Unwind(kPid, kTid, nullptr, MakeRegisters(kStackStart2),
+                                              stack_dump2_.data(), stack_dump2_.size());
+
+  EXPECT_THAT(result.frames(),
+              ElementsAre(Field(&unwindstack::FrameData::pc, 4),
+                          Field(&unwindstack::FrameData::pc, 5),
+                          Field(&unwindstack::FrameData::pc, 3)));
+  EXPECT_EQ(cache_.GetAndResetStats().reused_frame_count, 1);
+}
+
+TEST_F(UnwindingCacheTest, StackSampleIsFullyUnwoundWhenOuterFramesDontMatch) {
+  UnwindFirstStackSample();
+
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, kOuterFrameSp1 - kStackStart2, true, _))
+      .WillOnce(Return(LibunwindstackResult{{MakeFrame(4, kStackStart2),
+                                             MakeFrame(6, kOuterFrameSp1)},
+                                            unwindstack::ErrorCode::ERROR_MEMORY_INVALID}));
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, stack_dump2_.size(), false, _))
+      .WillOnce(Return(LibunwindstackResult{{MakeFrame(4, kStackStart2),
+                                             MakeFrame(6, kOuterFrameSp1),
+                                             MakeFrame(7, kOuterFrameSp2)}}));
+
+  LibunwindstackResult result = cache_.Unwind(kPid, kTid, nullptr, MakeRegisters(kStackStart2),
+                                              stack_dump2_.data(), stack_dump2_.size());
+
+  EXPECT_THAT(result.frames(),
+              ElementsAre(Field(&unwindstack::FrameData::pc, 4),
+                          Field(&unwindstack::FrameData::pc, 6),
+                          Field(&unwindstack::FrameData::pc, 7)));
+  UnwindingCache::Stats stats = cache_.GetAndResetStats();
+  EXPECT_EQ(stats.hit_count, 0);
+  EXPECT_EQ(stats.miss_count, 2);
+}
+
+TEST_F(UnwindingCacheTest, CachedFramesAreNotReusedForOtherThreads) {
+  UnwindFirstStackSample();
+
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, stack_dump2_.size(), false, _))
+      .WillOnce(Return(LibunwindstackResult{{MakeFrame(4, kStackStart2),
+                                             MakeFrame(2, kOuterFrameSp1),
+                                             MakeFrame(3, kOuterFrameSp2)}}));
+
+  LibunwindstackResult result = cache_.Unwind(kPid, kTid + 1, nullptr, MakeRegisters(kStackStart2),
+                                              stack_dump2_.data(), stack_dump2_.size());
+
+  EXPECT_EQ(result.frames().size(), 3);
+  EXPECT_EQ(cache_.GetAndResetStats().hit_count, 0);
+}
+
+TEST_F(UnwindingCacheTest, CachedFramesAreNotReusedAfterThreadExited) {
+  UnwindFirstStackSample();
+  cache_.RemoveThread(kTid);
+
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, stack_dump2_.size(), false, _))
+      .WillOnce(Return(LibunwindstackResult{{MakeFrame(4, kStackStart2),
+                                             MakeFrame(2, kOuterFrameSp1),
+                                             MakeFrame(3, kOuterFrameSp2)}}));
+
+  LibunwindstackResult result = cache_.Unwind(kPid, kTid, nullptr, MakeRegisters(kStackStart2),
+                                              stack_dump2_.data(), stack_dump2_.size());
+
+  EXPECT_EQ(result.frames().size(), 3);
+  UnwindingCache::Stats stats = cache_.GetAndResetStats();
+  EXPECT_EQ(stats.hit_count, 0);
+  EXPECT_EQ(stats.miss_count, 2);
+}
+
+TEST_F(UnwindingCacheTest, UnwindingErrorsAreNotCached) {
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, stack_dump1_.size(), false, _))
+      .WillOnce(Return(LibunwindstackResult{
+          {MakeFrame(1, kStackStart1), MakeFrame(2, kOuterFrameSp1)},
+          unwindstack::ErrorCode::ERROR_UNWIND_INFO}));
+  LibunwindstackResult result = cache_.Unwind(kPid, kTid, nullptr, MakeRegisters(kStackStart1),
+                                              stack_dump1_.data(), stack_dump1_.size());
+  EXPECT_FALSE(result.IsSuccess());
+
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, stack_dump2_.size(), false, _))
+      .WillOnce(Return(LibunwindstackResult{
+          {MakeFrame(4, kStackStart2), MakeFrame(2, kOuterFrameSp1)},
+          unwindstack::ErrorCode::ERROR_UNWIND_INFO}));
+  result = cache_.Unwind(kPid, kTid, nullptr, MakeRegisters(kStackStart2), stack_dump2_.data(),
+                         stack_dump2_.size());
+  EXPECT_FALSE(result.IsSuccess());
+
+  EXPECT_EQ(cache_.GetAndResetStats().miss_count, 2);
+}
+
+}  // namespace orbit_linux_tracing
@@ -9,6 +9,8 @@
 #include <unwindstack/MapInfo.h>
 #include <unwindstack/Unwinder.h>
 
+#include <absl/time/time.h>
+
 #include <algorithm>
 #include <optional>
 #include <utility>
@@ -16,6 +18,7 @@
 #include "Function.h"
 #include "LeafFunctionCallManager.h"
 #include "ObjectUtils/LinuxMap.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
 #include "capture.pb.h"
@@ -60,16 +63,137 @@ static void SendUprobesFullAddressInfoToListener(
   listener->OnAddressInfo(std::move(address_info));
 }
 
-void UprobesUnwindingVisitor::Visit(StackSamplePerfEvent* event) {
-  CHECK(listener_ != nullptr);
-  CHECK(current_maps_ != nullptr);
+namespace {
+
+// Collects the stack samples among the upcoming events, stopping at the first event that changes
+// the state that unwinding a stack sample depends on.
+class UnwindAheadCollector : public PerfEventVisitor {
+ public:
+  void Visit(StackSamplePerfEvent* event) override { stack_samples.push_back(event); }
+  // Uprobes and uretprobes change the return addresses that UprobesReturnAddressManager patches.
+  void Visit(UprobesPerfEvent* /*event*/) override { reached_state_change = true; }
+  void Visit(UretprobesPerfEvent* /*event*/) override { reached_state_change = true; }
+  // Mmaps change the maps used for unwinding.
+  void Visit(MmapPerfEvent* /*event*/) override { reached_state_change = true; }
+
+  std::vector<StackSamplePerfEvent*> stack_samples;
+  bool reached_state_change = false;
+};
+
+}  // namespace
+
+UprobesUnwindingVisitor::~UprobesUnwindingVisitor() {
+  if (unwinding_thread_pool_ != nullptr) {
+    unwinding_thread_pool_->ShutdownAndWait();
+  }
+}
+
+void UprobesUnwindingVisitor::SetUnwindingThreadCount(size_t thread_count) {
+  if (unwinding_thread_pool_ != nullptr) {
+    unwinding_thread_pool_->ShutdownAndWait();
+    unwinding_thread_pool_ = nullptr;
+  }
+  unwinding_thread_count_ = std::max<size_t>(thread_count, 1);
+  if (unwinding_thread_count_ > 1) {
+    // The thread that processes the events also unwinds, hence one thread fewer in the pool.
+    unwinding_thread_pool_ = ThreadPool::Create(
+        unwinding_thread_count_ - 1, unwinding_thread_count_ - 1, absl::Seconds(1));
+  }
+}
+
+size_t UprobesUnwindingVisitor::PrepareUpcomingEvents(
+    absl::Span<PerfEvent* const> upcoming_events) {
+  if (unwinding_thread_pool_ == nullptr) return upcoming_events.size();
+
+  UnwindAheadCollector collector;
+  size_t segment_size = 0;
+  while (segment_size < upcoming_events.size() && !collector.reached_state_change) {
+    upcoming_events[segment_size]->Accept(&collector);
+    ++segment_size;
+  }
+
+  // Samples from a previous segment that was cut short by another visitor were already unwound.
+  std::vector<StackSamplePerfEvent*>& stack_samples = collector.stack_samples;
+  stack_samples.erase(std::remove_if(stack_samples.begin(), stack_samples.end(),
+                                     [this](StackSamplePerfEvent* event) {
+                                       return unwound_stack_samples_.contains(event);
+                                     }),
+                      stack_samples.end());
+
+  // With a single sample, there is nothing to gain from unwinding it ahead of time.
+  if (stack_samples.size() > 1) {
+    UnwindStackSamplesInParallel(stack_samples);
+  }
+  return segment_size;
+}
+
+void UprobesUnwindingVisitor::UnwindStackSamplesInParallel(
+    absl::Span<StackSamplePerfEvent* const> events) {
+  CHECK(unwinding_thread_pool_ != nullptr);
+
+  // The return addresses must be patched in order, before anything is unwound.
+  for (StackSamplePerfEvent* event : events) {
+    return_address_manager_->PatchSample(event->GetTid(), event->GetRegisters()[PERF_REG_X86_SP],
+                                         event->GetStackData(), event->GetStackSize());
+  }
+
+  // No mmap is processed until all these samples are unwound, so the maps don't change meanwhile.
+  unwindstack::Maps* maps = current_maps_->Get();
+  std::vector<std::optional<LibunwindstackResult>> results(events.size());
+  std::atomic<size_t> next_event_index = 0;
+  auto unwind_next_events = [this, events, maps, &results, &next_event_index] {
+    for (size_t i = next_event_index++; i < events.size(); i = next_event_index++) {
+      StackSamplePerfEvent* event = events[i];
+      results[i] = UnwindStackSample(event, maps);
+    }
+  };
+
+  std::vector<orbit_base::Future<void>> futures;
+  futures.reserve(unwinding_thread_count_ - 1);
+  for (size_t i = 0; i < std::min(unwinding_thread_count_ - 1, events.size() - 1); ++i) {
+    futures.push_back(unwinding_thread_pool_->Schedule(unwind_next_events));
+  }
+  unwind_next_events();
+  for (const orbit_base::Future<void>& future : futures) {
+    future.Wait();
+  }
+
+  for (size_t i = 0; i < events.size(); ++i) {
+    CHECK(results[i].has_value());
+    unwound_stack_samples_.emplace(events[i], std::move(results[i].value()));
+  }
+}
+
+LibunwindstackResult UprobesUnwindingVisitor::PatchAndUnwindStackSample(
+    StackSamplePerfEvent* event) {
+  auto unwound_stack_sample_it = unwound_stack_samples_.find(event);
+  if (unwound_stack_sample_it != unwound_stack_samples_.end()) {
+    LibunwindstackResult libunwindstack_result = std::move(unwound_stack_sample_it->second);
+    unwound_stack_samples_.erase(unwound_stack_sample_it);
+    return libunwindstack_result;
+  }
 
   return_address_manager_->PatchSample(event->GetTid(), event->GetRegisters()[PERF_REG_X86_SP],
                                        event->GetStackData(), event->GetStackSize());
 
-  LibunwindstackResult libunwindstack_result =
-      unwinder_->Unwind(event->GetPid(), current_maps_->Get(), event->GetRegisters(),
-                        event->GetStackData(), event->GetStackSize());
+  return UnwindStackSample(event, current_maps_->Get());
+}
+
+LibunwindstackResult UprobesUnwindingVisitor::UnwindStackSample(StackSamplePerfEvent* event,
+                                                                unwindstack::Maps* maps) {
+  if (unwinding_cache_ != nullptr) {
+    return unwinding_cache_->Unwind(event->GetPid(), event->GetTid(), maps, event->GetRegisters(),
+                                    event->GetStackData(), event->GetStackSize());
+  }
+  return unwinder_->Unwind(event->GetPid(), maps, event->GetRegisters(), event->GetStackData(),
+                           event->GetStackSize());
+}
+
+void UprobesUnwindingVisitor::Visit(StackSamplePerfEvent* event) {
+  CHECK(listener_ != nullptr);
+  CHECK(current_maps_ != nullptr);
+
+  LibunwindstackResult libunwindstack_result = PatchAndUnwindStackSample(event);
 
   if (libunwindstack_result.frames().empty()) {
     // Even with unwinding errors this is not expected because we should at least get the program
@@ -337,6 +461,10 @@ void UprobesUnwindingVisitor::Visit(MmapPerfEvent* event) {
                             event->page_offset(), PROT_READ | PROT_EXEC, event->filename(),
                             module_info.load_bias());
 
+  if (precompiled_cfi_unwinder_ != nullptr) {
+    precompiled_cfi_unwinder_->PrecompileCfiTable(event->filename());
+  }
+
   orbit_grpc_protos::ModuleUpdateEvent module_update_event;
   module_update_event.set_pid(event->pid());
   module_update_event.set_timestamp_ns(event->GetTimestamp());
@@ -345,4 +473,10 @@ void UprobesUnwindingVisitor::Visit(MmapPerfEvent* event) {
   listener_->OnModuleUpdate(std::move(module_update_event));
 }
 
+void UprobesUnwindingVisitor::Visit(ExitPerfEvent* event) {
+  if (unwinding_cache_ != nullptr) {
+    unwinding_cache_->RemoveThread(event->GetTid());
+  }
+}
+
 }  // namespace orbit_linux_tracing
@@ -7,6 +7,8 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
+#include <absl/types/span.h>
+#include <stddef.h>
 #include <sys/types.h>
 #include <unwindstack/Maps.h>
 
@@ -21,8 +23,11 @@
 #include "LibunwindstackMaps.h"
 #include "LibunwindstackUnwinder.h"
 #include "LinuxTracing/TracerListener.h"
+#include "OrbitBase/ThreadPool.h"
 #include "PerfEvent.h"
 #include "PerfEventVisitor.h"
+#include "PrecompiledCfiUnwinder.h"
+#include "UnwindingCache.h"
 #include "UprobesFunctionCallManager.h"
 #include "UprobesReturnAddressManager.h"
 
@@ -40,6 +45,11 @@ namespace orbit_linux_tracing {
 // of the return addresses before they are hijacked, and patches them into the
 // time-based stack samples. Such return addresses can be retrieved by getting
 // the eight bytes at the top of the stack on hitting uprobes.
+// Stack samples can be unwound ahead of time on several threads (see SetUnwindingThreadCount). In
+// that case, PrepareUpcomingEvents patches and unwinds in parallel all the stack samples that come
+// before the next uprobes, uretprobes or mmap event, as only these events change the state that
+// unwinding depends on. Visit(StackSamplePerfEvent*) then only consumes the result, so samples are
+// still reported in order.
 // TODO: Make this more robust to losing uprobes or uretprobes events, if this
 //  is still observed. For example, pass the address of uretprobes and compare
 //  it against the address of uprobes on the stack.
@@ -66,6 +76,8 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
     CHECK(leaf_function_call_manager_ != nullptr);
   }
 
+  ~UprobesUnwindingVisitor() override;
+
   UprobesUnwindingVisitor(const UprobesUnwindingVisitor&) = delete;
   UprobesUnwindingVisitor& operator=(const UprobesUnwindingVisitor&) = delete;
 
@@ -79,11 +91,27 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
     samples_in_uretprobes_counter_ = samples_in_uretprobes_counter;
   }
 
+  // When set, stack samples are unwound through `unwinding_cache`, which needs to use `unwinder`.
+  void SetUnwindingCache(UnwindingCache* unwinding_cache) { unwinding_cache_ = unwinding_cache; }
+
+  // When set, the CFI table of each module mapped during the capture is built with
+  // `precompiled_cfi_unwinder`, which should be `unwinder`, as soon as the mapping is visited.
+  void SetPrecompiledCfiUnwinder(PrecompiledCfiUnwinder* precompiled_cfi_unwinder) {
+    precompiled_cfi_unwinder_ = precompiled_cfi_unwinder;
+  }
+
+  // Unwinds stack samples on `thread_count` threads (including the thread that processes the
+  // events). With a count of 0 or 1, each stack sample is unwound when it is visited.
+  void SetUnwindingThreadCount(size_t thread_count);
+
+  size_t PrepareUpcomingEvents(absl::Span<PerfEvent* const> upcoming_events) override;
+
   void Visit(StackSamplePerfEvent* event) override;
   void Visit(CallchainSamplePerfEvent* event) override;
   void Visit(UprobesPerfEvent* event) override;
   void Visit(UretprobesPerfEvent* event) override;
   void Visit(MmapPerfEvent* event) override;
+  void Visit(ExitPerfEvent* event) override;
 
  private:
   TracerListener* listener_;
@@ -93,12 +121,24 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
   LibunwindstackMaps* current_maps_;
   LibunwindstackUnwinder* unwinder_;
   LeafFunctionCallManager* leaf_function_call_manager_;
+  UnwindingCache* unwinding_cache_ = nullptr;
+  PrecompiledCfiUnwinder* precompiled_cfi_unwinder_ = nullptr;
 
   std::atomic<uint64_t>* unwind_error_counter_ = nullptr;
   std::atomic<uint64_t>* samples_in_uretprobes_counter_ = nullptr;
 
   absl::flat_hash_map<pid_t, std::vector<std::tuple<uint64_t, uint64_t, uint32_t>>>
       uprobe_sps_ips_cpus_per_thread_{};
+
+  [[nodiscard]] LibunwindstackResult PatchAndUnwindStackSample(StackSamplePerfEvent* event);
+  [[nodiscard]] LibunwindstackResult UnwindStackSample(StackSamplePerfEvent* event,
+                                                       unwindstack::Maps* maps);
+  void UnwindStackSamplesInParallel(absl::Span<StackSamplePerfEvent* const> events);
+
+  size_t unwinding_thread_count_ = 1;
+  std::shared_ptr<ThreadPool> unwinding_thread_pool_ = nullptr;
+  // Results of UnwindStackSamplesInParallel, consumed by Visit(StackSamplePerfEvent*).
+  absl::flat_hash_map<StackSamplePerfEvent*, LibunwindstackResult> unwound_stack_samples_;
 };
 
 }  // namespace orbit_linux_tracing
@@ -17,6 +17,7 @@ using ::testing::ElementsAreArray;
 using ::testing::Ge;
 using ::testing::Invoke;
 using ::testing::Lt;
+using ::testing::Mock;
 using ::testing::Property;
 using ::testing::Return;
 using ::testing::SaveArg;
@@ -185,7 +186,7 @@ TEST_F(UprobesUnwindingVisitorTest,
       .cpu = 0,
       .res = 0,
   };
-  event.ring_buffer_record->sample_id = sample_id;
+  event.ring_buffer_record.sample_id = sample_id;
 
   EXPECT_CALL(return_address_manager_, PatchSample).Times(1).WillOnce(Return());
   EXPECT_CALL(maps_, Get).Times(1).WillOnce(Return(nullptr));
@@ -241,6 +242,65 @@ TEST_F(UprobesUnwindingVisitorTest,
   EXPECT_EQ(discarded_samples_in_uretprobes_counter, 0);
 }
 
+TEST_F(UprobesUnwindingVisitorTest,
+       StackSamplesBeforeMmapAreUnwoundAheadInParallelAndSentInOrderWhenVisited) {
+  constexpr uint32_t kPid = 10;
+  constexpr uint64_t kStackSize = 13;
+  std::vector<std::unique_ptr<StackSamplePerfEvent>> stack_samples;
+  for (uint64_t timestamp_ns : {15, 16, 17}) {
+    auto event = std::make_unique<StackSamplePerfEvent>(kStackSize);
+    event->ring_buffer_record.sample_id = perf_event_sample_id_tid_time_streamid_cpu{
+        .pid = kPid,
+        .tid = 11,
+        .time = timestamp_ns,
+        .stream_id = 12,
+        .cpu = 0,
+        .res = 0,
+    };
+    stack_samples.push_back(std::move(event));
+  }
+  MmapPerfEvent mmap_event{kPid, 18, perf_event_mmap_up_to_pgoff{}, kUprobesName};
+  StackSamplePerfEvent stack_sample_after_mmap{kStackSize};
+
+  std::vector<PerfEvent*> upcoming_events{stack_samples[0].get(), stack_samples[1].get(),
+                                          stack_samples[2].get(), &mmap_event,
+                                          &stack_sample_after_mmap};
+
+  visitor_->SetUnwindingThreadCount(4);
+
+  EXPECT_CALL(return_address_manager_, PatchSample).Times(3).WillRepeatedly(Return());
+  EXPECT_CALL(maps_, Get).Times(1).WillOnce(Return(nullptr));
+  EXPECT_CALL(unwinder_, Unwind(kPid, nullptr, _, _, kStackSize, _, _))
+      .Times(3)
+      .WillRepeatedly(Return(LibunwindstackResult{{kFrame1, kFrame2, kFrame3},
+                                                  unwindstack::ErrorCode::ERROR_NONE}));
+
+  // The segment ends with the mmap, which is included.
+  EXPECT_EQ(visitor_->PrepareUpcomingEvents(upcoming_events), 4);
+
+  Mock::VerifyAndClearExpectations(&return_address_manager_);
+  Mock::VerifyAndClearExpectations(&unwinder_);
+  EXPECT_CALL(return_address_manager_, PatchSample).Times(0);
+  EXPECT_CALL(unwinder_, Unwind).Times(0);
+
+  std::vector<uint64_t> actual_timestamps;
+  EXPECT_CALL(listener_, OnCallstackSample)
+      .Times(3)
+      .WillRepeatedly(Invoke([&actual_timestamps](orbit_grpc_protos::FullCallstackSample sample) {
+        EXPECT_THAT(sample.callstack().pcs(),
+                    ElementsAre(kTargetAddress1, kTargetAddress2, kTargetAddress3));
+        EXPECT_EQ(sample.callstack().type(), orbit_grpc_protos::Callstack::kComplete);
+        actual_timestamps.push_back(sample.timestamp_ns());
+      }));
+  EXPECT_CALL(listener_, OnAddressInfo).Times(9);
+
+  for (const std::unique_ptr<StackSamplePerfEvent>& event : stack_samples) {
+    visitor_->Visit(event.get());
+  }
+
+  EXPECT_THAT(actual_timestamps, ElementsAre(15, 16, 17));
+}
+
 TEST_F(UprobesUnwindingVisitorTest, VisitEmptyStackSampleWithoutUprobesDoesNothing) {
   constexpr uint32_t kPid = 10;
   constexpr uint64_t kStackSize = 13;
@@ -253,7 +313,7 @@ TEST_F(UprobesUnwindingVisitorTest, VisitEmptyStackSampleWithoutUprobesDoesNothi
       .cpu = 0,
       .res = 0,
   };
-  event.ring_buffer_record->sample_id = sample_id;
+  event.ring_buffer_record.sample_id = sample_id;
 
   EXPECT_CALL(return_address_manager_, PatchSample).Times(1).WillOnce(Return());
   EXPECT_CALL(maps_, Get).Times(1).WillOnce(Return(nullptr));
@@ -293,7 +353,7 @@ TEST_F(UprobesUnwindingVisitorTest,
       .cpu = 0,
       .res = 0,
   };
-  event.ring_buffer_record->sample_id = sample_id;
+  event.ring_buffer_record.sample_id = sample_id;
 
   EXPECT_CALL(return_address_manager_, PatchSample).Times(1).WillRepeatedly(Return());
   EXPECT_CALL(maps_, Get).Times(1).WillOnce(Return(nullptr));
@@ -352,7 +412,7 @@ TEST_F(UprobesUnwindingVisitorTest,
       .cpu = 0,
       .res = 0,
   };
-  event.ring_buffer_record->sample_id = sample_id;
+  event.ring_buffer_record.sample_id = sample_id;
 
   EXPECT_CALL(return_address_manager_, PatchSample).Times(1).WillOnce(Return());
   EXPECT_CALL(maps_, Get).Times(1).WillOnce(Return(nullptr));
@@ -408,7 +468,7 @@ TEST_F(UprobesUnwindingVisitorTest, VisitStackSampleWithinUprobeSendsInUprobesCa
       .cpu = 0,
       .res = 0,
   };
-  event.ring_buffer_record->sample_id = sample_id;
+  event.ring_buffer_record.sample_id = sample_id;
 
   EXPECT_CALL(return_address_manager_, PatchSample).Times(1).WillOnce(Return());
   EXPECT_CALL(maps_, Get).Times(1).WillOnce(Return(nullptr));
@@ -484,7 +544,7 @@ TEST_F(UprobesUnwindingVisitorTest, VisitValidCallchainSampleWithoutUprobesSends
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
   EXPECT_CALL(return_address_manager_, PatchCallchain).Times(1).WillOnce(Return(true));
@@ -526,7 +586,7 @@ TEST_F(UprobesUnwindingVisitorTest, VisitSingleFrameCallchainSampleDoesNothing)
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
   EXPECT_CALL(return_address_manager_, PatchCallchain).Times(0);
@@ -568,7 +628,7 @@ TEST_F(UprobesUnwindingVisitorTest, VisitCallchainSampleInsideUprobeCodeSendsInU
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   EXPECT_CALL(maps_, Find(_)).WillRepeatedly(Return(&kTargetMapInfo));
   EXPECT_CALL(maps_, Find(kUprobesMapsStart)).WillRepeatedly(Return(&kUprobesMapInfo));
@@ -615,7 +675,7 @@ TEST_F(UprobesUnwindingVisitorTest, VisitCallchainSampleWithUprobeSendsCompleteC
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
   auto fake_patch_callchain = [](pid_t /*tid*/, uint64_t* callchain, uint64_t callchain_size,
@@ -676,7 +736,7 @@ TEST_F(UprobesUnwindingVisitorTest,
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
   EXPECT_CALL(leaf_function_call_manager_, PatchCallerOfLeafFunction)
@@ -725,7 +785,7 @@ TEST_F(UprobesUnwindingVisitorTest,
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
   EXPECT_CALL(return_address_manager_, PatchCallchain).Times(1).WillRepeatedly(Return(true));
@@ -743,7 +803,7 @@ TEST_F(UprobesUnwindingVisitorTest,
     patched_callchain.push_back(kTargetAddress2 + 1);
     patched_callchain.push_back(kTargetAddress3 + 1);
     event->ring_buffer_record.nr = patched_callchain.size();
-    event->ips = std::move(patched_callchain);
+    event->ips.assign(patched_callchain.begin(), patched_callchain.end());
     return Callstack::kComplete;
   };
   EXPECT_CALL(leaf_function_call_manager_, PatchCallerOfLeafFunction)
@@ -789,7 +849,7 @@ TEST_F(
       .res = 0,
   };
   event.ring_buffer_record.sample_id = sample_id;
-  event.ips = callchain;
+  event.ips.assign(callchain.begin(), callchain.end());
 
   EXPECT_CALL(maps_, Find).WillRepeatedly(Return(&kTargetMapInfo));
   EXPECT_CALL(return_address_manager_, PatchCallchain).Times(0);
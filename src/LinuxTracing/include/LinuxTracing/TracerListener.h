@@ -9,6 +9,10 @@
 
 namespace orbit_linux_tracing {
 
+// The tracer never calls the methods of TracerListener concurrently: the snapshots and errors are
+// sent before the ring buffers are read, and all the events read from the ring buffers, however
+// many threads read them, are sent by the single thread that processes them in order. Calls can
+// still come from different threads over the course of a capture.
 class TracerListener {
  public:
   virtual ~TracerListener() = default;
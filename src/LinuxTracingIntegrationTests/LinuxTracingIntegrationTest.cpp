@@ -13,9 +13,12 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <sys/utsname.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
+#include <functional>
 #include <thread>
 #include <utility>
 
@@ -929,7 +932,10 @@ TEST(LinuxTracingIntegrationTest, CallstackSamplesAndAddressInfos) {
       inner_function_virtual_address_range, samples_per_second, &address_infos_received);
 }
 
-TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCalls) {
+// Runs the puppet's command with function calls and DWARF callstack samples, using the default
+// capture options as changed by `modify_capture_options`, and verifies the resulting events.
+void VerifyCallstackSamplesTogetherWithFunctionCalls(
+    const std::function<void(orbit_grpc_protos::CaptureOptions*)>& modify_capture_options) {
   if (!CheckIsRunningAsRoot()) {
     GTEST_SKIP();
   }
@@ -944,6 +950,7 @@ TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCalls) {
   constexpr uint64_t kInnerFunctionId = 2;
   AddOuterAndInnerFunctionToCaptureOptions(&capture_options, fixture.GetPuppetPid(),
                                            kOuterFunctionId, kInnerFunctionId);
+  modify_capture_options(&capture_options);
   const double sampling_rate = capture_options.samples_per_second();
 
   std::vector<orbit_grpc_protos::ProducerCaptureEvent> events =
@@ -966,6 +973,166 @@ TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCalls) {
       inner_function_virtual_address_range, sampling_rate, &address_infos_received);
 }
 
+TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCalls) {
+  VerifyCallstackSamplesTogetherWithFunctionCalls(
+      [](orbit_grpc_protos::CaptureOptions* /*capture_options*/) {});
+}
+
+TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCallsAndMultipleReaders) {
+  VerifyCallstackSamplesTogetherWithFunctionCalls(
+      [](orbit_grpc_protos::CaptureOptions* capture_options) {
+        capture_options->set_ring_buffer_reader_thread_count(4);
+      });
+}
+
+TEST(LinuxTracingIntegrationTest,
+     CallstackSamplesTogetherWithFunctionCallsAndEventDrivenRingBufferPolling) {
+  VerifyCallstackSamplesTogetherWithFunctionCalls(
+      [](orbit_grpc_protos::CaptureOptions* capture_options) {
+        capture_options->set_event_driven_ring_buffer_polling(true);
+      });
+}
+
+TEST(LinuxTracingIntegrationTest,
+     CallstackSamplesTogetherWithFunctionCallsAndUnwindingOnOneThread) {
+  VerifyCallstackSamplesTogetherWithFunctionCalls(
+      [](orbit_grpc_protos::CaptureOptions* capture_options) {
+        capture_options->set_unwinding_thread_count(1);
+      });
+}
+
+TEST(LinuxTracingIntegrationTest,
+     CallstackSamplesTogetherWithFunctionCallsAndUnwindingOnMultipleThreads) {
+  VerifyCallstackSamplesTogetherWithFunctionCalls(
+      [](orbit_grpc_protos::CaptureOptions* capture_options) {
+        capture_options->set_unwinding_thread_count(4);
+      });
+}
+
+TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCallsAndPrecompiledCfi) {
+  VerifyCallstackSamplesTogetherWithFunctionCalls(
+      [](orbit_grpc_protos::CaptureOptions* capture_options) {
+        capture_options->set_unwind_with_precompiled_cfi(true);
+      });
+}
+
+TEST(LinuxTracingIntegrationTest, CallstackSamplesTogetherWithFunctionCallsAndUnwindingCache) {
+  VerifyCallstackSamplesTogetherWithFunctionCalls(
+      [](orbit_grpc_protos::CaptureOptions* capture_options) {
+        capture_options->set_use_unwinding_cache(true);
+      });
+}
+
+struct UnwindingMeasurement {
+  uint64_t cpu_time_ns = 0;
+  uint64_t complete_callstack_count = 0;
+  uint64_t callstack_count = 0;
+};
+
+// Runs the puppet's command while sampling it with DWARF unwinding on a single thread, and measures
+// the CPU time spent by this process (which only runs the tracer and the BufferTracerListener).
+UnwindingMeasurement MeasureUnwinding(bool unwind_with_precompiled_cfi) {
+  LinuxTracingIntegrationTestFixture fixture;
+  orbit_grpc_protos::CaptureOptions capture_options = fixture.BuildDefaultCaptureOptions();
+  capture_options.set_unwinding_thread_count(1);
+  capture_options.set_unwind_with_precompiled_cfi(unwind_with_precompiled_cfi);
+
+  timespec cpu_time_start{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time_start);
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events =
+      TraceAndGetEvents(&fixture, PuppetConstants::kCallOuterFunctionCommand, capture_options);
+  timespec cpu_time_end{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time_end);
+
+  VerifyOrderOfAllEvents(events);
+
+  UnwindingMeasurement measurement;
+  measurement.cpu_time_ns = absl::ToInt64Nanoseconds(absl::DurationFromTimespec(cpu_time_end) -
+                                                     absl::DurationFromTimespec(cpu_time_start));
+  for (const orbit_grpc_protos::ProducerCaptureEvent& event : events) {
+    if (!event.has_full_callstack_sample()) continue;
+    ++measurement.callstack_count;
+    if (event.full_callstack_sample().callstack().type() ==
+        orbit_grpc_protos::Callstack::kComplete) {
+      ++measurement.complete_callstack_count;
+    }
+  }
+  return measurement;
+}
+
+// Logs the CPU time spent unwinding the same workload with libunwindstack only and with the
+// precompiled CFI tables. It makes no assertions, so it only runs when disabled tests are
+// requested.
+TEST(LinuxTracingIntegrationTest, DISABLED_PrecompiledCfiUnwindingBenchmark) {
+  if (!CheckIsRunningAsRoot()) {
+    GTEST_SKIP();
+  }
+
+  UnwindingMeasurement libunwindstack = MeasureUnwinding(/*unwind_with_precompiled_cfi=*/false);
+  UnwindingMeasurement precompiled_cfi = MeasureUnwinding(/*unwind_with_precompiled_cfi=*/true);
+  LOG("libunwindstack: cpu_time=%.1fms (%.1fus/callstack) complete_callstacks=%lu/%lu; "
+      "precompiled CFI: cpu_time=%.1fms (%.1fus/callstack) complete_callstacks=%lu/%lu",
+      libunwindstack.cpu_time_ns / 1e6,
+      libunwindstack.cpu_time_ns / 1e3 / std::max<uint64_t>(libunwindstack.callstack_count, 1),
+      libunwindstack.complete_callstack_count, libunwindstack.callstack_count,
+      precompiled_cfi.cpu_time_ns / 1e6,
+      precompiled_cfi.cpu_time_ns / 1e3 / std::max<uint64_t>(precompiled_cfi.callstack_count, 1),
+      precompiled_cfi.complete_callstack_count, precompiled_cfi.callstack_count);
+}
+
+struct RingBufferPollingModeMeasurement {
+  uint64_t cpu_time_ns = 0;
+  uint64_t lost_perf_records_event_count = 0;
+};
+
+// Runs the puppet's command while tracing, and measures the CPU time spent by this process (which
+// only runs the tracer and the BufferTracerListener) as well as how many times records were lost.
+RingBufferPollingModeMeasurement MeasureRingBufferPollingMode(std::string_view command,
+                                                              bool event_driven) {
+  LinuxTracingIntegrationTestFixture fixture;
+  orbit_grpc_protos::CaptureOptions capture_options = fixture.BuildDefaultCaptureOptions();
+  capture_options.set_event_driven_ring_buffer_polling(event_driven);
+
+  timespec cpu_time_start{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time_start);
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events =
+      TraceAndGetEvents(&fixture, command, capture_options);
+  timespec cpu_time_end{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time_end);
+
+  VerifyOrderOfAllEvents(events);
+
+  RingBufferPollingModeMeasurement measurement;
+  measurement.cpu_time_ns = absl::ToInt64Nanoseconds(absl::DurationFromTimespec(cpu_time_end) -
+                                                     absl::DurationFromTimespec(cpu_time_start));
+  for (const orbit_grpc_protos::ProducerCaptureEvent& event : events) {
+    if (event.has_lost_perf_records_event()) {
+      ++measurement.lost_perf_records_event_count;
+    }
+  }
+  return measurement;
+}
+
+// Traces the puppet with each ring buffer polling mode, once mostly idle and once while sampling it
+// heavily, and logs the CPU time and lost records of each run. Not run by default.
+TEST(LinuxTracingIntegrationTest, DISABLED_RingBufferPollingModesBenchmark) {
+  if (!CheckIsRunningAsRoot()) {
+    GTEST_SKIP();
+  }
+
+  for (std::string_view command :
+       {PuppetConstants::kSleepCommand, PuppetConstants::kCallOuterFunctionCommand}) {
+    RingBufferPollingModeMeasurement polling =
+        MeasureRingBufferPollingMode(command, /*event_driven=*/false);
+    RingBufferPollingModeMeasurement event_driven =
+        MeasureRingBufferPollingMode(command, /*event_driven=*/true);
+    LOG("%s: polling: cpu_time=%.1fms lost_perf_records_events=%lu; event-driven: "
+        "cpu_time=%.1fms lost_perf_records_events=%lu",
+        command, polling.cpu_time_ns / 1e6, polling.lost_perf_records_event_count,
+        event_driven.cpu_time_ns / 1e6, event_driven.lost_perf_records_event_count);
+  }
+}
+
 void VerifyNoAddressInfos(const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events) {
   for (const auto& event : events) {
     EXPECT_NE(event.event_case(), orbit_grpc_protos::ProducerCaptureEvent::kFullAddressInfo);
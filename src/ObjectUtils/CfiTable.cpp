@@ -0,0 +1,650 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ObjectUtils/CfiTable.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <outcome.hpp>
+#include <string>
+#include <utility>
+
+#include "ObjectUtils/ElfFile.h"
+
+namespace orbit_object_utils {
+
+namespace {
+
+// DWARF register numbers on x86-64.
+constexpr uint64_t kDwarfRegRbp = 6;
+constexpr uint64_t kDwarfRegRsp = 7;
+
+// Pointer encodings (DW_EH_PE_*) used in .eh_frame.
+constexpr uint8_t kPointerEncodingFormatMask = 0x0f;
+constexpr uint8_t kPointerEncodingApplicationMask = 0x70;
+constexpr uint8_t kPointerEncodingIndirect = 0x80;
+constexpr uint8_t kPointerEncodingAbsPtr = 0x00;
+constexpr uint8_t kPointerEncodingUleb128 = 0x01;
+constexpr uint8_t kPointerEncodingUdata2 = 0x02;
+constexpr uint8_t kPointerEncodingUdata4 = 0x03;
+constexpr uint8_t kPointerEncodingUdata8 = 0x04;
+constexpr uint8_t kPointerEncodingSleb128 = 0x09;
+constexpr uint8_t kPointerEncodingSdata2 = 0x0a;
+constexpr uint8_t kPointerEncodingSdata4 = 0x0b;
+constexpr uint8_t kPointerEncodingSdata8 = 0x0c;
+constexpr uint8_t kPointerEncodingPcRel = 0x10;
+
+// Reads the little-endian values of .eh_frame. Reading past the end doesn't fail immediately, but
+// returns zeros and sets a flag that is checked after reading each entry.
+class Reader {
+ public:
+  Reader(absl::Span<const uint8_t> data, uint64_t data_address)
+      : data_{data}, data_address_{data_address} {}
+
+  [[nodiscard]] uint64_t GetOffset() const { return offset_; }
+  void SetOffset(uint64_t offset) { offset_ = offset; }
+  [[nodiscard]] bool HasOverflowed() const { return has_overflowed_; }
+
+  [[nodiscard]] uint8_t ReadU8() { return ReadFixed<uint8_t>(); }
+  [[nodiscard]] uint16_t ReadU16() { return ReadFixed<uint16_t>(); }
+  [[nodiscard]] uint32_t ReadU32() { return ReadFixed<uint32_t>(); }
+  [[nodiscard]] uint64_t ReadU64() { return ReadFixed<uint64_t>(); }
+
+  [[nodiscard]] uint64_t ReadUleb128() {
+    uint64_t result = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+    do {
+      byte = ReadU8();
+      if (shift < 64) result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      shift += 7;
+    } while ((byte & 0x80) != 0 && !has_overflowed_);
+    return result;
+  }
+
+  [[nodiscard]] int64_t ReadSleb128() {
+    uint64_t result = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+    do {
+      byte = ReadU8();
+      if (shift < 64) result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      shift += 7;
+    } while ((byte & 0x80) != 0 && !has_overflowed_);
+    if (shift < 64 && (byte & 0x40) != 0) result |= ~uint64_t{0} << shift;
+    return static_cast<int64_t>(result);
+  }
+
+  // Returns an empty optional for encodings that can't be resolved from .eh_frame alone.
+  [[nodiscard]] std::optional<uint64_t> ReadEncodedPointer(uint8_t encoding) {
+    if ((encoding & kPointerEncodingIndirect) != 0) return std::nullopt;
+    const uint64_t field_address = data_address_ + offset_;
+
+    uint64_t value;
+    switch (encoding & kPointerEncodingFormatMask) {
+      case kPointerEncodingAbsPtr:
+      case kPointerEncodingUdata8:
+      case kPointerEncodingSdata8:
+        value = ReadU64();
+        break;
+      case kPointerEncodingUleb128:
+        value = ReadUleb128();
+        break;
+      case kPointerEncodingUdata2:
+        value = ReadU16();
+        break;
+      case kPointerEncodingUdata4:
+        value = ReadU32();
+        break;
+      case kPointerEncodingSleb128:
+        value = ReadSleb128();
+        break;
+      case kPointerEncodingSdata2:
+        value = static_cast<int16_t>(ReadU16());
+        break;
+      case kPointerEncodingSdata4:
+        value = static_cast<int32_t>(ReadU32());
+        break;
+      default:
+        return std::nullopt;
+    }
+
+    switch (encoding & kPointerEncodingApplicationMask) {
+      case 0:
+        return value;
+      case kPointerEncodingPcRel:
+        return field_address + value;
+      default:
+        return std::nullopt;
+    }
+  }
+
+ private:
+  template <typename T>
+  [[nodiscard]] T ReadFixed() {
+    if (offset_ > data_.size() || data_.size() - offset_ < sizeof(T)) {
+      has_overflowed_ = true;
+      offset_ = data_.size();
+      return 0;
+    }
+    T value;
+    std::memcpy(&value, data_.data() + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return value;
+  }
+
+  absl::Span<const uint8_t> data_;
+  uint64_t data_address_;
+  uint64_t offset_ = 0;
+  bool has_overflowed_ = false;
+};
+
+struct Cie {
+  uint64_t code_alignment_factor = 0;
+  int64_t data_alignment_factor = 0;
+  uint64_t return_address_register = 0;
+  uint8_t fde_pointer_encoding = kPointerEncodingAbsPtr;
+  bool has_augmentation_data = false;
+  bool is_signal_frame = false;
+  // Offsets of the initial instructions in .eh_frame.
+  uint64_t instructions_begin = 0;
+  uint64_t instructions_end = 0;
+};
+
+// The rule to recover the value of $rbp or of the return address in the caller.
+struct RegisterRule {
+  enum class Type { kSameValue, kUndefined, kOffset, kUnsupported };
+  Type type = Type::kSameValue;
+  int64_t offset = 0;
+};
+
+// The state of the CFA program interpretation, for the registers that CfiRow can represent.
+struct CfaState {
+  uint64_t cfa_register = kDwarfRegRsp;
+  int64_t cfa_offset = 0;
+  bool cfa_is_expression = false;
+  RegisterRule rbp;
+  RegisterRule return_address;
+};
+
+// A range of addresses with the same rule, as produced by interpreting one FDE.
+struct CfiRange {
+  uint64_t start;
+  uint64_t end;
+  CfiRow row;
+};
+
+[[nodiscard]] bool FitsInInt32(int64_t value) {
+  return value >= std::numeric_limits<int32_t>::min() &&
+         value <= std::numeric_limits<int32_t>::max();
+}
+
+[[nodiscard]] CfiRow ConvertCfaStateToRow(const CfaState& state) {
+  CfiRow row;
+  if (state.return_address.type == RegisterRule::Type::kUndefined) {
+    row.type = CfiRow::Type::kOutermostFrame;
+    return row;
+  }
+
+  row.type = CfiRow::Type::kUnsupported;
+  if (state.cfa_is_expression || !FitsInInt32(state.cfa_offset)) return row;
+  if (state.return_address.type != RegisterRule::Type::kOffset ||
+      !FitsInInt32(state.return_address.offset)) {
+    return row;
+  }
+  if (state.rbp.type != RegisterRule::Type::kSameValue &&
+      (state.rbp.type != RegisterRule::Type::kOffset || state.rbp.offset == 0 ||
+       !FitsInInt32(state.rbp.offset))) {
+    return row;
+  }
+
+  if (state.cfa_register == kDwarfRegRsp) {
+    row.type = CfiRow::Type::kCfaIsRspPlusOffset;
+  } else if (state.cfa_register == kDwarfRegRbp) {
+    row.type = CfiRow::Type::kCfaIsRbpPlusOffset;
+  } else {
+    return row;
+  }
+  row.cfa_offset = static_cast<int32_t>(state.cfa_offset);
+  row.ra_offset = static_cast<int32_t>(state.return_address.offset);
+  row.rbp_offset = state.rbp.type == RegisterRule::Type::kOffset
+                       ? static_cast<int32_t>(state.rbp.offset)
+                       : 0;
+  return row;
+}
+
+// Interprets the CFA instructions of a CIE and of its FDEs.
+class CfaProgramInterpreter {
+ public:
+  CfaProgramInterpreter(Cie cie, Reader* reader) : cie_{cie}, reader_{reader} {}
+
+  [[nodiscard]] const Cie& GetCie() const { return cie_; }
+
+  // Runs the initial instructions of the CIE, whose resulting state is the initial state of every
+  // FDE and the target of DW_CFA_restore.
+  [[nodiscard]] ErrorMessageOr<void> RunInitialInstructions() {
+    OUTCOME_TRY(Run(cie_.instructions_begin, cie_.instructions_end, 0, 0, nullptr));
+    initial_state_ = state_;
+    return outcome::success();
+  }
+
+  // Runs the instructions of an FDE and appends the resulting ranges to `ranges`.
+  [[nodiscard]] ErrorMessageOr<void> RunFdeInstructions(uint64_t instructions_begin,
+                                                        uint64_t instructions_end,
+                                                        uint64_t pc_begin, uint64_t pc_end,
+                                                        std::vector<CfiRange>* ranges) {
+    state_ = initial_state_;
+    remembered_states_.clear();
+    return Run(instructions_begin, instructions_end, pc_begin, pc_end, ranges);
+  }
+
+ private:
+  [[nodiscard]] RegisterRule* GetRegisterRule(uint64_t reg) {
+    if (reg == kDwarfRegRbp) return &state_.rbp;
+    if (reg == cie_.return_address_register) return &state_.return_address;
+    // The rules for other registers are not needed to unwind with a CfiRow.
+    return nullptr;
+  }
+
+  void SetRegisterRule(uint64_t reg, RegisterRule::Type type, int64_t offset = 0) {
+    RegisterRule* rule = GetRegisterRule(reg);
+    if (rule == nullptr) return;
+    rule->type = type;
+    rule->offset = offset;
+  }
+
+  void RestoreRegisterRule(uint64_t reg) {
+    if (reg == kDwarfRegRbp) state_.rbp = initial_state_.rbp;
+    if (reg == cie_.return_address_register) state_.return_address = initial_state_.return_address;
+  }
+
+  // Emits the current row for the addresses up to `new_location`.
+  void AdvanceLocation(uint64_t new_location, std::vector<CfiRange>* ranges) {
+    if (ranges == nullptr) return;
+    new_location = std::min(new_location, pc_end_);
+    if (new_location <= location_) return;
+    ranges->push_back({location_, new_location, ConvertCfaStateToRow(state_)});
+    location_ = new_location;
+  }
+
+  [[nodiscard]] ErrorMessageOr<void> Run(uint64_t instructions_begin, uint64_t instructions_end,
+                                         uint64_t pc_begin, uint64_t pc_end,
+                                         std::vector<CfiRange>* ranges);
+
+  Cie cie_;
+  Reader* reader_;
+  CfaState initial_state_;
+  CfaState state_;
+  std::vector<CfaState> remembered_states_;
+  uint64_t location_ = 0;
+  uint64_t pc_end_ = 0;
+};
+
+ErrorMessageOr<void> CfaProgramInterpreter::Run(uint64_t instructions_begin,
+                                                uint64_t instructions_end, uint64_t pc_begin,
+                                                uint64_t pc_end, std::vector<CfiRange>* ranges) {
+  location_ = pc_begin;
+  pc_end_ = pc_end;
+  const uint64_t caf = cie_.code_alignment_factor;
+  const int64_t daf = cie_.data_alignment_factor;
+
+  reader_->SetOffset(instructions_begin);
+  while (reader_->GetOffset() < instructions_end) {
+    const uint8_t opcode = reader_->ReadU8();
+    const uint8_t operand = opcode & 0x3f;
+    switch (opcode & 0xc0) {
+      case 0x40:  // DW_CFA_advance_loc
+        AdvanceLocation(location_ + operand * caf, ranges);
+        continue;
+      case 0x80:  // DW_CFA_offset
+        SetRegisterRule(operand, RegisterRule::Type::kOffset,
+                        static_cast<int64_t>(reader_->ReadUleb128()) * daf);
+        continue;
+      case 0xc0:  // DW_CFA_restore
+        RestoreRegisterRule(operand);
+        continue;
+      default:
+        break;
+    }
+
+    switch (opcode) {
+      case 0x00:  // DW_CFA_nop
+        break;
+      case 0x01: {  // DW_CFA_set_loc
+        std::optional<uint64_t> new_location =
+            reader_->ReadEncodedPointer(cie_.fde_pointer_encoding);
+        if (!new_location.has_value() || new_location.value() < location_) {
+          return ErrorMessage("Invalid DW_CFA_set_loc.");
+        }
+        AdvanceLocation(new_location.value(), ranges);
+        break;
+      }
+      case 0x02:  // DW_CFA_advance_loc1
+        AdvanceLocation(location_ + reader_->ReadU8() * caf, ranges);
+        break;
+      case 0x03:  // DW_CFA_advance_loc2
+        AdvanceLocation(location_ + reader_->ReadU16() * caf, ranges);
+        break;
+      case 0x04:  // DW_CFA_advance_loc4
+        AdvanceLocation(location_ + reader_->ReadU32() * caf, ranges);
+        break;
+      case 0x05: {  // DW_CFA_offset_extended
+        const uint64_t reg = reader_->ReadUleb128();
+        SetRegisterRule(reg, RegisterRule::Type::kOffset,
+                        static_cast<int64_t>(reader_->ReadUleb128()) * daf);
+        break;
+      }
+      case 0x06:  // DW_CFA_restore_extended
+        RestoreRegisterRule(reader_->ReadUleb128());
+        break;
+      case 0x07:  // DW_CFA_undefined
+        SetRegisterRule(reader_->ReadUleb128(), RegisterRule::Type::kUndefined);
+        break;
+      case 0x08:  // DW_CFA_same_value
+        SetRegisterRule(reader_->ReadUleb128(), RegisterRule::Type::kSameValue);
+        break;
+      case 0x09: {  // DW_CFA_register
+        const uint64_t reg = reader_->ReadUleb128();
+        const uint64_t other_reg = reader_->ReadUleb128();
+        SetRegisterRule(reg, reg == other_reg ? RegisterRule::Type::kSameValue
+                                              : RegisterRule::Type::kUnsupported);
+        break;
+      }
+      case 0x0a:  // DW_CFA_remember_state
+        remembered_states_.push_back(state_);
+        break;
+      case 0x0b: {  // DW_CFA_restore_state
+        if (remembered_states_.empty()) return ErrorMessage("Unbalanced DW_CFA_restore_state.");
+        // The location is not part of the remembered state.
+        state_ = remembered_states_.back();
+        remembered_states_.pop_back();
+        break;
+      }
+      case 0x0c:  // DW_CFA_def_cfa
+        state_.cfa_register = reader_->ReadUleb128();
+        state_.cfa_offset = static_cast<int64_t>(reader_->ReadUleb128());
+        state_.cfa_is_expression = false;
+        break;
+      case 0x0d:  // DW_CFA_def_cfa_register
+        state_.cfa_register = reader_->ReadUleb128();
+        state_.cfa_is_expression = false;
+        break;
+      case 0x0e:  // DW_CFA_def_cfa_offset
+        state_.cfa_offset = static_cast<int64_t>(reader_->ReadUleb128());
+        break;
+      case 0x0f: {  // DW_CFA_def_cfa_expression
+        const uint64_t size = reader_->ReadUleb128();
+        reader_->SetOffset(reader_->GetOffset() + size);
+        state_.cfa_is_expression = true;
+        break;
+      }
+      case 0x10:    // DW_CFA_expression
+      case 0x16: {  // DW_CFA_val_expression
+        const uint64_t reg = reader_->ReadUleb128();
+        const uint64_t size = reader_->ReadUleb128();
+        reader_->SetOffset(reader_->GetOffset() + size);
+        SetRegisterRule(reg, RegisterRule::Type::kUnsupported);
+        break;
+      }
+      case 0x11: {  // DW_CFA_offset_extended_sf
+        const uint64_t reg = reader_->ReadUleb128();
+        SetRegisterRule(reg, RegisterRule::Type::kOffset, reader_->ReadSleb128() * daf);
+        break;
+      }
+      case 0x12:  // DW_CFA_def_cfa_sf
+        state_.cfa_register = reader_->ReadUleb128();
+        state_.cfa_offset = reader_->ReadSleb128() * daf;
+        state_.cfa_is_expression = false;
+        break;
+      case 0x13:  // DW_CFA_def_cfa_offset_sf
+        state_.cfa_offset = reader_->ReadSleb128() * daf;
+        break;
+      case 0x14:    // DW_CFA_val_offset
+      case 0x15: {  // DW_CFA_val_offset_sf
+        const uint64_t reg = reader_->ReadUleb128();
+        (void)reader_->ReadUleb128();
+        SetRegisterRule(reg, RegisterRule::Type::kUnsupported);
+        break;
+      }
+      case 0x2e:  // DW_CFA_GNU_args_size
+        (void)reader_->ReadUleb128();
+        break;
+      case 0x2f: {  // DW_CFA_GNU_negative_offset_extended
+        const uint64_t reg = reader_->ReadUleb128();
+        SetRegisterRule(reg, RegisterRule::Type::kOffset,
+                        -static_cast<int64_t>(reader_->ReadUleb128()) * daf);
+        break;
+      }
+      default:
+        return ErrorMessage(absl::StrFormat("Unknown CFA instruction 0x%x.", opcode));
+    }
+
+    if (reader_->HasOverflowed()) return ErrorMessage("CFA instructions are truncated.");
+  }
+
+  if (reader_->GetOffset() > instructions_end) {
+    return ErrorMessage("CFA instructions are truncated.");
+  }
+  AdvanceLocation(pc_end, ranges);
+  return outcome::success();
+}
+
+[[nodiscard]] ErrorMessageOr<Cie> ParseCie(Reader* reader, uint64_t cie_offset) {
+  reader->SetOffset(cie_offset);
+  uint64_t length = reader->ReadU32();
+  bool is_64_bit = false;
+  if (length == 0xffffffff) {
+    length = reader->ReadU64();
+    is_64_bit = true;
+  }
+  const uint64_t cie_end = reader->GetOffset() + length;
+  const uint64_t cie_id = is_64_bit ? reader->ReadU64() : reader->ReadU32();
+  if (cie_id != 0) return ErrorMessage("FDE does not point to a CIE.");
+
+  Cie cie;
+  const uint8_t version = reader->ReadU8();
+  if (version != 1 && version != 3 && version != 4) {
+    return ErrorMessage(absl::StrFormat("Unsupported CIE version %u.", version));
+  }
+
+  std::string augmentation;
+  for (uint8_t c = reader->ReadU8(); c != 0 && !reader->HasOverflowed(); c = reader->ReadU8()) {
+    augmentation.push_back(static_cast<char>(c));
+  }
+  if (version == 4) {
+    const uint8_t address_size = reader->ReadU8();
+    const uint8_t segment_size = reader->ReadU8();
+    if (address_size != 8 || segment_size != 0) {
+      return ErrorMessage("Unsupported address or segment size in CIE.");
+    }
+  }
+  cie.code_alignment_factor = reader->ReadUleb128();
+  cie.data_alignment_factor = reader->ReadSleb128();
+  cie.return_address_register = version == 1 ? reader->ReadU8() : reader->ReadUleb128();
+
+  if (!augmentation.empty()) {
+    if (augmentation[0] != 'z') {
+      return ErrorMessage(absl::StrFormat("Unsupported CIE augmentation \"%s\".", augmentation));
+    }
+    cie.has_augmentation_data = true;
+    const uint64_t augmentation_data_size = reader->ReadUleb128();
+    const uint64_t augmentation_data_end = reader->GetOffset() + augmentation_data_size;
+    for (size_t i = 1; i < augmentation.size(); ++i) {
+      const char c = augmentation[i];
+      if (c == 'R') {
+        cie.fde_pointer_encoding = reader->ReadU8();
+      } else if (c == 'P') {
+        const uint8_t personality_encoding = reader->ReadU8();
+        // The personality routine is not needed for unwinding, but its size depends on its
+        // encoding. Indirect pointers are still stored directly in .eh_frame.
+        (void)reader->ReadEncodedPointer(
+            static_cast<uint8_t>(personality_encoding & ~kPointerEncodingIndirect));
+      } else if (c == 'L') {
+        (void)reader->ReadU8();
+      } else if (c == 'S') {
+        cie.is_signal_frame = true;
+      } else {
+        // The data of unknown augmentations can be skipped thanks to 'z', but the following
+        // augmentations can't be interpreted anymore.
+        break;
+      }
+    }
+    reader->SetOffset(augmentation_data_end);
+  }
+
+  cie.instructions_begin = reader->GetOffset();
+  cie.instructions_end = cie_end;
+  if (reader->HasOverflowed() || cie.instructions_begin > cie.instructions_end) {
+    return ErrorMessage("CIE is truncated.");
+  }
+  return cie;
+}
+
+// Builds the rows of one FDE, whose fields start at the current offset of the reader, after the
+// CIE pointer.
+[[nodiscard]] ErrorMessageOr<void> ParseFde(Reader* reader, uint64_t fde_end, const Cie& cie,
+                                            CfaProgramInterpreter* interpreter,
+                                            std::vector<CfiRange>* ranges) {
+  std::optional<uint64_t> pc_begin = reader->ReadEncodedPointer(cie.fde_pointer_encoding);
+  // The address range is never relative.
+  std::optional<uint64_t> pc_range =
+      reader->ReadEncodedPointer(cie.fde_pointer_encoding & kPointerEncodingFormatMask);
+  if (!pc_begin.has_value() || !pc_range.has_value()) {
+    return ErrorMessage(
+        absl::StrFormat("Unsupported FDE pointer encoding 0x%x.", cie.fde_pointer_encoding));
+  }
+  if (pc_range.value() == 0) return outcome::success();
+  const uint64_t pc_end = pc_begin.value() + pc_range.value();
+
+  if (cie.has_augmentation_data) {
+    const uint64_t augmentation_data_size = reader->ReadUleb128();
+    reader->SetOffset(reader->GetOffset() + augmentation_data_size);
+  }
+  if (reader->HasOverflowed() || reader->GetOffset() > fde_end) {
+    return ErrorMessage("FDE is truncated.");
+  }
+
+  // Signal frames are unwound differently (e.g., the program counter must not be adjusted to
+  // look up the rule), so we leave them to the fallback.
+  const size_t range_count_before_fde = ranges->size();
+  if (cie.is_signal_frame || interpreter
+                                 ->RunFdeInstructions(reader->GetOffset(), fde_end,
+                                                      pc_begin.value(), pc_end, ranges)
+                                 .has_error()) {
+    // Whatever we can't interpret makes the whole FDE unsupported, without failing the whole table.
+    ranges->resize(range_count_before_fde);
+    CfiRow unsupported_row;
+    unsupported_row.type = CfiRow::Type::kUnsupported;
+    ranges->push_back({pc_begin.value(), pc_end, unsupported_row});
+  }
+  return outcome::success();
+}
+
+}  // namespace
+
+ErrorMessageOr<CfiTable> CfiTable::CreateFromEhFrame(uint64_t eh_frame_address,
+                                                     absl::Span<const uint8_t> eh_frame,
+                                                     uint64_t load_bias) {
+  Reader reader{eh_frame, eh_frame_address};
+  absl::flat_hash_map<uint64_t, std::unique_ptr<CfaProgramInterpreter>> interpreters_by_cie_offset;
+  std::vector<CfiRange> ranges;
+
+  uint64_t entry_offset = 0;
+  while (entry_offset < eh_frame.size()) {
+    reader.SetOffset(entry_offset);
+    uint64_t length = reader.ReadU32();
+    // A zero length marks the end of .eh_frame.
+    if (length == 0) break;
+    bool is_64_bit = false;
+    if (length == 0xffffffff) {
+      length = reader.ReadU64();
+      is_64_bit = true;
+    }
+    const uint64_t entry_end = reader.GetOffset() + length;
+    if (reader.HasOverflowed() || length > eh_frame.size() || entry_end > eh_frame.size()) {
+      return ErrorMessage(
+          absl::StrFormat("Truncated .eh_frame entry at offset 0x%x.", entry_offset));
+    }
+
+    const uint64_t cie_pointer_offset = reader.GetOffset();
+    const uint64_t cie_pointer = is_64_bit ? reader.ReadU64() : reader.ReadU32();
+    if (cie_pointer != 0) {
+      // This is an FDE: the CIE pointer is relative to its own offset.
+      if (cie_pointer > cie_pointer_offset) {
+        return ErrorMessage(
+            absl::StrFormat("Invalid CIE pointer in FDE at offset 0x%x.", entry_offset));
+      }
+      const uint64_t cie_offset = cie_pointer_offset - cie_pointer;
+      auto interpreter_it = interpreters_by_cie_offset.find(cie_offset);
+      if (interpreter_it == interpreters_by_cie_offset.end()) {
+        Reader cie_reader{eh_frame, eh_frame_address};
+        OUTCOME_TRY(cie, ParseCie(&cie_reader, cie_offset));
+        auto interpreter = std::make_unique<CfaProgramInterpreter>(cie, &reader);
+        OUTCOME_TRY(interpreter->RunInitialInstructions());
+        interpreter_it =
+            interpreters_by_cie_offset.emplace(cie_offset, std::move(interpreter)).first;
+        reader.SetOffset(cie_pointer_offset + (is_64_bit ? 8 : 4));
+      }
+      CfaProgramInterpreter* interpreter = interpreter_it->second.get();
+      OUTCOME_TRY(ParseFde(&reader, entry_end, interpreter->GetCie(), interpreter, &ranges));
+    }
+
+    entry_offset = entry_end;
+  }
+
+  std::stable_sort(ranges.begin(), ranges.end(),
+                   [](const CfiRange& lhs, const CfiRange& rhs) { return lhs.start < rhs.start; });
+
+  CfiTable table;
+  table.load_bias_ = load_bias;
+  table.row_start_addresses_.reserve(ranges.size() + 1);
+  table.rows_.reserve(ranges.size() + 1);
+  uint64_t previous_end = 0;
+  for (const CfiRange& range : ranges) {
+    // FDEs are not supposed to overlap. If they do, the first one wins.
+    const uint64_t start = std::max(range.start, previous_end);
+    if (start >= range.end) continue;
+    if (start > previous_end && !table.rows_.empty()) {
+      table.row_start_addresses_.push_back(previous_end);
+      table.rows_.emplace_back();
+    }
+    if (table.rows_.empty() || table.rows_.back() != range.row) {
+      table.row_start_addresses_.push_back(start);
+      table.rows_.push_back(range.row);
+    }
+    previous_end = range.end;
+  }
+  if (!table.rows_.empty()) {
+    table.row_start_addresses_.push_back(previous_end);
+    table.rows_.emplace_back();
+  }
+  table.row_start_addresses_.shrink_to_fit();
+  table.rows_.shrink_to_fit();
+  return table;
+}
+
+ErrorMessageOr<CfiTable> CfiTable::CreateFromElfFile(const std::filesystem::path& file_path) {
+  OUTCOME_TRY(elf_file, CreateElfFile(file_path));
+  if (!elf_file->Is64Bit()) {
+    return ErrorMessage(absl::StrFormat("Unable to create CFI table for 32-bit ELF file \"%s\".",
+                                        file_path.string()));
+  }
+  OUTCOME_TRY(eh_frame_section, elf_file->GetEhFrameSection());
+  return CreateFromEhFrame(eh_frame_section.address, eh_frame_section.contents,
+                           elf_file->GetLoadBias());
+}
+
+const CfiRow& CfiTable::FindRow(uint64_t address) const {
+  static const CfiRow kNoInfoRow{};
+  auto it = std::upper_bound(row_start_addresses_.begin(), row_start_addresses_.end(), address);
+  if (it == row_start_addresses_.begin()) return kNoInfoRow;
+  return rows_[it - row_start_addresses_.begin() - 1];
+}
+
+}  // namespace orbit_object_utils
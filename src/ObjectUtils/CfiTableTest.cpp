@@ -0,0 +1,242 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <filesystem>
+#include <vector>
+
+#include "ObjectUtils/CfiTable.h"
+#include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/Result.h"
+#include "OrbitBase/TestUtils.h"
+
+using orbit_base::HasError;
+using orbit_base::HasNoError;
+
+namespace orbit_object_utils {
+
+namespace {
+
+constexpr uint64_t kEhFrameAddress = 0x2000;
+
+// Assembles a .eh_frame section with CIEs like the ones emitted by GCC and clang: code alignment
+// factor 1, data alignment factor -8, return address in register 16, and pc-relative 4-byte FDE
+// pointers.
+class EhFrameBuilder {
+ public:
+  // Returns the offset of the CIE, to be passed to AddFde.
+  uint64_t AddCie(const std::vector<uint8_t>& initial_instructions) {
+    const uint64_t cie_offset = data_.size();
+    std::vector<uint8_t> cie{0, 0, 0, 0, 1, 'z', 'R', 0, 1, 0x78, 16, 1, 0x1b};
+    cie.insert(cie.end(), initial_instructions.begin(), initial_instructions.end());
+    AppendEntry(cie);
+    return cie_offset;
+  }
+
+  void AddFde(uint64_t cie_offset, uint64_t pc_begin, uint32_t pc_range,
+              const std::vector<uint8_t>& instructions) {
+    const uint64_t fde_offset = data_.size();
+    std::vector<uint8_t> fde;
+    // The CIE pointer is relative to its own offset, right after the length.
+    AppendU32(&fde, static_cast<uint32_t>(fde_offset + 4 - cie_offset));
+    AppendU32(&fde, static_cast<uint32_t>(pc_begin - (kEhFrameAddress + fde_offset + 8)));
+    AppendU32(&fde, pc_range);
+    // Augmentation data size.
+    fde.push_back(0);
+    fde.insert(fde.end(), instructions.begin(), instructions.end());
+    AppendEntry(fde);
+  }
+
+  [[nodiscard]] std::vector<uint8_t> Build() const {
+    std::vector<uint8_t> result = data_;
+    AppendU32(&result, 0);
+    return result;
+  }
+
+ private:
+  static void AppendU32(std::vector<uint8_t>* data, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      data->push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  void AppendEntry(std::vector<uint8_t> entry) {
+    while ((entry.size() + 4) % 8 != 0) entry.push_back(0);  // DW_CFA_nop
+    AppendU32(&data_, static_cast<uint32_t>(entry.size()));
+    data_.insert(data_.end(), entry.begin(), entry.end());
+  }
+
+  std::vector<uint8_t> data_;
+};
+
+// DW_CFA_def_cfa: rsp+8, DW_CFA_offset: r16 at cfa-8.
+const std::vector<uint8_t> kDefaultInitialInstructions{0x0c, 0x07, 0x08, 0x90, 0x01};
+
+CfiRow MakeRow(CfiRow::Type type, int32_t cfa_offset, int32_t ra_offset, int32_t rbp_offset = 0) {
+  CfiRow row;
+  row.type = type;
+  row.cfa_offset = cfa_offset;
+  row.ra_offset = ra_offset;
+  row.rbp_offset = rbp_offset;
+  return row;
+}
+
+CfiRow MakeRow(CfiRow::Type type) { return MakeRow(type, 0, 0); }
+
+MATCHER_P(RowEq, expected_row, "") { return arg == expected_row; }
+
+}  // namespace
+
+TEST(CfiTable, FunctionWithFramePointer) {
+  EhFrameBuilder builder;
+  const uint64_t cie_offset = builder.AddCie(kDefaultInitialInstructions);
+  // push rbp; mov rbp, rsp; ...; pop rbp; ret
+  builder.AddFde(cie_offset, 0x1100, 0x20,
+                 {0x41, 0x0e, 0x10, 0x86, 0x02, 0x43, 0x0d, 0x06, 0x58, 0x0c, 0x07, 0x08});
+
+  std::vector<uint8_t> eh_frame = builder.Build();
+  ErrorMessageOr<CfiTable> table_or_error =
+      CfiTable::CreateFromEhFrame(kEhFrameAddress, eh_frame, 0);
+  ASSERT_THAT(table_or_error, HasNoError());
+  const CfiTable& table = table_or_error.value();
+
+  using Type = CfiRow::Type;
+  EXPECT_THAT(table.FindRow(0x10ff), RowEq(MakeRow(Type::kNoInfo)));
+  EXPECT_THAT(table.FindRow(0x1100), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8)));
+  EXPECT_THAT(table.FindRow(0x1101), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 16, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x1103), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 16, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x1104), RowEq(MakeRow(Type::kCfaIsRbpPlusOffset, 16, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x111b), RowEq(MakeRow(Type::kCfaIsRbpPlusOffset, 16, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x111c), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x111f), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x1120), RowEq(MakeRow(Type::kNoInfo)));
+  EXPECT_EQ(table.GetRowCount(), 5);
+}
+
+TEST(CfiTable, GapsBetweenFdesHaveNoInfoAndIdenticalAdjacentRowsAreMerged) {
+  EhFrameBuilder builder;
+  const uint64_t cie_offset = builder.AddCie(kDefaultInitialInstructions);
+  // The FDEs are not sorted by address.
+  builder.AddFde(cie_offset, 0x1200, 0x10, {});
+  builder.AddFde(cie_offset, 0x1100, 0x10, {});
+  builder.AddFde(cie_offset, 0x1110, 0x10, {});
+
+  std::vector<uint8_t> eh_frame = builder.Build();
+  ErrorMessageOr<CfiTable> table_or_error =
+      CfiTable::CreateFromEhFrame(kEhFrameAddress, eh_frame, 0x1000);
+  ASSERT_THAT(table_or_error, HasNoError());
+  const CfiTable& table = table_or_error.value();
+
+  using Type = CfiRow::Type;
+  EXPECT_THAT(table.FindRow(0x1100), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8)));
+  EXPECT_THAT(table.FindRow(0x111f), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8)));
+  EXPECT_THAT(table.FindRow(0x1120), RowEq(MakeRow(Type::kNoInfo)));
+  EXPECT_THAT(table.FindRow(0x11ff), RowEq(MakeRow(Type::kNoInfo)));
+  EXPECT_THAT(table.FindRow(0x1200), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8)));
+  EXPECT_THAT(table.FindRow(0x1210), RowEq(MakeRow(Type::kNoInfo)));
+  EXPECT_EQ(table.GetRowCount(), 4);
+  EXPECT_EQ(table.GetLoadBias(), 0x1000);
+}
+
+TEST(CfiTable, RememberAndRestoreState) {
+  EhFrameBuilder builder;
+  const uint64_t cie_offset = builder.AddCie(kDefaultInitialInstructions);
+  // DW_CFA_def_cfa_offset 16, DW_CFA_remember_state, DW_CFA_def_cfa_offset 8,
+  // DW_CFA_restore_state.
+  builder.AddFde(cie_offset, 0x1100, 0x10, {0x41, 0x0e, 0x10, 0x0a, 0x41, 0x0e, 0x08, 0x41, 0x0b});
+
+  std::vector<uint8_t> eh_frame = builder.Build();
+  ErrorMessageOr<CfiTable> table_or_error =
+      CfiTable::CreateFromEhFrame(kEhFrameAddress, eh_frame, 0);
+  ASSERT_THAT(table_or_error, HasNoError());
+  const CfiTable& table = table_or_error.value();
+
+  using Type = CfiRow::Type;
+  EXPECT_THAT(table.FindRow(0x1101), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 16, -8)));
+  EXPECT_THAT(table.FindRow(0x1102), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8)));
+  EXPECT_THAT(table.FindRow(0x1103), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 16, -8)));
+  EXPECT_THAT(table.FindRow(0x110f), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 16, -8)));
+}
+
+TEST(CfiTable, UnsupportedRules) {
+  EhFrameBuilder builder;
+  const uint64_t cie_offset = builder.AddCie(kDefaultInitialInstructions);
+  // DW_CFA_def_cfa_expression with a one-byte expression after 1 byte.
+  builder.AddFde(cie_offset, 0x1100, 0x10, {0x41, 0x0f, 0x01, 0x00});
+  // DW_CFA_def_cfa_register rbx.
+  builder.AddFde(cie_offset, 0x1110, 0x10, {0x0d, 0x03});
+  // An unknown instruction makes the whole FDE unsupported.
+  builder.AddFde(cie_offset, 0x1120, 0x10, {0x41, 0x0e, 0x10, 0x3f});
+
+  std::vector<uint8_t> eh_frame = builder.Build();
+  ErrorMessageOr<CfiTable> table_or_error =
+      CfiTable::CreateFromEhFrame(kEhFrameAddress, eh_frame, 0);
+  ASSERT_THAT(table_or_error, HasNoError());
+  const CfiTable& table = table_or_error.value();
+
+  using Type = CfiRow::Type;
+  EXPECT_THAT(table.FindRow(0x1100), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8)));
+  EXPECT_THAT(table.FindRow(0x1101), RowEq(MakeRow(Type::kUnsupported)));
+  EXPECT_THAT(table.FindRow(0x1110), RowEq(MakeRow(Type::kUnsupported)));
+  EXPECT_THAT(table.FindRow(0x1120), RowEq(MakeRow(Type::kUnsupported)));
+  EXPECT_THAT(table.FindRow(0x112f), RowEq(MakeRow(Type::kUnsupported)));
+}
+
+TEST(CfiTable, UndefinedReturnAddressMarksOutermostFrame) {
+  EhFrameBuilder builder;
+  // DW_CFA_def_cfa: rsp+8, DW_CFA_undefined: r16.
+  const uint64_t cie_offset = builder.AddCie({0x0c, 0x07, 0x08, 0x07, 0x10});
+  builder.AddFde(cie_offset, 0x1100, 0x10, {});
+
+  std::vector<uint8_t> eh_frame = builder.Build();
+  ErrorMessageOr<CfiTable> table_or_error =
+      CfiTable::CreateFromEhFrame(kEhFrameAddress, eh_frame, 0);
+  ASSERT_THAT(table_or_error, HasNoError());
+  EXPECT_THAT(table_or_error.value().FindRow(0x1108),
+              RowEq(MakeRow(CfiRow::Type::kOutermostFrame)));
+}
+
+TEST(CfiTable, TruncatedEhFrame) {
+  EhFrameBuilder builder;
+  const uint64_t cie_offset = builder.AddCie(kDefaultInitialInstructions);
+  builder.AddFde(cie_offset, 0x1100, 0x10, {});
+
+  std::vector<uint8_t> eh_frame = builder.Build();
+  eh_frame.resize(eh_frame.size() - 8);
+  EXPECT_THAT(CfiTable::CreateFromEhFrame(kEhFrameAddress, eh_frame, 0),
+              HasError("Truncated .eh_frame entry"));
+}
+
+TEST(CfiTable, CreateFromElfFile) {
+  const std::filesystem::path file_path =
+      orbit_base::GetExecutableDir() / "testdata" / "hello_world_elf";
+
+  ErrorMessageOr<CfiTable> table_or_error = CfiTable::CreateFromElfFile(file_path);
+  ASSERT_THAT(table_or_error, HasNoError());
+  const CfiTable& table = table_or_error.value();
+
+  using Type = CfiRow::Type;
+  // _start
+  EXPECT_THAT(table.FindRow(0x1050), RowEq(MakeRow(Type::kOutermostFrame)));
+  // main
+  EXPECT_THAT(table.FindRow(0x1135), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8)));
+  EXPECT_THAT(table.FindRow(0x1136), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 16, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x1140), RowEq(MakeRow(Type::kCfaIsRbpPlusOffset, 16, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x1157), RowEq(MakeRow(Type::kCfaIsRspPlusOffset, 8, -8, -16)));
+  EXPECT_THAT(table.FindRow(0x1158), RowEq(MakeRow(Type::kNoInfo)));
+  // The end of the PLT uses a DWARF expression.
+  EXPECT_THAT(table.FindRow(0x1030), RowEq(MakeRow(Type::kUnsupported)));
+}
+
+TEST(CfiTable, CreateFromElfFileWithoutEhFrame) {
+  const std::filesystem::path file_path =
+      orbit_base::GetExecutableDir() / "testdata" / "hello_world_elf.debug";
+
+  EXPECT_THAT(CfiTable::CreateFromElfFile(file_path), HasError(".eh_frame"));
+}
+
+}  // namespace orbit_object_utils
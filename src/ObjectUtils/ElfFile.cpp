@@ -76,6 +76,7 @@ class ElfFileImpl : public ElfFile {
   [[nodiscard]] ErrorMessageOr<LineInfo> GetDeclarationLocationOfFunction(
       uint64_t address) override;
   [[nodiscard]] std::optional<GnuDebugLinkInfo> GetGnuDebugLinkInfo() const override;
+  [[nodiscard]] ErrorMessageOr<EhFrameSection> GetEhFrameSection() const override;
 
  private:
   ErrorMessageOr<void> InitSections();
@@ -93,6 +94,7 @@ class ElfFileImpl : public ElfFile {
   bool has_dynsym_section_;
   bool has_debug_info_section_;
   std::optional<GnuDebugLinkInfo> gnu_debuglink_info_;
+  const typename ElfT::Shdr* eh_frame_section_;
 
   uint64_t load_bias_;
   uint64_t executable_segment_offset_;
@@ -151,6 +153,7 @@ ElfFileImpl<ElfT>::ElfFileImpl(std::filesystem::path file_path,
       has_symtab_section_(false),
       has_dynsym_section_(false),
       has_debug_info_section_(false),
+      eh_frame_section_(nullptr),
       load_bias_{0},
       executable_segment_offset_{0} {}
 
@@ -275,6 +278,11 @@ ErrorMessageOr<void> ElfFileImpl<ElfT>::InitSections() {
       continue;
     }
 
+    if (name.str() == ".eh_frame") {
+      eh_frame_section_ = &section;
+      continue;
+    }
+
     if (name.str() == ".note.gnu.build-id" && section.sh_type == llvm::ELF::SHT_NOTE) {
       llvm::Error error = llvm::Error::success();
       for (const typename ElfT::Note& note : elf_file->notes(section, error)) {
@@ -553,6 +561,28 @@ std::optional<GnuDebugLinkInfo> ElfFileImpl<ElfT>::GetGnuDebugLinkInfo() const {
   return gnu_debuglink_info_;
 }
 
+template <typename ElfT>
+ErrorMessageOr<EhFrameSection> ElfFileImpl<ElfT>::GetEhFrameSection() const {
+  if (eh_frame_section_ == nullptr) {
+    return ErrorMessage("ELF file does not have a .eh_frame section.");
+  }
+  if (eh_frame_section_->sh_type == llvm::ELF::SHT_NOBITS) {
+    return ErrorMessage("The .eh_frame section of the ELF file has no contents.");
+  }
+
+  llvm::Expected<llvm::ArrayRef<uint8_t>> contents_or_error =
+      object_file_->getELFFile()->getSectionContents(eh_frame_section_);
+  if (!contents_or_error) {
+    return ErrorMessage{absl::StrFormat("Unable to read .eh_frame section: %s",
+                                        llvm::toString(contents_or_error.takeError()))};
+  }
+
+  EhFrameSection eh_frame_section;
+  eh_frame_section.address = eh_frame_section_->sh_addr;
+  eh_frame_section.contents.assign(contents_or_error.get().begin(), contents_or_error.get().end());
+  return eh_frame_section;
+}
+
 template <typename ElfT>
 uint64_t ElfFileImpl<ElfT>::GetExecutableSegmentOffset() const {
   return executable_segment_offset_;
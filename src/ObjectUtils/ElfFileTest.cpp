@@ -287,6 +287,30 @@ TEST(ElfFile, HasGnuDebugLink) {
   EXPECT_EQ(hello_world.value()->GetGnuDebugLinkInfo()->path.string(), "hello_world_elf.debug");
 }
 
+TEST(ElfFile, GetEhFrameSection) {
+  const std::filesystem::path file_path =
+      orbit_base::GetExecutableDir() / "testdata" / "hello_world_elf";
+
+  auto hello_world = CreateElfFile(file_path);
+  ASSERT_THAT(hello_world, HasNoError());
+
+  const auto eh_frame_section = hello_world.value()->GetEhFrameSection();
+  ASSERT_THAT(eh_frame_section, HasNoError());
+  EXPECT_EQ(eh_frame_section.value().address, 0x2058);
+  EXPECT_EQ(eh_frame_section.value().contents.size(), 0x108);
+}
+
+TEST(ElfFile, GetEhFrameSectionOfSeparateDebugInfoFile) {
+  const std::filesystem::path file_path =
+      orbit_base::GetExecutableDir() / "testdata" / "hello_world_elf.debug";
+
+  auto hello_world = CreateElfFile(file_path);
+  ASSERT_THAT(hello_world, HasNoError());
+
+  // The .eh_frame section is only present in the stripped file.
+  EXPECT_THAT(hello_world.value()->GetEhFrameSection(), HasError("has no contents"));
+}
+
 TEST(ElfFile, CalculateDebuglinkChecksumValid) {
   const std::filesystem::path file_path =
       orbit_base::GetExecutableDir() / "testdata" / "hello_world_elf_with_gnu_debuglink";
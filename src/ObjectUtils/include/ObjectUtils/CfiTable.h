@@ -0,0 +1,79 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OBJECT_UTILS_CFI_TABLE_H_
+#define OBJECT_UTILS_CFI_TABLE_H_
+
+#include <absl/types/span.h>
+#include <stdint.h>
+
+#include <filesystem>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+
+namespace orbit_object_utils {
+
+// Unwinding rule for a range of addresses, precompiled from the call frame information (CFI) in
+// .eh_frame. Only the rules commonly found in x86-64 code are represented: the canonical frame
+// address (CFA) is $rsp or $rbp plus an offset, the return address is saved at an offset from the
+// CFA, and $rbp is either unchanged or saved at an offset from the CFA.
+struct CfiRow {
+  enum class Type : uint8_t {
+    // There is no CFI for these addresses.
+    kNoInfo,
+    // The CFI for these addresses uses rules that are not represented (e.g., DWARF expressions).
+    kUnsupported,
+    kCfaIsRspPlusOffset,
+    kCfaIsRbpPlusOffset,
+    // The return address is undefined, which marks the outermost frame (e.g., _start or clone).
+    kOutermostFrame,
+  };
+
+  Type type = Type::kNoInfo;
+  int32_t cfa_offset = 0;
+  // The return address is at CFA + ra_offset.
+  int32_t ra_offset = 0;
+  // The caller's $rbp is at CFA + rbp_offset. Zero means that $rbp is unchanged.
+  int32_t rbp_offset = 0;
+
+  friend bool operator==(const CfiRow& lhs, const CfiRow& rhs) {
+    return lhs.type == rhs.type && lhs.cfa_offset == rhs.cfa_offset &&
+           lhs.ra_offset == rhs.ra_offset && lhs.rbp_offset == rhs.rbp_offset;
+  }
+  friend bool operator!=(const CfiRow& lhs, const CfiRow& rhs) { return !(lhs == rhs); }
+};
+
+// Flat, sorted table of the CFI of an x86-64 ELF file, built once by interpreting all the CFA
+// programs in .eh_frame, so that finding the unwinding rule for an address is a binary search over
+// a contiguous array of addresses rather than a search and evaluation of the FDE.
+class CfiTable {
+ public:
+  // `eh_frame_address` is the virtual address of .eh_frame, which is needed to resolve pc-relative
+  // pointers. Addresses in the table are virtual addresses as in the ELF file.
+  [[nodiscard]] static ErrorMessageOr<CfiTable> CreateFromEhFrame(
+      uint64_t eh_frame_address, absl::Span<const uint8_t> eh_frame, uint64_t load_bias);
+  [[nodiscard]] static ErrorMessageOr<CfiTable> CreateFromElfFile(
+      const std::filesystem::path& file_path);
+
+  // Returns the row covering `address`, which is a virtual address as in the ELF file.
+  [[nodiscard]] const CfiRow& FindRow(uint64_t address) const;
+
+  // The load bias of the ELF file, to convert absolute addresses to virtual addresses.
+  [[nodiscard]] uint64_t GetLoadBias() const { return load_bias_; }
+  [[nodiscard]] size_t GetRowCount() const { return rows_.size(); }
+
+ private:
+  CfiTable() = default;
+
+  uint64_t load_bias_ = 0;
+  // rows_[i] covers addresses from row_start_addresses_[i] (included) to row_start_addresses_[i+1]
+  // (excluded). Addresses are kept apart from the rows to make the search cache-friendly.
+  std::vector<uint64_t> row_start_addresses_;
+  std::vector<CfiRow> rows_;
+};
+
+}  // namespace orbit_object_utils
+
+#endif  // OBJECT_UTILS_CFI_TABLE_H_
@@ -31,6 +31,12 @@ struct GnuDebugLinkInfo {
   uint32_t crc32_checksum;
 };
 
+struct EhFrameSection {
+  // Virtual address of the section, needed to resolve the pc-relative pointers it contains.
+  uint64_t address;
+  std::vector<uint8_t> contents;
+};
+
 class ElfFile : public ObjectFile {
  public:
   ElfFile() = default;
@@ -50,6 +56,7 @@ class ElfFile : public ObjectFile {
   [[nodiscard]] virtual ErrorMessageOr<orbit_grpc_protos::LineInfo>
   GetDeclarationLocationOfFunction(uint64_t address) = 0;
   [[nodiscard]] virtual std::optional<GnuDebugLinkInfo> GetGnuDebugLinkInfo() const = 0;
+  [[nodiscard]] virtual ErrorMessageOr<EhFrameSection> GetEhFrameSection() const = 0;
 
   [[nodiscard]] static ErrorMessageOr<uint32_t> CalculateDebuglinkChecksum(
       const std::filesystem::path& file_path);
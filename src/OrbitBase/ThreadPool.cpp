@@ -9,20 +9,30 @@
 #include <absl/time/time.h>
 
 #include <algorithm>
-#include <list>
+#include <atomic>
 #include <thread>
 #include <utility>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
+#include "WorkStealingQueue.h"
+#include "concurrentqueue.h"
 
 namespace {
 
+using orbit_base_internal::WorkStealingQueue;
+
+// Each worker thread owns a WorkStealingQueue, to which it pushes the actions it schedules itself
+// (e.g. continuations of futures), and from which it pops them in LIFO order. Actions scheduled
+// from other threads go to a lock-free multi-producer queue. Idle workers take actions from their
+// own queue first, then from the shared queue, then steal from the queues of the other workers.
+// The mutex is only needed to create and retire worker threads and to put idle workers to sleep.
 class ThreadPoolImpl : public ThreadPool {
  public:
   explicit ThreadPoolImpl(size_t thread_pool_min_size, size_t thread_pool_max_size,
                           absl::Duration thread_ttl,
                           std::function<void(const std::unique_ptr<Action>&)> run_action);
+  ~ThreadPoolImpl() override;
 
   size_t GetPoolSize() override;
   size_t GetNumberOfBusyThreads() override;
@@ -32,64 +42,124 @@ class ThreadPoolImpl : public ThreadPool {
  private:
   void ScheduleImpl(std::unique_ptr<Action> action) override;
   bool ActionsAvailableOrShutdownInitiated();
-  // Blocking call - returns nullptr if the worker thread needs to exit.
-  std::unique_ptr<Action> TakeAction();
-  void CleanupFinishedThreads();
-  void CreateWorker();
-  void WorkerFunction();
+  // Returns nullptr if no action could be found.
+  Action* TryTakeAction(size_t worker_index);
+  void ExecuteAction(Action* action);
+  void CleanupFinishedThreads() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void CreateWorker() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void WorkerFunction(size_t worker_index);
 
   absl::Mutex mutex_;
-  std::list<std::unique_ptr<Action>> scheduled_actions_;
-  absl::flat_hash_map<std::thread::id, std::thread> worker_threads_;
-  std::vector<std::thread> finished_threads_;
+  absl::flat_hash_map<std::thread::id, std::thread> worker_threads_ ABSL_GUARDED_BY(mutex_);
+  std::vector<std::thread> finished_threads_ ABSL_GUARDED_BY(mutex_);
+  // Indices in worker_queues_ not used by any worker thread.
+  std::vector<size_t> free_worker_indices_ ABSL_GUARDED_BY(mutex_);
+  // Only modified while holding mutex_, so that sleeping workers are woken up.
+  std::atomic<bool> shutdown_initiated_;
   size_t thread_pool_min_size_;
   size_t thread_pool_max_size_;
   absl::Duration thread_ttl_;
-  size_t idle_threads_;
-  bool shutdown_initiated_;
   std::function<void(const std::unique_ptr<Action>&)> run_action_ = nullptr;
+
+  // One queue per possible worker thread, so that queues never need to be added or removed.
+  std::vector<std::unique_ptr<WorkStealingQueue<Action>>> worker_queues_;
+  moodycamel::ConcurrentQueue<Action*> shared_queue_;
+
+  // Number of actions scheduled but not yet taken by a worker. This can temporarily be negative, as
+  // it is only incremented after the action has been enqueued.
+  std::atomic<int64_t> pending_actions_ = 0;
+  std::atomic<size_t> worker_count_ = 0;
+  std::atomic<size_t> busy_worker_count_ = 0;
+  std::atomic<size_t> sleeping_worker_count_ = 0;
+};
+
+// Identifies the ThreadPool and the queue of the worker running on the current thread, if any.
+struct CurrentWorker {
+  const ThreadPoolImpl* thread_pool = nullptr;
+  WorkStealingQueue<Action>* queue = nullptr;
 };
+thread_local CurrentWorker current_worker;
 
 ThreadPoolImpl::ThreadPoolImpl(size_t thread_pool_min_size, size_t thread_pool_max_size,
                                absl::Duration thread_ttl,
                                std::function<void(const std::unique_ptr<Action>&)> run_action)
-    : thread_pool_min_size_(thread_pool_min_size),
+    : shutdown_initiated_(false),
+      thread_pool_min_size_(thread_pool_min_size),
       thread_pool_max_size_(thread_pool_max_size),
       thread_ttl_(thread_ttl),
-      idle_threads_(0),
-      shutdown_initiated_(false),
       run_action_(std::move(run_action)) {
   CHECK(thread_pool_min_size > 0);
   CHECK(thread_pool_max_size >= thread_pool_min_size);
   // Ttl should not be too small
   CHECK(thread_ttl / absl::Nanoseconds(1) >= 1000);
 
+  worker_queues_.reserve(thread_pool_max_size);
+  for (size_t i = 0; i < thread_pool_max_size; ++i) {
+    worker_queues_.push_back(std::make_unique<WorkStealingQueue<Action>>());
+  }
+
   absl::MutexLock lock(&mutex_);
+  // Hand out the lowest indices first, so that stealing workers find the busy queues early.
+  for (size_t i = thread_pool_max_size; i > 0; --i) {
+    free_worker_indices_.push_back(i - 1);
+  }
   for (size_t i = 0; i < thread_pool_min_size; ++i) {
     CreateWorker();
   }
 }
 
+ThreadPoolImpl::~ThreadPoolImpl() {
+  // Only reached after Wait, unless the pool is destroyed without being shut down, in which case
+  // the std::thread destructors terminate the program anyway.
+  Action* action = nullptr;
+  while (shared_queue_.try_dequeue(action)) {
+    delete action;
+  }
+}
+
 void ThreadPoolImpl::CreateWorker() {
   CHECK(!shutdown_initiated_);
-  idle_threads_++;
-  std::thread thread([this] { WorkerFunction(); });
+  CHECK(!free_worker_indices_.empty());
+  size_t worker_index = free_worker_indices_.back();
+  free_worker_indices_.pop_back();
+  std::thread thread([this, worker_index] { WorkerFunction(worker_index); });
   std::thread::id thread_id = thread.get_id();
   CHECK(!worker_threads_.contains(thread_id));
   worker_threads_.insert_or_assign(thread_id, std::move(thread));
+  worker_count_ = worker_threads_.size();
 }
 
 void ThreadPoolImpl::ScheduleImpl(std::unique_ptr<Action> action) {
+  CHECK(!shutdown_initiated_);
   std::unique_ptr<Action> wrapped_action =
       run_action_
           ? CreateAction([this, action = std::move(action)]() mutable { run_action_(action); })
           : std::move(action);
 
-  absl::MutexLock lock(&mutex_);
-  CHECK(!shutdown_initiated_);
+  if (current_worker.thread_pool == this) {
+    current_worker.queue->Push(wrapped_action.release());
+  } else {
+    shared_queue_.enqueue(wrapped_action.release());
+  }
+  const int64_t pending_actions = ++pending_actions_;
+
+  // Fast path: enough workers are awake to take care of all the pending actions.
+  const size_t worker_count = worker_count_;
+  const size_t idle_worker_count = worker_count - std::min(worker_count, busy_worker_count_.load());
+  const bool needs_worker = static_cast<int64_t>(idle_worker_count) < pending_actions &&
+                            worker_count < thread_pool_max_size_;
+  if (!needs_worker && sleeping_worker_count_ == 0) {
+    // A worker that goes to sleep after the load of sleeping_worker_count_ is guaranteed to see
+    // the increment of pending_actions_ before blocking.
+    return;
+  }
 
-  scheduled_actions_.push_back(std::move(wrapped_action));
-  if (idle_threads_ < scheduled_actions_.size() && worker_threads_.size() < thread_pool_max_size_) {
+  // Locking and unlocking the mutex wakes up sleeping workers.
+  absl::MutexLock lock(&mutex_);
+  if (needs_worker &&
+      worker_threads_.size() - std::min(worker_threads_.size(), busy_worker_count_.load()) <
+          static_cast<size_t>(std::max<int64_t>(pending_actions_, 0)) &&
+      worker_threads_.size() < thread_pool_max_size_) {
     CreateWorker();
   }
 
@@ -109,10 +179,7 @@ size_t ThreadPoolImpl::GetPoolSize() {
   return worker_threads_.size();
 }
 
-size_t ThreadPoolImpl::GetNumberOfBusyThreads() {
-  absl::MutexLock lock(&mutex_);
-  return worker_threads_.size() - idle_threads_;
-}
+size_t ThreadPoolImpl::GetNumberOfBusyThreads() { return busy_worker_count_; }
 
 void ThreadPoolImpl::Shutdown() {
   absl::MutexLock lock(&mutex_);
@@ -131,58 +198,73 @@ void ThreadPoolImpl::Wait() {
 }
 
 bool ThreadPoolImpl::ActionsAvailableOrShutdownInitiated() {
-  return !scheduled_actions_.empty() || shutdown_initiated_;
+  return pending_actions_ > 0 || shutdown_initiated_;
 }
 
-std::unique_ptr<Action> ThreadPoolImpl::TakeAction() {
-  while (true) {
-    if (mutex_.AwaitWithTimeout(
-            absl::Condition(
-                +[](ThreadPoolImpl* self) { return self->ActionsAvailableOrShutdownInitiated(); },
-                this),
-            thread_ttl_)) {
-      break;
-    }
+Action* ThreadPoolImpl::TryTakeAction(size_t worker_index) {
+  Action* action = worker_queues_[worker_index]->Pop();
+  if (action != nullptr) return action;
 
-    // Timed out - check if we need to reduce thread pool.
-    if (worker_threads_.size() > thread_pool_min_size_) {
-      return nullptr;
-    }
-  }
+  if (shared_queue_.try_dequeue(action)) return action;
 
-  if (scheduled_actions_.empty()) {
-    return nullptr;
+  // Start with the queue after our own, so that not all thieves compete for the same victim.
+  for (size_t i = 1; i < worker_queues_.size(); ++i) {
+    WorkStealingQueue<Action>& victim =
+        *worker_queues_[(worker_index + i) % worker_queues_.size()];
+    if (victim.IsEmpty()) continue;
+    action = victim.Steal();
+    if (action != nullptr) return action;
   }
+  return nullptr;
+}
 
-  std::unique_ptr<Action> action = std::move(scheduled_actions_.front());
-  scheduled_actions_.pop_front();
-
-  return action;
+void ThreadPoolImpl::ExecuteAction(Action* action) {
+  ++busy_worker_count_;
+  --pending_actions_;
+  std::unique_ptr<Action>{action}->Execute();
+  --busy_worker_count_;
 }
 
-void ThreadPoolImpl::WorkerFunction() {
+void ThreadPoolImpl::WorkerFunction(size_t worker_index) {
+  current_worker = CurrentWorker{this, worker_queues_[worker_index].get()};
+
   while (true) {
-    absl::MutexLock lock(&mutex_);
-    std::unique_ptr<Action> action = TakeAction();
-
-    CHECK(idle_threads_ > 0);  // Sanity check
-    --idle_threads_;
-
-    if (!action) {
-      // Move this thread from the worker_threads_ to finished_threads_.
-      std::thread::id thread_id = std::this_thread::get_id();
-      auto it = worker_threads_.find(thread_id);
-      CHECK(it != worker_threads_.end());
-      finished_threads_.push_back(std::move(it->second));
-      worker_threads_.erase(it);
-      break;
+    Action* action = TryTakeAction(worker_index);
+    if (action != nullptr) {
+      ExecuteAction(action);
+      continue;
     }
 
-    mutex_.Unlock();
-    action->Execute();
-    mutex_.Lock();
-    ++idle_threads_;
+    absl::MutexLock lock(&mutex_);
+    ++sleeping_worker_count_;
+    bool actions_available_or_shutdown = mutex_.AwaitWithTimeout(
+        absl::Condition(
+            +[](ThreadPoolImpl* self) { return self->ActionsAvailableOrShutdownInitiated(); },
+            this),
+        thread_ttl_);
+    --sleeping_worker_count_;
+
+    // pending_actions_ can be positive while the action is not visible yet: try again.
+    if (pending_actions_ > 0) continue;
+
+    // Timed out - check if we need to reduce thread pool.
+    bool reduce_thread_pool =
+        !actions_available_or_shutdown && worker_threads_.size() > thread_pool_min_size_;
+    if (!shutdown_initiated_ && !reduce_thread_pool) continue;
+
+    // Our own queue is empty, as only this thread pushes to it: hand it over to future workers and
+    // move this thread from the worker_threads_ to finished_threads_.
+    free_worker_indices_.push_back(worker_index);
+    std::thread::id thread_id = std::this_thread::get_id();
+    auto it = worker_threads_.find(thread_id);
+    CHECK(it != worker_threads_.end());
+    finished_threads_.push_back(std::move(it->second));
+    worker_threads_.erase(it);
+    worker_count_ = worker_threads_.size();
+    break;
   }
+
+  current_worker = CurrentWorker{};
 }
 
 }  // namespace
@@ -6,8 +6,11 @@
 #include <gtest/gtest.h>
 #include <stddef.h>
 
+#include <atomic>
 #include <chrono>
+#include <functional>
 #include <memory>
+#include <thread>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadPool.h"
@@ -538,3 +541,75 @@ TEST(ThreadPool, WithRunActionParameter) {
   EXPECT_EQ(run_before_action_count, 1);
   EXPECT_EQ(run_after_action_count, 1);
 }
+
+TEST(ThreadPool, ActionsScheduledFromWorkerThreadsAreExecuted) {
+  constexpr size_t kThreadPoolMinSize = 2;
+  constexpr size_t kThreadPoolMaxSize = 4;
+  constexpr absl::Duration kThreadTtl = absl::Milliseconds(5);
+  std::shared_ptr<ThreadPool> thread_pool =
+      ThreadPool::Create(kThreadPoolMinSize, kThreadPoolMaxSize, kThreadTtl);
+
+  // Each action schedules two more, down to kDepth: these end up in the queues of the workers and
+  // are partly stolen by the others.
+  constexpr int kDepth = 12;
+  std::atomic<size_t> executed_count = 0;
+  std::function<void(int)> fan_out = [&](int depth) {
+    ++executed_count;
+    if (depth == kDepth) return;
+    thread_pool->Schedule([&fan_out, depth] { fan_out(depth + 1); });
+    thread_pool->Schedule([&fan_out, depth] { fan_out(depth + 1); });
+  };
+  thread_pool->Schedule([&fan_out] { fan_out(0); });
+
+  constexpr size_t kExpectedCount = (1 << (kDepth + 1)) - 1;
+  for (int elapsed_ms = 0; executed_count < kExpectedCount && elapsed_ms < 5000; ++elapsed_ms) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(executed_count, kExpectedCount);
+
+  thread_pool->ShutdownAndWait();
+}
+
+// How many actions that do almost no work the pool runs per second, whether they are scheduled
+// from outside the pool or by the actions themselves. This only prints numbers, hence disabled.
+TEST(ThreadPool, DISABLED_SmallActionsThroughputBenchmark) {
+  constexpr size_t kActionCount = 200'000;
+  for (size_t pool_size : {1, 2, 4, 8}) {
+    std::shared_ptr<ThreadPool> thread_pool =
+        ThreadPool::Create(pool_size, pool_size, absl::Milliseconds(100));
+
+    std::atomic<size_t> executed_count = 0;
+    absl::Time start = absl::Now();
+    for (size_t i = 0; i < kActionCount; ++i) {
+      thread_pool->Schedule([&executed_count] { ++executed_count; });
+    }
+    while (executed_count < kActionCount) {
+      std::this_thread::yield();
+    }
+    absl::Duration external_duration = absl::Now() - start;
+
+    executed_count = 0;
+    std::function<void(size_t)> schedule_next = [&](size_t remaining) {
+      ++executed_count;
+      if (remaining > 1) {
+        thread_pool->Schedule([&schedule_next, remaining] { schedule_next(remaining - 1); });
+      }
+    };
+    start = absl::Now();
+    // Chains of actions that each schedule the next one, one chain per worker.
+    for (size_t i = 0; i < pool_size; ++i) {
+      thread_pool->Schedule(
+          [&schedule_next, pool_size] { schedule_next(kActionCount / pool_size); });
+    }
+    while (executed_count < kActionCount / pool_size * pool_size) {
+      std::this_thread::yield();
+    }
+    absl::Duration internal_duration = absl::Now() - start;
+
+    thread_pool->ShutdownAndWait();
+    LOG("%u threads: %.0f ns per action scheduled from outside, %.0f ns per action scheduled from "
+        "a worker",
+        pool_size, absl::ToDoubleNanoseconds(external_duration) / kActionCount,
+        absl::ToDoubleNanoseconds(internal_duration) / kActionCount);
+  }
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_WORK_STEALING_QUEUE_H_
+#define ORBIT_BASE_WORK_STEALING_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_base_internal {
+
+// Lock-free work-stealing deque of pointers (Chase and Lev, "Dynamic Circular Work-Stealing Deque",
+// with the memory orderings from Le et al., "Correct and Efficient Work-Stealing for Weak Memory
+// Models").
+// Only the owner thread is allowed to call Push and Pop, which work on the bottom of the deque.
+// Any thread can call Steal, which takes from the top. Ownership can be transferred to another
+// thread, as long as the transfer synchronizes with the previous owner.
+// The deque doesn't own the pointed-to objects.
+template <typename T>
+class WorkStealingQueue {
+ public:
+  explicit WorkStealingQueue(size_t initial_capacity = 64) {
+    CHECK(initial_capacity > 0 && (initial_capacity & (initial_capacity - 1)) == 0);
+    arrays_.push_back(std::make_unique<Array>(initial_capacity));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingQueue(const WorkStealingQueue&) = delete;
+  WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+  WorkStealingQueue(WorkStealingQueue&&) = delete;
+  WorkStealingQueue& operator=(WorkStealingQueue&&) = delete;
+
+  void Push(T* element) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Array* array = array_.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64_t>(array->mask)) {
+      array = Grow(array, top, bottom);
+    }
+    array->Put(bottom, element);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  // Returns nullptr if the deque is empty.
+  [[nodiscard]] T* Pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* array = array_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T* element = array->Get(bottom);
+    if (top == bottom) {
+      // Last element: race against concurrent Steals.
+      if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        element = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return element;
+  }
+
+  // Returns nullptr if the deque is empty or if another thread took the top element first.
+  [[nodiscard]] T* Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) return nullptr;
+
+    Array* array = array_.load(std::memory_order_acquire);
+    T* element = array->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return element;
+  }
+
+  // Only a hint when called concurrently with other methods.
+  [[nodiscard]] bool IsEmpty() const {
+    return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Array {
+    explicit Array(size_t capacity)
+        : mask{capacity - 1}, elements{std::make_unique<std::atomic<T*>[]>(capacity)} {}
+    [[nodiscard]] T* Get(int64_t index) const {
+      return elements[index & mask].load(std::memory_order_relaxed);
+    }
+    void Put(int64_t index, T* element) {
+      elements[index & mask].store(element, std::memory_order_relaxed);
+    }
+    const size_t mask;
+    std::unique_ptr<std::atomic<T*>[]> elements;
+  };
+
+  Array* Grow(Array* array, int64_t top, int64_t bottom) {
+    auto new_array = std::make_unique<Array>(2 * (array->mask + 1));
+    for (int64_t i = top; i < bottom; ++i) {
+      new_array->Put(i, array->Get(i));
+    }
+    // Stealers might still be reading from the old array, so it is only freed with the deque.
+    arrays_.push_back(std::move(new_array));
+    array_.store(arrays_.back().get(), std::memory_order_release);
+    return arrays_.back().get();
+  }
+
+  std::atomic<int64_t> top_ = 0;
+  std::atomic<int64_t> bottom_ = 0;
+  std::atomic<Array*> array_ = nullptr;
+  // Only accessed by the owner.
+  std::vector<std::unique_ptr<Array>> arrays_;
+};
+
+}  // namespace orbit_base_internal
+
+#endif  // ORBIT_BASE_WORK_STEALING_QUEUE_H_
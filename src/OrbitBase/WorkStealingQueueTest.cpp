@@ -0,0 +1,80 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "WorkStealingQueue.h"
+
+namespace orbit_base_internal {
+
+TEST(WorkStealingQueue, PopIsLifoAndStealIsFifo) {
+  WorkStealingQueue<int> queue{2};
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_EQ(queue.Pop(), nullptr);
+  EXPECT_EQ(queue.Steal(), nullptr);
+
+  // Pushing more elements than the initial capacity makes the queue grow.
+  std::vector<int> values{0, 1, 2, 3, 4};
+  for (int& value : values) {
+    queue.Push(&value);
+  }
+  EXPECT_FALSE(queue.IsEmpty());
+
+  EXPECT_EQ(queue.Pop(), &values[4]);
+  EXPECT_EQ(queue.Steal(), &values[0]);
+  EXPECT_EQ(queue.Pop(), &values[3]);
+  EXPECT_EQ(queue.Steal(), &values[1]);
+  EXPECT_EQ(queue.Pop(), &values[2]);
+  EXPECT_EQ(queue.Pop(), nullptr);
+  EXPECT_EQ(queue.Steal(), nullptr);
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(WorkStealingQueue, EachElementIsTakenExactlyOnce) {
+  constexpr size_t kElementCount = 200'000;
+  constexpr size_t kThiefCount = 3;
+  std::vector<int> values(kElementCount);
+  std::vector<std::atomic<int>> take_counts(kElementCount);
+  WorkStealingQueue<int> queue{4};
+  std::atomic<bool> owner_done = false;
+
+  auto take = [&values, &take_counts](int* element) { ++take_counts[element - values.data()]; };
+
+  std::vector<std::thread> thieves;
+  for (size_t i = 0; i < kThiefCount; ++i) {
+    thieves.emplace_back([&queue, &owner_done, &take] {
+      while (!owner_done || !queue.IsEmpty()) {
+        int* element = queue.Steal();
+        if (element != nullptr) take(element);
+      }
+    });
+  }
+
+  for (size_t i = 0; i < kElementCount; ++i) {
+    queue.Push(&values[i]);
+    // Also pop some of the elements, so that Pop races with Steal.
+    if (i % 3 == 0) {
+      int* element = queue.Pop();
+      if (element != nullptr) take(element);
+    }
+  }
+  owner_done = true;
+  while (int* element = queue.Pop()) {
+    take(element);
+  }
+  for (std::thread& thief : thieves) {
+    thief.join();
+  }
+
+  for (size_t i = 0; i < kElementCount; ++i) {
+    EXPECT_EQ(take_counts[i], 1) << "element " << i;
+  }
+}
+
+}  // namespace orbit_base_internal
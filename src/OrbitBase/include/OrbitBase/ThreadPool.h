@@ -52,7 +52,10 @@ class ThreadPool : public orbit_base::Executor {
   // threads.
   //
   // Whenever an action is Scheduled the thread pool puts it in an internal
-  // queue. Worker threads pick actions from the queue and execute them.
+  // queue: the queue of the worker thread if it is scheduled from one of the
+  // worker threads, a queue shared by all worker threads otherwise. Worker
+  // threads pick actions from their own queue, then from the shared queue, and
+  // steal actions from the queues of other worker threads when both are empty.
   // If at the time of scheduling new action there are no idle worker threads,
   // the thread pool creates a new worker thread if current number of worker
   // threads is less than maximum pool size.
@@ -41,6 +41,13 @@
 
 ABSL_DECLARE_FLAG(bool, thread_state);
 ABSL_DECLARE_FLAG(uint64_t, max_local_marker_depth_per_command_buffer);
+ABSL_DECLARE_FLAG(uint32_t, ring_buffer_reader_threads);
+ABSL_DECLARE_FLAG(bool, event_driven_ring_buffer_polling);
+ABSL_DECLARE_FLAG(bool, compress_capture_events);
+ABSL_DECLARE_FLAG(bool, unwind_with_precompiled_cfi);
+ABSL_DECLARE_FLAG(bool, intern_orbit_api_names);
+ABSL_DECLARE_FLAG(bool, use_shared_memory_producer_transport);
+ABSL_DECLARE_FLAG(bool, use_unwinding_cache);
 
 using orbit_base::Future;
 
@@ -116,6 +123,14 @@ ErrorMessageOr<void> ClientGgp::RequestStartCapture(ThreadPool* thread_pool) {
   bool enable_user_space_instrumentation = false;
   uint64_t max_local_marker_depth_per_command_buffer =
       absl::GetFlag(FLAGS_max_local_marker_depth_per_command_buffer);
+  uint32_t ring_buffer_reader_thread_count = absl::GetFlag(FLAGS_ring_buffer_reader_threads);
+  bool event_driven_ring_buffer_polling = absl::GetFlag(FLAGS_event_driven_ring_buffer_polling);
+  bool compress_capture_events = absl::GetFlag(FLAGS_compress_capture_events);
+  bool unwind_with_precompiled_cfi = absl::GetFlag(FLAGS_unwind_with_precompiled_cfi);
+  bool intern_orbit_api_names = absl::GetFlag(FLAGS_intern_orbit_api_names);
+  bool use_shared_memory_producer_transport =
+      absl::GetFlag(FLAGS_use_shared_memory_producer_transport);
+  bool use_unwinding_cache = absl::GetFlag(FLAGS_use_unwinding_cache);
 
   std::filesystem::path file_path = GenerateFilePath();
 
@@ -131,7 +146,10 @@ ErrorMessageOr<void> ClientGgp::RequestStartCapture(ThreadPool* thread_pool) {
       selected_tracepoints, options_.samples_per_second, options_.stack_dump_size, unwinding_method,
       collect_scheduling_info, collect_thread_state, collect_gpu_jobs, enable_api,
       enable_introspection, enable_user_space_instrumentation,
-      max_local_marker_depth_per_command_buffer, false, 0, std::move(event_processor));
+      max_local_marker_depth_per_command_buffer, false, 0, ring_buffer_reader_thread_count,
+      event_driven_ring_buffer_polling, compress_capture_events, unwind_with_precompiled_cfi,
+      intern_orbit_api_names, use_shared_memory_producer_transport, use_unwinding_cache,
+      std::move(event_processor));
 
   orbit_base::ImmediateExecutor executor;
 
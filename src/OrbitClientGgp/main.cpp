@@ -40,6 +40,21 @@ ABSL_FLAG(bool, frame_pointer_unwinding, false, "Use frame pointers for unwindin
 ABSL_FLAG(bool, thread_state, false, "Collect thread states");
 ABSL_FLAG(uint64_t, max_local_marker_depth_per_command_buffer, std::numeric_limits<uint64_t>::max(),
           "Max local marker depth per command buffer");
+ABSL_FLAG(uint32_t, ring_buffer_reader_threads, 1,
+          "Number of threads OrbitService uses to read perf_event_open ring buffers");
+ABSL_FLAG(bool, event_driven_ring_buffer_polling, false,
+          "Wait for perf_event_open ring buffers to have data instead of polling them");
+ABSL_FLAG(bool, compress_capture_events, false,
+          "Ask OrbitService to compress the CaptureEvents it sends");
+ABSL_FLAG(bool, unwind_with_precompiled_cfi, false,
+          "Unwind DWARF stack samples with call frame information precompiled into flat tables");
+ABSL_FLAG(bool, intern_orbit_api_names, false,
+          "Ask the Orbit API to send the name of each scope only once per capture");
+ABSL_FLAG(bool, use_shared_memory_producer_transport, false,
+          "Ask producers to send their events to OrbitService through shared memory");
+ABSL_FLAG(bool, use_unwinding_cache, false,
+          "Unwind DWARF stack samples only up to the frames shared with the previous sample of the "
+          "same thread, reusing the outer frames of that sample (experimental)");
 
 namespace {
 
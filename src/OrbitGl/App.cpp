@@ -92,6 +92,13 @@
 ABSL_DECLARE_FLAG(bool, devmode);
 ABSL_DECLARE_FLAG(bool, local);
 ABSL_DECLARE_FLAG(bool, enable_tracepoint_feature);
+ABSL_DECLARE_FLAG(uint32_t, ring_buffer_reader_threads);
+ABSL_DECLARE_FLAG(bool, event_driven_ring_buffer_polling);
+ABSL_DECLARE_FLAG(bool, compress_capture_events);
+ABSL_DECLARE_FLAG(bool, unwind_with_precompiled_cfi);
+ABSL_DECLARE_FLAG(bool, intern_orbit_api_names);
+ABSL_DECLARE_FLAG(bool, use_shared_memory_producer_transport);
+ABSL_DECLARE_FLAG(bool, use_unwinding_cache);
 
 using orbit_base::Future;
 
@@ -328,6 +335,8 @@ void OrbitApp::OnCaptureStarted(const orbit_grpc_protos::CaptureStarted& capture
 
         frame_track_online_processor_ =
             orbit_gl::FrameTrackOnlineProcessor(GetCaptureData(), GetMutableTimeGraph());
+        sampling_data_post_processor_ =
+            std::make_unique<orbit_client_model::SamplingDataPostProcessor>();
 
         CHECK(capture_started_callback_ != nullptr);
         capture_started_callback_(file_path);
@@ -355,9 +364,11 @@ Future<void> OrbitApp::OnCaptureComplete() {
   }
 
   GetMutableCaptureData().FilterBrokenCallstacks();
+  CHECK(sampling_data_post_processor_ != nullptr);
   PostProcessedSamplingData post_processed_sampling_data =
-      orbit_client_model::CreatePostProcessedSamplingData(*GetCaptureData().GetCallstackData(),
-                                                          GetCaptureData());
+      sampling_data_post_processor_->CreatePostProcessedSamplingData(
+          *GetCaptureData().GetCallstackData(), GetCaptureData(),
+          core_count_sized_thread_pool_.get());
 
   LOG("The capture contains %u intervals with incomplete data",
       GetCaptureData().incomplete_data_intervals().size());
@@ -431,6 +442,7 @@ void OrbitApp::OnUniqueCallstack(uint64_t callstack_id, CallstackInfo callstack)
 }
 
 void OrbitApp::OnCallstackEvent(CallstackEvent callstack_event) {
+  sampling_data_post_processor_->AddCallstackEvent(callstack_event);
   GetMutableCaptureData().AddCallstackEvent(std::move(callstack_event));
 }
 
@@ -487,12 +499,14 @@ void OrbitApp::UpdateModulesAbortCaptureIfModuleWithoutBuildIdNeedsReload(
 void OrbitApp::OnModuleUpdate(uint64_t /*timestamp_ns*/, ModuleInfo module_info) {
   UpdateModulesAbortCaptureIfModuleWithoutBuildIdNeedsReload({module_info});
   GetMutableCaptureData().mutable_process()->AddOrUpdateModuleInfo(module_info);
+  GetMutableCaptureData().UpdateAddressToFunctionIndex();
   main_thread_executor_->Schedule([this]() { FireRefreshCallbacks(DataViewType::kLiveFunctions); });
 }
 
 void OrbitApp::OnModulesSnapshot(uint64_t /*timestamp_ns*/, std::vector<ModuleInfo> module_infos) {
   UpdateModulesAbortCaptureIfModuleWithoutBuildIdNeedsReload(module_infos);
   GetMutableCaptureData().mutable_process()->UpdateModuleInfos(module_infos);
+  GetMutableCaptureData().UpdateAddressToFunctionIndex();
   main_thread_executor_->Schedule([this]() { FireRefreshCallbacks(DataViewType::kLiveFunctions); });
 }
 
@@ -1124,7 +1138,7 @@ orbit_data_views::PresetLoadState OrbitApp::GetPresetLoadState(const PresetFile&
 }
 
 static ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCaptureFromNewFormat(
-    CaptureListener* listener, CaptureFile* capture_file,
+    CaptureListener* listener, CaptureFile* capture_file, ThreadPool* thread_pool,
     std::atomic<bool>* capture_loading_cancellation_requested) {
   SCOPED_TIMED_LOG("Loading capture in new format from \"%s\"",
                    capture_file->GetFilePath().string());
@@ -1146,18 +1160,20 @@ static ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCaptureFromNewFormat(
       CaptureEventProcessor::CreateForCaptureListener(listener, capture_file->GetFilePath(),
                                                       frame_track_function_ids);
 
-  auto capture_section_input_stream = capture_file->CreateCaptureSectionInputStream();
-  while (true) {
-    if (*capture_loading_cancellation_requested) {
-      return CaptureListener::CaptureOutcome::kCancelled;
-    }
-    ClientCaptureEvent event;
-    OUTCOME_TRY(capture_section_input_stream->ReadMessage(&event));
-    capture_event_processor->ProcessEvent(event);
-    if (event.event_case() == ClientCaptureEvent::kCaptureFinished) {
-      return CaptureListener::CaptureOutcome::kComplete;
-    }
+  // Protobuf decoding happens on `thread_pool`, the events are still processed in order here.
+  OUTCOME_TRY(orbit_capture_file::ReadCaptureSection(
+      capture_file, thread_pool,
+      [&capture_event_processor,
+       capture_loading_cancellation_requested](const ClientCaptureEvent& event) {
+        if (*capture_loading_cancellation_requested) return false;
+        capture_event_processor->ProcessEvent(event);
+        return true;
+      }));
+
+  if (*capture_loading_cancellation_requested) {
+    return CaptureListener::CaptureOutcome::kCancelled;
   }
+  return CaptureListener::CaptureOutcome::kComplete;
 }
 
 Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> OrbitApp::LoadCaptureFromFile(
@@ -1184,6 +1200,7 @@ Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> OrbitApp::LoadCaptureFro
                             : orbit_metrics_uploader::OrbitLogEvent::ORBIT_CAPTURE_LOAD};
     if (capture_file_or_error.has_value()) {
       load_result = LoadCaptureFromNewFormat(this, capture_file_or_error.value().get(),
+                                             core_count_sized_thread_pool_.get(),
                                              &capture_loading_cancellation_requested_);
     } else {  // Fall back to old capture format.
       load_result = orbit_client_model::capture_deserializer::Load(
@@ -1372,6 +1389,13 @@ void OrbitApp::StartCapture() {
       collect_scheduling_info, collect_thread_states, collect_gpu_jobs, enable_api,
       enable_introspection, enable_user_space_instrumentation,
       max_local_marker_depth_per_command_buffer, collect_memory_info, memory_sampling_period_ms,
+      absl::GetFlag(FLAGS_ring_buffer_reader_threads),
+      absl::GetFlag(FLAGS_event_driven_ring_buffer_polling),
+      absl::GetFlag(FLAGS_compress_capture_events),
+      absl::GetFlag(FLAGS_unwind_with_precompiled_cfi),
+      absl::GetFlag(FLAGS_intern_orbit_api_names),
+      absl::GetFlag(FLAGS_use_shared_memory_producer_transport),
+      absl::GetFlag(FLAGS_use_unwinding_cache),
       std::move(capture_event_processor));
 
   // TODO(b/187250643): Refactor this to be more readable and maybe remove parts that are not needed
@@ -1440,6 +1464,7 @@ void OrbitApp::ClearCapture() {
     capture_window_->ClearTimeGraph();
   }
   capture_data_.reset();
+  sampling_data_post_processor_.reset();
 
   string_manager_.Clear();
 
@@ -2071,6 +2096,13 @@ orbit_base::Future<std::vector<ErrorMessageOr<void>>> OrbitApp::ReloadModules(
 
   // Update modules and get the ones to reload.
   std::vector<ModuleData*> modules_to_reload = module_manager_->AddOrUpdateModules(module_infos);
+  // Modules that changed lost their symbols: stop resolving addresses to their functions.
+  if (HasCaptureData()) {
+    GetMutableCaptureData().UpdateAddressToFunctionIndex();
+  }
+  if (sampling_data_post_processor_ != nullptr) {
+    sampling_data_post_processor_->InvalidateResolvedCallstacks();
+  }
 
   absl::flat_hash_map<std::string, std::vector<uint64_t>> function_hashes_to_hook_map;
   for (const FunctionInfo& func : data_manager_->GetSelectedFunctions()) {
@@ -2212,23 +2244,8 @@ void OrbitApp::SetVisibleFunctionIds(absl::flat_hash_set<uint64_t> visible_funct
   RequestUpdatePrimitives();
 }
 
-bool OrbitApp::IsFunctionVisible(uint64_t function_address) {
-  if (data_manager_->IsFunctionVisible(function_address)) {
-    return true;
-  }
-
-  // TODO(b/179225487): Filtering for manually instrumented scopes is not yet supported.
-  // All "Orbit" functions are considered visible. Note: this code will change shortly as
-  // we will introduce a TimerInfo type for Orbit API events which will allow faster filtering.
-  const auto& instrumented_functions = GetCaptureData().instrumented_functions();
-  auto it = instrumented_functions.find(function_address);
-  if (it != instrumented_functions.end()) {
-    if (orbit_client_data::function_utils::IsOrbitFunctionFromName(it->second.function_name())) {
-      return true;
-    }
-  }
-
-  return false;
+const absl::flat_hash_set<uint64_t>& OrbitApp::GetVisibleFunctionIds() const {
+  return data_manager_->visible_function_ids();
 }
 
 uint64_t OrbitApp::highlighted_function_id() const {
@@ -2298,7 +2315,8 @@ void OrbitApp::SelectCallstackEvents(const std::vector<CallstackEvent>& selected
   bool generate_summary = thread_id == orbit_base::kAllProcessThreadsTid;
   PostProcessedSamplingData processed_sampling_data =
       orbit_client_model::CreatePostProcessedSamplingData(
-          *GetCaptureData().GetSelectionCallstackData(), GetCaptureData(), generate_summary);
+          *GetCaptureData().GetSelectionCallstackData(), GetCaptureData(), generate_summary,
+          core_count_sized_thread_pool_.get());
 
   SetSelectionTopDownView(processed_sampling_data, GetCaptureData());
   SetSelectionBottomUpView(processed_sampling_data, GetCaptureData());
@@ -2312,12 +2330,17 @@ void OrbitApp::UpdateAfterSymbolLoading() {
   if (!HasCaptureData()) {
     return;
   }
+  GetMutableCaptureData().UpdateAddressToFunctionIndex();
   const CaptureData& capture_data = GetCaptureData();
+  if (sampling_data_post_processor_ != nullptr) {
+    sampling_data_post_processor_->InvalidateResolvedCallstacks();
+  }
 
   if (sampling_report_ != nullptr) {
+    CHECK(sampling_data_post_processor_ != nullptr);
     PostProcessedSamplingData post_processed_sampling_data =
-        orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetCallstackData(),
-                                                            capture_data);
+        sampling_data_post_processor_->CreatePostProcessedSamplingData(
+            *capture_data.GetCallstackData(), capture_data, core_count_sized_thread_pool_.get());
     sampling_report_->UpdateReport(post_processed_sampling_data,
                                    capture_data.GetCallstackData()->GetUniqueCallstacksCopy());
     GetMutableCaptureData().set_post_processed_sampling_data(post_processed_sampling_data);
@@ -2330,9 +2353,9 @@ void OrbitApp::UpdateAfterSymbolLoading() {
   }
 
   PostProcessedSamplingData selection_post_processed_sampling_data =
-      orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetSelectionCallstackData(),
-                                                          capture_data,
-                                                          selection_report_->has_summary());
+      orbit_client_model::CreatePostProcessedSamplingData(
+          *capture_data.GetSelectionCallstackData(), capture_data, selection_report_->has_summary(),
+          core_count_sized_thread_pool_.get());
 
   SetSelectionTopDownView(selection_post_processed_sampling_data, capture_data);
   SetSelectionBottomUpView(selection_post_processed_sampling_data, capture_data);
@@ -2441,6 +2464,14 @@ bool OrbitApp::IsCapturing() const {
 
 bool OrbitApp::IsLoadingCapture() const { return is_loading_capture_; }
 
+uint64_t OrbitApp::GetCompressedCaptureEventsByteCount() const {
+  return capture_client_ != nullptr ? capture_client_->GetCompressedCaptureEventsByteCount() : 0;
+}
+
+uint64_t OrbitApp::GetUncompressedCaptureEventsByteCount() const {
+  return capture_client_ != nullptr ? capture_client_->GetUncompressedCaptureEventsByteCount() : 0;
+}
+
 ScopedStatus OrbitApp::CreateScopedStatus(const std::string& initial_message) {
   CHECK(std::this_thread::get_id() == main_thread_id_);
   CHECK(status_listener_ != nullptr);
@@ -41,6 +41,7 @@
 #include "ClientData/TracepointCustom.h"
 #include "ClientData/UserDefinedCaptureData.h"
 #include "ClientModel/CaptureData.h"
+#include "ClientModel/SamplingDataPostProcessor.h"
 #include "ClientServices/CrashManager.h"
 #include "ClientServices/ProcessManager.h"
 #include "ClientServices/TracepointServiceClient.h"
@@ -113,6 +114,8 @@ class OrbitApp final : public DataViewFactory,
   [[nodiscard]] orbit_capture_client::CaptureClient::State GetCaptureState() const;
   [[nodiscard]] bool IsCapturing() const;
   [[nodiscard]] bool IsLoadingCapture() const;
+  [[nodiscard]] uint64_t GetCompressedCaptureEventsByteCount() const;
+  [[nodiscard]] uint64_t GetUncompressedCaptureEventsByteCount() const;
 
   void StartCapture();
   void StopCapture();
@@ -420,7 +423,7 @@ class OrbitApp final : public DataViewFactory,
       uint64_t function_id) const;
 
   void SetVisibleFunctionIds(absl::flat_hash_set<uint64_t> visible_functions);
-  [[nodiscard]] bool IsFunctionVisible(uint64_t function_id);
+  [[nodiscard]] const absl::flat_hash_set<uint64_t>& GetVisibleFunctionIds() const;
 
   [[nodiscard]] uint64_t highlighted_function_id() const;
   void set_highlighted_function_id(uint64_t highlighted_function_id);
@@ -594,6 +597,9 @@ class OrbitApp final : public DataViewFactory,
   std::unique_ptr<orbit_client_model::CaptureData> capture_data_;
 
   orbit_gl::FrameTrackOnlineProcessor frame_track_online_processor_;
+  // Fed with the CallstackEvents of the current capture as they arrive, so that the sampling report
+  // doesn't require a pass over all the samples when the capture stops or symbols are loaded.
+  std::unique_ptr<orbit_client_model::SamplingDataPostProcessor> sampling_data_post_processor_;
 
   const orbit_base::CrashHandler* crash_handler_;
   orbit_metrics_uploader::MetricsUploader* metrics_uploader_;
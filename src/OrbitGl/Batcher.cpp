@@ -6,10 +6,13 @@
 
 #include <GteVector.h>
 #include <GteVector2.h>
+#include <absl/base/casts.h>
 #include <glad/glad.h>
 #include <math.h>
 #include <stddef.h>
 
+#include <iterator>
+
 #include "ClientData/TextBox.h"
 #include "DisplayFormats/DisplayFormats.h"
 #include "Introspection/Introspection.h"
@@ -17,7 +20,7 @@
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
                       std::unique_ptr<PickingUserData> user_data) {
-  Color picking_color = PickingId::ToColor(PickingType::kLine, user_data_.size(), batcher_id_);
+  Color picking_color = PickingId::ToColor(PickingType::kLine, GetNextElementId(), batcher_id_);
 
   AddLine(from, to, z, color, picking_color, std::move(user_data));
 }
@@ -55,12 +58,13 @@ void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Col
   buffer.line_buffer.lines_.emplace_back(line);
   buffer.line_buffer.colors_.push_back_n(color, 2);
   buffer.line_buffer.picking_colors_.push_back_n(picking_color, 2);
+  ++buffer.version;
   user_data_.push_back(std::move(user_data));
 }
 
 void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors,
                      std::unique_ptr<PickingUserData> user_data) {
-  Color picking_color = PickingId::ToColor(PickingType::kBox, user_data_.size(), batcher_id_);
+  Color picking_color = PickingId::ToColor(PickingType::kBox, GetNextElementId(), batcher_id_);
   AddBox(box, colors, picking_color, std::move(user_data));
 }
 
@@ -200,12 +204,13 @@ void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors, const C
   buffer.box_buffer.boxes_.emplace_back(rounded_box);
   buffer.box_buffer.colors_.push_back(colors);
   buffer.box_buffer.picking_colors_.push_back_n(picking_color, 4);
+  ++buffer.version;
   user_data_.push_back(std::move(user_data));
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
                           std::unique_ptr<PickingUserData> user_data) {
-  Color picking_color = PickingId::ToColor(PickingType::kTriangle, user_data_.size(), batcher_id_);
+  Color picking_color = PickingId::ToColor(PickingType::kTriangle, GetNextElementId(), batcher_id_);
 
   AddTriangle(triangle, color, picking_color, std::move(user_data));
 }
@@ -233,13 +238,14 @@ void Batcher::AddShadedTrapezium(const Vec3& top_left, const Vec3& bottom_left,
                                  ShadingDirection shading_direction) {
   std::array<Color, 4> colors;  // top_left, bottom_left, bottom_right, top_right.
   GetBoxGradientColors(color, &colors, shading_direction);
-  Color picking_color = PickingId::ToColor(PickingType::kTriangle, user_data_.size(), batcher_id_);
+  // Both triangles have the picking id of the first one, so only the first one needs user data.
+  Color picking_color = PickingId::ToColor(PickingType::kTriangle, GetNextElementId(), batcher_id_);
   Triangle triangle_1{top_left, bottom_left, top_right};
   std::array<Color, 3> colors_1{colors[0], colors[1], colors[2]};
-  AddTriangle(triangle_1, colors_1, picking_color, std::make_unique<PickingUserData>(*user_data));
+  AddTriangle(triangle_1, colors_1, picking_color, std::move(user_data));
   Triangle triangle_2{bottom_left, bottom_right, top_right};
   std::array<Color, 3> colors_2{colors[1], colors[2], colors[3]};
-  AddTriangle(triangle_2, colors_2, picking_color, std::move(user_data));
+  AddTriangle(triangle_2, colors_2, picking_color, nullptr);
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const std::array<Color, 3>& colors,
@@ -254,6 +260,7 @@ void Batcher::AddTriangle(const Triangle& triangle, const std::array<Color, 3>&
   buffer.triangle_buffer.triangles_.emplace_back(rounded_tri);
   buffer.triangle_buffer.colors_.push_back(colors);
   buffer.triangle_buffer.picking_colors_.push_back_n(picking_color, 3);
+  ++buffer.version;
   user_data_.push_back(std::move(user_data));
 }
 
@@ -279,6 +286,7 @@ void Batcher::AddCircle(Vec2 position, float radius, float z, Color color) {
 }
 
 const PickingUserData* Batcher::GetUserData(PickingId id) const {
+  if (primitives_moved_to_ != nullptr) return primitives_moved_to_->GetUserData(id);
   CHECK(id.element_id >= 0);
   CHECK(id.batcher_id == batcher_id_);
 
@@ -288,8 +296,9 @@ const PickingUserData* Batcher::GetUserData(PickingId id) const {
     case PickingType::kBox:
     case PickingType::kTriangle:
     case PickingType::kLine:
-      CHECK(id.element_id < user_data_.size());
-      return user_data_[id.element_id].get();
+      CHECK(id.element_id >= first_element_id_);
+      CHECK(id.element_id - first_element_id_ < user_data_.size());
+      return user_data_[id.element_id - first_element_id_].get();
     case PickingType::kPickable:
       return nullptr;
     case PickingType::kCount:
@@ -357,6 +366,70 @@ void Batcher::ResetElements() {
 void Batcher::StartNewFrame() {
   ResetElements();
   user_data_.clear();
+  first_element_id_ = 0;
+}
+
+template <uint32_t BlockSize>
+static void OffsetPickingColors(uint32_t first_element_id, uint32_t new_first_element_id,
+                                BlockChain<Color, BlockSize>* picking_colors) {
+  picking_colors->ForEach([first_element_id, new_first_element_id](Color& color) {
+    const PickingId id = PickingId::FromPixelValue(absl::bit_cast<uint32_t>(
+        std::array<uint8_t, 4>{color[0], color[1], color[2], color[3]}));
+    // The ids of pickables come from the PickingManager and don't depend on the batcher.
+    if (id.type == PickingType::kLine || id.type == PickingType::kBox ||
+        id.type == PickingType::kTriangle) {
+      color = PickingId::ToColor(id.type, id.element_id - first_element_id + new_first_element_id,
+                                 id.batcher_id);
+    }
+  });
+}
+
+void Batcher::SetFirstElementId(uint32_t first_element_id) {
+  ORBIT_SCOPE_FUNCTION;
+  if (first_element_id == first_element_id_) return;
+  for (auto& [unused_layer, buffers] : primitive_buffers_by_layer_) {
+    OffsetPickingColors(first_element_id_, first_element_id,
+                        &buffers.line_buffer.picking_colors_);
+    OffsetPickingColors(first_element_id_, first_element_id, &buffers.box_buffer.picking_colors_);
+    OffsetPickingColors(first_element_id_, first_element_id,
+                        &buffers.triangle_buffer.picking_colors_);
+    ++buffers.version;
+  }
+  first_element_id_ = first_element_id;
+}
+
+void Batcher::MovePrimitivesFrom(Batcher* other) {
+  ORBIT_SCOPE_FUNCTION;
+  CHECK(other != this);
+  CHECK(other->batcher_id_ == batcher_id_);
+
+  other->SetFirstElementId(GetNextElementId());
+  for (auto& [layer, other_buffers] : other->primitive_buffers_by_layer_) {
+    LineBuffer& other_lines = other_buffers.line_buffer;
+    BoxBuffer& other_boxes = other_buffers.box_buffer;
+    TriangleBuffer& other_triangles = other_buffers.triangle_buffer;
+    if (other_lines.lines_.size() == 0 && other_boxes.boxes_.size() == 0 &&
+        other_triangles.triangles_.size() == 0) {
+      continue;
+    }
+
+    PrimitiveBuffers& buffers = primitive_buffers_by_layer_[layer];
+    buffers.line_buffer.lines_.Splice(&other_lines.lines_);
+    buffers.line_buffer.colors_.Splice(&other_lines.colors_);
+    buffers.line_buffer.picking_colors_.Splice(&other_lines.picking_colors_);
+    buffers.box_buffer.boxes_.Splice(&other_boxes.boxes_);
+    buffers.box_buffer.colors_.Splice(&other_boxes.colors_);
+    buffers.box_buffer.picking_colors_.Splice(&other_boxes.picking_colors_);
+    buffers.triangle_buffer.triangles_.Splice(&other_triangles.triangles_);
+    buffers.triangle_buffer.colors_.Splice(&other_triangles.colors_);
+    buffers.triangle_buffer.picking_colors_.Splice(&other_triangles.picking_colors_);
+    ++buffers.version;
+  }
+
+  user_data_.insert(user_data_.end(), std::make_move_iterator(other->user_data_.begin()),
+                    std::make_move_iterator(other->user_data_.end()));
+  other->StartNewFrame();
+  other->primitives_moved_to_ = this;
 }
 
 std::vector<float> Batcher::GetLayers() const {
@@ -370,6 +443,10 @@ std::vector<float> Batcher::GetLayers() const {
 void Batcher::DrawLayer(float layer, bool picking) const {
   ORBIT_SCOPE_FUNCTION;
   if (!primitive_buffers_by_layer_.count(layer)) return;
+  const PrimitiveBuffers& buffers = primitive_buffers_by_layer_.at(layer);
+  VertexBufferObjects& vbos = vbos_by_layer_[layer];
+  UploadVertexBufferObjects(buffers, picking, &vbos);
+
   glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
   if (picking) {
     glDisable(GL_BLEND);
@@ -383,9 +460,25 @@ void Batcher::DrawLayer(float layer, bool picking) const {
   glEnable(GL_TEXTURE_2D);
   glLineWidth(2.0f);
 
-  DrawBoxBuffer(layer, picking);
-  DrawLineBuffer(layer, picking);
-  DrawTriangleBuffer(layer, picking);
+  glBindBuffer(GL_ARRAY_BUFFER, vbos.vertex_buffer_id);
+  glVertexPointer(3, GL_FLOAT, sizeof(Vec3), nullptr);
+  glBindBuffer(GL_ARRAY_BUFFER, picking ? vbos.picking_color_buffer_id : vbos.color_buffer_id);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), nullptr);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // The vertices of the boxes come first, then the ones of the lines and of the triangles.
+  const GLint box_vertex_count = 4 * buffers.box_buffer.boxes_.size();
+  const GLint line_vertex_count = 2 * buffers.line_buffer.lines_.size();
+  const GLint triangle_vertex_count = 3 * buffers.triangle_buffer.triangles_.size();
+  if (box_vertex_count > 0) {
+    glDrawArrays(GL_QUADS, 0, box_vertex_count);
+  }
+  if (line_vertex_count > 0) {
+    glDrawArrays(GL_LINES, box_vertex_count, line_vertex_count);
+  }
+  if (triangle_vertex_count > 0) {
+    glDrawArrays(GL_TRIANGLES, box_vertex_count + line_vertex_count, triangle_vertex_count);
+  }
 
   glDisableClientState(GL_COLOR_ARRAY);
   glDisableClientState(GL_VERTEX_ARRAY);
@@ -398,60 +491,71 @@ void Batcher::Draw(bool picking) const {
   }
 }
 
-void Batcher::DrawBoxBuffer(float layer, bool picking) const {
-  auto& box_buffer = primitive_buffers_by_layer_.at(layer).box_buffer;
-  const Block<Box, BoxBuffer::NUM_BOXES_PER_BLOCK>* box_block = box_buffer.boxes_.root();
-  const Block<Color, BoxBuffer::NUM_BOXES_PER_BLOCK * 4>* color_block;
-
-  color_block = !picking ? box_buffer.colors_.root() : box_buffer.picking_colors_.root();
-
-  while (box_block != nullptr) {
-    if (auto num_elems = box_block->size()) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), box_block->data());
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
-      glDrawArrays(GL_QUADS, 0, num_elems * 4);
-    }
+template <class T, uint32_t BlockSize>
+static size_t GetBlockChainSizeInBytes(const BlockChain<T, BlockSize>& block_chain) {
+  return block_chain.size() * sizeof(T);
+}
 
-    box_block = box_block->next();
-    color_block = color_block->next();
+// Copies the elements of `block_chain` to the buffer bound to GL_ARRAY_BUFFER, starting at
+// `offset`, and returns the offset following them.
+template <class T, uint32_t BlockSize>
+static size_t CopyBlockChainToBoundBuffer(const BlockChain<T, BlockSize>& block_chain,
+                                          size_t offset) {
+  for (const Block<T, BlockSize>* block = block_chain.root(); block != nullptr && block->size() > 0;
+       block = block->next()) {
+    const size_t size = block->size() * sizeof(T);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, block->data());
+    offset += size;
   }
+  return offset;
 }
 
-void Batcher::DrawLineBuffer(float layer, bool picking) const {
-  auto& line_buffer = primitive_buffers_by_layer_.at(layer).line_buffer;
-  const Block<Line, LineBuffer::NUM_LINES_PER_BLOCK>* line_block = line_buffer.lines_.root();
-  const Block<Color, LineBuffer::NUM_LINES_PER_BLOCK * 2>* color_block;
-
-  color_block = !picking ? line_buffer.colors_.root() : line_buffer.picking_colors_.root();
-
-  while (line_block != nullptr) {
-    if (auto num_elems = line_block->size()) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), line_block->data());
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
-      glDrawArrays(GL_LINES, 0, num_elems * 2);
-    }
-
-    line_block = line_block->next();
-    color_block = color_block->next();
+template <class BoxT, class LineT, class TriangleT>
+static void UploadToVertexBufferObject(uint32_t* buffer_id, const BoxT& box_data,
+                                       const LineT& line_data, const TriangleT& triangle_data) {
+  if (*buffer_id == 0) {
+    glGenBuffers(1, buffer_id);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, *buffer_id);
+  // Reallocating the storage lets the driver keep using the previous one for pending draws.
+  glBufferData(GL_ARRAY_BUFFER,
+               GetBlockChainSizeInBytes(box_data) + GetBlockChainSizeInBytes(line_data) +
+                   GetBlockChainSizeInBytes(triangle_data),
+               nullptr, GL_DYNAMIC_DRAW);
+  size_t offset = CopyBlockChainToBoundBuffer(box_data, 0);
+  offset = CopyBlockChainToBoundBuffer(line_data, offset);
+  CopyBlockChainToBoundBuffer(triangle_data, offset);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Batcher::UploadVertexBufferObjects(const PrimitiveBuffers& buffers, bool picking,
+                                        VertexBufferObjects* vbos) {
+  if (vbos->uploaded_version != buffers.version) {
+    ORBIT_SCOPE("Upload vertices and colors");
+    UploadToVertexBufferObject(&vbos->vertex_buffer_id, buffers.box_buffer.boxes_,
+                               buffers.line_buffer.lines_, buffers.triangle_buffer.triangles_);
+    UploadToVertexBufferObject(&vbos->color_buffer_id, buffers.box_buffer.colors_,
+                               buffers.line_buffer.colors_, buffers.triangle_buffer.colors_);
+    vbos->uploaded_version = buffers.version;
+  }
+  // Picking colors are only needed when rendering for picking.
+  if (picking && vbos->uploaded_picking_version != buffers.version) {
+    ORBIT_SCOPE("Upload picking colors");
+    UploadToVertexBufferObject(
+        &vbos->picking_color_buffer_id, buffers.box_buffer.picking_colors_,
+        buffers.line_buffer.picking_colors_, buffers.triangle_buffer.picking_colors_);
+    vbos->uploaded_picking_version = buffers.version;
   }
 }
 
-void Batcher::DrawTriangleBuffer(float layer, bool picking) const {
-  auto& triangle_buffer = primitive_buffers_by_layer_.at(layer).triangle_buffer;
-  const Block<Triangle, TriangleBuffer::NUM_TRIANGLES_PER_BLOCK>* triangle_block =
-      triangle_buffer.triangles_.root();
-  const Block<Color, TriangleBuffer::NUM_TRIANGLES_PER_BLOCK * 3>* color_block;
-
-  color_block = !picking ? triangle_buffer.colors_.root() : triangle_buffer.picking_colors_.root();
-
-  while (triangle_block != nullptr) {
-    if (int num_elems = triangle_block->size()) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), triangle_block->data());
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
-      glDrawArrays(GL_TRIANGLES, 0, num_elems * 3);
+std::vector<uint32_t> Batcher::TakeVertexBufferObjects() {
+  std::vector<uint32_t> buffer_ids;
+  for (const auto& [unused_layer, vbos] : vbos_by_layer_) {
+    for (uint32_t buffer_id :
+         {vbos.vertex_buffer_id, vbos.color_buffer_id, vbos.picking_color_buffer_id}) {
+      if (buffer_id != 0) buffer_ids.push_back(buffer_id);
     }
-
-    triangle_block = triangle_block->next();
-    color_block = color_block->next();
   }
+  vbos_by_layer_.clear();
+  return buffer_ids;
 }
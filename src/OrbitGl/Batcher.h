@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <array>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -79,11 +80,15 @@ struct PrimitiveBuffers {
     line_buffer.Reset();
     box_buffer.Reset();
     triangle_buffer.Reset();
+    ++version;
   }
 
   LineBuffer line_buffer;
   BoxBuffer box_buffer;
   TriangleBuffer triangle_buffer;
+  // Incremented whenever primitives are added or reset, so that the copies in vertex buffer
+  // objects are only uploaded again when they are outdated.
+  uint64_t version = 0;
 };
 
 enum class ShadingDirection { kLeftToRight, kRightToLeft, kTopToBottom, kBottomToTop };
@@ -116,6 +121,7 @@ class Batcher {
   Batcher() = delete;
   Batcher(const Batcher&) = delete;
   Batcher(Batcher&&) = delete;
+  virtual ~Batcher() = default;
 
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color,
                std::unique_ptr<PickingUserData> user_data = nullptr);
@@ -165,6 +171,26 @@ class Batcher {
   void ResetElements();
   void StartNewFrame();
 
+  // Moves the primitives and the picking user data of `other` to this batcher, after the ones
+  // already added, by relinking the blocks holding them rather than copying them. Their picking ids
+  // are offset with SetFirstElementId so that they are the same as if the primitives had been added
+  // to this batcher directly. `other` is left empty and from then on looks up picking ids in this
+  // batcher, as the tooltip callbacks created while filling it keep a pointer to it.
+  void MovePrimitivesFrom(Batcher* other);
+  // Changes the picking ids of the primitives with picking user data to start at
+  // `first_element_id`, which is otherwise 0. Lets several batchers rewrite their picking ids in
+  // parallel before being moved to the same batcher, which then only has to relink their blocks.
+  void SetFirstElementId(uint32_t first_element_id);
+  // The picking id the next primitive added with picking user data gets.
+  [[nodiscard]] uint32_t GetNextElementId() const { return first_element_id_ + user_data_.size(); }
+
+  // Hands over the ids of the vertex buffer objects created by DrawLayer, which the batcher no
+  // longer uses afterwards. The batcher can't delete them itself, as this needs the OpenGL context
+  // of its canvas to be current, which is usually not the case when the batcher is destroyed.
+  [[nodiscard]] std::vector<uint32_t> TakeVertexBufferObjects();
+
+  [[nodiscard]] BatcherId GetBatcherId() const { return batcher_id_; }
+
   [[nodiscard]] PickingManager* GetPickingManager() const { return picking_manager_; }
   void SetPickingManager(PickingManager* picking_manager) { picking_manager_ = picking_manager; }
 
@@ -176,10 +202,6 @@ class Batcher {
   static constexpr uint32_t kNumArcSides = 16;
 
  protected:
-  void DrawLineBuffer(float layer, bool picking) const;
-  void DrawBoxBuffer(float layer, bool picking) const;
-  void DrawTriangleBuffer(float layer, bool picking) const;
-
   void GetBoxGradientColors(const Color& color, std::array<Color, 4>* colors,
                             ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
 
@@ -197,7 +219,26 @@ class Batcher {
   PickingManager* picking_manager_;
   std::unordered_map<float, PrimitiveBuffers> primitive_buffers_by_layer_;
 
+  // Copies of the primitives of a layer on the GPU, kept across frames: redrawing without changing
+  // the primitives (e.g. for the mouse hover) doesn't upload anything. Vertices and colors of the
+  // boxes come first, then the ones of the lines and of the triangles. As the coordinates are in
+  // pixels, panning and zooming still change the primitives and upload them again.
+  struct VertexBufferObjects {
+    uint32_t vertex_buffer_id = 0;
+    uint32_t color_buffer_id = 0;
+    uint32_t picking_color_buffer_id = 0;
+    uint64_t uploaded_version = std::numeric_limits<uint64_t>::max();
+    uint64_t uploaded_picking_version = std::numeric_limits<uint64_t>::max();
+  };
+  static void UploadVertexBufferObjects(const PrimitiveBuffers& buffers, bool picking,
+                                        VertexBufferObjects* vbos);
+  mutable std::unordered_map<float, VertexBufferObjects> vbos_by_layer_;
+
   std::vector<std::unique_ptr<PickingUserData>> user_data_;
+  // The picking id of the primitive with the first element of `user_data_`.
+  uint32_t first_element_id_ = 0;
+  // Set by MovePrimitivesFrom on the batcher that was moved from.
+  const Batcher* primitives_moved_to_ = nullptr;
 
   std::vector<Vec2> circle_points;
 };
@@ -237,4 +237,98 @@ TEST(Batcher, MultipleDrawCalls) {
   EXPECT_DEATH((void)batcher.GetUserData(id), "size");
 }
 
+TEST(Batcher, MovePrimitivesFrom) {
+  MockBatcher batcher(BatcherId::kUi);
+  MockBatcher other_batcher(BatcherId::kUi);
+
+  std::string first_box_custom_data = "first box custom data";
+  auto first_box_user_data = std::make_unique<PickingUserData>();
+  first_box_user_data->custom_data_ = &first_box_custom_data;
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                 std::move(first_box_user_data));
+
+  std::string line_custom_data = "line custom data";
+  auto line_user_data = std::make_unique<PickingUserData>();
+  line_user_data->custom_data_ = &line_custom_data;
+  other_batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255),
+                        std::move(line_user_data));
+
+  std::string second_box_custom_data = "second box custom data";
+  auto second_box_user_data = std::make_unique<PickingUserData>();
+  second_box_user_data->custom_data_ = &second_box_custom_data;
+  other_batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(0, 0, 255, 255),
+                       std::move(second_box_user_data));
+
+  batcher.MovePrimitivesFrom(&other_batcher);
+  ExpectDraw(other_batcher, 0, 0, 0);
+  ExpectDraw(batcher, 1, 0, 2);
+  EXPECT_EQ(batcher.GetDrawnBoxColors()[1], Color(0, 0, 255, 255));
+
+  batcher.ResetMockDrawCounts();
+  batcher.Draw(true);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], first_box_custom_data);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[1], second_box_custom_data);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnLineColors()[0], line_custom_data);
+  // The batcher moved from looks up the ids in the batcher it was moved to.
+  ExpectCustomDataEq(other_batcher, batcher.GetDrawnLineColors()[0], line_custom_data);
+}
+
+TEST(Batcher, SetFirstElementId) {
+  MockBatcher batcher(BatcherId::kUi);
+  std::string box_custom_data = "box custom data";
+  auto box_user_data = std::make_unique<PickingUserData>();
+  box_user_data->custom_data_ = &box_custom_data;
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), std::move(box_user_data));
+  EXPECT_EQ(batcher.GetNextElementId(), 1);
+
+  batcher.SetFirstElementId(5);
+  EXPECT_EQ(batcher.GetNextElementId(), 6);
+  batcher.Draw(true);
+  ASSERT_EQ(batcher.GetDrawnBoxColors().size(), 1);
+  EXPECT_EQ(MockRenderPickingColor(batcher.GetDrawnBoxColors()[0]).element_id, 5);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], box_custom_data);
+
+  batcher.StartNewFrame();
+  EXPECT_EQ(batcher.GetNextElementId(), 0);
+}
+
+TEST(Batcher, MovePrimitivesFromBatcherWithFirstElementIdSet) {
+  MockBatcher batcher(BatcherId::kUi);
+  MockBatcher other_batcher(BatcherId::kUi);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                 std::make_unique<PickingUserData>());
+
+  std::string line_custom_data = "line custom data";
+  auto line_user_data = std::make_unique<PickingUserData>();
+  line_user_data->custom_data_ = &line_custom_data;
+  other_batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255),
+                        std::move(line_user_data));
+  other_batcher.SetFirstElementId(batcher.GetNextElementId());
+
+  batcher.MovePrimitivesFrom(&other_batcher);
+  batcher.Draw(true);
+  ASSERT_EQ(batcher.GetDrawnLineColors().size(), 1);
+  EXPECT_EQ(MockRenderPickingColor(batcher.GetDrawnLineColors()[0]).element_id, 1);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnLineColors()[0], line_custom_data);
+}
+
+TEST(Batcher, PickingShadedTrapezium) {
+  MockBatcher batcher(BatcherId::kUi);
+
+  std::string trapezium_custom_data = "trapezium custom data";
+  auto trapezium_user_data = std::make_unique<PickingUserData>();
+  trapezium_user_data->custom_data_ = &trapezium_custom_data;
+  batcher.AddShadedTrapezium(Vec3(0, 1, 0), Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(1, 1, 0),
+                             Color(0, 255, 0, 255), std::move(trapezium_user_data));
+  batcher.AddShadedTrapezium(Vec3(0, 1, 0), Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(1, 1, 0),
+                             Color(0, 255, 0, 255));
+
+  batcher.Draw(true);
+  ASSERT_EQ(batcher.GetDrawnTriangleColors().size(), 4);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnTriangleColors()[0], trapezium_custom_data);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnTriangleColors()[1], trapezium_custom_data);
+  EXPECT_EQ(batcher.GetUserData(MockRenderPickingColor(batcher.GetDrawnTriangleColors()[2])),
+            nullptr);
+}
+
 }  // namespace
\ No newline at end of file
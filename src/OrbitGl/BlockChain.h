@@ -7,6 +7,8 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
 
@@ -159,6 +161,54 @@ class BlockChain final {
 
   [[nodiscard]] const Block<T, BlockSize>* root() const { return root_; }
 
+  // Moves the elements of `other` to the end of this chain by relinking their blocks, without
+  // copying them. In exchange, `other` gets the blocks this chain doesn't use, so that both keep
+  // memory to reuse after Reset.
+  void Splice(BlockChain* other) {
+    CHECK(other != this);
+    if (other->size_ == 0) return;
+    if (size_ == 0) {
+      std::swap(root_, other->root_);
+      std::swap(current_, other->current_);
+      std::swap(size_, other->size_);
+      return;
+    }
+
+    Block<T, BlockSize>* unused_blocks = current_->next_;
+    Block<T, BlockSize>* other_unused_blocks = other->current_->next_;
+    current_->next_ = other->root_;
+    other->root_->prev_ = current_;
+    current_ = other->current_;
+    current_->next_ = nullptr;
+    size_ += other->size_;
+
+    if (unused_blocks == nullptr) {
+      unused_blocks = other_unused_blocks;
+    } else if (other_unused_blocks != nullptr) {
+      Block<T, BlockSize>* last_unused_block = unused_blocks;
+      while (last_unused_block->next_ != nullptr) last_unused_block = last_unused_block->next_;
+      last_unused_block->next_ = other_unused_blocks;
+      other_unused_blocks->prev_ = last_unused_block;
+    }
+    if (unused_blocks == nullptr) {
+      unused_blocks = new Block<T, BlockSize>(nullptr);
+    }
+    unused_blocks->prev_ = nullptr;
+    other->root_ = other->current_ = unused_blocks;
+    other->size_ = 0;
+  }
+
+  // Calls `function` on each element, which it may modify in place.
+  template <class Function>
+  void ForEach(Function&& function) {
+    for (Block<T, BlockSize>* block = root_; block != nullptr && block->size() > 0;
+         block = block->next_) {
+      for (T& item : block->data_) {
+        function(item);
+      }
+    }
+  }
+
   void Reset() {
     Block<T, BlockSize>* block = root_;
     while (block) {
@@ -204,3 +204,63 @@ TEST(BlockChain, MovableType) {
   EXPECT_EQ(chain.root()->data()[0].value(), "v1");
   EXPECT_EQ(chain.root()->data()[1].value(), "v2");
 }
+
+TEST(BlockChain, Splice) {
+  BlockChain<int, 1024> chain;
+  chain.push_back_n(1, 1024 + 10);
+  BlockChain<int, 1024> other;
+  other.push_back_n(2, 1024 * 2);
+  const Block<int, 1024>* other_root = other.root();
+
+  chain.Splice(&other);
+  EXPECT_EQ(chain.size(), 1024 * 3 + 10);
+  EXPECT_EQ(other.size(), 0);
+  // The blocks are relinked, not copied.
+  EXPECT_EQ(chain.root()->next()->next(), other_root);
+
+  int count_of_1 = 0;
+  int count_of_2 = 0;
+  for (int value : chain) {
+    if (value == 1) {
+      EXPECT_EQ(count_of_2, 0);
+      ++count_of_1;
+    } else {
+      EXPECT_EQ(value, 2);
+      ++count_of_2;
+    }
+  }
+  EXPECT_EQ(count_of_1, 1024 + 10);
+  EXPECT_EQ(count_of_2, 1024 * 2);
+
+  chain.emplace_back(3);
+  EXPECT_EQ(chain.size(), 1024 * 3 + 11);
+  other.push_back_n(4, 1024 * 2);
+  EXPECT_EQ(other.size(), 1024 * 2);
+  EXPECT_EQ(*other.begin(), 4);
+}
+
+TEST(BlockChain, SpliceIntoEmptyChain) {
+  BlockChain<int, 1024> chain;
+  chain.push_back_n(1, 1024 * 2);
+  chain.Reset();
+  BlockChain<int, 1024> other;
+  other.push_back_n(2, 10);
+
+  chain.Splice(&other);
+  EXPECT_EQ(chain.size(), 10);
+  EXPECT_EQ(chain.root()->size(), 10);
+  EXPECT_EQ(other.size(), 0);
+  // The blocks `chain` didn't use went to `other`.
+  other.push_back_n(3, 1024 + 1);
+  EXPECT_EQ(other.size(), 1024 + 1);
+  EXPECT_EQ(chain.size(), 10);
+}
+
+TEST(BlockChain, ForEach) {
+  BlockChain<int, 1024> chain;
+  chain.push_back_n(1, 1024 + 1);
+  chain.ForEach([](int& value) { value *= 2; });
+  for (int value : chain) {
+    EXPECT_EQ(value, 2);
+  }
+}
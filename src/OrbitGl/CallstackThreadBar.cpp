@@ -147,10 +147,11 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
       CHECK(time >= min_tick && time <= max_tick);
       Vec2 pos(time_graph_->GetWorldFromTick(time) - kPickingBoxOffset, pos_[1] - track_height + 1);
       Vec2 size(kPickingBoxWidth, track_height);
+      // The event is only valid for the duration of this call, so only its callstack id is kept.
       auto user_data = std::make_unique<PickingUserData>(
-          nullptr,
-          [this, batcher](PickingId id) -> std::string { return GetSampleTooltip(*batcher, id); });
-      user_data->custom_data_ = &event;
+          nullptr, [this, callstack_id = event.callstack_id()](PickingId /*id*/) -> std::string {
+            return GetSampleTooltip(callstack_id);
+          });
       batcher->AddShadedBox(pos, size, z, kGreenSelection, std::move(user_data));
     };
     if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
@@ -238,19 +239,11 @@ std::string CallstackThreadBar::FormatCallstackForTooltip(const CallstackInfo& c
   return result;
 }
 
-std::string CallstackThreadBar::GetSampleTooltip(const Batcher& batcher, PickingId id) const {
+std::string CallstackThreadBar::GetSampleTooltip(uint64_t callstack_id) const {
   static const std::string unknown_return_text = "Function call information missing";
 
-  const PickingUserData* user_data = batcher.GetUserData(id);
-  if (user_data == nullptr || user_data->custom_data_ == nullptr) {
-    return unknown_return_text;
-  }
-
   CHECK(capture_data_ != nullptr);
   const CallstackData* callstack_data = capture_data_->GetCallstackData();
-  const auto* callstack_event = static_cast<const CallstackEvent*>(user_data->custom_data_);
-
-  uint64_t callstack_id = callstack_event->callstack_id();
   const CallstackInfo* callstack = callstack_data->GetCallstack(callstack_id);
   if (callstack == nullptr) {
     return unknown_return_text;
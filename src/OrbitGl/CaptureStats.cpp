@@ -29,6 +29,14 @@ ErrorMessageOr<void> CaptureStats::Generate(CaptureWindow* capture_window, uint6
     return capture_data->GetThreadName(thread_id);
   };
   SchedulingStats scheduling_stats(sched_scopes, thread_name_provider, start_ns, end_ns);
-  summary_ = scheduling_stats.ToString();
+  summary_ = scheduling_stats.ToString() + GetCompressionSummary();
   return outcome::success();
 }
+
+std::string CaptureStats::GetCompressionSummary() const {
+  if (compressed_byte_count_ == 0) return "";
+  return absl::StrFormat(
+      "\nCapture events: %u bytes received compressed, %u bytes uncompressed (ratio %.2f)\n",
+      compressed_byte_count_, uncompressed_byte_count_,
+      static_cast<double>(uncompressed_byte_count_) / compressed_byte_count_);
+}
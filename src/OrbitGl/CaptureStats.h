@@ -5,21 +5,38 @@
 #ifndef ORBIT_GL_CAPUTRE_STATS_H_
 #define ORBIT_GL_CAPUTRE_STATS_H_
 
+#include <stdint.h>
+
 #include <string>
 
 #include "OrbitBase/Result.h"
 
 class CaptureWindow;
 
-// CaptureStats generates statistics from a CaptureWindow for a given time period.
+// CaptureStats generates statistics from a CaptureWindow for a given time period. The summary also
+// reports how much the CaptureEvents of the whole capture were compressed, if they were.
 class CaptureStats {
  public:
   CaptureStats() = default;
   ErrorMessageOr<void> Generate(CaptureWindow* capture_window, uint64_t start_ns, uint64_t end_ns);
   [[nodiscard]] const std::string& GetSummary() { return summary_; }
 
+  // The number of bytes of compressed CaptureEvents received, and their number of bytes after
+  // decompression.
+  void SetCaptureEventsByteCounts(uint64_t compressed_byte_count,
+                                  uint64_t uncompressed_byte_count) {
+    compressed_byte_count_ = compressed_byte_count;
+    uncompressed_byte_count_ = uncompressed_byte_count;
+  }
+  [[nodiscard]] uint64_t GetCompressedByteCount() const { return compressed_byte_count_; }
+  [[nodiscard]] uint64_t GetUncompressedByteCount() const { return uncompressed_byte_count_; }
+  // Empty if no compressed CaptureEvents were received.
+  [[nodiscard]] std::string GetCompressionSummary() const;
+
  private:
   std::string summary_;
+  uint64_t compressed_byte_count_ = 0;
+  uint64_t uncompressed_byte_count_ = 0;
 };
 
 #endif  // ORBIT_GL_CAPUTRE_STATS_H_
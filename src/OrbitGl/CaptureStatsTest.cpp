@@ -17,6 +17,24 @@ TEST(CaptureStats, NullCaptureWindow) {
   EXPECT_EQ(result.has_error(), true);
 }
 
+TEST(CaptureStats, CompressionSummaryIsEmptyWithoutCompressedEvents) {
+  CaptureStats capture_stats;
+  EXPECT_EQ(capture_stats.GetCompressedByteCount(), 0);
+  EXPECT_EQ(capture_stats.GetUncompressedByteCount(), 0);
+  EXPECT_EQ(capture_stats.GetCompressionSummary(), "");
+}
+
+TEST(CaptureStats, CompressionSummaryReportsByteCountsAndRatio) {
+  CaptureStats capture_stats;
+  capture_stats.SetCaptureEventsByteCounts(/*compressed_byte_count=*/1000,
+                                           /*uncompressed_byte_count=*/2500);
+  EXPECT_EQ(capture_stats.GetCompressedByteCount(), 1000);
+  EXPECT_EQ(capture_stats.GetUncompressedByteCount(), 2500);
+  EXPECT_EQ(capture_stats.GetCompressionSummary(),
+            "\nCapture events: 1000 bytes received compressed, 2500 bytes uncompressed (ratio "
+            "2.50)\n");
+}
+
 TEST(SchedulingStats, ZeroSchedulingScopes) {
   std::vector<const orbit_client_data::TextBox*> scheduling_scopes;
   SchedulingStats::ThreadNameProvider thread_name_provider = [](int32_t thread_id) {
@@ -234,6 +234,8 @@ bool CaptureWindow::RightUp() {
   }
 
   if (app_->IsDevMode()) {
+    selection_stats_.SetCaptureEventsByteCounts(app_->GetCompressedCaptureEventsByteCount(),
+                                                app_->GetUncompressedCaptureEventsByteCount());
     auto result = selection_stats_.Generate(this, select_start_time_, select_stop_time_);
     if (result.has_error()) {
       ERROR("%s", result.error().message());
@@ -606,10 +608,21 @@ void CaptureWindow::set_draw_help(bool draw_help) {
 }
 
 void CaptureWindow::CreateTimeGraph(const CaptureData* capture_data) {
+  if (time_graph_ != nullptr) ReleaseVertexBufferObjectsLater(&time_graph_->GetBatcher());
   time_graph_ =
       std::make_unique<TimeGraph>(this, app_, &viewport_, capture_data, &GetPickingManager());
 }
 
+void CaptureWindow::ClearTimeGraph() {
+  if (time_graph_ != nullptr) ReleaseVertexBufferObjectsLater(&time_graph_->GetBatcher());
+  time_graph_.reset(nullptr);
+}
+
+void CaptureWindow::ReleaseGlResources() {
+  if (time_graph_ != nullptr) ReleaseVertexBufferObjectsLater(&time_graph_->GetBatcher());
+  GlCanvas::ReleaseGlResources();
+}
+
 Batcher& CaptureWindow::GetBatcherById(BatcherId batcher_id) {
   switch (batcher_id) {
     case BatcherId::kTimeGraph:
@@ -667,7 +680,8 @@ void CaptureWindow::RenderImGuiDebugUI() {
       IMGUI_VAR_TO_TEXT(time_graph_->GetTimeWindowUs());
       const CaptureData* capture_data = time_graph_->GetCaptureData();
       if (capture_data != nullptr) {
-        IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->callstack_events_by_tid().size());
+        IMGUI_VAR_TO_TEXT(
+            capture_data->GetCallstackData()->GetCallstackEventsCountsPerTid().size());
         IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->GetCallstackEventsCount());
       }
     }
@@ -45,6 +45,7 @@ class CaptureWindow : public GlCanvas {
 
   void PostRender() override;
   void RenderImGuiDebugUI() override;
+  void ReleaseGlResources() override;
 
   void RequestUpdatePrimitives();
   [[nodiscard]] bool IsRedrawNeeded() const override;
@@ -54,7 +55,7 @@ class CaptureWindow : public GlCanvas {
 
   [[nodiscard]] TimeGraph* GetTimeGraph() { return time_graph_.get(); }
   void CreateTimeGraph(const orbit_client_model::CaptureData* capture_data);
-  void ClearTimeGraph() { time_graph_.reset(nullptr); }
+  void ClearTimeGraph();
 
   Batcher& GetBatcherById(BatcherId batcher_id);
 
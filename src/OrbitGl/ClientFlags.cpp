@@ -43,6 +43,24 @@ ABSL_FLAG(bool, enable_frame_pointer_validator, false, "Enable validation of fra
 // TODO: Remove this flag once we have a way to toggle the display return values
 ABSL_FLAG(bool, show_return_values, false, "Show return values on time slices");
 
+// TODO: Remove this flag once OrbitService can pick the number of ring buffer readers on its own.
+ABSL_FLAG(uint32_t, ring_buffer_reader_threads, 1,
+          "Number of threads OrbitService uses to read perf_event_open ring buffers");
+
+ABSL_FLAG(bool, event_driven_ring_buffer_polling, false,
+          "Wait for perf_event_open ring buffers to have data instead of polling them");
+ABSL_FLAG(bool, compress_capture_events, false,
+          "Ask OrbitService to compress the CaptureEvents it sends");
+ABSL_FLAG(bool, unwind_with_precompiled_cfi, false,
+          "Unwind DWARF stack samples with call frame information precompiled into flat tables");
+ABSL_FLAG(bool, intern_orbit_api_names, false,
+          "Ask the Orbit API to send the name of each scope only once per capture");
+ABSL_FLAG(bool, use_shared_memory_producer_transport, false,
+          "Ask producers to send their events to OrbitService through shared memory");
+ABSL_FLAG(bool, use_unwinding_cache, false,
+          "Unwind DWARF stack samples only up to the frames shared with the previous sample of the "
+          "same thread, reusing the outer frames of that sample (experimental)");
+
 ABSL_FLAG(bool, enable_tracepoint_feature, false,
           "Enable the setting of the panel of kernel tracepoints");
 
@@ -42,9 +42,9 @@ void DataManager::set_selected_thread_id(int32_t thread_id) {
   selected_thread_id_ = thread_id;
 }
 
-bool DataManager::IsFunctionVisible(uint64_t function_id) const {
+const absl::flat_hash_set<uint64_t>& DataManager::visible_function_ids() const {
   CHECK(std::this_thread::get_id() == main_thread_id_);
-  return visible_function_ids_.contains(function_id);
+  return visible_function_ids_;
 }
 
 uint64_t DataManager::highlighted_function_id() const {
@@ -40,7 +40,7 @@ class DataManager final {
 
   [[nodiscard]] bool IsFunctionSelected(const orbit_client_protos::FunctionInfo& function) const;
   [[nodiscard]] std::vector<orbit_client_protos::FunctionInfo> GetSelectedFunctions() const;
-  [[nodiscard]] bool IsFunctionVisible(uint64_t function_address) const;
+  [[nodiscard]] const absl::flat_hash_set<uint64_t>& visible_function_ids() const;
   [[nodiscard]] uint64_t highlighted_function_id() const;
   [[nodiscard]] int32_t selected_thread_id() const;
   [[nodiscard]] const orbit_client_data::TextBox* selected_text_box() const;
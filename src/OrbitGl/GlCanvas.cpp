@@ -274,6 +274,7 @@ void GlCanvas::Render(int width, int height) {
 
   redraw_requested_ = false;
   ui_batcher_.StartNewFrame();
+  DeleteReleasedVertexBufferObjects();
 
   PrepareGlState();
   PrepareWorldSpaceViewport();
@@ -309,6 +310,23 @@ void GlCanvas::Render(int width, int height) {
   double_clicking_ = false;
 }
 
+void GlCanvas::ReleaseGlResources() {
+  ReleaseVertexBufferObjectsLater(&ui_batcher_);
+  DeleteReleasedVertexBufferObjects();
+}
+
+void GlCanvas::ReleaseVertexBufferObjectsLater(Batcher* batcher) {
+  std::vector<uint32_t> buffer_ids = batcher->TakeVertexBufferObjects();
+  released_vertex_buffer_objects_.insert(released_vertex_buffer_objects_.end(),
+                                         buffer_ids.begin(), buffer_ids.end());
+}
+
+void GlCanvas::DeleteReleasedVertexBufferObjects() {
+  if (released_vertex_buffer_objects_.empty()) return;
+  glDeleteBuffers(released_vertex_buffer_objects_.size(), released_vertex_buffer_objects_.data());
+  released_vertex_buffer_objects_.clear();
+}
+
 void GlCanvas::PreRender() {
   if (viewport_.IsDirty()) {
     ResetHoverTimer();
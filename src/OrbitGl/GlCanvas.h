@@ -41,6 +41,9 @@ class GlCanvas : public orbit_gl::AccessibleInterfaceProvider {
 
   void Resize(int width, int height);
   void Render(int width, int height);
+  // Deletes the vertex buffer objects of the batchers of this canvas. Needs the OpenGL context of
+  // the canvas to be current, so it has to be called before the canvas is destroyed.
+  virtual void ReleaseGlResources();
 
   virtual void PreRender();
   virtual void PostRender();
@@ -137,6 +140,11 @@ class GlCanvas : public orbit_gl::AccessibleInterfaceProvider {
 
   void SetPickingMode(PickingMode mode);
 
+  // Takes the vertex buffer objects of a batcher that is about to be destroyed, to delete them the
+  // next time the OpenGL context is current.
+  void ReleaseVertexBufferObjectsLater(Batcher* batcher);
+  void DeleteReleasedVertexBufferObjects();
+
   Vec2 mouse_click_pos_world_;
   Vec2i mouse_move_pos_screen_ = Vec2i(0, 0);
   Vec2 select_start_pos_world_ = Vec2(0, 0);
@@ -164,6 +172,7 @@ class GlCanvas : public orbit_gl::AccessibleInterfaceProvider {
   // Batcher to draw elements in the UI.
   Batcher ui_batcher_;
   std::vector<RenderCallback> render_callbacks_;
+  std::vector<uint32_t> released_vertex_buffer_objects_;
 
  private:
   [[nodiscard]] virtual std::unique_ptr<orbit_accessibility::AccessibleInterface>
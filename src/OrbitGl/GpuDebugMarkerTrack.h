@@ -45,6 +45,7 @@ class GpuDebugMarkerTrack : public TimerTrack {
   [[nodiscard]] float GetYFromTimer(
       const orbit_client_protos::TimerInfo& timer_info) const override;
   [[nodiscard]] bool TimerFilter(const orbit_client_protos::TimerInfo& timer) const override;
+  [[nodiscard]] bool CanDrawTimerSummaries() const override { return false; }
   [[nodiscard]] Color GetTimerColor(const orbit_client_protos::TimerInfo& timer, bool is_selected,
                                     bool is_highlighted) const override;
   void SetTimesliceText(const orbit_client_protos::TimerInfo& timer, float min_x, float z_offset,
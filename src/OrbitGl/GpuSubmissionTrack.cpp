@@ -59,11 +59,12 @@ void GpuSubmissionTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_inf
 }
 
 bool GpuSubmissionTrack::IsTimerActive(const TimerInfo& timer_info) const {
-  bool is_same_tid_as_selected = timer_info.thread_id() == app_->selected_thread_id();
+  const int32_t selected_thread_id = time_graph_->GetTrackSelection().selected_thread_id;
+  bool is_same_tid_as_selected = timer_info.thread_id() == selected_thread_id;
   // We do not properly track the PID for GPU jobs and we still want to show
   // all jobs as active when no thread is selected, so this logic is a bit
   // different than SchedulerTrack::IsTimerActive.
-  bool no_thread_selected = app_->selected_thread_id() == orbit_base::kAllProcessThreadsTid;
+  bool no_thread_selected = selected_thread_id == orbit_base::kAllProcessThreadsTid;
 
   return is_same_tid_as_selected || no_thread_selected;
 }
@@ -64,6 +64,7 @@ class GpuSubmissionTrack : public TimerTrack {
   [[nodiscard]] Color GetTimerColor(const orbit_client_protos::TimerInfo& timer, bool is_selected,
                                     bool is_highlighted) const override;
   [[nodiscard]] bool TimerFilter(const orbit_client_protos::TimerInfo& timer) const override;
+  [[nodiscard]] bool CanDrawTimerSummaries() const override { return false; }
   void SetTimesliceText(const orbit_client_protos::TimerInfo& timer, float min_x, float z_offset,
                         orbit_client_data::TextBox* text_box) override;
   [[nodiscard]] std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const override;
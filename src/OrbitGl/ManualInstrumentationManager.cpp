@@ -62,11 +62,10 @@ void ManualInstrumentationManager::ProcessAsyncTimerDeprecated(
 }
 
 void ManualInstrumentationManager::ProcessAsyncTimer(
-    const orbit_client_protos::TimerInfo& timer_info) {
-  orbit_api::Event start_event = ApiEventFromTimerInfo(timer_info);
+    const std::string& name, const orbit_client_protos::TimerInfo& timer_info) {
   absl::MutexLock lock(&mutex_);
   for (auto* listener : async_timer_info_listeners_) {
-    (*listener)(start_event.name, timer_info);
+    (*listener)(name, timer_info);
   }
 }
 
@@ -49,6 +49,12 @@ TextRenderer::~TextRenderer() {
     vertex_buffer_delete(buffer);
   }
   vertex_buffers_by_layer_.clear();
+  for (VertexBuffersByLayer& parallel_vertex_buffers : parallel_vertex_buffers_) {
+    for (auto& [unused_layer, buffer] : parallel_vertex_buffers) {
+      vertex_buffer_delete(buffer);
+    }
+  }
+  parallel_vertex_buffers_.clear();
 
   if (texture_atlas_) {
     texture_atlas_delete(texture_atlas_);
@@ -68,9 +74,6 @@ void TextRenderer::Init() {
     fonts_by_size_[i] = texture_font_new_from_file(texture_atlas_, i, font_file_name.c_str());
   }
 
-  pen_.x = 0;
-  pen_.y = 0;
-
   glGenTextures(1, &texture_atlas_->id);
   glBindTexture(GL_TEXTURE_2D, texture_atlas_->id);
 
@@ -108,22 +111,49 @@ ftgl::texture_font_t* TextRenderer::GetFont(uint32_t size) {
       size = (--iterator_next)->first;
     }
   }
-  return fonts_by_size_[size];
+  return fonts_by_size_.at(size);
 }
 
-// Always use this method when you need to get a glyph, we need to make sure we know when the
-// texture atlas has been updated. One way to ensure that is to check if we can find the glyph
-// already and, if not, load it explicitly (in which case the texture atlas is updated). Note that
-// texture_font_get_glyph internally may load the glyph if it does not find it. We do not want
-// that as in that case, we do not know that the atlas has actually changed.
-ftgl::texture_glyph_t* TextRenderer::MaybeLoadAndGetGlyph(ftgl::texture_font_t* font,
-                                                          const char* character) {
-  if (!texture_font_find_glyph(font, character)) {
-    texture_font_load_glyph(font, character);
-    texture_atlas_changed_ = true;
+static bool HasAllGlyphs(ftgl::texture_font_t* font, const char* text) {
+  for (const char* character = text; *character != '\0'; ++character) {
+    if (texture_font_find_glyph(font, character) == nullptr) return false;
+  }
+  return true;
+}
+
+// Loading glyphs is the only way text is added to the texture atlas, and we need to know when
+// the atlas has been updated. Note that texture_font_get_glyph internally may load the glyph if it
+// does not find it, in which case we would not know that the atlas has actually changed. This also
+// modifies the glyphs of the font, so it needs the exclusive lock, which is only taken when some
+// glyphs are missing: laying out the text then only needs the shared lock.
+ftgl::texture_font_t* TextRenderer::GetFontWithGlyphs(uint32_t font_size,
+                                                      std::initializer_list<const char*> texts) {
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    ftgl::texture_font_t* font = GetFont(font_size);
+    if (std::all_of(texts.begin(), texts.end(),
+                    [font](const char* text) { return HasAllGlyphs(font, text); })) {
+      return font;
+    }
+  }
+
+  absl::MutexLock lock(&mutex_);
+  ftgl::texture_font_t* font = GetFont(font_size);
+  for (const char* text : texts) {
+    for (const char* character = text; *character != '\0'; ++character) {
+      if (texture_font_find_glyph(font, character) == nullptr) {
+        texture_font_load_glyph(font, character);
+        texture_atlas_changed_ = true;
+      }
+    }
   }
+  return font;
+}
 
-  return texture_font_get_glyph(font, character);
+// Returns nullptr if the glyph was not loaded by GetFontWithGlyphs, or can't be loaded.
+ftgl::texture_glyph_t* TextRenderer::GetLoadedGlyph(ftgl::texture_font_t* font,
+                                                    const char* character) {
+  return texture_font_find_glyph(font, character);
 }
 
 void TextRenderer::RenderLayer(float layer) {
@@ -232,7 +262,7 @@ void TextRenderer::AddTextInternal(ftgl::texture_font_t* font, const char* text,
       continue;
     }
 
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+    ftgl::texture_glyph_t* glyph = GetLoadedGlyph(font, text + i);
     if (glyph != nullptr) {
       float kerning = (i == 0) ? 0.0f : texture_glyph_get_kerning(glyph, text + i - 1);
       pen->x += kerning;
@@ -262,10 +292,11 @@ void TextRenderer::AddTextInternal(ftgl::texture_font_t* font, const char* text,
       if (str_width > max_width) {
         break;
       }
-      if (!vertex_buffers_by_layer_.count(z)) {
-        vertex_buffers_by_layer_[z] = ftgl::vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
+      ftgl::vertex_buffer_t*& vertex_buffer = GetVertexBuffersOfCallingThread()[z];
+      if (vertex_buffer == nullptr) {
+        vertex_buffer = ftgl::vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
       }
-      vertex_buffer_push_back(vertex_buffers_by_layer_.at(z), vertices, 4, kIndices.data(), 6);
+      vertex_buffer_push_back(vertex_buffer, vertices, 4, kIndices.data(), 6);
       pen->x += glyph->advance_x;
     }
   }
@@ -285,17 +316,28 @@ void TextRenderer::AddText(const char* text, float x, float y, float z, const Co
                            uint32_t font_size, float max_size, bool right_justified,
                            Vec2* out_text_pos, Vec2* out_text_size) {
   if (!font_size) return;
-  ToScreenSpace(x, y, pen_.x, pen_.y);
+  (void)GetFontWithGlyphs(font_size, {text});
+  absl::ReaderMutexLock lock(&mutex_);
+  AddTextLocked(text, x, y, z, color, font_size, max_size, right_justified, out_text_pos,
+                out_text_size);
+}
+
+void TextRenderer::AddTextLocked(const char* text, float x, float y, float z, const Color& color,
+                                 uint32_t font_size, float max_size, bool right_justified,
+                                 Vec2* out_text_pos, Vec2* out_text_size) {
+  if (!font_size) return;
+  ftgl::vec2 pen;
+  ToScreenSpace(x, y, pen.x, pen.y);
 
   if (right_justified) {
     max_size = FLT_MAX;
     int string_width = GetStringWidthScreenSpace(text, font_size);
-    pen_.x -= string_width;
+    pen.x -= string_width;
   }
 
   ftgl::vec2 out_screen_pos;
   ftgl::vec2 out_screen_size;
-  AddTextInternal(GetFont(font_size), text, ColorToVec4(color), &pen_, max_size, z, &out_screen_pos,
+  AddTextInternal(GetFont(font_size), text, ColorToVec4(color), &pen, max_size, z, &out_screen_pos,
                   &out_screen_size);
 
   if (out_text_pos) {
@@ -314,9 +356,13 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
                                                     const Color& color,
                                                     size_t trailing_chars_length,
                                                     uint32_t font_size, float max_size) {
-  if (!initialized_) {
-    Init();
-  }
+  static const char* kEllipsisText = "... ";
+  static const size_t kEllipsisTextLen = strlen(kEllipsisText);
+  static const size_t kLeadingCharsCount = 1;
+  static const size_t kEllipsisBufferSize = kEllipsisTextLen + kLeadingCharsCount;
+
+  ftgl::texture_font_t* font = GetFontWithGlyphs(font_size, {text, kEllipsisText});
+  absl::ReaderMutexLock lock(&mutex_);
 
   float temp_pen_x = ToScreenSpace(x);
   float max_width = max_size == -1.f ? FLT_MAX : ToScreenSpace(max_size);
@@ -325,10 +371,9 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
   int max_x = -INT_MAX;
 
   const size_t text_length = strlen(text);
-  ftgl::texture_font_t* font = GetFont(font_size);
   size_t i;
   for (i = 0; i < text_length; ++i) {
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+    ftgl::texture_glyph_t* glyph = GetLoadedGlyph(font, text + i);
     if (glyph != nullptr) {
       float kerning = 0.0f;
       if (i > 0) {
@@ -355,17 +400,12 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
 
   auto fitting_chars_count = i;
 
-  static const char* kEllipsisText = "... ";
-  static const size_t kEllipsisTextLen = strlen(kEllipsisText);
-  static const size_t kLeadingCharsCount = 1;
-  static const size_t kEllipsisBufferSize = kEllipsisTextLen + kLeadingCharsCount;
-
   bool use_ellipsis_text = (fitting_chars_count < text_length) &&
                            (fitting_chars_count > (trailing_chars_length + kEllipsisBufferSize));
 
   if (!use_ellipsis_text) {
-    AddText(text, x, y, z, color, font_size, max_size);
-    return GetStringWidth(text, font_size);
+    AddTextLocked(text, x, y, z, color, font_size, max_size);
+    return GetStringWidthLocked(text, font_size);
   }
 
   auto leading_char_count = fitting_chars_count - (trailing_chars_length + kEllipsisTextLen);
@@ -376,15 +416,23 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
   auto time_position = text_length - trailing_chars_length;
   modified_text.append(&text[time_position], trailing_chars_length);
 
-  AddText(modified_text.c_str(), x, y, z, color, font_size, max_size);
-  return GetStringWidth(modified_text.c_str(), font_size);
+  AddTextLocked(modified_text.c_str(), x, y, z, color, font_size, max_size);
+  return GetStringWidthLocked(modified_text.c_str(), font_size);
 }
 
 float TextRenderer::GetStringWidth(const char* text, uint32_t font_size) {
+  (void)GetFontWithGlyphs(font_size, {text});
+  absl::ReaderMutexLock lock(&mutex_);
+  return GetStringWidthLocked(text, font_size);
+}
+
+float TextRenderer::GetStringWidthLocked(const char* text, uint32_t font_size) {
   return viewport_->ScreenToWorldWidth(GetStringWidthScreenSpace(text, font_size));
 }
 
 float TextRenderer::GetStringHeight(const char* text, uint32_t font_size) {
+  (void)GetFontWithGlyphs(font_size, {text});
+  absl::ReaderMutexLock lock(&mutex_);
   return viewport_->ScreenToWorldHeight(GetStringHeightScreenSpace(text, font_size));
 }
 
@@ -394,7 +442,7 @@ int TextRenderer::GetStringWidthScreenSpace(const char* text, uint32_t font_size
   std::size_t len = strlen(text);
   for (std::size_t i = 0; i < len; ++i) {
     ftgl::texture_font_t* font = GetFont(font_size);
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+    ftgl::texture_glyph_t* glyph = GetLoadedGlyph(font, text + i);
     if (glyph != nullptr) {
       float kerning = 0.0f;
       if (i > 0) {
@@ -416,7 +464,7 @@ int TextRenderer::GetStringHeightScreenSpace(const char* text, uint32_t font_siz
   int max_height = 0.f;
   ftgl::texture_font_t* font = GetFont(font_size);
   for (std::size_t i = 0; i < strlen(text); ++i) {
-    ftgl::texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+    ftgl::texture_glyph_t* glyph = GetLoadedGlyph(font, text + i);
     if (glyph != nullptr) {
       max_height = std::max(max_height, glyph->offset_y);
     }
@@ -450,9 +498,56 @@ float TextRenderer::ToScreenSpace(float width) {
 }
 
 void TextRenderer::Clear() {
-  pen_.x = 0.f;
-  pen_.y = 0.f;
   for (auto& [unused_layer, buffer] : vertex_buffers_by_layer_) {
     vertex_buffer_clear(buffer);
   }
+  for (VertexBuffersByLayer& parallel_vertex_buffers : parallel_vertex_buffers_) {
+    for (auto& [unused_layer, buffer] : parallel_vertex_buffers) {
+      vertex_buffer_clear(buffer);
+    }
+  }
+}
+
+thread_local TextRenderer* TextRenderer::parallel_text_renderer_ = nullptr;
+thread_local TextRenderer::VertexBuffersByLayer* TextRenderer::parallel_vertex_buffers_of_thread_ =
+    nullptr;
+
+TextRenderer::VertexBuffersByLayer& TextRenderer::GetVertexBuffersOfCallingThread() {
+  if (parallel_text_renderer_ == this) return *parallel_vertex_buffers_of_thread_;
+  return vertex_buffers_by_layer_;
+}
+
+void TextRenderer::SetParallelTextBufferCount(size_t count) {
+  if (parallel_vertex_buffers_.size() < count) parallel_vertex_buffers_.resize(count);
+}
+
+TextRenderer::ScopedParallelTextBuffer::ScopedParallelTextBuffer(TextRenderer* text_renderer,
+                                                                 size_t index) {
+  CHECK(parallel_text_renderer_ == nullptr);
+  CHECK(index < text_renderer->parallel_vertex_buffers_.size());
+  parallel_text_renderer_ = text_renderer;
+  parallel_vertex_buffers_of_thread_ = &text_renderer->parallel_vertex_buffers_[index];
+}
+
+TextRenderer::ScopedParallelTextBuffer::~ScopedParallelTextBuffer() {
+  parallel_text_renderer_ = nullptr;
+  parallel_vertex_buffers_of_thread_ = nullptr;
+}
+
+void TextRenderer::MergeParallelTextBuffers() {
+  ORBIT_SCOPE_FUNCTION;
+  for (VertexBuffersByLayer& parallel_vertex_buffers : parallel_vertex_buffers_) {
+    for (auto& [layer, buffer] : parallel_vertex_buffers) {
+      if (buffer->vertices->size == 0) continue;
+      ftgl::vertex_buffer_t*& merged_buffer = vertex_buffers_by_layer_[layer];
+      if (merged_buffer == nullptr) {
+        merged_buffer = ftgl::vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
+      }
+      // The indices are relative to the vertices of `buffer`, vertex_buffer_push_back offsets them.
+      vertex_buffer_push_back(merged_buffer, buffer->vertices->items, buffer->vertices->size,
+                              static_cast<const GLuint*>(buffer->indices->items),
+                              buffer->indices->size);
+      vertex_buffer_clear(buffer);
+    }
+  }
 }
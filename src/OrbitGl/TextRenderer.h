@@ -6,6 +6,8 @@
 #define ORBIT_GL_TEXT_RENDERER_H_
 
 #include <GteVector.h>
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 #include <freetype-gl/mat4.h>
 #include <freetype-gl/texture-atlas.h>
 #include <freetype-gl/texture-font.h>
@@ -14,6 +16,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <initializer_list>
 #include <map>
 #include <unordered_map>
 #include <vector>
@@ -28,8 +31,23 @@ struct vertex_buffer_t;
 struct texture_font_t;
 }  // namespace ftgl
 
+// The methods adding text and measuring strings can be called concurrently, e.g. by tracks updating
+// their primitives in parallel. Init, rendering and clearing happen on the thread owning the GL
+// context, while no text is added.
 class TextRenderer {
  public:
+  // While it exists, the text the calling thread adds goes to the parallel text buffer `index`
+  // instead of the buffers that are rendered, so that threads adding text at the same time don't
+  // contend for them. MergeParallelTextBuffers then appends the parallel text buffers in the order
+  // of their index.
+  class ScopedParallelTextBuffer {
+   public:
+    ScopedParallelTextBuffer(TextRenderer* text_renderer, size_t index);
+    ScopedParallelTextBuffer(const ScopedParallelTextBuffer&) = delete;
+    ScopedParallelTextBuffer& operator=(const ScopedParallelTextBuffer&) = delete;
+    ~ScopedParallelTextBuffer();
+  };
+
   explicit TextRenderer();
   ~TextRenderer();
 
@@ -54,6 +72,10 @@ class TextRenderer {
 
   static void SetDrawOutline(bool value) { draw_outline_ = value; }
 
+  // Has to be called before the threads adding text to parallel text buffers start.
+  void SetParallelTextBufferCount(size_t count);
+  void MergeParallelTextBuffers();
+
  protected:
   void AddTextInternal(ftgl::texture_font_t* font, const char* text, const ftgl::vec4& color,
                        ftgl::vec2* pen, float max_size = -1.f, float z = -0.01f,
@@ -64,25 +86,43 @@ class TextRenderer {
   [[nodiscard]] int GetStringWidthScreenSpace(const char* text, uint32_t font_size);
   [[nodiscard]] int GetStringHeightScreenSpace(const char* text, uint32_t font_size);
   [[nodiscard]] ftgl::texture_font_t* GetFont(uint32_t size);
-  [[nodiscard]] ftgl::texture_glyph_t* MaybeLoadAndGetGlyph(ftgl::texture_font_t* self,
-                                                            const char* character);
+  [[nodiscard]] ftgl::texture_font_t* GetFontWithGlyphs(uint32_t font_size,
+                                                        std::initializer_list<const char*> texts)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  [[nodiscard]] ftgl::texture_glyph_t* GetLoadedGlyph(ftgl::texture_font_t* font,
+                                                      const char* character);
 
   void DrawOutline(Batcher* batcher, ftgl::vertex_buffer_t* buffer);
 
  private:
+  using VertexBuffersByLayer = std::unordered_map<float, ftgl::vertex_buffer_t*>;
+
+  void AddTextLocked(const char* text, float x, float y, float z, const Color& color,
+                     uint32_t font_size, float max_size = -1.f, bool right_justified = false,
+                     Vec2* out_text_pos = nullptr, Vec2* out_text_size = nullptr)
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] float GetStringWidthLocked(const char* text, uint32_t font_size)
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] VertexBuffersByLayer& GetVertexBuffersOfCallingThread();
+
+  // Held exclusively to load glyphs into the fonts and the texture atlas, and shared to use them.
+  absl::Mutex mutex_;
   ftgl::texture_atlas_t* texture_atlas_;
   // Indicates when a change to the texture atlas occurred so that we have to reupload the
   // texture data. Only freetype-gl's texture_font_load_glyph modifies the texture atlas,
   // so we need to set this to true when and only when we call that function.
   bool texture_atlas_changed_;
-  std::unordered_map<float, ftgl::vertex_buffer_t*> vertex_buffers_by_layer_;
+  VertexBuffersByLayer vertex_buffers_by_layer_;
+  std::vector<VertexBuffersByLayer> parallel_vertex_buffers_;
+  // Set by ScopedParallelTextBuffer.
+  static thread_local TextRenderer* parallel_text_renderer_;
+  static thread_local VertexBuffersByLayer* parallel_vertex_buffers_of_thread_;
   std::map<uint32_t, ftgl::texture_font_t*> fonts_by_size_;
   orbit_gl::Viewport* viewport_;
   GLuint shader_;
   ftgl::mat4 model_;
   ftgl::mat4 view_;
   ftgl::mat4 projection_;
-  ftgl::vec2 pen_;
   bool initialized_;
   static bool draw_outline_;
 };
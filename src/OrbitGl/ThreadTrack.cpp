@@ -5,12 +5,14 @@
 #include "ThreadTrack.h"
 
 #include <GteVector.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/strings/str_format.h>
 #include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
 
 #include <algorithm>
 #include <atomic>
+#include <iterator>
 #include <optional>
 
 #include "App.h"
@@ -129,8 +131,7 @@ std::string ThreadTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) con
   }
 
   if (is_manual) {
-    auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
-    function_name = api_event.name;
+    function_name = time_graph_->GetManualInstrumentationName(timer_info);
   } else {
     function_name = func->function_name();
   }
@@ -152,9 +153,23 @@ std::string ThreadTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) con
 }
 
 bool ThreadTrack::IsTimerActive(const TimerInfo& timer_info) const {
-  return timer_info.type() == TimerInfo::kIntrospection ||
-         timer_info.type() == TimerInfo::kApiEvent ||
-         app_->IsFunctionVisible(timer_info.function_id());
+  if (timer_info.type() == TimerInfo::kIntrospection ||
+      timer_info.type() == TimerInfo::kApiEvent) {
+    return true;
+  }
+
+  const absl::flat_hash_set<uint64_t>* visible_function_ids =
+      time_graph_->GetTrackSelection().visible_function_ids;
+  if (visible_function_ids != nullptr && visible_function_ids->contains(timer_info.function_id())) {
+    return true;
+  }
+
+  // TODO(b/179225487): Filtering for manually instrumented scopes is not yet supported.
+  // All "Orbit" functions are considered visible.
+  const InstrumentedFunction* function =
+      capture_data_->GetInstrumentedFunctionById(timer_info.function_id());
+  return function != nullptr &&
+         orbit_client_data::function_utils::IsOrbitFunctionFromName(function->function_name());
 }
 
 bool ThreadTrack::IsTrackSelected() const {
@@ -214,7 +229,8 @@ Color ThreadTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
   }
 
   uint64_t function_id = timer_info.function_id();
-  const InstrumentedFunction* instrumented_function = app_->GetInstrumentedFunction(function_id);
+  const InstrumentedFunction* instrumented_function =
+      capture_data_->GetInstrumentedFunctionById(function_id);
   CHECK(instrumented_function != nullptr || timer_info.type() == TimerInfo::kIntrospection ||
         timer_info.type() == TimerInfo::kApiEvent);
   std::optional<Color> user_color = GetUserColor(timer_info, instrumented_function);
@@ -338,7 +354,8 @@ void ThreadTrack::SetTimesliceText(const TimerInfo& timer_info, float min_x, flo
         absl::Nanoseconds(timer_info.end() - timer_info.start()));
     text_box->SetElapsedTimeTextLength(time.length());
 
-    const InstrumentedFunction* func = app_->GetInstrumentedFunction(timer_info.function_id());
+    const InstrumentedFunction* func =
+        capture_data_->GetInstrumentedFunctionById(timer_info.function_id());
     if (func != nullptr) {
       std::string extra_info = GetExtraInfo(timer_info);
       std::string name;
@@ -357,10 +374,9 @@ void ThreadTrack::SetTimesliceText(const TimerInfo& timer_info, float min_x, flo
       std::string text = absl::StrFormat("%s %s", api_event.name, time.c_str());
       text_box->SetText(text);
     } else if (timer_info.type() == TimerInfo::kApiEvent) {
-      auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
+      std::string name = time_graph_->GetManualInstrumentationName(timer_info);
       std::string extra_info = GetExtraInfo(timer_info);
-      std::string text =
-          absl::StrFormat("%s %s %s", api_event.name, extra_info.c_str(), time.c_str());
+      std::string text = absl::StrFormat("%s %s %s", name, extra_info.c_str(), time.c_str());
       text_box->SetText(text);
     } else {
       ERROR(
@@ -509,9 +525,11 @@ void ThreadTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
   UpdatePrimitivesOfSubtracks(batcher, min_tick, max_tick, picking_mode, z_offset);
   UpdateBoxHeight();
 
-  const internal::DrawData draw_data = GetDrawData(
-      min_tick, max_tick, z_offset, batcher, time_graph_, viewport_,
-      collapse_toggle_->IsCollapsed(), app_->selected_text_box(), app_->GetFunctionIdToHighlight());
+  const TimeGraph::TrackSelection& selection = time_graph_->GetTrackSelection();
+  const internal::DrawData draw_data =
+      GetDrawData(min_tick, max_tick, z_offset, batcher, time_graph_, viewport_,
+                  collapse_toggle_->IsCollapsed(), selection.selected_text_box,
+                  selection.function_id_to_highlight);
 
   absl::MutexLock lock(&scope_tree_mutex_);
 
@@ -523,9 +541,13 @@ void ThreadTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
     float world_timer_y = GetYFromDepth(depth - 1);
     uint64_t next_pixel_start_time_ns = min_tick;
 
-    for (auto it = first_node_to_draw; it != ordered_nodes.end() && it->first < max_tick; ++it) {
+    auto it = first_node_to_draw;
+    while (it != ordered_nodes.end() && it->first < max_tick) {
       orbit_client_data::TextBox& text_box = *it->second->GetScope();
-      if (text_box.End() <= next_pixel_start_time_ns) continue;
+      if (text_box.End() <= next_pixel_start_time_ns) {
+        ++it;
+        continue;
+      }
       ++visible_timer_count_;
 
       Color color = GetTimerColor(text_box, draw_data);
@@ -548,6 +570,14 @@ void ThreadTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
 
       // Use the time at boundary of the next pixel as a threshold to avoid overdraw.
       next_pixel_start_time_ns = GetNextPixelBoundaryTimeNs(pos.first + size.first, draw_data);
+
+      // Nodes of the same depth don't overlap, so of the nodes starting before the next pixel
+      // boundary, only the last one can be visible. Seek to it instead of iterating over all the
+      // nodes in between, so that the cost depends on the number of pixels rather than on the
+      // number of timers when zoomed out.
+      auto next_it = ordered_nodes.lower_bound(std::max(next_pixel_start_time_ns, it->first + 1));
+      if (next_it != ordered_nodes.begin() && std::prev(next_it)->first > it->first) --next_it;
+      it = next_it;
     }
   }
 }
@@ -67,7 +67,8 @@ TimeGraph::TimeGraph(AccessibleInterfaceProvider* parent, OrbitApp* app,
     : orbit_gl::CaptureViewElement(nullptr, this, viewport, &layout_),
       accessible_parent_{parent},
       batcher_(BatcherId::kTimeGraph),
-      manual_instrumentation_manager_{app->GetManualInstrumentationManager()},
+      manual_instrumentation_manager_{app != nullptr ? app->GetManualInstrumentationManager()
+                                                     : nullptr},
       capture_data_{capture_data},
       app_{app} {
   text_renderer_static_.SetViewport(viewport);
@@ -80,11 +81,16 @@ TimeGraph::TimeGraph(AccessibleInterfaceProvider* parent, OrbitApp* app,
           [this](const std::string& name, const TimerInfo& timer_info) {
             ProcessAsyncTimer(name, timer_info);
           });
-  manual_instrumentation_manager_->AddAsyncTimerListener(async_timer_info_listener_.get());
+  // `app` is null in tests.
+  if (manual_instrumentation_manager_ != nullptr) {
+    manual_instrumentation_manager_->AddAsyncTimerListener(async_timer_info_listener_.get());
+  }
 }
 
 TimeGraph::~TimeGraph() {
-  manual_instrumentation_manager_->RemoveAsyncTimerListener(async_timer_info_listener_.get());
+  if (manual_instrumentation_manager_ != nullptr) {
+    manual_instrumentation_manager_->RemoveAsyncTimerListener(async_timer_info_listener_.get());
+  }
 }
 
 void TimeGraph::UpdateCaptureMinMaxTimestamps() {
@@ -347,6 +353,15 @@ void TimeGraph::ProcessOrbitFunctionTimer(FunctionInfo::OrbitType type,
   }
 }
 
+std::string TimeGraph::GetManualInstrumentationName(const TimerInfo& timer_info) const {
+  if (timer_info.type() == TimerInfo::kApiEvent && timer_info.user_data_key() != 0 &&
+      app_ != nullptr) {
+    std::optional<std::string> name = app_->GetStringManager()->Get(timer_info.user_data_key());
+    if (name.has_value()) return std::move(name.value());
+  }
+  return ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info).name;
+}
+
 void TimeGraph::ProcessApiEventTimer(const TimerInfo& timer_info) {
   orbit_api::Event api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
   switch (api_event.type) {
@@ -358,7 +373,8 @@ void TimeGraph::ProcessApiEventTimer(const TimerInfo& timer_info) {
     }
     case orbit_api::kScopeStartAsync:
     case orbit_api::kScopeStopAsync:
-      manual_instrumentation_manager_->ProcessAsyncTimer(timer_info);
+      manual_instrumentation_manager_->ProcessAsyncTimer(GetManualInstrumentationName(timer_info),
+                                                         timer_info);
       break;
 
     case orbit_api::kTrackInt:
@@ -385,7 +401,7 @@ void TimeGraph::ProcessIntrospectionTimer(const TimerInfo& timer_info) {
     } break;
     case orbit_api::kScopeStartAsync:
     case orbit_api::kScopeStopAsync:
-      manual_instrumentation_manager_->ProcessAsyncTimer(timer_info);
+      manual_instrumentation_manager_->ProcessAsyncTimer(event.name, timer_info);
       break;
     case orbit_api::kTrackInt:
     case orbit_api::kTrackInt64:
@@ -409,7 +425,8 @@ void TimeGraph::ProcessValueTrackingTimer(const TimerInfo& timer_info) {
     return;
   }
 
-  VariableTrack* track = track_manager_->GetOrCreateVariableTrack(event.name);
+  VariableTrack* track =
+      track_manager_->GetOrCreateVariableTrack(GetManualInstrumentationName(timer_info));
   uint64_t time = timer_info.start();
 
   switch (event.type) {
@@ -547,10 +564,11 @@ const orbit_client_data::TextBox* TimeGraph::FindPreviousFunctionCall(
       GetAllThreadTrackTimerChains();
   for (auto& chain : chains) {
     if (!chain) continue;
-    for (const auto& block : *chain) {
-      if (!block.Intersects(previous_box_time, current_time)) continue;
-      for (uint64_t i = 0; i < block.size(); i++) {
-        const orbit_client_data::TextBox& box = block[i];
+    for (const orbit_client_data::TimerBlock* block :
+         chain->GetBlocksIntersecting(previous_box_time, current_time)) {
+      if (!block->Intersects(previous_box_time, current_time)) continue;
+      for (uint64_t i = 0; i < block->size(); i++) {
+        const orbit_client_data::TextBox& box = (*block)[i];
         auto box_time = box.GetTimerInfo().end();
         if ((box.GetTimerInfo().function_id() == function_id) &&
             (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
@@ -572,10 +590,11 @@ const orbit_client_data::TextBox* TimeGraph::FindNextFunctionCall(
       GetAllThreadTrackTimerChains();
   for (auto& chain : chains) {
     if (!chain) continue;
-    for (const auto& block : *chain) {
-      if (!block.Intersects(current_time, next_box_time)) continue;
-      for (uint64_t i = 0; i < block.size(); i++) {
-        const orbit_client_data::TextBox& box = block[i];
+    for (const orbit_client_data::TimerBlock* block :
+         chain->GetBlocksIntersecting(current_time, next_box_time)) {
+      if (!block->Intersects(current_time, next_box_time)) continue;
+      for (uint64_t i = 0; i < block->size(); i++) {
+        const orbit_client_data::TextBox& box = (*block)[i];
         auto box_time = box.GetTimerInfo().end();
         if ((box.GetTimerInfo().function_id() == function_id) &&
             (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
@@ -601,6 +620,9 @@ void TimeGraph::UpdatePrimitives(Batcher* /*batcher*/, uint64_t /*min_tick*/, ui
   CHECK(app_->GetStringManager() != nullptr);
 
   batcher_.StartNewFrame();
+  // Tracks add text while updating their primitives, possibly on other threads, so the text
+  // renderer has to be initialized on this one, which owns the GL context.
+  text_renderer_static_.Init();
   text_renderer_static_.Clear();
 
   capture_min_timestamp_ =
@@ -614,10 +636,17 @@ void TimeGraph::UpdatePrimitives(Batcher* /*batcher*/, uint64_t /*min_tick*/, ui
   uint64_t min_tick = GetTickFromUs(min_time_us_);
   uint64_t max_tick = GetTickFromUs(max_time_us_);
 
+  track_selection_.selected_text_box = app_->selected_text_box();
+  track_selection_.function_id_to_highlight = app_->GetFunctionIdToHighlight();
+  track_selection_.selected_thread_id = app_->selected_thread_id();
+  track_selection_.visible_function_ids = &app_->GetVisibleFunctionIds();
+
   track_manager_->UpdateTracksForRendering();
-  track_manager_->UpdateTrackPrimitives(&batcher_, min_tick, max_tick, picking_mode);
+  const bool tracks_positioned =
+      track_manager_->UpdateTrackPrimitives(&batcher_, min_tick, max_tick, picking_mode);
 
   update_primitives_requested_ = false;
+  if (!tracks_positioned) RequestUpdate();
 }
 
 void TimeGraph::SelectCallstacks(float world_start, float world_end, int32_t thread_id) {
@@ -646,8 +675,12 @@ void TimeGraph::SelectCallstacks(float world_start, float world_end, int32_t thr
   RequestUpdate();
 }
 
-const std::vector<CallstackEvent>& TimeGraph::GetSelectedCallstackEvents(int32_t tid) {
-  return selected_callstack_events_per_thread_[tid];
+const std::vector<CallstackEvent>& TimeGraph::GetSelectedCallstackEvents(int32_t tid) const {
+  // Called by tracks updating their primitives in parallel: don't insert into the map.
+  static const std::vector<CallstackEvent> kNoCallstackEvents;
+  auto it = selected_callstack_events_per_thread_.find(tid);
+  if (it == selected_callstack_events_per_thread_.end()) return kNoCallstackEvents;
+  return it->second;
 }
 
 void TimeGraph::Draw(Batcher& batcher, TextRenderer& text_renderer, uint64_t current_mouse_time_ns,
@@ -6,6 +6,7 @@
 #define ORBIT_GL_TIME_GRAPH_H_
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 
 #include <cstdint>
 #include <map>
@@ -23,8 +24,10 @@
 #include "ClientData/TimerChain.h"
 #include "ClientModel/CaptureData.h"
 #include "CoreMath.h"
+#include "GrpcProtos/Constants.h"
 #include "ManualInstrumentationManager.h"
 #include "OrbitAccessibility/AccessibleInterface.h"
+#include "OrbitBase/ThreadConstants.h"
 #include "PickingManager.h"
 #include "TextRenderer.h"
 #include "TimeGraphLayout.h"
@@ -59,7 +62,25 @@ class TimeGraph : public orbit_gl::CaptureViewElement {
   void UpdatePrimitives(Batcher* /*batcher*/, uint64_t /*min_tick*/, uint64_t /*max_tick*/,
                         PickingMode /*picking_mode*/, float /*z_offset*/ = 0) override;
   void SelectCallstacks(float world_start, float world_end, int32_t thread_id);
-  const std::vector<orbit_client_protos::CallstackEvent>& GetSelectedCallstackEvents(int32_t tid);
+  const std::vector<orbit_client_protos::CallstackEvent>& GetSelectedCallstackEvents(
+      int32_t tid) const;
+
+  // What tracks need to know about the user's selection to update their primitives. It is read
+  // from OrbitApp at the start of UpdatePrimitives, on the main thread, as the tracks then update
+  // their primitives on several threads and OrbitApp must only be accessed from the main thread.
+  struct TrackSelection {
+    const orbit_client_data::TextBox* selected_text_box = nullptr;
+    uint64_t function_id_to_highlight = orbit_grpc_protos::kInvalidFunctionId;
+    int32_t selected_thread_id = orbit_base::kAllProcessThreadsTid;
+    // Owned by OrbitApp, which doesn't modify it while the primitives are updated.
+    const absl::flat_hash_set<uint64_t>* visible_function_ids = nullptr;
+  };
+  [[nodiscard]] const TrackSelection& GetTrackSelection() const { return track_selection_; }
+
+  // Returns the name of a manual instrumentation timer. Unlike the name encoded in the registers of
+  // the timer, the names the Orbit API interned are not truncated.
+  [[nodiscard]] std::string GetManualInstrumentationName(
+      const orbit_client_protos::TimerInfo& timer_info) const;
 
   void ProcessTimer(const orbit_client_protos::TimerInfo& timer_info,
                     const orbit_grpc_protos::InstrumentedFunction* function);
@@ -234,6 +255,7 @@ class TimeGraph : public orbit_gl::CaptureViewElement {
 
   absl::flat_hash_map<int32_t, std::vector<orbit_client_protos::CallstackEvent>>
       selected_callstack_events_per_thread_;
+  TrackSelection track_selection_;
 
   ManualInstrumentationManager* manual_instrumentation_manager_;
   std::unique_ptr<ManualInstrumentationManager::AsyncTimerInfoListener> async_timer_info_listener_;
@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <memory>
 #include <utility>
 
 #include "App.h"
@@ -259,9 +260,10 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
 
   draw_data.z = GlCanvas::kZValueBox + z_offset;
 
-  std::vector<std::shared_ptr<orbit_client_data::TimerChain>> chains_by_depth = GetTimers();
-  draw_data.selected_textbox = app_->selected_text_box();
-  draw_data.highlighted_function_id = app_->GetFunctionIdToHighlight();
+  std::vector<TimersAndSummary> timers_by_depth = GetTimersAndSummaries();
+  const TimeGraph::TrackSelection& selection = time_graph_->GetTrackSelection();
+  draw_data.selected_textbox = selection.selected_text_box;
+  draw_data.highlighted_function_id = selection.function_id_to_highlight;
 
   // We minimize overdraw when drawing lines for small events by discarding
   // events that would just draw over an already drawn line. When zoomed in
@@ -271,7 +273,7 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
   draw_data.ns_per_pixel = time_window_ns / viewport_->GetScreenWidth();
   draw_data.min_timegraph_tick = time_graph_->GetTickFromUs(time_graph_->GetMinTimeUs());
 
-  for (auto& chain : chains_by_depth) {
+  for (auto& [chain, summary] : timers_by_depth) {
     if (!chain) continue;
     // In order to draw overlaps correctly, we need for every text box to be drawn (current),
     // its previous and next text box. In order to avoid looking ahead for the next text (which is
@@ -287,21 +289,30 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
     // would miss drawing events that should be drawn.
     uint64_t min_ignore = std::numeric_limits<uint64_t>::max();
     uint64_t max_ignore = std::numeric_limits<uint64_t>::min();
-    for (orbit_client_data::TimerBlock& block : *chain) {
-      if (!block.Intersects(min_tick, max_tick)) continue;
-
-      for (size_t k = 0; k < block.size(); ++k) {
-        // The current index (k) points to the "next" text box and we want to draw the text box
-        // from the previous iteration ("current").
-        next_text_box = &block[k];
+    auto draw_next_text_box = [&](orbit_client_data::TextBox* text_box) {
+      // The new text box is the "next" text box and we want to draw the text box from the previous
+      // iteration ("current").
+      next_text_box = text_box;
+
+      if (DrawTimer(prev_text_box, next_text_box, draw_data, current_text_box, &min_ignore,
+                    &max_ignore)) {
+        ++visible_timer_count_;
+      }
 
-        if (DrawTimer(prev_text_box, next_text_box, draw_data, current_text_box, &min_ignore,
-                      &max_ignore)) {
-          ++visible_timer_count_;
+      prev_text_box = current_text_box;
+      current_text_box = next_text_box;
+    };
+
+    // When zoomed out, only visit the longest timer starting in each pixel instead of all timers.
+    const bool drawn_from_summary =
+        summary != nullptr && summary->ForEachLongestTimerPerBucket(
+                                  draw_data.ns_per_pixel, min_tick, max_tick, draw_next_text_box);
+    if (!drawn_from_summary) {
+      for (orbit_client_data::TimerBlock* block :
+           chain->GetBlocksIntersecting(min_tick, max_tick)) {
+        for (size_t k = 0; k < block->size(); ++k) {
+          draw_next_text_box(&(*block)[k]);
         }
-
-        prev_text_box = current_text_box;
-        current_text_box = next_text_box;
       }
     }
 
@@ -329,7 +340,20 @@ void TimerTrack::OnTimer(const TimerInfo& timer_info) {
     timers_[timer_info.depth()] = timer_chain;
   }
 
-  timer_chain->emplace_back(timer_info);
+  orbit_client_data::TextBox& text_box = timer_chain->emplace_back(timer_info);
+  if (CanDrawTimerSummaries()) {
+    orbit_client_data::TimerSummary* summary = nullptr;
+    {
+      absl::MutexLock lock(&mutex_);
+      std::unique_ptr<orbit_client_data::TimerSummary>& summary_ptr =
+          timer_summaries_[timer_info.depth()];
+      if (summary_ptr == nullptr) {
+        summary_ptr = std::make_unique<orbit_client_data::TimerSummary>();
+      }
+      summary = summary_ptr.get();
+    }
+    summary->Add(&text_box);
+  }
 
   ++num_timers_;
   if (timer_info.start() < min_time_) min_time_ = timer_info.start();
@@ -363,16 +387,7 @@ const orbit_client_data::TextBox* TimerTrack::GetFirstAfterTime(uint64_t time,
   std::shared_ptr<orbit_client_data::TimerChain> chain = GetTimers(depth);
   if (chain == nullptr) return nullptr;
 
-  // TODO: do better than linear search...
-  for (orbit_client_data::TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
-    for (size_t k = 0; k < it->size(); ++k) {
-      const orbit_client_data::TextBox& text_box = (*it)[k];
-      if (text_box.GetTimerInfo().start() > time) {
-        return &text_box;
-      }
-    }
-  }
-  return nullptr;
+  return chain->FindFirstStartingAfter(time);
 }
 
 const orbit_client_data::TextBox* TimerTrack::GetFirstBeforeTime(uint64_t time,
@@ -380,20 +395,21 @@ const orbit_client_data::TextBox* TimerTrack::GetFirstBeforeTime(uint64_t time,
   std::shared_ptr<orbit_client_data::TimerChain> chain = GetTimers(depth);
   if (chain == nullptr) return nullptr;
 
-  const orbit_client_data::TextBox* text_box = nullptr;
+  const orbit_client_data::TextBox* first_after_time = chain->FindFirstStartingAfter(time);
+  if (first_after_time == nullptr) return nullptr;
 
-  // TODO: do better than linear search...
-  for (orbit_client_data::TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
-    for (size_t k = 0; k < it->size(); ++k) {
-      const orbit_client_data::TextBox& box = (*it)[k];
-      if (box.GetTimerInfo().start() > time) {
-        return text_box;
-      }
-      text_box = &box;
-    }
-  }
+  return chain->GetElementBefore(first_after_time);
+}
 
-  return nullptr;
+std::vector<TimerTrack::TimersAndSummary> TimerTrack::GetTimersAndSummaries() const {
+  std::vector<TimersAndSummary> timers_and_summaries;
+  absl::MutexLock lock(&mutex_);
+  for (const auto& [depth, chain] : timers_) {
+    auto summary_it = timer_summaries_.find(depth);
+    timers_and_summaries.push_back(
+        {chain, summary_it != timer_summaries_.end() ? summary_it->second.get() : nullptr});
+  }
+  return timers_and_summaries;
 }
 
 std::shared_ptr<orbit_client_data::TimerChain> TimerTrack::GetTimers(uint32_t depth) const {
@@ -428,10 +444,10 @@ std::vector<const orbit_client_data::TextBox*> TimerTrack::GetScopesInRange(uint
   std::vector<const orbit_client_data::TextBox*> result;
   for (auto chain : GetAllChains()) {
     if (chain == nullptr) continue;
-    for (const auto& block : *chain) {
-      if (!block.Intersects(start_ns, end_ns)) continue;
-      for (uint64_t i = 0; i < block.size(); ++i) {
-        const orbit_client_data::TextBox& box = block[i];
+    for (const orbit_client_data::TimerBlock* block :
+         chain->GetBlocksIntersecting(start_ns, end_ns)) {
+      for (uint64_t i = 0; i < block->size(); ++i) {
+        const orbit_client_data::TextBox& box = (*block)[i];
         if (box.GetTimerInfo().start() <= end_ns && box.GetTimerInfo().end() > start_ns) {
           result.push_back(&box);
         }
@@ -19,6 +19,7 @@
 #include "ClientData/CallstackTypes.h"
 #include "ClientData/TextBox.h"
 #include "ClientData/TimerChain.h"
+#include "ClientData/TimerSummary.h"
 #include "CoreMath.h"
 #include "PickingManager.h"
 #include "TextRenderer.h"
@@ -127,6 +128,10 @@ class TimerTrack : public Track {
       const orbit_client_protos::TimerInfo& /*timer_info*/) const {
     return true;
   }
+  // When zoomed out, tracks with a TimerSummary for each depth only draw the longest timer
+  // starting in each pixel. Tracks that filter timers, or that draw the timers of a depth in
+  // different rows, need to visit all timers.
+  [[nodiscard]] virtual bool CanDrawTimerSummaries() const { return true; }
 
   [[nodiscard]] bool DrawTimer(const orbit_client_data::TextBox* prev_text_box,
                                const orbit_client_data::TextBox* next_text_box,
@@ -139,6 +144,13 @@ class TimerTrack : public Track {
   }
   [[nodiscard]] std::shared_ptr<orbit_client_data::TimerChain> GetTimers(uint32_t depth) const;
 
+  struct TimersAndSummary {
+    std::shared_ptr<orbit_client_data::TimerChain> timers;
+    const orbit_client_data::TimerSummary* summary;
+  };
+  // The summary is nullptr if the track doesn't use summaries (see CanDrawTimerSummaries).
+  [[nodiscard]] std::vector<TimersAndSummary> GetTimersAndSummaries() const;
+
   virtual void SetTimesliceText(const orbit_client_protos::TimerInfo& /*timer*/, float /*min_x*/,
                                 float /*z_offset*/, orbit_client_data::TextBox* /*text_box*/) {}
 
@@ -150,6 +162,8 @@ class TimerTrack : public Track {
   TextRenderer* text_renderer_ = nullptr;
   uint32_t depth_ = 0;
   mutable absl::Mutex mutex_;
+  std::map<int, std::unique_ptr<orbit_client_data::TimerSummary>> timer_summaries_
+      ABSL_GUARDED_BY(mutex_);
   int visible_timer_count_ = 0;
 
   [[nodiscard]] virtual std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const;
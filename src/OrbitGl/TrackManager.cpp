@@ -12,6 +12,7 @@
 #include <absl/strings/match.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
+#include <absl/time/time.h>
 #include <stdlib.h>
 
 #include <algorithm>
@@ -28,7 +29,9 @@
 #include "CoreMath.h"
 #include "GlCanvas.h"
 #include "OrbitBase/Append.h"
+#include "OrbitBase/Future.h"
 #include "OrbitBase/ThreadConstants.h"
+#include "TextRenderer.h"
 #include "TimeGraph.h"
 #include "TimeGraphLayout.h"
 #include "Viewport.h"
@@ -43,7 +46,8 @@ ABSL_DECLARE_FLAG(bool, enable_tracepoint_feature);
 
 TrackManager::TrackManager(TimeGraph* time_graph, orbit_gl::Viewport* viewport,
                            TimeGraphLayout* layout, OrbitApp* app,
-                           const orbit_client_model::CaptureData* capture_data)
+                           const orbit_client_model::CaptureData* capture_data,
+                           uint32_t update_thread_count)
     : time_graph_(time_graph),
       viewport_(viewport),
       layout_(layout),
@@ -52,6 +56,19 @@ TrackManager::TrackManager(TimeGraph* time_graph, orbit_gl::Viewport* viewport,
   for (auto& type : Track::kAllTrackTypes) {
     track_type_visibility_[type] = true;
   }
+
+  if (update_thread_count > 1) {
+    thread_pool_size_ = update_thread_count - 1;
+    thread_pool_ = ThreadPool::Create(/*thread_pool_min_size=*/1,
+                                      /*thread_pool_max_size=*/thread_pool_size_,
+                                      /*thread_ttl=*/absl::Seconds(1));
+  }
+}
+
+TrackManager::~TrackManager() {
+  if (thread_pool_ != nullptr) {
+    thread_pool_->ShutdownAndWait();
+  }
 }
 
 std::vector<Track*> TrackManager::GetAllTracks() const {
@@ -298,19 +315,30 @@ int TrackManager::FindMovingTrackIndex() {
   return -1;
 }
 
-void TrackManager::UpdateTrackPrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+bool TrackManager::UpdateTrackPrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                          PickingMode picking_mode) {
   // Make sure track tab fits in the viewport.
   float current_y = -layout_->GetSchedulerTrackOffset();
 
-  // Draw tracks
+  // Position the tracks first, as their primitives can be updated in parallel.
+  std::vector<float> track_heights;
+  track_heights.reserve(visible_tracks_.size());
   for (auto& track : visible_tracks_) {
-    const float z_offset = track->IsMoving() ? GlCanvas::kZOffsetMovingTrack : 0.f;
     if (!track->IsMoving()) {
       track->SetPos(track->GetPos()[0], current_y);
     }
-    track->UpdatePrimitives(batcher, min_tick, max_tick, picking_mode, z_offset);
-    current_y -= (track->GetHeight() + layout_->GetSpaceBetweenTracks());
+    track_heights.push_back(track->GetHeight());
+    current_y -= (track_heights.back() + layout_->GetSpaceBetweenTracks());
+  }
+
+  UpdateVisibleTrackPrimitives(batcher, min_tick, max_tick, picking_mode);
+
+  bool track_heights_changed = false;
+  current_y = -layout_->GetSchedulerTrackOffset();
+  for (size_t i = 0; i < visible_tracks_.size(); ++i) {
+    const float track_height = visible_tracks_[i]->GetHeight();
+    track_heights_changed |= track_height != track_heights[i];
+    current_y -= (track_height + layout_->GetSpaceBetweenTracks());
   }
 
   // TODO: This margin should be treated in a different way (http://b/192070555).
@@ -318,6 +346,73 @@ void TrackManager::UpdateTrackPrimitives(Batcher* batcher, uint64_t min_tick, ui
 
   // Tracks are drawn from 0 (top) to negative y-coordinates.
   tracks_total_height_ = std::abs(current_y);
+
+  return !track_heights_changed;
+}
+
+void TrackManager::UpdateVisibleTrackPrimitives(Batcher* batcher, uint64_t min_tick,
+                                                uint64_t max_tick, PickingMode picking_mode) {
+  const size_t task_count = std::min(visible_tracks_.size(), thread_pool_size_ + 1);
+  // Each task updates a contiguous range of tracks into its own batcher and text buffer, the first
+  // one directly into `batcher` and the rendered text. Moving the other ones there in the order of
+  // the ranges keeps the order of the primitives, and so their picking ids, the same as when
+  // updating the tracks one after the other.
+  while (parallel_batchers_.size() + 1 < task_count) {
+    parallel_batchers_.push_back(
+        std::make_unique<Batcher>(batcher->GetBatcherId(), batcher->GetPickingManager()));
+  }
+  TextRenderer* text_renderer = time_graph_ != nullptr ? time_graph_->GetTextRenderer() : nullptr;
+  if (text_renderer != nullptr && task_count > 1) {
+    text_renderer->SetParallelTextBufferCount(task_count - 1);
+  }
+
+  auto update_track_range = [&](size_t task_index) {
+    Batcher* task_batcher = batcher;
+    std::optional<TextRenderer::ScopedParallelTextBuffer> text_buffer;
+    if (task_index > 0) {
+      task_batcher = parallel_batchers_[task_index - 1].get();
+      task_batcher->StartNewFrame();
+      if (text_renderer != nullptr) text_buffer.emplace(text_renderer, task_index - 1);
+    }
+    const size_t begin = visible_tracks_.size() * task_index / task_count;
+    const size_t end = visible_tracks_.size() * (task_index + 1) / task_count;
+    for (size_t i = begin; i < end; ++i) {
+      Track* track = visible_tracks_[i];
+      const float z_offset = track->IsMoving() ? GlCanvas::kZOffsetMovingTrack : 0.f;
+      track->UpdatePrimitives(task_batcher, min_tick, max_tick, picking_mode, z_offset);
+    }
+  };
+  RunTasks(task_count, update_track_range);
+
+  // Rewriting the picking ids is the only part of moving the primitives of a batcher that depends
+  // on their number, so it is done in parallel as well. The moves then only relink blocks.
+  std::vector<uint32_t> first_element_ids(task_count);
+  uint32_t next_element_id = batcher->GetNextElementId();
+  for (size_t task_index = 1; task_index < task_count; ++task_index) {
+    first_element_ids[task_index] = next_element_id;
+    next_element_id += parallel_batchers_[task_index - 1]->GetNextElementId();
+  }
+  RunTasks(task_count, [&](size_t task_index) {
+    if (task_index == 0) return;
+    parallel_batchers_[task_index - 1]->SetFirstElementId(first_element_ids[task_index]);
+  });
+
+  for (size_t task_index = 1; task_index < task_count; ++task_index) {
+    batcher->MovePrimitivesFrom(parallel_batchers_[task_index - 1].get());
+  }
+  if (text_renderer != nullptr && task_count > 1) text_renderer->MergeParallelTextBuffers();
+}
+
+void TrackManager::RunTasks(size_t task_count, const std::function<void(size_t)>& task) {
+  std::vector<orbit_base::Future<void>> futures;
+  futures.reserve(task_count);
+  for (size_t task_index = 1; task_index < task_count; ++task_index) {
+    futures.push_back(thread_pool_->Schedule([&task, task_index] { task(task_index); }));
+  }
+  if (task_count > 0) task(0);
+  for (const orbit_base::Future<void>& future : futures) {
+    future.Wait();
+  }
 }
 
 void TrackManager::UpdateTracksForRendering() {
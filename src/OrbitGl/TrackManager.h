@@ -9,17 +9,21 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "AsyncTrack.h"
+#include "Batcher.h"
 #include "CGroupAndProcessMemoryTrack.h"
 #include "FrameTrack.h"
 #include "GpuTrack.h"
 #include "GraphTrack.h"
+#include "OrbitBase/ThreadPool.h"
 #include "PagefaultTrack.h"
 #include "PickingManager.h"
 #include "SchedulerTrack.h"
@@ -39,9 +43,13 @@ class Timegraph;
 // and sorting).
 class TrackManager {
  public:
+  // The primitives of the tracks are updated on `update_thread_count` threads, including the thread
+  // calling UpdateTrackPrimitives.
   explicit TrackManager(TimeGraph* time_graph, orbit_gl::Viewport* viewport,
                         TimeGraphLayout* layout, OrbitApp* app,
-                        const orbit_client_model::CaptureData* capture_data);
+                        const orbit_client_model::CaptureData* capture_data,
+                        uint32_t update_thread_count = std::thread::hardware_concurrency());
+  ~TrackManager();
 
   [[nodiscard]] std::vector<Track*> GetAllTracks() const;
   [[nodiscard]] std::vector<Track*> GetVisibleTracks() const { return visible_tracks_; }
@@ -52,8 +60,11 @@ class TrackManager {
   void SetFilter(const std::string& filter);
 
   void UpdateTracksForRendering();
-  void UpdateTrackPrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
-                             PickingMode picking_mode);
+  // Positions the visible tracks and updates their primitives, in parallel if there are several
+  // cores. Returns false if a track grew while updating its primitives: the tracks below it are
+  // then only moved by the next update.
+  [[nodiscard]] bool UpdateTrackPrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+                                           PickingMode picking_mode);
   [[nodiscard]] float GetTracksTotalHeight() const { return tracks_total_height_; }
 
   [[nodiscard]] uint32_t GetNumTimers() const;
@@ -92,6 +103,11 @@ class TrackManager {
   void SortTracks();
   [[nodiscard]] std::vector<ThreadTrack*> GetSortedThreadTracks();
   void UpdateVisibleTrackList();
+  void UpdateVisibleTrackPrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+                                    PickingMode picking_mode);
+  // Runs `task` with the indices from 0 to `task_count` - 1, the first one on the calling thread
+  // and the other ones on the thread pool, and waits for all of them.
+  void RunTasks(size_t task_count, const std::function<void(size_t)>& task);
 
   void AddTrack(const std::shared_ptr<Track>& track);
   void AddFrameTrack(const std::shared_ptr<FrameTrack>& frame_track);
@@ -127,6 +143,15 @@ class TrackManager {
   std::vector<Track*> visible_tracks_;
 
   float tracks_total_height_ = 0.0f;
+
+  // Null if the primitives are updated on a single thread. The thread calling UpdateTrackPrimitives
+  // takes part in the work, so the pool has one thread less than `update_thread_count`.
+  std::shared_ptr<ThreadPool> thread_pool_;
+  size_t thread_pool_size_ = 0;
+  // Batchers into which ranges of visible tracks update their primitives in parallel, before being
+  // moved to the batcher passed to UpdateTrackPrimitives. Kept across frames to reuse their memory.
+  std::vector<std::unique_ptr<Batcher>> parallel_batchers_;
+
   const orbit_client_model::CaptureData* capture_data_ = nullptr;
 
   OrbitApp* app_ = nullptr;
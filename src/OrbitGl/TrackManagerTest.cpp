@@ -3,12 +3,21 @@
 // found in the LICENSE file.
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Batcher.h"
 #include "ClientData/ModuleManager.h"
 #include "ClientModel/CaptureData.h"
+#include "PickingManager.h"
+#include "PickingManagerTest.h"
 #include "TimeGraph.h"
+#include "TimeGraphLayout.h"
 #include "Track.h"
 #include "TrackManager.h"
 #include "TrackTestData.h"
+#include "Viewport.h"
 #include "capture.pb.h"
 #include "capture_data.pb.h"
 
@@ -124,4 +133,139 @@ TEST_F(TrackManagerTest, TrackTypeVisibilityAffectsVisibleTrackList) {
   EXPECT_EQ(kNumTracks - 1, track_manager_.GetVisibleTracks().size());
 }
 
+// Exposes the primitives added to the batcher, with the picking user data of their picking ids.
+class PrimitivesBatcher : public Batcher {
+ public:
+  explicit PrimitivesBatcher(PickingManager* picking_manager)
+      : Batcher(BatcherId::kTimeGraph, picking_manager) {}
+
+  struct Primitives {
+    size_t line_count = 0;
+    size_t box_count = 0;
+    size_t triangle_count = 0;
+    std::vector<Color> colors;
+    std::vector<PickingType> picking_types;
+    // The element ids of the picking ids of primitives that are not pickables.
+    std::vector<uint32_t> picking_element_ids;
+    // For the picking ids of primitives added with picking user data: whether it is set, and
+    // whether it has a tooltip callback.
+    std::vector<std::pair<bool, bool>> user_data;
+  };
+
+  [[nodiscard]] Primitives GetPrimitives() const {
+    Primitives primitives;
+    std::vector<float> layers = GetLayers();
+    std::sort(layers.begin(), layers.end());
+    for (float layer : layers) {
+      const PrimitiveBuffers& buffers = primitive_buffers_by_layer_.at(layer);
+      primitives.line_count += buffers.line_buffer.lines_.size();
+      primitives.box_count += buffers.box_buffer.boxes_.size();
+      primitives.triangle_count += buffers.triangle_buffer.triangles_.size();
+      AddColors(buffers.line_buffer.colors_, buffers.line_buffer.picking_colors_, &primitives);
+      AddColors(buffers.box_buffer.colors_, buffers.box_buffer.picking_colors_, &primitives);
+      AddColors(buffers.triangle_buffer.colors_, buffers.triangle_buffer.picking_colors_,
+                &primitives);
+    }
+    return primitives;
+  }
+
+ private:
+  template <class ColorChain>
+  void AddColors(const ColorChain& colors, const ColorChain& picking_colors,
+                 Primitives* primitives) const {
+    for (const Color& color : colors) {
+      primitives->colors.push_back(color);
+    }
+    for (const Color& picking_color : picking_colors) {
+      const PickingId id = MockRenderPickingColor(picking_color);
+      primitives->picking_types.push_back(id.type);
+      // The ids of pickables depend on the order in which the threads register them.
+      if (id.type == PickingType::kPickable) continue;
+      primitives->picking_element_ids.push_back(id.element_id);
+      const PickingUserData* user_data = GetUserData(id);
+      primitives->user_data.emplace_back(
+          user_data != nullptr, user_data != nullptr && user_data->generate_tooltip_ != nullptr);
+    }
+  }
+};
+
+// Updates the primitives of tracks, which have callstack samples in the updated time range, with
+// `update_thread_count` threads.
+static PrimitivesBatcher::Primitives UpdateTrackPrimitives(uint32_t update_thread_count,
+                                                           PickingMode picking_mode) {
+  constexpr uint64_t kMinTick = 0;
+  constexpr uint64_t kMaxTick = 100;
+  constexpr size_t kOtherThreadCount = 7;
+  constexpr uint64_t kSampleCountPerThread = 5;
+
+  std::unique_ptr<orbit_client_model::CaptureData> capture_data =
+      TrackTestData::GenerateTestCaptureData();
+  for (size_t i = 0; i <= kOtherThreadCount; ++i) {
+    for (uint64_t sample = 1; sample <= kSampleCountPerThread; ++sample) {
+      orbit_client_protos::CallstackEvent callstack_event;
+      callstack_event.set_time(sample * kMaxTick / (kSampleCountPerThread + 1));
+      callstack_event.set_callstack_id(TrackTestData::kCallstackId);
+      callstack_event.set_thread_id(TrackTestData::kThreadId + static_cast<int32_t>(i));
+      capture_data->AddCallstackEvent(std::move(callstack_event));
+    }
+  }
+
+  Viewport viewport(100, 100);
+  PickingManager picking_manager;
+  // Without an OrbitApp, this also checks that the tracks don't access it while updating their
+  // primitives, which would only be allowed on the main thread.
+  TimeGraph time_graph(nullptr, nullptr, &viewport, capture_data.get(), &picking_manager);
+  TimeGraphLayout layout;
+  TrackManager track_manager(&time_graph, &viewport, &layout, nullptr, capture_data.get(),
+                             update_thread_count);
+
+  // The timers start after the updated time range, so only the samples are drawn.
+  TimerInfo timer;
+  timer.set_start(1000);
+  timer.set_end(2000);
+  timer.set_depth(0);
+  for (size_t i = 0; i <= kOtherThreadCount; ++i) {
+    const int32_t thread_id = TrackTestData::kThreadId + static_cast<int32_t>(i);
+    timer.set_thread_id(thread_id);
+    track_manager.GetOrCreateThreadTrack(thread_id)->OnTimer(timer);
+  }
+  track_manager.UpdateTracksForRendering();
+  EXPECT_EQ(kOtherThreadCount + 1, track_manager.GetVisibleTracks().size());
+
+  PrimitivesBatcher batcher(&picking_manager);
+  PrimitivesBatcher::Primitives primitives;
+  // Update twice, as the batchers of the other threads are reused.
+  for (int update = 0; update < 2; ++update) {
+    batcher.StartNewFrame();
+    EXPECT_TRUE(track_manager.UpdateTrackPrimitives(&batcher, kMinTick, kMaxTick, picking_mode));
+    primitives = batcher.GetPrimitives();
+  }
+  return primitives;
+}
+
+static void ExpectSamePrimitivesOnSeveralThreads(PickingMode picking_mode) {
+  const PrimitivesBatcher::Primitives expected = UpdateTrackPrimitives(1, picking_mode);
+  EXPECT_GT(expected.line_count + expected.box_count + expected.triangle_count, 0);
+  EXPECT_FALSE(expected.user_data.empty());
+
+  constexpr uint32_t kUpdateThreadCount = 3;
+  const PrimitivesBatcher::Primitives primitives =
+      UpdateTrackPrimitives(kUpdateThreadCount, picking_mode);
+  EXPECT_EQ(primitives.line_count, expected.line_count);
+  EXPECT_EQ(primitives.box_count, expected.box_count);
+  EXPECT_EQ(primitives.triangle_count, expected.triangle_count);
+  EXPECT_EQ(primitives.colors, expected.colors);
+  EXPECT_EQ(primitives.picking_element_ids, expected.picking_element_ids);
+  EXPECT_EQ(primitives.picking_types, expected.picking_types);
+  EXPECT_EQ(primitives.user_data, expected.user_data);
+}
+
+TEST(TrackManager, UpdatesTrackPrimitivesOnSeveralThreads) {
+  ExpectSamePrimitivesOnSeveralThreads(PickingMode::kNone);
+}
+
+TEST(TrackManager, UpdatesTrackPrimitivesForPickingOnSeveralThreads) {
+  ExpectSamePrimitivesOnSeveralThreads(PickingMode::kClick);
+}
+
 }  // namespace orbit_gl
\ No newline at end of file
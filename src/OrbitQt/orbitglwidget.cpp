@@ -71,6 +71,12 @@ void OrbitGLWidget::Deinitialize(OrbitMainWindow* main_window) {
   if (main_window) {
     main_window->UnregisterGlWidget(this);
   }
+  if (gl_canvas_ != nullptr) {
+    // OpenGL objects can only be deleted while the context they were created in is current.
+    makeCurrent();
+    gl_canvas_->ReleaseGlResources();
+    doneCurrent();
+  }
   gl_canvas_.reset();
 }
 
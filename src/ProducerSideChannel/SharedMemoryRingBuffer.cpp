@@ -0,0 +1,176 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+#include <absl/strings/match.h>
+#include <absl/strings/str_format.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_producer_side_channel {
+
+namespace {
+constexpr uint64_t kMagic = 0x4f52424954534852;  // "ORBITSHR"
+constexpr const char* kNamePrefix = "/orbit-producer-";
+}  // namespace
+
+SharedMemoryRingBuffer::SharedMemoryRingBuffer(std::string name, bool is_producer,
+                                               void* mmap_address, uint64_t mmap_length)
+    : name_{std::move(name)},
+      is_producer_{is_producer},
+      mmap_address_{mmap_address},
+      mmap_length_{mmap_length},
+      control_{static_cast<ControlBlock*>(mmap_address)},
+      data_{static_cast<uint8_t*>(mmap_address) + sizeof(ControlBlock)},
+      capacity_{mmap_length - sizeof(ControlBlock)} {}
+
+SharedMemoryRingBuffer::~SharedMemoryRingBuffer() {
+  if (munmap(mmap_address_, mmap_length_) != 0) {
+    ERROR("munmap: %s", SafeStrerror(errno));
+  }
+  // The consumer normally removes the name as soon as it has opened the shared memory object. If
+  // it never did, don't leave the object behind.
+  if (is_producer_ && shm_unlink(name_.c_str()) != 0 && errno != ENOENT) {
+    ERROR("shm_unlink: %s", SafeStrerror(errno));
+  }
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> SharedMemoryRingBuffer::Create(
+    uint64_t capacity) {
+  CHECK(capacity >= kCacheLineSize && (capacity & (capacity - 1)) == 0);
+
+  static std::atomic<uint64_t> buffer_counter = 0;
+  std::string name = absl::StrFormat("%s%d-%u", kNamePrefix, getpid(), buffer_counter++);
+  orbit_base::unique_fd fd{shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600)};
+  if (!fd.valid()) {
+    return ErrorMessage{absl::StrFormat("Unable to create shared memory object \"%s\": %s", name,
+                                        SafeStrerror(errno))};
+  }
+
+  const uint64_t mmap_length = sizeof(ControlBlock) + capacity;
+  if (ftruncate(fd.get(), static_cast<off_t>(mmap_length)) != 0) {
+    std::string error = SafeStrerror(errno);
+    shm_unlink(name.c_str());
+    return ErrorMessage{
+        absl::StrFormat("Unable to resize shared memory object \"%s\": %s", name, error)};
+  }
+
+  void* mmap_address =
+      mmap(nullptr, mmap_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), /*offset=*/0);
+  if (mmap_address == MAP_FAILED) {
+    std::string error = SafeStrerror(errno);
+    shm_unlink(name.c_str());
+    return ErrorMessage{
+        absl::StrFormat("Unable to map shared memory object \"%s\": %s", name, error)};
+  }
+
+  auto* control = new (mmap_address) ControlBlock{};
+  control->magic = kMagic;
+  control->capacity = capacity;
+  control->write_offset.store(0, std::memory_order_relaxed);
+  control->read_offset.store(0, std::memory_order_relaxed);
+
+  return std::unique_ptr<SharedMemoryRingBuffer>{
+      new SharedMemoryRingBuffer{std::move(name), /*is_producer=*/true, mmap_address, mmap_length}};
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> SharedMemoryRingBuffer::OpenAndUnlink(
+    const std::string& name, uint64_t size) {
+  // The name comes from the producer, which can't be trusted: only ever open, and later unlink,
+  // shared memory objects with the names that Create gives them.
+  if (!absl::StartsWith(name, kNamePrefix) || name.find('/', 1) != std::string::npos) {
+    return ErrorMessage{
+        absl::StrFormat("\"%s\" is not the name of a shared memory ring buffer", name)};
+  }
+
+  orbit_base::unique_fd fd{shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0)};
+  if (!fd.valid()) {
+    return ErrorMessage{absl::StrFormat("Unable to open shared memory object \"%s\": %s", name,
+                                        SafeStrerror(errno))};
+  }
+
+  struct stat stat_buf {};
+  if (fstat(fd.get(), &stat_buf) != 0) {
+    return ErrorMessage{absl::StrFormat("Unable to stat shared memory object \"%s\": %s", name,
+                                        SafeStrerror(errno))};
+  }
+  const uint64_t capacity = size - sizeof(ControlBlock);
+  if (static_cast<uint64_t>(stat_buf.st_size) != size || size <= sizeof(ControlBlock) ||
+      capacity < kCacheLineSize || (capacity & (capacity - 1)) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Shared memory object \"%s\" has an unexpected size", name)};
+  }
+
+  void* mmap_address =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), /*offset=*/0);
+  if (mmap_address == MAP_FAILED) {
+    return ErrorMessage{absl::StrFormat("Unable to map shared memory object \"%s\": %s", name,
+                                        SafeStrerror(errno))};
+  }
+
+  std::unique_ptr<SharedMemoryRingBuffer> ring_buffer{
+      new SharedMemoryRingBuffer{name, /*is_producer=*/false, mmap_address, size}};
+  if (ring_buffer->control_->magic != kMagic || ring_buffer->control_->capacity != capacity) {
+    return ErrorMessage{
+        absl::StrFormat("Shared memory object \"%s\" is not a ring buffer created by Orbit", name)};
+  }
+
+  // Only remove the name once the object is known to be a ring buffer.
+  if (shm_unlink(name.c_str()) != 0) {
+    ERROR("shm_unlink: %s", SafeStrerror(errno));
+  }
+  return ring_buffer;
+}
+
+uint8_t* SharedMemoryRingBuffer::TryBeginRecord(SharedMemoryRecordType type,
+                                                uint32_t payload_size) {
+  CHECK(!record_pending_);
+  CHECK(type != SharedMemoryRecordType::kWrapAround);
+  if (payload_size > GetMaxPayloadSize()) return nullptr;
+
+  // Only the producer writes write_offset.
+  uint64_t write_offset = control_->write_offset.load(std::memory_order_relaxed);
+  uint64_t position = write_offset & (capacity_ - 1);
+  const uint64_t contiguous_size = capacity_ - position;
+  const uint64_t record_size = GetRecordSize(payload_size);
+  const uint64_t required_size =
+      record_size <= contiguous_size ? record_size : contiguous_size + record_size;
+
+  if (write_offset + required_size - cached_read_offset_ > capacity_) {
+    cached_read_offset_ = control_->read_offset.load(std::memory_order_acquire);
+    if (write_offset + required_size - cached_read_offset_ > capacity_) return nullptr;
+  }
+
+  if (record_size > contiguous_size) {
+    RecordHeader wrap_around{static_cast<uint32_t>(SharedMemoryRecordType::kWrapAround), 0};
+    memcpy(data_ + position, &wrap_around, sizeof(RecordHeader));
+    write_offset += contiguous_size;
+    position = 0;
+  }
+
+  RecordHeader header{static_cast<uint32_t>(type), payload_size};
+  memcpy(data_ + position, &header, sizeof(RecordHeader));
+  pending_write_offset_ = write_offset + record_size;
+  record_pending_ = true;
+  return data_ + position + sizeof(RecordHeader);
+}
+
+void SharedMemoryRingBuffer::CommitRecord() {
+  CHECK(record_pending_);
+  record_pending_ = false;
+  control_->write_offset.store(pending_write_offset_, std::memory_order_release);
+}
+
+}  // namespace orbit_producer_side_channel
@@ -0,0 +1,209 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "OrbitBase/TestUtils.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+namespace orbit_producer_side_channel {
+
+using orbit_base::HasError;
+
+namespace {
+
+struct ConsumedRecord {
+  SharedMemoryRecordType type;
+  std::vector<uint8_t> payload;
+};
+
+std::vector<ConsumedRecord> ConsumeAll(SharedMemoryRingBuffer* ring_buffer) {
+  std::vector<ConsumedRecord> records;
+  auto count_or_error = ring_buffer->ConsumeRecords(
+      SIZE_MAX, [&records](SharedMemoryRecordType type, absl::Span<const uint8_t> payload) {
+        records.push_back({type, std::vector<uint8_t>(payload.begin(), payload.end())});
+      });
+  EXPECT_FALSE(count_or_error.has_error());
+  return records;
+}
+
+std::pair<std::unique_ptr<SharedMemoryRingBuffer>, std::unique_ptr<SharedMemoryRingBuffer>>
+CreateProducerAndConsumer(uint64_t capacity) {
+  auto producer_or_error = SharedMemoryRingBuffer::Create(capacity);
+  EXPECT_FALSE(producer_or_error.has_error());
+  std::unique_ptr<SharedMemoryRingBuffer> producer = std::move(producer_or_error.value());
+  auto consumer_or_error =
+      SharedMemoryRingBuffer::OpenAndUnlink(producer->GetName(), producer->GetSize());
+  EXPECT_FALSE(consumer_or_error.has_error());
+  return {std::move(producer), std::move(consumer_or_error.value())};
+}
+
+}  // namespace
+
+TEST(SharedMemoryRingBuffer, WriteAndConsumeInOrder) {
+  auto [producer, consumer] = CreateProducerAndConsumer(4096);
+  EXPECT_EQ(consumer->GetCapacity(), 4096);
+
+  EXPECT_TRUE(producer->TryWriteRecord(SharedMemoryRecordType::kProducerCaptureEvent,
+                                       static_cast<uint8_t>(42)));
+  SharedMemoryApiEventRecord api_event{};
+  api_event.timestamp_ns = 1234;
+  api_event.tid = 5;
+  api_event.name_key = 6;
+  EXPECT_TRUE(producer->TryWriteRecord(SharedMemoryRecordType::kApiEvent, api_event));
+
+  std::vector<ConsumedRecord> records = ConsumeAll(consumer.get());
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[0].type, SharedMemoryRecordType::kProducerCaptureEvent);
+  EXPECT_THAT(records[0].payload, testing::ElementsAre(42));
+  EXPECT_EQ(records[1].type, SharedMemoryRecordType::kApiEvent);
+  ASSERT_EQ(records[1].payload.size(), sizeof(SharedMemoryApiEventRecord));
+  SharedMemoryApiEventRecord consumed_api_event;
+  memcpy(&consumed_api_event, records[1].payload.data(), sizeof(SharedMemoryApiEventRecord));
+  EXPECT_EQ(consumed_api_event.timestamp_ns, 1234);
+  EXPECT_EQ(consumed_api_event.tid, 5);
+  EXPECT_EQ(consumed_api_event.name_key, 6);
+
+  EXPECT_TRUE(ConsumeAll(consumer.get()).empty());
+}
+
+TEST(SharedMemoryRingBuffer, ConsumeRespectsMaxCount) {
+  auto [producer, consumer] = CreateProducerAndConsumer(4096);
+  for (uint64_t i = 0; i < 3; ++i) {
+    EXPECT_TRUE(producer->TryWriteRecord(SharedMemoryRecordType::kProducerCaptureEvent, i));
+  }
+  auto count_or_error = consumer->ConsumeRecords(
+      2, [](SharedMemoryRecordType /*type*/, absl::Span<const uint8_t> /*payload*/) {});
+  ASSERT_FALSE(count_or_error.has_error());
+  EXPECT_EQ(count_or_error.value(), 2);
+  EXPECT_EQ(ConsumeAll(consumer.get()).size(), 1);
+}
+
+TEST(SharedMemoryRingBuffer, TryBeginRecordFailsWhenFullOrTooLarge) {
+  auto [producer, consumer] = CreateProducerAndConsumer(256);
+  EXPECT_EQ(producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent,
+                                     producer->GetMaxPayloadSize() + 1),
+            nullptr);
+
+  // Each record of 56 bytes of payload takes 64 bytes.
+  constexpr uint32_t kPayloadSize = 56;
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_NE(producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent, kPayloadSize),
+              nullptr);
+    producer->CommitRecord();
+  }
+  EXPECT_EQ(producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent, kPayloadSize),
+            nullptr);
+
+  EXPECT_EQ(ConsumeAll(consumer.get()).size(), 4);
+  EXPECT_NE(producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent, kPayloadSize),
+            nullptr);
+  producer->CommitRecord();
+}
+
+TEST(SharedMemoryRingBuffer, RecordsAreNotSplitAtTheEndOfTheBuffer) {
+  auto [producer, consumer] = CreateProducerAndConsumer(256);
+  // Fill 192 bytes and consume them, then write a record that doesn't fit in the last 64 bytes.
+  for (uint64_t i = 0; i < 3; ++i) {
+    ASSERT_NE(producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent, 56), nullptr);
+    producer->CommitRecord();
+  }
+  EXPECT_EQ(ConsumeAll(consumer.get()).size(), 3);
+
+  std::vector<uint8_t> payload(producer->GetMaxPayloadSize());
+  for (size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<uint8_t>(i);
+  uint8_t* destination = producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent,
+                                                  static_cast<uint32_t>(payload.size()));
+  ASSERT_NE(destination, nullptr);
+  memcpy(destination, payload.data(), payload.size());
+  producer->CommitRecord();
+
+  std::vector<ConsumedRecord> records = ConsumeAll(consumer.get());
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].payload, payload);
+}
+
+TEST(SharedMemoryRingBuffer, InvalidRecordSizeIsAnError) {
+  auto [producer, consumer] = CreateProducerAndConsumer(256);
+  // Simulate a producer that writes a record header with a payload size past the write offset.
+  uint8_t* destination = producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent, 8);
+  ASSERT_NE(destination, nullptr);
+  uint32_t invalid_header[2] = {static_cast<uint32_t>(SharedMemoryRecordType::kApiEvent), 200};
+  memcpy(destination - sizeof(invalid_header), invalid_header, sizeof(invalid_header));
+  producer->CommitRecord();
+
+  EXPECT_THAT(consumer->ConsumeRecords(
+                  1, [](SharedMemoryRecordType /*type*/, absl::Span<const uint8_t> /*payload*/) {}),
+              HasError("invalid record"));
+}
+
+TEST(SharedMemoryRingBuffer, OpenNonExistingObjectFails) {
+  EXPECT_THAT(SharedMemoryRingBuffer::OpenAndUnlink("/orbit-producer-non-existing", 4096),
+              HasError("Unable to open"));
+}
+
+TEST(SharedMemoryRingBuffer, OpenWithForeignNameFails) {
+  EXPECT_THAT(SharedMemoryRingBuffer::OpenAndUnlink("/some-other-object", 4096),
+              HasError("is not the name of a shared memory ring buffer"));
+  EXPECT_THAT(SharedMemoryRingBuffer::OpenAndUnlink("/orbit-producer-/../some-other-object", 4096),
+              HasError("is not the name of a shared memory ring buffer"));
+}
+
+TEST(SharedMemoryRingBuffer, OpenWithWrongSizeFailsWithoutUnlinking) {
+  auto producer_or_error = SharedMemoryRingBuffer::Create(4096);
+  ASSERT_FALSE(producer_or_error.has_error());
+  const std::unique_ptr<SharedMemoryRingBuffer>& producer = producer_or_error.value();
+  EXPECT_THAT(SharedMemoryRingBuffer::OpenAndUnlink(producer->GetName(), 1024),
+              HasError("unexpected size"));
+  EXPECT_FALSE(
+      SharedMemoryRingBuffer::OpenAndUnlink(producer->GetName(), producer->GetSize()).has_error());
+}
+
+TEST(SharedMemoryRingBuffer, ConcurrentProducerAndConsumer) {
+  constexpr uint64_t kRecordCount = 200'000;
+  auto [producer, consumer] = CreateProducerAndConsumer(4096);
+
+  std::thread producer_thread([&producer = producer] {
+    for (uint64_t i = 0; i < kRecordCount; ++i) {
+      // Alternate record sizes so that wrap-around records are needed.
+      std::vector<uint64_t> payload(i % 7 + 1, i);
+      while (true) {
+        uint8_t* destination =
+            producer->TryBeginRecord(SharedMemoryRecordType::kProducerCaptureEvent,
+                                     static_cast<uint32_t>(payload.size() * sizeof(uint64_t)));
+        if (destination != nullptr) {
+          memcpy(destination, payload.data(), payload.size() * sizeof(uint64_t));
+          producer->CommitRecord();
+          break;
+        }
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint64_t expected_value = 0;
+  while (expected_value < kRecordCount) {
+    auto count_or_error = consumer->ConsumeRecords(
+        16, [&expected_value](SharedMemoryRecordType /*type*/, absl::Span<const uint8_t> payload) {
+          ASSERT_EQ(payload.size(), (expected_value % 7 + 1) * sizeof(uint64_t));
+          uint64_t value;
+          memcpy(&value, payload.data() + payload.size() - sizeof(uint64_t), sizeof(uint64_t));
+          EXPECT_EQ(value, expected_value);
+          ++expected_value;
+        });
+    ASSERT_FALSE(count_or_error.has_error());
+    if (count_or_error.value() == 0) std::this_thread::yield();
+  }
+  producer_thread.join();
+}
+
+}  // namespace orbit_producer_side_channel
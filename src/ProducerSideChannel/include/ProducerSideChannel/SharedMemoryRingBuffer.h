@@ -0,0 +1,178 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
+#define ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
+
+#include <absl/types/span.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_producer_side_channel {
+
+// The type of each record in a SharedMemoryRingBuffer. kWrapAround is reserved by the ring buffer
+// itself, to skip the end of the buffer when the next record doesn't fit there.
+enum class SharedMemoryRecordType : uint32_t {
+  kWrapAround = 0,
+  // A serialized orbit_grpc_protos::ProducerCaptureEvent.
+  kProducerCaptureEvent = 1,
+  // A SharedMemoryApiEventRecord.
+  kApiEvent = 2,
+};
+
+// The fixed layout of orbit_grpc_protos::ApiEvent in a SharedMemoryRingBuffer.
+struct SharedMemoryApiEventRecord {
+  uint64_t timestamp_ns;
+  int32_t pid;
+  int32_t tid;
+  uint64_t args[6];
+  uint64_t name_key;
+};
+static_assert(std::is_trivially_copyable_v<SharedMemoryApiEventRecord>);
+static_assert(sizeof(SharedMemoryApiEventRecord) == 72);
+
+// Single-producer, single-consumer ring buffer of variable-size records in a POSIX shared memory
+// object. A producer of CaptureEvents creates it and writes records, OrbitService opens it by name
+// and consumes them, so that events don't need to be serialized into gRPC requests.
+//
+// Each record is an 8-byte header (type and payload size) followed by the payload, padded to a
+// multiple of 8 bytes. Records are never split across the end of the buffer. As the content of the
+// shared memory can't be trusted by the consumer, ConsumeRecords validates every record header.
+class SharedMemoryRingBuffer {
+ public:
+  // Creates a new shared memory object with a unique name. `capacity` must be a power of two.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> Create(
+      uint64_t capacity);
+  // Opens the shared memory object created by a producer and removes its name, which is no longer
+  // needed once both sides have mapped it. `name` must have been returned by GetName of a buffer
+  // created with Create. The name is only removed if the object is a valid ring buffer.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> OpenAndUnlink(
+      const std::string& name, uint64_t size);
+
+  ~SharedMemoryRingBuffer();
+
+  SharedMemoryRingBuffer(const SharedMemoryRingBuffer&) = delete;
+  SharedMemoryRingBuffer& operator=(const SharedMemoryRingBuffer&) = delete;
+  SharedMemoryRingBuffer(SharedMemoryRingBuffer&&) = delete;
+  SharedMemoryRingBuffer& operator=(SharedMemoryRingBuffer&&) = delete;
+
+  [[nodiscard]] const std::string& GetName() const { return name_; }
+  // The size of the whole shared memory object, as required by OpenAndUnlink.
+  [[nodiscard]] uint64_t GetSize() const { return mmap_length_; }
+  [[nodiscard]] uint64_t GetCapacity() const { return capacity_; }
+  // Larger payloads are rejected by TryBeginRecord, so that a single record can never stall the
+  // producer until the consumer has emptied the whole buffer.
+  [[nodiscard]] uint64_t GetMaxPayloadSize() const { return capacity_ / 4 - sizeof(RecordHeader); }
+
+  // Only to be called by the producer. Reserves a record of `payload_size` bytes and returns where
+  // to write its payload, or nullptr if there isn't enough free space. The record only becomes
+  // visible to the consumer when CommitRecord is called.
+  [[nodiscard]] uint8_t* TryBeginRecord(SharedMemoryRecordType type, uint32_t payload_size);
+  void CommitRecord();
+
+  template <typename T>
+  [[nodiscard]] bool TryWriteRecord(SharedMemoryRecordType type, const T& payload) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint8_t* destination = TryBeginRecord(type, sizeof(T));
+    if (destination == nullptr) return false;
+    memcpy(destination, &payload, sizeof(T));
+    CommitRecord();
+    return true;
+  }
+
+  // Only to be called by the consumer. Calls `consumer(SharedMemoryRecordType, absl::Span<const
+  // uint8_t>)` on at most `max_count` records, oldest first, and returns the number of records
+  // consumed. The payload is only valid during the call. The space is only handed back to the
+  // producer once the whole batch has been consumed. Returns an error if the buffer is corrupted,
+  // in which case it shouldn't be read any further.
+  template <typename Consumer>
+  [[nodiscard]] ErrorMessageOr<size_t> ConsumeRecords(size_t max_count, Consumer&& consumer) {
+    uint64_t read_offset = control_->read_offset.load(std::memory_order_relaxed);
+    const uint64_t write_offset = control_->write_offset.load(std::memory_order_acquire);
+    if (write_offset - read_offset > capacity_ || write_offset % kRecordAlignment != 0) {
+      return ErrorMessage{"Shared memory ring buffer has an invalid write offset"};
+    }
+
+    size_t count = 0;
+    while (read_offset != write_offset && count < max_count) {
+      const uint64_t position = read_offset & (capacity_ - 1);
+      const uint64_t contiguous_size = capacity_ - position;
+      RecordHeader header;
+      memcpy(&header, data_ + position, sizeof(RecordHeader));
+      if (header.type == static_cast<uint32_t>(SharedMemoryRecordType::kWrapAround)) {
+        if (contiguous_size > write_offset - read_offset) {
+          return ErrorMessage{"Shared memory ring buffer contains an invalid record"};
+        }
+        read_offset += contiguous_size;
+        continue;
+      }
+
+      const uint64_t record_size = GetRecordSize(header.payload_size);
+      if (record_size > contiguous_size || record_size > write_offset - read_offset) {
+        return ErrorMessage{"Shared memory ring buffer contains an invalid record"};
+      }
+      consumer(static_cast<SharedMemoryRecordType>(header.type),
+               absl::MakeConstSpan(data_ + position + sizeof(RecordHeader), header.payload_size));
+      read_offset += record_size;
+      ++count;
+    }
+    control_->read_offset.store(read_offset, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  struct RecordHeader {
+    uint32_t type;
+    uint32_t payload_size;
+  };
+
+  static constexpr size_t kCacheLineSize = 64;
+  static constexpr uint64_t kRecordAlignment = 8;
+  static_assert(sizeof(RecordHeader) == kRecordAlignment);
+
+  // The beginning of the shared memory object, followed by the records.
+  struct ControlBlock {
+    uint64_t magic;
+    uint64_t capacity;
+    alignas(kCacheLineSize) std::atomic<uint64_t> write_offset;
+    alignas(kCacheLineSize) std::atomic<uint64_t> read_offset;
+  };
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+  static_assert(sizeof(ControlBlock) % kCacheLineSize == 0);
+
+  SharedMemoryRingBuffer(std::string name, bool is_producer, void* mmap_address,
+                         uint64_t mmap_length);
+
+  [[nodiscard]] static uint64_t GetRecordSize(uint32_t payload_size) {
+    return sizeof(RecordHeader) +
+           ((static_cast<uint64_t>(payload_size) + kRecordAlignment - 1) & ~(kRecordAlignment - 1));
+  }
+
+  std::string name_;
+  // Only the producer, which created the shared memory object, removes its name on destruction.
+  bool is_producer_;
+  void* mmap_address_;
+  uint64_t mmap_length_;
+  ControlBlock* control_;
+  uint8_t* data_;
+  uint64_t capacity_;
+
+  // Only used by the producer.
+  uint64_t cached_read_offset_ = 0;
+  uint64_t pending_write_offset_ = 0;
+  bool record_pending_ = false;
+};
+
+}  // namespace orbit_producer_side_channel
+
+#endif  // ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
@@ -5,17 +5,42 @@
 #ifndef ORBIT_SERVICE_CAPTURE_EVENT_BUFFER_H_
 #define ORBIT_SERVICE_CAPTURE_EVENT_BUFFER_H_
 
+#include <absl/functional/function_ref.h>
+#include <google/protobuf/arena.h>
+
+#include <utility>
+#include <vector>
+
 #include "capture.pb.h"
 
 namespace orbit_service {
 
 // Interface used to buffer CaptureEvents so that multiple CaptureEvents
 // can be processed at the same time (e.g., grouped into fewer bigger CaptureResponses).
-// AddEvent is to be assumed thread safe.
+// AddEvent and AddEvents are to be assumed thread safe.
 class CaptureEventBuffer {
  public:
+  using BuildEventsFunction = absl::FunctionRef<void(
+      google::protobuf::Arena* arena, std::vector<orbit_grpc_protos::ClientCaptureEvent*>* events)>;
+
   virtual ~CaptureEventBuffer() = default;
   virtual void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) = 0;
+
+  // Adds a batch of events at once. `build_events` is called exactly once and must append to
+  // `events` the ClientCaptureEvents to add, created in `arena` with
+  // `google::protobuf::Arena::CreateMessage`. Implementations can keep the arena alive until the
+  // events have been sent, which avoids a heap allocation for each event.
+  // `build_events` is not called while holding a lock of the buffer, so it can do the work of
+  // translating the events, but it must not call back into the buffer.
+  virtual void AddEvents(BuildEventsFunction build_events) {
+    google::protobuf::Arena arena;
+    std::vector<orbit_grpc_protos::ClientCaptureEvent*> events;
+    build_events(&arena, &events);
+    for (orbit_grpc_protos::ClientCaptureEvent* event : events) {
+      // This copies the event, as it was allocated in the arena.
+      AddEvent(std::move(*event));
+    }
+  }
 };
 
 }  // namespace orbit_service
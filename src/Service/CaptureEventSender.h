@@ -5,16 +5,20 @@
 #ifndef ORBIT_SERVICE_CAPTURE_EVENT_SENDER_H_
 #define ORBIT_SERVICE_CAPTURE_EVENT_SENDER_H_
 
+#include <absl/types/span.h>
+
 #include "capture.pb.h"
 
 namespace orbit_service {
 
 // Interface used to process at once multiple CaptureEvents that were previously buffered
 // (e.g., to group all those CaptureEvents into a single CaptureResponse).
+// The events are owned by the caller (they are usually allocated in an Arena) and are only valid
+// for the duration of the call.
 class CaptureEventSender {
  public:
   virtual ~CaptureEventSender() = default;
-  virtual void SendEvents(std::vector<orbit_grpc_protos::ClientCaptureEvent>&& events) = 0;
+  virtual void SendEvents(absl::Span<orbit_grpc_protos::ClientCaptureEvent* const> events) = 0;
 };
 
 }  // namespace orbit_service
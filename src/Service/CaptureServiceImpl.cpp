@@ -6,12 +6,14 @@
 
 #include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
-#include <absl/time/time.h>
+#include <absl/types/span.h>
 #include <pthread.h>
 #include <stdint.h>
 
 #include <algorithm>
 #include <limits>
+#include <optional>
+#include <string>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -19,6 +21,7 @@
 #include "ApiLoader/EnableInTracee.h"
 #include "CaptureEventBuffer.h"
 #include "CaptureEventSender.h"
+#include "GrpcProtos/CaptureEventsCompression.h"
 #include "GrpcProtos/Constants.h"
 #include "Introspection/Introspection.h"
 #include "LinuxTracingHandler.h"
@@ -28,6 +31,8 @@
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
 #include "ProducerEventProcessor.h"
+#include "SenderThreadCaptureEventBuffer.h"
+#include "UserSpaceInstrumentation/InstrumentProcess.h"
 #include "capture.pb.h"
 
 namespace orbit_service {
@@ -37,88 +42,33 @@ using orbit_grpc_protos::CaptureOptions;
 using orbit_grpc_protos::CaptureRequest;
 using orbit_grpc_protos::CaptureResponse;
 using orbit_grpc_protos::CaptureStarted;
+using orbit_grpc_protos::InstrumentedFunction;
 using orbit_grpc_protos::ProducerCaptureEvent;
 
 namespace {
 
 using orbit_grpc_protos::ClientCaptureEvent;
 
-class SenderThreadCaptureEventBuffer final : public CaptureEventBuffer {
- public:
-  explicit SenderThreadCaptureEventBuffer(CaptureEventSender* event_sender)
-      : capture_event_sender_{event_sender} {
-    CHECK(capture_event_sender_ != nullptr);
-    sender_thread_ = std::thread{[this] { SenderThread(); }};
-  }
-
-  void AddEvent(ClientCaptureEvent&& event) override {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    if (stop_requested_) {
-      return;
-    }
-    event_buffer_.emplace_back(std::move(event));
-  }
-
-  void StopAndWait() {
-    CHECK(sender_thread_.joinable());
-    {
-      // Protect stop_requested_ with event_buffer_mutex_ so that we can use stop_requested_
-      // in Conditions for Await/LockWhen (specifically, in SenderThread).
-      absl::MutexLock lock{&event_buffer_mutex_};
-      stop_requested_ = true;
-    }
-    sender_thread_.join();
-  }
-
-  ~SenderThreadCaptureEventBuffer() override { CHECK(!sender_thread_.joinable()); }
-
- private:
-  void SenderThread() {
-    pthread_setname_np(pthread_self(), "SenderThread");
-    constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(20);
-    // This should be lower than kMaxEventsPerResponse in GrpcCaptureEventSender::SendEvents
-    // as a few more events are likely to arrive after the condition becomes true.
-    constexpr uint64_t kSendEventCountInterval = 5000;
-
-    bool stopped = false;
-    while (!stopped) {
-      ORBIT_SCOPE("SenderThread iteration");
-      event_buffer_mutex_.LockWhenWithTimeout(absl::Condition(
-                                                  +[](SenderThreadCaptureEventBuffer* self) {
-                                                    return self->event_buffer_.size() >=
-                                                               kSendEventCountInterval ||
-                                                           self->stop_requested_;
-                                                  },
-                                                  this),
-                                              kSendTimeInterval);
-      if (stop_requested_) {
-        stopped = true;
-      }
-      std::vector<ClientCaptureEvent> buffered_events = std::move(event_buffer_);
-      event_buffer_.clear();
-      event_buffer_mutex_.Unlock();
-      capture_event_sender_->SendEvents(std::move(buffered_events));
-    }
-  }
-
-  std::vector<ClientCaptureEvent> event_buffer_;
-  absl::Mutex event_buffer_mutex_;
-  CaptureEventSender* capture_event_sender_;
-  std::thread sender_thread_;
-  bool stop_requested_ = false;
-};
-
 class GrpcCaptureEventSender final : public CaptureEventSender {
  public:
   explicit GrpcCaptureEventSender(
-      grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer)
+      grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer,
+      bool compress_capture_events)
       : reader_writer_{reader_writer} {
     CHECK(reader_writer_ != nullptr);
+    if (compress_capture_events) {
+      compressor_.emplace();
+    }
   }
 
   ~GrpcCaptureEventSender() override {
     LOG("Total number of events sent: %lu", total_number_of_events_sent_);
     LOG("Total number of bytes sent: %lu", total_number_of_bytes_sent_);
+    if (compressor_.has_value()) {
+      LOG("Total number of bytes sent after compression: %lu (%.1f%%)",
+          total_number_of_compressed_bytes_sent_,
+          100.f * total_number_of_compressed_bytes_sent_ / total_number_of_bytes_sent_);
+    }
 
     // Ensure we can divide by 0.f safely.
     static_assert(std::numeric_limits<float>::is_iec559);
@@ -128,29 +78,39 @@ class GrpcCaptureEventSender final : public CaptureEventSender {
     LOG("Average number of bytes per event: %.2f", average_bytes);
   }
 
-  void SendEvents(std::vector<ClientCaptureEvent>&& events) override {
+  void SendEvents(absl::Span<ClientCaptureEvent* const> events) override {
     ORBIT_SCOPE_FUNCTION;
     ORBIT_UINT64("Number of buffered events sent", events.size());
     if (events.empty()) {
       return;
     }
 
-    constexpr uint64_t kMaxEventsPerResponse = 10'000;
+    constexpr size_t kMaxEventsPerResponse = 10'000;
     uint64_t number_of_bytes_sent = 0;
-    CaptureResponse response;
-    for (ClientCaptureEvent& event : events) {
+    uint64_t number_of_compressed_bytes_sent = 0;
+    for (size_t begin = 0; begin < events.size(); begin += kMaxEventsPerResponse) {
       // We buffer to avoid sending countless tiny messages, but we also want to
       // avoid huge messages, which would cause the capture on the client to jump
       // forward in time in few big steps and not look live anymore.
-      if (response.capture_events_size() == kMaxEventsPerResponse) {
-        number_of_bytes_sent += response.ByteSizeLong();
-        reader_writer_->Write(response);
-        response.clear_capture_events();
+      const size_t end = std::min(events.size(), begin + kMaxEventsPerResponse);
+      // The events are owned by the caller: only lend them to response_ while writing it.
+      for (size_t i = begin; i < end; ++i) {
+        response_.mutable_capture_events()->UnsafeArenaAddAllocated(events[i]);
+      }
+      if (compressor_.has_value()) {
+        response_.SerializeToString(&serialized_response_);
+        number_of_bytes_sent += serialized_response_.size();
+        compressor_->CompressBlock(serialized_response_,
+                                   compressed_response_.mutable_compressed_capture_events());
+        number_of_compressed_bytes_sent += compressed_response_.ByteSizeLong();
+        reader_writer_->Write(compressed_response_);
+      } else {
+        number_of_bytes_sent += response_.ByteSizeLong();
+        reader_writer_->Write(response_);
       }
-      response.mutable_capture_events()->Add(std::move(event));
+      response_.mutable_capture_events()->UnsafeArenaExtractSubrange(
+          0, response_.capture_events_size(), nullptr);
     }
-    number_of_bytes_sent += response.ByteSizeLong();
-    reader_writer_->Write(response);
 
     // Ensure we can divide by 0.f safely.
     static_assert(std::numeric_limits<float>::is_iec559);
@@ -159,13 +119,24 @@ class GrpcCaptureEventSender final : public CaptureEventSender {
     ORBIT_FLOAT("Average bytes per CaptureEvent", average_bytes);
     total_number_of_events_sent_ += events.size();
     total_number_of_bytes_sent_ += number_of_bytes_sent;
+    if (compressor_.has_value()) {
+      ORBIT_FLOAT("Average compressed bytes per CaptureEvent",
+                  static_cast<float>(number_of_compressed_bytes_sent) / events.size());
+      total_number_of_compressed_bytes_sent_ += number_of_compressed_bytes_sent;
+    }
   }
 
  private:
   grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer_;
+  CaptureResponse response_;
+  // Only used when compressing.
+  std::optional<orbit_grpc_protos::CaptureEventsCompressor> compressor_;
+  std::string serialized_response_;
+  CaptureResponse compressed_response_;
 
   uint64_t total_number_of_events_sent_ = 0;
   uint64_t total_number_of_bytes_sent_ = 0;
+  uint64_t total_number_of_compressed_bytes_sent_ = 0;
 };
 
 }  // namespace
@@ -261,6 +232,18 @@ static ProducerCaptureEvent CreateWarningEvent(uint64_t timestamp_ns, std::strin
   return event;
 }
 
+// Functions instrumented with trampolines must not also be instrumented with uprobes.
+static void RemoveInstrumentedFunctions(CaptureOptions* capture_options,
+                                        const absl::flat_hash_set<uint64_t>& function_ids) {
+  auto* instrumented_functions = capture_options->mutable_instrumented_functions();
+  instrumented_functions->erase(
+      std::remove_if(instrumented_functions->begin(), instrumented_functions->end(),
+                     [&function_ids](const InstrumentedFunction& function) {
+                       return function_ids.contains(function.function_id());
+                     }),
+      instrumented_functions->end());
+}
+
 static ClientCaptureEvent CreateCaptureFinishedEvent() {
   ClientCaptureEvent event;
   CaptureFinished* capture_finished = event.mutable_capture_finished();
@@ -279,19 +262,20 @@ grpc::Status CaptureServiceImpl::Capture(
   }
   is_capturing = true;
 
-  GrpcCaptureEventSender capture_event_sender{reader_writer};
-  SenderThreadCaptureEventBuffer capture_event_buffer{&capture_event_sender};
-  std::unique_ptr<ProducerEventProcessor> producer_event_processor =
-      ProducerEventProcessor::Create(&capture_event_buffer);
-  LinuxTracingHandler tracing_handler{producer_event_processor.get()};
-  MemoryInfoHandler memory_info_handler{producer_event_processor.get()};
-
   CaptureRequest request;
   reader_writer->Read(&request);
   LOG("Read CaptureRequest from Capture's gRPC stream: starting capture");
 
   const CaptureOptions& capture_options = request.capture_options();
 
+  GrpcCaptureEventSender capture_event_sender{reader_writer,
+                                              capture_options.compress_capture_events()};
+  SenderThreadCaptureEventBuffer capture_event_buffer{&capture_event_sender};
+  std::unique_ptr<ProducerEventProcessor> producer_event_processor =
+      ProducerEventProcessor::Create(&capture_event_buffer);
+  LinuxTracingHandler tracing_handler{producer_event_processor.get()};
+  MemoryInfoHandler memory_info_handler{producer_event_processor.get()};
+
   // Enable Orbit API in tracee.
   std::optional<std::string> error_enabling_orbit_api;
   if (capture_options.enable_api()) {
@@ -303,6 +287,24 @@ grpc::Status CaptureServiceImpl::Capture(
     }
   }
 
+  // Instrument functions with trampolines in the tracee, when asked to. The functions that can't
+  // be instrumented this way keep using uprobes.
+  CaptureOptions linux_tracing_capture_options = capture_options;
+  std::optional<std::string> error_enabling_user_space_instrumentation;
+  if (capture_options.enable_user_space_instrumentation()) {
+    auto instrumented_function_ids_or_error =
+        instrumentation_manager_.InstrumentProcess(capture_options);
+    if (instrumented_function_ids_or_error.has_error()) {
+      ERROR("Instrumenting process: %s", instrumented_function_ids_or_error.error().message());
+      error_enabling_user_space_instrumentation = absl::StrFormat(
+          "Could not instrument functions in the process, using uprobes instead: %s",
+          instrumented_function_ids_or_error.error().message());
+    } else {
+      RemoveInstrumentedFunctions(&linux_tracing_capture_options,
+                                  instrumented_function_ids_or_error.value());
+    }
+  }
+
   uint64_t capture_start_timestamp_ns = orbit_base::CaptureTimestampNs();
   producer_event_processor->ProcessEvent(
       orbit_grpc_protos::kRootProducerId,
@@ -319,7 +321,14 @@ grpc::Status CaptureServiceImpl::Capture(
                                          std::move(error_enabling_orbit_api.value())));
   }
 
-  tracing_handler.Start(capture_options);
+  if (error_enabling_user_space_instrumentation.has_value()) {
+    producer_event_processor->ProcessEvent(
+        orbit_grpc_protos::kRootProducerId,
+        CreateWarningEvent(capture_start_timestamp_ns,
+                           std::move(error_enabling_user_space_instrumentation.value())));
+  }
+
+  tracing_handler.Start(linux_tracing_capture_options);
 
   memory_info_handler.Start(request.capture_options());
   for (CaptureStartStopListener* listener : capture_start_stop_listeners_) {
@@ -346,6 +355,19 @@ grpc::Status CaptureServiceImpl::Capture(
     }
   }
 
+  // Restore the original code of the functions instrumented with trampolines.
+  if (capture_options.enable_user_space_instrumentation()) {
+    auto result = instrumentation_manager_.UninstrumentProcess(capture_options.pid());
+    if (result.has_error()) {
+      ERROR("Uninstrumenting process: %s", result.error().message());
+      producer_event_processor->ProcessEvent(
+          orbit_grpc_protos::kRootProducerId,
+          CreateWarningEvent(orbit_base::CaptureTimestampNs(),
+                             absl::StrFormat("Could not remove instrumentation from process: %s",
+                                             result.error().message())));
+    }
+  }
+
   StopInternalProducersAndCaptureStartStopListenersInParallel(
       &tracing_handler, &memory_info_handler, &capture_start_stop_listeners_);
 
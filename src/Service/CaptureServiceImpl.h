@@ -12,6 +12,7 @@
 #include "CaptureStartStopListener.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
+#include "UserSpaceInstrumentation/InstrumentProcess.h"
 #include "absl/container/flat_hash_set.h"
 #include "services.grpc.pb.h"
 #include "services.pb.h"
@@ -37,6 +38,9 @@ class CaptureServiceImpl final : public orbit_grpc_protos::CaptureService::Servi
   std::atomic<bool> is_capturing = false;
   absl::flat_hash_set<CaptureStartStopListener*> capture_start_stop_listeners_;
 
+  // Kept across captures, so that the processes instrumented with trampolines are only set up once.
+  orbit_user_space_instrumentation::InstrumentationManager instrumentation_manager_;
+
   uint64_t clock_resolution_ns_ = 0;
   void EstimateAndLogClockResolution();
 };
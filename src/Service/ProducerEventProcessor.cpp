@@ -5,6 +5,12 @@
 #include "ProducerEventProcessor.h"
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <google/protobuf/arena.h>
+
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "capture.pb.h"
@@ -47,6 +53,7 @@ using orbit_grpc_protos::ThreadStateSlice;
 using orbit_grpc_protos::TracepointEvent;
 using orbit_grpc_protos::WarningEvent;
 
+// Not thread-safe: the owning ProducerEventProcessorImpl only uses it while holding its mutex.
 template <typename T>
 class InternPool final {
  public:
@@ -55,7 +62,6 @@ class InternPool final {
   // Return pair of <id, assigned>, where assigned is true if the entry was assigned a new id
   // and false if returning id for already existing entry.
   std::pair<uint64_t, bool> GetOrAssignId(const T& entry) {
-    absl::MutexLock lock(&entry_to_id_mutex_);
     auto it = entry_to_id_.find(entry);
     if (it != entry_to_id_.end()) {
       return std::make_pair(it->second, false);
@@ -70,7 +76,6 @@ class InternPool final {
  private:
   uint64_t id_counter_ = 1;  // 0 is reserved for invalid_id
   absl::flat_hash_map<T, uint64_t> entry_to_id_;
-  absl::Mutex entry_to_id_mutex_;
 };
 
 class ProducerEventProcessorImpl : public ProducerEventProcessor {
@@ -80,8 +85,16 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
       : capture_event_buffer_{capture_event_buffer} {}
 
   void ProcessEvent(uint64_t producer_id, ProducerCaptureEvent event) override;
+  void ProcessEvents(uint64_t producer_id,
+                     google::protobuf::RepeatedPtrField<ProducerCaptureEvent>* events) override;
 
  private:
+  // All the following methods are only called while holding mutex_.
+  void ProcessEventInternal(uint64_t producer_id, ProducerCaptureEvent* event);
+  // Creates a ClientCaptureEvent in the arena of the batch being processed and appends it to the
+  // events of the batch.
+  ClientCaptureEvent* CreateClientCaptureEvent();
+
   void ProcessCaptureStartedAndTransferOwnership(CaptureStarted* capture_started);
   void ProcessFullAddressInfo(FullAddressInfo* full_address_info);
   void ProcessFullCallstackSample(FullCallstackSample* full_callstack_sample);
@@ -105,7 +118,7 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
   void ProcessThreadStateSliceAndTransferOwnership(ThreadStateSlice* thread_state_slice);
   void ProcessFullTracepointEvent(FullTracepointEvent* full_tracepoint_event);
   void ProcessMemoryUsageEventAndTransferOwnership(MemoryUsageEvent* memory_usage_event);
-  void ProcessApiEventAndTransferOwnership(ApiEvent* api_event);
+  void ProcessApiEventAndTransferOwnership(uint64_t producer_id, ApiEvent* api_event);
   void ProcessWarningEventAndTransferOwnership(WarningEvent* warning_event);
   void ProcessClockResolutionEventAndTransferOwnership(
       ClockResolutionEvent* clock_resolution_event);
@@ -122,6 +135,13 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
 
   CaptureEventBuffer* capture_event_buffer_;
 
+  // Guards the intern pools and id mappings, which are shared between all producers. A batch of
+  // events only acquires it once.
+  absl::Mutex mutex_;
+  // Only set while a batch is being processed.
+  google::protobuf::Arena* arena_ = nullptr;
+  std::vector<ClientCaptureEvent*>* client_capture_events_ = nullptr;
+
   InternPool<std::pair<std::vector<uint64_t>, Callstack::CallstackType>> callstack_pool_;
   InternPool<std::string> string_pool_;
   InternPool<std::pair<std::string, std::string>> tracepoint_pool_;
@@ -149,21 +169,18 @@ void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_ad
     SendInternedStringEvent(module_name_key, full_address_info->module_name());
   }
 
-  ClientCaptureEvent event;
-  AddressInfo* interned_address_info = event.mutable_address_info();
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  AddressInfo* interned_address_info = event->mutable_address_info();
   interned_address_info->set_absolute_address(full_address_info->absolute_address());
   interned_address_info->set_offset_in_function(full_address_info->offset_in_function());
   interned_address_info->set_function_name_key(function_name_key);
   interned_address_info->set_module_name_key(module_name_key);
-
-  capture_event_buffer_->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessFunctionCallAndTransferOwnership(
     FunctionCall* function_call) {
-  ClientCaptureEvent event;
-  event.set_allocated_function_call(function_call);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_function_call(function_call);
 }
 
 void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_event) {
@@ -172,8 +189,8 @@ void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_even
     SendInternedStringEvent(timeline_key, full_gpu_job_event->timeline());
   }
 
-  ClientCaptureEvent event;
-  GpuJob* gpu_job_event = event.mutable_gpu_job();
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  GpuJob* gpu_job_event = event->mutable_gpu_job();
   gpu_job_event->set_pid(full_gpu_job_event->pid());
   gpu_job_event->set_tid(full_gpu_job_event->tid());
   gpu_job_event->set_context(full_gpu_job_event->context());
@@ -185,7 +202,6 @@ void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_even
   gpu_job_event->set_gpu_hardware_start_time_ns(full_gpu_job_event->gpu_hardware_start_time_ns());
   gpu_job_event->set_dma_fence_signaled_time_ns(full_gpu_job_event->dma_fence_signaled_time_ns());
   gpu_job_event->set_timeline_key(timeline_key);
-  capture_event_buffer_->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
@@ -198,9 +214,8 @@ void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
     mutable_marker.set_text_key(it->second);
   }
 
-  ClientCaptureEvent event;
-  event.set_allocated_gpu_queue_submission(gpu_queue_submission);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_gpu_queue_submission(gpu_queue_submission);
 }
 
 void ProducerEventProcessorImpl::ProcessFullCallstackSample(
@@ -211,20 +226,18 @@ void ProducerEventProcessorImpl::ProcessFullCallstackSample(
   auto [callstack_id, assigned] = callstack_pool_.GetOrAssignId(callstack_data);
 
   if (assigned) {
-    ClientCaptureEvent interned_callstack_event;
-    interned_callstack_event.mutable_interned_callstack()->set_key(callstack_id);
-    interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
+    ClientCaptureEvent* interned_callstack_event = CreateClientCaptureEvent();
+    interned_callstack_event->mutable_interned_callstack()->set_key(callstack_id);
+    interned_callstack_event->mutable_interned_callstack()->set_allocated_intern(
         full_callstack_sample->release_callstack());
-    capture_event_buffer_->AddEvent(std::move(interned_callstack_event));
   }
 
-  ClientCaptureEvent callstack_sample_event;
-  CallstackSample* callstack_sample = callstack_sample_event.mutable_callstack_sample();
+  ClientCaptureEvent* callstack_sample_event = CreateClientCaptureEvent();
+  CallstackSample* callstack_sample = callstack_sample_event->mutable_callstack_sample();
   callstack_sample->set_pid(full_callstack_sample->pid());
   callstack_sample->set_tid(full_callstack_sample->tid());
   callstack_sample->set_timestamp_ns(full_callstack_sample->timestamp_ns());
   callstack_sample->set_callstack_id(callstack_id);
-  capture_event_buffer_->AddEvent(std::move(callstack_sample_event));
 }
 
 void ProducerEventProcessorImpl::ProcessInternedCallstack(uint64_t producer_id,
@@ -247,9 +260,8 @@ void ProducerEventProcessorImpl::ProcessInternedCallstack(uint64_t producer_id,
 
   // If this is first time we see it -> send it over with client_id
   interned_callstack->set_key(interned_callstack_id);
-  ClientCaptureEvent event;
-  *event.mutable_interned_callstack() = std::move(*interned_callstack);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  *event->mutable_interned_callstack() = std::move(*interned_callstack);
 }
 
 void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
@@ -261,9 +273,8 @@ void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
   CHECK(it != producer_interned_callstack_id_to_client_callstack_id_.end());
   callstack_sample->set_callstack_id(it->second);
 
-  ClientCaptureEvent event;
-  event.set_allocated_callstack_sample(callstack_sample);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_callstack_sample(callstack_sample);
 }
 
 void ProducerEventProcessorImpl::ProcessInternedString(uint64_t producer_id,
@@ -282,64 +293,55 @@ void ProducerEventProcessorImpl::ProcessInternedString(uint64_t producer_id,
 
   interned_string->set_key(client_string_id);
 
-  ClientCaptureEvent event;
-  *event.mutable_interned_string() = std::move(*interned_string);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  *event->mutable_interned_string() = std::move(*interned_string);
 }
 
 void ProducerEventProcessorImpl::ProcessIntrospectionScopeAndTransferOwnership(
     IntrospectionScope* introspection_scope) {
-  ClientCaptureEvent event;
-  event.set_allocated_introspection_scope(introspection_scope);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_introspection_scope(introspection_scope);
 }
 
 void ProducerEventProcessorImpl::ProcessModuleUpdateEventAndTransferOwnership(
     orbit_grpc_protos::ModuleUpdateEvent* module_update_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_module_update_event(module_update_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_module_update_event(module_update_event);
 }
 
 void ProducerEventProcessorImpl::ProcessModulesSnapshotAndTransferOwnership(
     ModulesSnapshot* modules_snapshot) {
-  ClientCaptureEvent event;
-  event.set_allocated_modules_snapshot(modules_snapshot);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_modules_snapshot(modules_snapshot);
 }
 
 void ProducerEventProcessorImpl::ProcessCaptureStartedAndTransferOwnership(
     CaptureStarted* capture_started) {
-  ClientCaptureEvent event;
-  event.set_allocated_capture_started(capture_started);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_capture_started(capture_started);
 }
 
 void ProducerEventProcessorImpl::ProcessSchedulingSliceAndTransferOwnership(
     SchedulingSlice* scheduling_slice) {
-  ClientCaptureEvent event;
-  event.set_allocated_scheduling_slice(scheduling_slice);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_scheduling_slice(scheduling_slice);
 }
 
 void ProducerEventProcessorImpl::ProcessThreadNameAndTransferOwnership(ThreadName* thread_name) {
-  ClientCaptureEvent event;
-  event.set_allocated_thread_name(thread_name);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_thread_name(thread_name);
 }
 
 void ProducerEventProcessorImpl::ProcessThreadNamesSnapshotAndTransferOwnership(
     ThreadNamesSnapshot* thread_names_snapshot) {
-  ClientCaptureEvent event;
-  event.set_allocated_thread_names_snapshot(thread_names_snapshot);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_thread_names_snapshot(thread_names_snapshot);
 }
 
 void ProducerEventProcessorImpl::ProcessThreadStateSliceAndTransferOwnership(
     ThreadStateSlice* thread_state_slice) {
-  ClientCaptureEvent event;
-  event.set_allocated_thread_state_slice(thread_state_slice);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_thread_state_slice(thread_state_slice);
 }
 
 void ProducerEventProcessorImpl::ProcessFullTracepointEvent(
@@ -348,171 +350,206 @@ void ProducerEventProcessorImpl::ProcessFullTracepointEvent(
       tracepoint_pool_.GetOrAssignId({full_tracepoint_event->tracepoint_info().category(),
                                       full_tracepoint_event->tracepoint_info().name()});
   if (assigned) {
-    ClientCaptureEvent event;
-    InternedTracepointInfo* interned_tracepoint_info = event.mutable_interned_tracepoint_info();
+    ClientCaptureEvent* event = CreateClientCaptureEvent();
+    InternedTracepointInfo* interned_tracepoint_info = event->mutable_interned_tracepoint_info();
     interned_tracepoint_info->set_key(tracepoint_key);
     interned_tracepoint_info->set_allocated_intern(
         full_tracepoint_event->release_tracepoint_info());
-    capture_event_buffer_->AddEvent(std::move(event));
   }
 
-  ClientCaptureEvent event;
-  TracepointEvent* tracepoint_event = event.mutable_tracepoint_event();
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  TracepointEvent* tracepoint_event = event->mutable_tracepoint_event();
   tracepoint_event->set_pid(full_tracepoint_event->pid());
   tracepoint_event->set_tid(full_tracepoint_event->tid());
   tracepoint_event->set_timestamp_ns(full_tracepoint_event->timestamp_ns());
   tracepoint_event->set_cpu(full_tracepoint_event->cpu());
   tracepoint_event->set_tracepoint_info_key(tracepoint_key);
-  capture_event_buffer_->AddEvent(std::move(event));
 }
 
 void ProducerEventProcessorImpl::ProcessMemoryUsageEventAndTransferOwnership(
     MemoryUsageEvent* memory_usage_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_memory_usage_event(memory_usage_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_memory_usage_event(memory_usage_event);
 }
 
-void ProducerEventProcessorImpl::ProcessApiEventAndTransferOwnership(ApiEvent* api_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_api_event(api_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+void ProducerEventProcessorImpl::ProcessApiEventAndTransferOwnership(uint64_t producer_id,
+                                                                     ApiEvent* api_event) {
+  // Translate the key of the interned name
+  if (api_event->name_key() != 0) {
+    auto it = producer_interned_string_id_to_client_string_id_.find(
+        {producer_id, api_event->name_key()});
+    CHECK(it != producer_interned_string_id_to_client_string_id_.end());
+    api_event->set_name_key(it->second);
+  }
+
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_api_event(api_event);
 }
 
 void ProducerEventProcessorImpl::ProcessWarningEventAndTransferOwnership(
     WarningEvent* warning_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_warning_event(warning_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_warning_event(warning_event);
 }
 
 void ProducerEventProcessorImpl::ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
     ErrorEnablingOrbitApiEvent* error_enabling_orbit_api_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_error_enabling_orbit_api_event(error_enabling_orbit_api_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_error_enabling_orbit_api_event(error_enabling_orbit_api_event);
 }
 
 void ProducerEventProcessorImpl::ProcessClockResolutionEventAndTransferOwnership(
     ClockResolutionEvent* clock_resolution_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_clock_resolution_event(clock_resolution_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_clock_resolution_event(clock_resolution_event);
 }
 
 void ProducerEventProcessorImpl::ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
     ErrorsWithPerfEventOpenEvent* errors_with_perf_event_open_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_errors_with_perf_event_open_event(errors_with_perf_event_open_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_errors_with_perf_event_open_event(errors_with_perf_event_open_event);
 }
 
 void ProducerEventProcessorImpl::ProcessLostPerfRecordsEventAndTransferOwnership(
     LostPerfRecordsEvent* lost_perf_records_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_lost_perf_records_event(lost_perf_records_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_lost_perf_records_event(lost_perf_records_event);
 }
 
 void ProducerEventProcessorImpl::ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
     OutOfOrderEventsDiscardedEvent* out_of_order_events_discarded_event) {
-  ClientCaptureEvent event;
-  event.set_allocated_out_of_order_events_discarded_event(out_of_order_events_discarded_event);
-  capture_event_buffer_->AddEvent(std::move(event));
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  event->set_allocated_out_of_order_events_discarded_event(out_of_order_events_discarded_event);
 }
 
-void ProducerEventProcessorImpl::ProcessEvent(uint64_t producer_id, ProducerCaptureEvent event) {
-  switch (event.event_case()) {
+void ProducerEventProcessorImpl::ProcessEventInternal(uint64_t producer_id,
+                                                      ProducerCaptureEvent* event) {
+  switch (event->event_case()) {
     case ProducerCaptureEvent::kCaptureStarted:
-      ProcessCaptureStartedAndTransferOwnership(event.release_capture_started());
+      ProcessCaptureStartedAndTransferOwnership(event->release_capture_started());
       break;
     case ProducerCaptureEvent::kInternedCallstack:
-      ProcessInternedCallstack(producer_id, event.mutable_interned_callstack());
+      ProcessInternedCallstack(producer_id, event->mutable_interned_callstack());
       break;
     case ProducerCaptureEvent::kSchedulingSlice:
-      ProcessSchedulingSliceAndTransferOwnership(event.release_scheduling_slice());
+      ProcessSchedulingSliceAndTransferOwnership(event->release_scheduling_slice());
       break;
     case ProducerCaptureEvent::kCallstackSample:
-      ProcessCallstackSampleAndTransferOwnership(producer_id, event.release_callstack_sample());
+      ProcessCallstackSampleAndTransferOwnership(producer_id, event->release_callstack_sample());
       break;
     case ProducerCaptureEvent::kFullCallstackSample:
-      ProcessFullCallstackSample(event.mutable_full_callstack_sample());
+      ProcessFullCallstackSample(event->mutable_full_callstack_sample());
       break;
     case ProducerCaptureEvent::kFullTracepointEvent:
-      ProcessFullTracepointEvent(event.mutable_full_tracepoint_event());
+      ProcessFullTracepointEvent(event->mutable_full_tracepoint_event());
       break;
     case ProducerCaptureEvent::kFunctionCall:
-      ProcessFunctionCallAndTransferOwnership(event.release_function_call());
+      ProcessFunctionCallAndTransferOwnership(event->release_function_call());
       break;
     case ProducerCaptureEvent::kInternedString:
-      ProcessInternedString(producer_id, event.mutable_interned_string());
+      ProcessInternedString(producer_id, event->mutable_interned_string());
       break;
     case ProducerCaptureEvent::kFullGpuJob:
-      ProcessFullGpuJob(event.mutable_full_gpu_job());
+      ProcessFullGpuJob(event->mutable_full_gpu_job());
       break;
     case ProducerCaptureEvent::kGpuQueueSubmission:
       ProcessGpuQueueSubmissionAndTransferOwnership(producer_id,
-                                                    event.release_gpu_queue_submission());
+                                                    event->release_gpu_queue_submission());
       break;
     case ProducerCaptureEvent::kThreadName:
-      ProcessThreadNameAndTransferOwnership(event.release_thread_name());
+      ProcessThreadNameAndTransferOwnership(event->release_thread_name());
       break;
     case ProducerCaptureEvent::kThreadNamesSnapshot:
-      ProcessThreadNamesSnapshotAndTransferOwnership(event.release_thread_names_snapshot());
+      ProcessThreadNamesSnapshotAndTransferOwnership(event->release_thread_names_snapshot());
       break;
     case ProducerCaptureEvent::kThreadStateSlice:
-      ProcessThreadStateSliceAndTransferOwnership(event.release_thread_state_slice());
+      ProcessThreadStateSliceAndTransferOwnership(event->release_thread_state_slice());
       break;
     case ProducerCaptureEvent::kFullAddressInfo:
-      ProcessFullAddressInfo(event.mutable_full_address_info());
+      ProcessFullAddressInfo(event->mutable_full_address_info());
       break;
     case ProducerCaptureEvent::kIntrospectionScope:
-      ProcessIntrospectionScopeAndTransferOwnership(event.release_introspection_scope());
+      ProcessIntrospectionScopeAndTransferOwnership(event->release_introspection_scope());
       break;
     case ProducerCaptureEvent::kModuleUpdateEvent:
-      ProcessModuleUpdateEventAndTransferOwnership(event.release_module_update_event());
+      ProcessModuleUpdateEventAndTransferOwnership(event->release_module_update_event());
       break;
     case ProducerCaptureEvent::kModulesSnapshot:
-      ProcessModulesSnapshotAndTransferOwnership(event.release_modules_snapshot());
+      ProcessModulesSnapshotAndTransferOwnership(event->release_modules_snapshot());
       break;
     case ProducerCaptureEvent::kMemoryUsageEvent:
-      ProcessMemoryUsageEventAndTransferOwnership(event.release_memory_usage_event());
+      ProcessMemoryUsageEventAndTransferOwnership(event->release_memory_usage_event());
       break;
     case ProducerCaptureEvent::kApiEvent:
-      ProcessApiEventAndTransferOwnership(event.release_api_event());
+      ProcessApiEventAndTransferOwnership(producer_id, event->release_api_event());
       break;
     case ProducerCaptureEvent::kWarningEvent:
-      ProcessWarningEventAndTransferOwnership(event.release_warning_event());
+      ProcessWarningEventAndTransferOwnership(event->release_warning_event());
       break;
     case ProducerCaptureEvent::kClockResolutionEvent:
-      ProcessClockResolutionEventAndTransferOwnership(event.release_clock_resolution_event());
+      ProcessClockResolutionEventAndTransferOwnership(event->release_clock_resolution_event());
       break;
     case ProducerCaptureEvent::kErrorsWithPerfEventOpenEvent:
       ProcessErrorsWithPerfEventOpenEventAndTransferOwnership(
-          event.release_errors_with_perf_event_open_event());
+          event->release_errors_with_perf_event_open_event());
       break;
     case ProducerCaptureEvent::kErrorEnablingOrbitApiEvent:
       ProcessErrorEnablingOrbitApiEventAndTransferOwnership(
-          event.release_error_enabling_orbit_api_event());
+          event->release_error_enabling_orbit_api_event());
       break;
     case ProducerCaptureEvent::kLostPerfRecordsEvent:
-      ProcessLostPerfRecordsEventAndTransferOwnership(event.release_lost_perf_records_event());
+      ProcessLostPerfRecordsEventAndTransferOwnership(event->release_lost_perf_records_event());
       break;
     case ProducerCaptureEvent::kOutOfOrderEventsDiscardedEvent:
       ProcessOutOfOrderEventsDiscardedEventAndTransferOwnership(
-          event.release_out_of_order_events_discarded_event());
+          event->release_out_of_order_events_discarded_event());
       break;
     case ProducerCaptureEvent::EVENT_NOT_SET:
       UNREACHABLE();
   }
 }
 
+void ProducerEventProcessorImpl::ProcessEvent(uint64_t producer_id, ProducerCaptureEvent event) {
+  absl::MutexLock lock{&mutex_};
+  capture_event_buffer_->AddEvents(
+      [this, producer_id, &event](google::protobuf::Arena* arena,
+                                  std::vector<ClientCaptureEvent*>* client_capture_events) {
+        arena_ = arena;
+        client_capture_events_ = client_capture_events;
+        ProcessEventInternal(producer_id, &event);
+        arena_ = nullptr;
+        client_capture_events_ = nullptr;
+      });
+}
+
+void ProducerEventProcessorImpl::ProcessEvents(
+    uint64_t producer_id, google::protobuf::RepeatedPtrField<ProducerCaptureEvent>* events) {
+  absl::MutexLock lock{&mutex_};
+  capture_event_buffer_->AddEvents(
+      [this, producer_id, events](google::protobuf::Arena* arena,
+                                  std::vector<ClientCaptureEvent*>* client_capture_events) {
+        arena_ = arena;
+        client_capture_events_ = client_capture_events;
+        for (ProducerCaptureEvent& event : *events) {
+          ProcessEventInternal(producer_id, &event);
+        }
+        arena_ = nullptr;
+        client_capture_events_ = nullptr;
+      });
+}
+
+ClientCaptureEvent* ProducerEventProcessorImpl::CreateClientCaptureEvent() {
+  CHECK(arena_ != nullptr);
+  auto* event = google::protobuf::Arena::CreateMessage<ClientCaptureEvent>(arena_);
+  client_capture_events_->push_back(event);
+  return event;
+}
+
 void ProducerEventProcessorImpl::SendInternedStringEvent(uint64_t key, std::string value) {
-  ClientCaptureEvent event;
-  InternedString* interned_string = event.mutable_interned_string();
+  ClientCaptureEvent* event = CreateClientCaptureEvent();
+  InternedString* interned_string = event->mutable_interned_string();
   interned_string->set_key(key);
   interned_string->set_intern(std::move(value));
-  capture_event_buffer_->AddEvent(std::move(event));
 }
 
 }  // namespace
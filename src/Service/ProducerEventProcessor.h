@@ -5,8 +5,12 @@
 #ifndef SERVICE_PRODUCER_EVENT_PROCESSOR_H_
 #define SERVICE_PRODUCER_EVENT_PROCESSOR_H_
 
+#include <google/protobuf/repeated_field.h>
 #include <stdint.h>
 
+#include <memory>
+#include <utility>
+
 #include "CaptureEventBuffer.h"
 #include "capture.pb.h"
 
@@ -23,6 +27,16 @@ class ProducerEventProcessor {
   virtual void ProcessEvent(uint64_t producer_id,
                             orbit_grpc_protos::ProducerCaptureEvent event) = 0;
 
+  // Processes a whole batch of events from the same producer, e.g., all the events of a
+  // ReceiveCommandsAndSendEventsRequest. Implementations can move from the events.
+  virtual void ProcessEvents(
+      uint64_t producer_id,
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* events) {
+    for (orbit_grpc_protos::ProducerCaptureEvent& event : *events) {
+      ProcessEvent(producer_id, std::move(event));
+    }
+  }
+
   static std::unique_ptr<ProducerEventProcessor> Create(CaptureEventBuffer* capture_event_buffer);
 };
 
@@ -4,6 +4,7 @@
 
 #include <GrpcProtos/Constants.h>
 #include <gmock/gmock.h>
+#include <google/protobuf/repeated_field.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
 
@@ -15,6 +16,7 @@ namespace orbit_service {
 namespace {
 
 using orbit_grpc_protos::AddressInfo;
+using orbit_grpc_protos::ApiEvent;
 using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::CallstackSample;
 using orbit_grpc_protos::CaptureOptions;
@@ -574,6 +576,54 @@ TEST(ProducerEventProcessor, FullCallstackSampleDifferentCallstacks) {
   EXPECT_EQ(callstack_sample2.callstack_id(), interned_callstack2.key());
 }
 
+TEST(ProducerEventProcessor, ProcessEventsBatch) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  google::protobuf::RepeatedPtrField<ProducerCaptureEvent> events;
+  for (uint64_t timestamp_ns : {kTimestampNs1, kTimestampNs2}) {
+    FullCallstackSample* full_callstack_sample = events.Add()->mutable_full_callstack_sample();
+    full_callstack_sample->set_pid(kPid1);
+    full_callstack_sample->set_tid(kTid1);
+    full_callstack_sample->set_timestamp_ns(timestamp_ns);
+    Callstack* callstack = full_callstack_sample->mutable_callstack();
+    callstack->add_pcs(1);
+    callstack->add_pcs(2);
+    callstack->set_type(Callstack::kComplete);
+  }
+  SchedulingSlice* scheduling_slice = events.Add()->mutable_scheduling_slice();
+  scheduling_slice->set_tid(kTid2);
+  scheduling_slice->set_out_timestamp_ns(kTimestampNs2);
+
+  ClientCaptureEvent interned_callstack_event;
+  ClientCaptureEvent callstack_sample_event1;
+  ClientCaptureEvent callstack_sample_event2;
+  ClientCaptureEvent scheduling_slice_event;
+  EXPECT_CALL(buffer, AddEvent)
+      .Times(4)
+      .WillOnce(SaveArg<0>(&interned_callstack_event))
+      .WillOnce(SaveArg<0>(&callstack_sample_event1))
+      .WillOnce(SaveArg<0>(&callstack_sample_event2))
+      .WillOnce(SaveArg<0>(&scheduling_slice_event));
+
+  producer_event_processor->ProcessEvents(kDefaultProducerId, &events);
+
+  ASSERT_EQ(interned_callstack_event.event_case(), ClientCaptureEvent::kInternedCallstack);
+  const uint64_t callstack_key = interned_callstack_event.interned_callstack().key();
+  EXPECT_EQ(interned_callstack_event.interned_callstack().intern().pcs_size(), 2);
+
+  ASSERT_EQ(callstack_sample_event1.event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(callstack_sample_event1.callstack_sample().timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(callstack_sample_event1.callstack_sample().callstack_id(), callstack_key);
+  ASSERT_EQ(callstack_sample_event2.event_case(), ClientCaptureEvent::kCallstackSample);
+  EXPECT_EQ(callstack_sample_event2.callstack_sample().timestamp_ns(), kTimestampNs2);
+  EXPECT_EQ(callstack_sample_event2.callstack_sample().callstack_id(), callstack_key);
+
+  ASSERT_EQ(scheduling_slice_event.event_case(), ClientCaptureEvent::kSchedulingSlice);
+  EXPECT_EQ(scheduling_slice_event.scheduling_slice().tid(), kTid2);
+  EXPECT_EQ(scheduling_slice_event.scheduling_slice().out_timestamp_ns(), kTimestampNs2);
+}
+
 TEST(ProducerEventProcessor, FullCallstackSampleSameFramesDifferentTypes) {
   MockCaptureEventBuffer buffer;
   auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
@@ -1738,6 +1788,49 @@ TEST(ProducerEventProcessor, ErrorEnablingOrbitApiEvent) {
   EXPECT_EQ(actual_error_enabling_orbit_api_event.message(), kMessage);
 }
 
+TEST(ProducerEventProcessor, ApiEventWithInternedName) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent interned_string_event = CreateInternedStringEvent(kKey1, "name");
+  ProducerCaptureEvent api_event_with_name_key;
+  ApiEvent* api_event = api_event_with_name_key.mutable_api_event();
+  api_event->set_pid(kPid1);
+  api_event->set_tid(kTid1);
+  api_event->set_timestamp_ns(kTimestampNs1);
+  api_event->set_name_key(kKey1);
+  ProducerCaptureEvent api_event_without_name_key;
+  api_event_without_name_key.mutable_api_event()->set_timestamp_ns(kTimestampNs2);
+
+  ClientCaptureEvent client_interned_string_event;
+  ClientCaptureEvent client_api_event_with_name_key;
+  ClientCaptureEvent client_api_event_without_name_key;
+  EXPECT_CALL(buffer, AddEvent)
+      .Times(3)
+      .WillOnce(SaveArg<0>(&client_interned_string_event))
+      .WillOnce(SaveArg<0>(&client_api_event_with_name_key))
+      .WillOnce(SaveArg<0>(&client_api_event_without_name_key));
+
+  producer_event_processor->ProcessEvent(kDefaultProducerId, interned_string_event);
+  producer_event_processor->ProcessEvent(kDefaultProducerId, api_event_with_name_key);
+  producer_event_processor->ProcessEvent(kDefaultProducerId, api_event_without_name_key);
+
+  ASSERT_EQ(client_interned_string_event.event_case(), ClientCaptureEvent::kInternedString);
+  const uint64_t client_key = client_interned_string_event.interned_string().key();
+  EXPECT_EQ(client_interned_string_event.interned_string().intern(), "name");
+
+  ASSERT_EQ(client_api_event_with_name_key.event_case(), ClientCaptureEvent::kApiEvent);
+  const ApiEvent& actual_api_event = client_api_event_with_name_key.api_event();
+  EXPECT_EQ(actual_api_event.pid(), kPid1);
+  EXPECT_EQ(actual_api_event.tid(), kTid1);
+  EXPECT_EQ(actual_api_event.timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(actual_api_event.name_key(), client_key);
+
+  ASSERT_EQ(client_api_event_without_name_key.event_case(), ClientCaptureEvent::kApiEvent);
+  EXPECT_EQ(client_api_event_without_name_key.api_event().timestamp_ns(), kTimestampNs2);
+  EXPECT_EQ(client_api_event_without_name_key.api_event().name_key(), 0);
+}
+
 TEST(ProducerEventProcessor, LostPerfRecordsEvent) {
   MockCaptureEventBuffer buffer;
   auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
@@ -7,16 +7,21 @@
 #include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
 
+#include <memory>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+#include "SharedMemoryEventReader.h"
 #include "capture.pb.h"
 
 namespace orbit_service {
 
 using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
 
 void ProducerSideServiceImpl::OnCaptureStartRequested(
     orbit_grpc_protos::CaptureOptions capture_options,
@@ -356,6 +361,9 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
     uint64_t producer_id, bool* all_events_sent_received) {
   orbit_base::SetCurrentThreadName("PSSI::RcvEvents");
 
+  // Set when the producer sends its events for the current capture through shared memory.
+  std::unique_ptr<SharedMemoryEventReader> shared_memory_event_reader;
+
   orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
   while (stream->Read(&request)) {
     {
@@ -368,21 +376,43 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
     switch (request.event_case()) {
       case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kBufferedCaptureEvents: {
         // We use ReaderMutexLock because the mutex guards the value of producer_event_processor_,
-        // it does not guard calls to ProcessEvent nor the internal state of the object implementing
-        // the interface. The interface implementation is by itself thread-safe.
+        // it does not guard calls to ProcessEvents nor the internal state of the object
+        // implementing the interface. The interface implementation is by itself thread-safe.
         absl::ReaderMutexLock lock{&producer_event_processor_mutex_};
         // producer_event_processor_ can be nullptr if a producer sends events while not capturing.
         // Don't log an error in such a case as it could easily spam the logs.
         if (producer_event_processor_ != nullptr) {
-          for (ProducerCaptureEvent& event :
-               *request.mutable_buffered_capture_events()->mutable_capture_events()) {
-            producer_event_processor_->ProcessEvent(producer_id, std::move(event));
-          }
+          producer_event_processor_->ProcessEvents(
+              producer_id, request.mutable_buffered_capture_events()->mutable_capture_events());
+        }
+      } break;
+
+      case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryBufferCreated: {
+        LOG("Received SharedMemoryBufferCreated from CaptureEventProducer");
+        // A producer creates a new buffer for each capture: finish reading the previous one.
+        shared_memory_event_reader.reset();
+        const auto& shared_memory_buffer_created = request.shared_memory_buffer_created();
+        auto ring_buffer_or_error = SharedMemoryRingBuffer::OpenAndUnlink(
+            shared_memory_buffer_created.name(), shared_memory_buffer_created.size());
+        if (ring_buffer_or_error.has_error()) {
+          ERROR("%s", ring_buffer_or_error.error().message());
+          break;
         }
+        shared_memory_event_reader = std::make_unique<SharedMemoryEventReader>(
+            std::move(ring_buffer_or_error.value()),
+            [this,
+             producer_id](google::protobuf::RepeatedPtrField<ProducerCaptureEvent>* events) {
+              absl::ReaderMutexLock lock{&producer_event_processor_mutex_};
+              if (producer_event_processor_ == nullptr) return;
+              producer_event_processor_->ProcessEvents(producer_id, events);
+            });
       } break;
 
       case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent: {
         LOG("Received AllEventsSent from CaptureEventProducer");
+        // The producer has written all its events to shared memory before sending AllEventsSent:
+        // make sure they have all been processed before considering the producer done.
+        shared_memory_event_reader.reset();
         absl::MutexLock lock{&service_state_mutex_};
         switch (service_state_.capture_status) {
           case CaptureStatus::kCaptureStarted: {
@@ -416,6 +446,7 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
   }
 
   ERROR("Receiving ReceiveCommandsAndSendEventsRequest from CaptureEventProducer");
+  shared_memory_event_reader.reset();
   {
     absl::MutexLock lock{&service_state_mutex_};
     // Producer has disconnected: treat this as if it had sent all its CaptureEvents.
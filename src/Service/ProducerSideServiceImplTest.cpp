@@ -13,9 +13,11 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <thread>
 
 #include "CaptureEventBuffer.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "ProducerSideServiceImpl.h"
 #include "capture.pb.h"
 #include "grpcpp/grpcpp.h"
@@ -75,6 +77,15 @@ class FakeProducer {
     EXPECT_TRUE(written);
   }
 
+  void SendSharedMemoryBufferCreated(const std::string& name, uint64_t size) {
+    ASSERT_NE(stream_, nullptr);
+    orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
+    request.mutable_shared_memory_buffer_created()->set_name(name);
+    request.mutable_shared_memory_buffer_created()->set_size(size);
+    bool written = stream_->Write(request);
+    EXPECT_TRUE(written);
+  }
+
   void SendAllEventsSent() {
     ASSERT_NE(stream_, nullptr);
     orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
@@ -208,6 +219,56 @@ TEST_F(ProducerSideServiceImplTest, OneCapture) {
                           2 * kSendAllEventsDelayMs);
 }
 
+TEST_F(ProducerSideServiceImplTest, OneCaptureThroughSharedMemory) {
+  MockProducerEventProcessor mock_processor;
+
+  EXPECT_CALL(*fake_producer_, OnStartCaptureCommandReceived).Times(1);
+  service_->OnCaptureStartRequested(kFakeCaptureOptions, &mock_processor);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_producer_);
+
+  auto ring_buffer_or_error =
+      orbit_producer_side_channel::SharedMemoryRingBuffer::Create(/*capacity=*/4096);
+  ASSERT_FALSE(ring_buffer_or_error.has_error());
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> ring_buffer =
+      std::move(ring_buffer_or_error.value());
+  fake_producer_->SendSharedMemoryBufferCreated(ring_buffer->GetName(), ring_buffer->GetSize());
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  auto write_api_event_records = [&ring_buffer](uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+      orbit_producer_side_channel::SharedMemoryApiEventRecord record{};
+      record.timestamp_ns = i;
+      EXPECT_TRUE(ring_buffer->TryWriteRecord(
+          orbit_producer_side_channel::SharedMemoryRecordType::kApiEvent, record));
+    }
+  };
+
+  EXPECT_CALL(mock_processor,
+              ProcessEvent(orbit_grpc_protos::kExternalProducerStartingId, testing::_))
+      .Times(3);
+  write_api_event_records(3);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+
+  // Records written right before AllEventsSent must be processed before the capture is finished.
+  EXPECT_CALL(mock_processor, ProcessEvent).Times(2);
+  ON_CALL(*fake_producer_, OnStopCaptureCommandReceived)
+      .WillByDefault([this, &write_api_event_records] {
+        write_api_event_records(2);
+        fake_producer_->SendAllEventsSent();
+      });
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(*fake_producer_, OnStopCaptureCommandReceived).Times(1);
+    EXPECT_CALL(*fake_producer_, OnCaptureFinishedCommandReceived).Times(1);
+  }
+  service_->OnCaptureStopRequested();
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+}
+
 TEST_F(ProducerSideServiceImplTest, TwoCaptures) {
   MockProducerEventProcessor mock_processor;
 
@@ -0,0 +1,166 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SenderThreadCaptureEventBuffer.h"
+
+#include <absl/time/time.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+SenderThreadCaptureEventBuffer::EventBatch::EventBatch() {
+  // The initial block is kept when the arena is reset, so that a batch of typical size doesn't need
+  // any allocation.
+  constexpr size_t kArenaInitialBlockSize = 1024 * 1024;
+  arena_initial_block = make_unique_for_overwrite<char[]>(kArenaInitialBlockSize);
+  google::protobuf::ArenaOptions arena_options;
+  arena_options.initial_block = arena_initial_block.get();
+  arena_options.initial_block_size = kArenaInitialBlockSize;
+  arena = std::make_unique<google::protobuf::Arena>(arena_options);
+}
+
+SenderThreadCaptureEventBuffer::SenderThreadCaptureEventBuffer(CaptureEventSender* event_sender)
+    : current_window_{std::make_unique<SendWindow>()},
+      spare_window_{std::make_unique<SendWindow>()},
+      capture_event_sender_{event_sender} {
+  CHECK(capture_event_sender_ != nullptr);
+  sender_thread_ = std::thread{[this] { SenderThread(); }};
+}
+
+SenderThreadCaptureEventBuffer::~SenderThreadCaptureEventBuffer() {
+  CHECK(!sender_thread_.joinable());
+}
+
+void SenderThreadCaptureEventBuffer::AddEvent(ClientCaptureEvent&& event) {
+  absl::MutexLock lock{&event_buffer_mutex_};
+  if (stop_requested_) {
+    return;
+  }
+  // Moving into a message allocated in the arena would copy it, so just let the arena own it.
+  auto* heap_event = new ClientCaptureEvent{std::move(event)};
+  current_window_->arena.Own(heap_event);
+  current_window_->events.push_back(heap_event);
+}
+
+void SenderThreadCaptureEventBuffer::AddEvents(BuildEventsFunction build_events) {
+  SendWindow* window;
+  EventBatch* batch;
+  {
+    absl::MutexLock lock{&event_buffer_mutex_};
+    if (stop_requested_) {
+      return;
+    }
+    window = current_window_.get();
+    if (window->idle_batches.empty()) {
+      std::unique_ptr<EventBatch> new_batch;
+      {
+        absl::MutexLock free_batches_lock{&free_batches_mutex_};
+        if (!free_batches_.empty()) {
+          new_batch = std::move(free_batches_.back());
+          free_batches_.pop_back();
+        } else {
+          new_batch = std::make_unique<EventBatch>();
+          ++allocated_batch_count_;
+        }
+      }
+      window->idle_batches.push_back(new_batch.get());
+      window->batches.push_back(std::move(new_batch));
+    }
+    batch = window->idle_batches.back();
+    window->idle_batches.pop_back();
+    ++window->busy_batch_count;
+  }
+
+  // Building the events can take a while for large batches, so don't block the sender thread and
+  // the other producers meanwhile. The window can be swapped out in the meantime, but the sender
+  // thread waits for this call to be done with the batch before sending it.
+  build_events(batch->arena.get(), &batch->events);
+
+  absl::MutexLock lock{&event_buffer_mutex_};
+  window->events.insert(window->events.end(), batch->events.begin(), batch->events.end());
+  batch->events.clear();
+  window->idle_batches.push_back(batch);
+  --window->busy_batch_count;
+}
+
+uint64_t SenderThreadCaptureEventBuffer::GetAllocatedEventBatchCount() {
+  absl::MutexLock lock{&free_batches_mutex_};
+  return allocated_batch_count_;
+}
+
+void SenderThreadCaptureEventBuffer::StopAndWait() {
+  CHECK(sender_thread_.joinable());
+  {
+    // Protect stop_requested_ with event_buffer_mutex_ so that we can use stop_requested_
+    // in Conditions for Await/LockWhen (specifically, in SenderThread).
+    absl::MutexLock lock{&event_buffer_mutex_};
+    stop_requested_ = true;
+  }
+  sender_thread_.join();
+}
+
+void SenderThreadCaptureEventBuffer::RecycleBatches(
+    std::vector<std::unique_ptr<EventBatch>>* batches) {
+  // Keeping a few batches is enough to avoid allocations, as there are only a few producers.
+  constexpr size_t kMaxFreeBatchCount = 8;
+  for (std::unique_ptr<EventBatch>& batch : *batches) {
+    batch->arena->Reset();
+  }
+  absl::MutexLock lock{&free_batches_mutex_};
+  for (std::unique_ptr<EventBatch>& batch : *batches) {
+    if (free_batches_.size() >= kMaxFreeBatchCount) break;
+    free_batches_.push_back(std::move(batch));
+  }
+  batches->clear();
+}
+
+void SenderThreadCaptureEventBuffer::SenderThread() {
+  pthread_setname_np(pthread_self(), "SenderThread");
+  constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(20);
+  // This should be lower than kMaxEventsPerResponse in GrpcCaptureEventSender::SendEvents
+  // as a few more events are likely to arrive after the condition becomes true.
+  constexpr uint64_t kSendEventCountInterval = 5000;
+
+  bool stopped = false;
+  while (!stopped) {
+    ORBIT_SCOPE("SenderThread iteration");
+    event_buffer_mutex_.LockWhenWithTimeout(absl::Condition(
+                                                +[](SenderThreadCaptureEventBuffer* self) {
+                                                  return self->current_window_->events.size() >=
+                                                             kSendEventCountInterval ||
+                                                         self->stop_requested_;
+                                                },
+                                                this),
+                                            kSendTimeInterval);
+    if (stop_requested_) {
+      stopped = true;
+    }
+    std::unique_ptr<SendWindow> window_to_send = std::move(current_window_);
+    current_window_ = std::move(spare_window_);
+    // Wait for the calls to AddEvents that are still building events in the batches of the window.
+    SendWindow* window_to_send_ptr = window_to_send.get();
+    event_buffer_mutex_.Await(absl::Condition(
+        +[](SendWindow* window) { return window->busy_batch_count == 0; }, window_to_send_ptr));
+    event_buffer_mutex_.Unlock();
+
+    capture_event_sender_->SendEvents(window_to_send->events);
+    window_to_send->events.clear();
+    window_to_send->arena.Reset();
+    window_to_send->idle_batches.clear();
+    RecycleBatches(&window_to_send->batches);
+    spare_window_ = std::move(window_to_send);
+  }
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
+#define ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <google/protobuf/arena.h>
+#include <stdint.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventBuffer.h"
+#include "CaptureEventSender.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// CaptureEventBuffer that passes the buffered events to a CaptureEventSender every 20 ms, or as
+// soon as enough events have accumulated, on a dedicated thread.
+// Events are collected in send windows. AddEvents lets the caller build events directly in the
+// Arena of one of the batches of the current window, without holding the lock of the buffer. A
+// window only gets a new batch when all its batches are in use by other callers, so the number of
+// batches, and of Arenas, is bounded by the number of concurrent callers, however many events are
+// added one at a time. The sender thread alternates between two windows and recycles the batches
+// it has sent, so that their memory is reused from one window to the next.
+class SenderThreadCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  explicit SenderThreadCaptureEventBuffer(CaptureEventSender* event_sender);
+  ~SenderThreadCaptureEventBuffer() override;
+
+  void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override;
+  void AddEvents(BuildEventsFunction build_events) override;
+
+  void StopAndWait();
+
+  // The number of batches, each with its own Arena, that have been allocated so far.
+  [[nodiscard]] uint64_t GetAllocatedEventBatchCount();
+
+ private:
+  // An Arena, which owns the events that AddEvents built in it, possibly over several calls.
+  struct EventBatch {
+    EventBatch();
+    std::unique_ptr<char[]> arena_initial_block;
+    std::unique_ptr<google::protobuf::Arena> arena;
+    // The events built by the current call to AddEvents.
+    std::vector<orbit_grpc_protos::ClientCaptureEvent*> events;
+  };
+
+  struct SendWindow {
+    // Owns the events added with AddEvent.
+    google::protobuf::Arena arena;
+    std::vector<orbit_grpc_protos::ClientCaptureEvent*> events;
+    // Own the events added with AddEvents, which are also in `events`.
+    std::vector<std::unique_ptr<EventBatch>> batches;
+    // The batches in `batches` that no call to AddEvents is currently building events in.
+    std::vector<EventBatch*> idle_batches;
+    // The window can only be sent once no call to AddEvents is building events in its batches.
+    size_t busy_batch_count = 0;
+  };
+
+  void RecycleBatches(std::vector<std::unique_ptr<EventBatch>>* batches);
+  void SenderThread();
+
+  absl::Mutex event_buffer_mutex_;
+  std::unique_ptr<SendWindow> current_window_ ABSL_GUARDED_BY(event_buffer_mutex_);
+  // Only accessed by the sender thread.
+  std::unique_ptr<SendWindow> spare_window_;
+  absl::Mutex free_batches_mutex_;
+  std::vector<std::unique_ptr<EventBatch>> free_batches_ ABSL_GUARDED_BY(free_batches_mutex_);
+  uint64_t allocated_batch_count_ ABSL_GUARDED_BY(free_batches_mutex_) = 0;
+  CaptureEventSender* capture_event_sender_;
+  std::thread sender_thread_;
+  bool stop_requested_ ABSL_GUARDED_BY(event_buffer_mutex_) = false;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
@@ -0,0 +1,169 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <absl/types/span.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/repeated_field.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "CaptureEventSender.h"
+#include "OrbitBase/Logging.h"
+#include "ProducerEventProcessor.h"
+#include "SenderThreadCaptureEventBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+namespace {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::ProducerCaptureEvent;
+
+class FakeCaptureEventSender : public CaptureEventSender {
+ public:
+  void SendEvents(absl::Span<ClientCaptureEvent* const> events) override {
+    absl::MutexLock lock{&mutex_};
+    if (keep_events_) {
+      // The events are only valid during the call.
+      for (const ClientCaptureEvent* event : events) {
+        sent_events_.push_back(*event);
+      }
+    }
+    sent_event_count_ += events.size();
+  }
+
+  void set_keep_events(bool keep_events) {
+    absl::MutexLock lock{&mutex_};
+    keep_events_ = keep_events;
+  }
+  [[nodiscard]] std::vector<ClientCaptureEvent> sent_events() {
+    absl::MutexLock lock{&mutex_};
+    return sent_events_;
+  }
+  [[nodiscard]] uint64_t sent_event_count() {
+    absl::MutexLock lock{&mutex_};
+    return sent_event_count_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  bool keep_events_ ABSL_GUARDED_BY(mutex_) = true;
+  std::vector<ClientCaptureEvent> sent_events_ ABSL_GUARDED_BY(mutex_);
+  uint64_t sent_event_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+ClientCaptureEvent CreateSchedulingSliceEvent(uint64_t timestamp_ns) {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(timestamp_ns);
+  return event;
+}
+
+}  // namespace
+
+TEST(SenderThreadCaptureEventBuffer, AddEventAndAddEventsAreSentInOrder) {
+  FakeCaptureEventSender sender;
+  SenderThreadCaptureEventBuffer buffer{&sender};
+
+  constexpr uint64_t kIterationCount = 3;
+  uint64_t timestamp_ns = 0;
+  for (uint64_t i = 0; i < kIterationCount; ++i) {
+    buffer.AddEvent(CreateSchedulingSliceEvent(timestamp_ns++));
+    buffer.AddEvents([&timestamp_ns](google::protobuf::Arena* arena,
+                                     std::vector<ClientCaptureEvent*>* events) {
+      for (int j = 0; j < 2; ++j) {
+        auto* event = google::protobuf::Arena::CreateMessage<ClientCaptureEvent>(arena);
+        event->mutable_scheduling_slice()->set_out_timestamp_ns(timestamp_ns++);
+        events->push_back(event);
+      }
+    });
+    // Let the sender thread send the events, so that the windows and their arenas are reused.
+    absl::SleepFor(absl::Milliseconds(50));
+  }
+  buffer.StopAndWait();
+  // Events added after stopping are discarded.
+  buffer.AddEvent(CreateSchedulingSliceEvent(timestamp_ns));
+
+  std::vector<ClientCaptureEvent> sent_events = sender.sent_events();
+  ASSERT_EQ(sent_events.size(), 3 * kIterationCount);
+  for (uint64_t i = 0; i < sent_events.size(); ++i) {
+    ASSERT_EQ(sent_events[i].event_case(), ClientCaptureEvent::kSchedulingSlice);
+    EXPECT_EQ(sent_events[i].scheduling_slice().out_timestamp_ns(), i);
+  }
+}
+
+TEST(SenderThreadCaptureEventBuffer, AddEventsWithSingleEventsReusesBatches) {
+  FakeCaptureEventSender sender;
+  sender.set_keep_events(false);
+  SenderThreadCaptureEventBuffer buffer{&sender};
+
+  // As ProducerEventProcessor::ProcessEvent does for each event.
+  constexpr uint64_t kEventCount = 100'000;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    buffer.AddEvents([i](google::protobuf::Arena* arena, std::vector<ClientCaptureEvent*>* events) {
+      auto* event = google::protobuf::Arena::CreateMessage<ClientCaptureEvent>(arena);
+      event->mutable_scheduling_slice()->set_out_timestamp_ns(i);
+      events->push_back(event);
+    });
+  }
+  buffer.StopAndWait();
+
+  EXPECT_EQ(sender.sent_event_count(), kEventCount);
+  // A single producer only ever needs one batch in each of the two send windows.
+  EXPECT_LE(buffer.GetAllocatedEventBatchCount(), 2);
+}
+
+// Compares the time spent processing producer events one by one and in batches, from
+// ProducerEventProcessor to the CaptureEventSender. Only prints timings, hence disabled; pass
+// --gtest_also_run_disabled_tests to run it.
+TEST(SenderThreadCaptureEventBuffer, DISABLED_ProducerEventProcessorBatchingBenchmark) {
+  constexpr uint64_t kEventCount = 1'000'000;
+  constexpr int kBatchSize = 1'000;
+
+  google::protobuf::RepeatedPtrField<ProducerCaptureEvent> batch;
+  for (int i = 0; i < kBatchSize; ++i) {
+    orbit_grpc_protos::SchedulingSlice* scheduling_slice = batch.Add()->mutable_scheduling_slice();
+    scheduling_slice->set_pid(1);
+    scheduling_slice->set_tid(i);
+    scheduling_slice->set_core(i % 8);
+    scheduling_slice->set_duration_ns(1000);
+    scheduling_slice->set_out_timestamp_ns(i * 1000);
+  }
+
+  for (bool batched : {false, true}) {
+    FakeCaptureEventSender sender;
+    sender.set_keep_events(false);
+    SenderThreadCaptureEventBuffer buffer{&sender};
+    std::unique_ptr<ProducerEventProcessor> producer_event_processor =
+        ProducerEventProcessor::Create(&buffer);
+
+    const absl::Time start = absl::Now();
+    for (uint64_t i = 0; i < kEventCount / kBatchSize; ++i) {
+      // The events are consumed by the processor, so give it a copy of the batch each time.
+      google::protobuf::RepeatedPtrField<ProducerCaptureEvent> events = batch;
+      if (batched) {
+        producer_event_processor->ProcessEvents(1, &events);
+      } else {
+        for (ProducerCaptureEvent& event : events) {
+          producer_event_processor->ProcessEvent(1, std::move(event));
+        }
+      }
+    }
+    buffer.StopAndWait();
+    const absl::Duration duration = absl::Now() - start;
+
+    EXPECT_EQ(sender.sent_event_count(), kEventCount);
+    LOG("%s: %.1f ns per event", batched ? "ProcessEvents" : "ProcessEvent",
+        absl::ToDoubleNanoseconds(duration) / kEventCount);
+  }
+}
+
+}  // namespace orbit_service
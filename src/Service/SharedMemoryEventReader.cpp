@@ -0,0 +1,125 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SharedMemoryEventReader.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_producer_side_channel::SharedMemoryApiEventRecord;
+using orbit_producer_side_channel::SharedMemoryRecordType;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
+
+namespace {
+
+// Returns false if the record is malformed.
+[[nodiscard]] bool DecodeRecord(SharedMemoryRecordType type, absl::Span<const uint8_t> payload,
+                                ProducerCaptureEvent* event) {
+  switch (type) {
+    case SharedMemoryRecordType::kProducerCaptureEvent:
+      return event->ParseFromArray(payload.data(), static_cast<int>(payload.size()));
+
+    case SharedMemoryRecordType::kApiEvent: {
+      if (payload.size() != sizeof(SharedMemoryApiEventRecord)) return false;
+      SharedMemoryApiEventRecord record;
+      memcpy(&record, payload.data(), sizeof(SharedMemoryApiEventRecord));
+      orbit_grpc_protos::ApiEvent* api_event = event->mutable_api_event();
+      api_event->set_timestamp_ns(record.timestamp_ns);
+      api_event->set_pid(record.pid);
+      api_event->set_tid(record.tid);
+      api_event->set_r0(record.args[0]);
+      api_event->set_r1(record.args[1]);
+      api_event->set_r2(record.args[2]);
+      api_event->set_r3(record.args[3]);
+      api_event->set_r4(record.args[4]);
+      api_event->set_r5(record.args[5]);
+      api_event->set_name_key(record.name_key);
+      return true;
+    }
+
+    case SharedMemoryRecordType::kWrapAround:
+      break;
+  }
+  return false;
+}
+
+}  // namespace
+
+SharedMemoryEventReader::SharedMemoryEventReader(
+    std::unique_ptr<SharedMemoryRingBuffer> ring_buffer, ProcessEventsFunction process_events)
+    : ring_buffer_{std::move(ring_buffer)}, process_events_{std::move(process_events)} {
+  CHECK(ring_buffer_ != nullptr);
+  CHECK(process_events_ != nullptr);
+  polling_thread_ = std::thread{&SharedMemoryEventReader::PollingThread, this};
+}
+
+SharedMemoryEventReader::~SharedMemoryEventReader() {
+  exit_requested_ = true;
+  polling_thread_.join();
+  Drain();
+}
+
+void SharedMemoryEventReader::Drain() {
+  absl::MutexLock lock{&mutex_};
+  while (ReadRecords() > 0) {
+  }
+}
+
+void SharedMemoryEventReader::PollingThread() {
+  orbit_base::SetCurrentThreadName("PSSI::ShmEvents");
+  while (!exit_requested_) {
+    size_t record_count;
+    {
+      absl::MutexLock lock{&mutex_};
+      record_count = ReadRecords();
+    }
+    if (record_count == 0) {
+      // Same polling interval as the forwarder thread of LockFreeBufferCaptureEventProducer.
+      static constexpr std::chrono::duration kSleepOnEmptyRingBuffer =
+          std::chrono::microseconds{1000};
+      std::this_thread::sleep_for(kSleepOnEmptyRingBuffer);
+    }
+  }
+}
+
+size_t SharedMemoryEventReader::ReadRecords() {
+  if (ring_buffer_corrupted_) return 0;
+
+  constexpr size_t kMaxRecordsPerBatch = 10'000;
+  bool record_malformed = false;
+  google::protobuf::RepeatedPtrField<ProducerCaptureEvent>& events = events_;
+  ErrorMessageOr<size_t> record_count_or_error = ring_buffer_->ConsumeRecords(
+      kMaxRecordsPerBatch,
+      [&events, &record_malformed](SharedMemoryRecordType type, absl::Span<const uint8_t> payload) {
+        ProducerCaptureEvent* event = events.Add();
+        if (!DecodeRecord(type, payload, event)) {
+          events.RemoveLast();
+          record_malformed = true;
+        }
+      });
+  if (record_malformed) {
+    ERROR("Malformed record in shared memory ring buffer \"%s\"", ring_buffer_->GetName());
+  }
+  if (record_count_or_error.has_error()) {
+    ERROR("Reading from shared memory ring buffer \"%s\": %s", ring_buffer_->GetName(),
+          record_count_or_error.error().message());
+    ring_buffer_corrupted_ = true;
+  }
+
+  if (!events_.empty()) {
+    process_events_(&events_);
+    events_.Clear();
+  }
+  return record_count_or_error.has_error() ? 0 : record_count_or_error.value();
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,65 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_SHARED_MEMORY_EVENT_READER_H_
+#define ORBIT_SERVICE_SHARED_MEMORY_EVENT_READER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <google/protobuf/repeated_field.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// Reads the records a producer writes to a SharedMemoryRingBuffer and decodes them into
+// ProducerCaptureEvents, which are passed in batches to `process_events`. Fixed-layout records are
+// decoded field by field, without any protobuf parsing.
+// An internal thread polls the ring buffer. Drain allows to synchronously read all the records
+// that have been written so far, for example when the producer has sent AllEventsSent.
+class SharedMemoryEventReader {
+ public:
+  using ProcessEventsFunction = std::function<void(
+      google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent>* events)>;
+
+  explicit SharedMemoryEventReader(
+      std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> ring_buffer,
+      ProcessEventsFunction process_events);
+  // Stops the internal thread and drains the ring buffer one last time.
+  ~SharedMemoryEventReader();
+
+  SharedMemoryEventReader(const SharedMemoryEventReader&) = delete;
+  SharedMemoryEventReader& operator=(const SharedMemoryEventReader&) = delete;
+  SharedMemoryEventReader(SharedMemoryEventReader&&) = delete;
+  SharedMemoryEventReader& operator=(SharedMemoryEventReader&&) = delete;
+
+  void Drain();
+
+ private:
+  void PollingThread();
+  // Returns the number of records read.
+  size_t ReadRecords() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  absl::Mutex mutex_;
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> ring_buffer_
+      ABSL_GUARDED_BY(mutex_);
+  bool ring_buffer_corrupted_ ABSL_GUARDED_BY(mutex_) = false;
+  // Cleared after each batch: RepeatedPtrField keeps the cleared messages around for reuse.
+  google::protobuf::RepeatedPtrField<orbit_grpc_protos::ProducerCaptureEvent> events_
+      ABSL_GUARDED_BY(mutex_);
+  ProcessEventsFunction process_events_;
+
+  std::atomic<bool> exit_requested_ = false;
+  std::thread polling_thread_;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_SHARED_MEMORY_EVENT_READER_H_
@@ -0,0 +1,137 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+#include "SharedMemoryEventReader.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_producer_side_channel::SharedMemoryApiEventRecord;
+using orbit_producer_side_channel::SharedMemoryRecordType;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
+
+namespace {
+
+class SharedMemoryEventReaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto producer_ring_buffer_or_error = SharedMemoryRingBuffer::Create(kCapacity);
+    ASSERT_FALSE(producer_ring_buffer_or_error.has_error());
+    producer_ring_buffer_ = std::move(producer_ring_buffer_or_error.value());
+
+    auto consumer_ring_buffer_or_error = SharedMemoryRingBuffer::OpenAndUnlink(
+        producer_ring_buffer_->GetName(), producer_ring_buffer_->GetSize());
+    ASSERT_FALSE(consumer_ring_buffer_or_error.has_error());
+    reader_ = std::make_unique<SharedMemoryEventReader>(
+        std::move(consumer_ring_buffer_or_error.value()),
+        [this](google::protobuf::RepeatedPtrField<ProducerCaptureEvent>* events) {
+          for (ProducerCaptureEvent& event : *events) {
+            processed_events_.push_back(std::move(event));
+          }
+        });
+  }
+
+  void WriteCaptureEvent(const ProducerCaptureEvent& event) {
+    std::string serialized_event = event.SerializeAsString();
+    uint8_t* payload = producer_ring_buffer_->TryBeginRecord(
+        SharedMemoryRecordType::kProducerCaptureEvent,
+        static_cast<uint32_t>(serialized_event.size()));
+    ASSERT_NE(payload, nullptr);
+    memcpy(payload, serialized_event.data(), serialized_event.size());
+    producer_ring_buffer_->CommitRecord();
+  }
+
+  static constexpr uint64_t kCapacity = 64 * 1024;
+  std::unique_ptr<SharedMemoryRingBuffer> producer_ring_buffer_;
+  std::unique_ptr<SharedMemoryEventReader> reader_;
+  // Only accessed from process_events, which the reader never calls concurrently, and after Drain.
+  std::vector<ProducerCaptureEvent> processed_events_;
+};
+
+}  // namespace
+
+TEST_F(SharedMemoryEventReaderTest, DecodesApiEventRecords) {
+  SharedMemoryApiEventRecord record{};
+  record.timestamp_ns = 100;
+  record.pid = 1;
+  record.tid = 2;
+  for (uint64_t i = 0; i < 6; ++i) record.args[i] = 10 + i;
+  record.name_key = 42;
+  ASSERT_TRUE(producer_ring_buffer_->TryWriteRecord(SharedMemoryRecordType::kApiEvent, record));
+
+  reader_->Drain();
+  ASSERT_EQ(processed_events_.size(), 1);
+  ASSERT_EQ(processed_events_[0].event_case(), ProducerCaptureEvent::kApiEvent);
+  const orbit_grpc_protos::ApiEvent& api_event = processed_events_[0].api_event();
+  EXPECT_EQ(api_event.timestamp_ns(), 100);
+  EXPECT_EQ(api_event.pid(), 1);
+  EXPECT_EQ(api_event.tid(), 2);
+  EXPECT_EQ(api_event.r0(), 10);
+  EXPECT_EQ(api_event.r1(), 11);
+  EXPECT_EQ(api_event.r2(), 12);
+  EXPECT_EQ(api_event.r3(), 13);
+  EXPECT_EQ(api_event.r4(), 14);
+  EXPECT_EQ(api_event.r5(), 15);
+  EXPECT_EQ(api_event.name_key(), 42);
+}
+
+TEST_F(SharedMemoryEventReaderTest, DecodesSerializedCaptureEventsInOrder) {
+  ProducerCaptureEvent interned_string;
+  interned_string.mutable_interned_string()->set_key(42);
+  interned_string.mutable_interned_string()->set_intern("name");
+  WriteCaptureEvent(interned_string);
+  SharedMemoryApiEventRecord record{};
+  record.name_key = 42;
+  ASSERT_TRUE(producer_ring_buffer_->TryWriteRecord(SharedMemoryRecordType::kApiEvent, record));
+
+  reader_->Drain();
+  ASSERT_EQ(processed_events_.size(), 2);
+  ASSERT_EQ(processed_events_[0].event_case(), ProducerCaptureEvent::kInternedString);
+  EXPECT_EQ(processed_events_[0].interned_string().key(), 42);
+  EXPECT_EQ(processed_events_[0].interned_string().intern(), "name");
+  ASSERT_EQ(processed_events_[1].event_case(), ProducerCaptureEvent::kApiEvent);
+  EXPECT_EQ(processed_events_[1].api_event().name_key(), 42);
+}
+
+TEST_F(SharedMemoryEventReaderTest, SkipsMalformedRecords) {
+  ASSERT_TRUE(producer_ring_buffer_->TryWriteRecord(SharedMemoryRecordType::kApiEvent,
+                                                    static_cast<uint64_t>(0)));
+  SharedMemoryApiEventRecord record{};
+  record.name_key = 1;
+  ASSERT_TRUE(producer_ring_buffer_->TryWriteRecord(SharedMemoryRecordType::kApiEvent, record));
+
+  reader_->Drain();
+  ASSERT_EQ(processed_events_.size(), 1);
+  EXPECT_EQ(processed_events_[0].api_event().name_key(), 1);
+}
+
+TEST_F(SharedMemoryEventReaderTest, DestructorDrainsRemainingRecords) {
+  constexpr uint64_t kRecordCount = 5'000;
+  for (uint64_t i = 0; i < kRecordCount; ++i) {
+    SharedMemoryApiEventRecord record{};
+    record.timestamp_ns = i;
+    while (!producer_ring_buffer_->TryWriteRecord(SharedMemoryRecordType::kApiEvent, record)) {
+      std::this_thread::yield();
+    }
+  }
+
+  reader_.reset();
+  ASSERT_EQ(processed_events_.size(), kRecordCount);
+  for (uint64_t i = 0; i < kRecordCount; ++i) {
+    EXPECT_EQ(processed_events_[i].api_event().timestamp_ns(), i);
+  }
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,372 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "UserSpaceInstrumentation/InstrumentProcess.h"
+
+#include <absl/base/casts.h>
+#include <absl/strings/match.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_split.h>
+#include <capstone/capstone.h>
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "AccessTraceesMemory.h"
+#include "AddressRange.h"
+#include "AllocateInTracee.h"
+#include "ObjectUtils/LinuxMap.h"
+#include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ReadFileToString.h"
+#include "OrbitBase/UniqueResource.h"
+#include "Trampoline.h"
+#include "UserSpaceInstrumentation/Attach.h"
+#include "UserSpaceInstrumentation/InjectLibraryInTracee.h"
+
+namespace orbit_user_space_instrumentation {
+
+using orbit_grpc_protos::CaptureOptions;
+using orbit_grpc_protos::InstrumentedFunction;
+using orbit_grpc_protos::ModuleInfo;
+
+namespace {
+
+// Number of bytes at the beginning of a function that CreateTrampoline might relocate.
+constexpr uint64_t kMaxFunctionPrologueBackupSize = 20;
+
+ErrorMessageOr<std::filesystem::path> GetLibOrbitUserSpaceInstrumentationPath() {
+  // When packaged, the library is found alongside OrbitService. In development, it is found in
+  // "../lib", relative to OrbitService.
+  constexpr const char* kLibName = "liborbituserspaceinstrumentation.so";
+  const std::filesystem::path exe_dir = orbit_base::GetExecutableDir();
+  std::vector<std::filesystem::path> potential_paths = {exe_dir / kLibName,
+                                                        exe_dir / "../lib" / kLibName};
+  for (const auto& path : potential_paths) {
+    if (std::filesystem::exists(path)) {
+      return path;
+    }
+  }
+  return ErrorMessage(absl::StrFormat("%s not found on system.", kLibName));
+}
+
+// The payload library calls into these libraries, e.g., malloc while recording a call, or the libc
+// and libpthread functions used by gRPC. A trampoline in one of them would call into the payload
+// library from the payload library itself, so the functions of these modules are left to uprobes.
+bool IsModuleExcludedFromInstrumentation(const ModuleInfo& module) {
+  constexpr std::array<std::string_view, 11> kExcludedModuleNamePrefixes = {
+      "ld-linux", "libc-", "libc.so", "libdl", "libgcc_s", "libm-", "libm.so", "libpthread",
+      "librt", "libstdc++", "liborbituserspaceinstrumentation"};
+  return std::any_of(kExcludedModuleNamePrefixes.begin(), kExcludedModuleNamePrefixes.end(),
+                     [&module](std::string_view prefix) {
+                       return absl::StartsWith(module.name(), prefix);
+                     });
+}
+
+// Returns the time the process started after system boot, in clock ticks. Together with the pid,
+// this identifies a process, as pids get reused.
+ErrorMessageOr<uint64_t> GetProcessStartTime(pid_t pid) {
+  OUTCOME_TRY(stat, orbit_base::ReadFileToString(absl::StrFormat("/proc/%d/stat", pid)));
+  // The second field is the executable name in parentheses, which can contain spaces and
+  // parentheses itself: only split what comes after it. `starttime` is the 22nd field.
+  const size_t comm_end = stat.rfind(')');
+  if (comm_end == std::string::npos) {
+    return ErrorMessage(absl::StrFormat("Unable to parse /proc/%d/stat", pid));
+  }
+  const std::vector<std::string_view> fields =
+      absl::StrSplit(std::string_view{stat}.substr(comm_end + 1), ' ', absl::SkipEmpty());
+  constexpr size_t kStartTimeIndex = 22 - 3;
+  uint64_t start_time = 0;
+  if (fields.size() <= kStartTimeIndex || !absl::SimpleAtoi(fields[kStartTimeIndex], &start_time)) {
+    return ErrorMessage(absl::StrFormat("Unable to parse /proc/%d/stat", pid));
+  }
+  return start_time;
+}
+
+}  // namespace
+
+// Instrumentation state of a single process. All methods assume that we are attached to the
+// process (see AttachAndStopProcess).
+class InstrumentedProcess {
+ public:
+  // Injects the payload library into process `pid` and creates the return trampoline.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<InstrumentedProcess>> Create(
+      pid_t pid, uint64_t start_time);
+
+  ~InstrumentedProcess() { cs_close(&capstone_handle_); }
+
+  InstrumentedProcess(const InstrumentedProcess&) = delete;
+  InstrumentedProcess& operator=(const InstrumentedProcess&) = delete;
+  InstrumentedProcess(InstrumentedProcess&&) = delete;
+  InstrumentedProcess& operator=(InstrumentedProcess&&) = delete;
+
+  [[nodiscard]] ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentFunctions(
+      const CaptureOptions& capture_options);
+
+  [[nodiscard]] ErrorMessageOr<void> UninstrumentFunctions();
+
+  [[nodiscard]] uint64_t start_time() const { return start_time_; }
+
+ private:
+  InstrumentedProcess(pid_t pid, uint64_t start_time) : pid_{pid}, start_time_{start_time} {}
+
+  struct FunctionTrampoline {
+    uint64_t trampoline_address;
+    uint64_t address_after_prologue;
+    // The beginning of the function before it was instrumented.
+    std::vector<uint8_t> original_code;
+  };
+
+  // Creates trampolines for `function_addresses_and_sizes`, all of which need to be in `module`.
+  // Functions for which no trampoline can be created are added to `functions_without_trampoline_`.
+  void CreateTrampolines(
+      const ModuleInfo& module,
+      const std::vector<std::pair<uint64_t, uint64_t>>& function_addresses_and_sizes);
+
+  pid_t pid_;
+  uint64_t start_time_;
+  csh capstone_handle_ = 0;
+  uint64_t entry_payload_function_address_ = 0;
+  uint64_t return_trampoline_address_ = 0;
+
+  // The keys of these containers are the absolute addresses of the functions in the process.
+  absl::flat_hash_map<uint64_t, FunctionTrampoline> trampolines_;
+  absl::flat_hash_set<uint64_t> functions_without_trampoline_;
+  absl::flat_hash_set<uint64_t> instrumented_functions_;
+
+  // Accumulates the relocations of all the trampolines created.
+  absl::flat_hash_map<uint64_t, uint64_t> relocation_map_;
+};
+
+ErrorMessageOr<std::unique_ptr<InstrumentedProcess>> InstrumentedProcess::Create(
+    pid_t pid, uint64_t start_time) {
+  std::unique_ptr<InstrumentedProcess> process{new InstrumentedProcess(pid, start_time)};
+
+  cs_err error_code = cs_open(CS_ARCH_X86, CS_MODE_64, &process->capstone_handle_);
+  if (error_code != CS_ERR_OK) {
+    return ErrorMessage("Unable to open capstone disassembler.");
+  }
+  error_code = cs_option(process->capstone_handle_, CS_OPT_DETAIL, CS_OPT_ON);
+  if (error_code != CS_ERR_OK) {
+    return ErrorMessage("Unable to configure capstone disassembler.");
+  }
+
+  OUTCOME_TRY(library_path, GetLibOrbitUserSpaceInstrumentationPath());
+  OUTCOME_TRY(library_handle, DlopenInTracee(pid, library_path, RTLD_NOW));
+  OUTCOME_TRY(entry_payload_function_address,
+              DlsymInTracee(pid, library_handle, "EntryPayload"));
+  process->entry_payload_function_address_ =
+      absl::bit_cast<uint64_t>(entry_payload_function_address);
+  OUTCOME_TRY(exit_payload_function_address, DlsymInTracee(pid, library_handle, "ExitPayload"));
+
+  OUTCOME_TRY(return_trampoline_address, AllocateInTracee(pid, 0, GetReturnTrampolineSize()));
+  process->return_trampoline_address_ = return_trampoline_address;
+  OUTCOME_TRY(CreateReturnTrampoline(pid, absl::bit_cast<uint64_t>(exit_payload_function_address),
+                                     return_trampoline_address));
+
+  return process;
+}
+
+void InstrumentedProcess::CreateTrampolines(
+    const ModuleInfo& module,
+    const std::vector<std::pair<uint64_t, uint64_t>>& function_addresses_and_sizes) {
+  // All the trampolines for the module are allocated at once, close enough to the module for the
+  // relative jumps from the functions to the trampolines and back.
+  const uint64_t max_trampoline_size = GetMaxTrampolineSize();
+  auto trampolines_address_or_error = AllocateMemoryForTrampolines(
+      pid_, AddressRange{module.address_start(), module.address_end()},
+      function_addresses_and_sizes.size() * max_trampoline_size);
+  if (trampolines_address_or_error.has_error()) {
+    ERROR("Allocating memory for trampolines for \"%s\": %s", module.file_path(),
+          trampolines_address_or_error.error().message());
+    for (const auto& [function_address, unused_size] : function_addresses_and_sizes) {
+      functions_without_trampoline_.insert(function_address);
+    }
+    return;
+  }
+
+  uint64_t trampoline_address = trampolines_address_or_error.value();
+  for (const auto& [function_address, function_size] : function_addresses_and_sizes) {
+    // The size is unknown (zero) for some functions: assume they are long enough.
+    const uint64_t backup_size = function_size == 0
+                                     ? kMaxFunctionPrologueBackupSize
+                                     : std::min(function_size, kMaxFunctionPrologueBackupSize);
+    auto function_code_or_error = ReadTraceesMemory(pid_, function_address, backup_size);
+    if (function_code_or_error.has_error()) {
+      functions_without_trampoline_.insert(function_address);
+      continue;
+    }
+    // On failure, the relocations already made must not be used: the trampoline's memory is
+    // reused for the next function.
+    absl::flat_hash_map<uint64_t, uint64_t> relocation_map;
+    auto address_after_prologue_or_error = CreateTrampoline(
+        pid_, function_address, function_code_or_error.value(), trampoline_address,
+        entry_payload_function_address_, return_trampoline_address_, capstone_handle_,
+        relocation_map);
+    if (address_after_prologue_or_error.has_error()) {
+      functions_without_trampoline_.insert(function_address);
+      continue;
+    }
+    relocation_map_.insert(relocation_map.begin(), relocation_map.end());
+    trampolines_.emplace(function_address,
+                         FunctionTrampoline{trampoline_address,
+                                            address_after_prologue_or_error.value(),
+                                            std::move(function_code_or_error.value())});
+    trampoline_address += max_trampoline_size;
+  }
+}
+
+ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentedProcess::InstrumentFunctions(
+    const CaptureOptions& capture_options) {
+  OUTCOME_TRY(modules, orbit_object_utils::ReadModules(pid_));
+  absl::flat_hash_map<std::string, const ModuleInfo*> modules_by_path;
+  for (const ModuleInfo& module : modules) {
+    modules_by_path.emplace(module.file_path(), &module);
+  }
+
+  // Pairs of absolute address and function id.
+  std::vector<std::pair<uint64_t, uint64_t>> functions_to_instrument;
+  // Pairs of absolute address and size of the functions that don't have a trampoline yet.
+  absl::flat_hash_map<const ModuleInfo*, std::vector<std::pair<uint64_t, uint64_t>>>
+      functions_without_trampoline_by_module;
+  absl::flat_hash_set<uint64_t> function_addresses_seen;
+  for (const InstrumentedFunction& function : capture_options.instrumented_functions()) {
+    // Timer start and stop functions are handled by LinuxTracing, which also records their
+    // arguments and return values.
+    if (function.function_type() != InstrumentedFunction::kRegular) continue;
+
+    auto module_it = modules_by_path.find(function.file_path());
+    if (module_it == modules_by_path.end()) continue;
+    const ModuleInfo* module = module_it->second;
+    if (module->build_id() != function.file_build_id()) {
+      ERROR("Build-id mismatch for \"%s\" when instrumenting functions", function.file_path());
+      continue;
+    }
+    if (IsModuleExcludedFromInstrumentation(*module)) continue;
+
+    const uint64_t function_address =
+        module->address_start() + function.file_offset() - module->executable_segment_offset();
+    if (functions_without_trampoline_.contains(function_address) ||
+        !function_addresses_seen.insert(function_address).second) {
+      continue;
+    }
+    if (!trampolines_.contains(function_address)) {
+      functions_without_trampoline_by_module[module].emplace_back(function_address,
+                                                                  function.function_size());
+    }
+    functions_to_instrument.emplace_back(function_address, function.function_id());
+  }
+
+  for (const auto& [module, function_addresses_and_sizes] :
+       functions_without_trampoline_by_module) {
+    CreateTrampolines(*module, function_addresses_and_sizes);
+  }
+
+  absl::flat_hash_set<uint64_t> instrumented_function_ids;
+  for (const auto& [function_address, function_id] : functions_to_instrument) {
+    auto trampoline_it = trampolines_.find(function_address);
+    if (trampoline_it == trampolines_.end()) continue;
+    const FunctionTrampoline& trampoline = trampoline_it->second;
+    // The function id is written into the trampoline each time, as it is not stable across
+    // captures.
+    auto result = InstrumentFunction(pid_, function_address, function_id,
+                                     trampoline.address_after_prologue,
+                                     trampoline.trampoline_address);
+    if (result.has_error()) {
+      // The caller falls back to uprobes for all functions: don't leave any function instrumented.
+      if (UninstrumentFunctions().has_error()) {
+        ERROR("Removing instrumentation from process %i", pid_);
+      }
+      return result.error();
+    }
+    instrumented_functions_.insert(function_address);
+    instrumented_function_ids.insert(function_id);
+  }
+  LOG("Instrumented %u out of %u functions with trampolines", instrumented_function_ids.size(),
+      capture_options.instrumented_functions_size());
+
+  MoveInstructionPointersOutOfOverwrittenCode(pid_, relocation_map_);
+
+  return instrumented_function_ids;
+}
+
+ErrorMessageOr<void> InstrumentedProcess::UninstrumentFunctions() {
+  // Threads executing the relocated prologue in a trampoline simply jump back into the function, so
+  // no instruction pointer needs to be moved.
+  for (uint64_t function_address : instrumented_functions_) {
+    OUTCOME_TRY(WriteTraceesMemory(pid_, function_address,
+                                   trampolines_.at(function_address).original_code));
+  }
+  instrumented_functions_.clear();
+  return outcome::success();
+}
+
+InstrumentationManager::InstrumentationManager() = default;
+
+InstrumentationManager::~InstrumentationManager() = default;
+
+ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentationManager::InstrumentProcess(
+    const CaptureOptions& capture_options) {
+  const pid_t pid = capture_options.pid();
+  OUTCOME_TRY(AttachAndStopProcess(pid));
+
+  // Make sure we resume the target process, even on early-outs.
+  orbit_base::unique_resource scope_exit{pid, [](pid_t pid) {
+                                           if (DetachAndContinueProcess(pid).has_error()) {
+                                             ERROR("Detaching from %i", pid);
+                                           }
+                                         }};
+
+  OUTCOME_TRY(start_time, GetProcessStartTime(pid));
+  auto process_it = process_map_.find(pid);
+  if (process_it != process_map_.end() && process_it->second->start_time() != start_time) {
+    // The process we instrumented has ended and its pid was reused: nothing of the previous
+    // instrumentation is in the new process.
+    process_map_.erase(process_it);
+    process_it = process_map_.end();
+  }
+  if (process_it == process_map_.end()) {
+    OUTCOME_TRY(process, InstrumentedProcess::Create(pid, start_time));
+    process_it = process_map_.emplace(pid, std::move(process)).first;
+  }
+  return process_it->second->InstrumentFunctions(capture_options);
+}
+
+ErrorMessageOr<void> InstrumentationManager::UninstrumentProcess(pid_t pid) {
+  auto process_it = process_map_.find(pid);
+  if (process_it == process_map_.end()) {
+    return outcome::success();
+  }
+
+  auto attach_result = AttachAndStopProcess(pid);
+  if (attach_result.has_error()) {
+    // Most likely the process has ended. Forget about it, so that a new process with the same pid
+    // is instrumented from scratch.
+    process_map_.erase(process_it);
+    return attach_result.error();
+  }
+
+  orbit_base::unique_resource scope_exit{pid, [](pid_t pid) {
+                                           if (DetachAndContinueProcess(pid).has_error()) {
+                                             ERROR("Detaching from %i", pid);
+                                           }
+                                         }};
+  auto start_time_or_error = GetProcessStartTime(pid);
+  if (start_time_or_error.has_error() ||
+      start_time_or_error.value() != process_it->second->start_time()) {
+    // A different process reuses the pid, so there is nothing to uninstrument.
+    process_map_.erase(process_it);
+    return outcome::success();
+  }
+  return process_it->second->UninstrumentFunctions();
+}
+
+}  // namespace orbit_user_space_instrumentation
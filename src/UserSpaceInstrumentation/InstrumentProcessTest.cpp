@@ -0,0 +1,177 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_set.h>
+#include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "AccessTraceesMemory.h"
+#include "ObjectUtils/ElfFile.h"
+#include "ObjectUtils/LinuxMap.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/TestUtils.h"
+#include "UserSpaceInstrumentation/Attach.h"
+#include "UserSpaceInstrumentation/InstrumentProcess.h"
+#include "capture.pb.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+using orbit_base::HasNoError;
+using orbit_grpc_protos::CaptureOptions;
+using orbit_grpc_protos::InstrumentedFunction;
+using testing::ElementsAreArray;
+
+constexpr uint64_t kFunctionId = 42;
+
+extern "C" __attribute__((noinline)) int SomethingToInstrument() {
+  static int counter = 0;
+  return ++counter;
+}
+
+// Returns true if `module_name` is `name`, possibly followed by an extension and a version, e.g.
+// both "libc.so.6" and "libc-2.31.so" are named "libc".
+bool ModuleHasName(std::string_view module_name, std::string_view name) {
+  return module_name == name || absl::StartsWith(module_name, absl::StrCat(name, ".")) ||
+         absl::StartsWith(module_name, absl::StrCat(name, "-"));
+}
+
+// Returns the function `function_name` of the module `module_name` of process `pid` as it would be
+// sent by the client.
+InstrumentedFunction GetInstrumentedFunctionOrDie(pid_t pid, std::string_view module_name,
+                                                  std::string_view function_name) {
+  auto modules = orbit_object_utils::ReadModules(pid);
+  CHECK(!modules.has_error());
+  for (const auto& module : modules.value()) {
+    if (!ModuleHasName(module.name(), module_name)) continue;
+    auto elf_file = orbit_object_utils::CreateElfFile(module.file_path());
+    CHECK(!elf_file.has_error());
+    // System libraries usually come without .symtab.
+    auto symbols = elf_file.value()->HasDebugInfo() ? elf_file.value()->LoadDebugSymbols()
+                                                    : elf_file.value()->LoadSymbolsFromDynsym();
+    CHECK(!symbols.has_error());
+    for (const auto& symbol : symbols.value().symbol_infos()) {
+      if (symbol.name() != function_name) continue;
+      InstrumentedFunction function;
+      function.set_file_path(module.file_path());
+      function.set_file_build_id(module.build_id());
+      function.set_file_offset(symbol.address() - symbols.value().load_bias());
+      function.set_function_size(symbol.size());
+      function.set_function_id(kFunctionId);
+      function.set_function_name(symbol.name());
+      return function;
+    }
+  }
+  FATAL("Unable to find function \"%s\"", function_name);
+}
+
+std::vector<uint8_t> ReadFunctionCodeOrDie(pid_t pid, const InstrumentedFunction& function) {
+  CHECK(AttachAndStopProcess(pid).has_value());
+  auto modules = orbit_object_utils::ReadModules(pid);
+  CHECK(!modules.has_error());
+  uint64_t function_address = 0;
+  for (const auto& module : modules.value()) {
+    if (module.file_path() == function.file_path()) {
+      function_address =
+          module.address_start() + function.file_offset() - module.executable_segment_offset();
+    }
+  }
+  auto code = ReadTraceesMemory(pid, function_address, function.function_size());
+  CHECK(code.has_value());
+  CHECK(!DetachAndContinueProcess(pid).has_error());
+  return code.value();
+}
+
+}  // namespace
+
+TEST(InstrumentProcessTest, InstrumentAndUninstrumentRepeatedly) {
+  pid_t pid = fork();
+  CHECK(pid != -1);
+  if (pid == 0) {
+    uint64_t sum = 0;
+    while (true) {
+      sum += SomethingToInstrument();
+    }
+  }
+
+  CaptureOptions capture_options;
+  capture_options.set_pid(pid);
+  *capture_options.add_instrumented_functions() =
+      GetInstrumentedFunctionOrDie(pid, "UserSpaceInstrumentationTests", "SomethingToInstrument");
+  const std::vector<uint8_t> original_code =
+      ReadFunctionCodeOrDie(pid, capture_options.instrumented_functions(0));
+
+  InstrumentationManager instrumentation_manager;
+  // The second capture reuses the payload library and the trampoline.
+  for (int capture = 0; capture < 2; ++capture) {
+    auto instrumented_function_ids_or_error =
+        instrumentation_manager.InstrumentProcess(capture_options);
+    ASSERT_THAT(instrumented_function_ids_or_error, HasNoError());
+    EXPECT_EQ(instrumented_function_ids_or_error.value(),
+              absl::flat_hash_set<uint64_t>{kFunctionId});
+    EXPECT_NE(ReadFunctionCodeOrDie(pid, capture_options.instrumented_functions(0)),
+              original_code);
+
+    // Let the child run the instrumented function for a while.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    EXPECT_THAT(instrumentation_manager.UninstrumentProcess(pid), HasNoError());
+    EXPECT_THAT(ReadFunctionCodeOrDie(pid, capture_options.instrumented_functions(0)),
+                ElementsAreArray(original_code));
+  }
+
+  // The child is still alive and running.
+  EXPECT_EQ(waitpid(pid, nullptr, WNOHANG), 0);
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+TEST(InstrumentProcessTest, FunctionsInLibcAreLeftToUprobes) {
+  pid_t pid = fork();
+  CHECK(pid != -1);
+  if (pid == 0) {
+    while (true) {
+      void* volatile memory = malloc(16);
+      free(memory);
+    }
+  }
+
+  CaptureOptions capture_options;
+  capture_options.set_pid(pid);
+  // The payload library itself calls malloc while recording a call.
+  *capture_options.add_instrumented_functions() =
+      GetInstrumentedFunctionOrDie(pid, "libc", "malloc");
+  const std::vector<uint8_t> original_code =
+      ReadFunctionCodeOrDie(pid, capture_options.instrumented_functions(0));
+
+  InstrumentationManager instrumentation_manager;
+  auto instrumented_function_ids_or_error =
+      instrumentation_manager.InstrumentProcess(capture_options);
+  ASSERT_THAT(instrumented_function_ids_or_error, HasNoError());
+  EXPECT_TRUE(instrumented_function_ids_or_error.value().empty());
+  EXPECT_THAT(ReadFunctionCodeOrDie(pid, capture_options.instrumented_functions(0)),
+              ElementsAreArray(original_code));
+  EXPECT_THAT(instrumentation_manager.UninstrumentProcess(pid), HasNoError());
+
+  // The child is still alive and running.
+  EXPECT_EQ(waitpid(pid, nullptr, WNOHANG), 0);
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+}  // namespace orbit_user_space_instrumentation
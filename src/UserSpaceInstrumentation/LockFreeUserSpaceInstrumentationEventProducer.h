@@ -0,0 +1,141 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_LOCK_FREE_USER_SPACE_INSTRUMENTATION_EVENT_PRODUCER_H_
+#define USER_SPACE_INSTRUMENTATION_LOCK_FREE_USER_SPACE_INSTRUMENTATION_EVENT_PRODUCER_H_
+
+#include <google/protobuf/arena.h>
+#include <grpcpp/channel.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <array>
+#include <memory>
+
+#include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "capture.pb.h"
+
+namespace orbit_user_space_instrumentation {
+
+// Intermediate event for a call to an instrumented function that has returned. Unlike
+// orbit_grpc_protos::FunctionCall, creating it doesn't involve any allocation.
+struct FunctionCallEvent {
+  pid_t pid;
+  pid_t tid;
+  uint64_t function_id;
+  uint64_t begin_timestamp_ns;
+  uint64_t end_timestamp_ns;
+  int32_t depth;
+};
+
+// This class is used by the payload library injected into the tracee (see
+// OrbitUserSpaceInstrumentation.h) to record calls to the functions instrumented with trampolines
+// and relay them to OrbitService as orbit_grpc_protos::FunctionCall events.
+//
+// The functions currently being executed are kept on a per-thread stack, so OnFunctionEntry and
+// OnFunctionExit don't synchronize with other threads. The stack has a fixed size, so that
+// recording the entry of a function never allocates. Completed calls are enqueued in the
+// lock-free queue of LockFreeBufferCaptureEventProducer, which keeps a separate sub-queue for each
+// thread that enqueues.
+class LockFreeUserSpaceInstrumentationEventProducer
+    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<FunctionCallEvent> {
+ public:
+  explicit LockFreeUserSpaceInstrumentationEventProducer(
+      const std::shared_ptr<grpc::Channel>& channel) {
+    BuildAndStart(channel);
+  }
+
+  ~LockFreeUserSpaceInstrumentationEventProducer() override { ShutdownAndWait(); }
+
+  // Called on entry of an instrumented function. The call is recorded even when not capturing, as
+  // the matching OnFunctionExit needs to return `return_address`.
+  void OnFunctionEntry(uint64_t return_address, uint64_t function_id) {
+    // A zero timestamp marks calls that started outside of a capture: they are not sent.
+    const uint64_t begin_timestamp_ns = IsCapturing() ? orbit_base::CaptureTimestampNs() : 0;
+    PushOpenFunctionCall({return_address, function_id, begin_timestamp_ns});
+  }
+
+  // Called on exit of an instrumented function. Returns the return address passed to the matching
+  // OnFunctionEntry, where the execution has to continue.
+  [[nodiscard]] uint64_t OnFunctionExit() {
+    const OpenFunctionCall open_function_call = PopOpenFunctionCall();
+    if (open_function_call.begin_timestamp_ns != 0 && IsCapturing()) {
+      static const pid_t pid = orbit_base::GetCurrentProcessId();
+      thread_local const pid_t tid = orbit_base::GetCurrentThreadId();
+      EnqueueIntermediateEvent(FunctionCallEvent{
+          pid, tid, open_function_call.function_id, open_function_call.begin_timestamp_ns,
+          orbit_base::CaptureTimestampNs(), static_cast<int32_t>(GetOpenFunctionCalls().size)});
+    }
+    return open_function_call.return_address;
+  }
+
+  // Like OnFunctionEntry and OnFunctionExit, but for instrumented functions that are called while
+  // the payload library is already running on the thread, e.g., from OnFunctionEntry itself. Only
+  // the return address is kept: these calls are not recorded, and no producer is needed.
+  static void OnReentrantFunctionEntry(uint64_t return_address) {
+    PushOpenFunctionCall({return_address, 0, 0});
+  }
+  [[nodiscard]] static uint64_t OnReentrantFunctionExit() {
+    return PopOpenFunctionCall().return_address;
+  }
+
+ protected:
+  [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      FunctionCallEvent&& function_call_event, google::protobuf::Arena* arena) override {
+    auto* capture_event =
+        google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
+    orbit_grpc_protos::FunctionCall* function_call = capture_event->mutable_function_call();
+    function_call->set_pid(function_call_event.pid);
+    function_call->set_tid(function_call_event.tid);
+    function_call->set_function_id(function_call_event.function_id);
+    function_call->set_duration_ns(function_call_event.end_timestamp_ns -
+                                   function_call_event.begin_timestamp_ns);
+    function_call->set_end_timestamp_ns(function_call_event.end_timestamp_ns);
+    function_call->set_depth(function_call_event.depth);
+    return capture_event;
+  }
+
+ private:
+  struct OpenFunctionCall {
+    uint64_t return_address;
+    uint64_t function_id;
+    uint64_t begin_timestamp_ns;
+  };
+
+  // Instrumented functions nested deeper than this on a thread abort the tracee, as the return
+  // address of the innermost call couldn't be kept.
+  static constexpr size_t kMaxOpenFunctionCallCount = 1024;
+
+  // Unlike a std::vector, this is constant-initialized: neither creating it for a new thread nor
+  // pushing to it allocates.
+  struct OpenFunctionCallStack {
+    std::array<OpenFunctionCall, kMaxOpenFunctionCallCount> calls;
+    size_t size = 0;
+  };
+
+  [[nodiscard]] static OpenFunctionCallStack& GetOpenFunctionCalls() {
+    thread_local OpenFunctionCallStack open_function_calls;
+    return open_function_calls;
+  }
+
+  static void PushOpenFunctionCall(const OpenFunctionCall& open_function_call) {
+    OpenFunctionCallStack& open_function_calls = GetOpenFunctionCalls();
+    CHECK(open_function_calls.size < kMaxOpenFunctionCallCount);
+    open_function_calls.calls[open_function_calls.size++] = open_function_call;
+  }
+
+  [[nodiscard]] static OpenFunctionCall PopOpenFunctionCall() {
+    OpenFunctionCallStack& open_function_calls = GetOpenFunctionCalls();
+    CHECK(open_function_calls.size > 0);
+    return open_function_calls.calls[--open_function_calls.size];
+  }
+};
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // USER_SPACE_INSTRUMENTATION_LOCK_FREE_USER_SPACE_INSTRUMENTATION_EVENT_PRODUCER_H_
@@ -0,0 +1,198 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <grpcpp/server_impl.h>
+#include <grpcpp/support/channel_arguments.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventProducer/FakeProducerSideService.h"
+#include "LockFreeUserSpaceInstrumentationEventProducer.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "capture.pb.h"
+#include "grpcpp/grpcpp.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::ProducerCaptureEvent;
+
+constexpr std::chrono::duration kWaitMessagesSentDuration = std::chrono::milliseconds(25);
+
+class LockFreeUserSpaceInstrumentationEventProducerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fake_service_.emplace();
+
+    grpc::ServerBuilder builder;
+    builder.RegisterService(&fake_service_.value());
+    fake_server_ = builder.BuildAndStart();
+    ASSERT_NE(fake_server_, nullptr);
+
+    ON_CALL(*fake_service_, OnCaptureEventsReceived)
+        .WillByDefault([this](const std::vector<ProducerCaptureEvent>& events) {
+          absl::MutexLock lock{&mutex_};
+          for (const ProducerCaptureEvent& event : events) {
+            if (keep_function_calls_) {
+              received_function_calls_.push_back(event.function_call());
+            }
+            ++received_event_count_;
+          }
+        });
+
+    producer_.emplace(fake_server_->InProcessChannel(grpc::ChannelArguments{}));
+
+    // Leave some time for the ReceiveCommandsAndSendEvents RPC to actually happen.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  void TearDown() override {
+    // Leave some time for all pending communication to finish.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    producer_.reset();
+
+    fake_service_->FinishAndDisallowRpc();
+    fake_server_->Shutdown();
+    fake_server_->Wait();
+
+    fake_service_.reset();
+    fake_server_.reset();
+  }
+
+  void StartCapture() {
+    fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{});
+    std::this_thread::sleep_for(kWaitMessagesSentDuration);
+    ASSERT_TRUE(producer_->IsCapturing());
+  }
+
+  void StopCapture() {
+    fake_service_->SendStopCaptureCommand();
+    std::this_thread::sleep_for(kWaitMessagesSentDuration);
+    ASSERT_FALSE(producer_->IsCapturing());
+  }
+
+  std::optional<orbit_capture_event_producer::FakeProducerSideService> fake_service_;
+  std::unique_ptr<grpc::Server> fake_server_;
+  std::optional<LockFreeUserSpaceInstrumentationEventProducer> producer_;
+
+  absl::Mutex mutex_;
+  bool keep_function_calls_ ABSL_GUARDED_BY(mutex_) = true;
+  std::vector<FunctionCall> received_function_calls_ ABSL_GUARDED_BY(mutex_);
+  uint64_t received_event_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace
+
+TEST_F(LockFreeUserSpaceInstrumentationEventProducerTest, ReturnAddressesAreKeptWhenNotCapturing) {
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+
+  producer_->OnFunctionEntry(/*return_address=*/0x100, /*function_id=*/1);
+  producer_->OnFunctionEntry(/*return_address=*/0x200, /*function_id=*/2);
+  EXPECT_EQ(producer_->OnFunctionExit(), 0x200);
+  producer_->OnFunctionEntry(/*return_address=*/0x300, /*function_id=*/3);
+  EXPECT_EQ(producer_->OnFunctionExit(), 0x300);
+  EXPECT_EQ(producer_->OnFunctionExit(), 0x100);
+
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+}
+
+TEST_F(LockFreeUserSpaceInstrumentationEventProducerTest, FunctionCallsAreSentWhileCapturing) {
+  // Started before the capture: not sent, but still counted in the depth.
+  producer_->OnFunctionEntry(/*return_address=*/0x100, /*function_id=*/1);
+
+  StartCapture();
+  const uint64_t begin_timestamp_ns = orbit_base::CaptureTimestampNs();
+  producer_->OnFunctionEntry(/*return_address=*/0x200, /*function_id=*/2);
+  producer_->OnFunctionEntry(/*return_address=*/0x300, /*function_id=*/3);
+  EXPECT_EQ(producer_->OnFunctionExit(), 0x300);
+  EXPECT_EQ(producer_->OnFunctionExit(), 0x200);
+  const uint64_t end_timestamp_ns = orbit_base::CaptureTimestampNs();
+  EXPECT_EQ(producer_->OnFunctionExit(), 0x100);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  StopCapture();
+
+  absl::MutexLock lock{&mutex_};
+  ASSERT_EQ(received_function_calls_.size(), 2);
+  const FunctionCall& inner_call = received_function_calls_[0];
+  const FunctionCall& outer_call = received_function_calls_[1];
+  EXPECT_EQ(inner_call.pid(), orbit_base::GetCurrentProcessId());
+  EXPECT_EQ(inner_call.tid(), orbit_base::GetCurrentThreadId());
+  EXPECT_EQ(inner_call.function_id(), 3);
+  EXPECT_EQ(inner_call.depth(), 2);
+  EXPECT_EQ(outer_call.function_id(), 2);
+  EXPECT_EQ(outer_call.depth(), 1);
+  EXPECT_LE(outer_call.end_timestamp_ns(), end_timestamp_ns);
+  EXPECT_GE(outer_call.end_timestamp_ns() - outer_call.duration_ns(), begin_timestamp_ns);
+  EXPECT_LE(inner_call.end_timestamp_ns(), outer_call.end_timestamp_ns());
+  EXPECT_LE(inner_call.duration_ns(), outer_call.duration_ns());
+}
+
+TEST_F(LockFreeUserSpaceInstrumentationEventProducerTest, ReentrantFunctionCallsAreNotSent) {
+  StartCapture();
+  producer_->OnFunctionEntry(/*return_address=*/0x100, /*function_id=*/1);
+  // As for a function called by the payload library itself.
+  LockFreeUserSpaceInstrumentationEventProducer::OnReentrantFunctionEntry(
+      /*return_address=*/0x200);
+  EXPECT_EQ(LockFreeUserSpaceInstrumentationEventProducer::OnReentrantFunctionExit(), 0x200);
+  EXPECT_EQ(producer_->OnFunctionExit(), 0x100);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  StopCapture();
+
+  absl::MutexLock lock{&mutex_};
+  ASSERT_EQ(received_function_calls_.size(), 1);
+  EXPECT_EQ(received_function_calls_[0].function_id(), 1);
+  EXPECT_EQ(received_function_calls_[0].depth(), 0);
+}
+
+// Logs the per-call overhead of the payload of a function instrumented with trampolines, outside
+// of and during a capture. For comparison, a uprobe and uretprobe pair traps into the kernel twice
+// on each call. Pass --gtest_also_run_disabled_tests to run it.
+TEST_F(LockFreeUserSpaceInstrumentationEventProducerTest, DISABLED_PerCallOverheadBenchmark) {
+  constexpr uint64_t kCallCount = 100'000;
+  {
+    absl::MutexLock lock{&mutex_};
+    keep_function_calls_ = false;
+  }
+
+  auto run_calls = [this](uint64_t call_count) {
+    const absl::Time start = absl::Now();
+    for (uint64_t i = 0; i < call_count; ++i) {
+      producer_->OnFunctionEntry(/*return_address=*/i, /*function_id=*/1);
+      CHECK(producer_->OnFunctionExit() == i);
+    }
+    return absl::Now() - start;
+  };
+
+  const absl::Duration not_capturing_duration = run_calls(kCallCount);
+
+  StartCapture();
+  const absl::Duration capturing_duration = run_calls(kCallCount);
+  // Leave time for the forwarder thread to send the events.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  StopCapture();
+
+  {
+    absl::MutexLock lock{&mutex_};
+    EXPECT_EQ(received_event_count_, kCallCount);
+  }
+  LOG("Not capturing: %.1f ns per call, capturing: %.1f ns per call",
+      absl::ToDoubleNanoseconds(not_capturing_duration) / kCallCount,
+      absl::ToDoubleNanoseconds(capturing_duration) / kCallCount);
+}
+
+}  // namespace orbit_user_space_instrumentation
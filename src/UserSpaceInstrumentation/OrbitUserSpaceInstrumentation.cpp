@@ -0,0 +1,45 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitUserSpaceInstrumentation.h"
+
+#include "LockFreeUserSpaceInstrumentationEventProducer.h"
+#include "ProducerSideChannel/ProducerSideChannel.h"
+
+using orbit_user_space_instrumentation::LockFreeUserSpaceInstrumentationEventProducer;
+
+namespace {
+
+LockFreeUserSpaceInstrumentationEventProducer& GetCaptureEventProducer() {
+  static LockFreeUserSpaceInstrumentationEventProducer producer{
+      orbit_producer_side_channel::CreateProducerSideChannel()};
+  return producer;
+}
+
+// Set while the payload is running on the thread. Instrumented functions that the payload calls
+// itself, e.g., while creating the producer and its gRPC channel on the first call, enter the
+// payload again: they are not recorded, so that this can't recurse.
+thread_local bool is_in_payload = false;
+
+}  // namespace
+
+void EntryPayload(uint64_t return_address, uint64_t function_id) {
+  if (is_in_payload) {
+    LockFreeUserSpaceInstrumentationEventProducer::OnReentrantFunctionEntry(return_address);
+    return;
+  }
+  is_in_payload = true;
+  GetCaptureEventProducer().OnFunctionEntry(return_address, function_id);
+  is_in_payload = false;
+}
+
+uint64_t ExitPayload() {
+  if (is_in_payload) {
+    return LockFreeUserSpaceInstrumentationEventProducer::OnReentrantFunctionExit();
+  }
+  is_in_payload = true;
+  const uint64_t return_address = GetCaptureEventProducer().OnFunctionExit();
+  is_in_payload = false;
+  return return_address;
+}
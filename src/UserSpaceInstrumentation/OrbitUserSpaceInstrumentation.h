@@ -0,0 +1,24 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_ORBIT_USER_SPACE_INSTRUMENTATION_H_
+#define USER_SPACE_INSTRUMENTATION_ORBIT_USER_SPACE_INSTRUMENTATION_H_
+
+#include <cstdint>
+
+// These are the payload functions of liborbituserspaceinstrumentation.so. OrbitService injects the
+// library into the tracee and makes the trampolines of the instrumented functions call them (see
+// InstrumentProcess.h). The functions called by the payload (libc, libstdc++, gRPC, ...) must not
+// be instrumented themselves.
+
+// Payload called on entry of an instrumented function. Records the return address of the function
+// and the time of the call. `function_id` is the id of the instrumented function.
+extern "C" void EntryPayload(uint64_t return_address, uint64_t function_id);
+
+// Payload called on exit of an instrumented function. Sends the completed call to OrbitService
+// if a capture is in progress and returns the actual return address of the function, such that
+// the execution can be continued there.
+extern "C" uint64_t ExitPayload();
+
+#endif  // USER_SPACE_INSTRUMENTATION_ORBIT_USER_SPACE_INSTRUMENTATION_H_
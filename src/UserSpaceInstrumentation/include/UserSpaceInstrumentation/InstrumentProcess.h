@@ -0,0 +1,56 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_INSTRUMENT_PROCESS_H_
+#define USER_SPACE_INSTRUMENTATION_INSTRUMENT_PROCESS_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "OrbitBase/Result.h"
+#include "capture.pb.h"
+
+namespace orbit_user_space_instrumentation {
+
+class InstrumentedProcess;
+
+// Instruments functions of a process with trampolines calling into the payload library
+// liborbituserspaceinstrumentation.so (see OrbitUserSpaceInstrumentation.h). Unlike uprobes, this
+// doesn't involve the kernel on each call of an instrumented function.
+// An instance is meant to live as long as OrbitService: the payload library, the trampolines and
+// the backups of the overwritten code are set up the first time a process is instrumented and
+// reused by the following captures. As pids get reused, processes are told apart by their start
+// time as well.
+class InstrumentationManager {
+ public:
+  InstrumentationManager();
+  ~InstrumentationManager();
+
+  InstrumentationManager(const InstrumentationManager&) = delete;
+  InstrumentationManager& operator=(const InstrumentationManager&) = delete;
+  InstrumentationManager(InstrumentationManager&&) = delete;
+  InstrumentationManager& operator=(InstrumentationManager&&) = delete;
+
+  // Instruments the functions in `capture_options.instrumented_functions()` in the process
+  // `capture_options.pid()` and returns the ids of the functions that were instrumented. The other
+  // functions (e.g. the ones with a prologue that can't be relocated into a trampoline, or the ones
+  // in libraries that the payload library itself uses, like libc) are left to uprobes.
+  [[nodiscard]] ErrorMessageOr<absl::flat_hash_set<uint64_t>> InstrumentProcess(
+      const orbit_grpc_protos::CaptureOptions& capture_options);
+
+  // Restores the original code of the functions instrumented in process `pid`. The payload library
+  // and the trampolines stay in the process, as threads might still be executing them.
+  [[nodiscard]] ErrorMessageOr<void> UninstrumentProcess(pid_t pid);
+
+ private:
+  absl::flat_hash_map<pid_t, std::unique_ptr<InstrumentedProcess>> process_map_;
+};
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // USER_SPACE_INSTRUMENTATION_INSTRUMENT_PROCESS_H_